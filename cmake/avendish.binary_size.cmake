@@ -0,0 +1,47 @@
+# Binary size report: lists the plug-in modules found in a build tree by size,
+#   cmake -DAVND_BINARY_DIR=<build dir> -P avendish.binary_size.cmake
+# e.g. to check how much of each plug-in is taken by the binding code.
+cmake_minimum_required(VERSION 3.23)
+
+if(NOT IS_DIRECTORY "${AVND_BINARY_DIR}")
+  message(FATAL_ERROR "No build directory in ${AVND_BINARY_DIR}")
+endif()
+
+file(GLOB_RECURSE modules
+  LIST_DIRECTORIES false
+  "${AVND_BINARY_DIR}/*.clap"
+  "${AVND_BINARY_DIR}/*.so"
+  "${AVND_BINARY_DIR}/*.dylib"
+  "${AVND_BINARY_DIR}/*.dll"
+  "${AVND_BINARY_DIR}/*.pd_linux"
+  "${AVND_BINARY_DIR}/*.pd_darwin"
+  "${AVND_BINARY_DIR}/*.mxe64"
+)
+
+set(total 0)
+set(entries)
+foreach(module ${modules})
+  if(IS_SYMLINK "${module}")
+    continue()
+  endif()
+  file(SIZE "${module}" bytes)
+  math(EXPR total "${total} + ${bytes}")
+  # Zero-padded so that the entries sort by size
+  string(LENGTH "${bytes}" len)
+  math(EXPR pad "12 - ${len}")
+  string(REPEAT "0" ${pad} zeros)
+  file(RELATIVE_PATH name "${AVND_BINARY_DIR}" "${module}")
+  list(APPEND entries "${zeros}${bytes} ${name}")
+endforeach()
+list(SORT entries ORDER DESCENDING)
+list(LENGTH entries count)
+
+math(EXPR total_kib "${total} / 1024")
+message("${count} modules, ${total_kib} KiB in total:")
+foreach(entry ${entries})
+  string(REGEX REPLACE "^0*([0-9]+) (.*)$" "\\1\t\\2" entry "${entry}")
+  string(REGEX MATCH "^[0-9]+" bytes "${entry}")
+  math(EXPR kib "${bytes} / 1024")
+  string(REGEX REPLACE "^[0-9]+" "${kib} KiB" entry "${entry}")
+  message("  ${entry}")
+endforeach()
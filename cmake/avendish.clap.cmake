@@ -85,6 +85,7 @@ target_sources(Avendish PRIVATE
   "${AVND_SOURCE_DIR}/include/avnd/binding/clap/audio_effect.hpp"
   #"${AVND_SOURCE_DIR}/include/avnd/binding/clap/atomic_controls.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/clap/configure.hpp"
+  "${AVND_SOURCE_DIR}/include/avnd/binding/clap/core.hpp"
   #"${AVND_SOURCE_DIR}/include/avnd/binding/clap/dispatch.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/clap/helpers.hpp"
   #"${AVND_SOURCE_DIR}/include/avnd/binding/clap/midi_processor.hpp"
@@ -28,6 +28,31 @@ include(avendish.clap)
 include(avendish.ossia)
 include(avendish.standalone)
 include(avendish.example)
+include(avendish.freestanding)
+
+# The bindings are skipped when their SDK is not found: builds which must check them,
+# e.g. on CI, list them here to fail instead.
+set(AVENDISH_REQUIRED_BINDINGS "" CACHE STRING
+    "Bindings whose SDK must be found, among vst3;clap;ossia;python;portaudio")
+foreach(binding ${AVENDISH_REQUIRED_BINDINGS})
+  if(binding STREQUAL "vst3")
+    set(found VST3_SDK_ROOT)
+  elseif(binding STREQUAL "clap")
+    set(found CLAP_HEADER)
+  elseif(binding STREQUAL "ossia")
+    set(found TARGET ossia::ossia)
+  elseif(binding STREQUAL "python")
+    set(found pybind11_FOUND)
+  elseif(binding STREQUAL "portaudio")
+    set(found PORTAUDIO_INCLUDE_DIR AND PORTAUDIO_LIBRARY)
+  else()
+    message(FATAL_ERROR "Unknown binding in AVENDISH_REQUIRED_BINDINGS: ${binding}")
+  endif()
+
+  if(NOT (${found}))
+    message(FATAL_ERROR "The ${binding} binding is required but its SDK was not found")
+  endif()
+endforeach()
 
 # Used for getting completion in IDEs...
 function(avnd_register)
@@ -0,0 +1,96 @@
+# Compile-time benchmark of the introspection and of the bindings, see AVENDISH_COMPILE_BENCH.
+#
+# For each size N of AVENDISH_COMPILE_BENCH_SIZES, a synthetic processor with N parameters,
+# N output controls, N messages and an audio bus is generated and compiled:
+#  - through each of the introspection headers, in a translation unit of its own;
+#  - through each binding available in this build, with avnd_make_all.
+#
+# Building avendish_compile_bench rebuilds them one at a time, then prints their compile
+# times, and their peak memory when GNU time is installed. With clang, the details of
+# -ftime-trace are in a .json next to each object.
+if(NOT AVENDISH_COMPILE_BENCH)
+  return()
+endif()
+
+set(AVENDISH_COMPILE_BENCH_SIZES 10 100 500 CACHE STRING "The numbers of controls and messages of the synthetic processors")
+
+set(AVND_BENCH_DIR "${CMAKE_BINARY_DIR}/compile_bench")
+set(AVND_BENCH_TEMPLATES "${AVND_SOURCE_DIR}/tests/compile_bench")
+set(AVND_BENCH_HEADERS)
+set(AVND_BENCH_TARGETS)
+
+foreach(BENCH_N ${AVENDISH_COMPILE_BENCH_SIZES})
+  set(BENCH_INPUTS "")
+  set(BENCH_OUTPUTS "")
+  set(BENCH_FUNCTIONS "")
+  set(BENCH_MESSAGES "")
+  math(EXPR last "${BENCH_N} - 1")
+  foreach(i RANGE 0 ${last})
+    string(APPEND BENCH_INPUTS "    halp::hslider_f32<\"In ${i}\", halp::range{0., 1., 0.5}> in${i};\n")
+    string(APPEND BENCH_OUTPUTS "    halp::hbargraph_f32<\"Out ${i}\", halp::range{0., 1., 0.}> out${i};\n")
+    string(APPEND BENCH_FUNCTIONS "  void msg${i}(float v) { outputs.out${i}.value = v * inputs.in${i}.value; }\n")
+    string(APPEND BENCH_MESSAGES "    halp_mem_fun(msg${i})\n")
+  endforeach()
+  string(UUID BENCH_UUID NAMESPACE "6ba7b810-9dad-11d1-80b4-00c04fd430c8" NAME "avnd_compile_bench_${BENCH_N}" TYPE SHA1)
+
+  set(BENCH_HEADER "${AVND_BENCH_DIR}/synthetic_${BENCH_N}.hpp")
+  configure_file("${AVND_BENCH_TEMPLATES}/synthetic.hpp.in" "${BENCH_HEADER}" @ONLY)
+  list(APPEND AVND_BENCH_HEADERS "${BENCH_HEADER}")
+
+  foreach(subject input output messages widgets)
+    set(source "${AVND_BENCH_DIR}/${subject}_${BENCH_N}.cpp")
+    configure_file("${AVND_BENCH_TEMPLATES}/${subject}.cpp.in" "${source}" @ONLY)
+
+    add_library(compile_bench_${subject}_${BENCH_N} OBJECT EXCLUDE_FROM_ALL "${source}")
+    avnd_common_setup("" compile_bench_${subject}_${BENCH_N})
+    list(APPEND AVND_BENCH_TARGETS compile_bench_${subject}_${BENCH_N})
+  endforeach()
+
+  avnd_make_all(
+    TARGET compile_bench_${BENCH_N}
+    MAIN_FILE "${BENCH_HEADER}"
+    MAIN_CLASS compile_bench::synthetic_${BENCH_N}
+    C_NAME avnd_compile_bench_${BENCH_N}
+  )
+
+  # Only the bindings whose SDK was found in this build exist
+  foreach(binding clap max ossia pd python standalone vintage vst3 example_host)
+    if(TARGET compile_bench_${BENCH_N}_${binding})
+      set_target_properties(compile_bench_${BENCH_N}_${binding} PROPERTIES EXCLUDE_FROM_ALL ON)
+      list(APPEND AVND_BENCH_TARGETS compile_bench_${BENCH_N}_${binding})
+    endif()
+  endforeach()
+endforeach()
+
+# The peak memory needs GNU time: the BSD one does not have -f
+find_program(AVND_GNU_TIME NAMES gtime time)
+set(AVND_BENCH_TIME)
+if(AVND_GNU_TIME)
+  execute_process(COMMAND "${AVND_GNU_TIME}" --version OUTPUT_VARIABLE version ERROR_VARIABLE version)
+  if(version MATCHES "GNU")
+    set(AVND_BENCH_TIME "-DAVND_TIME=${AVND_GNU_TIME};")
+  endif()
+endif()
+
+set(AVND_BENCH_REPORT "${CMAKE_BINARY_DIR}/compile_bench.csv")
+foreach(target ${AVND_BENCH_TARGETS})
+  set_target_properties(${target}
+    PROPERTIES
+      CXX_COMPILER_LAUNCHER
+        "${CMAKE_COMMAND};-DAVND_REPORT=${AVND_BENCH_REPORT};${AVND_BENCH_TIME}-P;${AVND_SOURCE_DIR}/cmake/avendish.compile_time.cmake;--"
+  )
+  if("${CMAKE_CXX_COMPILER_ID}" MATCHES "Clang")
+    target_compile_options(${target} PRIVATE -ftime-trace)
+  endif()
+endforeach()
+
+add_custom_target(avendish_compile_bench
+  COMMAND "${CMAKE_COMMAND}" -E rm -f "${AVND_BENCH_REPORT}"
+  COMMAND "${CMAKE_COMMAND}" -E touch ${AVND_BENCH_HEADERS}
+  COMMAND "${CMAKE_COMMAND}" --build "${CMAKE_BINARY_DIR}" -j 1 --target ${AVND_BENCH_TARGETS}
+  COMMAND "${CMAKE_COMMAND}"
+    -DAVND_SUMMARY=ON
+    "-DAVND_REPORT=${AVND_BENCH_REPORT}"
+    -P "${AVND_SOURCE_DIR}/cmake/avendish.compile_time.cmake"
+  VERBATIM
+)
@@ -0,0 +1,88 @@
+# Compile time report, see AVENDISH_COMPILE_TIME_REPORT.
+#
+# As a compiler launcher, records how long each translation unit takes to build:
+#   cmake -DAVND_REPORT=<file> -P avendish.compile_time.cmake -- <compiler> <args...>
+# appends "<milliseconds>;<object file>" to the report.
+# With -DAVND_TIME=<GNU time>, runs the compiler through it and appends its peak memory too:
+# "<milliseconds>;<object file>;<kilobytes>".
+#
+# With -DAVND_SUMMARY=ON, prints the slowest translation units of the report instead.
+cmake_minimum_required(VERSION 3.23)
+
+if(AVND_SUMMARY)
+  if(NOT EXISTS "${AVND_REPORT}")
+    message(FATAL_ERROR "No compile time report in ${AVND_REPORT}: build with AVENDISH_COMPILE_TIME_REPORT first")
+  endif()
+
+  file(STRINGS "${AVND_REPORT}" lines)
+  set(total 0)
+  set(entries)
+  foreach(line ${lines})
+    list(GET line 0 ms)
+    list(GET line 1 object)
+    list(LENGTH line fields)
+    if(fields GREATER 2)
+      list(GET line 2 kb)
+      math(EXPR mb "${kb} / 1024")
+      string(APPEND object " (${mb} MB)")
+    endif()
+    math(EXPR total "${total} + ${ms}")
+    # Zero-padded so that the entries sort by time
+    string(LENGTH "${ms}" len)
+    math(EXPR pad "10 - ${len}")
+    string(REPEAT "0" ${pad} zeros)
+    list(APPEND entries "${zeros}${ms} ${object}")
+  endforeach()
+  list(SORT entries ORDER DESCENDING)
+  list(LENGTH entries count)
+
+  message("${count} translation units, ${total} ms in total. Slowest:")
+  list(SUBLIST entries 0 20 slowest)
+  foreach(entry ${slowest})
+    string(REGEX REPLACE "^0*([0-9]+) (.*)$" "\\1 ms\t\\2" entry "${entry}")
+    message("  ${entry}")
+  endforeach()
+  return()
+endif()
+
+set(command)
+set(object)
+set(in_command OFF)
+set(next_is_object OFF)
+math(EXPR last "${CMAKE_ARGC} - 1")
+foreach(i RANGE 1 ${last})
+  set(arg "${CMAKE_ARGV${i}}")
+  if(in_command)
+    list(APPEND command "${arg}")
+    if(next_is_object)
+      set(object "${arg}")
+      set(next_is_object OFF)
+    elseif(arg STREQUAL "-o")
+      set(next_is_object ON)
+    endif()
+  elseif(arg STREQUAL "--")
+    set(in_command ON)
+  endif()
+endforeach()
+
+set(memory_file "${object}.peak_memory")
+if(AVND_TIME)
+  list(PREPEND command "${AVND_TIME}" -f "%M" -o "${memory_file}")
+endif()
+
+string(TIMESTAMP start "%s%f")
+execute_process(COMMAND ${command} RESULT_VARIABLE res)
+string(TIMESTAMP end "%s%f")
+
+# The diagnostics were already printed by the compiler
+if(NOT res EQUAL 0)
+  message(FATAL_ERROR "Compilation of ${object} failed")
+endif()
+
+math(EXPR ms "(${end} - ${start}) / 1000")
+if(AVND_TIME AND EXISTS "${memory_file}")
+  file(STRINGS "${memory_file}" kb REGEX "^[0-9]+$")
+  file(APPEND "${AVND_REPORT}" "${ms};${object};${kb}\n")
+else()
+  file(APPEND "${AVND_REPORT}" "${ms};${object}\n")
+endif()
@@ -1,5 +1,10 @@
 include(CTest)
 
+option(AVENDISH_EXAMPLE_PROFILING "Also run the example hosts in profiling mode as tests, writing profiles/*.json" OFF)
+if(AVENDISH_EXAMPLE_PROFILING)
+  file(MAKE_DIRECTORY "${CMAKE_BINARY_DIR}/profiles")
+endif()
+
 function(avnd_make_example_host)
   cmake_parse_arguments(AVND "" "TARGET;MAIN_FILE;MAIN_CLASS" "" ${ARGN})
 
@@ -20,6 +25,12 @@ function(avnd_make_example_host)
 
   add_executable(${AVND_FX_TARGET})
   add_test(NAME ${AVND_FX_TARGET} COMMAND ${AVND_FX_TARGET})
+  if(AVENDISH_EXAMPLE_PROFILING)
+    add_test(
+      NAME ${AVND_FX_TARGET}_profile
+      COMMAND ${AVND_FX_TARGET} --profile "--output=${CMAKE_BINARY_DIR}/profiles/${AVND_TARGET}.json"
+    )
+  endif()
 
   set_target_properties(${AVND_FX_TARGET}
     PROPERTIES
@@ -134,6 +134,82 @@ avnd_make_all(
   C_NAME avnd_helpers_messages
   )
 
+avnd_make_all(
+  TARGET HelpersCVLowpass
+  MAIN_FILE examples/Helpers/CVLowpass.hpp
+  MAIN_CLASS examples::helpers::CVLowpass
+  C_NAME avnd_cv_lowpass
+  )
+
+avnd_make_all(
+  TARGET HelpersChangedControlsLowpass
+  MAIN_FILE examples/Helpers/ChangedControls.hpp
+  MAIN_CLASS examples::helpers::ChangedControlsLowpass
+  C_NAME avnd_changed_controls_lowpass
+  )
+
+# The audio plug-in and object bindings have no XY controls
+avnd_register(
+  TARGET HelpersMorphDistortion
+  MAIN_FILE examples/Helpers/Morph.hpp
+  MAIN_CLASS examples::helpers::MorphDistortion
+  C_NAME avnd_morph_distortion
+  )
+avnd_make_ossia(
+  TARGET HelpersMorphDistortion
+  MAIN_FILE examples/Helpers/Morph.hpp
+  MAIN_CLASS examples::helpers::MorphDistortion
+  C_NAME avnd_morph_distortion
+  )
+avnd_make_example_host(
+  TARGET HelpersMorphDistortion
+  MAIN_FILE examples/Helpers/Morph.hpp
+  MAIN_CLASS examples::helpers::MorphDistortion
+  C_NAME avnd_morph_distortion
+  )
+
+avnd_make_all(
+  TARGET HelpersWorkerWavetable
+  MAIN_FILE examples/Helpers/Worker.hpp
+  MAIN_CLASS examples::helpers::WorkerWavetable
+  C_NAME avnd_worker_wavetable
+  )
+
+avnd_make_all(
+  TARGET HelpersCoroutineSequencer
+  MAIN_FILE examples/Helpers/CoroutineSequencer.hpp
+  MAIN_CLASS examples::helpers::CoroutineSequencer
+  C_NAME avnd_coroutine_sequencer
+  )
+
+avnd_make_all(
+  TARGET HelpersTimedTrigger
+  MAIN_FILE examples/Helpers/TimedTrigger.hpp
+  MAIN_CLASS examples::helpers::TimedTrigger
+  C_NAME avnd_timed_trigger
+  )
+
+avnd_make_all(
+  TARGET HelpersMidiCV
+  MAIN_FILE examples/Helpers/MidiCV.hpp
+  MAIN_CLASS examples::helpers::MidiCV
+  C_NAME avnd_midi_cv
+  )
+
+avnd_make_all(
+  TARGET HelpersRingPanner
+  MAIN_FILE examples/Helpers/RingPanner.hpp
+  MAIN_CLASS examples::helpers::RingPanner
+  C_NAME avnd_ring_panner
+  )
+
+avnd_make_all(
+  TARGET HelpersControlRateSweep
+  MAIN_FILE examples/Helpers/ControlRate.hpp
+  MAIN_CLASS examples::helpers::ControlRateSweep
+  C_NAME avnd_control_rate_sweep
+  )
+
 avnd_make_all(
   TARGET HelpersPerBusAsArgs
   MAIN_FILE examples/Helpers/PerBus.hpp
@@ -155,6 +231,13 @@ avnd_make_all(
   C_NAME avnd_helpers_per_bus_as_ports_dynamic
   )
 
+avnd_make_all(
+  TARGET HelpersPerBusAsOutputs
+  MAIN_FILE examples/Helpers/PerBus.hpp
+  MAIN_CLASS examples::helpers::PerBusAsOutputs
+  C_NAME avnd_helpers_per_bus_as_outputs
+  )
+
 avnd_make_all(
   TARGET HelpersPerSampleAsArgs
   MAIN_FILE examples/Helpers/PerSample.hpp
@@ -169,6 +252,83 @@ avnd_make_all(
   C_NAME avnd_helpers_per_sample_as_ports
   )
 
+avnd_make_all(
+  TARGET HelpersPerSampleLowpass
+  MAIN_FILE examples/Helpers/PerSample.hpp
+  MAIN_CLASS examples::helpers::PerSampleLowpass
+  C_NAME avnd_helpers_per_sample_lowpass
+  )
+
+avnd_make_all(
+  TARGET HelpersModulatedGain
+  MAIN_FILE examples/Helpers/ModulatedGain.hpp
+  MAIN_CLASS examples::helpers::ModulatedGain
+  C_NAME avnd_helpers_modulated_gain
+  )
+
+avnd_make_all(
+  TARGET HelpersSmoothedGain
+  MAIN_FILE examples/Helpers/SmoothedGain.hpp
+  MAIN_CLASS examples::helpers::SmoothedGain
+  C_NAME avnd_helpers_smoothed_gain
+  )
+
+avnd_make_all(
+  TARGET HelpersSpectralGate
+  MAIN_FILE examples/Helpers/SpectralGate.hpp
+  MAIN_CLASS examples::helpers::SpectralGate
+  C_NAME avnd_helpers_spectral_gate
+  )
+
+avnd_make_all(
+  TARGET HelpersLimiter
+  MAIN_FILE examples/Helpers/Limiter.hpp
+  MAIN_CLASS examples::helpers::Limiter
+  C_NAME avnd_helpers_limiter
+  )
+
+avnd_make_all(
+  TARGET HelpersStreamedPlayer
+  MAIN_FILE examples/Helpers/StreamedPlayer.hpp
+  MAIN_CLASS examples::helpers::StreamedPlayer
+  C_NAME avnd_helpers_streamed_player
+  )
+
+avnd_make_all(
+  TARGET HelpersConvolutionReverb
+  MAIN_FILE examples/Helpers/ConvolutionReverb.hpp
+  MAIN_CLASS examples::helpers::ConvolutionReverb
+  C_NAME avnd_helpers_convolution_reverb
+  )
+
+avnd_make_all(
+  TARGET HelpersGranulator
+  MAIN_FILE examples/Helpers/Granulator.hpp
+  MAIN_CLASS examples::helpers::Granulator
+  C_NAME avnd_helpers_granulator
+  )
+
+avnd_make_all(
+  TARGET HelpersMeter
+  MAIN_FILE examples/Helpers/Meter.hpp
+  MAIN_CLASS examples::helpers::Meter
+  C_NAME avnd_helpers_meter
+  )
+
+avnd_make_all(
+  TARGET HelpersGainLowpass
+  MAIN_FILE examples/Helpers/Chain.hpp
+  MAIN_CLASS examples::helpers::GainLowpass
+  C_NAME avnd_helpers_gain_lowpass
+  )
+
+avnd_make_all(
+  TARGET OversampledDistortion
+  MAIN_FILE examples/Helpers/Oversampled.hpp
+  MAIN_CLASS examples::OversampledDistortion
+  C_NAME avnd_oversampled_distortion
+  )
+
 avnd_make_all(
   TARGET HelpersLowpass
   MAIN_FILE examples/Helpers/Lowpass.hpp
@@ -176,6 +336,13 @@ avnd_make_all(
   C_NAME avnd_helpers_lowpass
   )
 
+avnd_make_all(
+  TARGET HelpersWavetableSynth
+  MAIN_FILE examples/Helpers/WavetableSynth.hpp
+  MAIN_CLASS examples::helpers::WavetableSynth
+  C_NAME avnd_helpers_wavetable_synth
+  )
+
 avnd_make_all(
   TARGET HelpersMidi
   MAIN_FILE examples/Helpers/Midi.hpp
@@ -224,6 +391,7 @@ set(OSSIA_EXAMPLES
   Synth
   TextureFilterExample
   TextureGeneratorExample
+  TexturePassthroughExample
 )
 foreach(theTarget ${OSSIA_EXAMPLES})
   avnd_make_ossia(
@@ -241,6 +409,18 @@ avnd_make_all(
   MAIN_CLASS essentia_ports::Entropy
   C_NAME avnd_essentia_entropy
 )
+avnd_make_all(
+  TARGET Essentia_Spectrum
+  MAIN_FILE examples/Ports/Essentia/standard/Spectrum.hpp
+  MAIN_CLASS essentia_ports::Spectrum
+  C_NAME avnd_essentia_spectrum
+)
+avnd_make_all(
+  TARGET Essentia_Windowing
+  MAIN_FILE examples/Ports/Essentia/standard/Windowing.hpp
+  MAIN_CLASS essentia_ports::Windowing
+  C_NAME avnd_essentia_windowing
+)
 avnd_make_object(
   TARGET CCC
   MAIN_FILE examples/Ports/LitterPower/CCC.hpp
@@ -254,8 +434,34 @@ avnd_make_object(
   C_NAME avnd_vb_fourses_tilde
 )
 
+avnd_make_all(
+  TARGET HelpersRenderQualitySaturation
+  MAIN_FILE examples/Helpers/RenderQuality.hpp
+  MAIN_CLASS examples::helpers::RenderQualitySaturation
+  C_NAME avnd_render_quality_saturation
+  )
+
+avnd_make_all(
+  TARGET HelpersAdditiveSaw
+  MAIN_FILE examples/Helpers/QualityLevels.hpp
+  MAIN_CLASS examples::helpers::AdditiveSaw
+  C_NAME avnd_additive_saw
+  )
+
+avnd_make_all(
+  TARGET HelpersMultitrackRecorder
+  MAIN_FILE examples/Helpers/Recorder.hpp
+  MAIN_CLASS examples::helpers::MultitrackRecorder
+  C_NAME avnd_multitrack_recorder
+  )
+
 
 # Demo: dump all the known metadata.
 
 add_executable(demo_dump examples/Demos/Dump.cpp)
 target_link_libraries(demo_dump PRIVATE Avendish)
+
+# Demo: offline throughput of the same processors, compared with a saved baseline.
+
+add_executable(demo_benchmark examples/Demos/Benchmark.cpp)
+target_link_libraries(demo_benchmark PRIVATE Avendish)
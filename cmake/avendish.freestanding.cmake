@@ -0,0 +1,78 @@
+# Freestanding profile, for micro-controllers and DSP boards (Cortex-M, ESP32, Daisy...):
+# see avnd/common/freestanding.hpp. The firmware project sets up the toolchain of its board,
+# then links the library made by avnd_make_freestanding and calls its C functions.
+set(AVENDISH_FREESTANDING_MAX_CHANNELS 8 CACHE STRING "Most channels of a freestanding processor")
+set(AVENDISH_FREESTANDING_MAX_FRAMES 256 CACHE STRING "Most frames of the buffers of a freestanding processor")
+set(AVENDISH_FREESTANDING_ARENA_BYTES 16384 CACHE STRING "Bytes of the conversion buffers of a freestanding processor")
+
+add_library(Avendish_freestanding INTERFACE)
+add_library(Avendish::Freestanding ALIAS Avendish_freestanding)
+
+target_compile_features(Avendish_freestanding INTERFACE cxx_std_20)
+target_include_directories(Avendish_freestanding
+  INTERFACE
+    $<BUILD_INTERFACE:${AVND_SOURCE_DIR}/include>
+)
+target_compile_definitions(Avendish_freestanding
+  INTERFACE
+    AVND_FREESTANDING=1
+    AVND_DISABLE_COROUTINES=1
+    AVND_FREESTANDING_MAX_CHANNELS=${AVENDISH_FREESTANDING_MAX_CHANNELS}
+    AVND_FREESTANDING_MAX_FRAMES=${AVENDISH_FREESTANDING_MAX_FRAMES}
+    AVND_FREESTANDING_ARENA_BYTES=${AVENDISH_FREESTANDING_ARENA_BYTES}
+)
+if("${CMAKE_CXX_COMPILER_ID}" MATCHES "GNU|Clang")
+  target_compile_options(Avendish_freestanding
+    INTERFACE
+      -ffunction-sections
+      -fdata-sections
+      -fno-threadsafe-statics
+  )
+endif()
+
+# Boost is only used for its headers: mp11, pfr
+target_link_libraries(Avendish_freestanding
+  INTERFACE
+    DisableExceptions
+    Boost::boost
+)
+
+function(avnd_make_freestanding)
+  cmake_parse_arguments(AVND "" "TARGET;MAIN_FILE;MAIN_CLASS;C_NAME" "" ${ARGN})
+  set(AVND_FX_TARGET "${AVND_TARGET}_freestanding")
+  add_library(${AVND_FX_TARGET} STATIC)
+
+  configure_file(
+    "${AVND_SOURCE_DIR}/include/avnd/binding/freestanding/prototype.cpp.in"
+    "${CMAKE_BINARY_DIR}/${AVND_C_NAME}_freestanding.cpp"
+    @ONLY
+    NEWLINE_STYLE LF
+  )
+
+  target_sources(
+    ${AVND_FX_TARGET}
+    PRIVATE
+      "${CMAKE_BINARY_DIR}/${AVND_C_NAME}_freestanding.cpp"
+  )
+
+  set_target_properties(
+    ${AVND_FX_TARGET}
+    PROPERTIES
+      OUTPUT_NAME "${AVND_C_NAME}"
+      ARCHIVE_OUTPUT_DIRECTORY freestanding
+  )
+
+  target_link_libraries(
+    ${AVND_FX_TARGET}
+    PUBLIC
+      Avendish::Freestanding
+  )
+
+  if(TARGET "${AVND_TARGET}")
+    target_link_libraries(${AVND_FX_TARGET} PRIVATE ${AVND_TARGET})
+  endif()
+endfunction()
+
+target_sources(Avendish PRIVATE
+  "${AVND_SOURCE_DIR}/include/avnd/binding/freestanding/processor.hpp"
+)
@@ -114,6 +114,7 @@ add_library(Avendish::Avendish_max ALIAS Avendish_max)
 
 target_sources(Avendish PRIVATE
   "${AVND_SOURCE_DIR}/include/avnd/binding/max/atom_iterator.hpp"
+  "${AVND_SOURCE_DIR}/include/avnd/binding/max/attributes.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/max/audio_processor.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/max/configure.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/max/dsp.hpp"
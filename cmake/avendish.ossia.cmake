@@ -9,11 +9,16 @@ if(NOT TARGET ossia::ossia)
   return()
 endif()
 
+option(AVENDISH_OSSIA_PROFILING "Record the time spent in each node, see avnd/wrappers/profiling.hpp" OFF)
+
 # Define a PCH
 add_library(Avendish_ossia_pch STATIC "${AVND_SOURCE_DIR}/src/dummy.cpp")
 target_link_libraries(Avendish_ossia_pch PRIVATE
   ossia::ossia
 )
+if(AVENDISH_OSSIA_PROFILING)
+  target_compile_definitions(Avendish_ossia_pch PUBLIC AVND_PROFILING=1)
+endif()
 
 target_precompile_headers(Avendish_ossia_pch
   PUBLIC
@@ -68,12 +73,21 @@ function(avnd_make_ossia)
       SDL2
   )
 
+  if(AVENDISH_OSSIA_PROFILING)
+    target_compile_definitions(${AVND_FX_TARGET} PUBLIC AVND_PROFILING=1)
+  endif()
+
   avnd_common_setup("${AVND_TARGET}" "${AVND_FX_TARGET}")
 
   target_sources(Avendish PRIVATE
     "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/all.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/configure.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/gpu_node.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/gpu_pipeline_cache.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/gpu_staging.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/messages.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/node.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/node_pool.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/port_setup.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/port_run_preprocess.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/ossia/port_run_postprocess.hpp"
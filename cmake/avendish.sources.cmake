@@ -9,6 +9,7 @@ target_sources(Avendish
     "${AVND_SOURCE_DIR}/include/avnd/concepts/callback.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/concepts/channels.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/concepts/fft.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/concepts/fixed_point.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/concepts/generic.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/concepts/gfx.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/concepts/layout.hpp"
@@ -33,21 +34,65 @@ target_sources(Avendish
     "${AVND_SOURCE_DIR}/include/avnd/introspection/port.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/introspection/widgets.hpp"
 
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/audio_buffers.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/audio_channel_manager.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/avnd.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/background_worker.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/bus_host_process_adapter.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/bypass.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/chain.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/changed_controls.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/configure.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/constant_inputs.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/control_display.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/control_rate.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/controls.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/controls_double.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/controls_fp.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/controls_mirror.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/controls_storage.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/deferred_outputs.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/deadline.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/denormals.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/effect_container.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/fixed_block.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/instance_pool.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/interleaved.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/latency.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/mapped_soundfile.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/message_bus.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/metadatas.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/modulation_storage.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/morph.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/optional_busses.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/output_parameters.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/oversampling.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/per_bus.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/prepare.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/process_adapter.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/process_execution.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/profiling.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/programs.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/quality_governor.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/realtime_sanitizer.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/render_mode.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/resample.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/shared_controls.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/simd_state_storage.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/silence.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/smoothing_storage.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/soundfile_recorder.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/soundfile_stream.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/state.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/sub_block_scheduler.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/texture_async.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/texture_passthrough.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/texture_pool.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/texture_tiles.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/thread_pool.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/tracing.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/wrappers/widgets.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/wrappers/worker.hpp"
 
     "${AVND_SOURCE_DIR}/include/avnd/common/concepts_polyfill.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/common/coroutines.hpp"
@@ -55,26 +100,58 @@ target_sources(Avendish
     "${AVND_SOURCE_DIR}/include/avnd/common/errors.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/common/export.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/common/for_nth.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/common/freestanding.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/common/function_reflection.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/common/index_sequence.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/common/limited_string.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/common/limited_string_view.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/common/member_range.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/common/render_mode.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/common/selector_cache.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/common/setup_change.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/common/span_polyfill.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/common/spsc_queue.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/common/static_vector.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/common/struct_reflection.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/common/texture_access.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/common/triple_buffer.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/common/widechar.hpp"
 
     "${AVND_SOURCE_DIR}/include/halp/audio.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/block_coroutine.hpp"
     "${AVND_SOURCE_DIR}/include/halp/callback.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/changed_controls.hpp"
     "${AVND_SOURCE_DIR}/include/halp/controls.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/convolution.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/fastmath.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/filter_bank.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/fixed_point.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/granular.hpp"
     "${AVND_SOURCE_DIR}/include/halp/layout.hpp"
     "${AVND_SOURCE_DIR}/include/halp/log.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/lookahead.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/matrix_mixer.hpp"
     "${AVND_SOURCE_DIR}/include/halp/messages.hpp"
     "${AVND_SOURCE_DIR}/include/halp/meta.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/meter.hpp"
     "${AVND_SOURCE_DIR}/include/halp/midi.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/midi_to_cv.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/modulated_controls.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/morph.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/note_expressions.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/random.hpp"
     "${AVND_SOURCE_DIR}/include/halp/reactive_value.hpp"
     "${AVND_SOURCE_DIR}/include/halp/sample_accurate_controls.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/shared_resource.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/smoothed_controls.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/soundfile_reader.hpp"
     "${AVND_SOURCE_DIR}/include/halp/static_string.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/statistics.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/stft.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/tasks.hpp"
     "${AVND_SOURCE_DIR}/include/halp/texture.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/tuning.hpp"
+    "${AVND_SOURCE_DIR}/include/halp/wavetable.hpp"
 
     "${AVND_SOURCE_DIR}/include/gpp/commands.hpp"
     "${AVND_SOURCE_DIR}/include/gpp/generators.hpp"
@@ -93,6 +170,38 @@ if(AVENDISH_INCLUDE_SOURCE_ONLY)
   return()
 endif()
 
+option(AVENDISH_COMPILE_TIME_REPORT "Record the compile time of each translation unit, e.g. of the examples" OFF)
+set(AVENDISH_COMPILE_TIME_FILE "${CMAKE_BINARY_DIR}/compile_time.csv" CACHE FILEPATH "Where AVENDISH_COMPILE_TIME_REPORT writes")
+option(AVENDISH_COMPILE_BENCH "Add avendish_compile_bench, the compile time of the introspection and of the bindings for growing processors" OFF)
+option(AVENDISH_RT_SANITIZE "Report the allocations, locks and blocking syscalls in the audio callbacks, see avnd/wrappers/realtime_sanitizer.hpp" OFF)
+option(AVENDISH_DEADLINE_MONITOR "Count the audio callbacks over their time budget, see avnd/wrappers/deadline.hpp" OFF)
+
+set(AVENDISH_TRACING "" CACHE STRING "Trace zones in the bindings, see avnd/wrappers/tracing.hpp: tracy, perfetto, or empty for none")
+set_property(CACHE AVENDISH_TRACING PROPERTY STRINGS "" tracy perfetto)
+if(AVENDISH_TRACING STREQUAL "tracy")
+  find_package(Tracy REQUIRED)
+elseif(AVENDISH_TRACING STREQUAL "perfetto")
+  # The Perfetto SDK is shipped as sources: sdk/perfetto.h and sdk/perfetto.cc
+  set(AVENDISH_PERFETTO_SDK "" CACHE PATH "The sdk folder of Perfetto")
+  find_package(Threads REQUIRED)
+  add_library(avendish_perfetto STATIC
+    "${AVENDISH_PERFETTO_SDK}/perfetto.cc"
+    "${AVND_SOURCE_DIR}/src/tracing_perfetto.cpp"
+  )
+  target_include_directories(avendish_perfetto
+    PUBLIC
+      "${AVENDISH_PERFETTO_SDK}"
+    PRIVATE
+      "${AVND_SOURCE_DIR}/include"
+  )
+  target_compile_definitions(avendish_perfetto PUBLIC AVND_TRACING_PERFETTO=1)
+  target_compile_features(avendish_perfetto PUBLIC cxx_std_20)
+  set_target_properties(avendish_perfetto PROPERTIES POSITION_INDEPENDENT_CODE 1)
+  target_link_libraries(avendish_perfetto PUBLIC Threads::Threads)
+elseif(NOT AVENDISH_TRACING STREQUAL "")
+  message(FATAL_ERROR "AVENDISH_TRACING: unknown backend ${AVENDISH_TRACING}")
+endif()
+
 function(avnd_target_setup AVND_FX_TARGET)
   target_compile_features(
       ${AVND_FX_TARGET}
@@ -192,6 +301,35 @@ function(avnd_target_setup AVND_FX_TARGET)
   )
 
   target_link_libraries(${AVND_FX_TARGET} PUBLIC Boost::boost)
+
+  if(AVENDISH_RT_SANITIZE)
+    target_compile_definitions(${AVND_FX_TARGET} PUBLIC AVND_RT_SANITIZE=1)
+  endif()
+
+  if(AVENDISH_DEADLINE_MONITOR)
+    target_compile_definitions(${AVND_FX_TARGET} PUBLIC AVND_DEADLINE_MONITOR=1)
+  endif()
+
+  if(AVENDISH_TRACING STREQUAL "tracy")
+    target_compile_definitions(${AVND_FX_TARGET} PUBLIC AVND_TRACING_TRACY=1)
+    target_link_libraries(${AVND_FX_TARGET} PUBLIC Tracy::TracyClient)
+  elseif(AVENDISH_TRACING STREQUAL "perfetto")
+    target_link_libraries(${AVND_FX_TARGET} PUBLIC avendish_perfetto)
+  endif()
+
+  if(AVENDISH_COMPILE_TIME_REPORT)
+    set_target_properties(
+      ${AVND_FX_TARGET}
+      PROPERTIES
+        CXX_COMPILER_LAUNCHER
+          "${CMAKE_COMMAND};-DAVND_REPORT=${AVENDISH_COMPILE_TIME_FILE};-P;${AVND_SOURCE_DIR}/cmake/avendish.compile_time.cmake;--"
+    )
+
+    # The details of where the time goes, e.g. which instantiations, next to each object
+    if("${CMAKE_CXX_COMPILER_ID}" MATCHES "Clang")
+      target_compile_options(${AVND_FX_TARGET} PRIVATE -ftime-trace)
+    endif()
+  endif()
 endfunction()
 
 function(avnd_common_setup AVND_TARGET AVND_FX_TARGET)
@@ -206,6 +344,12 @@ function(avnd_common_setup AVND_TARGET AVND_FX_TARGET)
         ${AVND_TARGET}
     )
   endif()
+
+  # Only in the bindings: the tests count the allocations with their own operator new
+  if(AVENDISH_RT_SANITIZE AND NOT "${AVND_TARGET}" STREQUAL "")
+    target_sources(${AVND_FX_TARGET} PRIVATE "${AVND_SOURCE_DIR}/src/realtime_sanitizer.cpp")
+    target_link_libraries(${AVND_FX_TARGET} PRIVATE ${CMAKE_DL_LIBS})
+  endif()
 endfunction()
 
 avnd_common_setup("" "Avendish")
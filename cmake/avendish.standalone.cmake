@@ -11,8 +11,17 @@ if(NOT TARGET Qt5::Quick)
   endif()
 endif()
 
+# Live audio, see binding/standalone/audio.hpp
+find_path(PORTAUDIO_INCLUDE_DIR portaudio.h)
+find_library(PORTAUDIO_LIBRARY portaudio)
+
 add_library(Avendish_standalone_pch STATIC "${AVND_SOURCE_DIR}/src/dummy.cpp")
 
+if(PORTAUDIO_INCLUDE_DIR AND PORTAUDIO_LIBRARY)
+  target_include_directories(Avendish_standalone_pch PUBLIC "${PORTAUDIO_INCLUDE_DIR}")
+  target_link_libraries(Avendish_standalone_pch PUBLIC "${PORTAUDIO_LIBRARY}")
+endif()
+
 target_precompile_headers(Avendish_standalone_pch
   PUBLIC
     include/avnd/binding/standalone/all.hpp
@@ -93,11 +102,19 @@ function(avnd_make_standalone)
     )
   endif()
 
+  if(PORTAUDIO_INCLUDE_DIR AND PORTAUDIO_LIBRARY)
+    target_include_directories(${AVND_FX_TARGET} PRIVATE "${PORTAUDIO_INCLUDE_DIR}")
+    target_link_libraries(${AVND_FX_TARGET} PRIVATE "${PORTAUDIO_LIBRARY}")
+  endif()
+
   avnd_common_setup("${AVND_TARGET}" "${AVND_FX_TARGET}")
 
   target_sources(Avendish PRIVATE
     "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/audio.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/benchmark.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/configure.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/multi.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/offline.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/standalone.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/oscquery_mapper.hpp"
   )
@@ -151,11 +168,19 @@ function(avnd_make_standalone)
         OpenGL::GL
     )
 
+  if(PORTAUDIO_INCLUDE_DIR AND PORTAUDIO_LIBRARY)
+    target_include_directories(${AVND_FX_TARGET} PRIVATE "${PORTAUDIO_INCLUDE_DIR}")
+    target_link_libraries(${AVND_FX_TARGET} PRIVATE "${PORTAUDIO_LIBRARY}")
+  endif()
+
   avnd_common_setup("${AVND_TARGET}" "${AVND_FX_TARGET}")
 
   target_sources(Avendish PRIVATE
     "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/audio.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/benchmark.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/configure.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/multi.hpp"
+    "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/offline.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/standalone.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/standalone/oscquery_mapper.hpp"
     "${AVND_SOURCE_DIR}/include/avnd/binding/ui/nuklear_layout_ui.hpp"
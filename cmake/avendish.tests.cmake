@@ -5,9 +5,157 @@ function(avnd_add_static_test theTarget theFile)
   avnd_common_setup("" "${theTarget}")
 endfunction()
 
+function(avnd_add_executable_test theTarget theFile)
+  add_executable("${theTarget}" "${theFile}")
+  avnd_common_setup("" "${theTarget}")
+  add_test(NAME "${theTarget}" COMMAND "${theTarget}")
+endfunction()
+
 if(BUILD_TESTING)
   avnd_add_static_test(test_vintage tests/tests_vintage.cpp)
   avnd_add_static_test(test_channels tests/tests_channels.cpp)
   avnd_add_static_test(test_function_reflection tests/tests_function_reflection.cpp)
   avnd_add_static_test(test_audioprocessor tests/test_audioprocessor.cpp)
+  avnd_add_executable_test(test_allocations tests/test_allocations.cpp)
+  avnd_add_executable_test(test_interleaved tests/test_interleaved.cpp)
+  avnd_add_executable_test(test_bypass tests/test_bypass.cpp)
+  avnd_add_executable_test(test_fastmath tests/test_fastmath.cpp)
+  avnd_add_executable_test(test_meter tests/test_meter.cpp)
+  avnd_add_executable_test(test_deferred_callbacks tests/test_deferred_callbacks.cpp)
+  avnd_add_executable_test(test_worker tests/test_worker.cpp)
+  avnd_add_executable_test(test_block_coroutine tests/test_block_coroutine.cpp)
+  avnd_add_executable_test(test_rt_logger tests/test_rt_logger.cpp)
+  avnd_add_executable_test(test_timed_messages tests/test_timed_messages.cpp)
+  avnd_add_executable_test(test_note_expressions tests/test_note_expressions.cpp)
+  avnd_add_executable_test(test_midi_merge tests/test_midi_merge.cpp)
+  avnd_add_executable_test(test_midi_to_cv tests/test_midi_to_cv.cpp)
+  avnd_add_executable_test(test_tuning tests/test_tuning.cpp)
+  avnd_add_executable_test(test_sysex_stream tests/test_sysex_stream.cpp)
+  avnd_add_executable_test(test_message_bus tests/test_message_bus.cpp)
+  avnd_add_executable_test(test_statistics tests/test_statistics.cpp)
+  avnd_add_executable_test(test_essentia_pipeline tests/test_essentia_pipeline.cpp)
+  avnd_add_executable_test(test_matrix_mixer tests/test_matrix_mixer.cpp)
+  avnd_add_executable_test(test_freestanding tests/test_freestanding.cpp)
+  avnd_add_executable_test(test_fixed_point tests/test_fixed_point.cpp)
+  avnd_add_executable_test(test_remote tests/test_remote.cpp)
+  avnd_add_executable_test(test_shared_audio tests/test_shared_audio.cpp)
+  avnd_add_executable_test(test_vintage_controls tests/test_vintage_controls.cpp)
+  avnd_add_executable_test(test_timed_values tests/test_timed_values.cpp)
+  avnd_add_executable_test(test_random tests/test_random.cpp)
+  avnd_add_executable_test(test_release tests/test_release.cpp)
+  avnd_add_executable_test(test_render_mode tests/test_render_mode.cpp)
+  avnd_add_executable_test(test_quality_governor tests/test_quality_governor.cpp)
+  avnd_add_executable_test(test_soundfile_recorder tests/test_soundfile_recorder.cpp)
+  avnd_add_executable_test(test_texture_passthrough tests/test_texture_passthrough.cpp)
+  avnd_add_executable_test(test_texture_async tests/test_texture_async.cpp)
+  avnd_add_executable_test(test_per_sample_blocks tests/test_per_sample_blocks.cpp)
+  avnd_add_executable_test(test_reconfigure tests/test_reconfigure.cpp)
+  avnd_add_executable_test(test_cache_aligned tests/test_cache_aligned.cpp)
+  avnd_add_executable_test(test_instance_pool tests/test_instance_pool.cpp)
+  avnd_add_executable_test(test_batch_render tests/test_batch_render.cpp)
+  avnd_add_executable_test(test_modulation tests/test_modulation.cpp)
+  avnd_add_executable_test(test_lookahead tests/test_lookahead.cpp)
+  avnd_add_executable_test(test_shared_controls tests/test_shared_controls.cpp)
+  avnd_add_executable_test(test_latency_benchmark tests/test_latency_benchmark.cpp)
+  avnd_add_executable_test(test_thread_pool tests/test_thread_pool.cpp)
+  avnd_add_executable_test(test_state tests/test_state.cpp)
+  avnd_add_executable_test(test_voice_pool tests/test_voice_pool.cpp)
+  avnd_add_executable_test(test_vintage_synth tests/test_vintage_synth.cpp)
+  avnd_add_executable_test(test_fft tests/test_fft.cpp)
+  avnd_add_executable_test(test_smoothing tests/test_smoothing.cpp)
+  avnd_add_executable_test(test_output_parameters tests/test_output_parameters.cpp)
+
+  # The interposition of src/realtime_sanitizer.cpp is only implemented on Linux
+  if(UNIX AND NOT APPLE)
+    avnd_add_executable_test(test_realtime_sanitizer tests/test_realtime_sanitizer.cpp)
+    target_compile_definitions(test_realtime_sanitizer PRIVATE AVND_RT_SANITIZE=1)
+    target_sources(test_realtime_sanitizer PRIVATE "${AVND_SOURCE_DIR}/src/realtime_sanitizer.cpp")
+    target_link_libraries(test_realtime_sanitizer PRIVATE ${CMAKE_DL_LIBS})
+  endif()
+
+  # Not a test: run it manually to measure the process adapters and halp::fastmath
+  find_package(benchmark QUIET)
+  if(TARGET benchmark::benchmark)
+    add_executable(avendish_bench
+      tests/bench_process_adapters.cpp
+      tests/bench_fastmath.cpp
+    )
+    avnd_common_setup("" avendish_bench)
+    target_link_libraries(avendish_bench PRIVATE benchmark::benchmark)
+
+    # Neither: the glue of each binding whose SDK was found, around the same processors
+    add_executable(avendish_bench_bindings tests/bench_binding_vintage.cpp)
+    avnd_common_setup("" avendish_bench_bindings)
+    target_link_libraries(avendish_bench_bindings PRIVATE benchmark::benchmark_main)
+
+    if(CLAP_HEADER)
+      target_sources(avendish_bench_bindings PRIVATE tests/bench_binding_clap.cpp)
+      target_include_directories(avendish_bench_bindings PRIVATE "${CLAP_HEADER}")
+    endif()
+
+    if(VST3_SDK_ROOT)
+      target_sources(avendish_bench_bindings
+        PRIVATE
+          tests/bench_binding_vst3.cpp
+          "${AVND_SOURCE_DIR}/src/vst3_iids.cpp"
+      )
+      target_link_libraries(avendish_bench_bindings PRIVATE sdk_common pluginterfaces)
+    endif()
+
+    # Neither: the message dispatch of each binding which has its own
+    set(AVND_BENCH_MESSAGES_SOURCES)
+    set(AVND_BENCH_MESSAGES_INCLUDES)
+    set(AVND_BENCH_MESSAGES_LIBRARIES)
+    if(PD_HEADER)
+      list(APPEND AVND_BENCH_MESSAGES_SOURCES tests/bench_message_pd.cpp)
+      list(APPEND AVND_BENCH_MESSAGES_INCLUDES "${PD_HEADER}")
+    endif()
+    if(AVND_MAXSDK_PATH)
+      list(APPEND AVND_BENCH_MESSAGES_SOURCES tests/bench_message_max.cpp)
+      list(APPEND AVND_BENCH_MESSAGES_INCLUDES "${MAXSDK_MAX_INCLUDE_DIR}" "${MAXSDK_MSP_INCLUDE_DIR}")
+    endif()
+    if(TARGET ossia::ossia)
+      list(APPEND AVND_BENCH_MESSAGES_SOURCES tests/bench_message_ossia.cpp)
+      list(APPEND AVND_BENCH_MESSAGES_LIBRARIES ossia::ossia)
+    endif()
+    if(pybind11_FOUND)
+      list(APPEND AVND_BENCH_MESSAGES_SOURCES tests/bench_message_python.cpp)
+      list(APPEND AVND_BENCH_MESSAGES_LIBRARIES pybind11::embed)
+    endif()
+
+    if(AVND_BENCH_MESSAGES_SOURCES)
+      add_executable(avendish_bench_messages
+        tests/bench_messages.cpp
+        ${AVND_BENCH_MESSAGES_SOURCES}
+      )
+      avnd_common_setup("" avendish_bench_messages)
+      target_include_directories(avendish_bench_messages PRIVATE ${AVND_BENCH_MESSAGES_INCLUDES})
+      target_link_libraries(avendish_bench_messages
+        PRIVATE
+          benchmark::benchmark_main
+          ${AVND_BENCH_MESSAGES_LIBRARIES}
+      )
+    endif()
+  endif()
 endif()
+
+# Prints the slowest translation units once built with AVENDISH_COMPILE_TIME_REPORT:
+# e.g. delete the report, rebuild the examples, then build this target
+if(AVENDISH_COMPILE_TIME_REPORT)
+  add_custom_target(avendish_compile_time
+    COMMAND "${CMAKE_COMMAND}"
+      -DAVND_SUMMARY=ON
+      "-DAVND_REPORT=${AVENDISH_COMPILE_TIME_FILE}"
+      -P "${AVND_SOURCE_DIR}/cmake/avendish.compile_time.cmake"
+    VERBATIM
+  )
+endif()
+
+# Prints the size of each plug-in module of the build, e.g. to compare the
+# bindings across changes
+add_custom_target(avendish_binary_size
+  COMMAND "${CMAKE_COMMAND}"
+    "-DAVND_BINARY_DIR=${CMAKE_BINARY_DIR}"
+    -P "${AVND_SOURCE_DIR}/cmake/avendish.binary_size.cmake"
+  VERBATIM
+)
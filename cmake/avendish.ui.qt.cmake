@@ -16,4 +16,5 @@ target_sources(Avendish PRIVATE
   "${AVND_SOURCE_DIR}/include/avnd/binding/ui/qml/int_control.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/ui/qml/int_knob.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/ui/qml/int_slider.hpp"
+  "${AVND_SOURCE_DIR}/include/avnd/binding/ui/qml/refresh.hpp"
 )
@@ -18,6 +18,8 @@ if(MSVC)
   set(SMTG_USE_STDATOMIC_H OFF)
 endif()
 
+option(AVENDISH_VST3_MODULEINFO "Generate the moduleinfo.json of the VST3 plug-ins" ON)
+
 set(SMTG_ADD_VST3_HOSTING_SAMPLES 0)
 set(SMTG_ADD_VST3_HOSTING_SAMPLES 0 CACHE INTERNAL "")
 
@@ -47,6 +49,7 @@ function(avnd_make_vst3)
     ${AVND_FX_TARGET}
     PRIVATE
       "${CMAKE_BINARY_DIR}/${AVND_C_NAME}_vst3.cpp"
+      "${AVND_SOURCE_DIR}/src/vst3_iids.cpp"
   )
 
   set_target_properties(
@@ -74,6 +77,37 @@ function(avnd_make_vst3)
   endif()
 
   avnd_common_setup("${AVND_TARGET}" "${AVND_FX_TARGET}")
+
+  # The moduleinfo.json is generated by a small tool built from the same sources
+  # as the plug-in, which hosts can thus scan without loading it.
+  if(AVENDISH_VST3_MODULEINFO AND NOT CMAKE_CROSSCOMPILING)
+    set(AVND_INFO_TARGET "${AVND_TARGET}_vst3_moduleinfo")
+    configure_file(
+      "${AVND_SOURCE_DIR}/include/avnd/binding/vst3/moduleinfo.cpp.in"
+      "${CMAKE_BINARY_DIR}/${AVND_C_NAME}_vst3_moduleinfo.cpp"
+      @ONLY
+      NEWLINE_STYLE LF
+    )
+
+    add_executable(${AVND_INFO_TARGET} "${CMAKE_BINARY_DIR}/${AVND_C_NAME}_vst3_moduleinfo.cpp")
+    target_link_libraries(
+      ${AVND_INFO_TARGET}
+      PRIVATE
+        Avendish::Avendish_vst3
+        DisableExceptions
+    )
+    avnd_common_setup("${AVND_TARGET}" "${AVND_INFO_TARGET}")
+
+    set(AVND_RESOURCES_DIR "${CMAKE_CURRENT_BINARY_DIR}/vst3/${AVND_C_NAME}.vst3/Contents/Resources")
+    add_dependencies(${AVND_FX_TARGET} ${AVND_INFO_TARGET})
+    add_custom_command(
+      TARGET ${AVND_FX_TARGET}
+      POST_BUILD
+      COMMAND "${CMAKE_COMMAND}" -E make_directory "${AVND_RESOURCES_DIR}"
+      COMMAND "$<TARGET_FILE:${AVND_INFO_TARGET}>" "${AVND_RESOURCES_DIR}/moduleinfo.json"
+      VERBATIM
+    )
+  endif()
 endfunction()
 
 add_library(Avendish_vst3 INTERFACE)
@@ -92,6 +126,7 @@ target_sources(Avendish PRIVATE
   "${AVND_SOURCE_DIR}/include/avnd/binding/vst3/factory.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/vst3/helpers.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/vst3/metadata.hpp"
+  "${AVND_SOURCE_DIR}/include/avnd/binding/vst3/moduleinfo.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/vst3/programs.hpp"
   "${AVND_SOURCE_DIR}/include/avnd/binding/vst3/refcount.hpp"
 )
@@ -5,8 +5,8 @@
 #include <halp/audio.hpp>
 #include <halp/controls.hpp>
 #include <halp/meta.hpp>
+#include <halp/soundfile_reader.hpp>
 
-#include <vector>
 #include <cmath>
 
 namespace oscr
@@ -37,27 +37,17 @@ public:
     if(!inputs.sound)
       return;
 
-    // Just take the first channel of the soundfile.
-    // in is a std::span
-    const auto in = inputs.sound.channel(0);
-
     // We'll read at this position
-    const int64_t start = std::floor(inputs.pos * inputs.sound.frames());
+    const double start = inputs.pos * inputs.sound.frames();
 
-    // Copy it at the given position for each output
+    // Copy the first channel of the soundfile at the given position for each output:
+    // past the end of the file the samples are 0
     for (int i = 0; i < outputs.audio.channels; i++)
     {
-      // Output buffer for channel i, also a std::span.
+      // Output buffer for channel i, a std::span.
       auto out = outputs.audio.channel(i, t.frames);
-
-      for (int j = 0; j < t.frames; j++)
-      {
-        // If we're before the end of the file copy the sample
-        if(start + j < inputs.sound.frames())
-          out[j] = in[start + j];
-        else
-          out[j] = 0;
-      }
+      halp::read_soundfile<halp::interpolation::linear>(
+          inputs.sound, 0, start, 1., out.data(), int(t.frames));
     }
   }
 };
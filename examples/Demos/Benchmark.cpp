@@ -0,0 +1,210 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/example/example_processor.hpp>
+#include <avnd/binding/example/profiler.hpp>
+
+#include <examples/Raw/Lowpass.hpp>
+#include <examples/Raw/Callback.hpp>
+#include <examples/Raw/Messages.hpp>
+#include <examples/Raw/Init.hpp>
+#include <examples/Ports/Essentia/stats/Entropy.hpp>
+#include <examples/Ports/VB/vb.fourses_tilde.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Offline throughput of the processors of the Dump demo, through the generic wrappers
+ * of the example host: each one renders a few seconds of noise, block after block.
+ *
+ * ./demo_benchmark --save=baseline.txt
+ * ./demo_benchmark --baseline=baseline.txt --threshold=0.1
+ *
+ * The options, which all have defaults:
+ *  --seconds=10        of audio rendered by each processor
+ *  --block-size=512
+ *  --rate=48000
+ *  --save=file         writes the throughputs, to compare with later
+ *  --baseline=file     fails if a processor got slower than in the file...
+ *  --threshold=0.1     ... by more than this fraction of its throughput
+ */
+namespace
+{
+struct options
+{
+  double seconds{10.};
+  int block_size{512};
+  double rate{48000.};
+  double threshold{0.1};
+  std::string_view save;
+  std::string_view baseline;
+};
+
+struct result
+{
+  std::string name;
+  double frames_per_second{};
+  double realtime_factor{};
+};
+
+template <typename T>
+result benchmark(const options& opts)
+{
+  exhs::example_processor<T> proc{false};
+  proc.set_channels(2, 2);
+  proc.start(opts.block_size, opts.rate);
+
+  const int in_n = proc.input_channels();
+  const int out_n = proc.output_channels();
+  std::vector<float> storage(std::size_t(in_n + out_n) * opts.block_size);
+  std::vector<float*> ins(in_n), outs(out_n);
+  for (int c = 0; c < in_n; c++)
+    ins[c] = storage.data() + std::size_t(c) * opts.block_size;
+  for (int c = 0; c < out_n; c++)
+    outs[c] = storage.data() + std::size_t(in_n + c) * opts.block_size;
+
+  // The input is generated beforehand, so that only the processor is timed
+  const int64_t total = int64_t(opts.seconds * opts.rate);
+  std::vector<float> input(total);
+  exhs::signal_generator{exhs::test_signal::noise, opts.rate}.fill(input.data(), int(total));
+
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int64_t pos = 0; pos < total; pos += opts.block_size)
+  {
+    const int frames = int(std::min<int64_t>(opts.block_size, total - pos));
+    for (int c = 0; c < in_n; c++)
+      std::copy_n(input.data() + pos, frames, ins[c]);
+    proc.process(ins.data(), in_n, outs.data(), out_n, frames);
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  proc.stop();
+
+  const double elapsed = std::max(std::chrono::duration<double>(t1 - t0).count(), 1e-9);
+  return {
+      .name = std::string{avnd::get_c_name<T>()},
+      .frames_per_second = double(total) / elapsed,
+      .realtime_factor = opts.seconds / elapsed};
+}
+
+template <typename... T>
+std::vector<result> benchmark_all(const options& opts)
+{
+  return {benchmark<T>(opts)...};
+}
+
+bool parse(int argc, char** argv, options& opts)
+{
+  auto to_double = [](std::string_view s, double& res) {
+    return std::from_chars(s.data(), s.data() + s.size(), res).ec == std::errc{} && res > 0.;
+  };
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string_view arg = argv[i];
+    const std::size_t eq = arg.find('=');
+    const auto key = arg.substr(0, eq);
+    const auto value = eq == std::string_view::npos ? std::string_view{} : arg.substr(eq + 1);
+
+    double v{};
+    bool ok = true;
+    if (key == "--seconds")
+      ok = to_double(value, opts.seconds);
+    else if (key == "--block-size" && (ok = to_double(value, v)))
+      opts.block_size = int(v);
+    else if (key == "--rate")
+      ok = to_double(value, opts.rate);
+    else if (key == "--threshold")
+      ok = to_double(value, opts.threshold);
+    else if (key == "--save" && !value.empty())
+      opts.save = value;
+    else if (key == "--baseline" && !value.empty())
+      opts.baseline = value;
+    else
+      ok = false;
+
+    if (!ok || opts.block_size < 1)
+    {
+      std::fprintf(stderr, "Unknown or invalid option: %s\n", argv[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// One "c_name frames_per_second" line per processor
+std::map<std::string, double> read_baseline(std::string_view path)
+{
+  std::map<std::string, double> res;
+  if (std::FILE* f = std::fopen(std::string(path).c_str(), "r"))
+  {
+    char name[256];
+    double fps{};
+    while (std::fscanf(f, "%255s %lf", name, &fps) == 2)
+      res[name] = fps;
+    std::fclose(f);
+  }
+  return res;
+}
+}
+
+int main(int argc, char** argv)
+{
+  options opts;
+  if (!parse(argc, argv, opts))
+    return 1;
+
+  const auto results = benchmark_all<
+      examples::Lowpass, examples::Callback, examples::Messages, examples::Init,
+      essentia_ports::Entropy, vb_ports::fourses_tilde<exhs::config>>(opts);
+
+  std::printf("%-32s %16s %12s\n", "processor", "frames/s", "realtime");
+  for (const auto& r : results)
+    std::printf(
+        "%-32s %16.0f %11.1fx\n", r.name.c_str(), r.frames_per_second, r.realtime_factor);
+
+  if (!opts.save.empty())
+  {
+    std::FILE* f = std::fopen(std::string(opts.save).c_str(), "w");
+    if (!f)
+    {
+      std::fprintf(stderr, "Cannot write the baseline to %s\n", opts.save.data());
+      return 1;
+    }
+    for (const auto& r : results)
+      std::fprintf(f, "%s %.0f\n", r.name.c_str(), r.frames_per_second);
+    std::fclose(f);
+  }
+
+  if (!opts.baseline.empty())
+  {
+    const auto baseline = read_baseline(opts.baseline);
+    if (baseline.empty())
+    {
+      std::fprintf(stderr, "Cannot read the baseline from %s\n", opts.baseline.data());
+      return 1;
+    }
+
+    int regressions = 0;
+    for (const auto& r : results)
+    {
+      auto it = baseline.find(r.name);
+      if (it == baseline.end())
+        continue;
+      if (r.frames_per_second < it->second * (1. - opts.threshold))
+      {
+        std::fprintf(
+            stderr, "Regression: %s runs at %.0f frames/s, %.1f%% below the baseline\n",
+            r.name.c_str(), r.frames_per_second,
+            100. * (1. - r.frames_per_second / it->second));
+        regressions++;
+      }
+    }
+    return regressions > 0 ? 1 : 0;
+  }
+}
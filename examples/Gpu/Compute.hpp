@@ -132,6 +132,7 @@ void main()
       if(this->buf) {
         co_yield gpp::buffer_release{.handle = buf};
         buf = nullptr;
+        pending = {};
       }
       last_w = w;
       last_h = h;
@@ -175,18 +176,24 @@ void main()
 
     co_yield gpp::compute_dispatch{.x = 1, .y = 1, .z = 1};
 
-    // Request an asynchronous readback
-    gpp::buffer_awaiter readback = co_yield gpp::readback_buffer{
-        .handle = buf
-      , .offset = 0
-      , .size = bytes
-    };
+    // Request an asynchronous readback, unless the last one is still in flight
+    if(!pending.handle)
+    {
+      pending = co_yield gpp::readback_buffer{
+          .handle = buf
+        , .offset = 0
+        , .size = bytes
+      };
+    }
 
     co_yield gpp::end_compute_pass{};
 
-    // The readback can be fetched once the compute pass is done
-    // (this needs to be improved in terms of asyncness)
-    auto [data, size] = co_yield readback;
+    // Polling does not block the render thread: the result of the dispatch
+    // comes a few frames later. Yielding the awaiter instead would wait for it.
+    auto [data, size] = co_yield gpp::buffer_poll{.awaiter = pending};
+    if(!data || int(size) < bytes)
+      co_return;
+    pending = {};
 
     using color = float[4];
     auto flt = reinterpret_cast<const color*>(data);
@@ -211,6 +218,7 @@ private:
   static constexpr auto lay = layout{};
   int last_w{}, last_h{};
   gpp::buffer_handle buf{};
+  gpp::buffer_awaiter pending{};
   std::vector<float> zeros{};
 };
 
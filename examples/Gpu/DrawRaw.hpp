@@ -156,12 +156,14 @@ void main()
       };
     }
 
-    // Upload some data into it
+    // Upload some data into it. The generation tells the host that it is
+    // still the same data as long as we do not bump it: it is only sent once.
     co_yield gpp::dynamic_ubo_upload{
         .handle = buf_handle,
         .offset = 0,
         .size = ubo_size,
-        .data = buf.data()
+        .data = buf.data(),
+        .generation = buf_generation
     };
 
     // Same for the texture
@@ -184,6 +186,7 @@ void main()
       , .offset = 0
       , .size = sz
       , .data = tex.data()
+      , .generation = ++tex_generation
     };
   }
 private:
@@ -193,6 +196,10 @@ private:
   gpp::buffer_handle buf_handle{};
   gpp::texture_handle tex_handle{};
 
+  // Bumped whenever the CPU-side data changes
+  gpp::upload_generation buf_generation{1};
+  gpp::upload_generation tex_generation{};
+
 };
 
 }
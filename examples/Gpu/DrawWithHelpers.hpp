@@ -102,13 +102,20 @@ void main()
 
     // Upload some data into it, using an input (non-uniform) of our node
     using namespace std;
-    float xy[2] = {cos(inputs.other), sin(inputs.other)};
+    if(inputs.other != last_other)
+    {
+      last_other = inputs.other;
+      xy[0] = cos(last_other);
+      xy[1] = sin(last_other);
+      xy_generation++;
+    }
 
     co_yield gpp::dynamic_ubo_upload{
         .handle = ubo,
         .offset = 0,
         .size = sizeof(xy),
-        .data = &xy
+        .data = &xy,
+        .generation = xy_generation
     };
 
     // The sampler is not used by the inputs block, so we have to allocate it ourselves
@@ -132,6 +139,7 @@ void main()
       , .offset = 0
       , .size = sz
       , .data = tex.data()
+      , .generation = ++tex_generation
     };
   }
 
@@ -146,6 +154,13 @@ void main()
 private:
   std::vector<uint8_t> tex;
   gpp::texture_handle tex_handle{};
+
+  // Bumped whenever the CPU-side data changes, so that the host does not
+  // upload the same data at each frame
+  float last_other{};
+  float xy[2] = {1.f, 0.f};
+  gpp::upload_generation xy_generation{1};
+  gpp::upload_generation tex_generation{};
 };
 
 }
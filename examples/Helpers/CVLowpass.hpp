@@ -0,0 +1,66 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/meta.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace examples::helpers
+{
+/**
+ * A lowpass whose cutoff is a CV input, as in modular environments.
+ * The cutoff is mostly driven by a static control: when the host tells that
+ * it is constant over the buffer, the coefficient is computed once.
+ */
+struct CVLowpass
+{
+  halp_meta(name, "CV lowpass")
+  halp_meta(c_name, "avnd_cv_lowpass")
+  halp_meta(uuid, "b6f2d0a1-7e3c-4c8b-9a15-3d4e8f0c2a67")
+
+  struct
+  {
+    halp::audio_channel<"In", double> audio;
+    halp::constant_flagged<halp::audio_channel<"Cutoff (Hz)", double>> cutoff;
+  } inputs;
+
+  struct
+  {
+    halp::audio_channel<"Out", double> audio;
+  } outputs;
+
+  void prepare(halp::setup info) { rate = info.rate; }
+
+  double coefficient(double cutoff) const noexcept
+  {
+    using namespace std;
+    return 1. - exp(-2. * numbers::pi * clamp(cutoff, 0., rate / 2.) / rate);
+  }
+
+  void operator()(int frames)
+  {
+    auto in = inputs.audio.channel;
+    auto cutoff = inputs.cutoff.channel;
+    auto out = outputs.audio.channel;
+
+    if (inputs.cutoff.is_constant())
+    {
+      const double a = coefficient(cutoff[0]);
+      for (int i = 0; i < frames; i++)
+        out[i] = state += a * (in[i] - state);
+    }
+    else
+    {
+      for (int i = 0; i < frames; i++)
+        out[i] = state += coefficient(cutoff[i]) * (in[i] - state);
+    }
+  }
+
+  double rate{48000.};
+  double state{};
+};
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/wrappers/chain.hpp>
+#include <examples/Helpers/Lowpass.hpp>
+#include <examples/Helpers/SmoothedGain.hpp>
+#include <halp/meta.hpp>
+
+namespace examples::helpers
+{
+/**
+ * Two processors running as a single one, without copies between them
+ */
+struct GainLowpass : avnd::chain<SmoothedGain, Lowpass>
+{
+  halp_meta(name, "Gain & lowpass (helpers)")
+  halp_meta(c_name, "avnd_helpers_gain_lowpass")
+  halp_meta(uuid, "d50b4f7c-86e3-4a0e-9c52-5e1f3b7a2d68")
+};
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/changed_controls.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+namespace examples::helpers
+{
+/**
+ * A lowpass with an output gain, which only recomputes its coefficients
+ * when the controls they depend on change instead of at every buffer:
+ * the cutoff through its update() function, which the bindings call then,
+ * and the gain through its changed flag.
+ */
+struct ChangedControlsLowpass
+{
+  halp_meta(name, "Changed controls lowpass")
+  halp_meta(c_name, "avnd_changed_controls_lowpass")
+  halp_meta(uuid, "b3f1e6a4-27c8-4d95-a0e3-6f8d2c1b9e57")
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Input", double> audio;
+
+    struct : halp::hslider_f32<"Cutoff", halp::range{.min = 20., .max = 20000., .init = 1000.}>
+    {
+      void update(ChangedControlsLowpass& self)
+      {
+        const double cutoff = std::clamp(double(value), 1., self.rate / 2.);
+        self.coefficient = 1. - std::exp(-2. * std::numbers::pi * cutoff / self.rate);
+      }
+    } cutoff;
+
+    halp::change_flagged<
+        halp::hslider_f32<"Gain (dB)", halp::range{.min = -60., .max = 12., .init = 0.}>>
+        gain;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", double> audio;
+  } outputs;
+
+  void prepare(halp::setup info)
+  {
+    rate = info.rate;
+    state.assign(info.input_channels, 0.);
+
+    // The rate may have changed, and not the cutoff
+    inputs.cutoff.update(*this);
+  }
+
+  void operator()(int frames)
+  {
+    if (inputs.gain.changed)
+      gain = std::pow(10., inputs.gain / 20.);
+
+    const int channels = std::min(inputs.audio.channels, int(state.size()));
+    for (int c = 0; c < channels; c++)
+    {
+      auto* in = inputs.audio[c];
+      auto* out = outputs.audio[c];
+      double& s = state[c];
+      for (int i = 0; i < frames; i++)
+      {
+        s += coefficient * (in[i] - s);
+        out[i] = gain * s;
+      }
+    }
+  }
+
+  double rate{48000.};
+  double coefficient{1.};
+  double gain{1.};
+  std::vector<double> state;
+};
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+namespace examples::helpers
+{
+/**
+ * A lowpass whose cutoff is swept by an LFO. The LFO and the coefficient
+ * are computed in control(), which the bindings call every 32 frames
+ * whatever the size of the buffers, instead of at every sample.
+ */
+struct ControlRateSweep
+{
+  halp_meta(name, "Control-rate sweep")
+  halp_meta(c_name, "avnd_control_rate_sweep")
+  halp_meta(uuid, "5d0c7e92-1b4f-4a3e-8f26-9c1a7b3e5d48")
+  halp_meta(control_interval, 32)
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Input", double> audio;
+    halp::hslider_f32<"Cutoff", halp::range{.min = 20., .max = 20000., .init = 1000.}> cutoff;
+    halp::hslider_f32<"Rate", halp::range{.min = 0.01, .max = 20., .init = 0.5}> lfo_rate;
+    halp::hslider_f32<"Depth", halp::range{.min = 0., .max = 4., .init = 1.}> depth;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", double> audio;
+  } outputs;
+
+  void prepare(halp::setup info)
+  {
+    rate = info.rate;
+    phase = 0.;
+    state.assign(info.input_channels, 0.);
+  }
+
+  // Called every control_interval frames
+  void control()
+  {
+    using namespace std;
+    const double octaves = inputs.depth * sin(2. * numbers::pi * phase);
+    const double cutoff = clamp(inputs.cutoff * exp2(octaves), 1., rate / 2.);
+    coefficient = 1. - exp(-2. * numbers::pi * cutoff / rate);
+
+    phase += inputs.lfo_rate * control_interval() / rate;
+    phase -= floor(phase);
+  }
+
+  void operator()(int frames)
+  {
+    const int channels = std::min(inputs.audio.channels, int(state.size()));
+    for (int c = 0; c < channels; c++)
+    {
+      auto* in = inputs.audio[c];
+      auto* out = outputs.audio[c];
+      double& s = state[c];
+      for (int i = 0; i < frames; i++)
+        out[i] = s += coefficient * (in[i] - s);
+    }
+  }
+
+  double rate{48000.};
+  double phase{};
+  double coefficient{1.};
+  std::vector<double> state;
+};
+}
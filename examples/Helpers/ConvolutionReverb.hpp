@@ -0,0 +1,77 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/convolution.hpp>
+#include <halp/meta.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace examples::helpers
+{
+/**
+ * Convolves the input with the impulse response of a soundfile,
+ * without latency whatever its length
+ */
+class ConvolutionReverb
+{
+public:
+  halp_meta(name, "Convolution reverb (helpers)")
+  halp_meta(c_name, "avnd_helpers_convolution_reverb")
+  halp_meta(uuid, "c3e85a27-91d4-4b0f-8e6a-5f27d4b1a936")
+
+  using setup = halp::setup;
+  using tick = halp::tick;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Input", double> audio;
+    halp::soundfile_port<"Impulse response"> ir;
+    halp::knob_f32<"Dry/wet", halp::range{.min = 0., .max = 1., .init = 0.3}> mix;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", double> audio;
+  } outputs;
+
+  void prepare(halp::setup info)
+  {
+    // e.g. a new sample rate: the buffers stay the same
+    if (!info.changed.frames && !info.changed.channels)
+      return;
+
+    m_wet.assign(info.output_channels, std::vector<double>(info.frames));
+    m_wet_ptrs.clear();
+    for (auto& w : m_wet)
+      m_wet_ptrs.push_back(w.data());
+  }
+
+  void operator()(halp::tick t)
+  {
+    const int channels
+        = std::min({inputs.audio.channels, outputs.audio.channels, int(m_wet.size())});
+    const int frames = std::min(t.frames, m_wet.empty() ? 0 : int(m_wet[0].size()));
+
+    m_reverb.update(inputs.ir, channels);
+    m_reverb.process(inputs.audio.samples, m_wet_ptrs.data(), channels, frames);
+
+    const double wet = inputs.mix;
+    for (int c = 0; c < channels; c++)
+    {
+      const double* in = inputs.audio[c];
+      double* out = outputs.audio[c];
+      for (int j = 0; j < frames; j++)
+        out[j] = (1. - wet) * in[j] + wet * m_wet[c][j];
+    }
+  }
+
+private:
+  halp::ir_convolver<double> m_reverb;
+  std::vector<std::vector<double>> m_wet;
+  std::vector<double*> m_wet_ptrs;
+};
+}
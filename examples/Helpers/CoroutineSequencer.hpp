@@ -0,0 +1,73 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/block_coroutine.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace examples::helpers
+{
+/**
+ * A four-step sequencer of control voltages, with a short silence between the steps,
+ * written as a loop in a coroutine: the steps change at the exact sample
+ * where they are due, whatever the size of the buffers.
+ */
+struct CoroutineSequencer
+{
+  halp_meta(name, "Coroutine sequencer")
+  halp_meta(c_name, "avnd_coroutine_sequencer")
+  halp_meta(uuid, "0f6b8e3d-2a47-4c19-b5d2-7e91a4c3f806")
+
+  struct
+  {
+    halp::hslider_f32<"Step 1", halp::range{.min = -1., .max = 1., .init = 0.}> step1;
+    halp::hslider_f32<"Step 2", halp::range{.min = -1., .max = 1., .init = 0.5}> step2;
+    halp::hslider_f32<"Step 3", halp::range{.min = -1., .max = 1., .init = -0.5}> step3;
+    halp::hslider_f32<"Step 4", halp::range{.min = -1., .max = 1., .init = 1.}> step4;
+    halp::hslider_f32<"Length (ms)", halp::range{.min = 10., .max = 2000., .init = 250.}>
+        length;
+    halp::hslider_f32<"Gap (ms)", halp::range{.min = 0., .max = 500., .init = 20.}> gap;
+  } inputs;
+
+  struct
+  {
+    halp::audio_channel<"CV", double> audio;
+  } outputs;
+
+  halp::block_script script;
+  double rate{48000.};
+  double level{};
+
+  int64_t samples_of(double ms) const noexcept { return int64_t(std::round(rate * ms / 1000.)); }
+
+  halp::block_task sequence()
+  {
+    for (int step = 0;; step = (step + 1) % 4)
+    {
+      const float steps[]{inputs.step1, inputs.step2, inputs.step3, inputs.step4};
+      level = steps[step];
+      co_await script.samples(std::max(samples_of(inputs.length - inputs.gap), int64_t(1)));
+
+      level = 0.;
+      co_await script.samples(samples_of(inputs.gap));
+    }
+  }
+
+  void prepare(halp::setup info)
+  {
+    rate = info.rate;
+    script.start([this] { return sequence(); });
+  }
+
+  void operator()(int frames)
+  {
+    auto* out = outputs.audio.channel;
+    script(frames, [&](int first, int n) { std::fill_n(out + first, n, level); });
+  }
+};
+}
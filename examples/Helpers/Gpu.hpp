@@ -456,6 +456,7 @@ void main()
         int offset;
         int size;
         void* data;
+        uint64_t generation{};
     };
     using buffer_upload = buffer_upload_action;
 
@@ -476,6 +477,8 @@ void main()
     std::vector<float> buf;
 
     void* buf_handle{};
+    // Bumped when buf changes: the host only uploads new generations
+    uint64_t buf_generation{1};
 
     gpu::generator<action, void*> update()
     {
@@ -498,6 +501,7 @@ void main()
           , .offset = 0
           , .size = ubo_size
           , .data = buf.data()
+          , .generation = buf_generation
        };
     }
 /*
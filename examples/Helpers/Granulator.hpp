@@ -0,0 +1,80 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/granular.hpp>
+#include <halp/meta.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace examples::helpers
+{
+/**
+ * Granular synthesis on the first channel of a soundfile:
+ * up to a thousand grains at once, started at the frame where they fall
+ */
+class Granulator
+{
+public:
+  halp_meta(name, "Granulator (helpers)")
+  halp_meta(c_name, "avnd_helpers_granulator")
+  halp_meta(uuid, "5e0c7a91-3b2d-4f86-a1e4-9d7b2c6f0a53")
+
+  using setup = halp::setup;
+  using tick = halp::tick;
+
+  struct
+  {
+    halp::soundfile_port<"Sound"> sound;
+    halp::hslider_f32<"Position", halp::range{.min = 0., .max = 1., .init = 0.}> position;
+    halp::knob_f32<"Spread", halp::range{.min = 0., .max = 0.5, .init = 0.02}> spread;
+    halp::knob_f32<"Density", halp::range{.min = 1., .max = 2000., .init = 50.}> density;
+    halp::knob_f32<"Duration (ms)", halp::range{.min = 5., .max = 1000., .init = 100.}>
+        duration;
+    halp::knob_f32<"Pitch", halp::range{.min = -24., .max = 24., .init = 0.}> pitch;
+    halp::knob_f32<"Pitch spread", halp::range{.min = 0., .max = 12., .init = 0.}>
+        pitch_spread;
+    halp::knob_f32<"Jitter", halp::range{.min = 0., .max = 1., .init = 0.3}> jitter;
+    halp::knob_f32<"Volume", halp::range{.min = 0., .max = 1., .init = 0.5}> volume;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", double> audio;
+  } outputs;
+
+  void prepare(halp::setup info) { m_grains.reset(1024, info.rate, info.frames); }
+
+  void operator()(halp::tick t)
+  {
+    if (outputs.audio.channels <= 0)
+      return;
+
+    auto& s = m_grains.settings;
+    s.position = inputs.position;
+    s.position_spread = inputs.spread;
+    s.density = inputs.density;
+    s.duration = inputs.duration / 1000.;
+    s.pitch = std::exp2(inputs.pitch / 12.);
+    s.pitch_spread = inputs.pitch_spread;
+    s.jitter = inputs.jitter;
+
+    // About as loud whatever the number of overlapping grains
+    const double overlap = std::max(1., s.density * s.duration);
+    s.gain = float(inputs.volume / std::sqrt(overlap));
+
+    double* out = outputs.audio[0];
+    std::fill_n(out, t.frames, 0.);
+    m_grains.process(inputs.sound, 0, out, t.frames);
+
+    for (int c = 1; c < outputs.audio.channels; c++)
+      std::copy_n(out, t.frames, outputs.audio[c]);
+  }
+
+private:
+  halp::granulator<double> m_grains;
+};
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/lookahead.hpp>
+#include <halp/meta.hpp>
+
+#include <cmath>
+
+namespace examples::helpers
+{
+/**
+ * Brickwall limiter: the gain goes down before the peaks reach the output,
+ * thanks to a look-ahead of 5 milliseconds whose delay is reported to the host.
+ */
+class Limiter
+{
+public:
+  halp_meta(name, "Limiter (helpers)")
+  halp_meta(c_name, "avnd_helpers_limiter")
+  halp_meta(uuid, "c3e9a0d4-6f15-4b82-9e7a-51d08b2f64c1")
+
+  using setup = halp::setup;
+  using tick = halp::tick;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Input", double> audio;
+    halp::hslider_f32<"Ceiling", halp::range{.min = -24., .max = 0., .init = -1.}> ceiling;
+    halp::hslider_f32<"Release", halp::range{.min = 1., .max = 1000., .init = 100.}>
+        release;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", double> audio;
+  } outputs;
+
+  void prepare(halp::setup info)
+  {
+    m_rate = info.rate;
+    if (info.changed.channels || info.changed.rate)
+      m_lookahead.reset(info.input_channels, int(0.005 * info.rate));
+  }
+
+  int64_t latency_samples() const noexcept { return m_lookahead.latency(); }
+
+  void operator()(halp::tick t)
+  {
+    const double ceiling = std::pow(10., inputs.ceiling / 20.);
+    const double release = 1. - std::exp(-1000. / (inputs.release * m_rate));
+
+    // Instant attack, as the gain of a peak is reached before it gets out
+    m_lookahead.process(inputs.audio, outputs.audio, t.frames, [&](double peak) {
+      const double target = peak > ceiling ? ceiling / peak : 1.;
+      m_gain = target < m_gain ? target : m_gain + (target - m_gain) * release;
+      return m_gain;
+    });
+  }
+
+private:
+  halp::lookahead<double> m_lookahead;
+  double m_rate{48000.};
+  double m_gain{1.};
+};
+}
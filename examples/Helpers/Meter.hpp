@@ -0,0 +1,57 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/meta.hpp>
+#include <halp/meter.hpp>
+
+#include <algorithm>
+
+namespace examples::helpers
+{
+/**
+ * The meter of a channel strip: true peak, RMS and loudness of the input,
+ * which goes through unchanged
+ */
+class Meter
+{
+public:
+  halp_meta(name, "Meter (helpers)")
+  halp_meta(c_name, "avnd_helpers_meter")
+  halp_meta(uuid, "c2b7e4d9-6a15-4f3e-9b08-1d4e7a3c5f62")
+
+  using setup = halp::setup;
+  using tick = halp::tick;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Input", double> audio;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", double> audio;
+    halp::meter_port<"Level"> level;
+  } outputs;
+
+  void prepare(halp::setup info) { m_meter.reset(info.input_channels, info.rate); }
+
+  void operator()(halp::tick t)
+  {
+    m_meter.process(inputs.audio.samples, inputs.audio.channels, t.frames);
+    outputs.level = m_meter.value();
+
+    for (int c = 0; c < outputs.audio.channels; c++)
+    {
+      if (c < inputs.audio.channels)
+        std::copy_n(inputs.audio[c], t.frames, outputs.audio[c]);
+      else
+        std::fill_n(outputs.audio[c], t.frames, 0.);
+    }
+  }
+
+private:
+  halp::level_meter<double> m_meter;
+};
+}
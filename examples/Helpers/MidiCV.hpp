@@ -0,0 +1,48 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+#include <halp/midi.hpp>
+#include <halp/midi_to_cv.hpp>
+
+namespace examples::helpers
+{
+/**
+ * MIDI to CV: the gate, pitch (1 V / octave) and velocity of the last note,
+ * for modular environments. The CV are rendered directly in the outputs.
+ */
+struct MidiCV
+{
+  halp_meta(name, "MIDI to CV")
+  halp_meta(c_name, "avnd_midi_cv")
+  halp_meta(uuid, "7e3a9c51-0b6d-4f28-a1e4-96d52c8b3f07")
+
+  struct
+  {
+    halp::midi_bus<"MIDI"> midi;
+    halp::hslider_f32<"Glide (ms)", halp::range{.min = 0., .max = 1000., .init = 0.}>
+        glide;
+  } inputs;
+
+  struct
+  {
+    halp::audio_channel<"Gate", double> gate;
+    halp::audio_channel<"Pitch", double> pitch;
+    halp::audio_channel<"Velocity", double> velocity;
+  } outputs;
+
+  halp::midi_to_cv<1, double> cv;
+
+  void prepare(halp::setup info) { cv.prepare(info.rate); }
+
+  void operator()(int frames)
+  {
+    cv.glide_ms = inputs.glide;
+    cv.bind(0, outputs.gate.channel, outputs.pitch.channel, outputs.velocity.channel);
+    cv(inputs.midi, frames);
+  }
+};
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+#include <halp/modulated_controls.hpp>
+
+#include <algorithm>
+
+namespace examples::helpers
+{
+/**
+ * Tremolo and amplitude modulation: the host can modulate the gain at audio rate,
+ * e.g. from an LFO, and gives the modulated gain of each frame.
+ * The pan is modulatable too, but only needs its average over the buffer.
+ */
+class ModulatedGain
+{
+public:
+  halp_meta(name, "Modulated gain (helpers)")
+  halp_meta(c_name, "avnd_helpers_modulated_gain")
+  halp_meta(uuid, "5f0c8a3e-2b71-4c9d-a6e4-93d1b27f0c58")
+
+  using tick = halp::tick;
+
+  struct
+  {
+    halp::fixed_audio_bus<"Input", double, 2> audio;
+    halp::audio_rate_modulated<
+        halp::hslider_f32<"Gain", halp::range{.min = 0., .max = 2., .init = 1.}>>
+        gain;
+    halp::modulatable<
+        halp::hslider_f32<"Pan", halp::range{.min = -1., .max = 1., .init = 0.}>>
+        pan;
+  } inputs;
+
+  struct
+  {
+    halp::fixed_audio_bus<"Output", double, 2> audio;
+  } outputs;
+
+  void operator()(halp::tick t)
+  {
+    const float p = inputs.pan.value;
+    const float pan[2]{1.f - std::max(0.f, p), 1.f + std::min(0.f, p)};
+    for (int i = 0; i < 2; i++)
+    {
+      auto* in = inputs.audio[i];
+      auto* out = outputs.audio[i];
+      for (int j = 0; j < t.frames; j++)
+        out[j] = inputs.gain[j] * pan[i] * in[j];
+    }
+  }
+};
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+#include <halp/morph.hpp>
+
+#include <cmath>
+#include <string_view>
+
+namespace examples::helpers
+{
+/**
+ * A distortion whose controls all follow an XY pad, between the four programs
+ * in its corners: the bindings interpolate the sliders and switch the toggle.
+ */
+struct MorphDistortion
+{
+  halp_meta(name, "Morph distortion")
+  halp_meta(c_name, "avnd_morph_distortion")
+  halp_meta(uuid, "e4a7c2d9-5b1f-4c83-9e6a-3d8f0b2c7a15")
+
+  struct ins
+  {
+    halp::dynamic_audio_bus<"Input", double> audio;
+    halp::hslider_f32<"Drive", halp::range{.min = 0., .max = 50., .init = 1.}> drive;
+    halp::hslider_f32<"Bias", halp::range{.min = -1., .max = 1., .init = 0.}> bias;
+    halp::hslider_f32<"Volume", halp::range{.min = 0., .max = 1., .init = 0.5}> volume;
+    halp::toggle<"Fold", halp::toggle_setup{.init = false}> fold;
+    halp::morph<halp::xy_pad_f32<"Morph", halp::range{.min = 0., .max = 1., .init = 0.}>>
+        morph;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", double> audio;
+  } outputs;
+
+  struct program
+  {
+    std::string_view name;
+    ins parameters;
+  };
+
+  static inline const program programs[]{
+      {.name{"Clean"},
+       .parameters{.drive = {1.}, .bias = {0.}, .volume = {0.8}, .fold = {false}}},
+      {.name{"Crunch"},
+       .parameters{.drive = {8.}, .bias = {0.1}, .volume = {0.5}, .fold = {false}}},
+      {.name{"Fuzz"},
+       .parameters{.drive = {40.}, .bias = {0.4}, .volume = {0.3}, .fold = {false}}},
+      {.name{"Folded"},
+       .parameters{.drive = {20.}, .bias = {-0.2}, .volume = {0.4}, .fold = {true}}},
+  };
+
+  void operator()(int frames)
+  {
+    const double drive = inputs.drive;
+    const double bias = inputs.bias;
+    const double volume = inputs.volume;
+    const bool fold = inputs.fold;
+    for (int c = 0; c < inputs.audio.channels; c++)
+    {
+      auto* in = inputs.audio[c];
+      auto* out = outputs.audio[c];
+      for (int i = 0; i < frames; i++)
+      {
+        const double x = drive * in[i] + bias;
+        out[i] = volume * (fold ? std::sin(x) : std::tanh(x));
+      }
+    }
+  }
+};
+}
@@ -4,7 +4,7 @@
 
 #include <halp/audio.hpp>
 #include <halp/meta.hpp>
-#include <cmath>
+#include <halp/random.hpp>
 
 namespace examples::helpers
 {
@@ -25,7 +25,9 @@ struct WhiteNoise
 
   void operator()(const inputs& ins, outputs& outs)
   {
-    outs.audio.sample = 0.15 * (double(rand()) / RAND_MAX - 0.5);
+    outs.audio.sample = 0.075 * rng.bipolar<double>();
   }
+
+  halp::xoshiro128 rng{halp::random_seed()};
 };
 }
@@ -0,0 +1,21 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/wrappers/oversampling.hpp>
+#include <examples/Tutorial/Distortion.hpp>
+#include <halp/meta.hpp>
+
+namespace examples
+{
+/**
+ * The distortion of the tutorial, run at four times the sample rate so that
+ * the harmonics of the tanh do not alias
+ */
+struct OversampledDistortion : avnd::oversampled<Distortion, 4>
+{
+  halp_meta(name, "Distortion (4x)")
+  halp_meta(c_name, "avnd_oversampled_distortion")
+  halp_meta(uuid, "7f0c2e61-3b9a-4d85-a2f4-6c1e8d93b5a0")
+};
+}
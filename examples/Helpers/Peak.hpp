@@ -2,7 +2,7 @@
 #include <halp/audio.hpp>
 #include <halp/controls.hpp>
 #include <halp/meta.hpp>
-#include <cmath>
+#include <halp/meter.hpp>
 
 namespace examples::helpers
 {
@@ -26,16 +26,7 @@ struct Peak
     halp::val_port<"Peak", double> peak;
   } outputs;
 
-  void operator()(int frames)
-  {
-    outputs.peak = 0.;
-    for (int k = 0; k < frames; k++)
-    {
-      double sample = std::abs(inputs.audio[k]);
-      if (sample > outputs.peak)
-        outputs.peak = sample;
-    }
-  }
+  void operator()(int frames) { outputs.peak = halp::peak(inputs.audio.channel, frames); }
 };
 
 }
@@ -26,6 +26,10 @@ struct PeakBand
   halp_meta(c_name, "avnd_peak_band")
   halp_meta(uuid, "5610b62e-ef1f-4a34-abe0-e57816bc44c2")
 
+  // The FFT runs on whole buffers: the bindings queue the audio so that
+  // we always get 1024 frames, whatever the host sends.
+  halp_meta(block_size, 1024)
+
   struct
   {
     halp::audio_channel<"In", double> audio;
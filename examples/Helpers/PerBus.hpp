@@ -5,6 +5,7 @@
 #include <halp/audio.hpp>
 #include <halp/controls.hpp>
 #include <halp/meta.hpp>
+#include <halp/tasks.hpp>
 #include <cmath>
 
 namespace examples::helpers
@@ -96,4 +97,62 @@ struct PerBusAsPortsDynamic
     }
   }
 };
+
+// Each output bus is rendered on its own: the bindings which have worker threads
+// may render them in parallel when the buffers are large enough.
+struct PerBusAsOutputs
+{
+  halp_meta(name, "Per-bus processing (output busses, helpers)")
+  halp_meta(c_name, "avnd_helpers_per_bus_as_outputs")
+  halp_meta(uuid, "5d0f7e4a-2b8e-4a51-9d0e-6c3f1b7a9e24")
+
+  struct
+  {
+    halp::fixed_audio_bus<"In", double, 2> audio;
+  } inputs;
+
+  struct
+  {
+    halp::fixed_audio_bus<"Low", double, 2> low;
+    halp::fixed_audio_bus<"High", double, 2> high;
+    halp::fixed_audio_bus<"Drive", double, 2> drive;
+  } outputs;
+
+  // Connected by the bindings to their worker threads, if any
+  halp::task_runner tasks;
+
+  // Each bus only touches its own state
+  double low_state[2]{};
+  double high_state[2]{};
+
+  static void lowpass(const double* in, double* out, double& state, int frames)
+  {
+    for (int k = 0; k < frames; k++)
+      out[k] = state = state + 0.05 * (in[k] - state);
+  }
+
+  void process_bus(int bus, int frames)
+  {
+    using namespace std;
+    for (int c = 0; c < 2; ++c)
+    {
+      const double* in = inputs.audio[c];
+      switch (bus)
+      {
+        case 0:
+          lowpass(in, outputs.low[c], low_state[c], frames);
+          break;
+        case 1:
+          lowpass(in, outputs.high[c], high_state[c], frames);
+          for (int k = 0; k < frames; k++)
+            outputs.high[c][k] = in[k] - outputs.high[c][k];
+          break;
+        case 2:
+          for (int k = 0; k < frames; k++)
+            outputs.drive[c][k] = tanh(10. * in[k]);
+          break;
+      }
+    }
+  }
+};
 }
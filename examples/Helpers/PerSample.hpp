@@ -7,6 +7,7 @@
 #include <halp/controls.hpp>
 #include <halp/meta.hpp>
 #include <cmath>
+#include <span>
 
 namespace examples::helpers
 {
@@ -60,11 +61,85 @@ struct PerSampleAsPorts
   {
     outs.audio = std::tanh(ins.gain * ins.audio);
   }
+
+  // Optionally, a batch of samples can be processed at once:
+  // the host will call this as much as possible, and the per-sample
+  // version for the remaining samples.
+  void operator()(const inputs& ins, std::span<const double, 4> in, std::span<double, 4> out)
+  {
+    for (int i = 0; i < 4; i++)
+      out[i] = std::tanh(ins.gain * in[i]);
+  }
+
+  // Each out[i] is written after in[i] has been read:
+  // the host can pass the same buffers as input and output without copying them.
+  static constexpr bool in_place_safe = true;
+
+  // Each channel gets its own cache lines, apart from the shared controls
+  static constexpr bool cache_aligned = true;
 };
 
 static_assert(avnd::monophonic_processor<double, PerSampleAsPorts>);
 static_assert(avnd::mono_per_sample_port_processor<double, PerSampleAsPorts>);
 static_assert(avnd::sample_port_processor<PerSampleAsPorts>);
+static_assert(avnd::mono_per_sample_port_batch_invocations<double, PerSampleAsPorts, 4>);
+static_assert(avnd::in_place_safe_processor<PerSampleAsPorts>);
+static_assert(avnd::cache_aligned_processor<PerSampleAsPorts>);
 static_assert(avnd::inputs_is_type<PerSampleAsPorts>);
 static_assert(avnd::outputs_is_type<PerSampleAsPorts>);
+
+struct PerSampleLowpass
+{
+  halp_meta(name, "Per-sample lowpass (helpers)")
+  halp_meta(c_name, "avnd_helpers_per_sample_lowpass")
+  halp_meta(uuid, "6207fd02-577b-451b-80ef-b5f6078f9c0e")
+
+  struct inputs
+  {
+    halp::audio_sample<"In", float> audio;
+    halp::hslider_f32<"Weight", halp::range{.min = 0., .max = 1., .init = 0.5}> weight;
+  };
+
+  struct outputs
+  {
+    halp::audio_sample<"Out", float> audio;
+  };
+
+  // The state of a channel: when a processor declares it as simd_state,
+  // the host stores the state of all the channels field by field and passes it
+  // to the operator below. It is only loaded and stored once per buffer and channel.
+  struct state
+  {
+    float previous{};
+  };
+  using simd_state = state;
+
+  void operator()(const inputs& ins, outputs& outs, state& s)
+  {
+    s.previous = ins.weight * ins.audio + (1.f - ins.weight) * s.previous;
+    outs.audio = s.previous;
+  }
+
+  // Optionally, one sample of 4 channels at a time, with their states:
+  // the host groups the channels by 4, and this loop is what gets vectorized,
+  // on 4 lanes at once. The remaining channels go through the operator above.
+  void operator()(
+      const inputs& ins, std::span<const float, 4> in, std::span<float, 4> out,
+      std::span<state, 4> s)
+  {
+    for (int k = 0; k < 4; k++)
+    {
+      s[k].previous = ins.weight * in[k] + (1.f - ins.weight) * s[k].previous;
+      out[k] = s[k].previous;
+    }
+  }
+
+  // Used by hosts which process the instances one by one
+  state self;
+  void operator()(const inputs& ins, outputs& outs) { (*this)(ins, outs, self); }
+};
+
+static_assert(avnd::mono_per_sample_port_processor<float, PerSampleLowpass>);
+static_assert(avnd::mono_per_sample_port_simd_state<PerSampleLowpass>);
+static_assert(avnd::mono_per_sample_port_lane_invocations<float, PerSampleLowpass, 4>);
 }
@@ -0,0 +1,68 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace examples::helpers
+{
+/**
+ * A sawtooth summed from its harmonics, which plays fewer of them when the
+ * host runs out of CPU time: the bindings lower the quality, then raise it
+ * again once there is some headroom.
+ */
+struct AdditiveSaw
+{
+  halp_meta(name, "Additive saw")
+  halp_meta(c_name, "avnd_additive_saw")
+  halp_meta(uuid, "0b7e3c52-6f1d-4a8e-b94c-27d5e8a1f306")
+
+  // 0: 8 harmonics, 1: 32, 2: 128
+  halp_meta(quality_levels, 3)
+
+  struct
+  {
+    halp::hslider_f32<"Frequency", halp::range{.min = 20., .max = 2000., .init = 110.}>
+        frequency;
+  } inputs;
+
+  struct
+  {
+    halp::audio_channel<"Out", double> audio;
+  } outputs;
+
+  // Set by the bindings at the beginning of the buffers
+  int quality{};
+
+  void operator()(int frames)
+  {
+    const double increment = inputs.frequency / rate;
+    const int harmonics
+        = std::clamp(int(0.5 / increment), 1, 8 << (2 * std::clamp(quality, 0, 2)));
+
+    auto* out = outputs.audio.channel;
+    for (int i = 0; i < frames; i++)
+    {
+      const double x = 2. * std::numbers::pi * phase;
+      double v = 0.;
+      for (int h = 1; h <= harmonics; h++)
+        v += std::sin(h * x) / h;
+      out[i] = 0.25 * 2. / std::numbers::pi * v;
+
+      phase += increment;
+      phase -= std::floor(phase);
+    }
+  }
+
+  void prepare(halp::setup info) { rate = info.rate; }
+
+  double rate{48000.};
+  double phase{};
+};
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+namespace examples::helpers
+{
+/**
+ * Records its input to a file while "Record" is on: the host writes the
+ * frames to the disk from another thread, each take in a new file.
+ */
+struct MultitrackRecorder
+{
+  halp_meta(name, "Multitrack recorder")
+  halp_meta(c_name, "avnd_multitrack_recorder")
+  halp_meta(uuid, "3f9c2a71-84d6-4e0b-a5c3-6b1e7d20f948")
+
+  static constexpr int tracks = 16;
+
+  struct
+  {
+    halp::fixed_audio_bus<"In", float, tracks> audio;
+    halp::lineedit<"File", "take.wav"> file;
+    halp::toggle<"Record", halp::toggle_setup{.init = false}> record;
+  } inputs;
+
+  struct
+  {
+    halp::fixed_audio_bus<"Out", float, tracks> audio;
+    halp::soundfile_recorder_port<"Take", tracks> take;
+  } outputs;
+
+  void operator()(int frames)
+  {
+    if (inputs.record != recording)
+    {
+      recording = inputs.record;
+      if (recording)
+        outputs.take.open(inputs.file.value);
+      else
+        outputs.take.close();
+    }
+
+    outputs.take.write(inputs.audio.samples, frames);
+
+    for (int c = 0; c < tracks; c++)
+      for (int i = 0; i < frames; i++)
+        outputs.audio[c][i] = inputs.audio[c][i];
+  }
+
+  bool recording{};
+};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/fastmath.hpp>
+#include <halp/meta.hpp>
+
+#include <cmath>
+
+namespace examples::helpers
+{
+/**
+ * A saturation which uses a cheap approximation of tanh while playing live,
+ * and the exact one when the host bounces or exports
+ */
+struct RenderQualitySaturation
+{
+  halp_meta(name, "Saturation (render quality)")
+  halp_meta(c_name, "avnd_render_quality_saturation")
+  halp_meta(uuid, "d6a4f1c8-2b7e-4c93-8e05-91f3a7b2c64d")
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Input", float> audio;
+    halp::hslider_f32<"Drive", halp::range{.min = 1., .max = 20., .init = 4.}> drive;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", float> audio;
+  } outputs;
+
+  // Kept up to date by the bindings
+  halp::render_mode render_mode{};
+
+  void operator()(int frames)
+  {
+    const float drive = inputs.drive;
+    for (int c = 0; c < inputs.audio.channels; c++)
+    {
+      const float* in = inputs.audio[c];
+      float* out = outputs.audio[c];
+      if (render_mode == halp::render_mode::offline)
+        for (int i = 0; i < frames; i++)
+          out[i] = std::tanh(drive * in[i]);
+      else
+        for (int i = 0; i < frames; i++)
+          out[i] = halp::fastmath::tanh<halp::fastmath::accuracy::low>(drive * in[i]);
+    }
+  }
+};
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/matrix_mixer.hpp>
+#include <halp/meta.hpp>
+
+#include <cmath>
+
+namespace examples::helpers
+{
+/**
+ * Spreads the input channels evenly on a ring of speakers, one per output channel,
+ * and rotates them: each source is panned between the two speakers around it
+ * with a constant power. The gains go through a matrix mixer, which smooths them
+ * as the sources move and only computes the two speakers of each source.
+ */
+struct RingPanner
+{
+  halp_meta(name, "Ring panner")
+  halp_meta(c_name, "avnd_ring_panner")
+  halp_meta(uuid, "94ee30da-f34b-4575-8c3e-0b682045a3d4")
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Input", double> audio;
+    halp::hslider_f32<"Rotation", halp::range{.min = 0., .max = 1., .init = 0.}> rotation;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", double> audio;
+  } outputs;
+
+  void prepare(halp::setup info)
+  {
+    mixer.prepare(info.input_channels, info.output_channels, info.frames, info.rate);
+    pan(true);
+  }
+
+  void operator()(int frames)
+  {
+    pan(false);
+    mixer(inputs.audio.samples, outputs.audio.samples, frames);
+  }
+
+  void pan(bool jump)
+  {
+    static constexpr double half_pi = 1.5707963267948966;
+    const int n = mixer.inputs();
+    const int m = mixer.outputs();
+    for (int i = 0; i < n; i++)
+    {
+      // Position on the ring, in speakers
+      const double turns = double(i) / n + inputs.rotation;
+      const double pos = (turns - std::floor(turns)) * m;
+      const int left = int(pos) % m;
+      const int right = (left + 1) % m;
+      const double frac = pos - std::floor(pos);
+
+      for (int o = 0; o < m; o++)
+      {
+        double g = 0.;
+        if (o == left)
+          g += std::cos(frac * half_pi);
+        if (o == right)
+          g += std::sin(frac * half_pi);
+        if (jump)
+          mixer.jump_gain(o, i, g);
+        else
+          mixer.set_gain(o, i, g);
+      }
+    }
+  }
+
+  halp::matrix_mixer<double> mixer;
+};
+}
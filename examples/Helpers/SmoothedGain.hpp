@@ -0,0 +1,58 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+#include <halp/smoothed_controls.hpp>
+
+namespace examples::helpers
+{
+/**
+ * Gain without zipper noise: the host smoothes the changes of the control
+ */
+class SmoothedGain
+{
+public:
+  halp_meta(name, "Smoothed gain (helpers)")
+  halp_meta(c_name, "avnd_helpers_smoothed_gain")
+  halp_meta(uuid, "b00e1179-f8b9-4dea-84c0-0c63038bfaa1")
+
+  using tick = halp::tick;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Input", double> audio;
+    halp::exp_smoothed<
+        halp::hslider_f32<"Gain", halp::range{.min = 0., .max = 2., .init = 1.}>, 20.>
+        gain;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", double> audio;
+  } outputs;
+
+  void operator()(halp::tick t)
+  {
+    for (int i = 0; i < inputs.audio.channels; i++)
+    {
+      auto* in = inputs.audio[i];
+      auto* out = outputs.audio[i];
+
+      if (inputs.gain.stable())
+      {
+        const float g = inputs.gain;
+        for (int j = 0; j < t.frames; j++)
+          out[j] = g * in[j];
+      }
+      else
+      {
+        for (int j = 0; j < t.frames; j++)
+          out[j] = inputs.gain[j] * in[j];
+      }
+    }
+  }
+};
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+#include <halp/stft.hpp>
+
+#include <cmath>
+
+namespace examples::helpers
+{
+/**
+ * Removes the frequencies quieter than a threshold, e.g. to reduce a noise floor.
+ * The delay of the STFT is reported to the host.
+ */
+class SpectralGate
+{
+public:
+  halp_meta(name, "Spectral gate (helpers)")
+  halp_meta(c_name, "avnd_helpers_spectral_gate")
+  halp_meta(uuid, "0e6b42d9-7a3c-4f18-b5e1-9d24c8a06f73")
+
+  using setup = halp::setup;
+  using tick = halp::tick;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Input", double> audio;
+    halp::hslider_f32<"Threshold", halp::range{.min = -100., .max = 0., .init = -60.}>
+        threshold;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Output", double> audio;
+  } outputs;
+
+  // The frames which are being analyzed are kept as long as the channels are the same,
+  // e.g. when the host toggles its DSP off and on
+  void prepare(halp::setup info)
+  {
+    if (info.changed.channels)
+      m_stft.reset(info.input_channels, 2048, 512);
+  }
+
+  int64_t latency_samples() const noexcept { return m_stft.latency(); }
+
+  void operator()(halp::tick t)
+  {
+    // The magnitude of a full-scale sine in a bin, with the hann window
+    const double full_scale = m_stft.size() / 4.;
+    const double threshold = full_scale * std::pow(10., inputs.threshold / 20.);
+
+    m_stft.process(
+        inputs.audio, outputs.audio, t.frames,
+        [threshold](int, avnd::span<std::complex<double>> bins) {
+      for (auto& bin : bins)
+        if (std::abs(bin) < threshold)
+          bin = {};
+    });
+  }
+
+private:
+  halp::stft<double> m_stft;
+};
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <algorithm>
+
+namespace examples::helpers
+{
+/**
+ * Plays a soundfile which is read from the disk while playing,
+ * for files too large to be loaded in memory.
+ */
+class StreamedPlayer
+{
+public:
+  halp_meta(name, "Streamed player (helpers)")
+  halp_meta(c_name, "avnd_helpers_streamed_player")
+  halp_meta(uuid, "6a0f3b8e-2c41-4f7d-9b55-31d8e2a7c904")
+
+  using tick = halp::tick;
+
+  struct
+  {
+    halp::streamed_soundfile_port<"Sound"> sound;
+    halp::toggle<"Loop", halp::toggle_setup{.init = true}> loop;
+  } inputs;
+
+  struct
+  {
+    halp::fixed_audio_bus<"Output", float, 2> audio;
+  } outputs;
+
+  void operator()(halp::tick t)
+  {
+    auto& snd = inputs.sound;
+    if (!snd)
+    {
+      for (int c = 0; c < 2; c++)
+        std::fill_n(outputs.audio[c], t.frames, 0.f);
+      return;
+    }
+
+    // Another file was opened
+    if (snd.soundfile.stream != m_stream)
+    {
+      m_stream = snd.soundfile.stream;
+      m_position = 0;
+    }
+
+    if (m_position >= snd.frames() && inputs.loop)
+      m_position = 0;
+
+    for (int c = 0; c < 2; c++)
+      snd.read(
+          std::min(c, snd.channels() - 1), m_position,
+          {outputs.audio[c], std::size_t(t.frames)});
+
+    m_position += t.frames;
+    snd.play_from(m_position);
+  }
+
+private:
+  const void* m_stream{};
+  int64_t m_position{};
+};
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/messages.hpp>
+#include <halp/meta.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace examples::helpers
+{
+/**
+ * Percussive clicks, started by the "hit" message: as it is a timed message,
+ * the binding tells at which sample of the buffer each hit is due,
+ * so that the clicks keep their exact rhythm whatever the size of the buffers.
+ */
+struct TimedTrigger
+{
+  halp_meta(name, "Timed trigger")
+  halp_meta(c_name, "avnd_timed_trigger")
+  halp_meta(uuid, "b1e0c4a7-6d28-4f53-9a3e-58c7d2f0e914")
+
+  struct
+  {
+    halp::hslider_f32<"Decay (ms)", halp::range{.min = 1., .max = 1000., .init = 50.}>
+        decay;
+  } inputs;
+
+  struct
+  {
+    halp::audio_channel<"Out", double> audio;
+  } outputs;
+
+  // Hits received since the last buffer, in the order they are due
+  struct hit_event
+  {
+    int frame{};
+    float velocity{};
+  };
+  std::array<hit_event, 64> hits{};
+  int hit_count{};
+
+  void hit(float velocity, int frame)
+  {
+    if (hit_count == int(hits.size()))
+      return;
+    auto it = std::upper_bound(
+        hits.begin(), hits.begin() + hit_count, frame,
+        [](int f, const hit_event& h) { return f < h.frame; });
+    std::move_backward(it, hits.begin() + hit_count, hits.begin() + hit_count + 1);
+    *it = {frame, velocity};
+    hit_count++;
+  }
+
+  halp_start_messages(TimedTrigger)
+    halp_mem_fun_timed(hit)
+  halp_end_messages
+
+  void prepare(halp::setup info) { rate = info.rate; }
+
+  void operator()(int frames)
+  {
+    auto* out = outputs.audio.channel;
+    const double decay = std::exp(-1000. / (inputs.decay * rate));
+
+    int k = 0;
+    for (int i = 0; i < frames; i++)
+    {
+      for (; k < hit_count && hits[k].frame <= i; k++)
+        level = hits[k].velocity;
+      out[i] = level;
+      level *= decay;
+    }
+    hit_count = 0;
+  }
+
+  double rate{48000.};
+  double level{};
+};
+}
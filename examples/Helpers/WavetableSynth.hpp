@@ -0,0 +1,136 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+#include <halp/note_expressions.hpp>
+#include <halp/shared_resource.hpp>
+#include <halp/tuning.hpp>
+#include <halp/wavetable.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+namespace examples::helpers
+{
+/**
+ * A polyphonic synthesizer reading band-limited wavetables:
+ * all the voices of all the instances share the same tables,
+ * and high notes do not alias.
+ * Each voice follows the tuning and volume of its note, sent by MPE controllers
+ * or as note expressions by the host, and reads its frequency from
+ * a shared tuning table.
+ */
+class WavetableSynth
+{
+public:
+  halp_meta(name, "Wavetable synth (helpers)")
+  halp_meta(c_name, "avnd_helpers_wavetable_synth")
+  halp_meta(uuid, "b8d1e3a4-5f62-4c97-8e0b-2a7f94c1d356")
+
+  using setup = halp::setup;
+  using tick = halp::tick;
+
+  static constexpr int voices = 16;
+
+  struct
+  {
+    // Only the channel messages matter here: they are read from a dense array
+    halp::mpe_bus<"MIDI"> midi;
+    halp__enum("Waveform", Saw, Sine, Triangle, Saw, Square) waveform;
+    halp::knob_f32<"Volume", halp::range{.min = 0., .max = 1., .init = 0.5}> volume;
+    halp::hslider_i32<"Bend range", halp::range{1, 96, 48}> bend_range;
+  } inputs;
+
+  struct
+  {
+    halp::fixed_audio_bus<"Output", double, 2> audio;
+  } outputs;
+
+  void prepare(halp::setup info)
+  {
+    m_rate = info.rate;
+    m_oscillators.resize(voices);
+    m_notes.fill(-1);
+    m_tuning = halp::shared_resource<halp::tuning_table>(440.);
+  }
+
+  void operator()(halp::tick t)
+  {
+    using wf = halp::waveform;
+    static constexpr wf waveforms[]{wf::sine, wf::triangle, wf::saw, wf::square};
+    m_oscillators.set_table(
+        halp::wavetable<double>::shared(waveforms[int(inputs.waveform.value)]));
+
+    for (const halp::midi_event& m : inputs.midi)
+    {
+      const int type = m.bytes[0] & 0xF0;
+      const int channel = m.bytes[0] & 0x0F;
+      const int note = m.bytes[1];
+      const int velocity = m.bytes[2];
+      if (type == 0x90 && velocity > 0)
+        note_on(channel, note, velocity);
+      else if (type == 0x80 || type == 0x90)
+        note_off(channel, note);
+    }
+
+    // The expressions of the notes, once per buffer
+    inputs.midi.expressions.bend_range = inputs.bend_range;
+    for (int v = 0; v < voices; v++)
+    {
+      if (m_notes[v] < 0)
+        continue;
+      const auto e = inputs.midi.expressions(m_channels[v], m_notes[v]);
+      m_oscillators.set_frequency(v, m_tuning->frequency(m_notes[v] + e.tuning), m_rate);
+      m_oscillators.set_amplitude(v, e.volume * inputs.volume * m_velocities[v] / (127. * 4.));
+    }
+
+    double* left = outputs.audio[0];
+    double* right = outputs.audio[1];
+    std::fill_n(left, t.frames, 0.);
+    m_oscillators.render(left, t.frames);
+    std::copy_n(left, t.frames, right);
+  }
+
+private:
+  void note_on(int channel, int note, int velocity)
+  {
+    // A free voice, else the oldest one
+    int v = int(std::find(m_notes.begin(), m_notes.end(), -1) - m_notes.begin());
+    if (v == voices)
+      v = int(std::min_element(m_started.begin(), m_started.end()) - m_started.begin());
+
+    m_notes[v] = note;
+    m_channels[v] = channel;
+    m_velocities[v] = velocity;
+    m_started[v] = m_count++;
+    m_oscillators.set_phase(v, 0.);
+  }
+
+  void note_off(int channel, int note)
+  {
+    for (int v = 0; v < voices; v++)
+    {
+      if (m_notes[v] == note && m_channels[v] == channel)
+      {
+        m_notes[v] = -1;
+        m_oscillators.set_amplitude(v, 0.);
+      }
+    }
+  }
+
+  halp::oscillator_bank<double> m_oscillators;
+  std::shared_ptr<const halp::tuning_table> m_tuning;
+  std::array<int, voices> m_notes{};
+  std::array<int, voices> m_channels{};
+  std::array<int, voices> m_velocities{};
+  std::array<int64_t, voices> m_started{};
+  int64_t m_count{};
+  double m_rate{48000.};
+};
+}
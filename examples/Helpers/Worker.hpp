@@ -0,0 +1,98 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/audio.hpp>
+#include <halp/changed_controls.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <cmath>
+#include <functional>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+namespace examples::helpers
+{
+/**
+ * A band-limited sawtooth read from a wavetable, which is computed again
+ * when the number of harmonics changes: summing thousands of sines is
+ * too slow for the audio thread, so it is done by the worker of the binding,
+ * and the new table swapped in between two buffers.
+ */
+struct WorkerWavetable
+{
+  halp_meta(name, "Worker wavetable")
+  halp_meta(c_name, "avnd_worker_wavetable")
+  halp_meta(uuid, "5d0c7e2a-91f4-4b38-8a6e-c3b27f14d9a0")
+
+  static constexpr int table_size = 4096;
+
+  struct
+  {
+    halp::hslider_f32<"Frequency", halp::range{.min = 20., .max = 2000., .init = 110.}>
+        frequency;
+    halp::change_flagged<halp::hslider_i32<"Harmonics", halp::range{1, 1000, 16}>>
+        harmonics;
+  } inputs;
+
+  struct
+  {
+    halp::audio_channel<"Out", double> audio;
+  } outputs;
+
+  struct
+  {
+    // Set by the binding
+    std::function<void(int)> request;
+
+    // On the thread of the worker
+    static std::function<void(WorkerWavetable&)> work(int harmonics)
+    {
+      std::vector<double> table(table_size);
+      for (int i = 0; i < table_size; i++)
+      {
+        const double phase = 2. * std::numbers::pi * i / table_size;
+        double v = 0.;
+        for (int h = 1; h <= harmonics; h++)
+          v += std::sin(h * phase) / h;
+        table[i] = 2. / std::numbers::pi * v;
+      }
+
+      // The previous table goes back with the function, to be freed on the thread of the worker
+      return [table = std::move(table)](WorkerWavetable& self) mutable {
+        std::swap(self.table, table);
+      };
+    }
+  } worker;
+
+  void operator()(int frames)
+  {
+    if (inputs.harmonics.changed && worker.request)
+      worker.request(inputs.harmonics);
+
+    auto* out = outputs.audio.channel;
+    if (table.empty())
+    {
+      for (int i = 0; i < frames; i++)
+        out[i] = 0.;
+      return;
+    }
+
+    const double increment = inputs.frequency / rate;
+    for (int i = 0; i < frames; i++)
+    {
+      out[i] = 0.25 * table[int(phase * table_size)];
+      phase += increment;
+      phase -= std::floor(phase);
+    }
+  }
+
+  void prepare(halp::setup info) { rate = info.rate; }
+
+  double rate{48000.};
+  double phase{};
+  std::vector<double> table;
+};
+}
@@ -1,9 +1,15 @@
 #pragma once
 #include <halp/static_string.hpp>
 
+#include <optional>
+
 namespace essentia_ports
 {
 using Real = double;
+
+// What the algorithms return instead of throwing
+using error = std::optional<const char*>;
+constexpr auto success = std::nullopt;
 //
 template<halp::static_string Name, halp::static_string Desc>
 struct array_port
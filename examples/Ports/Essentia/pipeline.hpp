@@ -0,0 +1,202 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/struct_reflection.hpp>
+#include <boost/mp11.hpp>
+
+#include "essentia.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace essentia_ports
+{
+template <typename T>
+struct is_array_port : std::false_type
+{
+};
+template <halp::static_string Name, halp::static_string Desc>
+struct is_array_port<array_port<Name, Desc>> : std::true_type
+{
+};
+
+namespace pipeline_detail
+{
+template <typename Ports>
+using array_fields = avnd::matching_fields<avnd::as_tuple<Ports>, is_array_port>;
+
+template <typename S>
+using array_inputs = array_fields<decltype(S::inputs)>;
+template <typename S>
+using array_outputs = array_fields<decltype(S::outputs)>;
+
+template <typename S>
+constexpr std::size_t output_size(std::size_t input_size)
+{
+  if constexpr (requires { S::output_size(input_size); })
+    return S::output_size(input_size);
+  else
+    return input_size;
+}
+
+// An array lives from the stage which writes it to the next one, which reads it:
+// the outputs of a stage take the first slots of the arena which do not hold
+// its inputs, so that two stages apart share their buffers.
+template <std::size_t Outputs, std::size_t Stages>
+struct layout
+{
+  std::array<std::array<int, Outputs>, Stages> slot{};
+  int slots{};
+};
+
+template <std::size_t... Counts>
+constexpr auto arena_layout()
+{
+  constexpr std::size_t counts[] = {Counts...};
+  constexpr std::size_t max_outputs = std::max({Counts...});
+  layout<max_outputs, sizeof...(Counts)> res;
+
+  for (std::size_t k = 0; k < sizeof...(Counts); k++)
+  {
+    int s = 0;
+    for (std::size_t j = 0; j < counts[k]; j++, s++)
+    {
+      while (k > 0 && std::find(res.slot[k - 1].begin(),
+                                res.slot[k - 1].begin() + counts[k - 1], s)
+                          != res.slot[k - 1].begin() + counts[k - 1])
+        s++;
+      res.slot[k][j] = s;
+      res.slots = std::max(res.slots, s + 1);
+    }
+  }
+  return res;
+}
+}
+
+/**
+ * Runs array processors one after the other on each frame, e.g. at each hop
+ * of an analysis:
+ *
+ * essentia_ports::pipeline<Windowing, Spectrum, Entropy> analysis;
+ * analysis.prepare(1024);
+ * if (auto err = analysis(frame, 1024)) ...;
+ * entropy = analysis.stage<2>().outputs.entropy;
+ *
+ * The array inputs of a stage are the array outputs of the previous one, in order,
+ * and the first stage reads the frame. All the arrays are in a single arena allocated
+ * by prepare(): the stages write their outputs in it and the next ones read
+ * them there, without copies, and the buffers of the stages which are done
+ * are reused by the next ones. A stage whose output does not have the size of its
+ * input tells it with a static output_size(input_size); one which needs to allocate
+ * ahead of the frames does so in reset_frames(input_size), which is not named prepare
+ * so that avnd::prepare does not call it with a default-constructed setup.
+ *
+ * The first error of a stage stops the frame and is returned.
+ * The stages do not write in their inputs.
+ */
+template <typename... Stages>
+class pipeline
+{
+public:
+  static_assert(sizeof...(Stages) > 0);
+  static_assert(
+      pipeline_detail::array_inputs<boost::mp11::mp_front<std::tuple<Stages...>>>::size
+          == 1,
+      "the first stage reads the frame in its array input");
+
+  static constexpr std::size_t stages = sizeof...(Stages);
+
+  // Allocates the arena and prepares the stages for frames of up to max_size values
+  void prepare(std::size_t max_size)
+  {
+    std::size_t slot_size = 0;
+    std::size_t size = max_size;
+    [&]<std::size_t... K>(std::index_sequence<K...>) {
+      (
+          [&] {
+            auto& s = std::get<K>(m_stages);
+            using S = std::decay_t<decltype(s)>;
+            if constexpr (requires { s.reset_frames(size); })
+              s.reset_frames(size);
+            size = pipeline_detail::output_size<S>(size);
+            slot_size = std::max(slot_size, size);
+          }(),
+          ...);
+    }(std::index_sequence_for<Stages...>{});
+
+    m_max_size = max_size;
+    m_slot_size = slot_size;
+    m_arena.assign(std::size_t(layout.slots) * slot_size, Real{});
+  }
+
+  error operator()(const Real* frame, std::size_t size)
+  {
+    if (size > m_max_size)
+      return error{"pipeline: the frame is larger than the prepared size"};
+
+    std::array<Real*, max_outputs> current{const_cast<Real*>(frame)};
+    error err = success;
+    [&]<std::size_t... K>(std::index_sequence<K...>) {
+      ((err = run<K>(current, size)) || ...);
+    }(std::index_sequence_for<Stages...>{});
+    return err;
+  }
+
+  template <std::size_t K>
+  auto& stage() noexcept
+  {
+    return std::get<K>(m_stages);
+  }
+
+private:
+  static constexpr std::size_t output_counts[]
+      = {pipeline_detail::array_outputs<Stages>::size...};
+  static constexpr auto layout
+      = pipeline_detail::arena_layout<pipeline_detail::array_outputs<Stages>::size...>();
+  static constexpr std::size_t max_outputs
+      = std::max(layout.slot[0].size(), std::size_t(1));
+
+  template <std::size_t K>
+  error run(std::array<Real*, max_outputs>& current, std::size_t& size)
+  {
+    auto& s = std::get<K>(m_stages);
+    using S = std::decay_t<decltype(s)>;
+    using ins = pipeline_detail::array_inputs<S>;
+    using outs = pipeline_detail::array_outputs<S>;
+    static_assert(
+        K == 0 || ins::size <= output_counts[K - 1],
+        "a stage reads more arrays than the previous one writes");
+
+    [&]<int... I>(std::integer_sequence<int, I...>) {
+      std::size_t j = 0;
+      ((avnd::pfr::get<I>(s.inputs).channel = current[j++]), ...);
+    }(typename ins::indices_n{});
+
+    [&]<int... I>(std::integer_sequence<int, I...>) {
+      std::size_t j = 0;
+      ((current[j] = m_arena.data() + std::size_t(layout.slot[K][j]) * m_slot_size,
+        avnd::pfr::get<I>(s.outputs).channel = current[j++]),
+       ...);
+    }(typename outs::indices_n{});
+
+    error err = success;
+    if constexpr (std::is_same_v<decltype(s(size)), error>)
+      err = s(size);
+    else
+      s(size);
+    size = pipeline_detail::output_size<S>(size);
+    return err;
+  }
+
+  std::tuple<Stages...> m_stages;
+  std::vector<Real> m_arena;
+  std::size_t m_slot_size{};
+  std::size_t m_max_size{};
+};
+}
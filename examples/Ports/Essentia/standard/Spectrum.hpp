@@ -0,0 +1,79 @@
+#pragma once
+
+/*
+ * Copyright (C) 2006-2021  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is ported from Essentia
+ * Original version:
+ *
+ *  https://github.com/MTG/essentia/blob/master/src/algorithms/standard/spectrum.h
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+
+#include <halp/fft.hpp>
+#include <halp/meta.hpp>
+
+#include "../essentia.hpp"
+
+#include <cmath>
+#include <cstddef>
+
+namespace essentia_ports
+{
+struct Spectrum
+{
+  halp_meta(name, "Spectrum")
+  halp_meta(c_name, "avnd_essentia_spectrum")
+  halp_meta(category, "Standard")
+  halp_meta(version, "1.0")
+  halp_meta(author, "Music Technology Group - Universitat Pompeu Fabra")
+  halp_meta(vendor, "Music Technology Group - Universitat Pompeu Fabra")
+  halp_meta(description, DOC("This algorithm computes the magnitude spectrum of an array of Reals. The resulting magnitude spectrum has a size which is half the size of the input array plus one. Bins contain raw (linear) magnitude values.\n"
+                             "\n"
+                             "The size of the input array has to be a power of two."))
+  halp_meta(uuid, "343265dc-105b-41e5-bb2f-1a86335ca36a")
+
+  struct {
+    array_port<"frame", "the input audio frame"> frame;
+  } inputs;
+
+  struct {
+    array_port<"spectrum", "the magnitude spectrum of the input audio signal"> spectrum;
+  } outputs;
+
+  static constexpr std::size_t output_size(std::size_t frames) { return frames / 2 + 1; }
+
+  // Plans the transform of the frames of this size
+  void reset_frames(std::size_t size) { fft.reset(size); }
+
+  error operator()(std::size_t frames)
+  {
+    if (frames < 2 || (frames & (frames - 1)) != 0) {
+      return error{"Spectrum: the size of the frame must be a power of two"};
+    }
+
+    const auto* bins = fft.execute(inputs.frame.channel, frames);
+    Real* spectrum = outputs.spectrum;
+    for (std::size_t i = 0; i < output_size(frames); ++i)
+      spectrum[i] = std::abs(bins[i]);
+
+    return success;
+  }
+
+  halp::fft<Real> fft;
+};
+
+}
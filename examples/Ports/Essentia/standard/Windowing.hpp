@@ -0,0 +1,109 @@
+#pragma once
+
+/*
+ * Copyright (C) 2006-2021  Music Technology Group - Universitat Pompeu Fabra
+ *
+ * This file is ported from Essentia
+ * Original version:
+ *
+ *  https://github.com/MTG/essentia/blob/master/src/algorithms/standard/windowing.h
+ *
+ * Essentia is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the Free
+ * Software Foundation (FSF), either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the Affero GNU General Public License
+ * version 3 along with this program.  If not, see http://www.gnu.org/licenses/
+ */
+
+
+#include <halp/meta.hpp>
+
+#include "../essentia.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace essentia_ports
+{
+struct Windowing
+{
+  halp_meta(name, "Windowing")
+  halp_meta(c_name, "avnd_essentia_windowing")
+  halp_meta(category, "Standard")
+  halp_meta(version, "1.0")
+  halp_meta(author, "Music Technology Group - Universitat Pompeu Fabra")
+  halp_meta(vendor, "Music Technology Group - Universitat Pompeu Fabra")
+  halp_meta(description, DOC("This algorithm applies windowing to an audio signal. The window is normalized (to have an area of 1) and then scaled by a factor of 2.\n"
+                             "\n"
+                             "This port only has the Hann window, without zero-padding nor zero-phase windowing."))
+  halp_meta(uuid, "fa0502e8-2e66-48bd-82ae-a20f39c980d4")
+
+  struct {
+    array_port<"frame", "the input audio frame"> frame;
+  } inputs;
+
+  struct {
+    array_port<"frame", "the windowed audio frame"> frame;
+  } outputs;
+
+  // Allocates the window for frames of up to this size, ahead of the processing
+  void reset_frames(std::size_t size)
+  {
+    window.assign(size, Real{});
+    window_size = 0;
+    compute(size);
+  }
+
+  // Computes the Hann window of this size in place, without allocating
+  void compute(std::size_t size) noexcept
+  {
+    static constexpr double pi = 3.141592653589793238462643383279502884;
+    window_size = size;
+    if (size == 0)
+      return;
+    if (size == 1) {
+      window[0] = 1.;
+      return;
+    }
+
+    Real sum = 0.;
+    for (std::size_t i = 0; i < size; ++i) {
+      window[i] = 0.5 - 0.5 * std::cos(2. * pi * i / (size - 1.));
+      sum += window[i];
+    }
+    for (std::size_t i = 0; i < size; ++i)
+      window[i] *= 2. / sum;
+  }
+
+  error operator()(std::size_t frames)
+  {
+    if (frames < 2) {
+      return error{"Windowing: the frame must have at least 2 samples"};
+    }
+    if (frames > window.size()) {
+      return error{"Windowing: the frame is larger than the size given to reset_frames"};
+    }
+    if (window_size != frames)
+      compute(frames);
+
+    const Real* in = inputs.frame;
+    Real* out = outputs.frame;
+    for (std::size_t i = 0; i < frames; ++i)
+      out[i] = in[i] * window[i];
+
+    return success;
+  }
+
+  std::vector<Real> window;
+  std::size_t window_size{};
+};
+
+}
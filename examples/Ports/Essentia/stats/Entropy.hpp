@@ -26,36 +26,12 @@
 #include <halp/audio.hpp>
 #include <halp/controls.hpp>
 #include <halp/meta.hpp>
+#include <halp/statistics.hpp>
 
 #include "../essentia.hpp"
 
-#include <algorithm>
-#include <stdexcept>
-#include <cmath>
-
-#include <optional>
-
 namespace essentia_ports
 {
-using error = std::optional<const char*>;
-constexpr auto success = std::nullopt;
-
-template <typename T> void normalizeSum(std::span<T>& array) {
-  if (array.empty()) return;
-
-  T sumElements = (T) 0.;
-  for (size_t i=0; i<array.size(); ++i) {
-    if (array[i] < 0) return;
-    sumElements += array[i];
-  }
-
-  if (sumElements != (T) 0.0) {
-    for (size_t i=0; i<array.size(); ++i) {
-      array[i] /= sumElements;
-    }
-  }
-}
-
 struct Entropy
 {
   halp_meta(name, "Entropy")
@@ -84,24 +60,20 @@ struct Entropy
 
   error operator()(std::size_t frames)
   {
-    std::span<Real> array{inputs.array.channel, frames};
+    avnd::span<const Real> array{inputs.array.channel, frames};
     Real& entropy = outputs.entropy;
 
     if (array.size() == 0) {
       return error{"Entropy: array does not contain any values"};
     }
 
-    if (std::any_of(array.begin(), array.end(), [](Real value) { return value < 0; })) {
+    // The negatives, the normalization and the entropy in a single pass
+    const auto stats = halp::statistics::summarize(array);
+    if (stats.has_negatives()) {
       return error{"Entropy: array must not contain negative values"};
     }
 
-    normalizeSum(array);
-    entropy = 0.0;
-
-    for (size_t i=0; i<array.size(); ++i) {
-        if (array[i]==0)array[i] = 1;
-        entropy -= std::log2(array[i]) * array[i];
-    }
+    entropy = stats.entropy();
 
     return success;
   }
@@ -10,6 +10,9 @@ struct Addition
   static consteval auto c_name() { return "avnd_addition"; }
   static consteval auto uuid() { return "36427eb1-b5f4-4735-a383-6164cb9b2572"; }
 
+  // The output only changes with the inputs
+  static constexpr bool pure_controls = true;
+
   struct
   {
     struct
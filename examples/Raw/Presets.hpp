@@ -51,6 +51,10 @@ struct Presets
       {.name{"Hi gain"}, .parameters{.preamp = {1.0}, .volume = {1.0}}},
   };
 
+  // Switching programs glides the controls to their new values over 50 ms
+  // in the hosts which support it, instead of jumping
+  static consteval double program_fade_seconds() { return 0.05; }
+
   void operator()(double** in, double** out, int frames)
   {
     const double preamp = 100. * inputs.preamp.value;
@@ -21,11 +21,11 @@ struct Random
 
   void operator()()
   {
-    static thread_local std::random_device dev;
-    static thread_local std::mt19937_64 gen{dev()};
-
     auto dist = std::uniform_real_distribution<>{0., 1.};
     outputs.out.value = dist(gen);
   }
+
+  // Seeded once per instance, not at each call
+  std::mt19937_64 gen{std::random_device{}()};
 };
 }
@@ -22,7 +22,8 @@ struct AudioSidechainExample
   struct
   {
     halp::audio_input_bus<"Main Input"> audio;
-    halp::audio_input_bus<"Sidechain"> sidechain;
+    // The host may leave it unconnected: we then skip it altogether
+    halp::optional_bus<halp::audio_input_bus<"Sidechain">> sidechain;
 
     halp::knob_f32<"Gain", halp::range{.min = 0.f, .max = 100.f, .init = 10.f}> gain;
   } inputs;
@@ -52,8 +53,8 @@ struct AudioSidechainExample
       auto& in = p1.samples[i];
       auto& out = p2.samples[i];
 
-      // If there's enough channels in the sidechain, use it
-      if (sc.channels > i)
+      // If the sidechain is connected with enough channels, use it
+      if (sc.connected && sc.channels > i)
       {
         auto& sidechain = sc.samples[i];
         for (std::size_t j = 0; j < N; j++)
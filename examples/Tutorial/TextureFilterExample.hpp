@@ -3,6 +3,7 @@
 #include <halp/controls.hpp>
 #include <halp/meta.hpp>
 #include <halp/sample_accurate_controls.hpp>
+#include <halp/tasks.hpp>
 #include <halp/texture.hpp>
 #include <cmath>
 
@@ -34,7 +35,11 @@ struct TextureFilterExample
     outputs.image.create(1, 1);
   }
 
-  void operator()()
+  // Splits the work across the threads of the host, see tile()
+  halp::task_runner tasks;
+
+  // Called once per frame before the tiles: returns false when there is nothing to do
+  bool begin_frame()
   {
     auto& in_tex = inputs.image.texture;
     auto& out_tex = outputs.image.texture;
@@ -42,23 +47,37 @@ struct TextureFilterExample
     // Since GPU readbacks are asynchronous: reading textures may take some time and
     // thus the data may not be available from the beginning.
     if (in_tex.bytes == nullptr)
-      return;
+      return false;
 
     // Texture hasn't changed since last time, no need to recompute anything
     if (!in_tex.changed)
-      return;
+      return false;
     in_tex.changed = false;
 
     // We (dirtily) downscale by a factor of 16
-    if (out_tex.width != in_tex.width || out_tex.height != in_tex.height)
+    if (out_tex.width != in_tex.width / 16 || out_tex.height != in_tex.height / 16)
       outputs.image.create(in_tex.width / 16, in_tex.height / 16);
+    return out_tex.width > 0 && out_tex.height > 0;
+  }
+
+  // The output is small but each of its rows reads a whole row of the input:
+  // a few rows per tile are enough work for a thread
+  static constexpr int tile_rows() { return 4; }
 
-    for (int y = 0; y < in_tex.height / 16; y++)
+  // Computes a band of rows of the output: the bands may run in parallel
+  void tile(int x0, int y0, int w, int h)
+  {
+    const auto in = inputs.image.view();
+    const auto out = outputs.image.view();
+    for (int y = y0; y < y0 + h; y++)
     {
-      for (int x = 0; x < in_tex.width / 16; x++)
+      // Going through the rows is faster than calling get(x, y) for each pixel
+      auto in_row = in.row(y * 16);
+      auto out_row = out.row(y);
+      for (int x = x0; x < x0 + w; x++)
       {
         // Get a pixel
-        auto [r, g, b, a] = inputs.image.get(x * 16, y * 16);
+        auto [r, g, b, a] = in_row[x * 16];
 
         // (Dirtily) Take the luminance and compute its contrast
         double contrasted = std::pow((r + g + b) / (3. * 255.), 4.);
@@ -67,12 +86,25 @@ struct TextureFilterExample
         uint8_t col = uint8_t(contrasted * 8) * (255 / 8.);
 
         // Update the output texture
-        outputs.image.set(x, y, col, col, col, 255);
+        out_row[x] = {col, col, col, 255};
       }
     }
+  }
 
+  // Called once all the tiles are done
+  void end_frame()
+  {
     // Call this when the texture changed
     outputs.image.upload();
   }
+
+  // For the bindings which do not split the work in tiles
+  void operator()()
+  {
+    if (!begin_frame())
+      return;
+    tile(0, 0, outputs.image.texture.width, outputs.image.texture.height);
+    end_frame();
+  }
 };
 }
@@ -35,6 +35,10 @@ struct TextureGeneratorExample
   halp_meta(description, "<DESCRIPTION>");
   halp_meta(uuid, "01247f4f-6b19-458d-845d-9f7cc2d9d663");
 
+  // The host can generate the next frame on a worker thread while this one is shown,
+  // as the processor only ever writes into its own memory: see avnd/wrappers/texture_async.hpp
+  halp_flag(asynchronous_textures);
+
   // By know you know the drill: define inputs, outputs...
   struct
   {
@@ -0,0 +1,60 @@
+#pragma once
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+#include <halp/texture.hpp>
+
+namespace examples
+{
+/**
+ * Between two GPU nodes, a CPU texture processor costs a readback of its
+ * input and an upload of its output at each frame, which for 4K video takes
+ * longer than the frame itself.
+ *
+ * This one only needs the size of the image, and a pixel once in a while:
+ * its input is declared as staying on the GPU unless asked for, and the
+ * output forwards the input, which the host passes on as it is.
+ */
+struct TexturePassthroughExample
+{
+  halp_meta(name, "My example texture passthrough");
+  halp_meta(c_name, "texture_passthrough");
+  halp_meta(category, "Demo");
+  halp_meta(author, "<AUTHOR>");
+  halp_meta(description, "Measures a texture without reading it back");
+  halp_meta(uuid, "9a51e3c6-0d4b-4f27-b8e2-64c1f7a0d53b");
+
+  struct
+  {
+    halp::texture_input<"In", halp::rgba_texture, avnd::texture_access::on_demand> image;
+    halp::impulse_button<"Probe"> probe;
+  } inputs;
+
+  struct
+  {
+    halp::texture_output<"Out"> image;
+    halp::val_port<"Width", int> width;
+    halp::val_port<"Height", int> height;
+
+    // Red, green, blue and alpha of the center pixel, when probed
+    halp::val_port<"Center", int> center;
+  } outputs;
+
+  void operator()()
+  {
+    auto& in = inputs.image;
+    outputs.image.forward(in);
+    outputs.width = in.texture.width;
+    outputs.height = in.texture.height;
+
+    // The pixels come with one of the next frames
+    if (inputs.probe)
+      in.request_pixels();
+
+    if (in.has_pixels() && in.texture.width > 0 && in.texture.height > 0)
+    {
+      auto [r, g, b, a] = in.get(in.texture.width / 2, in.texture.height / 2);
+      outputs.center = (r << 24) | (g << 16) | (b << 8) | a;
+    }
+  }
+};
+}
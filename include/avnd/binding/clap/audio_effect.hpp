@@ -3,18 +3,49 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <avnd/binding/clap/bus_info.hpp>
+#include <avnd/binding/clap/core.hpp>
 #include <avnd/binding/clap/helpers.hpp>
+#include <avnd/binding/clap/thread_pool.hpp>
 #include <avnd/common/export.hpp>
 #include <avnd/introspection/channels.hpp>
 #include <avnd/introspection/midi.hpp>
+#include <avnd/wrappers/bypass.hpp>
+#include <avnd/wrappers/changed_controls.hpp>
+#include <avnd/wrappers/constant_inputs.hpp>
 #include <avnd/wrappers/control_display.hpp>
 #include <avnd/wrappers/controls.hpp>
 #include <avnd/wrappers/controls_double.hpp>
+#include <avnd/wrappers/controls_storage.hpp>
+#include <avnd/wrappers/deadline.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/latency.hpp>
+#include <avnd/wrappers/message_bus.hpp>
 #include <avnd/wrappers/metadatas.hpp>
-#include <avnd/wrappers/process_adapter.hpp>
+#include <avnd/wrappers/modulation_storage.hpp>
+#include <avnd/wrappers/morph.hpp>
+#include <avnd/wrappers/optional_busses.hpp>
+#include <avnd/wrappers/output_parameters.hpp>
+#include <avnd/wrappers/parameter_ids.hpp>
+#include <avnd/wrappers/quality_governor.hpp>
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+#include <avnd/wrappers/render_mode.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
+#include <avnd/wrappers/silence.hpp>
+#include <avnd/wrappers/smoothing_storage.hpp>
+#include <avnd/wrappers/state.hpp>
+#include <avnd/wrappers/sub_block_scheduler.hpp>
+#include <avnd/wrappers/tracing.hpp>
 #include <avnd/wrappers/widgets.hpp>
+#include <avnd/wrappers/worker.hpp>
 #include <clap/all.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
 namespace avnd_clap
 {
 template <typename T>
@@ -79,18 +110,77 @@ struct midi_processor : public avnd::midi_storage<T>
 
   void add_message(avnd::dynamic_container_midi_port auto& port, const clap_event& msg)
   {
+    if constexpr (avnd::sysex_midi_port<std::decay_t<decltype(port)>>)
+    {
+      if (msg.type == CLAP_EVENT_MIDI_SYSEX)
+      {
+        // The buffer of the event is valid until the end of the process call
+        if constexpr (avnd::sysex_view_midi_port<std::decay_t<decltype(port)>>)
+          port.sysex.push_view(msg.midi_sysex.buffer, msg.midi_sysex.size, msg.time);
+        else
+          port.sysex.push(msg.midi_sysex.buffer, msg.midi_sysex.size, msg.time);
+        return;
+      }
+    }
+
+    // Fixed-capacity buses drop the message when they are full
+    const auto count = port.midi_messages.size();
     port.midi_messages.push_back({});
+    if (port.midi_messages.size() == count)
+      return;
+
     auto& elt = port.midi_messages.back();
     init_midi_message(elt, msg);
+    update_expressions(port, elt);
   }
 
   void add_message(avnd::raw_container_midi_port auto& port, const clap_event& msg)
   {
     auto& elt = port.midi_messages[port.size];
     init_midi_message(elt, msg);
+    update_expressions(port, elt);
 
     port.size++;
   }
+
+  // MPE: the channel messages also update the table of expressions of the port
+  void update_expressions(avnd::midi_port auto& port, const auto& msg)
+  {
+    if constexpr (avnd::note_expression_midi_port<std::decay_t<decltype(port)>>)
+      port.expressions.update(std::data(msg.bytes), std::size(msg.bytes));
+  }
+
+  void add_expression(avnd::midi_port auto& port, const clap_event_note_expression& ev)
+  {
+    if constexpr (avnd::note_expression_midi_port<std::decay_t<decltype(port)>>)
+    {
+      using expr = avnd::note_expression;
+      switch (ev.expression_id)
+      {
+        case CLAP_NOTE_EXPRESSION_VOLUME:
+          // Already a linear gain in [0; 4], 1 being the neutral value
+          port.expressions.set(ev.channel, ev.key, expr::volume, ev.value);
+          break;
+        case CLAP_NOTE_EXPRESSION_PAN:
+          port.expressions.set(ev.channel, ev.key, expr::pan, ev.value);
+          break;
+        case CLAP_NOTE_EXPRESSION_TUNING:
+          port.expressions.set(ev.channel, ev.key, expr::tuning, ev.value);
+          break;
+        case CLAP_NOTE_EXPRESSION_VIBRATO:
+          port.expressions.set(ev.channel, ev.key, expr::vibrato, ev.value);
+          break;
+        case CLAP_NOTE_EXPRESSION_BRIGHTNESS:
+          port.expressions.set(ev.channel, ev.key, expr::brightness, ev.value);
+          break;
+        case CLAP_NOTE_EXPRESSION_PRESSURE:
+          port.expressions.set(ev.channel, ev.key, expr::pressure, ev.value);
+          break;
+        default:
+          break;
+      }
+    }
+  }
 };
 
 template <typename T>
@@ -99,6 +189,8 @@ struct SimpleAudioEffect : clap_plugin
   using effect_type = T;
   using inputs_t = typename avnd::inputs_type<T>::type;
   using param_in_info = avnd::parameter_input_introspection<T>;
+  using param_out_info = avnd::parameter_output_introspection<T>;
+  using param_ids = avnd::parameter_ids<T>;
   using midi_in_info = avnd::midi_input_introspection<T>;
   using midi_out_info = avnd::midi_output_introspection<T>;
   static const constexpr int32_t parameter_count = param_in_info::size;
@@ -108,8 +200,77 @@ struct SimpleAudioEffect : clap_plugin
   const clap_host& host;
 
   [[no_unique_address]] avnd_clap::audio_bus_info<T> audio_busses;
-  [[no_unique_address]] avnd::process_adapter<T> processor;
+  avnd::bypass_adapter<T> processor;
   [[no_unique_address]] midi_processor<T> midi;
+  [[no_unique_address]] avnd::control_storage<T> control_buffers;
+  [[no_unique_address]] avnd::smoothing_storage<T> smoothing;
+  [[no_unique_address]] avnd::modulation_storage<T> modulation;
+  [[no_unique_address]] avnd::shared_controls<T> controls;
+  [[no_unique_address]] avnd::changed_controls_storage<T> changed_controls;
+  [[no_unique_address]] avnd::morph_storage<T> morphing;
+  [[no_unique_address]] avnd::worker_storage<T> worker;
+  [[no_unique_address]] avnd::message_bus_storage<T> messages;
+  [[no_unique_address]] avnd::output_parameter_reporter<T> output_params;
+
+  // Hosts ask for the text of the values of all the visible parameters at each frame
+  avnd::display_cache<param_in_info::size + param_out_info::size> value_texts;
+
+  // Worker threads of the host, used for splitting the processing when possible
+  avnd_clap::host_thread_pool tasks;
+
+  struct param_change
+  {
+    clap_id id{};
+    double value{};
+    bool modulation{};
+  };
+
+  // Values set by the host, and modulation offsets, by parameter index:
+  // the controls get their sum, or both for the ones declared as modulated.
+  std::array<double, parameter_count> param_values{};
+  std::array<double, parameter_count> param_modulations{};
+
+  // Lets processors with a tail sleep when they only get silence
+  avnd::silence_tracker silence;
+  bool received_notes{};
+
+  // Set by the host through the render extension, e.g. when bouncing
+  avnd::render_mode_request render_request;
+
+  // Callbacks over their time budget, when built with AVND_DEADLINE_MONITOR
+  [[no_unique_address]] avnd::deadline_monitor deadlines{avnd::get_name<T>()};
+
+  // Lowers the quality of the processors which have levels when the buffers take too long
+  [[no_unique_address]] avnd::quality_governor<T> governor;
+
+  // The setup of the last prepare, to tell the processor what changed in the next one
+  avnd::process_setup current_setup{};
+
+  // What the host was last told, for the latencies and tails which change at run-time.
+  // The latency may only change while deactivated: once it changed, the main thread
+  // asks the host for a restart, and the new one is reported when activating again.
+  enum latency_state : int
+  {
+    latency_reported,
+    latency_changed,
+    restart_requested
+  };
+  const clap_host_latency* host_latency{};
+  const clap_host_tail* host_tail{};
+  int64_t reported_latency{};
+  double reported_tail{};
+  std::atomic<int> latency_status{latency_reported};
+
+  // Events of a buffer by time, when the host does not give them in order.
+  // Reserved at activate, see for_each_event_in_order
+  std::vector<const clap_event*> sorted_events;
+
+  // Kept from one save to the next to not reallocate
+  std::vector<char> state_buffer;
+
+  // Processors without sample-accurate inputs get their buffers split at parameter changes.
+  // Otherwise, this only holds the values of the sample-accurate inputs at the end of the buffer.
+  avnd::sub_block_scheduler<param_change> param_changes;
 
   float sample_rate{44100.};
   int buffer_size{512};
@@ -120,7 +281,18 @@ struct SimpleAudioEffect : clap_plugin
     // Set-up clap data structures
     clap_plugin::desc = &descriptor;
     clap_plugin::plugin_data = this;
-    clap_plugin::init = [](const struct clap_plugin* plugin) -> bool { return true; };
+    clap_plugin::init = [](const struct clap_plugin* plugin) -> bool
+    {
+      auto& p = *self(plugin);
+      p.tasks.init(p.host);
+      if constexpr (avnd::dynamic_latency<T>)
+        p.host_latency = static_cast<const clap_host_latency*>(
+            p.host.get_extension(&p.host, CLAP_EXT_LATENCY));
+      if constexpr (avnd::dynamic_tail<T>)
+        p.host_tail = static_cast<const clap_host_tail*>(
+            p.host.get_extension(&p.host, CLAP_EXT_TAIL));
+      return true;
+    };
     clap_plugin::destroy
         = [](const struct clap_plugin* plugin) -> void { delete self(plugin); };
 
@@ -134,10 +306,12 @@ struct SimpleAudioEffect : clap_plugin
       p.buffer_size = max_frames_count;
 
       p.start();
+      p.report_latency_and_tail();
       return true;
     };
 
-    clap_plugin::deactivate = [](const struct clap_plugin* plugin) -> void {};
+    clap_plugin::deactivate
+        = [](const struct clap_plugin* plugin) -> void { self(plugin)->stop(); };
 
     clap_plugin::start_processing
         = [](const struct clap_plugin* plugin) -> bool { return true; };
@@ -150,8 +324,7 @@ struct SimpleAudioEffect : clap_plugin
                               const clap_process* process) -> clap_process_status
     {
       auto& p = *self(plugin);
-      p.process(*process);
-      return CLAP_PROCESS_CONTINUE;
+      return p.process(*process);
     };
 
     clap_plugin::get_extension
@@ -166,17 +339,43 @@ struct SimpleAudioEffect : clap_plugin
         return &p.audio_ports;
       if (id_sv == "clap.note-ports")
         return &p.note_ports;
+      if (id_sv == CLAP_EXT_STATE)
+        return &p.state;
+      if (id_sv == CLAP_EXT_THREAD_POOL)
+        return &p.thread_pool;
+      if (id_sv == CLAP_EXT_RENDER)
+        return &p.render;
+      if constexpr (avnd::has_tail<T>)
+        if (id_sv == CLAP_EXT_TAIL)
+          return &p.tail;
+      if constexpr (avnd::reports_latency<T>)
+        if (id_sv == CLAP_EXT_LATENCY)
+          return &p.latency;
 
       return nullptr;
     };
 
-    clap_plugin::on_main_thread = [](const struct clap_plugin* plugin) {};
+    clap_plugin::on_main_thread = [](const struct clap_plugin* plugin) {
+      auto& p = *self(plugin);
+      if constexpr (avnd::dynamic_latency<T>)
+      {
+        int expected = latency_changed;
+        if (p.latency_status.compare_exchange_strong(expected, restart_requested))
+          p.host.request_restart(&p.host);
+      }
+    };
+
+    // Only the parameters until the host activates: a duplicated processor
+    // keeps a single instance, which holds the controls
+    effect.init_channels(1, 1);
 
     /// Read the initial state of the controls
     if constexpr (avnd::has_inputs<T>)
     {
       avnd::init_controls(effect.inputs());
     }
+
+    read_param_values();
   }
 
   void start()
@@ -186,9 +385,12 @@ struct SimpleAudioEffect : clap_plugin
         .input_channels = avnd::input_channels<T>(2),
         .output_channels = avnd::output_channels<T>(2),
         .frames_per_buffer = buffer_size,
-        .rate = sample_rate};
+        .rate = sample_rate,
+        .mode = render_request.get()};
 
-    processor.allocate_buffers(setup_info, double{});
+    // The audio ports advertise a precision the processor supports,
+    // thus no conversion buffers are needed
+    processor.allocate_buffers(setup_info, host_sample_type{});
     effect.init_channels(setup_info.input_channels, setup_info.output_channels);
 
     // Setup buffers for storing MIDI messages
@@ -197,8 +399,41 @@ struct SimpleAudioEffect : clap_plugin
       midi.reserve_space(this->effect, buffer_size);
     }
 
-    // Effect-specific preparation
-    avnd::prepare(effect, setup_info);
+    // Setup buffers for sample-accurate controls
+    control_buffers.reserve_space(this->effect, buffer_size);
+    param_changes.reserve(parameter_count * 16);
+    param_changes.set_granularity(avnd::control_granularity<T>());
+    sorted_events.reserve(avnd_clap::max_sorted_events);
+    smoothing.prepare(this->effect, sample_rate, buffer_size);
+    modulation.prepare(this->effect, buffer_size);
+    worker.start(this->effect);
+    messages.start(this->effect);
+    silence.prepare(sample_rate);
+    deadlines.prepare(sample_rate);
+    governor.prepare(sample_rate, setup_info.mode);
+    output_params.prepare(sample_rate);
+
+    // Effect-specific preparation: the buffers of the binding were freed when
+    // deactivating, but the processor keeps what does not depend on what changed
+    avnd::reconfigure(effect, current_setup, setup_info);
+    processor.reserve_delay(avnd::latency_samples(effect));
+
+    // Parallel processing of the channels, and of the tasks of the processor
+    if_possible(processor.parallelism.pool = &tasks);
+    for (auto& e : effect.effects())
+      avnd::bind_task_runner(e, &tasks);
+  }
+
+  // Frees what start() allocated: a deactivated instance only keeps its parameters,
+  // e.g. on a disabled track, until the next activate.
+  void stop()
+  {
+    processor.release_buffers();
+    midi.release(this->effect);
+    control_buffers.release(this->effect);
+    param_changes.release();
+    sorted_events = {};
+    avnd::release_channels(this->effect);
   }
 
   template <auto access_samples>
@@ -207,97 +442,467 @@ struct SimpleAudioEffect : clap_plugin
       auto** inputs,
       int in_N,
       auto** outputs,
-      int out_N)
+      int out_N,
+      int first,
+      int frames)
   {
     // Note: we map everything to a span.
     // But since this API has a very good bus implementation
     // we could try to leverage directly it if possible.
 
+    // There is no port activation in this version of the API:
+    // a bus the host did not connect comes without buffers.
     int in_i = 0;
+    [[maybe_unused]] uint64_t constants = 0;
     for (int bus = 0; bus < process.audio_inputs_count; bus++)
     {
       auto& b = process.audio_inputs[bus];
+      auto samples = b.*access_samples;
+      avnd::set_input_bus_connected(effect, bus, samples && b.channel_count > 0);
       for (int k = 0; k < b.channel_count; ++k)
       {
         if (in_i < in_N)
         {
-          inputs[in_i] = (b.*access_samples)[k];
+          if constexpr (avnd::wants_constant_inputs<T>())
+            if (in_i < 64 && k < 64 && (b.constant_mask >> k) & 1)
+              constants |= uint64_t(1) << in_i;
+          inputs[in_i] = samples ? samples[k] + first : nullptr;
           ++in_i;
         }
       }
     }
+    avnd::set_input_constants(effect, constants);
 
     int out_i = 0;
     for (int bus = 0; bus < process.audio_outputs_count; bus++)
     {
       auto& b = process.audio_outputs[bus];
+      auto samples = b.*access_samples;
+      avnd::set_output_bus_connected(effect, bus, samples && b.channel_count > 0);
       for (int k = 0; k < b.channel_count; ++k)
       {
         if (out_i < out_N)
         {
-          outputs[out_i] = (b.*access_samples)[k];
+          outputs[out_i] = samples ? samples[k] + first : nullptr;
           ++out_i;
         }
       }
     }
 
     using samples_t = std::decay_t<decltype(inputs[0][0])>;
-    processor.process(
-        effect,
-        avnd::span<samples_t*>{inputs, std::size_t(in_N)},
-        avnd::span<samples_t*>{outputs, std::size_t(out_N)},
-        process.frames_count);
+    {
+      AVND_TRACE_ZONE(T, process);
+      controls.sync(effect);
+      worker.deliver(effect);
+      messages.deliver(effect);
+      morphing.update(effect);
+      smoothing.update(effect, frames);
+      modulate(frames);
+      changed_controls.update(effect);
+      processor.process(
+          effect,
+          avnd::span<samples_t*>{inputs, std::size_t(in_N)},
+          avnd::span<samples_t*>{outputs, std::size_t(out_N)},
+          frames);
+      modulation.restore(effect);
+    }
+
+    // The MIDI outputs first, the timestamps of the sub-block come before its end
+    process_out_midi(process, first);
+
+    // The outputs have their value at the end of the sub-block
+    process_out_params(process, first + frames - 1, frames);
+  }
+
+  // The messages of all the MIDI outputs go to the host in a single pass, sorted by time
+  void process_out_midi(const clap_process& process, int first)
+  {
+    if constexpr (midi_out_info::size > 0)
+    {
+      if (!process.out_events)
+        return;
+
+      AVND_TRACE_ZONE(T, midi);
+      uint32_t last = 0;
+      midi.for_each_output_in_order(
+          effect, [&](avnd::span<const unsigned char> bytes, int32_t timestamp, int port) {
+        if (bytes.empty())
+          return;
+
+        // The host wants the events in order, even if a processor wrote them otherwise
+        last = std::max(last, uint32_t(std::max(first + timestamp, 0)));
+
+        clap_event ev{};
+        ev.time = last;
+        if (bytes[0] == 0xF0)
+        {
+          ev.type = CLAP_EVENT_MIDI_SYSEX;
+          ev.midi_sysex.port_index = port;
+          ev.midi_sysex.buffer = bytes.data();
+          ev.midi_sysex.size = uint32_t(bytes.size());
+        }
+        else
+        {
+          ev.type = CLAP_EVENT_MIDI;
+          ev.midi.port_index = port;
+          std::copy_n(bytes.begin(), std::min(bytes.size(), std::size_t(3)), ev.midi.data);
+        }
+        process.out_events->push_back(process.out_events, &ev);
+      });
+
+      // A processor split in sub-blocks writes its messages again for the next one
+      midi.clear_outputs(effect);
+    }
+  }
+
+  void process_out_params(const clap_process& process, int time, int frames)
+  {
+    if (process.out_events)
+      report_out_params(*process.out_events, time, frames);
   }
 
-  void process(const clap_process& process)
+  void report_out_params(const clap_event_list& out, int time, int frames)
   {
+    if constexpr (param_out_info::size > 0)
+    {
+      AVND_TRACE_ZONE(T, controls);
+      output_params.report(effect, frames, [&]<typename C>(const C& field, int index) {
+        clap_event ev{};
+        ev.type = CLAP_EVENT_PARAM_VALUE;
+        ev.time = std::max(time, 0);
+        ev.param_value.param_id = avnd::output_parameter_id_bit | index;
+        ev.param_value.key = -1;
+        ev.param_value.channel = -1;
+        ev.param_value.value = avnd::map_control_to_double(field);
+        out.push_back(&out, &ev);
+      });
+    }
+  }
+
+  // 64-bit buffers are requested by the audio ports when the processor supports them
+  using host_sample_type = std::conditional_t<avnd::double_processor<T>, double, float>;
+
+  // Processors supporting both precisions use the buffers the host gives
+  static bool host_uses_double(const clap_process& process) noexcept
+  {
+    if (process.audio_outputs_count > 0)
+      return process.audio_outputs[0].data64;
+    if (process.audio_inputs_count > 0)
+      return process.audio_inputs[0].data64;
+    return std::is_same_v<host_sample_type, double>;
+  }
+
+  void process_audio(const clap_process& process, int first, int frames)
+  {
+    int in_N = avnd::input_channels<T>(2);
+    int out_N = avnd::output_channels<T>(2);
+
+    auto process_float = [&] {
+      auto inputs = (float**)alloca(sizeof(float*) * in_N);
+      auto outputs = (float**)alloca(sizeof(float*) * out_N);
+
+      process_impl<&clap_audio_buffer::data32>(
+          process, inputs, in_N, outputs, out_N, first, frames);
+    };
+    auto process_double = [&] {
+      auto inputs = (double**)alloca(sizeof(double*) * in_N);
+      auto outputs = (double**)alloca(sizeof(double*) * out_N);
+
+      process_impl<&clap_audio_buffer::data64>(
+          process, inputs, in_N, outputs, out_N, first, frames);
+    };
+
+    if constexpr (avnd::float_processor<T> && avnd::double_processor<T>)
+    {
+      if (host_uses_double(process))
+        process_double();
+      else
+        process_float();
+    }
+    else if constexpr (avnd::float_processor<T>)
+    {
+      process_float();
+    }
+    else if constexpr (avnd::double_processor<T>)
+    {
+      process_double();
+    }
+  }
+
+  template <typename F>
+  static void for_each_channel(const clap_audio_buffer* buses, uint32_t count, F&& f)
+  {
+    for (uint32_t bus = 0; bus < count; bus++)
+    {
+      auto& b = buses[bus];
+      for (uint32_t c = 0; c < b.channel_count; c++)
+      {
+        if (b.data64)
+          f(b, c, b.data64[c]);
+        else if (b.data32)
+          f(b, c, b.data32[c]);
+      }
+    }
+  }
+
+  // The constant mask tells which channels are constant, with their first value
+  static bool inputs_silent(const clap_process& process) noexcept
+  {
+    bool silent = true;
+    for_each_channel(
+        process.audio_inputs, process.audio_inputs_count,
+        [&](const clap_audio_buffer& b, uint32_t c, const auto* samples) {
+          using mask_type = decltype(b.constant_mask);
+          const bool constant
+              = c < sizeof(mask_type) * 8 && (b.constant_mask & (mask_type(1) << c));
+          silent = silent
+                   && (constant ? samples[0] == 0
+                                : avnd::is_silent(samples, process.frames_count));
+        });
+    return silent;
+  }
+
+  static void clear_outputs(const clap_process& process) noexcept
+  {
+    for_each_channel(
+        process.audio_outputs, process.audio_outputs_count,
+        [&](const clap_audio_buffer&, uint32_t, auto* samples) {
+          std::fill_n(samples, process.frames_count, 0);
+        });
+  }
+
+  static void mark_silent_outputs(const clap_process& process) noexcept
+  {
+    for (uint32_t bus = 0; bus < process.audio_outputs_count; bus++)
+      process.audio_outputs[bus].constant_mask = 0;
+
+    for_each_channel(
+        process.audio_outputs, process.audio_outputs_count,
+        [&](const clap_audio_buffer& b, uint32_t c, const auto* samples) {
+          using mask_type = decltype(b.constant_mask);
+          if (c < sizeof(mask_type) * 8 && avnd::is_silent(samples, process.frames_count))
+            const_cast<clap_audio_buffer&>(b).constant_mask |= mask_type(1) << c;
+        });
+  }
+
+  clap_process_status process(const clap_process& process)
+  {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    [[maybe_unused]] avnd::deadline_scope deadline{deadlines, process.frames_count};
+    [[maybe_unused]] avnd::quality_scope<T> quality{governor, process.frames_count};
+    AVND_TRACE_ZONE(T, callback);
+
     // Clear the control out ports
     // FIXME
 
     // Clear the midi out ports
     midi.clear_outputs(this->effect);
 
+    // The render mode may change while active
+    render_request.apply(this->effect);
+    governor.set_render_mode(render_request.get());
+    governor.apply(this->effect);
+
     // Process the input events
     process_in_events(process);
+    midi.merge_inputs(this->effect);
+
+    // Skip the processing once the tail of the processor is over
+    if constexpr (avnd::has_tail<T>)
+      silence.advance(
+          !received_notes && inputs_silent(process),
+          process.frames_count,
+          avnd::tail_seconds(effect));
+    received_notes = false;
 
     // Process the audio
+    if (silence.asleep())
     {
-      int in_N = avnd::input_channels<T>(2);
-      int out_N = avnd::input_channels<T>(2);
-
-      if constexpr (avnd::float_processor<T>)
-      {
-        auto inputs = (float**)alloca(sizeof(float*) * in_N);
-        auto outputs = (float**)alloca(sizeof(float*) * out_N);
-
-        process_impl<&clap_audio_buffer::data32>(process, inputs, in_N, outputs, out_N);
-      }
-      else if constexpr (avnd::double_processor<T>)
-      {
-        auto inputs = (double**)alloca(sizeof(double*) * in_N);
-        auto outputs = (double**)alloca(sizeof(double*) * out_N);
-
-        process_impl<&clap_audio_buffer::data64>(process, inputs, in_N, outputs, out_N);
-      }
+      clear_outputs(process);
+    }
+    else if constexpr (avnd::splits_on_control_changes<T>)
+    {
+      param_changes.run(
+          process.frames_count,
+          [this](const param_change& c) { apply_param(c); },
+          [this, &process](int first, int frames) {
+            process_audio(process, first, frames);
+          });
+    }
+    else
+    {
+      process_audio(process, 0, process.frames_count);
     }
 
     // Process the output events
     process_out_events(process);
 
+    // Make sure the controls end up with their last value
+    param_changes.flush([this](const param_change& c) { apply_param(c); });
+    controls.sync(this->effect);
+
     // Clear the control in ports
-    // FIXME
+    control_buffers.clear_inputs(this->effect);
 
     // Clear the midi in ports
     midi.clear_inputs(this->effect);
+
+    mark_silent_outputs(process);
+    check_latency_and_tail();
+
+    if constexpr (avnd::has_tail<T>)
+    {
+      if (silence.asleep())
+        return CLAP_PROCESS_SLEEP;
+      if (silence.in_tail())
+        return CLAP_PROCESS_TAIL;
+    }
+    return CLAP_PROCESS_CONTINUE;
+  }
+
+  // In activate(), after prepare(): the only time the host accepts a new latency
+  void report_latency_and_tail()
+  {
+    if constexpr (avnd::dynamic_latency<T>)
+    {
+      const int64_t latency = avnd::latency_samples(effect);
+      if (latency != reported_latency && host_latency && host_latency->changed)
+        host_latency->changed(&host);
+      reported_latency = latency;
+      latency_status.store(latency_reported, std::memory_order_relaxed);
+    }
+    if constexpr (avnd::dynamic_tail<T>)
+      reported_tail = avnd::tail_seconds(effect);
+  }
+
+  // After each buffer, e.g. when a control changed the size of a look-ahead
+  void check_latency_and_tail()
+  {
+    if constexpr (avnd::dynamic_latency<T>)
+    {
+      int expected = latency_reported;
+      if (avnd::latency_samples(effect) != reported_latency
+          && latency_status.compare_exchange_strong(expected, latency_changed))
+        host.request_callback(&host);
+    }
+    if constexpr (avnd::dynamic_tail<T>)
+    {
+      // The tail may change while processing
+      if (const double tail = avnd::tail_seconds(effect); tail != reported_tail)
+      {
+        reported_tail = tail;
+        if (host_tail && host_tail->changed)
+          host_tail->changed(&host);
+      }
+    }
   }
 
-  void process_param(const clap_event_param_value& p)
+  void set_param(clap_id id, double value)
   {
     param_in_info::for_nth_mapped(
         this->effect.inputs(),
-        p.param_id,
-        [&]<typename C>(C& field)
-        { field.value = avnd::map_control_from_01<C>(p.value); });
+        param_index(id),
+        [&]<typename C>(C& field) { field.value = avnd::map_control_from_double<C>(value); });
+  }
+
+  // Returns parameter_count for unknown ids
+  static int param_index(clap_id id) noexcept { return param_ids::index(id); }
+
+  // The value of the control, between the bounds of the parameter
+  double modulated_value(int i) noexcept
+  {
+    double v = param_values[i] + param_modulations[i];
+    param_in_info::for_nth_mapped(
+        i, [&]<std::size_t Index, typename C>(avnd::field_reflection<Index, C>) {
+          if constexpr (avnd::has_range<C> && !avnd::enum_parameter<C>)
+          {
+            constexpr auto range = avnd::get_range<C>();
+            const double a = avnd::map_control_to_double<C>(range.min);
+            const double b = avnd::map_control_to_double<C>(range.max);
+            v = std::clamp(v, std::min(a, b), std::max(a, b));
+          }
+        });
+    return v;
+  }
+
+  // Returns the parameter index, or parameter_count for unknown ids
+  int store_param(const param_change& c) noexcept
+  {
+    const int i = param_index(c.id);
+    if (i < parameter_count)
+      (c.modulation ? param_modulations[i] : param_values[i]) = c.value;
+    return i;
+  }
+
+  template <typename C>
+  static auto control_value(double base, double modulated)
+  {
+    if constexpr (avnd::modulated_parameter<C> || avnd::modulatable_parameter<C>)
+      return avnd::map_control_from_double<C>(base);
+    else
+      return avnd::map_control_from_double<C>(modulated);
+  }
+
+  // Only the control which changed gets its value combined with its modulation
+  void commit_param(int i)
+  {
+    const double base = param_values[i];
+    const double v = modulated_value(i);
+    controls.write(this->effect, i, [&]<typename C>(C& field) {
+      field.value = control_value<C>(base, v);
+      if constexpr (avnd::modulated_parameter<C>)
+        field.modulation = avnd::map_control_from_double<C>(v) - field.value;
+    });
+  }
+
+  // The modulatable controls keep the value set by the host,
+  // and get their modulation through the modulation storage
+  void modulate(int frames)
+  {
+    for (int i : modulation.parameters)
+      if (param_modulations[i] != 0.)
+        modulation.offset(i, param_modulations[i], frames);
+    modulation.update(effect, frames);
+  }
+
+  void apply_param(const param_change& c)
+  {
+    if (const int i = store_param(c); i < parameter_count)
+      commit_param(i);
+  }
+
+  void process_param(const param_change& c, int frame)
+  {
+    if constexpr (avnd::splits_on_control_changes<T>)
+    {
+      // Applied while processing the audio
+      param_changes.push(frame, c);
+    }
+    else
+    {
+      const int i = store_param(c);
+      if (i >= parameter_count)
+        return;
+
+      // Sample-accurate inputs get every change
+      bool timed = false;
+      if constexpr (avnd::control_storage<T>::has_timed_inputs)
+      {
+        const double base = param_values[i];
+        const double v = modulated_value(i);
+        timed = control_buffers.push_input(
+            this->effect, param_in_info::index_map[i], frame, [&]<typename C>(C&) {
+              return control_value<C>(base, v);
+            });
+      }
+
+      // value is the one at the beginning of the buffer for sample-accurate inputs
+      if (!timed || frame <= 0)
+        commit_param(i);
+      if (timed)
+        param_changes.push(0, c);
+    }
   }
 
   void process_transport(const clap_event_transport& transport)
@@ -305,81 +910,192 @@ struct SimpleAudioEffect : clap_plugin
     // TODO
   }
 
-  void process_in_events(const clap_process& p)
+  void process_event(const clap_event& ev)
   {
-    if constexpr (midi_in_info::size > 0)
+    switch (ev.type)
     {
-      auto N = p.in_events->size(p.in_events);
+      case CLAP_EVENT_NOTE_ON:
+      case CLAP_EVENT_NOTE_OFF:
+      {
+        received_notes = true;
+        if constexpr (midi_in_info::size > 0)
+          midi_in_info::for_nth_mapped(
+              this->effect.inputs(),
+              ev.note.port_index,
+              [&]<typename C>(C& in_port) { midi.add_message(in_port, ev); });
+        break;
+      }
+      case CLAP_EVENT_MIDI:
+      {
+        received_notes = true;
+        if constexpr (midi_in_info::size > 0)
+          midi_in_info::for_nth_mapped(
+              this->effect.inputs(),
+              ev.midi.port_index,
+              [&]<typename C>(C& in_port) { midi.add_message(in_port, ev); });
+        break;
+      }
+      case CLAP_EVENT_MIDI_SYSEX:
+      {
+        received_notes = true;
+        if constexpr (midi_in_info::size > 0)
+          midi_in_info::for_nth_mapped(
+              this->effect.inputs(),
+              ev.midi_sysex.port_index,
+              [&]<typename C>(C& in_port) { midi.add_message(in_port, ev); });
+        break;
+      }
 
-      for (uint32_t i = 0; i < N; i++)
+      case CLAP_EVENT_PARAM_VALUE:
+      {
+        if (ev.param_value.param_id == avnd::bypass_parameter_id)
+          processor.set_bypass(ev.param_value.value >= 0.5);
+        else if constexpr (parameter_count > 0)
+          process_param({ev.param_value.param_id, ev.param_value.value, false}, ev.time);
+        break;
+      }
+      case CLAP_EVENT_PARAM_MOD:
       {
-        auto ev = p.in_events->get(p.in_events, i);
+        // Per-note modulations are for voices, which we do not expose: only the
+        // global ones are applied.
+        if constexpr (parameter_count > 0)
+          if (ev.param_mod.key < 0 && ev.param_mod.channel < 0)
+            process_param({ev.param_mod.param_id, ev.param_mod.amount, true}, ev.time);
+        break;
+      }
+      case CLAP_EVENT_TRANSPORT:
+      {
+        process_transport(ev.time_info);
+        break;
+      }
+      case CLAP_EVENT_NOTE_EXPRESSION:
+      {
+        if constexpr (midi_in_info::size > 0)
+          midi_in_info::for_nth_mapped(
+              this->effect.inputs(),
+              ev.note_expression.port_index,
+              [&]<typename C>(C& in_port) { midi.add_expression(in_port, ev.note_expression); });
+        break;
+      }
+      case CLAP_EVENT_NOTE_CHOKE:
+      case CLAP_EVENT_NOTE_MASK:
+      default:
+        // TODO
+        break;
+    }
+  }
 
-        switch (ev->type)
-        {
-          case CLAP_EVENT_NOTE_ON:
-          case CLAP_EVENT_NOTE_OFF:
-          {
-            midi_in_info::for_nth_mapped(
-                this->effect.inputs(),
-                ev->note.port_index,
-                [&]<typename C>(C& in_port) { midi.add_message(in_port, *ev); });
-            break;
-          }
-          case CLAP_EVENT_MIDI:
-          {
-            midi_in_info::for_nth_mapped(
-                this->effect.inputs(),
-                ev->midi.port_index,
-                [&]<typename C>(C& in_port) { midi.add_message(in_port, *ev); });
-            break;
-          }
-          case CLAP_EVENT_MIDI_SYSEX:
-          {
-            midi_in_info::for_nth_mapped(
-                this->effect.inputs(),
-                ev->midi_sysex.port_index,
-                [&]<typename C>(C& in_port) { midi.add_message(in_port, *ev); });
-            break;
-          }
+  // All the events go through a single pass by time: the parameter changes
+  // end up in the sub-blocks, or the timed storage, in the same order as the notes.
+  void process_in_events(const clap_process& p)
+  {
+    AVND_TRACE_ZONE(T, events);
+    avnd_clap::for_each_event_in_order(
+        *p.in_events, sorted_events, this, [](void* self, const clap_event& ev) {
+          static_cast<SimpleAudioEffect*>(self)->process_event(ev);
+        });
+  }
 
-          case CLAP_EVENT_PARAM_VALUE:
-          {
-            process_param(ev->param_value);
-            break;
-          }
-          break;
-          case CLAP_EVENT_PARAM_MOD:
-            break;
-          case CLAP_EVENT_TRANSPORT:
-          {
-            process_transport(ev->time_info);
-            break;
-          }
-          case CLAP_EVENT_NOTE_CHOKE:
-          case CLAP_EVENT_NOTE_EXPRESSION:
-          case CLAP_EVENT_NOTE_MASK:
-          default:
-            // TODO
-            break;
+  void process_out_events(const clap_process& p)
+  {
+    // The output parameters and MIDI messages are sent after each processed sub-block
+  }
+
+  // The parameter changes the host sends while the audio does not run, e.g. to an
+  // instance it keeps asleep: they go straight to the controls, as there is no buffer
+  // to place them in. The host never calls this while process() runs, so the controls
+  // are only ever written by one thread at a time.
+  void flush_params(const clap_event_list* in, const clap_event_list* out)
+  {
+    if (in)
+    {
+      const uint32_t N = in->size(in);
+      for (uint32_t i = 0; i < N; i++)
+      {
+        const clap_event& ev = *in->get(in, i);
+        if (ev.type == CLAP_EVENT_PARAM_VALUE)
+        {
+          if (ev.param_value.param_id == avnd::bypass_parameter_id)
+            processor.set_bypass(ev.param_value.value >= 0.5);
+          else if constexpr (parameter_count > 0)
+            apply_param({ev.param_value.param_id, ev.param_value.value, false});
+        }
+        else if (ev.type == CLAP_EVENT_PARAM_MOD)
+        {
+          if constexpr (parameter_count > 0)
+            if (ev.param_mod.key < 0 && ev.param_mod.channel < 0)
+              apply_param({ev.param_mod.param_id, ev.param_mod.amount, true});
         }
       }
+      controls.sync(this->effect);
     }
+
+    // The outputs which were not reported yet, e.g. the ones of the last buffer
+    // before the host stopped processing
+    if (out)
+      report_out_params(*out, 0, 0);
   }
 
-  void process_out_events(const clap_process& p)
+  // Output parameters come after the inputs, and are read-only
+  bool get_output_param_info(int32_t param_index, clap_param_info* info)
+  {
+    if (param_index < 0 || param_index >= param_out_info::size)
+      return false;
+
+    const int field = param_out_info::index_map[param_index];
+    info->id = avnd::output_parameter_id_bit | field;
+    info->flags = CLAP_PARAM_IS_READONLY;
+    info->min_value = 0.;
+    info->max_value = 1.;
+    info->default_value = 0.;
+    param_out_info::for_nth_raw(
+        field,
+        [&]<std::size_t Index, typename C>(avnd::field_reflection<Index, C> field)
+        {
+          if constexpr (avnd::has_range<C> && !avnd::enum_parameter<C>)
+          {
+            constexpr auto range = avnd::get_range<C>();
+            if constexpr (requires { range.min; range.max; })
+            {
+              info->min_value = avnd::map_control_to_double<C>(range.min);
+              info->max_value = avnd::map_control_to_double<C>(range.max);
+            }
+            if constexpr (requires { range.init; })
+              info->default_value = avnd::map_control_to_double<C>(range.init);
+          }
+          copy_string(info->name, C::name());
+          copy_string(info->module, "");
+        });
+    return true;
+  }
+
+  // The bypass of the host comes last, see avnd::bypass_adapter
+  static constexpr int32_t bypass_param_index = param_in_info::size + param_out_info::size;
+
+  bool get_bypass_param_info(clap_param_info* info)
   {
-    // TODO module
+    info->id = avnd::bypass_parameter_id;
+    info->flags = CLAP_PARAM_IS_BYPASS | CLAP_PARAM_IS_STEPPED | CLAP_PARAM_IS_AUTOMATABLE;
+    info->min_value = 0.;
+    info->max_value = 1.;
+    info->default_value = 0.;
+    copy_string(info->name, "Bypass");
+    copy_string(info->module, "");
+    return true;
   }
 
   bool get_param_info(int32_t param_index, clap_param_info* info)
   {
-    if (param_index < 0 || param_index >= param_in_info::size)
+    if (param_index == bypass_param_index)
+      return get_bypass_param_info(info);
+    if (param_index >= param_in_info::size)
+      return get_output_param_info(param_index - param_in_info::size, info);
+    if (param_index < 0)
       return false;
 
-    info->id = param_in_info::index_map[param_index];
-    param_in_info::for_nth_raw(
-        info->id,
+    info->id = param_ids::id(param_index);
+    param_in_info::for_nth_mapped(
+        param_index,
         [&]<std::size_t Index, typename C>(avnd::field_reflection<Index, C> field)
         {
           if constexpr (avnd::has_range<C>)
@@ -398,6 +1114,7 @@ struct SimpleAudioEffect : clap_plugin
             {
               info->min_value = avnd::map_control_to_double<C>(range.min);
               info->max_value = avnd::map_control_to_double<C>(range.max);
+              info->flags |= CLAP_PARAM_IS_MODULATABLE;
               if constexpr (requires { range.step; })
                 info->flags |= CLAP_PARAM_IS_STEPPED;
             }
@@ -411,23 +1128,60 @@ struct SimpleAudioEffect : clap_plugin
 
   bool get_param_value(clap_id param_id, double* value)
   {
-    param_in_info::for_nth_raw(
+    if (param_id == avnd::bypass_parameter_id)
+    {
+      *value = processor.bypass() ? 1. : 0.;
+      return true;
+    }
+
+    if (param_id & avnd::output_parameter_id_bit)
+    {
+      param_out_info::for_nth_raw(
+          this->effect.outputs(),
+          param_id & ~avnd::output_parameter_id_bit,
+          [&]<typename C>(const C& field) { *value = avnd::map_control_to_double(field); });
+      return true;
+    }
+
+    const int i = param_index(param_id);
+    param_in_info::for_nth_mapped(
         this->effect.inputs(),
-        param_id,
+        i,
         [&]<typename C>(const C& field)
         { *value = avnd::map_control_to_double(field); });
 
+    // The value set by the host, without the modulation
+    if (i < parameter_count)
+      *value = param_values[i];
     return true;
   }
 
   bool get_value_text(clap_id param_id, double value, char* display, uint32_t size)
   {
+    if (param_id == avnd::bypass_parameter_id)
+    {
+      return std::snprintf(display, size, "%s", value >= 0.5 ? "On" : "Off") > 0;
+    }
+
     bool ok = false;
-    param_in_info::for_nth_raw(
-        param_id, [&]<auto Idx, typename C>(avnd::field_reflection<Idx, C> tag) {
+    if (param_id & avnd::output_parameter_id_bit)
+    {
+      param_out_info::for_nth_raw(
+          param_id & ~avnd::output_parameter_id_bit,
+          [&]<auto Idx, typename C>(avnd::field_reflection<Idx, C> tag) {
+            ok = value_texts.template display<C>(
+                param_in_info::size + param_out_info::template unmap<Idx>(), value,
+                avnd::map_control_from_double<C>(value), display, size);
+          });
+      return ok;
+    }
+
+    param_in_info::for_nth_mapped(
+        param_index(param_id), [&]<auto Idx, typename C>(avnd::field_reflection<Idx, C> tag) {
           if (!ok)
           {
-            ok = avnd::display_control<C>(
+            ok = value_texts.template display<C>(
+                param_in_info::template unmap<Idx>(), value,
                 avnd::map_control_from_double<C>(value), display, size);
           }
         });
@@ -435,6 +1189,43 @@ struct SimpleAudioEffect : clap_plugin
     return ok;
   }
 
+  // The values of the parameters as seen by the host come from the controls
+  void read_param_values()
+  {
+    for (int i = 0; i < parameter_count; i++)
+      param_in_info::for_nth_mapped(
+          this->effect.inputs(), i, [&]<typename C>(const C& field) {
+            param_values[i] = avnd::map_control_to_double(field);
+          });
+  }
+
+  bool save_state(const clap_ostream& stream)
+  {
+    if constexpr (avnd::has_inputs<T>)
+    {
+      avnd::save_state<T>(this->effect.inputs(), state_buffer);
+      return avnd_clap::write_stream(stream, state_buffer.data(), state_buffer.size());
+    }
+    return true;
+  }
+
+  bool load_state(const clap_istream& stream)
+  {
+    if constexpr (avnd::has_inputs<T>)
+    {
+      if (!avnd_clap::read_stream(stream, state_buffer))
+        return false;
+
+      if (!avnd::load_state<T>(
+              this->effect.inputs(), state_buffer.data(), state_buffer.size()))
+        return false;
+
+      read_param_values();
+      param_modulations = {};
+    }
+    return true;
+  }
+
   static auto self(const clap_plugin* plugin) noexcept
   {
     return reinterpret_cast<SimpleAudioEffect*>(plugin->plugin_data);
@@ -463,7 +1254,8 @@ struct SimpleAudioEffect : clap_plugin
                             : CLAP_PLUGIN_EVENT_EFFECT)};
 
   static constexpr clap_plugin_params params{
-      .count = [](const clap_plugin* plugin) -> uint32_t { return param_in_info::size; },
+      .count = [](const clap_plugin* plugin) -> uint32_t
+      { return bypass_param_index + 1; },
 
       .get_info = [](const clap_plugin* plugin,
                      int32_t param_index,
@@ -487,7 +1279,8 @@ struct SimpleAudioEffect : clap_plugin
 
       .flush = [](const clap_plugin* plugin,
                   const clap_event_list* input_parameter_changes,
-                  const clap_event_list* output_parameter_changes) -> void {}};
+                  const clap_event_list* output_parameter_changes) -> void
+      { self(plugin)->flush_params(input_parameter_changes, output_parameter_changes); }};
 
   static constexpr clap_plugin_audio_ports audio_ports{
       .count = [](const clap_plugin* plugin, bool input) -> uint32_t
@@ -528,5 +1321,38 @@ struct SimpleAudioEffect : clap_plugin
         else
           return avnd_clap::event_bus_info<T>::output_info(index, *info);
       }};
+
+  static constexpr clap_plugin_tail tail{
+      .get = [](const clap_plugin* plugin) -> uint32_t
+      {
+        auto& p = *self(plugin);
+        const double frames = avnd::tail_seconds(p.effect) * p.sample_rate;
+        return frames < double(UINT32_MAX) ? uint32_t(std::ceil(frames)) : UINT32_MAX;
+      }};
+
+  static constexpr clap_plugin_latency latency{
+      .get = [](const clap_plugin* plugin) -> uint32_t {
+        return uint32_t(std::max(avnd::latency_samples(self(plugin)->effect), int64_t(0)));
+      }};
+
+  static constexpr clap_plugin_state state{
+      .save = [](const clap_plugin* plugin, const clap_ostream* stream) -> bool
+      { return self(plugin)->save_state(*stream); },
+      .load = [](const clap_plugin* plugin, const clap_istream* stream) -> bool
+      { return self(plugin)->load_state(*stream); }};
+
+  static constexpr clap_plugin_render render{
+      .has_hard_realtime_requirement = [](const clap_plugin* plugin) -> bool { return false; },
+      .set = [](const clap_plugin* plugin, clap_plugin_render_mode mode) -> bool
+      {
+        self(plugin)->render_request.set(
+            mode == CLAP_RENDER_OFFLINE ? avnd::render_mode::offline
+                                        : avnd::render_mode::realtime);
+        return true;
+      }};
+
+  static constexpr clap_plugin_thread_pool thread_pool{
+      .exec = [](const clap_plugin* plugin, uint32_t task_index) -> void
+      { self(plugin)->tasks.exec(task_index); }};
 };
 }
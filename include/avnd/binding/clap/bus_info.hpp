@@ -3,6 +3,7 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <avnd/binding/clap/helpers.hpp>
+#include <avnd/concepts/processor.hpp>
 #include <avnd/introspection/channels.hpp>
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/output.hpp>
@@ -10,6 +11,14 @@
 
 namespace avnd_clap
 {
+// Hosts give the buffers in the precision of the audio ports: 64 bits
+// when the processor supports it, so that no conversion is needed.
+template <typename T>
+constexpr uint32_t sample_size() noexcept
+{
+  return avnd::double_processor<T> ? 64 : 32;
+}
+
 template <typename T>
 struct event_bus_info
 {
@@ -107,7 +116,7 @@ struct audio_bus_info<T>
 
       info.channel_count = default_input_channel_count();
       info.channel_map = {};
-      info.sample_size = avnd::polyphonic_arg_audio_effect<double, T> ? 64 : 32;
+      info.sample_size = sample_size<T>();
       info.is_main = true;
       info.is_cv = false;
       info.in_place = true;
@@ -130,7 +139,7 @@ struct audio_bus_info<T>
 
       info.channel_count = default_output_channel_count();
       info.channel_map = {};
-      info.sample_size = avnd::polyphonic_arg_audio_effect<double, T> ? 64 : 32;
+      info.sample_size = sample_size<T>();
       info.is_main = true;
       info.is_cv = false;
       info.in_place = true;
@@ -162,7 +171,7 @@ struct audio_bus_info<T>
 
       info.channel_count = default_input_channel_count();
       info.channel_map = CLAP_CHMAP_MONO;
-      info.sample_size = avnd::mono_per_sample_arg_processor<double, T> ? 64 : 32;
+      info.sample_size = sample_size<T>();
       info.is_main = true;
       info.is_cv = false;
       info.in_place = true;
@@ -182,7 +191,7 @@ struct audio_bus_info<T>
 
       info.channel_count = default_output_channel_count();
       info.channel_map = CLAP_CHMAP_MONO;
-      info.sample_size = avnd::mono_per_sample_arg_processor<double, T> ? 64 : 32;
+      info.sample_size = sample_size<T>();
       info.is_main = true;
       info.is_cv = false;
       info.in_place = true;
@@ -214,7 +223,7 @@ struct audio_bus_info<T>
 
       info.channel_count = default_input_channel_count();
       info.channel_map = CLAP_CHMAP_MONO;
-      info.sample_size = avnd::monophonic_arg_audio_effect<double, T> ? 64 : 32;
+      info.sample_size = sample_size<T>();
       info.is_main = true;
       info.is_cv = false;
       info.in_place = true;
@@ -234,7 +243,7 @@ struct audio_bus_info<T>
 
       info.channel_count = default_output_channel_count();
       info.channel_map = CLAP_CHMAP_MONO;
-      info.sample_size = avnd::monophonic_arg_audio_effect<double, T> ? 64 : 32;
+      info.sample_size = sample_size<T>();
       info.is_main = true;
       info.is_cv = false;
       info.in_place = true;
@@ -275,7 +284,7 @@ struct audio_bus_info<T>
           [&]<std::size_t I, typename C>(const avnd::field_reflection<I, C>& port)
           {
             copy_string(info.name, C::name());
-            info.sample_size = avnd::poly_array_sample_port<double, C> ? 64 : 32;
+            info.sample_size = sample_size<T>();
           });
 
       info.channel_count = default_input_channel_count();
@@ -300,7 +309,7 @@ struct audio_bus_info<T>
           [&]<std::size_t I, typename C>(const avnd::field_reflection<I, C>& port)
           {
             copy_string(info.name, C::name());
-            info.sample_size = avnd::poly_array_sample_port<double, C> ? 64 : 32;
+            info.sample_size = sample_size<T>();
           });
 
       info.channel_count = default_output_channel_count();
@@ -339,7 +348,7 @@ struct audio_bus_info<T>
           [&]<std::size_t I, typename C>(const avnd::field_reflection<I, C>& port)
           {
             copy_string(info.name, C::name());
-            info.sample_size = avnd::audio_sample_port<double, C> ? 64 : 32;
+            info.sample_size = sample_size<T>();
           });
 
       info.channel_count = 1;
@@ -364,7 +373,7 @@ struct audio_bus_info<T>
           [&]<std::size_t I, typename C>(const avnd::field_reflection<I, C>& port)
           {
             copy_string(info.name, C::name());
-            info.sample_size = avnd::audio_sample_port<double, C> ? 64 : 32;
+            info.sample_size = sample_size<T>();
           });
 
       info.channel_count = 1;
@@ -402,7 +411,7 @@ struct audio_bus_info<T>
           [&]<std::size_t I, typename C>(const avnd::field_reflection<I, C>& port)
           {
             copy_string(info.name, C::name());
-            info.sample_size = avnd::mono_array_sample_port<double, C> ? 64 : 32;
+            info.sample_size = sample_size<T>();
           });
 
       info.channel_count = 1;
@@ -427,7 +436,7 @@ struct audio_bus_info<T>
           [&]<std::size_t I, typename C>(const avnd::field_reflection<I, C>& port)
           {
             copy_string(info.name, C::name());
-            info.sample_size = avnd::mono_array_sample_port<double, C> ? 64 : 32;
+            info.sample_size = sample_size<T>();
           });
 
       info.channel_count = 1;
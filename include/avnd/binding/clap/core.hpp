@@ -0,0 +1,105 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <clap/all.h>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * The parts of the binding which do not depend on the processor: they are
+ * compiled once per module instead of once per SimpleAudioEffect<T>.
+ */
+namespace avnd_clap
+{
+// Out-of-order events which are sorted in the scratch space reserved at activate
+inline constexpr uint32_t max_sorted_events = 1024;
+
+// Calls f(ctx, ev) for each event, by time: hosts are supposed to give the
+// events in order but not all of them do, thus sorted is used as scratch space.
+// It never grows past the capacity reserved at activate, so that nothing allocates
+// in process(): longer lists are walked by time in place instead, in O(N^2).
+inline void for_each_event_in_order(
+    const clap_event_list& in, std::vector<const clap_event*>& sorted, void* ctx,
+    void (*f)(void* ctx, const clap_event& ev))
+{
+  const uint32_t N = in.size(&in);
+
+  bool in_order = true;
+  for (uint32_t i = 1; i < N && in_order; i++)
+    in_order = in.get(&in, i - 1)->time <= in.get(&in, i)->time;
+
+  if (in_order)
+  {
+    for (uint32_t i = 0; i < N; i++)
+      f(ctx, *in.get(&in, i));
+    return;
+  }
+
+  if (N <= sorted.capacity())
+  {
+    // Insertion sort: stable, and fast on the mostly sorted lists we get
+    sorted.clear();
+    for (uint32_t i = 0; i < N; i++)
+    {
+      auto ev = in.get(&in, i);
+      auto it = sorted.end();
+      while (it != sorted.begin() && (*(it - 1))->time > ev->time)
+        --it;
+      sorted.insert(it, ev);
+    }
+
+    for (auto ev : sorted)
+      f(ctx, *ev);
+    return;
+  }
+
+  // Each step takes the first event after the previous one, by time then by index
+  uint64_t previous = 0;
+  for (uint32_t k = 0; k < N; k++)
+  {
+    uint64_t next = UINT64_MAX;
+    for (uint32_t i = 0; i < N; i++)
+    {
+      const uint64_t key = (uint64_t(in.get(&in, i)->time) << 32) | i;
+      if ((k == 0 || key > previous) && key < next)
+        next = key;
+    }
+    previous = next;
+    f(ctx, *in.get(&in, uint32_t(next & 0xFFFFFFFF)));
+  }
+}
+
+// The host may accept the data in several parts
+inline bool write_stream(const clap_ostream& stream, const char* data, int64_t size)
+{
+  while (size > 0)
+  {
+    const int64_t written = stream.write(&stream, data, size);
+    if (written <= 0)
+      return false;
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+// Reads the whole stream in buffer
+inline bool read_stream(const clap_istream& stream, std::vector<char>& buffer)
+{
+  constexpr int64_t chunk = 65536;
+  buffer.clear();
+  for (;;)
+  {
+    const auto size = buffer.size();
+    buffer.resize(size + chunk);
+    const int64_t read = stream.read(&stream, buffer.data() + size, chunk);
+    if (read < 0)
+      return false;
+    buffer.resize(size + read);
+    if (read == 0)
+      return true;
+  }
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/wrappers/thread_pool.hpp>
+#include <clap/all.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace avnd_clap
+{
+/**
+ * Runs the tasks of the plugin on the worker threads of the host,
+ * through the clap.thread-pool extension: request_exec() makes the host call
+ * clap_plugin_thread_pool::exec once per task, and returns when they are all done.
+ *
+ * execute() fails when the host does not provide the extension or refuses
+ * the request, the tasks are then run serially by the caller.
+ */
+class host_thread_pool final : public avnd::task_executor
+{
+public:
+  // Extensions can be queried from clap_plugin::init onwards
+  void init(const clap_host& host) noexcept
+  {
+    m_host = &host;
+    m_ext = static_cast<const clap_host_thread_pool*>(
+        host.get_extension(&host, CLAP_EXT_THREAD_POOL));
+  }
+
+  // The host does not tell how many threads it has
+  int size() const noexcept override
+  {
+    return m_ext ? std::max(int(std::thread::hardware_concurrency()) - 1, 0) : 0;
+  }
+
+  bool execute(int tasks, void (*call)(void*, int), void* context) noexcept override
+  {
+    if (!m_ext || !m_ext->request_exec)
+      return false;
+
+    m_call = call;
+    m_context = context;
+    return m_ext->request_exec(m_host, uint32_t(tasks));
+  }
+
+  // Called by the host threads
+  void exec(uint32_t task) const noexcept { m_call(m_context, int(task)); }
+
+private:
+  const clap_host* m_host{};
+  const clap_host_thread_pool* m_ext{};
+
+  void (*m_call)(void*, int){};
+  void* m_context{};
+};
+}
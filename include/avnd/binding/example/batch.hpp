@@ -0,0 +1,439 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/example/example_processor.hpp>
+#include <avnd/binding/example/profiler.hpp>
+#include <avnd/wrappers/soundfile_recorder.hpp>
+#include <avnd/wrappers/soundfile_stream.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Batch mode of the example host: renders a processor over many combinations
+ * of its parameters, e.g. for tuning it or for regression tests:
+ *
+ * ./example/Foo_example_host --batch --grid=Gain:0:1:11 --grid=Drive:1:10:4 --input=in.wav
+ *
+ * The options:
+ *  --grid=Name:min:max:steps  values of a parameter, repeated for each one:
+ *                             every combination of them is rendered
+ *  --random=N                 N combinations drawn uniformly between min and max instead
+ *  --seed=1                   of the random combinations
+ *  --input=file.wav           the input of every run, else --signal
+ *  --signal=sweep             noise, sweep or impulse, see profiler.hpp
+ *  --duration=2               seconds rendered without input file
+ *  --block-size=512 --rate=48000 --channels=2
+ *  --threads=N                all the cores by default
+ *  --audio=directory          also writes the output of each run to directory/run_N.wav
+ *  --output=file.csv          stdout otherwise
+ *
+ * Each thread has its own processor, constructed anew for each run so that
+ * no state is carried from a run to the next, and the results are written in
+ * the order of the combinations: they are the same whatever the threads.
+ * For each run, the output gets its RMS, its peak, and a hash of its samples.
+ */
+namespace exhs
+{
+struct batch_parameter
+{
+  std::string name;
+  double min{};
+  double max{};
+  int steps{1};
+};
+
+struct batch_options
+{
+  std::vector<batch_parameter> parameters;
+  int random{};
+  uint64_t seed{1};
+  std::string_view input{};
+  test_signal signal{test_signal::sweep};
+  double duration{2.};
+  int block_size{512};
+  double rate{48000.};
+  int channels{2};
+  int threads{};
+  std::string_view audio{};
+  std::string_view output{};
+};
+
+struct batch_result
+{
+  double rms{};
+  double peak{};
+  uint64_t hash{};
+};
+
+inline bool wants_batch(int argc, char** argv)
+{
+  for (int i = 1; i < argc; i++)
+    if (std::string_view{argv[i]} == "--batch")
+      return true;
+  return false;
+}
+
+inline std::optional<batch_options> parse_batch_options(int argc, char** argv)
+{
+  batch_options opts;
+
+  auto to_number = [](std::string_view s, auto& res) {
+    return std::from_chars(s.data(), s.data() + s.size(), res).ec == std::errc{};
+  };
+  auto to_parameter = [&](std::string_view s) {
+    // Name:min:max:steps, the name may not have colons
+    batch_parameter p;
+    std::string_view f[4];
+    for (int k = 0; k < 4; k++)
+    {
+      const std::size_t colon = std::min(s.find(':'), s.size());
+      f[k] = s.substr(0, colon);
+      s = colon < s.size() ? s.substr(colon + 1) : std::string_view{};
+    }
+    p.name = f[0];
+    if (p.name.empty() || !to_number(f[1], p.min) || !to_number(f[2], p.max))
+      return false;
+    if (!f[3].empty() && (!to_number(f[3], p.steps) || p.steps <= 0))
+      return false;
+    opts.parameters.push_back(std::move(p));
+    return true;
+  };
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string_view arg = argv[i];
+    const std::size_t eq = arg.find('=');
+    const auto key = arg.substr(0, eq);
+    const auto value = eq == std::string_view::npos ? std::string_view{} : arg.substr(eq + 1);
+
+    bool ok = true;
+    if (key == "--batch")
+      ;
+    else if (key == "--grid")
+      ok = to_parameter(value);
+    else if (key == "--random")
+      ok = to_number(value, opts.random) && opts.random > 0;
+    else if (key == "--seed")
+      ok = to_number(value, opts.seed);
+    else if (key == "--input" && !value.empty())
+      opts.input = value;
+    else if (key == "--signal")
+    {
+      auto it = std::find(std::begin(test_signal_names), std::end(test_signal_names), value);
+      ok = it != std::end(test_signal_names);
+      if (ok)
+        opts.signal = test_signal(it - std::begin(test_signal_names));
+    }
+    else if (key == "--duration")
+      ok = to_number(value, opts.duration) && opts.duration > 0.;
+    else if (key == "--block-size")
+      ok = to_number(value, opts.block_size) && opts.block_size > 0;
+    else if (key == "--rate")
+      ok = to_number(value, opts.rate) && opts.rate > 0.;
+    else if (key == "--channels")
+      ok = to_number(value, opts.channels) && opts.channels > 0;
+    else if (key == "--threads")
+      ok = to_number(value, opts.threads) && opts.threads > 0;
+    else if (key == "--audio" && !value.empty())
+      opts.audio = value;
+    else if (key == "--output" && !value.empty())
+      opts.output = value;
+    else
+      ok = false;
+
+    if (!ok)
+    {
+      logger.error("Unknown or invalid batch option: {}", arg);
+      return std::nullopt;
+    }
+  }
+  return opts;
+}
+
+// The values of the parameters for each run, in the order of the options
+inline std::vector<std::vector<double>> batch_combinations(const batch_options& opts)
+{
+  std::vector<std::vector<double>> res;
+  const std::size_t n = opts.parameters.size();
+  if (opts.random > 0)
+  {
+    // xorshift64*: the same combinations on every platform
+    uint64_t x = opts.seed ? opts.seed : 1;
+    auto next = [&x] {
+      x ^= x >> 12;
+      x ^= x << 25;
+      x ^= x >> 27;
+      return double((x * 0x2545F4914F6CDD1DULL) >> 11) * 0x1.0p-53;
+    };
+    for (int r = 0; r < opts.random; r++)
+    {
+      auto& values = res.emplace_back(n);
+      for (std::size_t k = 0; k < n; k++)
+      {
+        const auto& p = opts.parameters[k];
+        values[k] = p.min + next() * (p.max - p.min);
+      }
+    }
+    return res;
+  }
+
+  // Every combination, the last parameter changing first
+  std::vector<int> step(n);
+  for (;;)
+  {
+    auto& values = res.emplace_back(n);
+    for (std::size_t k = 0; k < n; k++)
+    {
+      const auto& p = opts.parameters[k];
+      values[k] = p.steps > 1 ? p.min + (p.max - p.min) * step[k] / (p.steps - 1) : p.min;
+    }
+
+    std::size_t k = n;
+    while (k > 0 && ++step[k - 1] == opts.parameters[k - 1].steps)
+      step[--k] = 0;
+    if (k == 0)
+      return res;
+  }
+}
+
+// The index of the parameter input named so, -1 if there is none
+template <typename T>
+int batch_parameter_index(std::string_view name)
+{
+  using info = avnd::parameter_input_introspection<T>;
+  int res = -1;
+  if constexpr (info::size > 0)
+  {
+    info::for_all([&]<auto Idx, typename M>(avnd::field_reflection<Idx, M>) {
+      if (res < 0 && avnd::get_name<M>() == name)
+        res = info::template unmap<Idx>();
+    });
+  }
+  return res;
+}
+
+template <typename T>
+void set_batch_parameter(avnd::effect_container<T>& effect, int index, double value)
+{
+  using info = avnd::parameter_input_introspection<T>;
+  if constexpr (info::size > 0)
+  {
+    info::for_all_n(
+        effect.inputs(), [&]<auto Idx, typename M>(M& field, avnd::predicate_index<Idx>) {
+          if (int(Idx) != index)
+            return;
+          using value_type = std::remove_cvref_t<decltype(field.value)>;
+          if constexpr (std::is_same_v<value_type, bool>)
+            field.value = value >= 0.5;
+          else if constexpr (std::is_integral_v<value_type> || std::is_enum_v<value_type>)
+            field.value = value_type(std::llround(value));
+          else if constexpr (std::is_arithmetic_v<value_type>)
+            field.value = value_type(value);
+        });
+  }
+}
+
+// The input of the runs, planar
+struct batch_input
+{
+  std::vector<std::vector<float>> channels;
+  int64_t frames{};
+  double rate{};
+};
+
+inline std::optional<batch_input> load_batch_input(const batch_options& opts)
+{
+  batch_input in;
+  if (!opts.input.empty())
+  {
+    auto file = avnd::wav_soundfile_source::open_wav(std::string(opts.input));
+    if (!file || file->channels() <= 0)
+    {
+      logger.error("Cannot read the input file {}", opts.input);
+      return std::nullopt;
+    }
+    in.frames = file->frames();
+    in.rate = file->sample_rate();
+    in.channels.assign(file->channels(), std::vector<float>(in.frames));
+    std::vector<float*> ptrs;
+    for (auto& c : in.channels)
+      ptrs.push_back(c.data());
+    file->read(0, in.frames, ptrs.data());
+    return in;
+  }
+
+  in.frames = int64_t(opts.duration * opts.rate);
+  in.rate = opts.rate;
+  in.channels.assign(1, std::vector<float>(in.frames));
+  signal_generator gen{opts.signal, opts.rate};
+  gen.fill(in.channels[0].data(), int(in.frames));
+  return in;
+}
+
+// One run, with the processor constructed in storage
+template <typename T>
+batch_result render_batch_run(
+    std::optional<example_processor<T>>& storage, const batch_options& opts,
+    const batch_input& input, const std::vector<int>& indices,
+    const std::vector<double>& values, const std::string& audio_path)
+{
+  storage.reset();
+  auto& proc = storage.emplace(false);
+  proc.set_channels(opts.channels, opts.channels);
+  proc.start(opts.block_size, input.rate);
+  for (std::size_t k = 0; k < indices.size(); k++)
+    set_batch_parameter(proc.implementation(), indices[k], values[k]);
+
+  const int in_n = proc.input_channels();
+  const int out_n = proc.output_channels();
+  const int bs = opts.block_size;
+  std::vector<float> buffers(std::size_t(in_n + out_n) * bs);
+  std::vector<float*> ins(in_n), outs(out_n);
+  for (int c = 0; c < in_n; c++)
+    ins[c] = buffers.data() + std::size_t(c) * bs;
+  for (int c = 0; c < out_n; c++)
+    outs[c] = buffers.data() + std::size_t(in_n + c) * bs;
+
+  std::unique_ptr<avnd::soundfile_sink> sink;
+  if (!audio_path.empty() && out_n > 0)
+    sink = avnd::wav_soundfile_sink::create(audio_path, out_n, input.rate);
+
+  batch_result r;
+  r.hash = 0xcbf29ce484222325ULL; // FNV-1a
+  double sum = 0.;
+  for (int64_t pos = 0; pos < input.frames; pos += bs)
+  {
+    const int frames = int(std::min<int64_t>(bs, input.frames - pos));
+    for (int c = 0; c < in_n; c++)
+    {
+      const auto& src = input.channels[c % input.channels.size()];
+      std::copy_n(src.data() + pos, frames, ins[c]);
+    }
+
+    proc.process(ins.data(), in_n, outs.data(), out_n, frames);
+
+    for (int c = 0; c < out_n; c++)
+    {
+      for (int i = 0; i < frames; i++)
+      {
+        const float x = outs[c][i];
+        sum += double(x) * x;
+        r.peak = std::max(r.peak, double(std::abs(x)));
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        for (int b = 0; b < 4; b++)
+        {
+          r.hash ^= (bits >> (8 * b)) & 0xff;
+          r.hash *= 0x100000001b3ULL;
+        }
+      }
+    }
+    if (sink)
+      sink->write(outs.data(), frames);
+  }
+  if (sink)
+    sink->finalize();
+  proc.stop();
+
+  const double samples = double(input.frames) * out_n;
+  r.rms = samples > 0. ? std::sqrt(sum / samples) : 0.;
+  return r;
+}
+
+// Renders every combination over the threads, the results in the order of the combinations
+template <typename T>
+std::vector<batch_result> render_batch(
+    const batch_options& opts, const batch_input& input, const std::vector<int>& indices,
+    const std::vector<std::vector<double>>& combinations)
+{
+  std::vector<batch_result> res(combinations.size());
+  std::atomic<std::size_t> next{0};
+
+  auto work = [&] {
+    std::optional<example_processor<T>> storage;
+    for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < res.size();)
+    {
+      std::string path;
+      if (!opts.audio.empty())
+        path = std::string(opts.audio) + "/run_" + std::to_string(i) + ".wav";
+      res[i] = render_batch_run<T>(storage, opts, input, indices, combinations[i], path);
+    }
+  };
+
+  const int threads = std::clamp(
+      opts.threads > 0 ? opts.threads : int(std::thread::hardware_concurrency()), 1,
+      int(std::max<std::size_t>(combinations.size(), 1)));
+  std::vector<std::thread> pool;
+  for (int t = 1; t < threads; t++)
+    pool.emplace_back(work);
+  work();
+  for (auto& t : pool)
+    t.join();
+  return res;
+}
+
+// What the example host runs with --batch: 0 on success
+template <typename T>
+int run_batch(const batch_options& opts)
+{
+  std::vector<int> indices;
+  for (const auto& p : opts.parameters)
+  {
+    const int idx = batch_parameter_index<T>(p.name);
+    if (idx < 0)
+    {
+      logger.error("No parameter named {}", p.name);
+      return 1;
+    }
+    indices.push_back(idx);
+  }
+
+  const auto input = load_batch_input(opts);
+  if (!input)
+    return 1;
+
+  const auto combinations = batch_combinations(opts);
+  const auto res = render_batch<T>(opts, *input, indices, combinations);
+
+  std::FILE* f = stdout;
+  if (!opts.output.empty())
+  {
+    f = std::fopen(std::string(opts.output).c_str(), "w");
+    if (!f)
+    {
+      logger.error("Cannot write the results to {}", opts.output);
+      return 1;
+    }
+  }
+
+  std::fprintf(f, "run");
+  for (const auto& p : opts.parameters)
+    std::fprintf(f, ",%s", p.name.c_str());
+  std::fprintf(f, ",rms,peak,hash\n");
+  for (std::size_t i = 0; i < res.size(); i++)
+  {
+    std::fprintf(f, "%zu", i);
+    for (double v : combinations[i])
+      std::fprintf(f, ",%.9g", v);
+    std::fprintf(
+        f, ",%.9g,%.9g,%016llx\n", res[i].rms, res[i].peak, (unsigned long long)res[i].hash);
+  }
+  if (f != stdout)
+    std::fclose(f);
+  return 0;
+}
+}
@@ -5,14 +5,22 @@
 #include <avnd/introspection/midi.hpp>
 #include <avnd/wrappers/audio_channel_manager.hpp>
 #include <avnd/wrappers/callbacks_adapter.hpp>
+#include <avnd/wrappers/changed_controls.hpp>
 #include <avnd/wrappers/configure.hpp>
 #include <avnd/wrappers/control_display.hpp>
 #include <avnd/wrappers/controls.hpp>
 #include <avnd/wrappers/controls_double.hpp>
 #include <avnd/wrappers/controls_storage.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
 #include <avnd/wrappers/metadatas.hpp>
-#include <avnd/wrappers/process_adapter.hpp>
+#include <avnd/wrappers/modulation_storage.hpp>
+#include <avnd/wrappers/morph.hpp>
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
+#include <avnd/wrappers/smoothing_storage.hpp>
 #include <avnd/wrappers/widgets.hpp>
+#include <avnd/wrappers/worker.hpp>
 
 #include <utility>
 
@@ -24,7 +32,8 @@ namespace exhs
 {
 struct config
 {
-  using logger_type = halp::basic_logger;
+  // Processors may log from the audio thread
+  using logger_type = halp::rt_logger;
 
   template<typename T>
   using fft_type = halp::fft<T>;
@@ -82,8 +91,9 @@ class example_processor
   // This allows to dedouble monophonic plug-ins.
   // This is done efficiently: as far as possible, there will be a single copy
   // of the input controls for instance, only the internal state will be duplicated
-  // in memory.
-  [[no_unique_address]] avnd::process_adapter<T> processor;
+  // in memory. When each instance has its own controls, they are written once
+  // and copied to the others before processing, see shared_controls.
+  [[no_unique_address]] avnd::host_process_adapter<T> processor;
 
   [[no_unique_address]] avnd::audio_channel_manager<T> channels;
 
@@ -91,17 +101,31 @@ class example_processor
 
   [[no_unique_address]] avnd::control_storage<T> control_buffers;
 
-  [[no_unique_address]] avnd::callback_storage<T> callbacks;
+  [[no_unique_address]] avnd::shared_controls<T> controls;
+
+  [[no_unique_address]] avnd::smoothing_storage<T> smoothing;
+
+  [[no_unique_address]] avnd::modulation_storage<T> modulation;
+
+  [[no_unique_address]] avnd::changed_controls_storage<T> changed_controls;
+
+  [[no_unique_address]] avnd::morph_storage<T> morphing;
+  [[no_unique_address]] avnd::worker_storage<T> worker;
+
+  // The calls of the callbacks reach the host from idle(), not from the audio thread
+  [[no_unique_address]] avnd::deferred_callbacks<T> callbacks;
 
   int buffer_size{};
   double sample_rate{};
 
 public:
-  example_processor()
+  // verbose: whether to print the introspected ports, e.g. not when profiling
+  explicit example_processor(bool verbose = true)
       : channels{effect}
   {
     /// Print some metadata
-    exhs::introspect<T>();
+    if (verbose)
+      exhs::introspect<T>();
 
     /// Initialize the host with how many audio channels are requested by the plug-in,
     /// for hosts which work like this:
@@ -206,15 +230,37 @@ public:
       control_buffers.reserve_space(effect, buffer_size);
     }
 
+    // Setup the ramps of smoothed controls
+    smoothing.prepare(effect, sample_rate, buffer_size);
+    modulation.prepare(effect, buffer_size);
+    worker.start(effect);
+
     // Effect-specific preparation
     avnd::prepare(effect, setup_info);
   }
 
+  // Asks the processor for channel counts, before start():
+  // the ones it actually gets are input_channels() and output_channels()
+  void set_channels(int inputs, int outputs)
+  {
+    channels.set_input_channels(effect, 0, inputs);
+    channels.set_output_channels(effect, 0, outputs);
+  }
+
+  int input_channels() const noexcept { return channels.actual_runtime_inputs; }
+  int output_channels() const noexcept { return channels.actual_runtime_outputs; }
+
+  // e.g. for the batch mode to set the controls
+  avnd::effect_container<T>& implementation() noexcept { return effect; }
+
   void start(int buffer_size, double sample_rate)
   {
     this->buffer_size = buffer_size;
     this->sample_rate = sample_rate;
 
+    // Not on the first message, which may be logged in the audio thread
+    config::logger_type::start();
+
     audio_configuration_changed();
   }
 
@@ -235,12 +281,20 @@ public:
     // If param_in_info::for_nth_raw was used,
     // the corresponding indices would be 1 and 3 respectively.
 
-    param_in_info::for_nth_mapped(
-        this->effect.inputs(),
+    controls.write(
+        this->effect,
         control_id,
         [&]<typename C>(C& field) { field.value = value; });
   }
 
+  // Modulates a parameter at audio rate for the next buffer, e.g. from an LFO:
+  // control_id is the one of apply_control, and the signals of a buffer are summed
+  template <typename S>
+  void modulate(int control_id, const S* signal, int frames, double depth = 1.)
+  {
+    modulation.add(control_id, signal, frames, depth);
+  }
+
   void apply_midi_in(int midi_id, std::array<unsigned char, 3> bytes)
   {
     midi_in_info::for_nth_mapped(
@@ -303,6 +357,9 @@ public:
   template <std::floating_point Fp>
   void process(Fp** inputs, int in_N, Fp** outputs, int out_N, int frames)
   {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+
     // Sanity checks
     if (in_N != this->channels.actual_runtime_inputs)
     {
@@ -340,11 +397,27 @@ public:
   template <std::floating_point Fp>
   void run_process(Fp** inputs, int in_N, Fp** outputs, int out_N, int frames)
   {
+    controls.sync(effect);
+    midi_buffers.merge_inputs(effect);
+    worker.deliver(effect);
+    morphing.update(effect);
+    smoothing.update(effect, frames);
+    modulation.update(effect, frames);
+    changed_controls.update(effect);
     processor.process(
         effect,
         avnd::span<Fp*>{inputs, std::size_t(in_N)},
         avnd::span<Fp*>{outputs, std::size_t(out_N)},
         frames);
+    modulation.restore(effect);
+    callbacks.advance(frames);
+  }
+
+  // Called by the host from its main thread, e.g. on a timer
+  void idle()
+  {
+    // The callbacks called while processing
+    callbacks.deliver();
   }
 
   void after_process()
@@ -361,6 +434,6 @@ public:
     this->control_buffers.clear_inputs(effect);
   }
 
-  void stop() { }
+  void stop() { config::logger_type::flush(); }
 };
 }
@@ -0,0 +1,352 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/example/example_processor.hpp>
+#include <avnd/wrappers/metadatas.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Profiling mode of the example host: runs a processor on synthetic inputs
+ * and times each call, e.g. over every example to catch regressions:
+ *
+ * ./example/Foo_example_host --profile --block-sizes=64,512 --channels=2 --output=foo.json
+ *
+ * The options, which all have defaults:
+ *  --blocks=N             timed blocks per configuration
+ *  --warmup=N             blocks run before timing
+ *  --block-sizes=64,512   frames per block
+ *  --channels=1,2         channels asked for; the processor may use others
+ *  --signals=noise,sweep,impulse
+ *  --rate=48000
+ *  --precision=float      or double
+ *  --budget=0.5           fraction of the duration of a block over which a call is a miss
+ *  --output=file.json     stdout otherwise
+ *
+ * The times are measured with std::chrono::steady_clock around each process() call,
+ * in nanoseconds.
+ */
+namespace exhs
+{
+enum class test_signal
+{
+  noise,   // White, at -6 dBFS
+  sweep,   // Logarithmic sine sweep from 20 Hz to 20 kHz, over 10 seconds
+  impulse, // One sample at 1 at every second, silence otherwise
+};
+
+inline constexpr std::string_view test_signal_names[] = {"noise", "sweep", "impulse"};
+
+struct profile_options
+{
+  std::vector<int> block_sizes{64, 512};
+  std::vector<int> channels{1, 2};
+  std::vector<test_signal> signals{test_signal::noise, test_signal::sweep, test_signal::impulse};
+  int blocks{500};
+  int warmup{20};
+  double rate{48000.};
+  double budget{0.5};
+  bool double_precision{};
+  std::string_view output{};
+};
+
+struct profile_result
+{
+  test_signal signal{};
+  int block_size{};
+  int inputs{};
+  int outputs{};
+  int blocks{};
+  int misses{}; // Calls over the budget
+
+  double mean_ns{};
+  double p99_ns{};
+  double max_ns{};
+  double ns_per_frame{};
+  double ns_per_sample{}; // Per frame of each channel
+};
+
+// The profiling options if --profile is among the arguments, nothing otherwise
+inline std::optional<profile_options> parse_profile_options(int argc, char** argv)
+{
+  bool profile = false;
+  profile_options opts;
+
+  auto to_count = [](std::string_view s, int& res) {
+    return std::from_chars(s.data(), s.data() + s.size(), res).ec == std::errc{} && res >= 0;
+  };
+  auto to_int = [&](std::string_view s, int& res) { return to_count(s, res) && res > 0; };
+  auto to_fraction = [](std::string_view s, double& res) {
+    return std::from_chars(s.data(), s.data() + s.size(), res).ec == std::errc{} && res > 0.;
+  };
+  auto to_ints = [&](std::string_view s, std::vector<int>& res) {
+    res.clear();
+    for (std::size_t p = 0; p <= s.size();)
+    {
+      const std::size_t comma = std::min(s.find(',', p), s.size());
+      int v{};
+      if (!to_int(s.substr(p, comma - p), v))
+        return false;
+      res.push_back(v);
+      p = comma + 1;
+    }
+    return true;
+  };
+  auto to_signals = [](std::string_view s, std::vector<test_signal>& res) {
+    res.clear();
+    for (std::size_t p = 0; p <= s.size();)
+    {
+      const std::size_t comma = std::min(s.find(',', p), s.size());
+      const auto name = s.substr(p, comma - p);
+      auto it = std::find(std::begin(test_signal_names), std::end(test_signal_names), name);
+      if (it == std::end(test_signal_names))
+        return false;
+      res.push_back(test_signal(it - std::begin(test_signal_names)));
+      p = comma + 1;
+    }
+    return true;
+  };
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string_view arg = argv[i];
+    const std::size_t eq = arg.find('=');
+    const auto key = arg.substr(0, eq);
+    const auto value = eq == std::string_view::npos ? std::string_view{} : arg.substr(eq + 1);
+
+    int rate{};
+    bool ok = true;
+    if (key == "--profile")
+      profile = true;
+    else if (key == "--blocks")
+      ok = to_int(value, opts.blocks);
+    else if (key == "--warmup")
+      ok = to_count(value, opts.warmup);
+    else if (key == "--block-sizes")
+      ok = to_ints(value, opts.block_sizes);
+    else if (key == "--channels")
+      ok = to_ints(value, opts.channels);
+    else if (key == "--signals")
+      ok = to_signals(value, opts.signals);
+    else if (key == "--rate" && (ok = to_int(value, rate)))
+      opts.rate = rate;
+    else if (key == "--budget")
+      ok = to_fraction(value, opts.budget);
+    else if (key == "--precision" && (value == "float" || value == "double"))
+      opts.double_precision = value == "double";
+    else if (key == "--output" && !value.empty())
+      opts.output = value;
+    else
+      ok = false;
+
+    if (!ok)
+    {
+      logger.error("Unknown or invalid profiling option: {}", arg);
+      return std::nullopt;
+    }
+  }
+
+  if (!profile)
+    return std::nullopt;
+  return opts;
+}
+
+// Fills the inputs with the signal, block after block, the same on every channel
+class signal_generator
+{
+public:
+  signal_generator(test_signal s, double rate)
+      : m_signal{s}
+      , m_rate{rate}
+  {
+  }
+
+  template <typename FP>
+  void fill(FP* out, int frames) noexcept
+  {
+    static constexpr double pi = 3.141592653589793238462643383279502884;
+    for (int i = 0; i < frames; i++, m_frame++)
+    {
+      switch (m_signal)
+      {
+        case test_signal::noise:
+          m_seed ^= m_seed << 13;
+          m_seed ^= m_seed >> 17;
+          m_seed ^= m_seed << 5;
+          out[i] = FP(double(m_seed) * (1. / 4294967296.) - 0.5);
+          break;
+        case test_signal::sweep:
+        {
+          // phase(t) = 2 pi f0 T / log(f1 / f0) * ((f1 / f0)^(t / T) - 1), restarted every T
+          constexpr double f0 = 20., f1 = 20000., T = 10.;
+          const double t = std::fmod(double(m_frame) / m_rate, T);
+          const double k = std::log(f1 / f0);
+          out[i] = FP(std::sin(2. * pi * f0 * T / k * (std::exp(t / T * k) - 1.)));
+          break;
+        }
+        case test_signal::impulse:
+          out[i] = FP(m_frame % int64_t(m_rate) == 0 ? 1. : 0.);
+          break;
+      }
+    }
+  }
+
+private:
+  test_signal m_signal{};
+  double m_rate{};
+  int64_t m_frame{};
+  uint32_t m_seed{0x9E3779B9u};
+};
+
+template <typename T, std::floating_point FP>
+profile_result
+profile_one(const profile_options& opts, test_signal signal, int block_size, int channels)
+{
+  exhs::example_processor<T> proc{false};
+  proc.set_channels(channels, channels);
+  proc.start(block_size, opts.rate);
+
+  const int in_n = proc.input_channels();
+  const int out_n = proc.output_channels();
+  std::vector<FP> storage(std::size_t(in_n + out_n) * block_size);
+  std::vector<FP*> ins(in_n), outs(out_n);
+  for (int c = 0; c < in_n; c++)
+    ins[c] = storage.data() + std::size_t(c) * block_size;
+  for (int c = 0; c < out_n; c++)
+    outs[c] = storage.data() + std::size_t(in_n + c) * block_size;
+
+  signal_generator gen{signal, opts.rate};
+  std::vector<double> times;
+  times.reserve(opts.blocks);
+  for (int b = 0; b < opts.warmup + opts.blocks; b++)
+  {
+    if (in_n > 0)
+    {
+      gen.fill(ins[0], block_size);
+      for (int c = 1; c < in_n; c++)
+        std::copy_n(ins[0], block_size, ins[c]);
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    proc.process(ins.data(), in_n, outs.data(), out_n, block_size);
+    const auto t1 = std::chrono::steady_clock::now();
+    if (b >= opts.warmup)
+      times.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+  }
+  proc.stop();
+
+  profile_result r{
+      .signal = signal,
+      .block_size = block_size,
+      .inputs = in_n,
+      .outputs = out_n,
+      .blocks = int(times.size())};
+  if (times.empty())
+    return r;
+
+  const double budget_ns = opts.budget * block_size * 1e9 / opts.rate;
+  r.misses = int(
+      std::count_if(times.begin(), times.end(), [=](double t) { return t > budget_ns; }));
+
+  std::sort(times.begin(), times.end());
+  double sum = 0.;
+  for (double t : times)
+    sum += t;
+  r.mean_ns = sum / double(times.size());
+  r.p99_ns = times[std::size_t(std::ceil(0.99 * double(times.size()))) - 1];
+  r.max_ns = times.back();
+  r.ns_per_frame = r.mean_ns / block_size;
+  r.ns_per_sample = r.ns_per_frame / std::max({in_n, out_n, 1});
+  return r;
+}
+
+// Every combination of the options
+template <typename T>
+std::vector<profile_result> profile(const profile_options& opts)
+{
+  std::vector<profile_result> res;
+  for (test_signal s : opts.signals)
+    for (int block_size : opts.block_sizes)
+      for (int channels : opts.channels)
+        res.push_back(
+            opts.double_precision ? profile_one<T, double>(opts, s, block_size, channels)
+                                  : profile_one<T, float>(opts, s, block_size, channels));
+  return res;
+}
+
+inline void write_json_string(std::FILE* f, std::string_view s)
+{
+  std::fputc('"', f);
+  for (char c : s)
+  {
+    if (c == '"' || c == '\\')
+      std::fprintf(f, "\\%c", c);
+    else if (static_cast<unsigned char>(c) < 0x20)
+      std::fprintf(f, "\\u%04x", c);
+    else
+      std::fputc(c, f);
+  }
+  std::fputc('"', f);
+}
+
+template <typename T>
+void write_json(std::FILE* f, const profile_options& opts, const std::vector<profile_result>& res)
+{
+  std::fprintf(f, "{\n  \"processor\": ");
+  write_json_string(f, avnd::get_name<T>());
+  if constexpr (avnd::has_c_name<T>)
+  {
+    std::fprintf(f, ",\n  \"c_name\": ");
+    write_json_string(f, avnd::get_c_name<T>());
+  }
+  std::fprintf(
+      f, ",\n  \"rate\": %g,\n  \"precision\": \"%s\",\n  \"budget\": %g,\n  \"results\": [",
+      opts.rate, opts.double_precision ? "double" : "float", opts.budget);
+
+  for (std::size_t i = 0; i < res.size(); i++)
+  {
+    const auto& r = res[i];
+    std::fprintf(
+        f,
+        "%s\n    {\"signal\": \"%s\", \"block_size\": %d, \"inputs\": %d, \"outputs\": %d, "
+        "\"blocks\": %d, \"misses\": %d, \"mean_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f, "
+        "\"ns_per_frame\": %.3f, \"ns_per_sample\": %.3f}",
+        i == 0 ? "" : ",", test_signal_names[int(r.signal)].data(), r.block_size, r.inputs,
+        r.outputs, r.blocks, r.misses, r.mean_ns, r.p99_ns, r.max_ns, r.ns_per_frame,
+        r.ns_per_sample);
+  }
+  std::fprintf(f, "\n  ]\n}\n");
+}
+
+// What the example host runs with --profile: 0 on success
+template <typename T>
+int run_profile(const profile_options& opts)
+{
+  const auto res = exhs::profile<T>(opts);
+
+  std::FILE* f = stdout;
+  if (!opts.output.empty())
+  {
+    f = std::fopen(std::string(opts.output).c_str(), "w");
+    if (!f)
+    {
+      logger.error("Cannot write the profile to {}", opts.output);
+      return 1;
+    }
+  }
+  exhs::write_json<T>(f, opts, res);
+  if (f != stdout)
+    std::fclose(f);
+  return 0;
+}
+}
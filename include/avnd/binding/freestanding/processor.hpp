@@ -0,0 +1,178 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/freestanding.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/wrappers/audio_channel_manager.hpp>
+#include <avnd/wrappers/configure.hpp>
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/prepare.hpp>
+#include <avnd/wrappers/smoothing_storage.hpp>
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+
+/**
+ * Binding for micro-controllers and DSP boards, e.g. Cortex-M, ESP32 or Daisy:
+ * the firmware calls process() from its audio callback, with its DMA buffers,
+ * and set_parameter() with the values of its knobs.
+ *
+ * It is meant for the freestanding profile (see avnd/common/freestanding.hpp):
+ * once constructed, nothing allocates, start() included, and all the memory is
+ * in the processor object, whose size is known when linking.
+ * Like in the example host, the audio goes through the process adapters of the
+ * desktop bindings, thus the same processors run on both.
+ */
+namespace freestanding
+{
+// There is nothing to print to on a board
+struct logger
+{
+  using logger_type = logger;
+  template <typename... T>
+  static void log(T&&...) noexcept { }
+  template <typename... T>
+  static void trace(T&&...) noexcept { }
+  template <typename... T>
+  static void debug(T&&...) noexcept { }
+  template <typename... T>
+  static void info(T&&...) noexcept { }
+  template <typename... T>
+  static void warn(T&&...) noexcept { }
+  template <typename... T>
+  static void error(T&&...) noexcept { }
+  template <typename... T>
+  static void critical(T&&...) noexcept { }
+};
+
+struct config
+{
+  using logger_type = logger;
+};
+
+// The samples process() takes besides float: the format of a fixed-point processor
+template <typename T>
+struct native_sample
+{
+  using type = float;
+};
+
+template <avnd::fixed_point_processor T>
+struct native_sample<T>
+{
+  using type = avnd::fixed_point_sample_type<T>;
+};
+
+template <typename T>
+class processor
+{
+public:
+  using effect_type = T;
+  using param_in_info = avnd::parameter_input_introspection<T>;
+
+  using sample_type = typename native_sample<T>::type;
+
+#if AVND_FREESTANDING
+  static constexpr int max_channels = AVND_FREESTANDING_MAX_CHANNELS;
+#else
+  static constexpr int max_channels = 64;
+#endif
+
+  processor()
+      : m_channels{m_effect}
+  {
+    if constexpr (avnd::has_inputs<T>)
+      avnd::init_controls(m_effect.inputs());
+  }
+
+  processor(const processor&) = delete;
+  processor& operator=(const processor&) = delete;
+
+  // Before the audio starts: the buffers given to process() then have up to frames
+  // frames; the channels and frames are clamped to the capacities of the profile
+  void start(int inputs, int outputs, int frames, double rate)
+  {
+    inputs = std::min(inputs, max_channels);
+    outputs = std::min(outputs, max_channels);
+#if AVND_FREESTANDING
+    frames = std::min(frames, AVND_FREESTANDING_MAX_FRAMES);
+#endif
+    m_channels.set_input_channels(m_effect, 0, inputs);
+    m_channels.set_output_channels(m_effect, 0, outputs);
+
+    const avnd::process_setup setup{
+        .input_channels = m_channels.actual_runtime_inputs,
+        .output_channels = m_channels.actual_runtime_outputs,
+        .frames_per_buffer = frames,
+        .rate = rate};
+
+    m_processor.allocate_buffers(setup, float{});
+    m_effect.init_channels(setup.input_channels, setup.output_channels);
+    m_smoothing.prepare(m_effect, rate, frames);
+    avnd::prepare(m_effect, setup);
+    m_frames = std::max(frames, 1);
+  }
+
+  int input_channels() const noexcept { return m_channels.actual_runtime_inputs; }
+  int output_channels() const noexcept { return m_channels.actual_runtime_outputs; }
+
+  static constexpr int parameter_count() noexcept { return param_in_info::size; }
+
+  // The index counts the parameters among the inputs, value is in [0; 1]
+  void set_parameter(int index, float value) noexcept
+  {
+    if constexpr (param_in_info::size > 0)
+    {
+      if (index < 0 || index >= param_in_info::size)
+        return;
+      param_in_info::for_nth_mapped(
+          m_effect.inputs(), index, [value]<typename C>(C& field) {
+            field.value = avnd::map_control_from_01<C>(std::clamp(value, 0.f, 1.f));
+          });
+    }
+  }
+
+  // In the audio callback: the channels are the ones of start().
+  // The samples are float, or for a fixed-point processor, e.g. of halp::q15,
+  // its own format, which the codecs of many boards give as is
+  template <typename S>
+  requires std::same_as<S, float> || std::same_as<S, sample_type>
+  void process(const S* const* inputs, S* const* outputs, int frames) noexcept
+  {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    S* in[max_channels];
+    S* out[max_channels];
+
+    // Buffers larger than in start() are processed in several times
+    for (int offset = 0; offset < frames; offset += m_frames)
+    {
+      const int n = std::min(m_frames, frames - offset);
+      const int ins = std::min(input_channels(), max_channels);
+      const int outs = std::min(output_channels(), max_channels);
+      for (int c = 0; c < ins; c++)
+        in[c] = const_cast<S*>(inputs[c]) + offset;
+      for (int c = 0; c < outs; c++)
+        out[c] = outputs[c] + offset;
+
+      m_smoothing.update(m_effect, n);
+      m_processor.process(
+          m_effect, avnd::span<S*>{in, std::size_t(ins)},
+          avnd::span<S*>{out, std::size_t(outs)}, n);
+    }
+  }
+
+  avnd::effect_container<T>& effect() noexcept { return m_effect; }
+
+private:
+  avnd::effect_container<T> m_effect;
+  [[no_unique_address]] avnd::host_process_adapter<T> m_processor;
+  [[no_unique_address]] avnd::audio_channel_manager<T> m_channels;
+  [[no_unique_address]] avnd::smoothing_storage<T> m_smoothing;
+
+  int m_frames{1};
+};
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/max/helpers.hpp>
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/metadatas.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace max
+{
+/**
+ * Registers the parameters of T as native Max attributes, e.g. @gain 0.5 in the
+ * object box, [gain 0.5( or [getgain( messages and the inspector.
+ *
+ * Each parameter has its own setter, typed on the parameter, so that Max dispatches
+ * a message with the name of a control directly to it, rather than through the
+ * "anything" method which compares the name with every control.
+ * The instance must have an avnd::shared_controls<T> controls member.
+ */
+template <typename T>
+struct attributes
+{
+  template <typename Instance>
+  static void register_attributes(t_class* c)
+  {
+  }
+};
+
+template <typename T>
+requires(avnd::parameter_input_introspection<T>::size > 0) struct attributes<T>
+{
+  using param_in = avnd::parameter_input_introspection<T>;
+
+  template <typename C>
+  static t_symbol* attribute_type() noexcept
+  {
+    if constexpr (avnd::string_parameter<C>)
+      return _sym_symbol;
+    else if constexpr (avnd::bool_parameter<C> || avnd::enum_parameter<C>)
+      return _sym_long;
+    else if constexpr (avnd::int_parameter<C>)
+      return _sym_long;
+    else if constexpr (avnd::float_parameter<C>)
+      return _sym_float64;
+    else
+      return nullptr;
+  }
+
+  static bool reserved_name(std::string_view name) noexcept
+  {
+    using namespace std::literals;
+    constexpr std::string_view builtins[]{
+        "bang"sv, "int"sv, "float"sv, "symbol"sv, "list"sv, "anything"sv,
+        "signal"sv, "dsp64"sv, "dumpall"sv};
+    for (auto builtin : builtins)
+      if (builtin == name)
+        return true;
+    return false;
+  }
+
+  template <typename C>
+  static void assign(C& ctl, t_atom* av)
+  {
+    if constexpr (avnd::string_parameter<C>)
+      ctl.value = atom_getsym(av)->s_name;
+    else if constexpr (avnd::bool_parameter<C>)
+      ctl.value = atom_getlong(av) != 0;
+    else if constexpr (avnd::enum_parameter<C>)
+      ctl.value = static_cast<decltype(C::value)>(std::clamp<t_atom_long>(
+          atom_getlong(av), 0, std::max(avnd::get_enum_choices_count<C>() - 1, 0)));
+    else if constexpr (avnd::int_parameter<C>)
+      avnd::apply_control(ctl, double(atom_getlong(av)));
+    else
+      avnd::apply_control(ctl, double(atom_getfloat(av)));
+  }
+
+  template <typename C>
+  static void read(const C& ctl, t_atom* av)
+  {
+    if constexpr (avnd::string_parameter<C>)
+      atom_setsym(av, gensym(std::string(ctl.value).c_str()));
+    else if constexpr (avnd::float_parameter<C>)
+      atom_setfloat(av, ctl.value);
+    else
+      atom_setlong(av, static_cast<t_atom_long>(ctl.value));
+  }
+
+  template <typename Instance, std::size_t N>
+  static t_max_err set(Instance* x, void* attr, long ac, t_atom* av)
+  {
+    if (ac < 1 || !av)
+      return MAX_ERR_NONE;
+    x->controls.write(
+        x->implementation, N, [av]<typename C>(C& ctl) { assign(ctl, av); });
+    return MAX_ERR_NONE;
+  }
+
+  template <typename Instance, std::size_t N>
+  static t_max_err get(Instance* x, void* attr, long* ac, t_atom** av)
+  {
+    char alloc{};
+    if (atom_alloc(ac, av, &alloc))
+      return MAX_ERR_OUT_OF_MEM;
+    *ac = 1;
+    atom_setlong(*av, 0);
+    x->controls.read(x->implementation, N, [av]<typename C>(const C& ctl) {
+      read(ctl, *av);
+    });
+    return MAX_ERR_NONE;
+  }
+
+  // Called once when setting up the Max class of Instance
+  template <typename Instance>
+  static void register_attributes(t_class* c)
+  {
+    [c]<std::size_t... N>(std::index_sequence<N...>) {
+      (register_attribute<Instance, N>(c), ...);
+    }(std::make_index_sequence<param_in::size>{});
+  }
+
+  template <typename Instance, std::size_t N>
+  static void register_attribute(t_class* c)
+  {
+    using C = typename param_in::template nth_element<N>;
+    if constexpr (avnd::has_name<C>)
+    {
+      t_symbol* type = attribute_type<C>();
+      if (!type)
+        return;
+
+      const std::string name{avnd::get_c_identifier<C>()};
+      if (name.empty() || reserved_name(name))
+        return;
+
+      t_object* attr = attribute_new(
+          name.c_str(), type, 0, (method)&get<Instance, N>, (method)&set<Instance, N>);
+      class_addattr(c, attr);
+    }
+  }
+};
+
+}
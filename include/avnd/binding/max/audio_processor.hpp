@@ -2,18 +2,31 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
+#include <avnd/binding/max/attributes.hpp>
 #include <avnd/binding/max/helpers.hpp>
 #include <avnd/binding/max/init.hpp>
 #include <avnd/binding/max/messages.hpp>
 #include <avnd/common/export.hpp>
 #include <avnd/wrappers/avnd.hpp>
+#include <avnd/wrappers/changed_controls.hpp>
 #include <avnd/wrappers/controls.hpp>
-#include <avnd/wrappers/process_adapter.hpp>
+#include <avnd/wrappers/deadline.hpp>
+#include <avnd/wrappers/deferred_outputs.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/morph.hpp>
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
+#include <avnd/wrappers/smoothing_storage.hpp>
+#include <avnd/wrappers/tracing.hpp>
+#include <avnd/wrappers/worker.hpp>
 #include <cmath>
 #include <ext.h>
 #include <z_dsp.h>
 
+#include <algorithm>
 #include <cstring>
+#include <memory>
 #include <span>
 #include <string>
 
@@ -21,9 +34,11 @@
  * This Pd processor is used when there is dsp processing involved.
  *
  * Inputs and outputs will be created according to the audio channel count.
- * Non-audio inputs will be processed through messages sent to the first port.
- *
- * TODO: support non-audio outputs.
+ * Non-audio inputs will be processed through messages sent to the first port;
+ * named parameters are attributes, which Max dispatches directly to their setter.
+ * Control outputs and callbacks get outlets on the right of the signal one: what they
+ * produce in the audio thread is sent by a clock on the scheduler thread, at the time
+ * of its frame.
  */
 
 namespace max
@@ -49,28 +64,72 @@ struct audio_processor
 
   // Our actual code
   avnd::effect_container<T> implementation;
-  avnd::process_adapter<T> processor;
+  avnd::host_process_adapter<T> processor;
+  [[no_unique_address]] avnd::shared_controls<T> controls;
+  [[no_unique_address]] avnd::smoothing_storage<T> smoothing;
+  [[no_unique_address]] avnd::changed_controls_storage<T> changed_controls;
+
+  [[no_unique_address]] avnd::morph_storage<T> morphing;
+  [[no_unique_address]] avnd::worker_storage<T> worker;
+
+  // Callbacks over their time budget, when built with AVND_DEADLINE_MONITOR
+  [[no_unique_address]] avnd::deadline_monitor deadlines{avnd::get_name<T>()};
 
   [[no_unique_address]] init_arguments<T> init_setup;
   [[no_unique_address]] messages<T> messages_setup;
 
+  // Channels of the multichannel signals, negotiated with Max
   int m_runtime_input_count{};
   int m_runtime_output_count{};
 
+  // Control outputs, sent from the scheduler thread
+  using deferred_outputs_type = avnd::deferred_outputs<T>;
+  std::unique_ptr<deferred_outputs_type> control_outputs;
+  std::array<void*, deferred_outputs_type::size> control_outlets{};
+  void* output_clock{};
+  double sample_rate{};
+
+  // What the outlet carries for a given number of input channels
+  static int output_count_for(int inputs) noexcept
+  {
+    return std::max(avnd::output_channels<T>(std::max(inputs, 1)), 1);
+  }
+
   // we don't use ctor / dtor, because
   // this breaks aggregate-ness...
   void init(int argc, t_atom* argv)
   {
+    // The @attribute arguments come after the ones of the object
+    const long attrstart = attr_args_offset(short(argc), argv);
+
     /// Pass arguments
     if constexpr (avnd::can_initialize<T>)
     {
-      init_setup.process(implementation, argc, argv);
+      init_setup.process(implementation, int(attrstart), argv);
     }
 
     /// Create ports ///
     // Audio inlet already created as we're a t_pxobject
     dsp_setup(&x_obj, 1);
 
+    // Max adds the outlets on the left: the last one created is the leftmost
+    if constexpr (deferred_outputs_type::has_event_outputs)
+    {
+      std::array<bool, deferred_outputs_type::size> is_event{};
+      deferred_outputs_type::for_each_output(
+          implementation, [&]<typename C, std::size_t Idx>(C&, avnd::predicate_index<Idx>) {
+            is_event[Idx] = deferred_outputs_type::template is_event_output<C>;
+          });
+      for (int k = deferred_outputs_type::size - 1; k >= 0; k--)
+        if (is_event[k])
+          control_outlets[k] = outlet_new(&x_obj, nullptr);
+
+      control_outputs = std::make_unique<deferred_outputs_type>();
+      control_outputs->setup_callbacks(implementation);
+      constexpr auto send = +[](audio_processor* self) { self->send_control_outputs(); };
+      output_clock = clock_new(this, (method)send);
+    }
+
     // Create an audio outlet
     if constexpr (output_channels != 0)
     {
@@ -84,24 +143,73 @@ struct audio_processor
 
     /// Initialize polyphony
     implementation.init_channels(input_channels, output_channels);
+
+    /// Then apply the @attribute arguments over the defaults
+    attr_args_process(&x_obj, short(argc), argv);
   }
 
-  void destroy() { }
+  void destroy()
+  {
+    if (output_clock)
+      object_free(output_clock);
+  }
+
+  static double scheduler_time() noexcept
+  {
+    double now{};
+    clock_getftime(&now);
+    return now;
+  }
+
+  // Scheduler thread: the control outputs which are due
+  void send_control_outputs()
+  {
+    const double now = scheduler_time();
+    const auto next = control_outputs->drain(
+        now, [this](const typename deferred_outputs_type::event& e) {
+          if (e.bang)
+          {
+            outlet_bang(control_outlets[e.port]);
+          }
+          else if (e.count == 1)
+          {
+            outlet_float(control_outlets[e.port], e.values[0]);
+          }
+          else
+          {
+            t_atom list[4];
+            for (int k = 0; k < e.count; k++)
+              atom_setfloat(&list[k], e.values[k]);
+            outlet_list(control_outlets[e.port], nullptr, short(e.count), list);
+          }
+        });
+    if (next)
+      clock_fdelay(output_clock, *next - now);
+  }
 
   void
   dsp(t_object* dsp64, short* count, double samplerate, long maxvectorsize, long flags)
   {
-    int a_chans
+    const int a_chans
         = (intptr_t)object_method(dsp64, gensym("getnuminputchannels"), &x_obj, 0);
 
-    int input_chans = std::max(this->input_channels, a_chans);
-    int output_chans = std::max(this->output_channels, input_chans);
+    // Processors with fixed channel counts keep theirs, the others follow the signal;
+    // missing input channels are silent.
+    const int input_chans = avnd::input_channels<T>(std::max(a_chans, 1));
+    const int output_chans = output_channels != 0 ? output_count_for(input_chans) : 0;
+    m_runtime_input_count = input_chans;
+    m_runtime_output_count = output_chans;
+    implementation.init_channels(input_chans, output_chans);
 
     // Initialize vectors for converting double -> float
     const int N = maxvectorsize;
     const double rate = samplerate;
+    sample_rate = rate;
+    if constexpr (deferred_outputs_type::has_event_outputs)
+      control_outputs->prepare(rate);
 
-    // Allocate buffers that may be required for converting float <-> double
+    // MSP is double precision: double processors run on its vectors in place,
+    // and conversion buffers are only allocated for float-only processors.
     avnd::process_setup setup_info{
         .input_channels = input_chans,
         .output_channels = output_chans,
@@ -109,6 +217,11 @@ struct audio_processor
         .rate = rate};
     processor.allocate_buffers(setup_info, double{});
 
+    // Setup the ramps of smoothed controls
+    smoothing.prepare(implementation, rate, N);
+    worker.start(implementation);
+    deadlines.prepare(rate);
+
     // Allocate buffers if supported
     avnd::prepare(implementation, setup_info);
 
@@ -139,15 +252,47 @@ struct audio_processor
       long flags,
       void* userparam)
   {
-    processor.process(
-        implementation,
-        avnd::span<double*>{ins, std::size_t(numins)},
-        avnd::span<double*>{outs, std::size_t(numouts)},
-        sampleframes);
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    [[maybe_unused]] avnd::deadline_scope deadline{deadlines, sampleframes};
+    AVND_TRACE_ZONE(T, callback);
+
+    [[maybe_unused]] double now{};
+    if constexpr (deferred_outputs_type::has_event_outputs)
+    {
+      now = scheduler_time();
+      control_outputs->begin_buffer(now);
+    }
+
+    {
+      AVND_TRACE_ZONE(T, process);
+      controls.sync(implementation);
+      worker.deliver(implementation);
+      morphing.update(implementation);
+      smoothing.update(implementation, sampleframes);
+      changed_controls.update(implementation);
+      processor.process(
+          implementation,
+          avnd::span<double*>{ins, std::size_t(std::min<long>(numins, m_runtime_input_count))},
+          avnd::span<double*>{
+              outs, std::size_t(std::min<long>(numouts, m_runtime_output_count))},
+          sampleframes);
+    }
+
+    if constexpr (deferred_outputs_type::has_event_outputs)
+    {
+      AVND_TRACE_ZONE(T, controls);
+      const double frame_ms = 1000. / sample_rate;
+      const auto drain_at = control_outputs->collect(
+          implementation, int(sampleframes), [=](int frame) { return now + frame * frame_ms; });
+      if (drain_at)
+        clock_fdelay(output_clock, *drain_at - now);
+    }
   }
 
   void process_inlet_control(t_symbol* s, long argc, t_atom* argv)
   {
+    AVND_TRACE_ZONE(T, parameters);
     switch (argv[0].a_type)
     {
       case A_FLOAT:
@@ -197,6 +342,8 @@ struct audio_processor
 
   void process(t_symbol* s, int argc, t_atom* argv)
   {
+    AVND_TRACE_ZONE(T, messages);
+
     // First try to process messages handled explicitely in the object
     if (messages_setup.process_messages(implementation, s, argc, argv))
       return;
@@ -290,10 +437,7 @@ audio_processor_metaclass<T>::audio_processor_metaclass()
       return false;
   };
   constexpr auto outputcount = +[](instance* x, long index) -> long
-  {
-    // TODO check whether the outputs are fixed or dynamic
-    return x->m_runtime_input_count;
-  };
+  { return instance::output_count_for(x->m_runtime_input_count); };
 
   // Message processing
   constexpr auto obj_process
@@ -311,6 +455,10 @@ audio_processor_metaclass<T>::audio_processor_metaclass()
       0);
 
   class_dspinit(g_class);
+
+  // Named controls are attributes, set without going through "anything"
+  attributes<T>::template register_attributes<instance>(g_class);
+
   class_register(CLASS_BOX, g_class);
 
   // Connect our methods
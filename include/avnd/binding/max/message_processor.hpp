@@ -2,6 +2,7 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
+#include <avnd/binding/max/attributes.hpp>
 #include <avnd/binding/max/helpers.hpp>
 #include <avnd/binding/max/init.hpp>
 #include <avnd/binding/max/inputs.hpp>
@@ -10,6 +11,8 @@
 #include <avnd/common/export.hpp>
 #include <avnd/wrappers/avnd.hpp>
 #include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
+#include <avnd/wrappers/tracing.hpp>
 #include <cmath>
 
 #include <span>
@@ -18,7 +21,7 @@
 /**
  * This Max processor is used when there is no dsp processing involved.
  *
- * It will create one inlet per input port.
+ * It will create one inlet per parameter, and one attribute per named parameter.
  */
 namespace max
 {
@@ -40,6 +43,7 @@ struct message_processor
 
   // Our actual code
   avnd::effect_container<T> implementation;
+  [[no_unique_address]] avnd::shared_controls<T> controls;
 
   // Setup, storage...for the outputs
   [[no_unique_address]] inputs<T> input_setup;
@@ -54,10 +58,13 @@ struct message_processor
   // this breaks aggregate-ness...
   void init(int argc, t_atom* argv)
   {
+    // The @attribute arguments come after the ones of the object
+    const long attrstart = attr_args_offset(short(argc), argv);
+
     /// Pass arguments
     if constexpr (avnd::can_initialize<T>)
     {
-      init_setup.process(implementation.effect, argc, argv);
+      init_setup.process(implementation.effect, int(attrstart), argv);
     }
 
     /// Create ports ///
@@ -72,24 +79,26 @@ struct message_processor
     {
       avnd::init_controls(avnd::get_inputs<T>(implementation));
     }
+
+    /// Then apply the @attribute arguments over the defaults
+    attr_args_process(&x_obj, short(argc), argv);
   }
 
   void destroy() { }
 
+  // The inlets are those of the parameters: inlet is a parameter index
   void process_inlet_control(int inlet, t_atom_long val)
   {
     if constexpr (avnd::has_inputs<T>)
     {
-      avnd::input_introspection<T>::for_nth(
-          avnd::get_inputs<T>(implementation),
-          inlet,
-          [val](auto& field)
+      controls.write(
+          implementation, inlet,
+          [val]<typename C>(C& field)
           {
-            // TODO dangerous if const char*
-            if constexpr (requires { field.value = 0; })
-            {
+            if constexpr (avnd::float_parameter<C> || avnd::int_parameter<C>)
+              avnd::apply_control(field, double(val));
+            else if constexpr (requires { field.value = 0; })
               field.value = val;
-            }
           });
     }
   }
@@ -98,16 +107,14 @@ struct message_processor
   {
     if constexpr (avnd::has_inputs<T>)
     {
-      avnd::input_introspection<T>::for_nth(
-          avnd::get_inputs<T>(implementation),
-          inlet,
-          [val](auto& field)
+      controls.write(
+          implementation, inlet,
+          [val]<typename C>(C& field)
           {
-            // TODO dangerous if const char*
-            if constexpr (requires { field.value = 0; })
-            {
+            if constexpr (avnd::float_parameter<C> || avnd::int_parameter<C>)
+              avnd::apply_control(field, double(val));
+            else if constexpr (requires { field.value = 0; })
               field.value = val;
-            }
           });
     }
   }
@@ -116,13 +123,11 @@ struct message_processor
   {
     if constexpr (avnd::has_inputs<T>)
     {
-      avnd::input_introspection<T>::for_nth(
-          avnd::get_inputs<T>(implementation),
-          inlet,
+      controls.write(
+          implementation, inlet,
           [val](auto& field)
           {
-            // TODO dangerous if const char*
-            if constexpr (requires { field.value = "str"; })
+            if constexpr (avnd::string_parameter<std::decay_t<decltype(field)>>)
             {
               field.value = val->s_name;
             }
@@ -158,10 +163,16 @@ struct message_processor
   {
     // Do our stuff if it makes sense - some objects may not
     // even have a "processing" method
-    if_possible(implementation.effect());
+    {
+      AVND_TRACE_ZONE(T, process);
+      if_possible(implementation.effect());
+    }
 
     // Then bang
-    output_setup.commit(implementation);
+    {
+      AVND_TRACE_ZONE(T, controls);
+      output_setup.commit(implementation);
+    }
   }
 
   template <typename V>
@@ -169,13 +180,32 @@ struct message_processor
   {
     const int inlet = proxy_getinlet(&x_obj);
     // Process the control
-    process_inlet_control(inlet, value);
+    {
+      AVND_TRACE_ZONE(T, parameters);
+      process_inlet_control(inlet, value);
+    }
+
+    process();
+  }
+
+  // Lists of numbers do not need to be looked up among the messages
+  void process_list(t_symbol* s, int argc, t_atom* argv)
+  {
+    if (argc < 1)
+      return;
+
+    const int inlet = proxy_getinlet(&x_obj);
+    {
+      AVND_TRACE_ZONE(T, parameters);
+      process_inlet_control(inlet, s, argc, argv);
+    }
 
     process();
   }
 
   void process(t_symbol* s, int argc, t_atom* argv)
   {
+    AVND_TRACE_ZONE(T, messages);
     const int inlet = proxy_getinlet(&x_obj);
 
     // First try to process messages handled explicitely in the object
@@ -252,6 +282,10 @@ message_processor_metaclass<T>::message_processor_metaclass()
       = +[](instance* obj, t_symbol* s, int argc, t_atom* argv) -> void
   { obj->process(s, argc, argv); };
 
+  constexpr auto obj_process_list
+      = +[](instance* obj, t_symbol* s, int argc, t_atom* argv) -> void
+  { obj->process_list(s, argc, argv); };
+
   constexpr auto obj_process_bang = +[](instance* obj) -> void { obj->process(); };
 
   constexpr auto obj_process_int
@@ -273,13 +307,17 @@ message_processor_metaclass<T>::message_processor_metaclass()
       A_GIMME,
       0);
 
-  // Connect our methods
+  // Connect our methods: numbers go straight to the control of their inlet
   class_addmethod(g_class, (method)obj_process_int, "int", A_LONG, 0);
   class_addmethod(g_class, (method)obj_process_float, "float", A_FLOAT, 0);
   class_addmethod(g_class, (method)obj_process_sym, "symbol", A_SYM, 0);
+  class_addmethod(g_class, (method)obj_process_list, "list", A_GIMME, 0);
   class_addmethod(g_class, (method)obj_process_bang, "bang", A_NOTHING, 0);
   class_addmethod(g_class, (method)obj_process, "anything", A_GIMME, 0);
 
+  // Named controls are also attributes, set without going through "anything"
+  attributes<T>::template register_attributes<instance>(g_class);
+
   class_register(CLASS_BOX, g_class);
 }
 
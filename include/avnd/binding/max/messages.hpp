@@ -4,8 +4,11 @@
 
 #include <avnd/binding/max/atom_iterator.hpp>
 #include <avnd/binding/max/helpers.hpp>
+#include <avnd/common/selector_cache.hpp>
 #include <avnd/introspection/messages.hpp>
 
+#include <array>
+
 namespace max
 {
 template <typename T>
@@ -15,9 +18,9 @@ struct messages
   static void
   call_static(T& implementation, std::string_view name, int argc, t_atom* argv)
   {
-    using refl = avnd::message_reflection<M>;
+    using arg_list_t = avnd::host_message_arguments<M>;
     constexpr auto f = avnd::message_get_func<M>();
-    constexpr auto arg_counts = refl::count;
+    constexpr auto arg_counts = boost::mp11::mp_size<arg_list_t>::value;
 
     if (arg_counts != argc)
     {
@@ -25,8 +28,6 @@ struct messages
       return;
     }
 
-    using arg_list_t = typename refl::arguments;
-
     // Check if all arguments passed are convertible to the expected
     // type of the method:
     const bool can_apply_args = [&]<typename... Args, std::size_t... I>(
@@ -43,30 +44,36 @@ struct messages
     }
 
     // Call the method
-    [&]<typename... Args, std::size_t... I>(
-        boost::mp11::mp_list<Args...>, std::index_sequence<I...>)
+    auto call = [&]<typename... Args, std::size_t... I>(
+        boost::mp11::mp_list<Args...>, std::index_sequence<I...>, auto... frame)
     {
       constexpr auto f = avnd::message_get_func<M>();
       if constexpr (std::is_member_function_pointer_v<decltype(f)>)
       {
-        if constexpr(requires (M m) { m(convert<Args>(argv[I])...); })
-          return M{}(convert<Args>(argv[I])...);
-        else if constexpr(requires { implementation.*f; })
-          return (implementation.*f)(convert<Args>(argv[I])...);
+        if constexpr(requires (M m) { m(convert<Args>(argv[I])..., frame...); })
+          return M{}(convert<Args>(argv[I])..., frame...);
+        else if constexpr(requires { (implementation.*f)(convert<Args>(argv[I])..., frame...); })
+          return (implementation.*f)(convert<Args>(argv[I])..., frame...);
       }
       else
-        return f(convert<Args>(argv[I])...);
-    }
-    (arg_list_t{}, std::make_index_sequence<arg_counts>());
+        return f(convert<Args>(argv[I])..., frame...);
+    };
+
+    // Max gives no position in the signal vector to a message:
+    // the timed ones are due at the start of the next buffer
+    if constexpr (avnd::timed_message<M>)
+      call(arg_list_t{}, std::make_index_sequence<arg_counts>(), 0);
+    else
+      call(arg_list_t{}, std::make_index_sequence<arg_counts>());
   }
 
   template <typename M>
   static void
   call_instance(T& implementation, std::string_view name, int argc, t_atom* argv)
   {
-    using refl = avnd::message_reflection<M>;
+    using arg_list_t = avnd::host_message_arguments<M>;
     constexpr auto f = avnd::message_get_func<M>();
-    constexpr auto arg_counts = refl::count;
+    constexpr auto arg_counts = boost::mp11::mp_size<arg_list_t>::value;
 
     if (arg_counts != (argc + 1))
     {
@@ -74,8 +81,6 @@ struct messages
       return;
     }
 
-    using arg_list_t = typename refl::arguments;
-
     // Check if all arguments passed are convertible to the expected
     // type of the method:
     const bool can_apply_args = [&]<typename... Args, std::size_t... I>(
@@ -92,20 +97,24 @@ struct messages
     }
 
     // Call the method
-    [&]<typename... Args, std::size_t... I>(
-        boost::mp11::mp_list<T&, Args...>, std::index_sequence<I...>)
+    auto call = [&]<typename... Args, std::size_t... I>(
+        boost::mp11::mp_list<T&, Args...>, std::index_sequence<I...>, auto... frame)
     {
       if constexpr (std::is_member_function_pointer_v<decltype(f)>)
       {
-        if constexpr(requires (M m) { m(implementation, convert<Args>(argv[I])...); })
-          return M{}(implementation, convert<Args>(argv[I])...);
-        else if constexpr(requires { implementation.*f; })
-          return (implementation.*f)(implementation, convert<Args>(argv[I])...);
+        if constexpr(requires (M m) { m(implementation, convert<Args>(argv[I])..., frame...); })
+          return M{}(implementation, convert<Args>(argv[I])..., frame...);
+        else if constexpr(requires { (implementation.*f)(implementation, convert<Args>(argv[I])..., frame...); })
+          return (implementation.*f)(implementation, convert<Args>(argv[I])..., frame...);
       }
       else
-        return f(implementation, convert<Args>(argv[I])...);
-    }
-    (arg_list_t{}, std::make_index_sequence<arg_counts - 1>());
+        return f(implementation, convert<Args>(argv[I])..., frame...);
+    };
+
+    if constexpr (avnd::timed_message<M>)
+      call(arg_list_t{}, std::make_index_sequence<arg_counts - 1>(), 0);
+    else
+      call(arg_list_t{}, std::make_index_sequence<arg_counts - 1>());
   }
 
   template <typename M>
@@ -167,24 +176,51 @@ struct messages
     return false;
   }
 
-  static bool process_messages(auto& implementation, t_symbol* s, int argc, t_atom* argv)
+  // One function per message, indexed like the fields of the messages struct
+  template <std::size_t I>
+  static bool dispatch(
+      avnd::effect_container<T>& implementation,
+      std::string_view sym,
+      int argc,
+      t_atom* argv)
+  {
+    auto& field = boost::pfr::get<I>(avnd::get_messages(implementation));
+    return process_message(implementation.effect, field, sym, argc, argv);
+  }
+
+  using dispatch_function
+      = bool (*)(avnd::effect_container<T>&, std::string_view, int, t_atom*);
+
+  static constexpr auto dispatch_table = []
   {
     if constexpr (avnd::has_messages<T>)
     {
-      bool ok = false;
-      std::string_view symname = s->s_name;
-      avnd::messages_introspection<T>::for_all(
-          avnd::get_messages(implementation),
-          [&]<typename M>(M& field)
-          {
-            if (ok)
-              return;
-            if (symname == M::name())
-            {
-              ok = process_message(implementation.effect, field, symname, argc, argv);
-            }
-          });
-      return ok;
+      return []<std::size_t... I>(std::index_sequence<I...>)
+      {
+        return std::array<dispatch_function, sizeof...(I)>{&dispatch<I>...};
+      }
+      (std::make_index_sequence<avnd::messages_introspection<T>::size>{});
+    }
+    else
+    {
+      return std::array<dispatch_function, 0>{};
+    }
+  }();
+
+  // Symbols are interned: once a selector has been seen,
+  // finding its message again does not compare any string
+  avnd::selector_cache<avnd::selector_cache_size(dispatch_table.size())> selectors;
+
+  bool process_messages(avnd::effect_container<T>& implementation, t_symbol* s, int argc, t_atom* argv)
+  {
+    if constexpr (avnd::has_messages<T>)
+    {
+      const int index = selectors.find(
+          s, [s] { return avnd::message_name_table<T>::find(s->s_name); });
+      if (index < 0)
+        return false;
+
+      return dispatch_table[index](implementation, s->s_name, argc, argv);
     }
     return false;
   }
@@ -3,6 +3,10 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <avnd/binding/max/helpers.hpp>
+#include <avnd/concepts/processor.hpp>
+
+#include <bitset>
+#include <utility>
 
 namespace max
 {
@@ -97,19 +101,37 @@ struct outputs
   {
   }
 
+  // Outlets are sent from right to left, as Max objects do
   void commit(avnd::effect_container<T>& implementation)
   {
-    int k = 0;
-    avnd::output_introspection<T>::for_all(
-        avnd::get_outputs<T>(implementation),
-        [this, &k]<typename C>(C& ctl)
-        {
-          if constexpr (requires(float v) { v = ctl.value; })
-          {
-            outlet_float(outlets[k], ctl.value);
-          }
-          ++k;
-        });
+    using info = avnd::output_introspection<T>;
+    if constexpr (info::size > 0)
+    {
+      auto& outs = avnd::get_outputs<T>(implementation);
+      [&]<std::size_t... I>(std::index_sequence<I...>)
+      {
+        constexpr std::size_t last = info::size - 1;
+        (send<last - I>(boost::pfr::get<last - I>(outs)), ...);
+      }
+      (std::make_index_sequence<info::size>{});
+    }
+  }
+
+  template <std::size_t K, typename C>
+  void send(C& ctl)
+  {
+    if constexpr (requires(float v) { v = ctl.value; })
+    {
+      const float v = ctl.value;
+      if constexpr (avnd::changed_outputs_processor<T>)
+      {
+        if (sent.test(K) && last_sent[K] == v)
+          return;
+        sent.set(K);
+        last_sent[K] = v;
+      }
+      outlet_float(outlets[K], v);
+    }
   }
 
   void init(avnd::effect_container<T>& implementation, t_object& x_obj)
@@ -127,6 +149,10 @@ struct outputs
   }
 
   std::array<t_outlet*, avnd::output_introspection<T>::size> outlets;
+
+  // For the processors which only send the changes
+  std::array<float, avnd::output_introspection<T>::size> last_sent{};
+  std::bitset<avnd::output_introspection<T>::size> sent;
 };
 
 }
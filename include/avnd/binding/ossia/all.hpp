@@ -2,3 +2,4 @@
 
 #include <avnd/binding/ossia/mono_audio_node.hpp>
 #include <avnd/binding/ossia/poly_audio_node.hpp>
+#include <avnd/binding/ossia/node_pool.hpp>
@@ -0,0 +1,386 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/ossia/gpu_staging.hpp>
+#include <gpp/commands.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace oscr
+{
+/**
+ * Runs the command streams of a gpp processor (its update(), dispatch() and
+ * release() coroutines, see gpp/commands.hpp) on the GPU backend of the host,
+ * e.g. score's RHI renderer, which handles each command:
+ *
+ *   struct backend
+ *   {
+ *     // One overload per command, returning Command::return_type
+ *     gpp::buffer_handle operator()(const gpp::static_allocation&);
+ *     void operator()(const gpp::static_upload&);
+ *     ...
+ *   };
+ *
+ * The buffers, textures and samplers allocated by the processor are kept by the
+ * backend across frames until the processor releases them. Uploads are only
+ * forwarded when their bytes changed since the last upload of the same range
+ * of the same resource: a processor yielding the same data at each frame
+ * only makes the backend record what actually changed. Processors which set
+ * the generation of their uploads spare the hashing: an upload is then
+ * forwarded only when its generation differs from the last one.
+ *
+ * The dynamic_*_map commands give the processor staging memory to write its
+ * dynamic buffers in directly, see staging_ring. At the end of update() the
+ * copies of the frame are sent at once to the backend if it handles them:
+ *
+ *   // The host calls staging().frame_completed() when the GPU is done with it
+ *   void operator()(const oscr::staging_batch&);
+ *   // Optional: e.g. persistently mapped memory, of size bytes
+ *   char* staging_memory(std::size_t bytes);
+ *
+ * Otherwise they are forwarded as dynamic_*_upload commands pointing in the
+ * staging memory, which is recycled right away.
+ *
+ * Readbacks requested by the processor can be awaited in the same dispatch(),
+ * which stalls until the GPU is done, or kept and polled with buffer_poll /
+ * texture_poll during the next frames, which do not block.
+ *
+ * Consecutive compute_dispatch commands are sent to the backend as one
+ * compute_dispatch_batch if it handles those, instead of one call each.
+ * Batches the processor yields are unrolled for the backends which do not.
+ */
+template <typename T, typename Backend>
+class gpu_node
+{
+public:
+  gpu_node(T& processor, Backend& backend, std::size_t staging_bytes_per_frame = 1 << 20)
+      : m_processor{processor}
+      , m_backend{backend}
+      , m_staging{staging_bytes_per_frame}
+  {
+    if constexpr (requires { m_backend.staging_memory(std::size_t{}); })
+      m_staging.set_memory(m_backend.staging_memory(m_staging.total_bytes()));
+  }
+
+  gpu_node(const gpu_node&) = delete;
+  gpu_node& operator=(const gpu_node&) = delete;
+
+  ~gpu_node() { release(); }
+
+  // Once per frame, before the passes
+  void update()
+  {
+    if constexpr (requires { m_processor.update(); })
+    {
+      m_staging.begin_frame();
+      run(m_processor.update());
+      submit_staging();
+    }
+  }
+
+  // Runs the compute passes of the frame
+  void dispatch()
+  {
+    if constexpr (requires { m_processor.dispatch(); })
+      run(m_processor.dispatch());
+    m_frame++;
+  }
+
+  // Frees the resources of the processor, e.g. when the renderer goes away
+  void release()
+  {
+    if constexpr (requires { m_processor.release(); })
+      run(m_processor.release());
+    m_uploads.clear();
+    m_readbacks.clear();
+  }
+
+  // Number of uploads which were not forwarded as their data did not change
+  int64_t skipped_uploads() const noexcept { return m_skipped_uploads; }
+
+  staging_ring<>& staging() noexcept { return m_staging; }
+
+  // Frames after which a polled readback is fetched, see poll_readback
+  static constexpr int64_t readback_latency = 2;
+  static constexpr int readback_slots = 3;
+
+private:
+  struct upload_record
+  {
+    const void* resource{};
+    int offset{};
+    int size{};
+    uint64_t hash{};
+    gpp::upload_generation generation{};
+  };
+
+  struct readback_record
+  {
+    const void* awaiter{};
+    const void* source{};
+    int64_t frame{};
+  };
+
+  static uint64_t hash(const void* data, int size) noexcept
+  {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (int i = 0; i < size; i++)
+    {
+      h ^= bytes[i];
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+
+  // True if the same bytes were already uploaded there
+  template <typename Command>
+  bool unchanged(const Command& cmd) noexcept
+  {
+    if (!cmd.data || cmd.size <= 0)
+      return false;
+
+    auto it = std::find_if(m_uploads.begin(), m_uploads.end(), [&](const upload_record& r) {
+      return r.resource == cmd.handle && r.offset == cmd.offset && r.size == cmd.size;
+    });
+
+    gpp::upload_generation generation{};
+    if constexpr (requires { cmd.generation; })
+      generation = cmd.generation;
+
+    if (generation != 0)
+    {
+      if (it == m_uploads.end())
+      {
+        m_uploads.push_back({cmd.handle, cmd.offset, cmd.size, 0, generation});
+        return false;
+      }
+      if (it->generation == generation)
+        return true;
+
+      it->generation = generation;
+      return false;
+    }
+
+    const uint64_t h = hash(cmd.data, cmd.size);
+    if (it == m_uploads.end())
+    {
+      m_uploads.push_back({cmd.handle, cmd.offset, cmd.size, h, 0});
+      return false;
+    }
+    if (it->generation == 0 && it->hash == h)
+      return true;
+
+    it->hash = h;
+    it->generation = 0;
+    return false;
+  }
+
+  template <typename Command>
+  auto execute(const Command& cmd)
+  {
+    if constexpr (requires { Command::upload; })
+    {
+      if (unchanged(cmd))
+      {
+        m_skipped_uploads++;
+        return;
+      }
+      return m_backend(cmd);
+    }
+    else if constexpr (requires { Command::map; })
+    {
+      constexpr auto target = requires { Command::ubo; } ? staging_target::ubo
+                              : requires { Command::index; } ? staging_target::index
+                                                               : staging_target::vertex;
+      char* data = m_staging.allocate(cmd.handle, target, cmd.offset, cmd.size);
+      return gpp::mapped_range{data, data ? std::size_t(cmd.size) : 0};
+    }
+    else if constexpr (requires { Command::deallocation; })
+    {
+      std::erase_if(m_uploads, [&](const upload_record& r) { return r.resource == cmd.handle; });
+      if constexpr (std::is_same_v<decltype(cmd.handle), gpp::buffer_handle>)
+        m_staging.discard(cmd.handle);
+      std::erase_if(m_readbacks, [&](const readback_record& r) { return r.source == cmd.handle; });
+      return m_backend(cmd);
+    }
+    else if constexpr (requires { Command::request; })
+    {
+      return request_readback(cmd);
+    }
+    else if constexpr (requires { Command::poll; })
+    {
+      return poll_readback(cmd);
+    }
+    else if constexpr (requires { Command::await; })
+    {
+      if (!cmd.handle)
+        return typename Command::return_type{};
+      forget_readback(cmd.handle);
+      return m_backend(cmd);
+    }
+    else
+    {
+      return m_backend(cmd);
+    }
+  }
+
+  // At most readback_slots readbacks of a same resource are in flight: the
+  // next ones get an empty awaiter until one of them is fetched.
+  template <typename Command>
+  auto request_readback(const Command& cmd)
+  {
+    using awaiter = typename Command::return_type;
+    const auto pending = std::count_if(
+        m_readbacks.begin(), m_readbacks.end(),
+        [&](const readback_record& r) { return r.source == cmd.handle; });
+    if (pending >= readback_slots)
+      return awaiter{};
+
+    awaiter res = m_backend(cmd);
+    if (res.handle)
+      m_readbacks.push_back({res.handle, cmd.handle, m_frame});
+    return res;
+  }
+
+  // Never blocks: backends which cannot tell whether a readback is done only
+  // get asked for the result once readback_latency frames went by since the
+  // request, when the GPU is done with it.
+  template <typename Command>
+  auto poll_readback(const Command& cmd)
+  {
+    using view = typename Command::return_type;
+    if (!cmd.awaiter.handle)
+      return view{};
+
+    if constexpr (requires { m_backend(cmd); })
+    {
+      view res = m_backend(cmd);
+      if (res.data)
+        forget_readback(cmd.awaiter.handle);
+      return res;
+    }
+    else
+    {
+      auto it = std::find_if(m_readbacks.begin(), m_readbacks.end(), [&](const readback_record& r) {
+        return r.awaiter == cmd.awaiter.handle;
+      });
+      if (it == m_readbacks.end() || m_frame - it->frame < readback_latency)
+        return view{};
+
+      m_readbacks.erase(it);
+      return view(m_backend(cmd.awaiter));
+    }
+  }
+
+  void forget_readback(const void* awaiter) noexcept
+  {
+    std::erase_if(m_readbacks, [=](const readback_record& r) { return r.awaiter == awaiter; });
+  }
+
+  void submit_staging()
+  {
+    const auto batch = m_staging.end_frame();
+    if (batch.count == 0)
+      return;
+
+    if constexpr (requires { m_backend(batch); })
+    {
+      m_backend(batch);
+    }
+    else
+    {
+      for (std::size_t i = 0; i < batch.count; i++)
+      {
+        const auto& c = batch.copies[i];
+        void* data = const_cast<char*>(batch.memory + c.source);
+        switch (c.target)
+        {
+          case staging_target::vertex:
+            m_backend(gpp::dynamic_vertex_upload{c.resource, c.offset, c.size, data});
+            break;
+          case staging_target::index:
+            m_backend(gpp::dynamic_index_upload{c.resource, c.offset, c.size, data});
+            break;
+          case staging_target::ubo:
+            m_backend(gpp::dynamic_ubo_upload{c.resource, c.offset, c.size, data});
+            break;
+        }
+      }
+      m_staging.frame_completed();
+    }
+  }
+
+  static constexpr bool batches_dispatches
+      = requires(Backend& b, const gpp::compute_dispatch_batch& batch) { b(batch); };
+
+  void dispatch_batch(const gpp::compute_dispatch_batch& batch)
+  {
+    if (batch.count <= 0)
+      return;
+
+    if constexpr (batches_dispatches)
+    {
+      m_backend(batch);
+    }
+    else
+    {
+      for (int i = 0; i < batch.count; i++)
+        m_backend(batch.dispatches[i]);
+    }
+  }
+
+  void flush_dispatches()
+  {
+    if (m_dispatches.empty())
+      return;
+    dispatch_batch({m_dispatches.data(), int(m_dispatches.size())});
+    m_dispatches.clear();
+  }
+
+  template <typename Generator>
+  void run(Generator&& gen)
+  {
+    for (auto& promise : gen)
+    {
+      std::visit(
+          [&]<typename Command>(const Command& cmd) {
+            using ret = typename Command::return_type;
+            if constexpr (std::is_same_v<Command, gpp::compute_dispatch> && batches_dispatches)
+            {
+              // Kept until the next command which is not a dispatch
+              m_dispatches.push_back(cmd);
+              return;
+            }
+            else
+            {
+              flush_dispatches();
+              if constexpr (std::is_same_v<Command, gpp::compute_dispatch_batch>)
+                dispatch_batch(cmd);
+              else if constexpr (std::is_void_v<ret>)
+                execute(cmd);
+              else
+                promise.feedback_value = execute(cmd);
+            }
+          },
+          promise.current_command);
+    }
+    flush_dispatches();
+  }
+
+  T& m_processor;
+  Backend& m_backend;
+  std::vector<upload_record> m_uploads;
+  staging_ring<> m_staging;
+  std::vector<readback_record> m_readbacks;
+  std::vector<gpp::compute_dispatch> m_dispatches;
+  int64_t m_frame{};
+  int64_t m_skipped_uploads{};
+};
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/wrappers/background_worker.hpp>
+#include <gpp/layout.hpp>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace oscr
+{
+/**
+ * Identifies the compiled pipeline of a gpp processor: its shader sources,
+ * the interface its layout declares (see gpp::layout_hash) and the driver the
+ * pipeline was compiled for.
+ */
+struct pipeline_key
+{
+  uint64_t shaders{};
+  uint64_t layout{};
+  uint64_t driver{};
+
+  bool operator==(const pipeline_key&) const noexcept = default;
+
+  std::string file_name() const
+  {
+    char buf[64];
+    std::snprintf(
+        buf, sizeof(buf), "%016" PRIx64 "%016" PRIx64 "%016" PRIx64 ".pipeline", shaders, layout,
+        driver);
+    return buf;
+  }
+};
+
+// driver: e.g. the API, device and driver version reported by the backend
+template <typename T>
+pipeline_key make_pipeline_key(T& processor, std::string_view driver)
+{
+  auto hash = [](uint64_t& h, std::string_view str) { gpp::detail::hash_name(h, str); };
+
+  pipeline_key key{14695981039346656037ull, 0, 14695981039346656037ull};
+  if constexpr (requires { processor.vertex(); })
+    hash(key.shaders, processor.vertex());
+  if constexpr (requires { processor.fragment(); })
+    hash(key.shaders, processor.fragment());
+  if constexpr (requires { processor.compute(); })
+    hash(key.shaders, processor.compute());
+  if constexpr (requires { typename T::layout; })
+    key.layout = gpp::layout_hash<typename T::layout>();
+  hash(key.driver, driver);
+  return key;
+}
+
+/**
+ * Compiled pipelines of the gpp processors, kept on disk across runs: one file
+ * per pipeline_key in a directory, all loaded when the cache is opened.
+ *
+ * The backend asks for the pipeline of a node with request(), which starts
+ * compiling it on a background thread if it is not known yet. Until it is ready,
+ * the node is drawn with a fallback, e.g. its input passed through:
+ *
+ *   if (auto blob = cache.request(key, [&] { return compile(shaders); }))
+ *     draw_with(*blob);
+ *   else
+ *     draw_fallback();
+ *
+ * The blobs are whatever the backend needs to recreate its pipeline quickly,
+ * e.g. serialized shaders or driver pipeline cache data.
+ */
+class pipeline_cache
+{
+public:
+  using blob = std::vector<char>;
+
+  explicit pipeline_cache(
+      std::filesystem::path directory,
+      int threads = std::max(1, int(std::thread::hardware_concurrency()) / 2))
+      : m_directory{std::move(directory)}
+      , m_workers(std::max(threads, 1))
+  {
+    for (auto& w : m_workers)
+      w = std::make_unique<avnd::background_worker>();
+    load();
+  }
+
+  pipeline_cache(const pipeline_cache&) = delete;
+  pipeline_cache& operator=(const pipeline_cache&) = delete;
+
+  // The workers are stopped first, i.e. the pending compilations are dropped
+  ~pipeline_cache() { m_workers.clear(); }
+
+  // Null while the pipeline is being compiled or if compiling it failed:
+  // compile() returns an empty blob on failure, which is not retried.
+  std::shared_ptr<const blob>
+  request(const pipeline_key& key, std::function<blob()> compile)
+  {
+    const auto name = key.file_name();
+    {
+      std::lock_guard lock{m_mutex};
+      auto [it, inserted] = m_entries.try_emplace(name);
+      if (!inserted)
+        return it->second;
+    }
+
+    auto& worker = *m_workers[m_next++ % m_workers.size()];
+    worker.post([this, name, compile = std::move(compile)] {
+      auto res = std::make_shared<const blob>(compile());
+      if (!res->empty())
+        store(name, *res);
+
+      std::lock_guard lock{m_mutex};
+      m_entries[name] = res->empty() ? nullptr : std::move(res);
+    });
+    return nullptr;
+  }
+
+  // Forgets everything, e.g. when the user asks to recompile the shaders
+  void clear()
+  {
+    std::lock_guard lock{m_mutex};
+    m_entries.clear();
+    std::error_code ec;
+    for (auto& file : std::filesystem::directory_iterator{m_directory, ec})
+      if (file.path().extension() == ".pipeline")
+        std::filesystem::remove(file.path(), ec);
+  }
+
+private:
+  void load()
+  {
+    std::error_code ec;
+    for (auto& file : std::filesystem::directory_iterator{m_directory, ec})
+    {
+      if (file.path().extension() != ".pipeline")
+        continue;
+
+      std::ifstream in{file.path(), std::ios::binary};
+      blob data{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+      if (!data.empty())
+        m_entries[file.path().filename().string()]
+            = std::make_shared<const blob>(std::move(data));
+    }
+  }
+
+  // Written aside then renamed, so that a crash does not leave a truncated file
+  void store(const std::string& name, const blob& data)
+  {
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+
+    const auto tmp = m_directory / (name + ".tmp");
+    {
+      std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+      out.write(data.data(), std::streamsize(data.size()));
+      if (!out)
+        return;
+    }
+    std::filesystem::rename(tmp, m_directory / name, ec);
+  }
+
+  std::filesystem::path m_directory;
+  std::mutex m_mutex;
+  std::unordered_map<std::string, std::shared_ptr<const blob>> m_entries;
+  std::vector<std::unique_ptr<avnd::background_worker>> m_workers;
+  std::size_t m_next{};
+};
+}
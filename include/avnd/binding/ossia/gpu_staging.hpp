@@ -0,0 +1,162 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <gpp/commands.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace oscr
+{
+enum class staging_target
+{
+  vertex,
+  index,
+  ubo
+};
+
+// A copy from the staging memory of a frame to a dynamic buffer
+struct staging_copy
+{
+  gpp::buffer_handle resource{};
+  staging_target target{};
+  int offset{};
+  int size{};
+  std::size_t source{};
+};
+
+// What the backend has to copy at the end of a frame
+struct staging_batch
+{
+  const char* memory{};
+  const staging_copy* copies{};
+  std::size_t count{};
+  int64_t frame{};
+};
+
+/**
+ * Staging memory for the dynamic_*_map commands, split in one slice per frame
+ * in flight. The processors write in the slice of the current frame, the
+ * backend copies from it once the frame is submitted: a slice is only written
+ * again once the host reports that the GPU is done with that frame, e.g. when
+ * its fence is signaled.
+ *
+ * The memory is either provided by the backend, e.g. persistently mapped
+ * host-visible memory, or allocated here.
+ */
+template <int FramesInFlight = 3>
+class staging_ring
+{
+  static_assert(FramesInFlight > 0);
+
+public:
+  static constexpr std::size_t alignment = 16;
+
+  explicit staging_ring(std::size_t bytes_per_frame = 1 << 20)
+      : m_frame_bytes{(bytes_per_frame + alignment - 1) / alignment * alignment}
+  {
+    m_copies.reserve(64);
+  }
+
+  std::size_t frame_bytes() const noexcept { return m_frame_bytes; }
+  std::size_t total_bytes() const noexcept { return m_frame_bytes * FramesInFlight; }
+
+  // total_bytes() of memory which outlives the ring
+  void set_memory(char* memory) noexcept
+  {
+    m_owned.reset();
+    m_memory = memory;
+  }
+
+  // False if the GPU still uses the slice of the next frame: allocate() then fails
+  bool begin_frame()
+  {
+    if (!m_memory)
+    {
+      m_owned = std::make_unique<char[]>(total_bytes());
+      m_memory = m_owned.get();
+    }
+
+    m_copies.clear();
+    m_used = 0;
+    m_writable = m_submitted - m_completed < FramesInFlight;
+    return m_writable;
+  }
+
+  char* allocate(gpp::buffer_handle resource, staging_target target, int offset, int size) noexcept
+  {
+    if (!m_writable || !resource || size <= 0 || std::size_t(size) > m_frame_bytes - m_used)
+      return nullptr;
+
+    const std::size_t source = slice() + m_used;
+    m_used = std::min(m_frame_bytes, m_used + (size + alignment - 1) / alignment * alignment);
+    m_copies.push_back({resource, target, offset, size, source});
+    return m_memory + source;
+  }
+
+  // Drops the copies to a buffer which is released before the end of the frame
+  void discard(gpp::buffer_handle resource) noexcept
+  {
+    std::erase_if(m_copies, [=](const staging_copy& c) { return c.resource == resource; });
+  }
+
+  // The copies of the frame, merged when they are contiguous in both the
+  // staging memory and the buffer. The slice is in use until frame_completed().
+  staging_batch end_frame()
+  {
+    if (!m_writable)
+      return {m_memory, nullptr, 0, m_submitted};
+    m_writable = false;
+
+    std::sort(m_copies.begin(), m_copies.end(), [](const staging_copy& a, const staging_copy& b) {
+      return a.resource != b.resource ? a.resource < b.resource : a.offset < b.offset;
+    });
+
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < m_copies.size(); i++)
+    {
+      const auto& c = m_copies[i];
+      if (n > 0)
+      {
+        auto& prev = m_copies[n - 1];
+        if (prev.resource == c.resource && prev.offset + prev.size == c.offset
+            && prev.source + prev.size == c.source)
+        {
+          prev.size += c.size;
+          continue;
+        }
+      }
+      m_copies[n++] = c;
+    }
+    m_copies.resize(n);
+
+    // Nothing to wait for if nothing was written
+    if (n == 0)
+      return {m_memory, nullptr, 0, m_submitted};
+    return {m_memory, m_copies.data(), m_copies.size(), m_submitted++};
+  }
+
+  // The GPU finished reading the oldest frame in flight
+  void frame_completed() noexcept
+  {
+    if (m_completed < m_submitted)
+      m_completed++;
+  }
+
+private:
+  std::size_t slice() const noexcept { return (m_submitted % FramesInFlight) * m_frame_bytes; }
+
+  std::unique_ptr<char[]> m_owned;
+  char* m_memory{};
+  std::size_t m_frame_bytes{};
+  std::size_t m_used{};
+  std::vector<staging_copy> m_copies;
+  int64_t m_submitted{};
+  int64_t m_completed{};
+  bool m_writable{};
+};
+}
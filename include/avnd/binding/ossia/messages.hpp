@@ -0,0 +1,138 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/ossia/port_run_preprocess.hpp>
+#include <avnd/common/span_polyfill.hpp>
+#include <avnd/concepts/message.hpp>
+
+#include <boost/mp11.hpp>
+
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace oscr
+{
+// Types of the message arguments which can be read from an ossia::value
+template <typename A>
+concept ossia_message_argument
+    = std::is_arithmetic_v<A> || std::is_same_v<A, std::string>
+      || (std::is_aggregate_v<A> && !std::is_array_v<A> && boost::pfr::tuple_size_v<A> >= 2
+          && boost::pfr::tuple_size_v<A> <= 4);
+
+template <typename Args>
+inline constexpr bool ossia_message_arguments = false;
+template <typename... Args>
+inline constexpr bool ossia_message_arguments<boost::mp11::mp_list<Args...>>
+    = (ossia_message_argument<Args> && ...);
+
+// void f(std::span<const float>) or void f(std::span<const std::tuple<float, int>>)
+template <typename A>
+struct message_batch_argument
+{
+  static constexpr bool value = false;
+  using element = void;
+};
+template <typename E>
+struct message_batch_argument<avnd::span<const E>>
+{
+  static constexpr bool value = true;
+  using element = E;
+};
+
+template <typename E>
+inline constexpr bool message_batch_of_tuples = false;
+template <typename... Args>
+inline constexpr bool message_batch_of_tuples<std::tuple<Args...>> = true;
+
+/**
+ * How a message gets called from the values received on its inlet:
+ * - f(T&, args...) and f(args...): one value per call, a list when there are
+ *   several arguments.
+ * - f([T&,] std::span<const E>): a batch, once per tick with all the values
+ *   of the tick, E being an argument or a std::tuple of arguments.
+ * - f([T&,] args..., int frame) for a timed message: one value per call,
+ *   with its timestamp in the tick.
+ */
+template <typename T, typename M>
+struct message_signature
+{
+  static constexpr bool takes_self = false;
+  static constexpr bool convertible = false;
+  static constexpr bool batch = false;
+  using values = std::tuple<>;
+  using batch_storage = std::monostate;
+};
+
+template <typename T, typename M>
+requires(!std::is_void_v<avnd::message_reflection<M>>)
+struct message_signature<T, M>
+{
+  using arguments = typename avnd::message_reflection<M>::arguments;
+
+  static constexpr bool takes_self = []
+  {
+    if constexpr (boost::mp11::mp_empty<arguments>::value)
+      return false;
+    else
+      return std::is_same_v<boost::mp11::mp_first<arguments>, T&>;
+  }();
+
+  // The frame of a timed message is passed by the node, see avnd::timed_message
+  static constexpr bool timed = avnd::timed_message<M>;
+
+  using value_arguments = boost::mp11::mp_transform<
+      std::remove_cvref_t,
+      boost::mp11::mp_drop_c<avnd::host_message_arguments<M>, takes_self ? 1 : 0>>;
+
+  static constexpr bool convertible = ossia_message_arguments<value_arguments>;
+  using values = boost::mp11::mp_rename<value_arguments, std::tuple>;
+
+  using batch_argument = message_batch_argument<boost::mp11::mp_eval_if_c<
+      boost::mp11::mp_size<value_arguments>::value != 1, void, boost::mp11::mp_first,
+      value_arguments>>;
+  using batch_element = typename batch_argument::element;
+  static constexpr bool batch_of_tuples = message_batch_of_tuples<batch_element>;
+
+  static constexpr bool batch = []
+  {
+    if constexpr (!batch_argument::value || timed)
+      return false;
+    else if constexpr (batch_of_tuples)
+      return ossia_message_arguments<boost::mp11::mp_rename<batch_element, boost::mp11::mp_list>>;
+    else
+      return ossia_message_argument<batch_element>;
+  }();
+
+  using batch_storage
+      = std::conditional_t<batch, std::vector<batch_element>, std::monostate>;
+};
+
+// Reads the arguments of a message call, several arguments being sent as a list
+template <typename... Args>
+bool message_arguments(const ossia::value& v, std::tuple<Args...>& args)
+{
+  if constexpr (sizeof...(Args) == 0)
+  {
+    return true;
+  }
+  else if constexpr (sizeof...(Args) == 1)
+  {
+    from_ossia_value(v, std::get<0>(args));
+    return true;
+  }
+  else
+  {
+    auto* list = v.target<std::vector<ossia::value>>();
+    if (!list || list->size() < sizeof...(Args))
+      return false;
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+      (from_ossia_value((*list)[I], std::get<I>(args)), ...);
+    }(std::index_sequence_for<Args...>{});
+    return true;
+  }
+}
+}
@@ -27,11 +27,7 @@ public:
   bool scan_audio_input_channels()
   {
     const int current_input_channels = this->channels.actual_runtime_inputs;
-    for (auto& chan : *audio_inlet())
-    {
-      if (chan.size() < this->buffer_size)
-        chan.resize(this->buffer_size);
-    }
+    this->reserve_frames(*audio_inlet());
 
     int port_input_channels = audio_inlet()->channels();
     int port_output_channels = audio_outlet()->channels();
@@ -51,6 +47,7 @@ public:
 
   void run(const ossia::token_request& tk, ossia::exec_state_facade st) noexcept override
   {
+    AVND_TRACE_ZONE(T, callback);
     auto [start, frames] = st.timings(tk);
 
     if (!this->prepare_run(start, frames))
@@ -65,22 +62,21 @@ public:
     // Initialize audio ports
     const int current_input_channels = this->channels.actual_runtime_inputs;
     const int current_output_channels = this->channels.actual_runtime_outputs;
-    const double** audio_ins
-        = (const double**)alloca(sizeof(double*) * (1 + current_input_channels));
-    double** audio_outs
-        = (double**)alloca(sizeof(double*) * (1 + current_output_channels));
-
-    std::fill_n(audio_ins, 1 + current_input_channels, nullptr);
-    std::fill_n(audio_outs, 1 + current_output_channels, nullptr);
-    for (int i = 0; i < current_input_channels; i++)
+    if (this->audio_channels_changed)
     {
-      audio_ins[i] = audio_in.channel(i).data();
-      audio_outs[i] = audio_out.channel(i).data();
+      this->resize_audio_channels(current_input_channels, current_output_channels);
+      for (int i = 0; i < current_input_channels; i++)
+      {
+        this->audio_in_channels[i] = audio_in.channel(i).data();
+        this->audio_out_channels[i] = audio_out.channel(i).data();
+      }
     }
 
+    const double** audio_ins = this->audio_in_channels.data();
+    double** audio_outs = this->audio_out_channels.data();
+
     // Run
-    this->processor.process(
-        this->impl,
+    this->process_audio(
         avnd::span<double*>{
             const_cast<double**>(audio_ins), std::size_t(current_input_channels)},
         avnd::span<double*>{audio_outs, std::size_t(current_output_channels)},
@@ -1,5 +1,6 @@
 #pragma once
 #include <avnd/binding/ossia/configure.hpp>
+#include <avnd/binding/ossia/messages.hpp>
 #include <avnd/binding/ossia/port_run_postprocess.hpp>
 #include <avnd/binding/ossia/port_run_preprocess.hpp>
 #include <avnd/binding/ossia/port_setup.hpp>
@@ -13,19 +14,44 @@
 #include <avnd/wrappers/audio_channel_manager.hpp>
 #include <avnd/wrappers/bus_host_process_adapter.hpp>
 #include <avnd/wrappers/callbacks_adapter.hpp>
+#include <avnd/wrappers/changed_controls.hpp>
 #include <avnd/wrappers/control_display.hpp>
 #include <avnd/wrappers/controls.hpp>
 #include <avnd/wrappers/controls_double.hpp>
+#include <avnd/wrappers/controls_mirror.hpp>
 #include <avnd/wrappers/controls_storage.hpp>
+#include <avnd/wrappers/deadline.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/latency.hpp>
+#include <avnd/wrappers/message_bus.hpp>
 #include <avnd/wrappers/metadatas.hpp>
-#include <avnd/wrappers/process_adapter.hpp>
+#include <avnd/wrappers/morph.hpp>
+#include <avnd/wrappers/optional_busses.hpp>
+#include <avnd/wrappers/profiling.hpp>
+#include <avnd/wrappers/quality_governor.hpp>
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+#include <avnd/wrappers/render_mode.hpp>
+#include <avnd/wrappers/silence.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
+#include <avnd/wrappers/smoothing_storage.hpp>
+#include <avnd/wrappers/soundfile_recorder.hpp>
+#include <avnd/wrappers/soundfile_stream.hpp>
+#include <avnd/wrappers/sub_block_scheduler.hpp>
+#include <avnd/wrappers/texture_passthrough.hpp>
+#include <avnd/wrappers/texture_pool.hpp>
+#include <avnd/wrappers/texture_tiles.hpp>
+#include <avnd/wrappers/tracing.hpp>
 #include <avnd/wrappers/widgets.hpp>
-#include <boost/smart_ptr/atomic_shared_ptr.hpp>
+#include <avnd/wrappers/worker.hpp>
 #include <ossia/dataflow/audio_port.hpp>
 #include <ossia/dataflow/graph_node.hpp>
 #include <ossia/dataflow/node_process.hpp>
 #include <ossia/dataflow/port.hpp>
 #include <ossia/detail/for_each_in_tuple.hpp>
+
+#include <atomic>
+
 namespace oscr
 {
 /*
@@ -95,11 +121,37 @@ static void safety_checks(const ossia::token_request& tk, ossia::exec_state_faca
 
 // void process(double** in, double** out, int N)
 
+/**
+ * What the UI of a node uses from its own thread, polling at its frame rate:
+ * it never waits for the audio thread, which publishes the changed controls
+ * at most once per tick and applies the ones sent by the UI at the next tick.
+ */
+template <typename T>
 struct ui_communication
 {
-  // Sends and receives info from the processor, e.g. audio signal, controls
+  avnd::controls_mirror<T>& controls;
+
+  // Sets the N-th input control, sent with the others at the next send()
+  template <std::size_t N, typename V>
+  void set_control(V&& value)
+  {
+    controls.from_ui.template set<N>(std::forward<V>(value));
+  }
+
+  void send() { controls.from_ui.send(); }
+
+  // f(const tuple& values, std::bitset changed), if controls changed since the last call
+  template <typename F>
+  bool poll_inputs(F&& f)
+  {
+    return controls.inputs.consume(std::forward<F>(f));
+  }
 
-  // Sets the controls from the UI
+  template <typename F>
+  bool poll_outputs(F&& f)
+  {
+    return controls.outputs.consume(std::forward<F>(f));
+  }
 };
 
 template <typename T>
@@ -136,61 +188,49 @@ struct builtin_message_value_ports
 template <typename T>
 requires(avnd::messages_introspection<T>::size > 0) struct builtin_message_value_ports<T>
 {
+  // Enough for bursts of network messages without allocating in the audio thread
+  static constexpr int reserved_batch_size = 1024;
+
+  template <typename M>
+  using batch_storage = typename message_signature<T, M>::batch_storage;
+
   ossia::value_inlet message_inlets[avnd::messages_introspection<T>::size];
+
+  // The arguments of the batch messages, see message_signature
+  boost::mp11::mp_transform<batch_storage, avnd::as_tuple<typename avnd::messages_type<T>::type>>
+      batches;
+
   void init(ossia::inlets& inlets)
   {
     for (auto& in : message_inlets)
     {
       inlets.push_back(&in);
     }
+
+    std::apply(
+        [](auto&... b) {
+          ((
+               [&] {
+                 if constexpr (requires { b.reserve(1); })
+                   b.reserve(reserved_batch_size);
+               }()),
+           ...);
+        },
+        batches);
   }
 };
 
 template <typename Field>
 using controls_type = std::decay_t<decltype(Field::value)>;
 
+// Control-rate processors which opted in with avnd::pure_controls_processor
+// are only run on the ticks where some of their inputs changed
 template <typename T>
-using atomic_shared_ptr = boost::atomic_shared_ptr<T>;
-
-template <typename T>
-struct controls_mirror
-{
-  static constexpr int i_size = avnd::control_input_introspection<T>::size;
-  static constexpr int o_size = avnd::control_output_introspection<T>::size;
-  using i_tuple
-      = avnd::filter_and_apply<controls_type, avnd::control_input_introspection, T>;
-  using o_tuple
-      = avnd::filter_and_apply<controls_type, avnd::control_output_introspection, T>;
-
-  controls_mirror()
-  {
-    inputs.load(new i_tuple);
-    outputs.load(new o_tuple);
-  }
-
-  [[no_unique_address]] atomic_shared_ptr<i_tuple> inputs;
-  [[no_unique_address]] atomic_shared_ptr<o_tuple> outputs;
-
-  std::bitset<i_size> inputs_bits;
-  std::bitset<o_size> outputs_bits;
-};
+inline constexpr bool skips_idle_runs
+    = avnd::pure_controls_processor<T> && !avnd::float_processor<T>
+      && !avnd::double_processor<T> && avnd::midi_input_introspection<T>::size == 0
+      && avnd::midi_output_introspection<T>::size == 0;
 
-template <typename T>
-struct controls_queue
-{
-  static constexpr int i_size = avnd::control_input_introspection<T>::size;
-  static constexpr int o_size = avnd::control_output_introspection<T>::size;
-  using i_tuple
-      = avnd::filter_and_apply<controls_type, avnd::control_input_introspection, T>;
-  using o_tuple
-      = avnd::filter_and_apply<controls_type, avnd::control_output_introspection, T>;
-
-  moodycamel::ConcurrentQueue<i_tuple> ins_queue;
-  moodycamel::ConcurrentQueue<o_tuple> outs_queue;
-
-  std::bitset<i_size> inputs_set;
-  std::bitset<o_size> outputs_set;
-};
 template <typename T>
 class safe_node_base_base : public ossia::nonowning_graph_node
 {
@@ -213,7 +253,7 @@ public:
 
   [[no_unique_address]] outlet_storage<T> ossia_outlets;
 
-  [[no_unique_address]] avnd::process_adapter<T> processor;
+  [[no_unique_address]] avnd::host_process_adapter<T> processor;
 
   [[no_unique_address]] avnd::audio_channel_manager<T> channels;
 
@@ -221,19 +261,107 @@ public:
 
   [[no_unique_address]] avnd::control_storage<T> control_buffers;
 
+  // The timed control changes are written once, see apply_control_change
+  [[no_unique_address]] avnd::shared_controls<T> controls;
+
+  [[no_unique_address]] avnd::smoothing_storage<T> smoothing;
+
+  [[no_unique_address]] avnd::changed_controls_storage<T> changed_controls;
+
+  [[no_unique_address]] avnd::morph_storage<T> morphing;
+  [[no_unique_address]] avnd::worker_storage<T> worker;
+  [[no_unique_address]] avnd::message_bus_storage<T> messages;
+
   [[no_unique_address]] avnd::callback_storage<T> callbacks;
 
   [[no_unique_address]] oscr::soundfile_storage<T> soundfiles;
 
-  // [[no_unique_address]]
-  // controls_mirror<T> feedback;
+  [[no_unique_address]] avnd::soundfile_stream_storage<T> soundfile_streams;
+  [[no_unique_address]] avnd::soundfile_recorder_storage<T> soundfile_recorders;
+
+  // The memory of the CPU texture outputs, uploaded from by the GPU host
+  [[no_unique_address]] avnd::texture_output_storage<T> texture_outputs;
+
+  // For the GPU host: the texture inputs to read back before the next frame,
+  // see avnd/wrappers/texture_passthrough.hpp
+  uint64_t texture_readbacks() noexcept { return avnd::texture_readbacks(this->impl); }
+
+  // Changed controls are sent to the UI through this
+  [[no_unique_address]] avnd::controls_mirror<T> control;
+
+  // Time spent in each phase of the ticks, when built with AVND_PROFILING
+  [[no_unique_address]] avnd::node_profile profile{avnd::get_name<T>()};
 
-  [[no_unique_address]] controls_queue<T> control;
+  // Callbacks over their time budget, when built with AVND_DEADLINE_MONITOR
+  [[no_unique_address]] avnd::deadline_monitor deadlines{avnd::get_name<T>()};
+
+  // Lowers the quality of the processors which have levels when the ticks take too long
+  [[no_unique_address]] avnd::quality_governor<T> governor;
+
+  // The setup of the last prepare, to tell the processor what changed in the next one
+  avnd::process_setup current_setup{};
+
+  // Written by the audio thread after each tick, read by the delay compensation of the host
+  std::atomic<int64_t> current_latency{};
+  std::atomic<double> current_tail{};
+
+  // Set by the host from any thread, e.g. during an offline export
+  avnd::render_mode_request render_request;
+  void set_render_mode(avnd::render_mode mode) noexcept { render_request.set(mode); }
+
+  struct control_change
+  {
+    int index{};
+    const ossia::value* value{};
+  };
+
+  // Timed control changes, when the buffers get split (see avnd::splits_on_control_changes)
+  [[no_unique_address]] avnd::sub_block_scheduler<control_change> control_changes;
+
+  // Pointers to the channels of the audio ports, given to the processor at each tick.
+  // They are only rebuilt when the ports got new channels or buffers (see set_channels),
+  // in storage reserved for enough channels to not allocate in the audio thread.
+  static constexpr int reserved_audio_channels = 64;
+  std::vector<const double*> audio_in_channels;
+  std::vector<double*> audio_out_channels;
+  // Used when splitting the buffers: the inputs, then the outputs
+  std::vector<double*> audio_sub_channels;
+  bool audio_channels_changed{true};
+
+  // The most channels the host said the ports may get, see reserve_channels
+  int max_input_channels{};
+  int max_output_channels{};
+
+  void reserve_audio_channels()
+  {
+    audio_in_channels.reserve(1 + reserved_audio_channels);
+    audio_out_channels.reserve(1 + reserved_audio_channels);
+    audio_sub_channels.reserve(2 + 2 * reserved_audio_channels);
+  }
+
+  // Sized for the current channel counts, to be filled by the node
+  void resize_audio_channels(int inputs, int outputs)
+  {
+    audio_in_channels.assign(1 + inputs, nullptr);
+    audio_out_channels.assign(1 + outputs, nullptr);
+    audio_sub_channels.assign(2 + inputs + outputs, nullptr);
+    audio_channels_changed = false;
+  }
 
   using control_input_values_type
       = avnd::filter_and_apply<controls_type, avnd::control_input_introspection, T>;
   using control_output_values_type
       = avnd::filter_and_apply<controls_type, avnd::control_output_introspection, T>;
+
+  // Output controls are only written to their port when their value changed
+  // since the last one sent, see process_after_run
+  control_output_values_type last_output_values{};
+  std::bitset<avnd::control_output_introspection<T>::size> output_values_sent;
+
+  // Whether an input got a value during the current tick, see skips_idle_runs.
+  // When the processor was not run, its outputs are left as they are.
+  bool inputs_changed{true};
+  bool run_skipped{};
 };
 
 template <typename T, typename AudioCount>
@@ -258,10 +386,18 @@ public:
 
     this->m_inlets.reserve(total_input_ports + 1);
     this->m_outlets.reserve(total_output_ports + 1);
+    this->reserve_audio_channels();
+    this->control_changes.reserve(avnd::parameter_input_introspection<T>::size * 16);
+    this->control_changes.set_granularity(avnd::control_granularity<T>());
 
     this->audio_ports.init(this->m_inlets, this->m_outlets);
     this->message_ports.init(this->m_inlets);
     this->soundfiles.init(this->impl);
+    this->soundfile_streams.init(this->impl);
+    this->soundfile_recorders.init(this->impl, this->sample_rate);
+    this->texture_outputs.init(this->impl);
+    if constexpr (avnd::tiled_texture_processor<T>)
+      avnd::bind_task_runner(this->impl.effect, &avnd::texture_tiles_pool());
 
     // constexpr const int total_input_channels = avnd::input_channels<T>(-1);
     // constexpr const int total_output_channels = avnd::output_channels<T>(-1);
@@ -289,8 +425,8 @@ public:
     }
     (typename info::indices_n{});
   }
-  template <typename Functor, typename M>
-  void process_inputs(Functor& f, avnd::member_iterator<M>&& in)
+  template <typename Functor, avnd::instance_range M>
+  void process_inputs(Functor& f, M&& in)
   {
     for (auto& i : in)
       process_inputs(f, i);
@@ -308,8 +444,8 @@ public:
     }
     (typename info::indices_n{});
   }
-  template <typename Functor, typename M>
-  void process_outputs(Functor& f, avnd::member_iterator<M>&& in)
+  template <typename Functor, avnd::instance_range M>
+  void process_outputs(Functor& f, M&& in)
   {
     for (auto& i : in)
       process_outputs(f, i);
@@ -318,17 +454,6 @@ public:
   template <typename Functor>
   void process_all_ports(Functor f)
   {
-    // Clear the current state of changed controls
-    /*
-      moodycamel::ConcurrentQueue<i_tuple> ins_queue;
-      moodycamel::ConcurrentQueue<o_tuple> outs_queue;
-
-      i_tuple last_inputs;
-      i_tuple last_outputs;
-
-      std::bitset<i_size> inputs_set;
-      std::bitset<o_size> outputs_set;
-      */
     if constexpr (avnd::inputs_type<T>::size > 0)
       process_inputs(f, this->impl.inputs());
     if constexpr (avnd::outputs_type<T>::size > 0)
@@ -349,7 +474,7 @@ public:
         setup_inlets<safe_node_base_base<T>> init{*this, this->m_inlets};
         (init(
              avnd::
-                 field_reflection<Index, boost::pfr::tuple_element_t<Index, in_type>>{},
+                 field_reflection<Index, avnd::field_type<Index, in_type>>{},
              std::get<Index>(port_tuple)),
          ...);
       }
@@ -368,7 +493,7 @@ public:
         setup_outlets<safe_node_base_base<T>> init{*this, this->m_outlets};
         (init(
              avnd::
-                 field_reflection<Index, boost::pfr::tuple_element_t<Index, out_type>>{},
+                 field_reflection<Index, avnd::field_type<Index, out_type>>{},
              std::get<Index>(port_tuple)),
          ...);
       }
@@ -436,26 +561,74 @@ public:
     this->control.inputs_set.set(N);
   }
 
+  // The channel to use from the UI thread
+  ui_communication<T> ui() noexcept { return {this->control}; }
+
+  // Applies the controls sent by the UI since the last tick
+  void apply_ui_controls()
+  {
+    using controls = avnd::control_input_introspection<T>;
+    if constexpr (controls::size > 0)
+    {
+      this->control.from_ui.consume([this](const auto& values, const auto& changed) {
+        auto& ins = avnd::get_inputs<T>(this->impl);
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+          ((changed.test(I) ? (void)(controls::template get<I>(ins).value = std::get<I>(values))
+                            : (void)0),
+           ...);
+        }(std::make_index_sequence<controls::size>{});
+
+        this->control.inputs_set |= changed;
+        this->inputs_changed = true;
+      });
+    }
+  }
+
+  // Called by the host before running the node, when it knows how many channels
+  // its ports may get: changes of the channels up to these do not reallocate the
+  // buffers of the node nor the instances of a duplicated processor.
+  void reserve_channels(int inputs, int outputs)
+  {
+    this->max_input_channels = inputs;
+    this->max_output_channels = outputs;
+    if (std::max(inputs, outputs) > this->reserved_audio_channels)
+    {
+      this->audio_in_channels.reserve(1 + inputs);
+      this->audio_out_channels.reserve(1 + outputs);
+      this->audio_sub_channels.reserve(2 + inputs + outputs);
+    }
+    audio_configuration_changed();
+  }
+
   void audio_configuration_changed()
   {
     // qDebug() << "New Audio configuration: "
     //          << this->channels.actual_runtime_inputs
     //          << this->channels.actual_runtime_outputs;
     // Allocate buffers, setup everything
-    avnd::process_setup setup_info{
+    const avnd::process_setup setup_info = avnd::with_max_channels<T>({
         .input_channels = this->channels.actual_runtime_inputs,
         .output_channels = this->channels.actual_runtime_outputs,
         .frames_per_buffer = this->buffer_size,
-        .rate = this->sample_rate};
+        .rate = this->sample_rate,
+        .max_input_channels = this->max_input_channels,
+        .max_output_channels = this->max_output_channels,
+        .mode = this->render_request.get()});
 
     // This allocates the buffers that may be used for conversion
     // if e.g. we have an API that works with doubles,
     // and a plug-in that expects floats.
-    // Here for instance we allocate buffers for an host that may invoke "process" with either floats or doubles.
-    this->processor.allocate_buffers(setup_info, float{});
-    this->processor.allocate_buffers(setup_info, double{});
+    // ossia only ever gives doubles: no buffer is needed for floats,
+    // and none at all for the plug-ins which work with doubles.
+    // A new device with the same buffers keeps them.
+    const auto changed = avnd::changes_between(this->current_setup, setup_info);
+    this->current_setup = setup_info;
+    if (changed.frames || changed.channels)
+      this->processor.allocate_buffers(setup_info, double{});
 
     // Initialize the channels for the effect duplicator
+    avnd::reserve_channels(
+        this->impl, setup_info.max_input_channels, setup_info.max_output_channels);
     this->impl.init_channels(setup_info.input_channels, setup_info.output_channels);
 
     // Setup buffers for storing MIDI messages
@@ -468,8 +641,37 @@ public:
       this->control_buffers.reserve_space(this->impl, this->buffer_size);
     }
 
+    this->smoothing.prepare(this->impl, this->sample_rate, this->buffer_size);
+    this->worker.start(this->impl);
+    this->messages.start(this->impl);
+    this->deadlines.prepare(this->sample_rate);
+    this->governor.prepare(this->sample_rate, setup_info.mode);
+
     // Effect-specific preparation
-    avnd::prepare(this->impl, setup_info);
+    avnd::prepare(this->impl, setup_info, changed);
+    update_latency_and_tail();
+
+    this->audio_channels_changed = true;
+  }
+
+  // In frames: how late the outputs are relatively to the inputs
+  int64_t latency_samples() const noexcept
+  {
+    return current_latency.load(std::memory_order_relaxed);
+  }
+
+  // In seconds, infinite if the output may never become silent
+  double tail_seconds() const noexcept
+  {
+    return current_tail.load(std::memory_order_relaxed);
+  }
+
+  void update_latency_and_tail() noexcept
+  {
+    if constexpr (avnd::reports_latency<T>)
+      current_latency.store(avnd::latency_samples(this->impl), std::memory_order_relaxed);
+    if constexpr (avnd::has_tail<T>)
+      current_tail.store(avnd::tail_seconds(this->impl), std::memory_order_relaxed);
   }
 
   void set_channels(ossia::audio_port& port, int channels)
@@ -479,12 +681,22 @@ public:
     {
       // qDebug() << "Setting port channels: " << channels;
       port.set_channels(channels);
+      this->audio_channels_changed = true;
     }
 
+    reserve_frames(port);
+  }
+
+  // Resizing may move the buffers of the channels
+  void reserve_frames(ossia::audio_port& port)
+  {
     for (auto& chan : port)
     {
       if (chan.size() < this->buffer_size)
+      {
         chan.resize(this->buffer_size);
+        this->audio_channels_changed = true;
+      }
     }
   }
 
@@ -503,6 +715,9 @@ public:
     {
       audio_configuration_changed();
     }
+    this->render_request.apply(this->impl);
+    this->governor.set_render_mode(this->render_request.get());
+    this->governor.apply(this->impl);
 
     // Clean up MIDI output ports
     this->midi_buffers.clear_outputs(this->impl);
@@ -510,80 +725,115 @@ public:
     // Clean up sample-accurate control output ports
     this->control_buffers.clear_outputs(this->impl);
 
-    // Process inputs of all sorts
-    process_all_ports(process_before_run<safe_node_base>{*this});
+    {
+      avnd::profile_scope _{this->profile, avnd_profile_inputs};
+      AVND_TRACE_ZONE(T, parameters);
+
+      // Controls changed from the UI, before the ones received on the ports
+      apply_ui_controls();
+
+      // Process inputs of all sorts
+      process_all_ports(process_before_run<safe_node_base>{*this});
+      this->midi_buffers.merge_inputs(this->impl);
+
+      // Switch to the soundfiles converted since the last tick,
+      // and point the streamed and recorded ones to the files currently opened
+      if (this->soundfiles.update(this->impl))
+        this->inputs_changed = true;
+      this->soundfile_streams.update(this->impl);
+      this->soundfile_recorders.update(this->impl);
+    }
 
     // Process messages
     if constexpr (avnd::messages_type<T>::size > 0)
+    {
+      avnd::profile_scope _{this->profile, avnd_profile_messages};
+      AVND_TRACE_ZONE(T, messages);
       process_messages();
+    }
     return true;
   }
 
+  // Calls the function of the message M, see pd::messages::invoke
+  template <typename M, typename... Args>
+  static void call_message(T& implementation, Args&&... args)
+  {
+    constexpr auto f = avnd::message_get_func<M>();
+    if constexpr (std::is_member_function_pointer_v<decltype(f)>)
+    {
+      if constexpr (requires(M m) { m(std::forward<Args>(args)...); })
+        M{}(std::forward<Args>(args)...);
+      else if constexpr (requires { (implementation.*f)(std::forward<Args>(args)...); })
+        (implementation.*f)(std::forward<Args>(args)...);
+    }
+    else
+    {
+      f(std::forward<Args>(args)...);
+    }
+  }
+
+  // Calls the message with the given arguments on each instance of the processor
+  template <typename M, typename... Args>
+  void call_message_on_all(Args&&... args)
+  {
+    for (auto& m : this->impl.effects())
+    {
+      if constexpr (message_signature<T, M>::takes_self)
+        call_message<M>(m, m, args...);
+      else
+        call_message<M>(m, args...);
+    }
+  }
+
   template <auto Idx, typename M>
-  void invoke_message(const ossia::value& val, avnd::field_reflection<Idx, M>)
+  void invoke_message(const ossia::timed_value& val, avnd::field_reflection<Idx, M>)
   {
     if constexpr (!std::is_void_v<avnd::message_reflection<M>>)
     {
-      using refl = avnd::message_reflection<M>;
-      constexpr auto arg_count = refl::count;
-      constexpr auto f = avnd::message_get_func<M>();
-
-      if constexpr (arg_count == 0)
+      using sig = message_signature<T, M>;
+      if constexpr (sig::convertible)
       {
-        for (auto& m : this->impl.effects())
-        {
-          if constexpr (std::is_member_function_pointer_v<decltype(f)>)
-          {
-            if constexpr(requires { M{}(); })
-              M{}();
-            else
-              (m.*f)();
-          }
-          else
-            f();
-        }
+        typename sig::values args;
+        if (!message_arguments(val.value, args))
+          return;
+        if constexpr (sig::timed)
+          std::apply(
+              [this, frame = int(val.timestamp)](auto&... a) {
+                call_message_on_all<M>(a..., frame);
+              },
+              args);
+        else
+          std::apply([this](auto&... a) { call_message_on_all<M>(a...); }, args);
       }
-      else if constexpr (arg_count == 1)
+    }
+  }
+
+  // All the messages of the tick are converted in the storage of the batch,
+  // and the message is called once with all of them
+  template <auto Idx, typename M>
+  void invoke_batch_message(
+      const ossia::value_port& data, avnd::field_reflection<Idx, M>)
+  {
+    using sig = message_signature<T, M>;
+    auto& batch = std::get<Idx>(this->message_ports.batches);
+    batch.clear();
+    for (const auto& val : data.get_data())
+    {
+      auto& args = batch.emplace_back();
+      if constexpr (sig::batch_of_tuples)
       {
-        if constexpr (std::is_same_v<avnd::first_message_argument<M>, T&>)
-        {
-          for (auto& m : this->impl.effects())
-          {
-            if constexpr (std::is_member_function_pointer_v<decltype(f)>)
-            {
-              if constexpr(requires { M{}(m); })
-                M{}(m);
-              else if constexpr(requires { (m.*f)(m); })
-                (m.*f)(m);
-            }
-            else
-              f(m);
-          }
-        }
-        else
-        {
-          //   FIXME ! oscquery_mapper.hpp already has all this code
-          // using first_arg = boost::mp11::mp_first<typename refl::arguments>;
-          // const auto& v = ossia::convert<std::decay_t<first_arg>>(val);
-          // for(auto& m : this->impl.effects())
-          // {
-          //   if constexpr (std::is_member_function_pointer_v<decltype(f)>)
-          //     (m.*f)(v);
-          //   else
-          //     f(v);
-          // }
-        }
+        if (!message_arguments(val.value, args))
+          batch.pop_back();
       }
       else
       {
-        // TODO use vecf, list, etc...
-        // FIXME
+        from_ossia_value(val.value, args);
       }
     }
-    else
-    {
-      //FIXME > 1 arguments
-    }
+
+    if (!batch.empty())
+      call_message_on_all<M>(
+          avnd::span<const typename sig::batch_element>{batch.data(), batch.size()});
   }
 
   template <auto Idx, typename M>
@@ -592,9 +842,23 @@ public:
     ossia::value_inlet& inl = this->message_ports.message_inlets[Idx];
     if (inl.data.get_data().empty())
       return;
-    for (const auto& val : inl.data.get_data())
+    this->inputs_changed = true;
+
+    if constexpr (message_signature<T, M>::batch)
     {
-      invoke_message(val.value, avnd::field_reflection<Idx, M>{});
+      invoke_batch_message(inl.data, avnd::field_reflection<Idx, M>{});
+    }
+    else if constexpr (avnd::coalesced_message<M>)
+    {
+      // Only the latest value matters
+      invoke_message(inl.data.get_data().back(), avnd::field_reflection<Idx, M>{});
+    }
+    else
+    {
+      for (const auto& val : inl.data.get_data())
+      {
+        invoke_message(val, avnd::field_reflection<Idx, M>{});
+      }
     }
   }
 
@@ -603,6 +867,64 @@ public:
     avnd::messages_introspection<T>::for_all([&](auto m) { process_message(m); });
   }
 
+  void apply_control_change(const typename safe_node_base_base<T>::control_change& c)
+  {
+    this->controls.write_raw(this->impl, c.index, [&](auto& field) {
+      from_ossia_value(field, *c.value, field.value);
+    });
+  }
+
+  // Runs the processor, on sub-blocks if controls changed during the buffer
+  void process_audio(avnd::span<double*> in, avnd::span<double*> out, int frames)
+  {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    [[maybe_unused]] avnd::deadline_scope deadline{deadlines, frames};
+    [[maybe_unused]] avnd::quality_scope<T> quality{governor, frames};
+    avnd::profile_scope _{this->profile, avnd_profile_process};
+    AVND_TRACE_ZONE(T, process);
+
+    if constexpr (skips_idle_runs<T>)
+    {
+      this->run_skipped = !this->inputs_changed;
+      this->inputs_changed = false;
+      if (this->run_skipped)
+        return;
+    }
+
+    if constexpr (avnd::splits_on_control_changes<T>)
+    {
+      auto in_sub = this->audio_sub_channels.data();
+      auto out_sub = in_sub + 1 + in.size();
+      this->control_changes.run(
+          frames,
+          [this](const auto& c) { apply_control_change(c); },
+          [&](int first, int n)
+          {
+            this->controls.sync(this->impl);
+            this->worker.deliver(this->impl);
+            this->messages.deliver(this->impl);
+            this->morphing.update(this->impl);
+            this->smoothing.update(this->impl, n);
+            this->changed_controls.update(this->impl);
+            this->processor.process(
+                this->impl,
+                avnd::sub_block_channels(in, first, in_sub),
+                avnd::sub_block_channels(out, first, out_sub),
+                n);
+          });
+    }
+    else
+    {
+      this->worker.deliver(this->impl);
+      this->messages.deliver(this->impl);
+      this->morphing.update(this->impl);
+      this->smoothing.update(this->impl, frames);
+      this->changed_controls.update(this->impl);
+      this->processor.process(this->impl, in, out, frames);
+    }
+  }
+
   auto make_controls_in_tuple()
   {
     return avnd::control_input_introspection<T>::filter_tuple(
@@ -616,6 +938,16 @@ public:
 
   void finish_run()
   {
+    avnd::profile_scope _{this->profile, avnd_profile_outputs};
+    AVND_TRACE_ZONE(T, controls);
+
+    if constexpr (avnd::dynamic_latency<T> || avnd::dynamic_tail<T>)
+      update_latency_and_tail();
+
+    // Apply the control changes which could not be applied while processing
+    this->control_changes.flush([this](const auto& c) { apply_control_change(c); });
+    this->controls.sync(this->impl);
+
     // Copy output events
     process_all_ports(process_after_run<safe_node_base>{*this});
 
@@ -625,13 +957,16 @@ public:
     // Clean up sample-accurate control input ports
     this->control_buffers.clear_inputs(this->impl);
 
-    // Clear control bitsets for UI
+    // Send the changed controls to the UI and clear the bitsets
     if constexpr (avnd::control_input_introspection<T>::size > 0)
     {
       if (this->control.inputs_set.any())
       {
-        // Notify the UI
-        this->control.ins_queue.enqueue(make_controls_in_tuple());
+        auto& ins = avnd::get_inputs<T>(this->impl);
+        this->control.inputs.publish(
+            this->control.inputs_set, [&]<std::size_t I>(avnd::predicate_index<I>) -> auto& {
+              return avnd::control_input_introspection<T>::template get<I>(ins).value;
+            });
         this->control.inputs_set.reset();
       }
     }
@@ -640,8 +975,11 @@ public:
     {
       if (this->control.outputs_set.any())
       {
-        // Notify the UI
-        this->control.outs_queue.enqueue(make_controls_out_tuple());
+        auto& outs = avnd::get_outputs<T>(this->impl);
+        this->control.outputs.publish(
+            this->control.outputs_set, [&]<std::size_t I>(avnd::predicate_index<I>) -> auto& {
+              return avnd::control_output_introspection<T>::template get<I>(outs).value;
+            });
         this->control.outputs_set.reset();
       }
     }
@@ -663,10 +1001,15 @@ public:
     fprintf(stderr, "%s:%d\n", str.c_str(), idx);
   }
 
+  // file_rate: sample rate of the file, 0 if it is the one of the session
   template<std::size_t N, std::size_t NField>
-  void soundfile_loaded(ossia::audio_handle& hdl, avnd::predicate_index<N>, avnd::field_index<NField>)
+  void soundfile_loaded(
+      ossia::audio_handle& hdl, avnd::predicate_index<N>, avnd::field_index<NField>,
+      double file_rate = 0.)
   {
-    this->soundfiles.load(this->impl, hdl, avnd::predicate_index<N>{}, avnd::field_index<NField>{});
+    this->soundfiles.load(
+        this->impl, hdl, avnd::predicate_index<N>{}, avnd::field_index<NField>{}, file_rate,
+        this->sample_rate);
   }
 };
 
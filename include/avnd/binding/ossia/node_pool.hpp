@@ -0,0 +1,36 @@
+#pragma once
+#include <avnd/binding/ossia/mono_audio_node.hpp>
+#include <avnd/binding/ossia/poly_audio_node.hpp>
+#include <avnd/wrappers/instance_pool.hpp>
+
+namespace oscr
+{
+struct node_setup
+{
+  int buffer_size{};
+  double sample_rate{};
+
+  bool operator==(const node_setup&) const noexcept = default;
+};
+
+/**
+ * Nodes of a processor, constructed and prepared on another thread
+ * for the current buffer size and rate of the engine: dropping one in a
+ * running score does not construct its ports nor allocate its buffers.
+ */
+template <typename T>
+avnd::instance_pool<safe_node<T>, node_setup>& node_pool()
+{
+  static avnd::instance_pool<safe_node<T>, node_setup> pool{
+      2, [](const node_setup& setup) {
+        return std::make_shared<safe_node<T>>(setup.buffer_size, setup.sample_rate);
+      }};
+  return pool;
+}
+
+template <typename T>
+std::shared_ptr<safe_node<T>> make_node(int buffer_size, double sample_rate)
+{
+  return node_pool<T>().take({buffer_size, sample_rate});
+}
+}
@@ -19,6 +19,8 @@ public:
     void operator()(ossia::audio_inlet& in) noexcept
     {
       int expected = in.data.channels();
+      // Nothing comes into the inlet: neither a cable nor an address
+      avnd::set_input_bus_connected(self.impl, k, expected > 0);
       self.channels.set_input_channels(self.impl, k, expected);
       int actual = self.channels.get_input_channels(self.impl, k);
       ok &= (expected == actual);
@@ -137,6 +139,7 @@ public:
   }
   void run(const ossia::token_request& tk, ossia::exec_state_facade st) noexcept override
   {
+    AVND_TRACE_ZONE(T, callback);
     auto [start, frames] = st.timings(tk);
 
     if (!this->prepare_run(start, frames))
@@ -148,24 +151,23 @@ public:
     // Initialize audio ports
     const int current_input_channels = this->channels.actual_runtime_inputs;
     const int current_output_channels = this->channels.actual_runtime_outputs;
-    const double** audio_ins
-        = (const double**)alloca(sizeof(double*) * (1 + current_input_channels));
-    double** audio_outs
-        = (double**)alloca(sizeof(double*) * (1 + current_output_channels));
-
-    std::fill_n(audio_ins, 1 + current_input_channels, nullptr);
-    std::fill_n(audio_outs, 1 + current_output_channels, nullptr);
-
-    this->initialize_audio_arrays(audio_ins, audio_outs);
+    if (this->audio_channels_changed)
+    {
+      this->resize_audio_channels(current_input_channels, current_output_channels);
+      this->initialize_audio_arrays(
+          this->audio_in_channels.data(), this->audio_out_channels.data());
+
+      for (int i = 0; i < current_input_channels; i++)
+        assert(this->audio_in_channels[i]);
+      for (int i = 0; i < current_output_channels; i++)
+        assert(this->audio_out_channels[i]);
+    }
 
-    for (int i = 0; i < current_input_channels; i++)
-      assert(audio_ins[i]);
-    for (int i = 0; i < current_output_channels; i++)
-      assert(audio_outs[i]);
+    const double** audio_ins = this->audio_in_channels.data();
+    double** audio_outs = this->audio_out_channels.data();
 
     // Run
-    this->processor.process(
-        this->impl,
+    this->process_audio(
         avnd::span<double*>{
             const_cast<double**>(audio_ins), std::size_t(current_input_channels)},
         avnd::span<double*>{audio_outs, std::size_t(current_output_channels)},
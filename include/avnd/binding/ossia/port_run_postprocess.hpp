@@ -2,13 +2,18 @@
 #include <avnd/common/struct_reflection.hpp>
 // #include <halp/midi.hpp>
 #include <avnd/introspection/input.hpp>
+#include <avnd/introspection/midi.hpp>
 #include <avnd/introspection/output.hpp>
 #include <avnd/wrappers/controls.hpp>
 #include <avnd/wrappers/metadatas.hpp>
+#include <avnd/wrappers/tracing.hpp>
 #include <avnd/wrappers/widgets.hpp>
 #include <ossia/dataflow/graph_node.hpp>
 #include <ossia/dataflow/port.hpp>
 
+#include <cstring>
+#include <type_traits>
+
 namespace oscr
 {
 
@@ -86,6 +91,8 @@ ossia::value to_ossia_value(const T& v)
 {
   // C++23: ranges::to (thanks cor3ntin!)
   std::vector<ossia::value> vec;
+  if constexpr (requires { std::size(v); })
+    vec.reserve(std::size(v));
   for(auto& e : v)
     vec.push_back(to_ossia_value(std::move(e)));
   return vec;
@@ -118,6 +125,18 @@ inline ossia::value to_ossia_value(bool v)
   return v;
 }
 
+// Bitwise for trivially copyable values, so that e.g. NaN meters do not get resent
+template <typename V>
+bool same_output_value(const V& lhs, const V& rhs) noexcept
+{
+  if constexpr (std::is_trivially_copyable_v<V>)
+    return std::memcmp(&lhs, &rhs, sizeof(V)) == 0;
+  else if constexpr (requires { bool(lhs == rhs); })
+    return lhs == rhs;
+  else
+    return false;
+}
+
 template <typename Exec_T>
 struct process_after_run
 {
@@ -177,6 +196,26 @@ struct process_after_run
   requires(!avnd::sample_accurate_parameter<Field>) void
   operator()(Field& ctrl, ossia::value_outlet& port, avnd::num<Idx>) const noexcept
   {
+    // The processor did not run: nothing new to send
+    if (self.run_skipped)
+      return;
+
+    if constexpr (avnd::control<Field>)
+    {
+      using type = typename Exec_T::processor_type;
+      using controls = avnd::control_output_introspection<type>;
+      constexpr int control_index
+          = avnd::index_of_element<Idx>(typename controls::indices_n{});
+
+      // Assigning keeps the storage of e.g. strings and vectors
+      auto& last = std::get<control_index>(self.last_output_values);
+      if (self.output_values_sent.test(control_index)
+          && same_output_value(last, ctrl.value))
+        return;
+      last = ctrl.value;
+      self.output_values_sent.set(control_index);
+    }
+
     write_value(ctrl, port, ctrl.value, 0, avnd::num<Idx>{});
   }
 
@@ -226,6 +265,7 @@ struct process_after_run
   template <avnd::raw_container_midi_port Field, std::size_t Idx>
   void operator()(Field& ctrl, ossia::midi_outlet& port, avnd::num<Idx>) const noexcept
   {
+    AVND_TRACE_ZONE(typename Exec_T::processor_type, midi);
     const int N = ctrl.midi_messages.size;
     port.data.messages.clear();
     port.data.messages.reserve(N);
@@ -242,15 +282,31 @@ struct process_after_run
   template <avnd::dynamic_container_midi_port Field, std::size_t Idx>
   void operator()(Field& ctrl, ossia::midi_outlet& port, avnd::num<Idx>) const noexcept
   {
+    AVND_TRACE_ZONE(typename Exec_T::processor_type, midi);
     port.data.messages.clear();
     port.data.messages.reserve(ctrl.midi_messages.size());
     for (auto& m : ctrl.midi_messages)
     {
       libremidi::message ms;
-      ms.bytes.assign(m.bytes.begin(), m.bytes.end());
+      if constexpr (avnd::raw_midi_message<std::decay_t<decltype(m)>>)
+        ms.bytes.assign(
+            m.bytes.begin(), m.bytes.begin() + avnd::midi_message_size(m.bytes[0]));
+      else
+        ms.bytes.assign(m.bytes.begin(), m.bytes.end());
       ms.timestamp = m.timestamp;
       port.data.messages.push_back(std::move(ms));
     }
+
+    if constexpr (avnd::sysex_midi_port<Field>)
+    {
+      for (auto& m : ctrl.sysex)
+      {
+        libremidi::message ms;
+        ms.bytes.assign(m.bytes.begin(), m.bytes.end());
+        ms.timestamp = m.timestamp;
+        port.data.messages.push_back(std::move(ms));
+      }
+    }
   }
 
   template <typename Field, std::size_t Idx>
@@ -263,6 +319,11 @@ struct process_after_run
   void operator()(Field& ctrl, ossia::value_outlet& port, avnd::num<Idx>) const noexcept
   {
   }
+
+  template <avnd::soundfile_recorder_port Field, std::size_t Idx>
+  void operator()(Field& ctrl, ossia::value_outlet& port, avnd::num<Idx>) const noexcept
+  {
+  }
 };
 
 }
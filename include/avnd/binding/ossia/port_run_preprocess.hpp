@@ -5,10 +5,15 @@
 #include <avnd/concepts/soundfile.hpp>
 #include <avnd/wrappers/controls.hpp>
 #include <avnd/wrappers/metadatas.hpp>
+#include <avnd/wrappers/sub_block_scheduler.hpp>
+#include <avnd/wrappers/tracing.hpp>
 #include <avnd/wrappers/widgets.hpp>
 #include <ossia/dataflow/graph_node.hpp>
 #include <ossia/dataflow/port.hpp>
 
+#include <algorithm>
+#include <iterator>
+
 namespace avnd
 {
 template <typename Field>
@@ -19,6 +24,8 @@ concept enum_ish_parameter = avnd::enum_parameter<Field> ||
 namespace oscr
 {
 
+// The values sent to a control generally already have its type:
+// they are read directly from the variant, and only converted otherwise.
 template <typename T>
 void from_ossia_value(const ossia::value& src, T& dst)
 {
@@ -29,17 +36,20 @@ void from_ossia_value(const ossia::value& src, T& dst)
   }
   else if constexpr (sz == 2)
   {
-    auto [x, y] = ossia::convert<ossia::vec2f>(src);
+    const auto* v = src.target<ossia::vec2f>();
+    auto [x, y] = v ? *v : ossia::convert<ossia::vec2f>(src);
     dst = {x, y};
   }
   else if constexpr (sz == 3)
   {
-    auto [x, y, z] = ossia::convert<ossia::vec3f>(src);
+    const auto* v = src.target<ossia::vec3f>();
+    auto [x, y, z] = v ? *v : ossia::convert<ossia::vec3f>(src);
     dst = {x, y, z};
   }
   else if constexpr (sz == 4)
   {
-    auto [x, y, z, w] = ossia::convert<ossia::vec4f>(src);
+    const auto* v = src.target<ossia::vec4f>();
+    auto [x, y, z, w] = v ? *v : ossia::convert<ossia::vec4f>(src);
     dst = {x, y, z, w};
   }
   else
@@ -51,22 +61,51 @@ void from_ossia_value(const ossia::value& src, T& dst)
 template <std::integral T>
 void from_ossia_value(const ossia::value& src, T& dst)
 {
-  dst = ossia::convert<int>(src);
+  if (auto v = src.target<int>())
+    dst = *v;
+  else if (auto f = src.target<float>())
+    dst = *f;
+  else
+    dst = ossia::convert<int>(src);
 }
 template <std::floating_point T>
 void from_ossia_value(const ossia::value& src, T& dst)
 {
-  dst = ossia::convert<float>(src);
+  if (auto v = src.target<float>())
+    dst = *v;
+  else if (auto i = src.target<int>())
+    dst = *i;
+  else
+    dst = ossia::convert<float>(src);
 }
 template <avnd::string_ish T>
 void from_ossia_value(const ossia::value& src, T& dst)
 {
-  dst = ossia::convert<std::string>(src);
+  if (auto str = src.target<std::string>())
+  {
+    // Copied in the existing storage, which only grows when needed
+    if constexpr (requires { dst.assign(str->data(), str->size()); })
+    {
+      if (std::string_view{dst} != *str)
+        dst.assign(str->data(), str->size());
+    }
+    else
+    {
+      dst = *str;
+    }
+  }
+  else
+  {
+    dst = ossia::convert<std::string>(src);
+  }
 }
 
 inline void from_ossia_value(const ossia::value& src, bool& dst)
 {
-  dst = ossia::convert<bool>(src);
+  if (auto v = src.target<bool>())
+    dst = *v;
+  else
+    dst = ossia::convert<bool>(src);
 }
 
 inline void from_ossia_value(auto& field, const ossia::value& src, auto& dst)
@@ -86,6 +125,13 @@ struct process_before_run
 {
   Exec_T& self;
 
+  // Tells the node that it has to run, see oscr::skips_idle_runs
+  void mark_changed(ossia::value_inlet& port) const noexcept
+  {
+    if (!port.data.get_data().empty())
+      self.inputs_changed = true;
+  }
+
   template <avnd::parameter Field, std::size_t Idx>
   requires(!avnd::control<Field>) void init_value(
       Field& ctrl,
@@ -125,13 +171,36 @@ struct process_before_run
   requires(!avnd::sample_accurate_parameter<Field>) void
   operator()(Field& ctrl, ossia::value_inlet& port, avnd::num<Idx>) const noexcept
   {
-    init_value(ctrl, port, avnd::num<Idx>{});
+    mark_changed(port);
+
+    using type = typename Exec_T::processor_type;
+    if constexpr (avnd::splits_on_control_changes<type>)
+    {
+      // Applied while processing the audio, see safe_node_base::process_audio
+      auto& data = port.data.get_data();
+      for (auto& [val, ts] : data)
+        self.control_changes.push(ts, {Idx, &val});
+
+      if constexpr (avnd::control<Field>)
+      {
+        using controls = avnd::control_input_introspection<type>;
+        constexpr int control_index
+            = avnd::index_of_element<Idx>(typename controls::indices_n{});
+        if (!data.empty())
+          self.control.inputs_set.set(control_index);
+      }
+    }
+    else
+    {
+      init_value(ctrl, port, avnd::num<Idx>{});
+    }
   }
 
   template <avnd::linear_sample_accurate_parameter Field, std::size_t Idx>
   void operator()(Field& ctrl, ossia::value_inlet& port, avnd::num<Idx>) const noexcept
   {
     // FIXME we need to know about the buffer size !
+    mark_changed(port);
     init_value(ctrl, port, avnd::num<Idx>{});
 
     for (auto& [val, ts] : port->get_data())
@@ -144,6 +213,7 @@ struct process_before_run
   template <avnd::span_sample_accurate_parameter Field, std::size_t Idx>
   void operator()(Field& ctrl, ossia::value_inlet& port, avnd::num<Idx>) const noexcept
   {
+    mark_changed(port);
     init_value(ctrl, port, avnd::num<Idx>{});
     for (auto& [val, ts] : port->get_data())
     {
@@ -154,6 +224,7 @@ struct process_before_run
   template <avnd::dynamic_sample_accurate_parameter Field, std::size_t Idx>
   void operator()(Field& ctrl, ossia::value_inlet& port, avnd::num<Idx>) const noexcept
   {
+    mark_changed(port);
     init_value(ctrl, port, avnd::num<Idx>{});
     for (auto& [val, ts] : port->get_data())
     {
@@ -192,14 +263,65 @@ struct process_before_run
     self.soundfile_load_request(*str, Idx);
   }
 
+  template <avnd::soundfile_stream_port Field, std::size_t Idx>
+  void operator()(Field& ctrl, ossia::value_inlet& port, avnd::num<Idx>) const noexcept
+  {
+    auto& dat = port.data.get_data();
+    if(dat.empty())
+      return;
+
+    auto str = dat.back().value.template target<std::string>();
+    if(!str)
+      return;
+
+    self.inputs_changed = true;
+
+    // Opened by the reader thread of the stream
+    using sf_in = avnd::soundfile_stream_input_introspection<typename Exec_T::processor_type>;
+    self.soundfile_streams.open(sf_in::template unmap<Idx>(), *str);
+  }
+
   template <avnd::dynamic_container_midi_port Field, std::size_t Idx>
   void operator()(Field& ctrl, ossia::midi_inlet& port, avnd::num<Idx>) const noexcept
   {
+    AVND_TRACE_ZONE(typename Exec_T::processor_type, midi);
+    using message_type = typename std::decay_t<decltype(ctrl.midi_messages)>::value_type;
     ctrl.midi_messages.reserve(port.data.messages.size());
     for (const libremidi::message& msg_in : port.data.messages)
     {
-      ctrl.midi_messages.push_back(
-          {.bytes{msg_in.begin(), msg_in.end()}, .timestamp{(int)msg_in.timestamp}});
+      // MPE: the channel messages also update the table of expressions of the port
+      if constexpr (avnd::note_expression_midi_port<Field>)
+        ctrl.expressions.update(msg_in.bytes.data(), msg_in.size());
+
+      if constexpr (avnd::sysex_midi_port<Field>)
+      {
+        if (msg_in.size() > 0 && msg_in.bytes[0] == 0xF0)
+        {
+          // The messages of the inlet are kept until the end of the tick
+          if constexpr (avnd::sysex_view_midi_port<Field>)
+            ctrl.sysex.push_view(
+                msg_in.bytes.data(), msg_in.size(), (int)msg_in.timestamp);
+          else
+            ctrl.sysex.push(msg_in.bytes.data(), msg_in.size(), (int)msg_in.timestamp);
+          continue;
+        }
+      }
+
+      if constexpr (avnd::raw_midi_message<message_type>)
+      {
+        // Compact messages: the status and the data bytes of a channel message
+        message_type m{};
+        std::copy_n(
+            msg_in.begin(), std::min(msg_in.size(), std::size(m.bytes)),
+            std::begin(m.bytes));
+        m.timestamp = (int)msg_in.timestamp;
+        ctrl.midi_messages.push_back(m);
+      }
+      else
+      {
+        ctrl.midi_messages.push_back(
+            {.bytes{msg_in.begin(), msg_in.end()}, .timestamp{(int)msg_in.timestamp}});
+      }
     }
   }
 
@@ -241,6 +363,11 @@ struct process_before_run
   void operator()(Field& ctrl, ossia::value_outlet& port, avnd::num<Idx>) const noexcept
   {
   }
+
+  template <avnd::soundfile_recorder_port Field, std::size_t Idx>
+  void operator()(Field& ctrl, ossia::value_outlet& port, avnd::num<Idx>) const noexcept
+  {
+  }
 };
 
 }
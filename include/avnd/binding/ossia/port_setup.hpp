@@ -39,6 +39,11 @@ struct get_ossia_inlet_type<T>
 {
     using type = ossia::value_inlet;
 };
+template <avnd::soundfile_stream_port T>
+struct get_ossia_inlet_type<T>
+{
+  using type = ossia::value_inlet;
+};
 template <avnd::message T>
 struct get_ossia_inlet_type<T>
 {
@@ -85,6 +90,11 @@ struct get_ossia_outlet_type<T>
 {
   using type = ossia::value_outlet;
 };
+template <avnd::soundfile_recorder_port T>
+struct get_ossia_outlet_type<T>
+{
+  using type = ossia::value_outlet;
+};
 
 template <typename T>
 using get_ossia_outlet_type_t = typename get_ossia_outlet_type<T>::type;
@@ -243,6 +253,14 @@ struct setup_value_port
     port.domain = ossia::domain{};
   }
 
+  template <avnd::soundfile_stream_port Field>
+  void setup(ossia::value_port& port)
+  {
+    port.is_event = true;
+    port.type = ossia::val_type::STRING;
+    port.domain = ossia::domain{};
+  }
+
   template <avnd::enum_parameter Field>
   void setup(ossia::value_port& port)
   {
@@ -347,6 +365,14 @@ struct setup_outlets
     outlets.push_back(std::addressof(port));
   }
 
+  // The files are written by the node: nothing goes through the port
+  template <std::size_t Idx, avnd::soundfile_recorder_port Field>
+  void operator()(avnd::field_reflection<Idx, Field> ctrl, ossia::value_outlet& port)
+      const noexcept
+  {
+    outlets.push_back(std::addressof(port));
+  }
+
   template <std::size_t Idx, typename Field>
   void operator()(avnd::field_reflection<Idx, Field> ctrl, ossia::audio_outlet& port)
       const noexcept
@@ -7,9 +7,17 @@
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/output.hpp>
 #include <avnd/introspection/port.hpp>
+#include <avnd/wrappers/background_worker.hpp>
+#include <avnd/wrappers/resample.hpp>
 #include <ossia/dataflow/nodes/media.hpp>
+
 #include <boost/mp11.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
 namespace oscr
 {
 // Field: struct { struct { float** data; } soundfile; }
@@ -21,6 +29,127 @@ template <typename Field>
 using soundfile_handle_type
     = ossia::audio_handle;
 
+/**
+ * A soundfile converted to the sample type of the processor
+ * and to the sample rate of the session.
+ */
+template <typename Ptr>
+struct converted_soundfile
+{
+  using pointer_type = Ptr;
+  using sample_type = std::remove_cvref_t<std::remove_pointer_t<Ptr>>;
+
+  // Keeps the samples and the path alive when the channels point in it
+  ossia::audio_handle source;
+  std::vector<std::vector<sample_type>> samples;
+  std::vector<Ptr> channels;
+  int64_t frames{};
+
+  converted_soundfile* next_retired{};
+};
+
+/**
+ * Shared between a soundfile port and the jobs converting the files
+ * loaded into it, which may outlive the node.
+ */
+template <typename Ptr>
+struct soundfile_slot
+{
+  using file = converted_soundfile<Ptr>;
+
+  // Last file converted, picked up by the audio thread
+  std::atomic<file*> ready{};
+
+  // Files replaced by the audio thread, freed by the worker
+  std::atomic<file*> retired{};
+
+  // Incremented for each load request, to drop the conversions which got superseded
+  std::atomic<uint64_t> generation{};
+
+  ~soundfile_slot()
+  {
+    delete ready.load();
+    free_retired();
+  }
+
+  // Realtime-safe
+  void retire(file* f) noexcept
+  {
+    f->next_retired = retired.load(std::memory_order_relaxed);
+    while (!retired.compare_exchange_weak(
+        f->next_retired, f, std::memory_order_release, std::memory_order_relaxed))
+      ;
+  }
+
+  void free_retired() noexcept
+  {
+    file* f = retired.exchange(nullptr, std::memory_order_acquire);
+    while (f)
+      delete std::exchange(f, f->next_retired);
+  }
+
+  void publish(file* f) noexcept
+  {
+    delete ready.exchange(f, std::memory_order_acq_rel);
+  }
+
+  file* take() noexcept { return ready.exchange(nullptr, std::memory_order_acq_rel); }
+};
+
+// Sample rate of the file when the handle knows it, 0 otherwise
+template <typename Data>
+double soundfile_rate(const Data& data) noexcept
+{
+  if constexpr (requires { data.rate; })
+    return data.rate;
+  else
+    return 0.;
+}
+
+template <typename Ptr>
+std::unique_ptr<converted_soundfile<Ptr>>
+convert_soundfile(const ossia::audio_handle& hdl, double file_rate, double session_rate)
+{
+  using file = converted_soundfile<Ptr>;
+  using sample_type = typename file::sample_type;
+
+  auto f = std::make_unique<file>();
+  f->source = hdl;
+
+  const int chans = hdl->data.size();
+  const int64_t in_frames = chans > 0 ? hdl->data[0].size() : 0;
+  const bool resampled = file_rate > 0. && session_rate > 0. && file_rate != session_rate;
+
+  f->frames = resampled ? avnd::resampled_frames(in_frames, file_rate, session_rate) : in_frames;
+  f->channels.resize(chans);
+
+  if constexpr (std::is_same_v<sample_type, ossia::audio_sample>)
+  {
+    if (!resampled)
+    {
+      // Nothing to convert, the channels point in the handle
+      for (int i = 0; i < chans; i++)
+        f->channels[i] = hdl->data[i].data();
+      return f;
+    }
+  }
+
+  f->samples.resize(chans);
+  for (int i = 0; i < chans; i++)
+  {
+    const auto& in = hdl->data[i];
+    auto& out = f->samples[i];
+    out.resize(f->frames);
+    if (resampled)
+      avnd::resample(
+          in.data(), int64_t(in.size()), file_rate, out.data(), f->frames, session_rate);
+    else
+      std::copy_n(in.data(), std::min<int64_t>(in.size(), f->frames), out.data());
+    f->channels[i] = out.data();
+  }
+  return f;
+}
+
 template <typename T>
 struct soundfile_input_storage
 {
@@ -35,23 +164,32 @@ struct soundfile_input_storage<T>
     soundfile_channel_type,
     avnd::soundfile_input_introspection,
     T>;
-  using hdl_tuple = avnd::filter_and_apply<
-    soundfile_handle_type,
-    avnd::soundfile_input_introspection,
-    T>;
 
-  using ptr_vectors = boost::mp11::mp_transform<std::vector, ptr_tuple>;
+  template <typename Ptr>
+  using slot_ptr = std::shared_ptr<soundfile_slot<Ptr>>;
+  template <typename Ptr>
+  using file_ptr = std::unique_ptr<converted_soundfile<Ptr>>;
 
-  // std::tuple< std::vector<float*>, std::vector<double*> >
-  [[no_unique_address]] ptr_vectors pointers;
+  // std::tuple< std::shared_ptr<soundfile_slot<float*>>, ... >
+  using slot_tuple = boost::mp11::mp_transform<slot_ptr, ptr_tuple>;
 
-  // std::tuple< ossia::audio_handle, ossia::audio_handle >
-  [[no_unique_address]] hdl_tuple handles;
+  // std::tuple< std::unique_ptr<converted_soundfile<float*>>, ... >
+  using file_tuple = boost::mp11::mp_transform<file_ptr, ptr_tuple>;
+
+  [[no_unique_address]] slot_tuple slots;
+
+  // The files currently used by the ports, only accessed from the audio thread
+  [[no_unique_address]] file_tuple current;
 };
 
 
 /**
- * Used to store RAM-loaded soundfiles channel pointers
+ * Used to store RAM-loaded soundfiles.
+ *
+ * Converting a loaded file to the sample type of the processor and resampling it
+ * to the rate of the session are done by a background worker: the audio thread
+ * switches to the converted file once it is ready, in update(). The files it
+ * replaces are freed by the worker.
  */
 template <typename T>
 struct soundfile_storage
@@ -65,13 +203,9 @@ struct soundfile_storage
     {
       auto init_raw_in = [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>)
       {
-        // Get the matching buffer in our storage, a std::vector<timed_value>
-        auto& buf = std::get<Idx>(this->pointers);
+        using slot_type = typename std::decay_t<decltype(std::get<Idx>(this->slots))>::element_type;
+        std::get<Idx>(this->slots) = std::make_shared<slot_type>();
 
-        // Preallocate some space for 2 channels
-        buf.reserve(2);
-
-        // Assign the pointer to the std::span<timed_value> values; member in the port
         port.soundfile.data = nullptr;
         port.soundfile.frames = 0;
         port.soundfile.channels = 0;
@@ -81,37 +215,88 @@ struct soundfile_storage
     }
   }
 
-  template<std::size_t N, std::size_t NField>
-  void load(avnd::effect_container<T>& t, ossia::audio_handle& hdl, avnd::predicate_index<N>, avnd::field_index<NField>)
+  ~soundfile_storage()
   {
-    // Store the handle to keep the memory from being freed
-    ossia::audio_handle& g = std::get<N>(this->handles);
-    std::exchange(g, hdl);
-
-    auto& buf = std::get<N>(this->pointers);
-    using pointer_type = typename std::decay_t<decltype(buf)>::value_type;
-    int chans = g->data.size();
-    int64_t frames = chans > 0 ? g->data[0].size() : 0;
-    buf.resize(chans);
-
-    // Copy the pointers in our storage if no conversion is needed
-    if constexpr(std::is_same_v<pointer_type, const ossia::audio_sample*>)
+    if constexpr (sf_in::size > 0)
     {
-      for(int i = 0; i < chans; i++)
-        buf[i] = g->data[i].data();
+      // Let the worker free the files, in case the node goes away in the audio thread
+      auto release = [this]<std::size_t... I>(std::index_sequence<I...>) {
+        (
+            [this] {
+              auto& slot = std::get<I>(this->slots);
+              if (!slot)
+                return;
+              if (auto* f = std::get<I>(this->current).release())
+                slot->retire(f);
+              slot->generation++;
+              avnd::background_worker::shared().post([slot = std::move(slot)] {});
+            }(),
+            ...);
+      };
+      release(std::make_index_sequence<sf_in::size>{});
     }
-    else
+  }
+
+  /**
+   * Starts converting a newly loaded soundfile for the port.
+   * file_rate is the sample rate of the file, 0 if it is the one of the session.
+   */
+  template<std::size_t N, std::size_t NField>
+  void load(
+      avnd::effect_container<T>&, const ossia::audio_handle& hdl, avnd::predicate_index<N>,
+      avnd::field_index<NField>, double file_rate, double session_rate)
+  {
+    auto slot = std::get<N>(this->slots);
+    using pointer_type = typename std::decay_t<decltype(*slot)>::file::pointer_type;
+
+    if (file_rate <= 0. && hdl)
+      file_rate = soundfile_rate(*hdl);
+
+    const uint64_t generation = ++slot->generation;
+    avnd::background_worker::shared().post(
+        [slot = std::move(slot), hdl, generation, file_rate, session_rate] {
+      slot->free_retired();
+      if (slot->generation.load() != generation || !hdl)
+        return;
+
+      auto f = convert_soundfile<pointer_type>(hdl, file_rate, session_rate);
+      if (slot->generation.load() == generation)
+        slot->publish(f.release());
+    });
+  }
+
+  /**
+   * To be called by the audio thread before each buffer:
+   * switches the ports to the files which finished converting.
+   * Returns whether a port changed.
+   */
+  bool update(avnd::effect_container<T>& t) noexcept
+  {
+    bool changed = false;
+    if constexpr (sf_in::size > 0)
     {
-      // TODO allocate and copy ? we should do that earlier... not in the audio thread
-      fprintf(stderr, "FIXME: soundfile float / double conversion\n");
-    }
+      sf_in::for_all_n2(
+          avnd::get_inputs(t),
+          [&]<std::size_t N, std::size_t NField, typename M>(
+              M& port, avnd::predicate_index<N>, avnd::field_index<NField>) {
+        auto& slot = std::get<N>(this->slots);
+        auto* f = slot->take();
+        if (!f)
+          return;
 
-    // Update the port
-    auto& port = boost::pfr::get<N>(t.inputs());
-    port.soundfile.data = buf.data();
-    port.soundfile.frames = frames;
-    port.soundfile.channels = chans;
-    port.soundfile.filename = hdl->path;
+        auto& cur = std::get<N>(this->current);
+        if (auto* old = cur.release())
+          slot->retire(old);
+        cur.reset(f);
+
+        port.soundfile.data = f->channels.data();
+        port.soundfile.frames = f->frames;
+        port.soundfile.channels = f->channels.size();
+        port.soundfile.filename = f->source->path;
+        changed = true;
+      });
+    }
+    return changed;
   }
 };
 
@@ -8,22 +8,48 @@
 #include <avnd/common/export.hpp>
 #include <avnd/concepts/object.hpp>
 #include <avnd/introspection/channels.hpp>
+#include <avnd/wrappers/changed_controls.hpp>
 #include <avnd/wrappers/controls.hpp>
-#include <avnd/wrappers/process_adapter.hpp>
+#include <avnd/wrappers/deadline.hpp>
+#include <avnd/wrappers/deferred_outputs.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/morph.hpp>
+#include <avnd/wrappers/quality_governor.hpp>
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+#include <avnd/wrappers/render_mode.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
+#include <avnd/wrappers/smoothing_storage.hpp>
+#include <avnd/wrappers/tracing.hpp>
+#include <avnd/wrappers/worker.hpp>
 #include <cmath>
 #include <m_pd.h>
 
+#include <algorithm>
 #include <cstring>
+#include <memory>
 #include <span>
 #include <string>
+#include <vector>
+
+// Pd 0.54 and later can carry many channels in a single signal connection
+#if defined(CLASS_MULTICHANNEL)
+#define AVND_PD_MULTICHANNEL 1
+#else
+#define AVND_PD_MULTICHANNEL 0
+#endif
 
 /**
  * This Pd processor is used when there is dsp processing involved.
  *
  * Inputs and outputs will be created according to the audio channel count.
  * Non-audio inputs will be processed through messages sent to the first port.
+ * Control outputs and callbacks get outlets after the signal ones: what they
+ * produce in perform() is sent by a clock, at the logical time of its frame.
  *
- * TODO: support non-audio outputs.
+ * With Pd 0.54 and later, objects created with "-m" as first argument instead have
+ * a single multichannel inlet and outlet. The number of input channels is the one
+ * of the incoming signal, unless the processor has a fixed number of channels.
  */
 
 namespace pd
@@ -44,8 +70,8 @@ struct audio_processor
   static constexpr const int input_channels = avnd::input_channels<T>(1);
   static constexpr const int output_channels = avnd::output_channels<T>(1);
 
-  static constexpr const int dsp_input_count
-      = input_channels + output_channels + 2; // one for this, one for buffer_size
+  // The main inlet is a signal inlet even without input channels
+  static constexpr const int first_output_signal = std::max(input_channels, 1);
 
   // Head of the Pd object
   t_object x_obj;
@@ -55,17 +81,62 @@ struct audio_processor
 
   // Our actual code
   avnd::effect_container<T> implementation;
-  avnd::process_adapter<T> processor;
+  avnd::host_process_adapter<T> processor;
+  [[no_unique_address]] avnd::shared_controls<T> controls;
+  [[no_unique_address]] avnd::smoothing_storage<T> smoothing;
+  [[no_unique_address]] avnd::changed_controls_storage<T> changed_controls;
+
+  [[no_unique_address]] avnd::morph_storage<T> morphing;
+  [[no_unique_address]] avnd::worker_storage<T> worker;
+
+  // Callbacks over their time budget, when built with AVND_DEADLINE_MONITOR
+  [[no_unique_address]] avnd::deadline_monitor deadlines{avnd::get_name<T>()};
+
+  // Lowers the quality of the processors which have levels when the blocks take too long
+  [[no_unique_address]] avnd::quality_governor<T> governor;
 
-  std::array<t_int, dsp_input_count> dsp_inputs;
+  // The setup of the last prepare, to tell the processor what changed in the next one
+  avnd::process_setup current_setup{};
+
+  // Offline while the patch is fast-forwarded, see process()
+  avnd::render_mode render{avnd::render_mode::realtime};
+
+  // The signal vectors only change when dsp() is called again
+  std::array<t_sample*, input_channels> dsp_inputs{};
+  std::array<t_sample*, output_channels> dsp_outputs{};
 
   [[no_unique_address]] init_arguments<T> init_setup;
   [[no_unique_address]] messages<T> messages_setup;
 
+  // Multichannel mode: the channels of the processor, then the ones of its outputs,
+  // in the signals of the inlet and the outlet
+  bool multichannel{};
+  int mc_inputs{};
+  int mc_outputs{};
+  std::vector<t_sample*> mc_channels;
+  std::vector<t_sample> mc_silence; // The inputs missing from the incoming signal
+
+  // Control outputs, sent outside of the DSP tick
+  using deferred_outputs_type = avnd::deferred_outputs<T>;
+  std::unique_ptr<deferred_outputs_type> control_outputs;
+  std::array<t_outlet*, deferred_outputs_type::size> control_outlets{};
+  t_clock* output_clock{};
+  float sample_rate{};
+
   // we don't use ctor / dtor, because
   // this breaks aggregate-ness...
   void init(int argc, t_atom* argv)
   {
+#if AVND_PD_MULTICHANNEL
+    if (argc > 0 && argv[0].a_type == A_SYMBOL
+        && strcmp(atom_getsymbol(argv)->s_name, "-m") == 0)
+    {
+      multichannel = true;
+      argc--;
+      argv++;
+    }
+#endif
+
     /// Pass arguments
     if constexpr (avnd::can_initialize<T>)
     {
@@ -76,13 +147,37 @@ struct audio_processor
     // Dummy "port" used by CLASS_MAINSIGNALIN
     f = 0.f;
 
-    // first inlet automatically created by pd
-    // it receives both left channel and signals so we have to substract 1
-    for (int i = 0; i < input_channels - 1; i++)
-      signalinlet_new(&x_obj, 0.f);
+    if (multichannel)
+    {
+      // The first inlet carries all the input channels
+      if (output_channels > 0)
+        outlet_new(&x_obj, &s_signal);
+    }
+    else
+    {
+      // first inlet automatically created by pd
+      // it receives both left channel and signals so we have to substract 1
+      for (int i = 0; i < input_channels - 1; i++)
+        signalinlet_new(&x_obj, 0.f);
 
-    for (int i = 0; i < output_channels; i++)
-      outlet_new(&x_obj, &s_signal);
+      for (int i = 0; i < output_channels; i++)
+        outlet_new(&x_obj, &s_signal);
+    }
+
+    if constexpr (deferred_outputs_type::has_event_outputs)
+    {
+      deferred_outputs_type::for_each_output(
+          implementation,
+          [this]<typename C, std::size_t Idx>(C& out, avnd::predicate_index<Idx>) {
+            if constexpr (deferred_outputs_type::template is_event_output<C>)
+              control_outlets[Idx] = outlet_new(&x_obj, symbol_for_port(out));
+          });
+
+      control_outputs = std::make_unique<deferred_outputs_type>();
+      control_outputs->setup_callbacks(implementation);
+      constexpr auto send = +[](audio_processor* self) { self->send_control_outputs(); };
+      output_clock = clock_new(this, (t_method)send);
+    }
 
     /// Initialize controls
     if constexpr (avnd::has_inputs<T>)
@@ -94,77 +189,239 @@ struct audio_processor
     implementation.init_channels(input_channels, output_channels);
   }
 
-  void destroy() { }
+  void destroy()
+  {
+    if (output_clock)
+      clock_free(output_clock);
+  }
+
+  // Scheduler: the control outputs which are due
+  void send_control_outputs()
+  {
+    const auto next = control_outputs->drain(
+        clock_getlogicaltime(), [this](const typename deferred_outputs_type::event& e) {
+          if (e.bang)
+          {
+            outlet_bang(control_outlets[e.port]);
+          }
+          else if (e.count == 1)
+          {
+            outlet_float(control_outlets[e.port], t_float(e.values[0]));
+          }
+          else
+          {
+            t_atom list[4];
+            for (int k = 0; k < e.count; k++)
+              SETFLOAT(&list[k], t_float(e.values[k]));
+            outlet_list(control_outlets[e.port], &s_list, e.count, list);
+          }
+        });
+    if (next)
+      clock_set(output_clock, *next);
+  }
+
+  // DSP tick, around the processing of a block
+  void begin_control_outputs()
+  {
+    if constexpr (deferred_outputs_type::has_event_outputs)
+      control_outputs->begin_buffer(clock_getlogicaltime());
+  }
+
+  void queue_control_outputs(int frames)
+  {
+    if constexpr (deferred_outputs_type::has_event_outputs)
+    {
+      AVND_TRACE_ZONE(T, controls);
+      const double frame_ms = 1000. / sample_rate;
+      const auto drain_at = control_outputs->collect(
+          implementation, frames, [frame_ms](int frame) { return clock_getsystimeafter(frame * frame_ms); });
+      if (drain_at)
+        clock_set(output_clock, *drain_at);
+    }
+  }
 
   void dsp(t_signal** sp)
   {
     // Initialize vectors for converting float -> double
     const int N = sp[0]->s_n;
     const float rate = sp[0]->s_sr;
+    sample_rate = rate;
+    if constexpr (deferred_outputs_type::has_event_outputs)
+      control_outputs->prepare(rate);
+
+    int inputs = input_channels;
+    int outputs = output_channels;
+#if AVND_PD_MULTICHANNEL
+    if (multichannel)
+    {
+      // Negotiate the channels with the incoming signal
+      inputs = avnd::input_channels<T>(sp[0]->s_nchans);
+      outputs = avnd::output_channels<T>(inputs);
+      avnd::reserve_channels(
+          implementation, avnd::max_input_channels<T>(), avnd::max_output_channels<T>());
+      implementation.init_channels(inputs, outputs);
+    }
+#endif
 
     // Allocate buffers that may be required for converting float <-> double
-    avnd::process_setup setup_info{
-        .input_channels = input_channels,
-        .output_channels = output_channels,
+    const avnd::process_setup setup_info = avnd::with_max_channels<T>({
+        .input_channels = inputs,
+        .output_channels = outputs,
         .frames_per_buffer = N,
-        .rate = rate};
-    processor.allocate_buffers(setup_info, float{});
+        .rate = rate,
+        .mode = render});
+
+    // Toggling the DSP keeps the buffers, and only tells the processor what changed
+    const auto changed = avnd::changes_between(current_setup, setup_info);
+    current_setup = setup_info;
+    if (changed.frames || changed.channels)
+      processor.allocate_buffers(setup_info, float{});
+
+    // Setup the ramps of smoothed controls
+    smoothing.prepare(implementation, rate, N);
+    worker.start(implementation);
+    deadlines.prepare(rate);
+    governor.prepare(rate, render);
 
     // Allocate buffers if supported
-    avnd::prepare(implementation, setup_info);
+    avnd::prepare(implementation, setup_info, changed);
 
-    // Notify puredata of the dsp execution
-    constexpr t_perfroutine perf = +[](t_int* w)
+#if AVND_PD_MULTICHANNEL
+    if (multichannel)
     {
-      ++w; // Arguments passed to the t_perfroutine start at 1
-      return reinterpret_cast<audio_processor<T>*>(*w)->perform(w);
-    };
+      dsp_multichannel(sp, N, inputs, outputs);
+      return;
+    }
 
-    /// Initialize dsp_inputs
-    dsp_inputs[0] = reinterpret_cast<t_int>(this);
-    dsp_inputs[1] = N;
+    // The outlets of the class can be multichannel: give them a single channel here
+    for (int k = 0; k < output_channels; ++k)
+      signal_setmultiout(&sp[first_output_signal + k], 1);
+#endif
 
-    for (int k = 0; k < input_channels + output_channels; ++k)
-      dsp_inputs[2 + k] = reinterpret_cast<t_int>(sp[k]->s_vec);
+    /// Initialize the signal vectors
+    for (int k = 0; k < input_channels; ++k)
+      dsp_inputs[k] = sp[k]->s_vec;
+    for (int k = 0; k < output_channels; ++k)
+      dsp_outputs[k] = sp[first_output_signal + k]->s_vec;
 
-    dsp_addv(perf, dsp_input_count, dsp_inputs.data());
+    // Notify puredata of the dsp execution.
+    // Arguments passed to the t_perfroutine start at 1
+    constexpr t_perfroutine perf = +[](t_int* w)
+    {
+      reinterpret_cast<audio_processor<T>*>(w[1])->perform(int(w[2]));
+      return w + 3;
+    };
+    dsp_add(perf, 2, this, N);
   }
 
-  t_int* perform(t_int* w)
+#if AVND_PD_MULTICHANNEL
+  // The channels of a multichannel signal follow each other in its vector.
+  // The channel pointers only get reallocated when there are more than ever before.
+  void dsp_multichannel(t_signal** sp, int N, int inputs, int outputs)
   {
-    const int n = (int)(*++w);
+    mc_inputs = inputs;
+    mc_outputs = outputs;
+    mc_channels.resize(inputs + outputs);
+
+    const int incoming = sp[0]->s_nchans;
+    if (incoming < inputs)
+      mc_silence.assign(N, 0.f);
 
-    t_sample** input{};
-    if (input_channels > 0)
+    for (int c = 0; c < inputs; ++c)
+      mc_channels[c] = c < incoming ? sp[0]->s_vec + c * N : mc_silence.data();
+
+    if (output_channels > 0)
     {
-      input = (t_sample**)alloca(sizeof(t_sample*) * input_channels);
-      for (int c = 0; c < input_channels; ++c)
-      {
-        input[c] = (t_sample*)(*++w);
-      }
+      signal_setmultiout(&sp[1], std::max(outputs, 1));
+      for (int c = 0; c < outputs; ++c)
+        mc_channels[inputs + c] = sp[1]->s_vec + c * N;
     }
 
-    t_sample** output{};
-    if (output_channels > 0)
+    constexpr t_perfroutine perf = +[](t_int* w)
     {
-      output = (t_sample**)alloca(sizeof(t_sample*) * output_channels);
-      for (int c = 0; c < output_channels; ++c)
-      {
-        output[c] = (t_sample*)(*++w);
-      }
+      reinterpret_cast<audio_processor<T>*>(w[1])->perform_multichannel(int(w[2]));
+      return w + 3;
+    };
+    dsp_add(perf, 2, this, N);
+  }
+
+  void perform_multichannel(int n)
+  {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    [[maybe_unused]] avnd::deadline_scope deadline{deadlines, n};
+    [[maybe_unused]] avnd::quality_scope<T> quality{governor, n};
+    AVND_TRACE_ZONE(T, callback);
+
+    t_sample** channels = mc_channels.data();
+    begin_control_outputs();
+    {
+      AVND_TRACE_ZONE(T, process);
+      governor.apply(implementation);
+      controls.sync(implementation);
+      worker.deliver(implementation);
+      morphing.update(implementation);
+      smoothing.update(implementation, n);
+      changed_controls.update(implementation);
+      processor.process(
+          implementation,
+          avnd::span<t_sample*>{channels, std::size_t(mc_inputs)},
+          avnd::span<t_sample*>{channels + mc_inputs, std::size_t(mc_outputs)},
+          n);
     }
+    queue_control_outputs(n);
+    messages_setup.tick(n);
+  }
+#endif
+
+  // The channel counts are constants here: each arity gets its own routine
+  void perform(int n)
+  {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    [[maybe_unused]] avnd::deadline_scope deadline{deadlines, n};
+    [[maybe_unused]] avnd::quality_scope<T> quality{governor, n};
+    AVND_TRACE_ZONE(T, callback);
 
-    processor.process(
-        implementation,
-        avnd::span<t_sample*>{input, input_channels},
-        avnd::span<t_sample*>{output, output_channels},
-        n);
+    begin_control_outputs();
+    {
+      AVND_TRACE_ZONE(T, process);
+      governor.apply(implementation);
+      controls.sync(implementation);
+      worker.deliver(implementation);
+      morphing.update(implementation);
+      smoothing.update(implementation, n);
+      changed_controls.update(implementation);
+      processor.process(
+          implementation,
+          avnd::span<t_sample*>{dsp_inputs.data(), std::size_t(input_channels)},
+          avnd::span<t_sample*>{dsp_outputs.data(), std::size_t(output_channels)},
+          n);
+    }
+    queue_control_outputs(n);
+    messages_setup.tick(n);
+  }
 
-    return ++w;
+  // The index of the input field of the control named s, -1 if there is none
+  static int control_field(t_symbol* s) noexcept
+  {
+    int field = -1;
+    avnd::parameter_input_introspection<T>::for_all(
+        [s, &field]<std::size_t Idx, typename C>(avnd::field_reflection<Idx, C>) {
+          if constexpr (avnd::has_name<C>)
+            if (avnd::get_name<C>() == s->s_name)
+              field = Idx;
+        });
+    return field;
   }
 
   void process_inlet_control(t_symbol* s, int argc, t_atom* argv)
   {
+    AVND_TRACE_ZONE(T, parameters);
+    const int field = control_field(s);
+    if (field < 0)
+      return;
+
     switch (argv[0].a_type)
     {
       case A_FLOAT:
@@ -172,18 +429,10 @@ struct audio_processor
         // Note: teeeechnically, one could store a map of string -> {void*,typeid} and then cast...
         // but most pd externals seem to just do a chain of if() so this is equivalent
         float res = argv[0].a_w.w_float;
-        avnd::for_each_field_ref(
-            implementation.inputs(),
-            [this, s, res]<typename C>(C& ctl)
-            {
-              if constexpr (requires { ctl.value = float{}; })
-              {
-                if (avnd::get_name<C>() == s->s_name)
-                {
-                  avnd::apply_control(ctl, res);
-                }
-              }
-            });
+        controls.write_raw(implementation, field, [res]<typename C>(C& ctl) {
+          if constexpr (requires { ctl.value = float{}; })
+            avnd::apply_control(ctl, res);
+        });
         break;
       }
 
@@ -192,19 +441,10 @@ struct audio_processor
         // TODO ?
         std::string res = argv[0].a_w.w_symbol->s_name;
         // thread_local for perf ?
-        avnd::for_each_field_ref(
-            implementation.inputs(),
-            [this, s, &res](auto& ctl)
-            {
-              if constexpr (requires { ctl.value = std::string{}; })
-              {
-                if (std::string_view{ctl.name()} == s->s_name)
-                {
-                  avnd::apply_control(ctl, std::move(res));
-                  ctl.value = std::move(res);
-                }
-              }
-            });
+        controls.write_raw(implementation, field, [&res](auto& ctl) {
+          if constexpr (requires { ctl.value = std::string{}; })
+            ctl.value = res;
+        });
         break;
       }
 
@@ -215,10 +455,24 @@ struct audio_processor
 
   void process(t_symbol* s, int argc, t_atom* argv)
   {
+    AVND_TRACE_ZONE(T, messages);
+
     // First try to process messages handled explicitely in the object
     if (messages_setup.process_messages(implementation, s, argc, argv))
       return;
 
+    // [fast-forward 1( before running the patch faster than real-time, e.g. with
+    // [; pd fast-forward <ms>( or in batch mode, and [fast-forward 0( after.
+    // Messages and DSP run in the same thread: the processor gets it right away.
+    if (s == gensym("fast-forward"))
+    {
+      render = argc > 0 && atom_getfloat(argv) != 0.f ? avnd::render_mode::offline
+                                                       : avnd::render_mode::realtime;
+      avnd::set_render_mode(implementation, render);
+      governor.set_render_mode(render);
+      return;
+    }
+
     // Then some default behaviour
     switch (argc)
     {
@@ -302,7 +556,11 @@ audio_processor_metaclass<T>::audio_processor_metaclass()
       (t_newmethod)obj_new,
       (t_method)obj_free,
       sizeof(audio_processor<T>),
+#if AVND_PD_MULTICHANNEL
+      CLASS_DEFAULT | CLASS_MULTICHANNEL,
+#else
       CLASS_DEFAULT,
+#endif
       A_GIMME,
       0);
 
@@ -312,6 +570,9 @@ audio_processor_metaclass<T>::audio_processor_metaclass()
   // Connect our methods
   class_addmethod(g_class, (t_method)obj_dsp, gensym("dsp"), A_CANT, 0);
   class_addanything(g_class, (t_method)obj_process);
+
+  // Messages with simple signatures are dispatched by Pd directly
+  messages<T>::template register_typed_methods<instance>(g_class);
 }
 
 }
@@ -104,23 +104,33 @@ static void process_generic_message(T& implementation, t_symbol* s)
   }
 }
 
+// Strings are checked first: std::string can also be assigned a float
+template <typename Arg>
+static constexpr bool symbol_argument
+    = std::is_convertible_v<std::remove_cvref_t<Arg>, std::string_view>
+      && std::is_constructible_v<std::remove_cvref_t<Arg>, const char*>;
+
+template <typename Arg>
+static constexpr bool float_argument
+    = !symbol_argument<Arg> && requires(std::remove_cvref_t<Arg> arg) { arg = 0.f; };
+
 template <typename Arg>
 static constexpr bool compatible(t_atomtype type)
 {
-  if constexpr (requires(Arg arg) { arg = 0.f; })
+  if constexpr (float_argument<Arg>)
     return type == t_atomtype::A_FLOAT;
-  else if constexpr (requires(Arg arg) { arg = "str"; })
+  else if constexpr (symbol_argument<Arg>)
     return type == t_atomtype::A_SYMBOL;
 
   return false;
 }
 
 template <typename Arg>
-static Arg convert(t_atom& atom)
+static std::remove_cvref_t<Arg> convert(t_atom& atom)
 {
-  if constexpr (requires(Arg arg) { arg = 0.f; })
+  if constexpr (float_argument<Arg>)
     return atom.a_w.w_float;
-  else if constexpr (requires(Arg arg) { arg = "str"; })
+  else if constexpr (symbol_argument<Arg>)
     return atom.a_w.w_symbol->s_name;
   else
     static_assert(std::is_same_v<void, Arg>, "Argument type not handled yet");
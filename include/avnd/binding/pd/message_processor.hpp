@@ -12,6 +12,7 @@
 #include <avnd/wrappers/avnd.hpp>
 #include <avnd/wrappers/controls.hpp>
 #include <avnd/wrappers/controls_storage.hpp>
+#include <avnd/wrappers/tracing.hpp>
 #include <cmath>
 #include <m_pd.h>
 
@@ -119,6 +120,7 @@ struct message_processor
     {
       if constexpr (avnd::parameter_input_introspection<T>::size > 0)
       {
+        AVND_TRACE_ZONE(T, parameters);
         auto& first_inlet = boost::pfr::get<0>(avnd::get_inputs<T>(implementation));
         if(argc > 0)
         {
@@ -146,11 +148,17 @@ struct message_processor
 
     // Do our stuff if it makes sense - some objects may not
     // even have a "processing" method
-    if_possible(implementation.effect())
-    else if_possible(implementation.effect(1));
+    {
+      AVND_TRACE_ZONE(T, process);
+      if_possible(implementation.effect())
+      else if_possible(implementation.effect(1));
+    }
 
     // Then bang
-    output_setup.commit(*this);
+    {
+      AVND_TRACE_ZONE(T, controls);
+      output_setup.commit(*this);
+    }
 
     // Then clean the inlets if needed
     this->control_buffers.clear_inputs(this->implementation);
@@ -158,6 +166,8 @@ struct message_processor
 
   void process(t_symbol* s, int argc, t_atom* argv)
   {
+    AVND_TRACE_ZONE(T, messages);
+
     // First try to process messages handled explicitely in the object
     if (messages_setup.process_messages(implementation, s, argc, argv))
       return;
@@ -231,6 +241,9 @@ message_processor_metaclass<T>::message_processor_metaclass()
 
   // Connect our methods
   class_addanything(g_class, (t_method)obj_process);
+
+  // Messages with simple signatures are dispatched by Pd directly
+  messages<T>::template register_typed_methods<instance>(g_class);
 }
 
 }
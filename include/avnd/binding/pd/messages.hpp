@@ -4,21 +4,42 @@
 
 #include <avnd/binding/pd/atom_iterator.hpp>
 #include <avnd/binding/pd/helpers.hpp>
+#include <avnd/common/selector_cache.hpp>
 #include <avnd/introspection/messages.hpp>
 
+#include <algorithm>
+#include <array>
+
 namespace pd
 {
 
 template <typename T>
 struct messages
 {
+  // Calls the function of the message M with already converted arguments
+  template <typename M, typename... Args>
+  static void invoke(T& implementation, Args&&... args)
+  {
+    constexpr auto f = avnd::message_get_func<M>();
+    if constexpr (std::is_member_function_pointer_v<decltype(f)>)
+    {
+      if constexpr (requires(M m) { m(std::forward<Args>(args)...); })
+        M{}(std::forward<Args>(args)...);
+      else if constexpr (requires { (implementation.*f)(std::forward<Args>(args)...); })
+        (implementation.*f)(std::forward<Args>(args)...);
+    }
+    else
+    {
+      f(std::forward<Args>(args)...);
+    }
+  }
+
   template <typename M>
   static void
-  call_static(T& implementation, std::string_view name, int argc, t_atom* argv)
+  call_static(T& implementation, std::string_view name, int argc, t_atom* argv, int frame)
   {
-    using refl = avnd::message_reflection<M>;
-    constexpr auto f = avnd::message_get_func<M>();
-    constexpr auto arg_counts = refl::count;
+    using arg_list_t = avnd::host_message_arguments<M>;
+    constexpr auto arg_counts = boost::mp11::mp_size<arg_list_t>::value;
 
     if (arg_counts != argc)
     {
@@ -28,8 +49,6 @@ struct messages
       return;
     }
 
-    using arg_list_t = typename refl::arguments;
-
     // Check if all arguments passed are convertible to the expected
     // type of the method:
     const bool can_apply_args = [&]<typename... Args, std::size_t... I>(
@@ -51,27 +70,20 @@ struct messages
     [&]<typename... Args, std::size_t... I>(
         boost::mp11::mp_list<Args...>, std::index_sequence<I...>)
     {
-      constexpr auto f = avnd::message_get_func<M>();
-      if constexpr (std::is_member_function_pointer_v<decltype(f)>)
-      {
-        if constexpr(requires (M m) { m(convert<Args>(argv[I])...); })
-          return M{}(convert<Args>(argv[I])...);
-        else if constexpr(requires { implementation.*f; })
-          return (implementation.*f)(convert<Args>(argv[I])...);
-      }
+      if constexpr (avnd::timed_message<M>)
+        invoke<M>(implementation, convert<Args>(argv[I])..., frame);
       else
-        return f(convert<Args>(argv[I])...);
+        invoke<M>(implementation, convert<Args>(argv[I])...);
     }
     (arg_list_t{}, std::make_index_sequence<arg_counts>());
   }
 
   template <typename M>
   static void
-  call_instance(T& implementation, std::string_view name, int argc, t_atom* argv)
+  call_instance(T& implementation, std::string_view name, int argc, t_atom* argv, int frame)
   {
-    using refl = avnd::message_reflection<M>;
-    constexpr auto f = avnd::message_get_func<M>();
-    constexpr auto arg_counts = refl::count;
+    using arg_list_t = avnd::host_message_arguments<M>;
+    constexpr auto arg_counts = boost::mp11::mp_size<arg_list_t>::value;
 
     if (arg_counts != (argc + 1))
     {
@@ -81,8 +93,6 @@ struct messages
       return;
     }
 
-    using arg_list_t = typename refl::arguments;
-
     // Check if all arguments passed are convertible to the expected
     // type of the method:
     const bool can_apply_args = [&]<typename... Args, std::size_t... I>(
@@ -104,18 +114,10 @@ struct messages
     [&]<typename... Args, std::size_t... I>(
         boost::mp11::mp_list<T&, Args...>, std::index_sequence<I...>)
     {
-      constexpr auto f = avnd::message_get_func<M>();
-      if constexpr (std::is_member_function_pointer_v<decltype(f)>)
-      {
-        if constexpr(requires (M m) { m(implementation, convert<Args>(argv[I])...); })
-          return M{}(implementation, convert<Args>(argv[I])...);
-        else if constexpr(requires { implementation.*f; })
-          return (implementation.*f)(implementation, convert<Args>(argv[I])...);
-      }
+      if constexpr (avnd::timed_message<M>)
+        invoke<M>(implementation, implementation, convert<Args>(argv[I])..., frame);
       else
-      {
-        return f(implementation, convert<Args>(argv[I])...);
-      }
+        invoke<M>(implementation, implementation, convert<Args>(argv[I])...);
     }
     (arg_list_t{}, std::make_index_sequence<arg_counts - 1>());
   }
@@ -126,24 +128,25 @@ struct messages
       M& field,
       std::string_view sym,
       int argc,
-      t_atom* argv)
+      t_atom* argv,
+      int frame)
   {
     if constexpr (!std::is_void_v<avnd::message_reflection<M>>)
     {
       constexpr auto arg_count = avnd::message_reflection<M>::count;
       if constexpr (arg_count == 0)
       {
-        call_static<M>(implementation, sym, argc, argv);
+        call_static<M>(implementation, sym, argc, argv, frame);
       }
       else
       {
         if constexpr (std::is_same_v<avnd::first_message_argument<M>, T&>)
         {
-          call_instance<M>(implementation, sym, argc, argv);
+          call_instance<M>(implementation, sym, argc, argv, frame);
         }
         else
         {
-          call_static<M>(implementation, sym, argc, argv);
+          call_static<M>(implementation, sym, argc, argv, frame);
         }
       }
       return true;
@@ -179,27 +182,235 @@ struct messages
     return false;
   }
 
-  static bool process_messages(avnd::effect_container<T>& implementation, t_symbol* s, int argc, t_atom* argv)
+  // One function per message, indexed like the fields of the messages struct
+  template <std::size_t I>
+  static bool dispatch(
+      avnd::effect_container<T>& implementation,
+      std::string_view sym,
+      int argc,
+      t_atom* argv,
+      int frame)
+  {
+    auto& field = boost::pfr::get<I>(avnd::get_messages(implementation));
+    return process_message(implementation.effect, field, sym, argc, argv, frame);
+  }
+
+  using dispatch_function
+      = bool (*)(avnd::effect_container<T>&, std::string_view, int, t_atom*, int);
+
+  static constexpr auto dispatch_table = []
+  {
+    if constexpr (avnd::has_messages<T>)
+    {
+      return []<std::size_t... I>(std::index_sequence<I...>)
+      {
+        return std::array<dispatch_function, sizeof...(I)>{&dispatch<I>...};
+      }
+      (std::make_index_sequence<avnd::messages_introspection<T>::size>{});
+    }
+    else
+    {
+      return std::array<dispatch_function, 0>{};
+    }
+  }();
+
+  // Symbols are interned: once a selector has been seen,
+  // finding its message again does not compare any string
+  avnd::selector_cache<avnd::selector_cache_size(dispatch_table.size())> selectors;
+
+  bool process_messages(avnd::effect_container<T>& implementation, t_symbol* s, int argc, t_atom* argv)
   {
     if constexpr (avnd::has_messages<T>)
     {
-      bool ok = false;
-      std::string_view symname = s->s_name;
-      avnd::messages_introspection<T>::for_all(
-          avnd::get_messages(implementation),
-          [&]<typename M>(M& field)
-          {
-            if (ok)
-              return;
-            if (symname == M::name())
-            {
-              ok = process_message(implementation.effect, field, symname, argc, argv);
-            }
-          });
-      return ok;
+      const int index = selectors.find(
+          s, [s] { return avnd::message_name_table<T>::find(s->s_name); });
+      if (index < 0)
+        return false;
+
+      return dispatch_table[index](implementation, s->s_name, argc, argv, frame_offset());
     }
     return false;
   }
+
+  // Called by the DSP perform routine: the messages received until the next one
+  // are due in the next buffer, at the sample given by their logical time
+  void tick(int frames) noexcept
+  {
+    m_tick_time = clock_getlogicaltime();
+    m_tick_frames = frames;
+  }
+
+  // The sample of the next buffer at which a message received now is due,
+  // see avnd::timed_message. Always 0 without DSP, e.g. for message objects.
+  int frame_offset() const noexcept
+  {
+    if (m_tick_frames <= 0)
+      return 0;
+    const double since = clock_gettimesincewithunits(m_tick_time, 1., 1);
+    return std::clamp(int(since), 0, m_tick_frames - 1);
+  }
+
+  double m_tick_time{};
+  int m_tick_frames{};
+
+  /**
+   * Messages which only take floats and symbols are registered as typed Pd methods:
+   * Pd then checks and unpacks the arguments itself, and calls us directly
+   * instead of going through the A_GIMME "anything" method.
+   */
+  template <typename Args>
+  struct pd_arguments
+  {
+    static constexpr bool is_instance = false;
+    using type = Args;
+  };
+
+  template <typename... Args>
+  struct pd_arguments<boost::mp11::mp_list<T&, Args...>>
+  {
+    static constexpr bool is_instance = true;
+    using type = boost::mp11::mp_list<Args...>;
+  };
+
+  template <typename M>
+  struct typed_message
+  {
+    using all_arguments = pd_arguments<avnd::host_message_arguments<M>>;
+    static constexpr bool is_instance = all_arguments::is_instance;
+
+    // The arguments which come from Pd
+    using arguments = typename all_arguments::type;
+
+    static constexpr int count = boost::mp11::mp_size<arguments>::value;
+
+    static constexpr int floats = []<typename... Args>(boost::mp11::mp_list<Args...>) {
+      return (0 + ... + int(float_argument<Args>));
+    }(arguments{});
+
+    static constexpr int symbols = []<typename... Args>(boost::mp11::mp_list<Args...>) {
+      return (0 + ... + int(symbol_argument<Args>));
+    }(arguments{});
+
+    // For each argument, its index among the floats or among the symbols:
+    // Pd passes the symbols first and then the floats, whatever their order
+    static constexpr auto positions = []<typename... Args>(boost::mp11::mp_list<Args...>) {
+      std::array<int, sizeof...(Args) + 1> pos{};
+      int f = 0, s = 0, k = 0;
+      ((pos[k++] = float_argument<Args> ? f++ : s++), ...);
+      return pos;
+    }(arguments{});
+
+    static constexpr bool reserved_name()
+    {
+      using namespace std::literals;
+      constexpr std::string_view builtins[]{
+          "bang"sv, "float"sv, "symbol"sv, "list"sv, "anything"sv, "pointer"sv,
+          "signal"sv, "dsp"sv, "loadbang"sv};
+      for (auto name : builtins)
+        if (name == M::name())
+          return true;
+      return false;
+    }
+
+    // Pd can pass at most 5 typed arguments (MAXPDARG)
+    static constexpr bool value = floats + symbols == count && count <= 5 && !reserved_name();
+  };
+
+  template <std::size_t>
+  using symbol_parameter = t_symbol*;
+  template <std::size_t>
+  using float_parameter = t_floatarg;
+
+  template <typename Instance, typename M, typename Symbols, typename Floats>
+  struct typed_method;
+
+  template <typename Instance, typename M, std::size_t... S, std::size_t... F>
+  struct typed_method<Instance, M, std::index_sequence<S...>, std::index_sequence<F...>>
+  {
+    using info = typed_message<M>;
+
+    static void call(Instance* x, symbol_parameter<S>... syms, float_parameter<F>... floats)
+    {
+      t_symbol* const sym_args[]{syms..., nullptr};
+      const t_floatarg float_args[]{floats..., 0.f};
+
+      auto& implementation = x->implementation.effect;
+      [&]<typename... Args, std::size_t... I>(
+          boost::mp11::mp_list<Args...>, std::index_sequence<I...>)
+      {
+        auto arg = [&]<typename Arg, std::size_t K>() -> decltype(auto) {
+          if constexpr (float_argument<Arg>)
+            return float_args[info::positions[K]];
+          else
+            return sym_args[info::positions[K]]->s_name;
+        };
+
+        auto call = [&](auto&&... frame) {
+          if constexpr (info::is_instance)
+            invoke<M>(
+                implementation, implementation,
+                static_cast<std::remove_cvref_t<Args>>(arg.template operator()<Args, I>())...,
+                frame...);
+          else
+            invoke<M>(
+                implementation,
+                static_cast<std::remove_cvref_t<Args>>(arg.template operator()<Args, I>())...,
+                frame...);
+        };
+
+        if constexpr (avnd::timed_message<M>)
+          call(x->messages_setup.frame_offset());
+        else
+          call();
+      }
+      (typename info::arguments{}, std::make_index_sequence<info::count>{});
+    }
+  };
+
+  template <typename Arg>
+  static constexpr t_atomtype atom_type() noexcept
+  {
+    return float_argument<Arg> ? A_FLOAT : A_SYMBOL;
+  }
+
+  // Called once when setting up the Pd class of Instance
+  template <typename Instance>
+  static void register_typed_methods(t_class* c)
+  {
+    if constexpr (avnd::has_messages<T>)
+    {
+      using messages_type = typename avnd::messages_type<T>::type;
+      [c]<std::size_t... I>(std::index_sequence<I...>)
+      {
+        (register_typed_method<Instance, avnd::field_type<I, messages_type>>(c),
+         ...);
+      }
+      (std::make_index_sequence<avnd::messages_introspection<T>::size>{});
+    }
+  }
+
+  template <typename Instance, typename M>
+  static void register_typed_method(t_class* c)
+  {
+    if constexpr (!std::is_void_v<avnd::message_reflection<M>>)
+    {
+      using info = typed_message<M>;
+      if constexpr (info::value)
+      {
+        using method = typed_method<
+            Instance, M, std::make_index_sequence<info::symbols>,
+            std::make_index_sequence<info::floats>>;
+
+        [&]<typename... Args>(boost::mp11::mp_list<Args...>)
+        {
+          class_addmethod(
+              c, (t_method)&method::call, gensym(std::string_view{M::name()}.data()),
+              atom_type<Args>()..., A_NULL);
+        }
+        (typename info::arguments{});
+      }
+    }
+  }
 };
 
 }
@@ -3,9 +3,16 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <avnd/concepts/parameter.hpp>
+#include <avnd/concepts/processor.hpp>
 #include <avnd/binding/pd/helpers.hpp>
+#include <avnd/common/dummy.hpp>
 #include <avnd/introspection/output.hpp>
 
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
 namespace pd
 {
 
@@ -68,20 +75,73 @@ inline void value_to_pd(t_outlet* outlet, std::string_view v) noexcept
 inline void value_to_pd(t_outlet* outlet, const std::string& v) noexcept
 { outlet_symbol(outlet, gensym(v.c_str())); }
 
+// Only interns a string output again when it changed
+struct symbol_cache
+{
+  std::string text;
+  t_symbol* symbol{};
+
+  t_symbol* get(std::string_view v)
+  {
+    if (!symbol || v != text)
+    {
+      text.assign(v);
+      symbol = gensym(text.c_str());
+    }
+    return symbol;
+  }
+};
+
+template <typename V>
+concept symbol_value = std::is_convertible_v<const V&, std::string_view>;
+
+// What an outlet last sent, for the processors which only send the changes
+// and for the symbols of string outputs
+template <typename Processor, typename Field>
+struct outlet_cache
+{
+};
+
+template <typename Processor, typename Field>
+requires avnd::parameter<Field> && (!avnd::sample_accurate_parameter<Field>)
+struct outlet_cache<Processor, Field>
+{
+  using value_type = std::decay_t<decltype(Field::value)>;
+  static constexpr bool changes_only
+      = avnd::changed_outputs_processor<Processor>
+        && std::equality_comparable<value_type>;
+
+  [[no_unique_address]] std::conditional_t<changes_only, std::optional<value_type>, avnd::dummy>
+      last;
+  [[no_unique_address]] std::conditional_t<symbol_value<value_type>, symbol_cache, avnd::dummy>
+      symbol;
+};
+
 template<typename T>
 struct value_writer
 {
     T& self;
 
-    template <avnd::parameter Field, std::size_t Idx>
+    template <avnd::parameter Field, typename Cache, std::size_t Idx>
     requires(!avnd::sample_accurate_parameter<Field>) void
-    operator()(Field& ctrl, t_outlet* port, avnd::num<Idx>) const noexcept
+    operator()(Field& ctrl, t_outlet* port, Cache& cache, avnd::num<Idx>) const noexcept
     {
-      value_to_pd(port, ctrl.value);
+      using value_type = std::decay_t<decltype(ctrl.value)>;
+      if constexpr (Cache::changes_only)
+      {
+        if (cache.last && *cache.last == ctrl.value)
+          return;
+        cache.last = ctrl.value;
+      }
+
+      if constexpr (symbol_value<value_type>)
+        outlet_symbol(port, cache.symbol.get(ctrl.value));
+      else
+        value_to_pd(port, ctrl.value);
     }
 
-    template <avnd::linear_sample_accurate_parameter Field, std::size_t Idx>
-    void operator()(Field& ctrl, t_outlet* port, avnd::num<Idx>) const noexcept
+    template <avnd::linear_sample_accurate_parameter Field, typename Cache, std::size_t Idx>
+    void operator()(Field& ctrl, t_outlet* port, Cache&, avnd::num<Idx>) const noexcept
     {
       auto& buffers = self.control_buffers.linear_inputs;
       // Idx is the index of the port in the complete input array.
@@ -103,8 +163,8 @@ struct value_writer
       }
     }
 
-    template <avnd::dynamic_sample_accurate_parameter Field, std::size_t Idx>
-    void operator()(Field& ctrl, t_outlet* port, avnd::num<Idx>) const noexcept
+    template <avnd::dynamic_sample_accurate_parameter Field, typename Cache, std::size_t Idx>
+    void operator()(Field& ctrl, t_outlet* port, Cache&, avnd::num<Idx>) const noexcept
     {
       for (auto& [timestamp, val] : ctrl.values)
       {
@@ -114,8 +174,8 @@ struct value_writer
     }
 
     // does not make sense as output, only as input
-    template <avnd::span_sample_accurate_parameter Field, std::size_t Idx>
-    void operator()(Field& ctrl, t_outlet* port, avnd::num<Idx>)
+    template <avnd::span_sample_accurate_parameter Field, typename Cache, std::size_t Idx>
+    void operator()(Field& ctrl, t_outlet* port, Cache&, avnd::num<Idx>)
         const noexcept = delete;
 
     void operator()(auto&&...) const noexcept { }
@@ -213,6 +273,7 @@ struct outputs
   {
   }
 
+  // Outlets are sent from right to left, as Pd objects do
   template<typename Self>
   void commit(Self& self)
   {
@@ -220,15 +281,17 @@ struct outputs
     if constexpr(info::size > 0)
     {
       auto& outs = avnd::get_outputs<T>(self.implementation);
-      [&]<typename K, K... Index>(std::integer_sequence<K, Index...>)
+      [&]<std::size_t... I>(std::index_sequence<I...>)
       {
+        constexpr std::size_t last = info::size - 1;
         (value_writer<Self>{self}(
-           boost::pfr::get<Index>(outs),
-           outlets[Index],
-           avnd::num<Index>{}),
+           boost::pfr::get<last - I>(outs),
+           outlets[last - I],
+           std::get<last - I>(caches),
+           avnd::num<last - I>{}),
          ...);
       }
-      (typename info::indices_n{});
+      (std::make_index_sequence<info::size>{});
     }
   }
 
@@ -249,7 +312,11 @@ struct outputs
     }
   }
 
+  template <typename Field>
+  using cache_for = outlet_cache<T, Field>;
+
   std::array<t_outlet*, avnd::output_introspection<T>::size> outlets;
+  avnd::struct_apply<cache_for, typename avnd::outputs_type<T>::type> caches;
 };
 
 }
@@ -6,18 +6,30 @@
 //#include <halp/callback.hpp>
 #include <avnd/introspection/messages.hpp>
 #include <avnd/wrappers/avnd.hpp>
+#include <avnd/introspection/channels.hpp>
 #include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/controls_storage.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
 #include <avnd/wrappers/metadatas.hpp>
-#include <avnd/wrappers/process_adapter.hpp>
+#include <avnd/wrappers/prepare.hpp>
+#include <avnd/wrappers/thread_pool.hpp>
 #include <cmath>
+#include <pybind11/numpy.h>
 #include <pybind11/chrono.h>
 #include <pybind11/complex.h>
 #include <pybind11/functional.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <span>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace python
 {
@@ -54,19 +66,83 @@ constexpr auto output_name(avnd::field_reflection<Idx, C>)
   return "output_" + std::to_string(Idx);
 }
 
+/**
+ * What a Python object of the processor holds: the processor,
+ * and the buffers to run it on NumPy arrays.
+ */
+template <typename T>
+struct instance : avnd::effect_container<T>
+{
+  avnd::host_process_adapter<T> adapter;
+  // Arrays are processed as fast as possible: always offline
+  avnd::process_setup setup{
+      .frames_per_buffer = 4096, .rate = 48000., .mode = avnd::render_mode::offline};
+  int prepared_size{}; // Size of the samples the adapter was last prepared for
+
+  // The automation of the sample-accurate controls for the current block
+  avnd::control_storage<T> control_buffers;
+
+  // For the channels whose samples are not contiguous in the arrays
+  std::vector<char> scratch;
+
+  // Outputs of the chunks of a stream, allocated once by open_stream:
+  // the chunk of process_chunk() is valid until the process_chunk() which reuses its slot.
+  struct
+  {
+    std::vector<py::array> ring;
+    std::size_t next{};
+    int max_frames{};
+  } stream;
+};
+
+/**
+ * One channel of a [channels, frames] (or [frames] for mono) NumPy array.
+ * Channels whose samples follow each other in memory, e.g. the rows of a
+ * C-contiguous array, are processed in place; the others, e.g. in a Fortran-ordered
+ * array, are copied through a scratch buffer one block at a time.
+ */
+struct array_channel
+{
+  char* base{};
+  py::ssize_t stride{};
+};
+
+/**
+ * The changes of a control during a process() call, sorted by frame.
+ * field is the index of the control in the inputs.
+ */
+struct automation_track
+{
+  int field{};
+  std::vector<std::pair<int64_t, double>> points;
+};
+
+// The arrays of a process() call, as can be used without holding the GIL
+struct array_job
+{
+  std::vector<array_channel> ins;
+  std::vector<array_channel> outs;
+  std::vector<automation_track> automation;
+  int frames{};
+};
+
 template <typename T>
 struct processor
 {
+  using object_type = instance<T>;
+
   // m: pybind11 module
-  py::class_<T> class_def;
+  py::class_<object_type> class_def;
 
   template <auto Idx, typename C>
   void setup_input(avnd::field_reflection<Idx, C> refl)
   {
     class_def.def_property(
         c_str(input_name(refl)),
-        [](const T& t) { return boost::pfr::get<Idx>(t.inputs).value; },
-        [](T& t, decltype(C::value) x) { boost::pfr::get<Idx>(t.inputs).value = x; });
+        [](const object_type& t) { return boost::pfr::get<Idx>(t.effect.inputs).value; },
+        [](object_type& t, decltype(C::value) x) {
+          boost::pfr::get<Idx>(t.effect.inputs).value = x;
+        });
   }
 
   template <auto Idx, typename C>
@@ -76,8 +152,10 @@ struct processor
     {
       class_def.def_property(
           c_str(output_name(refl)),
-          [](const T& t) { return boost::pfr::get<Idx>(t.outputs).value; },
-          [](T& t, decltype(C::value) x) { boost::pfr::get<Idx>(t.outputs).value = x; });
+          [](const object_type& t) { return boost::pfr::get<Idx>(t.effect.outputs).value; },
+          [](object_type& t, decltype(C::value) x) {
+            boost::pfr::get<Idx>(t.effect.outputs).value = x;
+          });
     }
   }
 
@@ -99,7 +177,12 @@ struct processor
       }
       else
       {
-        class_def.def(c_str(avnd::get_name<M>()), func);
+        auto member_fun = []<typename... Args>(boost::mp11::mp_list<Args...>) {
+          return [](object_type& t, Args... args) -> decltype(auto) {
+            return (t.effect.*func)(args...);
+          };
+        };
+        class_def.def(c_str(avnd::get_name<M>()), member_fun(typename refl::arguments{}));
       }
     }
     else if constexpr (requires { avnd::function_reflection<M::func()>::count; })
@@ -117,7 +200,11 @@ struct processor
     class_def.def(py::init<>());
     if constexpr (requires { T{}(); })
     {
-      class_def.def("process", &T::operator());
+      class_def.def("process", [](object_type& t) { return t.effect(); });
+    }
+    else if constexpr (avnd::float_processor<T> || avnd::double_processor<T>)
+    {
+      setup_audio();
     }
 
     if constexpr (avnd::inputs_is_value<T>)
@@ -157,11 +244,450 @@ struct processor
       {
         class_def.def_property(
             c_str(avnd::get_name<C>()),
-            [](T& t) { return boost::pfr::get<Idx>(t.outputs).call; },
-            [](T& t, call_type cb)
-            { boost::pfr::get<Idx>(t.outputs).call = std::move(cb); });
+            [](object_type& t) { return boost::pfr::get<Idx>(t.effect.outputs).call; },
+            [](object_type& t, call_type cb)
+            { boost::pfr::get<Idx>(t.effect.outputs).call = std::move(cb); });
+      }
+    }
+  }
+
+  // Channels of a [channels, frames] or [frames] array
+  static std::vector<array_channel> channels_of(const py::array& arr, char* data)
+  {
+    std::vector<array_channel> res;
+    if (arr.ndim() == 1)
+    {
+      res.push_back({data, arr.strides(0)});
+    }
+    else if (arr.ndim() == 2)
+    {
+      for (py::ssize_t c = 0; c < arr.shape(0); c++)
+        res.push_back({data + c * arr.strides(0), arr.strides(1)});
+    }
+    else
+    {
+      throw std::invalid_argument("expected an array of shape [channels, frames]");
+    }
+    return res;
+  }
+
+  template <typename S>
+  static void prepare(object_type& self, int inputs, int outputs)
+  {
+    if (self.prepared_size == sizeof(S) && self.setup.input_channels == inputs
+        && self.setup.output_channels == outputs)
+      return;
+
+    self.setup.input_channels = inputs;
+    self.setup.output_channels = outputs;
+    self.adapter.allocate_buffers(self.setup, S{});
+    self.init_channels(inputs, outputs);
+    self.control_buffers.reserve_space(self, self.setup.frames_per_buffer);
+    avnd::prepare(static_cast<avnd::effect_container<T>&>(self), self.setup);
+    self.prepared_size = sizeof(S);
+  }
+
+  // With the GIL
+  static array_job bind_arrays(const py::array& in, py::array& out)
+  {
+    array_job job;
+    job.ins = channels_of(in, static_cast<char*>(const_cast<void*>(in.data())));
+    job.outs = channels_of(out, static_cast<char*>(out.mutable_data()));
+    job.frames = int(in.shape(in.ndim() - 1));
+    if (out.shape(out.ndim() - 1) != job.frames)
+      throw std::invalid_argument("the inputs and outputs must have the same number of frames");
+    return job;
+  }
+
+  template <typename C>
+  static auto control_value(double v)
+  {
+    using value_type = std::decay_t<decltype(C::value)>;
+    if constexpr (std::is_enum_v<value_type>)
+      return static_cast<value_type>(int(v));
+    else
+      return static_cast<value_type>(v);
+  }
+
+  static void set_control(object_type& self, int field, double v)
+  {
+    avnd::parameter_input_introspection<T>::for_nth_raw(
+        avnd::get_inputs(self), field, [v]<typename C>(C& ctl) {
+          if constexpr (std::is_arithmetic_v<std::decay_t<decltype(C::value)>>
+                        || std::is_enum_v<std::decay_t<decltype(C::value)>>)
+            ctl.value = control_value<C>(v);
+        });
+  }
+
+  // With the GIL. automation maps the names of controls to either:
+  //  - an array of one value per frame, of the length of the inputs,
+  //  - or an array of shape [points, 2] of (frame, value) rows, sorted by frame.
+  static std::vector<automation_track> automation_of(const py::dict& automation, int frames)
+  {
+    std::vector<automation_track> res;
+    if constexpr (avnd::inputs_is_value<T>)
+    {
+      avnd::parameter_input_introspection<T>::for_all(
+          [&]<std::size_t Idx, typename C>(avnd::field_reflection<Idx, C> refl) {
+            const std::string name{input_name(refl)};
+            if (!automation.contains(name))
+              return;
+
+            using array_type = py::array_t<double, py::array::c_style | py::array::forcecast>;
+            auto arr = array_type::ensure(automation[name.c_str()]);
+            if (!arr)
+              throw std::invalid_argument("the automation of " + name + " must be an array");
+
+            auto& track = res.emplace_back();
+            track.field = int(Idx);
+            const double* v = arr.data();
+            if (arr.ndim() == 1 && arr.shape(0) == frames)
+            {
+              // Only the changes are kept
+              for (int i = 0; i < frames; i++)
+                if (i == 0 || v[i] != v[i - 1])
+                  track.points.emplace_back(i, v[i]);
+            }
+            else if (arr.ndim() == 2 && arr.shape(1) == 2)
+            {
+              for (py::ssize_t i = 0; i < arr.shape(0); i++)
+                track.points.emplace_back(int64_t(v[2 * i]), v[2 * i + 1]);
+              std::stable_sort(
+                  track.points.begin(), track.points.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+            }
+            else
+            {
+              throw std::invalid_argument(
+                  "the automation of " + name
+                  + " must have one value per frame or be of shape [points, 2]");
+            }
+          });
+    }
+
+    if (res.size() != py::len(automation))
+      throw std::invalid_argument("the automation names unknown controls");
+    return res;
+  }
+
+  // Without the GIL: does not touch any Python object.
+  // Sample-accurate controls get every change of their automation at its frame;
+  // the other ones change at the start of the blocks of prepare()'s frames_per_buffer.
+  template <typename S>
+  static void run(object_type& self, const array_job& job)
+  {
+    const auto& ins = job.ins;
+    const auto& outs = job.outs;
+    const int frames = job.frames;
+    prepare<S>(self, int(ins.size()), int(outs.size()));
+
+    const int block = self.setup.frames_per_buffer;
+    self.scratch.resize((ins.size() + outs.size()) * block * sizeof(S));
+    std::vector<S*> in_ptrs(ins.size()), out_ptrs(outs.size());
+    std::vector<std::size_t> next_point(job.automation.size());
+
+    for (int pos = 0; pos < frames; pos += block)
+    {
+      const int n = std::min(block, frames - pos);
+      auto scratch = [&](std::size_t k) {
+        return reinterpret_cast<S*>(self.scratch.data()) + k * block;
+      };
+      auto sample = [&](const array_channel& chan, int i) -> S& {
+        return *reinterpret_cast<S*>(chan.base + (pos + i) * chan.stride);
+      };
+
+      for (std::size_t t = 0; t < job.automation.size(); t++)
+      {
+        const auto& track = job.automation[t];
+        for (auto& k = next_point[t]; k < track.points.size(); k++)
+        {
+          const auto [point_frame, value] = track.points[k];
+          if (point_frame >= pos + n)
+            break;
+
+          const int frame = int(std::max<int64_t>(point_frame - pos, 0));
+          if (frame == 0)
+            set_control(self, track.field, value);
+          const bool timed = self.control_buffers.push_input(
+              self, track.field, frame, [value]<typename C>(C&) {
+                return control_value<C>(value);
+              });
+          if (!timed && frame > 0)
+            break;
+        }
+      }
+
+      for (std::size_t c = 0; c < ins.size(); c++)
+      {
+        if (ins[c].stride == sizeof(S))
+        {
+          in_ptrs[c] = &sample(ins[c], 0);
+        }
+        else
+        {
+          in_ptrs[c] = scratch(c);
+          for (int i = 0; i < n; i++)
+            in_ptrs[c][i] = sample(ins[c], i);
+        }
+      }
+      for (std::size_t c = 0; c < outs.size(); c++)
+        out_ptrs[c] = outs[c].stride == sizeof(S) ? &sample(outs[c], 0)
+                                                  : scratch(ins.size() + c);
+
+      self.adapter.process(
+          self, avnd::span<S*>{in_ptrs.data(), in_ptrs.size()},
+          avnd::span<S*>{out_ptrs.data(), out_ptrs.size()}, n);
+      self.control_buffers.clear_inputs(self);
+
+      for (std::size_t c = 0; c < outs.size(); c++)
+        if (outs[c].stride != sizeof(S))
+          for (int i = 0; i < n; i++)
+            sample(outs[c], i) = out_ptrs[c][i];
+    }
+  }
+
+  // With the GIL: checks the arguments and allocates the output if needed
+  template <typename S>
+  static py::array output_for(const py::array& in, std::optional<py::array> out)
+  {
+    const int inputs = in.ndim() == 1 ? 1 : int(in.shape(0));
+    if (avnd::input_channels<T>(inputs) != inputs)
+      throw std::invalid_argument(
+          "expected " + std::to_string(avnd::input_channels<T>(inputs)) + " input channels");
+
+    if (!out)
+    {
+      const auto frames = in.shape(in.ndim() - 1);
+      out = py::array_t<S>(std::vector<py::ssize_t>{avnd::output_channels<T>(inputs), frames});
+    }
+    else if (!out->writeable() || out->dtype().kind() != 'f'
+             || out->itemsize() != py::ssize_t(sizeof(S)))
+    {
+      throw std::invalid_argument("out must be a writeable array of the type of the inputs");
+    }
+
+    return *out;
+  }
+
+  static bool is_double(const py::array& in)
+  {
+    if (in.dtype().kind() == 'f' && in.itemsize() == 4)
+      return false;
+    else if (in.dtype().kind() == 'f' && in.itemsize() == 8)
+      return true;
+    throw std::invalid_argument("expected a float32 or float64 array");
+  }
+
+  template <typename S>
+  static py::array process(
+      object_type& self, const py::array& in, std::optional<py::array> out,
+      const std::optional<py::dict>& automation)
+  {
+    py::array res = output_for<S>(in, std::move(out));
+    array_job job = bind_arrays(in, res);
+    if (automation)
+      job.automation = automation_of(*automation, job.frames);
+
+    py::gil_scoped_release release;
+    run<S>(self, job);
+    return res;
+  }
+
+  // Allocates the output ring of the stream, and prepares the processor for chunks
+  // of up to max_frames of the given number of input channels
+  template <typename S>
+  static void open_stream(object_type& self, int max_frames, int channels, int ring)
+  {
+    if (max_frames <= 0 || ring <= 0)
+      throw std::invalid_argument("max_frames and ring must be positive");
+
+    const int inputs = avnd::input_channels<T>(channels);
+    const int outputs = avnd::output_channels<T>(inputs);
+    self.setup.frames_per_buffer = max_frames;
+    self.prepared_size = 0;
+    prepare<S>(self, inputs, outputs);
+
+    auto& st = self.stream;
+    st.ring.clear();
+    for (int i = 0; i < ring; i++)
+      st.ring.push_back(py::array_t<S>(std::vector<py::ssize_t>{outputs, max_frames}));
+    st.next = 0;
+    st.max_frames = max_frames;
+  }
+
+  // Processes a chunk into the next slot of the ring: does not allocate any sample
+  static py::array process_chunk(object_type& self, const py::array& in)
+  {
+    auto& st = self.stream;
+    if (st.ring.empty())
+      throw std::logic_error("open_stream() must be called before process_chunk()");
+
+    const py::ssize_t frames = in.shape(in.ndim() - 1);
+    if (frames > st.max_frames)
+      throw std::invalid_argument(
+          "chunks must have at most " + std::to_string(st.max_frames) + " frames");
+
+    py::array& slot = st.ring[st.next];
+    st.next = (st.next + 1) % st.ring.size();
+    if (is_double(in) != (slot.itemsize() == sizeof(double)))
+      throw std::invalid_argument("chunks must have the type the stream was opened with");
+
+    // A view on the beginning of the slot for the last, shorter chunks
+    py::array out = frames == st.max_frames
+                        ? slot
+                        : py::array(
+                            slot.dtype(), std::vector<py::ssize_t>{slot.shape(0), frames},
+                            std::vector<py::ssize_t>{slot.strides(0), slot.strides(1)},
+                            slot.data(), slot);
+    const array_job job = bind_arrays(in, out);
+
+    py::gil_scoped_release release;
+    if (slot.itemsize() == sizeof(double))
+      run<double>(self, job);
+    else
+      run<float>(self, job);
+    return out;
+  }
+
+  // Iterates over the chunks of a Python iterable, e.g. of a network client,
+  // yielding the processed chunks
+  struct stream_iterator
+  {
+    object_type& self;
+    py::object source;
+
+    py::array next()
+    {
+      py::handle item = PyIter_Next(source.ptr());
+      if (!item)
+      {
+        if (PyErr_Occurred())
+          throw py::error_already_set();
+        throw py::stop_iteration();
       }
+      return process_chunk(self, py::array{py::reinterpret_steal<py::object>(item)});
+    }
+  };
+
+  // Sets the controls named in the dict, e.g. {"Weight": 0.3}
+  static void set_parameters(object_type& t, const py::dict& params)
+  {
+    if constexpr (avnd::inputs_is_value<T>)
+    {
+      avnd::parameter_input_introspection<T>::for_all(
+          [&]<std::size_t Idx, typename C>(avnd::field_reflection<Idx, C> refl) {
+            const std::string name{input_name(refl)};
+            if (params.contains(name))
+              boost::pfr::get<Idx>(t.effect.inputs).value
+                  = params[name.c_str()].template cast<decltype(C::value)>();
+          });
+    }
+  }
+
+  // Renders each array with its own copy of the processor, on native threads:
+  // a job gets the controls of self, then the ones of its entry in params.
+  static py::list process_batch(
+      object_type& self, const py::list& inputs, std::optional<py::list> params, int threads)
+  {
+    struct batch_job
+    {
+      std::unique_ptr<object_type> processor;
+      py::array input;
+      py::array output;
+      array_job arrays;
+      bool is_double{};
+    };
+
+    const std::size_t count = py::len(inputs);
+    if (params && py::len(*params) != count)
+      throw std::invalid_argument("params must have one entry per input");
+
+    std::vector<batch_job> jobs(count);
+    py::list res;
+    for (std::size_t i = 0; i < count; i++)
+    {
+      auto& job = jobs[i];
+      job.input = inputs[i].template cast<py::array>();
+      job.is_double = is_double(job.input);
+      job.output = job.is_double ? output_for<double>(job.input, std::nullopt)
+                                 : output_for<float>(job.input, std::nullopt);
+      job.arrays = bind_arrays(job.input, job.output);
+
+      job.processor = std::make_unique<object_type>();
+      job.processor->setup = self.setup;
+      if constexpr (avnd::inputs_is_value<T> && std::is_copy_assignable_v<decltype(T::inputs)>)
+        job.processor->effect.inputs = self.effect.inputs;
+      if (params)
+        set_parameters(*job.processor, (*params)[i].template cast<py::dict>());
+      res.append(job.output);
+    }
+
+    {
+      py::gil_scoped_release release;
+      avnd::thread_pool pool{
+          (threads > 0 ? threads : int(std::thread::hardware_concurrency())) - 1};
+      pool.run(int(count), [&](int i) {
+        auto& job = jobs[i];
+        if (job.is_double)
+          run<double>(*job.processor, job.arrays);
+        else
+          run<float>(*job.processor, job.arrays);
+      });
     }
+    return res;
+  }
+
+  // process(inputs, out=None, automation=None): runs the processor on float32 or float64
+  // arrays of shape [channels, frames], without copying them when their rows are contiguous.
+  // automation: {"control name": array}, see automation_of.
+  // process_batch(inputs, params=None, threads=0): a list of those, in parallel.
+  // open_stream(max_frames, channels=2, ring=2, double=False), then
+  // process_chunk(inputs) or stream(iterable): for unbounded sources, see open_stream.
+  void setup_audio()
+  {
+    class_def.def(
+        "prepare",
+        [](object_type& self, double rate, int frames_per_buffer) {
+          self.setup.rate = rate;
+          self.setup.frames_per_buffer = std::max(frames_per_buffer, 1);
+          self.prepared_size = 0;
+        },
+        py::arg("rate") = 48000., py::arg("frames_per_buffer") = 4096);
+
+    class_def.def(
+        "process",
+        [](object_type& self, const py::array& in, std::optional<py::array> out,
+           std::optional<py::dict> automation) {
+          return is_double(in) ? process<double>(self, in, std::move(out), automation)
+                               : process<float>(self, in, std::move(out), automation);
+        },
+        py::arg("inputs"), py::arg("out") = py::none(), py::arg("automation") = py::none());
+
+    class_def.def(
+        "process_batch", &processor::process_batch, py::arg("inputs"),
+        py::arg("params") = py::none(), py::arg("threads") = 0);
+
+    class_def.def(
+        "open_stream",
+        [](object_type& self, int max_frames, int channels, int ring, bool is_double) {
+          if (is_double)
+            open_stream<double>(self, max_frames, channels, ring);
+          else
+            open_stream<float>(self, max_frames, channels, ring);
+        },
+        py::arg("max_frames"), py::arg("channels") = 2, py::arg("ring") = 2,
+        py::arg("double") = false);
+    class_def.def("process_chunk", &processor::process_chunk, py::arg("inputs"));
+
+    py::class_<stream_iterator>(class_def, "Stream")
+        .def("__iter__", [](stream_iterator& it) -> stream_iterator& { return it; })
+        .def("__next__", &stream_iterator::next);
+    class_def.def(
+        "stream",
+        [](object_type& self, py::object iterable) {
+          return stream_iterator{self, py::iter(iterable)};
+        },
+        py::keep_alive<0, 1>(), py::arg("chunks"));
   }
 };
 }
@@ -0,0 +1,299 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#if __has_include(<portaudio.h>)
+#define AVND_STANDALONE_PORTAUDIO 1
+#include <avnd/introspection/channels.hpp>
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/interleaved.hpp>
+#include <avnd/wrappers/prepare.hpp>
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+
+#include <portaudio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace standalone
+{
+struct audio_settings
+{
+  // What is asked to the device, the driver may pick something close
+  double rate{48000.};
+  int frames_per_buffer{64};
+
+  // Device indices, as listed by Pa_GetDeviceInfo; -1 for the default ones
+  int input_device{-1};
+  int output_device{-1};
+};
+
+/**
+ * An audio stream on the audio interface, through PortAudio:
+ * JACK, ALSA, CoreAudio, WASAPI, ASIO... depending on how it was built.
+ *
+ * The callback runs on the thread of the driver, which is given a realtime
+ * priority by the host APIs which support it. Samples are exchanged
+ * as non-interleaved floats, or interleaved ones when the processor works on
+ * them directly; the channels the devices do not have are silent on input
+ * and discarded on output.
+ */
+class audio_stream
+{
+public:
+  audio_stream() { m_initialized = Pa_Initialize() == paNoError; }
+
+  audio_stream(const audio_stream&) = delete;
+  audio_stream& operator=(const audio_stream&) = delete;
+
+  virtual ~audio_stream()
+  {
+    close();
+    if (m_initialized)
+      Pa_Terminate();
+  }
+
+  void stop() { close(); }
+
+  double sample_rate() const noexcept { return m_rate; }
+  int frames_per_buffer() const noexcept { return m_frames; }
+
+  // Round-trip latency reported by the driver, in seconds
+  double latency() const noexcept { return m_latency; }
+
+  // Called on the audio thread before and after each buffer, e.g. to exchange
+  // the controls with the network. Must be set before start().
+  std::function<void()> before_process;
+  std::function<void()> after_process;
+
+protected:
+  // Called before the stream starts, with what the driver actually runs at
+  virtual void prepare(double rate, int frames) = 0;
+
+  // Audio thread
+  virtual void process(float** ins, float** outs, int frames) = 0;
+
+  // Audio thread, for streams opened interleaved: as many channels in and out
+  virtual void process_interleaved(const float* ins, float* outs, int frames) { }
+
+  // Must be called by the destructor of derived classes, the callback calls process()
+  void close()
+  {
+    if (!m_stream)
+      return;
+    Pa_StopStream(m_stream);
+    Pa_CloseStream(m_stream);
+    m_stream = nullptr;
+  }
+
+  bool open(
+      const audio_settings& settings, int inputs, int outputs, bool interleaved = false)
+  {
+    if (!m_initialized || m_stream)
+      return false;
+
+    // Interleaved frames are what most drivers use: PortAudio then has nothing to copy
+    interleaved = interleaved && inputs == outputs;
+    auto parameters = [interleaved](
+                          int device, bool input, int channels, PaStreamParameters& p) {
+      if (device < 0)
+        device = input ? Pa_GetDefaultInputDevice() : Pa_GetDefaultOutputDevice();
+      const PaDeviceInfo* info = device >= 0 ? Pa_GetDeviceInfo(device) : nullptr;
+      if (!info || channels == 0)
+        return false;
+
+      p.device = device;
+      p.channelCount = channels;
+      p.sampleFormat = interleaved ? paFloat32 : paFloat32 | paNonInterleaved;
+      p.suggestedLatency
+          = input ? info->defaultLowInputLatency : info->defaultLowOutputLatency;
+      p.hostApiSpecificStreamInfo = nullptr;
+      return true;
+    };
+
+    PaStreamParameters in{}, out{};
+    const bool has_in = parameters(settings.input_device, true, inputs, in);
+    const bool has_out = parameters(settings.output_device, false, outputs, out);
+    if (!has_in && !has_out)
+      return false;
+
+    // A fixed buffer size: PortAudio adapts if the driver uses another one
+    PaError err = Pa_OpenStream(
+        &m_stream, has_in ? &in : nullptr, has_out ? &out : nullptr, settings.rate,
+        settings.frames_per_buffer, paClipOff | paDitherOff, &callback, this);
+    if (err != paNoError)
+    {
+      std::fprintf(stderr, "Cannot open the audio stream: %s\n", Pa_GetErrorText(err));
+      m_stream = nullptr;
+      return false;
+    }
+
+    // The rate the driver actually runs at
+    const PaStreamInfo* info = Pa_GetStreamInfo(m_stream);
+    m_rate = info ? info->sampleRate : settings.rate;
+    m_latency = info ? info->inputLatency + info->outputLatency : 0.;
+    m_frames = settings.frames_per_buffer;
+    m_device_inputs = has_in ? inputs : 0;
+    m_device_outputs = has_out ? outputs : 0;
+    m_interleaved = interleaved;
+
+    // Interleaved, they stand for a whole missing device
+    const std::size_t silent_channels = interleaved ? std::max(inputs, 1) : 1;
+    m_silence.assign(std::size_t(m_frames) * silent_channels, 0.f);
+    m_scratch.assign(std::size_t(m_frames) * silent_channels, 0.f);
+    m_ins.assign(std::size_t(inputs), m_silence.data());
+    m_outs.assign(std::size_t(outputs), m_scratch.data());
+
+    prepare(m_rate, m_frames);
+
+    if (Pa_StartStream(m_stream) != paNoError)
+    {
+      Pa_CloseStream(m_stream);
+      m_stream = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+private:
+  static int callback(
+      const void* input, void* output, unsigned long frames,
+      const PaStreamCallbackTimeInfo*, PaStreamCallbackFlags, void* ctx)
+  {
+    auto& self = *static_cast<audio_stream*>(ctx);
+    if (self.before_process)
+      self.before_process();
+
+    const int n = int(std::min<unsigned long>(frames, self.m_frames));
+    if (self.m_interleaved)
+    {
+      self.process_interleaved(
+          self.m_device_inputs ? static_cast<const float*>(input) : self.m_silence.data(),
+          self.m_device_outputs ? static_cast<float*>(output) : self.m_scratch.data(), n);
+
+      if (self.after_process)
+        self.after_process();
+      return paContinue;
+    }
+
+    auto ins = static_cast<float* const*>(input);
+    auto outs = static_cast<float* const*>(output);
+    for (int i = 0; i < self.m_device_inputs; i++)
+      self.m_ins[i] = ins[i];
+    for (int i = 0; i < self.m_device_outputs; i++)
+      self.m_outs[i] = outs[i];
+
+    self.process(self.m_ins.data(), self.m_outs.data(), n);
+
+    if (self.after_process)
+      self.after_process();
+    return paContinue;
+  }
+
+  PaStream* m_stream{};
+  bool m_initialized{};
+  double m_rate{};
+  double m_latency{};
+  int m_frames{};
+  int m_device_inputs{};
+  int m_device_outputs{};
+  bool m_interleaved{};
+
+  std::vector<float> m_silence;
+  std::vector<float> m_scratch;
+  std::vector<float*> m_ins;
+  std::vector<float*> m_outs;
+};
+
+/**
+ * Runs an effect on the audio interface. Processors working in double
+ * precision get conversion buffers from the process_adapter.
+ */
+template <typename T>
+class audio_engine final : public audio_stream
+{
+public:
+  explicit audio_engine(avnd::effect_container<T>& effect)
+      : m_effect{effect}
+  {
+  }
+
+  ~audio_engine() { close(); }
+
+  bool start(const audio_settings& settings = {})
+  {
+    m_inputs = avnd::input_channels<T>(2);
+    m_outputs = avnd::output_channels<T>(2);
+    return open(settings, m_inputs, m_outputs, interleaved);
+  }
+
+private:
+  void prepare(double rate, int frames) override
+  {
+    avnd::process_setup setup_info{
+        .input_channels = m_inputs,
+        .output_channels = m_outputs,
+        .frames_per_buffer = frames,
+        .rate = rate};
+
+    if constexpr (avnd::has_inputs<T>)
+      avnd::init_controls(m_effect.inputs());
+
+    m_processor.allocate_buffers(setup_info, float{});
+    m_effect.init_channels(m_inputs, m_outputs);
+    avnd::prepare(m_effect, setup_info);
+  }
+
+  void process(float** ins, float** outs, int frames) override
+  {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    m_processor.process(
+        m_effect, avnd::span<float*>{ins, std::size_t(m_inputs)},
+        avnd::span<float*>{outs, std::size_t(m_outputs)}, frames);
+  }
+
+  void process_interleaved(const float* ins, float* outs, int frames) override
+  {
+    if constexpr (interleaved)
+    {
+      [[maybe_unused]] avnd::denormals_guard<T> denormals;
+      [[maybe_unused]] avnd::realtime_scope realtime;
+      m_processor.process(
+          m_effect, avnd::interleaved_buffer<const float>{ins, m_inputs, frames},
+          avnd::interleaved_buffer<float>{outs, m_outputs, frames}, frames);
+    }
+  }
+
+  // The per-sample processors go through the interleaved frames of the driver as they are
+  static constexpr bool interleaved
+      = avnd::interleaved_process_adapter<T>::template direct<float>();
+
+  avnd::effect_container<T>& m_effect;
+  [[no_unique_address]] std::conditional_t<
+      interleaved, avnd::interleaved_process_adapter<T>, avnd::host_process_adapter<T>>
+      m_processor;
+  int m_inputs{};
+  int m_outputs{};
+};
+
+// For headless boxes: keeps the audio running until SIGINT or SIGTERM
+inline void wait_for_termination()
+{
+  static volatile std::sig_atomic_t quit = 0;
+  std::signal(SIGINT, [](int) { quit = 1; });
+  std::signal(SIGTERM, [](int) { quit = 1; });
+  while (!quit)
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+}
+#endif
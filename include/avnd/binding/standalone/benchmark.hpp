@@ -0,0 +1,797 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/standalone/audio.hpp>
+#include <avnd/wrappers/metadatas.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if AVND_STANDALONE_PORTAUDIO
+#include <avnd/wrappers/latency.hpp>
+
+#include <thread>
+#endif
+
+#if AVND_STANDALONE_PORTAUDIO && __has_include(<ossia/dataflow/execution_state.hpp>)
+#define AVND_STANDALONE_OSSIA_BENCHMARK 1
+#include <avnd/binding/ossia/all.hpp>
+#include <avnd/binding/ossia/configure.hpp>
+#include <ossia/dataflow/execution_state.hpp>
+#include <ossia/dataflow/port.hpp>
+#include <ossia/dataflow/token_request.hpp>
+#endif
+
+/**
+ * Benchmark mode of the standalone binding: measures, on the audio interface,
+ * the round-trip latency and the jitter of the audio callbacks at several period sizes,
+ * to choose the hardware and buffer sizes of an installation:
+ *
+ * ./Foo_standalone --benchmark --periods=32,64,256 --duration=10 --output=foo.json
+ *
+ * An output of the interface must be connected to one of its inputs with a cable.
+ * Every --probe-interval, an impulse is sent through the processor to the output;
+ * the round trip is the time until it comes back on the input. It thus includes the
+ * latency of the processor, also reported, and the impulse has to survive it.
+ * Processors without audio inputs get the impulse added to their output.
+ *
+ * The arrival of each callback is timed with std::chrono::steady_clock:
+ * the jitter is how far the intervals between callbacks are from the period.
+ * The time spent in the callback is reported as well.
+ *
+ * Each measurement runs through the standalone path, i.e. the processor called as
+ * by standalone::audio_engine, and through the ossia path, i.e. an oscr::safe_node
+ * run as the ossia graph does, when built with libossia.
+ *
+ * The options, which all have defaults:
+ *  --periods=32,64,128,256,512   frames per buffer
+ *  --paths=standalone,ossia
+ *  --duration=5                  seconds per period and path
+ *  --rate=48000
+ *  --probe-interval=0.25         seconds between impulses
+ *  --threshold=0.1               level over which the impulse is back
+ *  --bin=0.05                    width of the bins of the jitter histogram, in ms
+ *  --input-device=N, --output-device=N   as listed by PortAudio, default ones otherwise
+ *  --input-channel=0, --output-channel=0 where the loopback cable is
+ *  --output=file.json            stdout otherwise
+ */
+namespace standalone
+{
+struct benchmark_options
+{
+  std::vector<int> periods{32, 64, 128, 256, 512};
+  std::vector<std::string> paths{"standalone", "ossia"};
+  double duration{5.};
+  double rate{48000.};
+  double probe_interval{0.25};
+  double threshold{0.1};
+  double bin_ms{0.05};
+  int input_device{-1};
+  int output_device{-1};
+  int input_channel{};
+  int output_channel{};
+  std::string output;
+};
+
+// The benchmark options if --benchmark is among the arguments, nothing otherwise
+inline std::optional<benchmark_options> parse_benchmark_options(int argc, char** argv)
+{
+  bool benchmark = false;
+  benchmark_options opts;
+
+  auto to_int = [](std::string_view s, int& res) {
+    return std::from_chars(s.data(), s.data() + s.size(), res).ec == std::errc{};
+  };
+  auto to_positive = [](std::string_view s, double& res) {
+    return std::from_chars(s.data(), s.data() + s.size(), res).ec == std::errc{} && res > 0.;
+  };
+  auto to_list = [](std::string_view s, auto&& add) {
+    for (std::size_t p = 0; p <= s.size();)
+    {
+      const std::size_t comma = std::min(s.find(',', p), s.size());
+      if (!add(s.substr(p, comma - p)))
+        return false;
+      p = comma + 1;
+    }
+    return true;
+  };
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string_view arg = argv[i];
+    const std::size_t eq = arg.find('=');
+    const auto key = arg.substr(0, eq);
+    const auto value = eq == std::string_view::npos ? std::string_view{} : arg.substr(eq + 1);
+
+    bool ok = true;
+    if (key == "--benchmark")
+      benchmark = true;
+    else if (key == "--periods")
+    {
+      opts.periods.clear();
+      ok = to_list(value, [&](std::string_view s) {
+        int v{};
+        if (!to_int(s, v) || v <= 0)
+          return false;
+        opts.periods.push_back(v);
+        return true;
+      });
+    }
+    else if (key == "--paths")
+    {
+      opts.paths.clear();
+      ok = to_list(value, [&](std::string_view s) {
+        opts.paths.emplace_back(s);
+        return s == "standalone" || s == "ossia";
+      });
+    }
+    else if (key == "--duration")
+      ok = to_positive(value, opts.duration);
+    else if (key == "--rate")
+      ok = to_positive(value, opts.rate);
+    else if (key == "--probe-interval")
+      ok = to_positive(value, opts.probe_interval);
+    else if (key == "--threshold")
+      ok = to_positive(value, opts.threshold);
+    else if (key == "--bin")
+      ok = to_positive(value, opts.bin_ms);
+    else if (key == "--input-device")
+      ok = to_int(value, opts.input_device);
+    else if (key == "--output-device")
+      ok = to_int(value, opts.output_device);
+    else if (key == "--input-channel")
+      ok = to_int(value, opts.input_channel) && opts.input_channel >= 0;
+    else if (key == "--output-channel")
+      ok = to_int(value, opts.output_channel) && opts.output_channel >= 0;
+    else if (key == "--output")
+      opts.output = value;
+
+    if (!ok)
+    {
+      std::fprintf(stderr, "Invalid benchmark option: %s\n", argv[i]);
+      return std::nullopt;
+    }
+  }
+
+  if (!benchmark || opts.periods.empty() || opts.paths.empty())
+    return std::nullopt;
+  return opts;
+}
+
+/**
+ * Audio thread: sends an impulse every interval and waits for it to come back.
+ * reset() allocates, process() does not: the round trips past the capacity are dropped.
+ */
+class latency_probe
+{
+public:
+  void reset(double rate, double interval, double threshold, int max_probes)
+  {
+    m_interval = std::max(int64_t(interval * rate), int64_t(1));
+    m_threshold = float(threshold);
+    m_round_trips.clear();
+    m_round_trips.reserve(std::max(max_probes, 0));
+    m_time = 0;
+    // The first impulse leaves the driver the time to settle
+    m_next = m_interval;
+    m_sent_at = -1;
+    m_sent = 0;
+    m_missed = 0;
+  }
+
+  // returned: the input on which the impulse comes back.
+  // probe: overwritten by the signal to send, silence but for the impulses.
+  void process(const float* returned, float* probe, int frames) noexcept
+  {
+    for (int i = 0; i < frames; i++)
+    {
+      const int64_t t = m_time + i;
+      if (m_sent_at >= 0 && std::abs(returned[i]) > m_threshold)
+      {
+        if (m_round_trips.size() < m_round_trips.capacity())
+          m_round_trips.push_back(t - m_sent_at);
+        m_sent_at = -1;
+      }
+
+      probe[i] = 0.f;
+      if (t == m_next)
+      {
+        // The previous impulse never came back
+        if (m_sent_at >= 0)
+          m_missed++;
+        probe[i] = impulse;
+        m_sent_at = t;
+        m_sent++;
+        m_next += m_interval;
+      }
+    }
+    m_time += frames;
+  }
+
+  // In frames
+  const std::vector<int64_t>& round_trips() const noexcept { return m_round_trips; }
+  int sent() const noexcept { return m_sent; }
+  int missed() const noexcept { return m_missed; }
+
+  static constexpr float impulse = 0.5f;
+
+private:
+  std::vector<int64_t> m_round_trips;
+  int64_t m_interval{1};
+  int64_t m_time{};
+  int64_t m_next{};
+  int64_t m_sent_at{-1};
+  float m_threshold{0.1f};
+  int m_sent{};
+  int m_missed{};
+};
+
+/**
+ * Audio thread: the time at which each callback starts and ends.
+ * reset() allocates, begin() and end() do not: the callbacks past the capacity
+ * are not timed.
+ */
+class callback_timer
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  void reset(int max_callbacks)
+  {
+    m_begin.clear();
+    m_end.clear();
+    m_begin.reserve(std::max(max_callbacks, 0));
+    m_end.reserve(std::max(max_callbacks, 0));
+  }
+
+  void begin(clock::time_point t = clock::now()) noexcept
+  {
+    if (m_begin.size() < m_begin.capacity())
+      m_begin.push_back(t);
+  }
+
+  void end(clock::time_point t = clock::now()) noexcept
+  {
+    if (m_end.size() < m_begin.size())
+      m_end.push_back(t);
+  }
+
+  const std::vector<clock::time_point>& arrivals() const noexcept { return m_begin; }
+  const std::vector<clock::time_point>& completions() const noexcept { return m_end; }
+
+private:
+  std::vector<clock::time_point> m_begin;
+  std::vector<clock::time_point> m_end;
+};
+
+struct latency_stats
+{
+  int sent{};
+  int received{};
+  int missed{};
+  int64_t min_frames{};
+  int64_t max_frames{};
+  double mean_frames{};
+  double stddev_frames{};
+};
+
+struct jitter_stats
+{
+  int callbacks{};
+  double period_ms{}; // frames / rate
+  double mean_ms{};   // of the intervals between two callbacks
+  double stddev_ms{};
+  double min_ms{};
+  double max_ms{};
+  // |interval - period|
+  double p99_deviation_ms{};
+  double max_deviation_ms{};
+  // Time spent in the callbacks, and its ratio to the period
+  double mean_callback_ms{};
+  double max_callback_ms{};
+  double load{};
+
+  // Count of the intervals in [k * bin_ms; (k + 1) * bin_ms[, up to twice the period
+  // and the last bin for all the longer ones
+  double bin_ms{};
+  std::vector<int> histogram;
+};
+
+inline latency_stats compute_latency(const latency_probe& probe)
+{
+  latency_stats res;
+  const auto& rt = probe.round_trips();
+  res.sent = probe.sent();
+  res.received = int(rt.size());
+  res.missed = probe.missed();
+  if (rt.empty())
+    return res;
+
+  auto [min, max] = std::minmax_element(rt.begin(), rt.end());
+  res.min_frames = *min;
+  res.max_frames = *max;
+
+  double sum{}, sq{};
+  for (auto v : rt)
+    sum += double(v);
+  res.mean_frames = sum / double(rt.size());
+  for (auto v : rt)
+    sq += (double(v) - res.mean_frames) * (double(v) - res.mean_frames);
+  res.stddev_frames = std::sqrt(sq / double(rt.size()));
+  return res;
+}
+
+inline jitter_stats compute_jitter(const callback_timer& timer, double period_ms, double bin_ms)
+{
+  using ms = std::chrono::duration<double, std::milli>;
+
+  jitter_stats res;
+  res.period_ms = period_ms;
+  res.bin_ms = bin_ms;
+  res.histogram.assign(std::size_t(std::ceil(2. * period_ms / bin_ms)) + 1, 0);
+
+  const auto& arrivals = timer.arrivals();
+  const auto& completions = timer.completions();
+  res.callbacks = int(arrivals.size());
+
+  for (std::size_t i = 0; i < completions.size(); i++)
+  {
+    const double d = ms(completions[i] - arrivals[i]).count();
+    res.mean_callback_ms += d;
+    res.max_callback_ms = std::max(res.max_callback_ms, d);
+  }
+  if (!completions.empty())
+    res.mean_callback_ms /= double(completions.size());
+  res.load = period_ms > 0. ? res.mean_callback_ms / period_ms : 0.;
+
+  if (arrivals.size() < 2)
+    return res;
+
+  std::vector<double> intervals(arrivals.size() - 1);
+  for (std::size_t i = 1; i < arrivals.size(); i++)
+    intervals[i - 1] = ms(arrivals[i] - arrivals[i - 1]).count();
+
+  auto [min, max] = std::minmax_element(intervals.begin(), intervals.end());
+  res.min_ms = *min;
+  res.max_ms = *max;
+
+  double sum{}, sq{};
+  for (double v : intervals)
+    sum += v;
+  res.mean_ms = sum / double(intervals.size());
+
+  std::vector<double> deviations(intervals.size());
+  for (std::size_t i = 0; i < intervals.size(); i++)
+  {
+    const double v = intervals[i];
+    sq += (v - res.mean_ms) * (v - res.mean_ms);
+    deviations[i] = std::abs(v - period_ms);
+
+    const auto bin = std::min(std::size_t(v / bin_ms), res.histogram.size() - 1);
+    res.histogram[bin]++;
+  }
+  res.stddev_ms = std::sqrt(sq / double(intervals.size()));
+
+  std::sort(deviations.begin(), deviations.end());
+  res.p99_deviation_ms = deviations[std::size_t(0.99 * double(deviations.size() - 1))];
+  res.max_deviation_ms = deviations.back();
+  return res;
+}
+
+struct benchmark_result
+{
+  std::string path;
+  int period{};
+  double rate{};              // What the driver actually runs at
+  double driver_latency_ms{}; // Input and output latencies reported by the driver
+  int64_t processor_latency{};
+  latency_stats latency;
+  jitter_stats jitter;
+};
+
+// What the results were measured on, to compare machine configurations
+struct benchmark_machine
+{
+  std::string host_api;
+  std::string input_device;
+  std::string output_device;
+  unsigned threads{};
+};
+
+inline void write_json_string(std::FILE* f, std::string_view s)
+{
+  std::fputc('"', f);
+  for (char c : s)
+  {
+    if (c == '"' || c == '\\')
+      std::fprintf(f, "\\%c", c);
+    else if (static_cast<unsigned char>(c) < 0x20)
+      std::fprintf(f, "\\u%04x", c);
+    else
+      std::fputc(c, f);
+  }
+  std::fputc('"', f);
+}
+
+template <typename T>
+void write_json(
+    std::FILE* f, const benchmark_options& opts, const benchmark_machine& machine,
+    const std::vector<benchmark_result>& res)
+{
+  std::fprintf(f, "{\n  \"processor\": ");
+  write_json_string(f, avnd::get_name<T>());
+  std::fprintf(f, ",\n  \"machine\": {\"host_api\": ");
+  write_json_string(f, machine.host_api);
+  std::fprintf(f, ", \"input_device\": ");
+  write_json_string(f, machine.input_device);
+  std::fprintf(f, ", \"output_device\": ");
+  write_json_string(f, machine.output_device);
+  std::fprintf(
+      f,
+      ", \"threads\": %u},\n  \"rate\": %g,\n  \"duration\": %g,\n  \"probe_interval\": %g,\n"
+      "  \"threshold\": %g,\n  \"results\": [",
+      machine.threads, opts.rate, opts.duration, opts.probe_interval, opts.threshold);
+
+  for (std::size_t i = 0; i < res.size(); i++)
+  {
+    const auto& r = res[i];
+    const auto& l = r.latency;
+    const auto& j = r.jitter;
+    const double frame_ms = r.rate > 0. ? 1000. / r.rate : 0.;
+    std::fprintf(f, "%s\n    {\"path\": ", i == 0 ? "" : ",");
+    write_json_string(f, r.path);
+    std::fprintf(
+        f,
+        ", \"period\": %d, \"rate\": %g, \"driver_latency_ms\": %.3f, "
+        "\"processor_latency_frames\": %lld,\n"
+        "     \"latency\": {\"sent\": %d, \"received\": %d, \"missed\": %d, "
+        "\"min_frames\": %lld, \"max_frames\": %lld, \"mean_frames\": %.2f, "
+        "\"stddev_frames\": %.2f, \"mean_ms\": %.3f},\n"
+        "     \"jitter\": {\"callbacks\": %d, \"period_ms\": %.4f, \"mean_ms\": %.4f, "
+        "\"stddev_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, "
+        "\"p99_deviation_ms\": %.4f, \"max_deviation_ms\": %.4f, "
+        "\"mean_callback_ms\": %.4f, \"max_callback_ms\": %.4f, \"load\": %.4f, "
+        "\"bin_ms\": %g, \"histogram\": [",
+        r.period, r.rate, r.driver_latency_ms, (long long)r.processor_latency, l.sent,
+        l.received, l.missed, (long long)l.min_frames, (long long)l.max_frames,
+        l.mean_frames, l.stddev_frames, l.mean_frames * frame_ms, j.callbacks, j.period_ms,
+        j.mean_ms, j.stddev_ms, j.min_ms, j.max_ms, j.p99_deviation_ms, j.max_deviation_ms,
+        j.mean_callback_ms, j.max_callback_ms, j.load, j.bin_ms);
+    for (std::size_t k = 0; k < j.histogram.size(); k++)
+      std::fprintf(f, "%s%d", k == 0 ? "" : ", ", j.histogram[k]);
+    std::fprintf(f, "]}}");
+  }
+  std::fprintf(f, "\n  ]\n}\n");
+}
+
+#if AVND_STANDALONE_PORTAUDIO
+/**
+ * The processor called as standalone::audio_engine does.
+ */
+template <typename T>
+struct standalone_path
+{
+  static constexpr std::string_view name = "standalone";
+
+  avnd::effect_container<T> effect;
+  avnd::host_process_adapter<T> processor;
+  int inputs{avnd::input_channels<T>(2)};
+  int outputs{avnd::output_channels<T>(2)};
+
+  void prepare(double rate, int frames)
+  {
+    avnd::process_setup setup_info{
+        .input_channels = inputs,
+        .output_channels = outputs,
+        .frames_per_buffer = frames,
+        .rate = rate};
+
+    if constexpr (avnd::has_inputs<T>)
+      avnd::init_controls(effect.inputs());
+
+    processor.allocate_buffers(setup_info, float{});
+    effect.init_channels(inputs, outputs);
+    avnd::prepare(effect, setup_info);
+  }
+
+  int64_t latency() { return avnd::latency_samples(effect); }
+
+  void process(float** ins, float** outs, int frames)
+  {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    processor.process(
+        effect, avnd::span<float*>{ins, std::size_t(inputs)},
+        avnd::span<float*>{outs, std::size_t(outputs)}, frames);
+  }
+};
+
+#if AVND_STANDALONE_OSSIA_BENCHMARK
+/**
+ * The processor in an oscr::safe_node, given its audio and run
+ * once per callback as the ossia graph does.
+ */
+template <typename T>
+struct ossia_path
+{
+  static constexpr std::string_view name = "ossia";
+
+  std::shared_ptr<oscr::safe_node<T>> node;
+  ossia::execution_state state;
+  ossia::audio_port* audio_in{};
+  ossia::audio_port* audio_out{};
+  int64_t time{};
+  int inputs{avnd::input_channels<T>(2)};
+  int outputs{avnd::output_channels<T>(2)};
+
+  void prepare(double rate, int frames)
+  {
+    node = oscr::make_node<T>(frames, rate);
+    state.bufferSize = frames;
+    state.sampleRate = rate;
+    // The dates of the token requests are in frames
+    state.modelToSamplesRatio = 1.;
+    time = 0;
+
+    audio_in = nullptr;
+    for (auto* inlet : node->root_inputs())
+      if ((audio_in = inlet->template target<ossia::audio_port>()))
+        break;
+    audio_out = nullptr;
+    for (auto* outlet : node->root_outputs())
+      if ((audio_out = outlet->template target<ossia::audio_port>()))
+        break;
+
+    if (audio_in)
+    {
+      audio_in->set_channels(inputs);
+      for (int c = 0; c < inputs; c++)
+        audio_in->channel(c).resize(frames);
+    }
+  }
+
+  int64_t latency() { return avnd::latency_samples(node->impl); }
+
+  void process(float** ins, float** outs, int frames)
+  {
+    if (audio_in)
+    {
+      for (int c = 0; c < inputs; c++)
+      {
+        auto& chan = audio_in->channel(c);
+        std::copy_n(ins[c], std::min(frames, int(chan.size())), chan.data());
+      }
+    }
+
+    ossia::token_request tk{};
+    tk.prev_date = ossia::time_value{time};
+    tk.date = ossia::time_value{time + frames};
+    node->run(tk, ossia::exec_state_facade{&state});
+    time += frames;
+
+    for (int c = 0; c < outputs; c++)
+    {
+      int n = 0;
+      if (audio_out && c < audio_out->channels())
+      {
+        const auto& chan = audio_out->channel(c);
+        n = std::min(frames, int(chan.size()));
+        std::copy_n(chan.data(), n, outs[c]);
+      }
+      std::fill(outs[c] + n, outs[c] + frames, 0.f);
+    }
+  }
+};
+#endif
+
+/**
+ * A stream which runs a path between the probe and the audio interface.
+ */
+template <typename Path>
+class benchmark_stream final : public audio_stream
+{
+public:
+  benchmark_stream(Path& path, const benchmark_options& opts)
+      : m_path{path}
+      , m_opts{opts}
+  {
+  }
+
+  ~benchmark_stream() { close(); }
+
+  std::optional<benchmark_result> run(int period)
+  {
+    audio_settings settings{
+        .rate = m_opts.rate,
+        .frames_per_buffer = period,
+        .input_device = m_opts.input_device,
+        .output_device = m_opts.output_device};
+
+    const int device_outputs = std::max(m_path.outputs, m_opts.output_channel + 1);
+    if (!open(settings, m_opts.input_channel + 1, device_outputs))
+      return std::nullopt;
+    std::this_thread::sleep_for(std::chrono::duration<double>(m_opts.duration));
+    close();
+
+    benchmark_result res;
+    res.path = Path::name;
+    res.period = frames_per_buffer();
+    res.rate = sample_rate();
+    res.driver_latency_ms = latency() * 1000.;
+    res.processor_latency = m_path.latency();
+    res.latency = compute_latency(m_probe);
+    res.jitter = compute_jitter(m_timer, 1000. * res.period / res.rate, m_opts.bin_ms);
+    return res;
+  }
+
+private:
+  void prepare(double rate, int frames) override
+  {
+    m_path.prepare(rate, frames);
+
+    // With a margin for the drivers which call more often with smaller buffers
+    const double seconds = m_opts.duration + 1.;
+    m_probe.reset(
+        rate, m_opts.probe_interval, m_opts.threshold,
+        int(seconds / m_opts.probe_interval) + 1);
+    m_timer.reset(int(4. * seconds * rate / frames) + 1);
+
+    m_signal.assign(frames, 0.f);
+    m_ins.assign(std::max(m_path.inputs, 1), m_signal.data());
+    m_buffers.assign(std::max(m_path.outputs, 1), std::vector<float>(frames, 0.f));
+    m_outs.clear();
+    for (auto& buf : m_buffers)
+      m_outs.push_back(buf.data());
+  }
+
+  void process(float** ins, float** outs, int frames) override
+  {
+    m_timer.begin();
+    m_probe.process(ins[m_opts.input_channel], m_signal.data(), frames);
+
+    // The impulse goes through the processor when it has audio inputs
+    m_path.process(m_ins.data(), m_outs.data(), frames);
+
+    const int device_outputs = std::max(m_path.outputs, m_opts.output_channel + 1);
+    for (int c = 0; c < device_outputs; c++)
+    {
+      // The loopback channel gets the first output if the processor has no such channel
+      const int src = c < m_path.outputs ? c : c == m_opts.output_channel ? 0 : -1;
+      if (src >= 0 && m_path.outputs > 0)
+        std::copy_n(m_outs[src], frames, outs[c]);
+      else
+        std::fill_n(outs[c], frames, 0.f);
+    }
+    if (m_path.inputs == 0 || m_path.outputs == 0)
+    {
+      float* out = outs[m_opts.output_channel];
+      for (int i = 0; i < frames; i++)
+        out[i] += m_signal[i];
+    }
+    m_timer.end();
+  }
+
+  Path& m_path;
+  const benchmark_options& m_opts;
+  latency_probe m_probe;
+  callback_timer m_timer;
+  std::vector<float> m_signal;
+  std::vector<float*> m_ins;
+  std::vector<std::vector<float>> m_buffers;
+  std::vector<float*> m_outs;
+};
+
+inline benchmark_machine benchmark_machine_info(const benchmark_options& opts)
+{
+  benchmark_machine res;
+  res.threads = std::thread::hardware_concurrency();
+
+  // PortAudio counts its initializations: this works whether a stream is open or not
+  if (Pa_Initialize() != paNoError)
+    return res;
+
+  const int in = opts.input_device >= 0 ? opts.input_device : Pa_GetDefaultInputDevice();
+  const int out = opts.output_device >= 0 ? opts.output_device : Pa_GetDefaultOutputDevice();
+  if (const PaDeviceInfo* info = in >= 0 ? Pa_GetDeviceInfo(in) : nullptr)
+  {
+    res.input_device = info->name;
+    if (const PaHostApiInfo* api = Pa_GetHostApiInfo(info->hostApi))
+      res.host_api = api->name;
+  }
+  if (const PaDeviceInfo* info = out >= 0 ? Pa_GetDeviceInfo(out) : nullptr)
+    res.output_device = info->name;
+
+  Pa_Terminate();
+  return res;
+}
+
+template <typename Path>
+void run_benchmark_path(const benchmark_options& opts, std::vector<benchmark_result>& res)
+{
+  for (int period : opts.periods)
+  {
+    // A fresh processor for each period, as when the host restarts the audio
+    auto path = std::make_unique<Path>();
+    benchmark_stream<Path> stream{*path, opts};
+    if (auto r = stream.run(period))
+    {
+      std::fprintf(
+          stderr, "%s, %d frames: %.2f ms round trip, %.3f ms max jitter\n", r->path.c_str(),
+          r->period, r->latency.mean_frames * 1000. / r->rate,
+          r->jitter.max_deviation_ms);
+      res.push_back(std::move(*r));
+    }
+    else
+    {
+      std::fprintf(stderr, "Cannot run %s at %d frames\n", Path::name.data(), period);
+    }
+  }
+}
+#endif
+
+/**
+ * Runs the benchmark if --benchmark is among the arguments, and returns -1 otherwise.
+ * T is the processor configured for the standalone binding, Raw the class
+ * from which the ossia one is configured.
+ */
+template <typename T, typename Raw = T>
+int benchmark_main(int argc, char** argv)
+{
+  auto opts = parse_benchmark_options(argc, argv);
+  if (!opts)
+  {
+    for (int i = 1; i < argc; i++)
+      if (std::string_view{argv[i]} == "--benchmark")
+        return 1;
+    return -1;
+  }
+
+#if AVND_STANDALONE_PORTAUDIO
+  std::vector<benchmark_result> res;
+  for (const auto& path : opts->paths)
+  {
+    if (path == "standalone")
+    {
+      run_benchmark_path<standalone_path<T>>(*opts, res);
+    }
+    else if (path == "ossia")
+    {
+#if AVND_STANDALONE_OSSIA_BENCHMARK
+      using node_type = typename decltype(avnd::configure<oscr::config, Raw>())::type;
+      run_benchmark_path<ossia_path<node_type>>(*opts, res);
+#else
+      std::fprintf(stderr, "The ossia path needs a build with libossia\n");
+#endif
+    }
+  }
+
+  std::FILE* f = stdout;
+  if (!opts->output.empty())
+  {
+    f = std::fopen(opts->output.c_str(), "w");
+    if (!f)
+    {
+      std::fprintf(stderr, "Cannot write the benchmark to %s\n", opts->output.c_str());
+      return 1;
+    }
+  }
+
+  write_json<T>(f, *opts, benchmark_machine_info(*opts), res);
+  if (f != stdout)
+    std::fclose(f);
+  return res.empty() ? 1 : 0;
+#else
+  std::fprintf(stderr, "The benchmark needs a build with PortAudio\n");
+  return 1;
+#endif
+}
+}
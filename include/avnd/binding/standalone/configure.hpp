@@ -8,7 +8,7 @@ namespace standalone
 {
 struct config
 {
-  using logger_type = halp::basic_logger;
+  using logger_type = halp::rt_logger;
 };
 
 }
@@ -0,0 +1,382 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/standalone/audio.hpp>
+#include <avnd/introspection/channels.hpp>
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/prepare.hpp>
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+#include <avnd/wrappers/thread_pool.hpp>
+
+#if AVND_STANDALONE_OSCQUERY
+#include <avnd/binding/standalone/oscquery_mapper.hpp>
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace standalone
+{
+/**
+ * One of the processors of an instance_graph.
+ */
+class hosted_instance
+{
+public:
+  explicit hosted_instance(std::string name)
+      : name{std::move(name)}
+  {
+  }
+  virtual ~hosted_instance() = default;
+
+  virtual int input_channels() const noexcept = 0;
+  virtual int output_channels() const noexcept = 0;
+  virtual void prepare(double rate, int frames) = 0;
+
+  // Frames by which the outputs lag behind the inputs, e.g. for a remote_proxy
+  virtual int latency() const noexcept { return 0; }
+
+  // Audio thread, also exchanges the controls with the network if any
+  virtual void process(float** ins, float** outs, int frames) = 0;
+
+  const std::string name;
+};
+
+template <typename T>
+class hosted_effect final : public hosted_instance
+{
+public:
+  explicit hosted_effect(std::string name)
+      : hosted_instance{std::move(name)}
+  {
+    if constexpr (avnd::has_inputs<T>)
+      avnd::init_controls(effect.inputs());
+  }
+
+  int input_channels() const noexcept override { return m_inputs; }
+  int output_channels() const noexcept override { return m_outputs; }
+
+  void prepare(double rate, int frames) override
+  {
+    avnd::process_setup setup_info{
+        .input_channels = m_inputs,
+        .output_channels = m_outputs,
+        .frames_per_buffer = frames,
+        .rate = rate};
+
+    m_processor.allocate_buffers(setup_info, float{});
+    effect.init_channels(m_inputs, m_outputs);
+    avnd::prepare(effect, setup_info);
+  }
+
+  void process(float** ins, float** outs, int frames) override
+  {
+#if AVND_STANDALONE_OSCQUERY
+    if (network)
+      network->apply_network_controls();
+#endif
+
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    m_processor.process(
+        effect, avnd::span<float*>{ins, std::size_t(m_inputs)},
+        avnd::span<float*>{outs, std::size_t(m_outputs)}, frames);
+
+#if AVND_STANDALONE_OSCQUERY
+    if (network)
+      network->publish_network_outputs();
+#endif
+  }
+
+  avnd::effect_container<T> effect;
+#if AVND_STANDALONE_OSCQUERY
+  std::unique_ptr<oscquery_mapper<T>> network;
+#endif
+
+private:
+  [[no_unique_address]] avnd::host_process_adapter<T> m_processor;
+  int m_inputs{avnd::input_channels<T>(2)};
+  int m_outputs{avnd::output_channels<T>(2)};
+};
+
+/**
+ * Many processors sharing one audio callback, e.g. to run a whole installation
+ * in a single process.
+ *
+ * connect() routes audio channels between the instances, and from / to the
+ * device with the instance index device. Within a buffer the instances run in
+ * the order of their connections; the ones of a same level of the graph, which
+ * do not depend on each other, are spread over the threads of a pool.
+ *
+ * With OSCQuery, the instances are published on a single server, each in
+ * the node with its name.
+ */
+class instance_graph
+{
+public:
+  static constexpr int device = -1;
+
+  // threads: the workers running the instances besides the audio thread
+  explicit instance_graph(int threads = int(std::thread::hardware_concurrency()) - 1)
+      : m_pool{threads}
+  {
+  }
+
+#if AVND_STANDALONE_OSCQUERY
+  // Creates the server the instances added after this are published on.
+  // A port of 0 picks a free one, see oscquery_device.
+  oscquery_device& enable_network(int osc_port = 0, int ws_port = 0)
+  {
+    if (!m_network)
+      m_network = std::make_unique<oscquery_device>(osc_port, ws_port);
+    return *m_network;
+  }
+
+  // The network thread
+  void run_network()
+  {
+    if (m_network)
+      m_network->run();
+  }
+  void stop_network()
+  {
+    if (m_network)
+      m_network->stop();
+  }
+#endif
+
+  // Before prepare(); returns the index of the instance
+  template <typename T>
+  int add(std::string name)
+  {
+    auto inst = std::make_unique<hosted_effect<T>>(std::move(name));
+#if AVND_STANDALONE_OSCQUERY
+    if (m_network)
+      inst->network = std::make_unique<oscquery_mapper<T>>(inst->effect, *m_network, inst->name);
+#endif
+    m_nodes.push_back({std::move(inst)});
+    return int(m_nodes.size()) - 1;
+  }
+
+  hosted_instance& instance(int index) noexcept { return *m_nodes[index].instance; }
+  int size() const noexcept { return int(m_nodes.size()); }
+
+  // Before prepare(). Returns false if the connection is invalid or makes a cycle.
+  bool connect(int from, int from_channel, int to, int to_channel)
+  {
+    auto valid = [this](int node, int channel, bool output) {
+      if (node == device)
+        return channel >= 0;
+      if (node < 0 || node >= size() || channel < 0)
+        return false;
+      auto& inst = *m_nodes[node].instance;
+      return channel < (output ? inst.output_channels() : inst.input_channels());
+    };
+    if (!valid(from, from_channel, true) || !valid(to, to_channel, false)
+        || (from == to && from != device))
+      return false;
+
+    m_connections.push_back({from, from_channel, to, to_channel});
+    if (!schedule())
+    {
+      m_connections.pop_back();
+      schedule();
+      return false;
+    }
+    return true;
+  }
+
+  // Channels of the device used by the connections
+  int device_inputs() const noexcept { return device_channels(true); }
+  int device_outputs() const noexcept { return device_channels(false); }
+
+  void prepare(double rate, int frames)
+  {
+    schedule();
+    m_frames = frames;
+    for (auto& node : m_nodes)
+    {
+      auto& inst = *node.instance;
+      inst.prepare(rate, frames);
+
+      node.in_storage.assign(std::size_t(inst.input_channels()) * frames, 0.f);
+      node.out_storage.assign(std::size_t(inst.output_channels()) * frames, 0.f);
+      node.ins.resize(inst.input_channels());
+      node.outs.resize(inst.output_channels());
+      for (int c = 0; c < inst.input_channels(); c++)
+        node.ins[c] = node.in_storage.data() + c * frames;
+      for (int c = 0; c < inst.output_channels(); c++)
+        node.outs[c] = node.out_storage.data() + c * frames;
+    }
+  }
+
+  // Audio thread
+  void process(float* const* device_ins, float** device_outs, int frames)
+  {
+    frames = std::min(frames, m_frames);
+    for (const auto& level : m_levels)
+    {
+      m_pool.run(int(level.size()), [&](int task) {
+        run_node(level[task], device_ins, frames);
+      });
+    }
+
+    for (int c = 0, n = device_outputs(); c < n; c++)
+      std::fill_n(device_outs[c], frames, 0.f);
+    for (const auto& cable : m_connections)
+      if (cable.to == device)
+        mix(source(cable, device_ins), device_outs[cable.to_channel], frames);
+  }
+
+private:
+  struct connection
+  {
+    int from{};
+    int from_channel{};
+    int to{};
+    int to_channel{};
+  };
+
+  struct node
+  {
+    std::unique_ptr<hosted_instance> instance;
+    std::vector<int> inputs; // index of the connections going to this node
+    std::vector<float> in_storage;
+    std::vector<float> out_storage;
+    std::vector<float*> ins;
+    std::vector<float*> outs;
+  };
+
+  int device_channels(bool input) const noexcept
+  {
+    int n = 0;
+    for (const auto& cable : m_connections)
+    {
+      if (input && cable.from == device)
+        n = std::max(n, cable.from_channel + 1);
+      else if (!input && cable.to == device)
+        n = std::max(n, cable.to_channel + 1);
+    }
+    return n;
+  }
+
+  // Groups the instances by the longest path which leads to them
+  bool schedule()
+  {
+    const int n = size();
+    std::vector<int> pending(n, 0);
+    std::vector<int> level(n, 0);
+    for (auto& node : m_nodes)
+      node.inputs.clear();
+    for (int i = 0; i < int(m_connections.size()); i++)
+    {
+      const auto& cable = m_connections[i];
+      if (cable.to == device)
+        continue;
+      m_nodes[cable.to].inputs.push_back(i);
+      if (cable.from != device)
+        pending[cable.to]++;
+    }
+
+    std::vector<int> ready;
+    for (int i = 0; i < n; i++)
+      if (pending[i] == 0)
+        ready.push_back(i);
+
+    int visited = 0;
+    m_levels.clear();
+    while (!ready.empty())
+    {
+      const int i = ready.back();
+      ready.pop_back();
+      visited++;
+
+      if (int(m_levels.size()) <= level[i])
+        m_levels.resize(level[i] + 1);
+      m_levels[level[i]].push_back(i);
+
+      for (const auto& cable : m_connections)
+      {
+        if (cable.from != i || cable.to == device)
+          continue;
+        level[cable.to] = std::max(level[cable.to], level[i] + 1);
+        if (--pending[cable.to] == 0)
+          ready.push_back(cable.to);
+      }
+    }
+    return visited == n;
+  }
+
+  const float* source(const connection& cable, float* const* device_ins) const noexcept
+  {
+    return cable.from == device ? device_ins[cable.from_channel]
+                                : m_nodes[cable.from].outs[cable.from_channel];
+  }
+
+  static void mix(const float* in, float* out, int frames) noexcept
+  {
+    for (int i = 0; i < frames; i++)
+      out[i] += in[i];
+  }
+
+  void run_node(int index, float* const* device_ins, int frames)
+  {
+    auto& node = m_nodes[index];
+    for (float* chan : node.ins)
+      std::fill_n(chan, frames, 0.f);
+    for (int cable : node.inputs)
+    {
+      const auto& c = m_connections[cable];
+      mix(source(c, device_ins), node.ins[c.to_channel], frames);
+    }
+
+    node.instance->process(node.ins.data(), node.outs.data(), frames);
+  }
+
+#if AVND_STANDALONE_OSCQUERY
+  // Outlives the instances which are published on it
+  std::unique_ptr<oscquery_device> m_network;
+#endif
+  std::vector<node> m_nodes;
+  std::vector<connection> m_connections;
+  std::vector<std::vector<int>> m_levels;
+  avnd::thread_pool m_pool;
+  int m_frames{};
+};
+
+#if AVND_STANDALONE_PORTAUDIO
+/**
+ * Runs an instance_graph on the audio interface
+ */
+class multi_host final : public audio_stream
+{
+public:
+  explicit multi_host(instance_graph& graph)
+      : m_graph{graph}
+  {
+  }
+
+  ~multi_host() { close(); }
+
+  bool start(const audio_settings& settings = {})
+  {
+    return open(settings, m_graph.device_inputs(), m_graph.device_outputs());
+  }
+
+private:
+  void prepare(double rate, int frames) override { m_graph.prepare(rate, frames); }
+  void process(float** ins, float** outs, int frames) override
+  {
+    m_graph.process(ins, outs, frames);
+  }
+
+  instance_graph& m_graph;
+};
+#endif
+}
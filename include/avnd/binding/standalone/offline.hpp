@@ -0,0 +1,353 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/introspection/channels.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/prepare.hpp>
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+#include <avnd/wrappers/soundfile_stream.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace standalone
+{
+/**
+ * A file to render:
+ *  - the channels of the inputs are put side by side, the shortest ones padded with silence.
+ *  - without inputs, "duration" seconds are rendered at "rate".
+ *  - automation is a text file with one change per line: "<seconds> <control name> <value>".
+ */
+struct offline_job
+{
+  std::vector<std::string> inputs;
+  std::string output;
+  std::string automation;
+  double rate{48000.};
+  double duration{};
+};
+
+struct automation_point
+{
+  int64_t frame{};
+  std::string control;
+  double value{};
+};
+
+inline std::vector<automation_point> load_automation(const std::string& path, double rate)
+{
+  std::vector<automation_point> points;
+  std::ifstream file{path};
+  std::string line;
+  while (std::getline(file, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream ss{line};
+    double t{};
+    automation_point p;
+    if (ss >> t >> p.control >> p.value)
+    {
+      p.frame = int64_t(t * rate);
+      points.push_back(std::move(p));
+    }
+  }
+
+  std::stable_sort(points.begin(), points.end(), [](const auto& a, const auto& b) {
+    return a.frame < b.frame;
+  });
+  return points;
+}
+
+// Writes 32-bit float WAVE files
+inline bool write_wav(
+    const std::string& path, int channels, int64_t frames, double rate,
+    const std::vector<std::vector<float>>& data)
+{
+  std::FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f)
+    return false;
+
+  auto u32 = [f](uint32_t v) {
+    const unsigned char b[4]{
+        (unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16),
+        (unsigned char)(v >> 24)};
+    std::fwrite(b, 1, 4, f);
+  };
+  auto u16 = [f](uint16_t v) {
+    const unsigned char b[2]{(unsigned char)v, (unsigned char)(v >> 8)};
+    std::fwrite(b, 1, 2, f);
+  };
+
+  const uint32_t bytes = uint32_t(frames * channels * 4);
+  std::fwrite("RIFF", 1, 4, f);
+  u32(36 + bytes);
+  std::fwrite("WAVEfmt ", 1, 8, f);
+  u32(16);
+  u16(3); // IEEE float
+  u16(uint16_t(channels));
+  u32(uint32_t(rate));
+  u32(uint32_t(rate) * channels * 4);
+  u16(uint16_t(channels * 4));
+  u16(32);
+  std::fwrite("data", 1, 4, f);
+  u32(bytes);
+
+  // Interleaved by chunks, so that a long file is not copied whole
+  std::vector<float> chunk;
+  constexpr int64_t chunk_frames = 16384;
+  for (int64_t start = 0; start < frames; start += chunk_frames)
+  {
+    const int64_t n = std::min(chunk_frames, frames - start);
+    chunk.resize(n * channels);
+    for (int64_t i = 0; i < n; i++)
+      for (int c = 0; c < channels; c++)
+        chunk[i * channels + c] = data[c][start + i];
+    std::fwrite(chunk.data(), sizeof(float), chunk.size(), f);
+  }
+
+  return std::fclose(f) == 0;
+}
+
+/**
+ * Renders files through a processor as fast as possible: there is no device
+ * to keep up with, thus it runs with large buffers, and the jobs of a batch are
+ * spread on all the cores.
+ */
+template <typename T>
+class offline_renderer
+{
+public:
+  int frames_per_buffer{4096};
+
+  bool render(const offline_job& job) const
+  {
+    // Read the inputs
+    std::vector<std::vector<float>> in;
+    double rate = job.rate;
+    int64_t frames = int64_t(job.duration * job.rate);
+    for (const auto& path : job.inputs)
+    {
+      auto src = avnd::wav_soundfile_source::open_wav(path);
+      if (!src)
+      {
+        std::fprintf(stderr, "Cannot read %s\n", path.c_str());
+        return false;
+      }
+      if (&path == &job.inputs.front())
+      {
+        rate = src->sample_rate();
+        frames = 0;
+      }
+
+      const int64_t n = src->frames();
+      const std::size_t first = in.size();
+      in.resize(first + src->channels());
+      std::vector<float*> ptrs;
+      for (std::size_t c = first; c < in.size(); c++)
+      {
+        in[c].resize(n);
+        ptrs.push_back(in[c].data());
+      }
+      src->read(0, n, ptrs.data());
+      frames = std::max(frames, n);
+    }
+    for (auto& chan : in)
+      chan.resize(frames, 0.f);
+
+    const int inputs = avnd::input_channels<T>(int(in.size()));
+    const int outputs = avnd::output_channels<T>(inputs);
+    in.resize(std::max(inputs, 0), std::vector<float>(frames, 0.f));
+    std::vector<std::vector<float>> out(std::max(outputs, 0), std::vector<float>(frames));
+
+    // Set-up the processor
+    avnd::effect_container<T> effect;
+    avnd::host_process_adapter<T> processor;
+    const avnd::process_setup setup_info{
+        .input_channels = inputs,
+        .output_channels = outputs,
+        .frames_per_buffer = frames_per_buffer,
+        .rate = rate,
+        .mode = avnd::render_mode::offline};
+
+    if constexpr (avnd::has_inputs<T>)
+      avnd::init_controls(effect.inputs());
+    processor.allocate_buffers(setup_info, float{});
+    effect.init_channels(inputs, outputs);
+    avnd::prepare(effect, setup_info);
+
+    std::vector<automation_point> automation;
+    if (!job.automation.empty())
+      automation = load_automation(job.automation, rate);
+    auto next_point = automation.begin();
+
+    // Process: the buffers are cut at the automation points
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    std::vector<float*> ins(in.size()), outs(out.size());
+    int64_t pos = 0;
+    while (pos < frames)
+    {
+      for (; next_point != automation.end() && next_point->frame <= pos; ++next_point)
+        set_control(effect, next_point->control, next_point->value);
+
+      int64_t n = std::min<int64_t>(frames_per_buffer, frames - pos);
+      if (next_point != automation.end())
+        n = std::min(n, next_point->frame - pos);
+
+      for (std::size_t c = 0; c < in.size(); c++)
+        ins[c] = in[c].data() + pos;
+      for (std::size_t c = 0; c < out.size(); c++)
+        outs[c] = out[c].data() + pos;
+
+      processor.process(
+          effect, avnd::span<float*>{ins.data(), ins.size()},
+          avnd::span<float*>{outs.data(), outs.size()}, int(n));
+      pos += n;
+    }
+
+    if (!write_wav(job.output, int(out.size()), frames, rate, out))
+    {
+      std::fprintf(stderr, "Cannot write %s\n", job.output.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // Returns the number of jobs which failed
+  int render(const std::vector<offline_job>& jobs, int threads = 0) const
+  {
+    if (threads <= 0)
+      threads = std::max(1, int(std::thread::hardware_concurrency()));
+    threads = std::min<int>(threads, jobs.size());
+
+    std::atomic_int next{0};
+    std::atomic_int failures{0};
+    auto work = [&] {
+      for (int i = next++; i < int(jobs.size()); i = next++)
+        if (!render(jobs[i]))
+          failures++;
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++)
+      workers.emplace_back(work);
+    work();
+    for (auto& t : workers)
+      t.join();
+    return failures;
+  }
+
+private:
+  static void set_control(avnd::effect_container<T>& effect, std::string_view name, double v)
+  {
+    if constexpr (avnd::control_input_introspection<T>::size > 0)
+    {
+      avnd::control_input_introspection<T>::for_all(
+          avnd::get_inputs<T>(effect), [&]<typename Field>(Field& field) {
+            if constexpr (requires { Field::name(); })
+            {
+              if (Field::name() != name)
+                return;
+
+              using value_type = std::decay_t<decltype(field.value)>;
+              if constexpr (std::is_enum_v<value_type>)
+                field.value = static_cast<value_type>(int(v));
+              else if constexpr (std::is_arithmetic_v<value_type>)
+                field.value = static_cast<value_type>(v);
+            }
+          });
+    }
+  }
+};
+
+/**
+ * Command-line front-end:
+ *   --render <in.wav>[,<in2.wav>...] <out.wav> [--automation <file>]
+ *   --batch <jobs> [--threads <n>]: one job per line, "<in.wav>[,...] <out.wav> [<automation>]"
+ *   --duration <seconds>, --rate <hz>: for processors without inputs ("-" as input)
+ *   --buffer <frames>
+ * Returns -1 if the arguments do not ask for offline rendering.
+ */
+template <typename T>
+int offline_main(int argc, char** argv)
+{
+  std::vector<std::string_view> args(argv + 1, argv + argc);
+  auto option = [&](std::string_view name) -> std::string_view {
+    auto it = std::find(args.begin(), args.end(), name);
+    return (it != args.end() && it + 1 != args.end()) ? *(it + 1) : std::string_view{};
+  };
+  auto number = [&](std::string_view name, double init) {
+    auto str = option(name);
+    double v = init;
+    if (!str.empty())
+      std::from_chars(str.data(), str.data() + str.size(), v);
+    return v;
+  };
+  auto split_inputs = [](std::string_view list) {
+    std::vector<std::string> res;
+    if (list == "-")
+      return res;
+    for (std::size_t start = 0; start <= list.size();)
+    {
+      const auto end = std::min(list.find(',', start), list.size());
+      if (end > start)
+        res.emplace_back(list.substr(start, end - start));
+      start = end + 1;
+    }
+    return res;
+  };
+
+  offline_renderer<T> renderer;
+  renderer.frames_per_buffer = std::max(1, int(number("--buffer", 4096)));
+  const double rate = number("--rate", 48000.);
+  const double duration = number("--duration", 0.);
+
+  std::vector<offline_job> jobs;
+  if (auto it = std::find(args.begin(), args.end(), "--render");
+      it != args.end() && std::distance(it, args.end()) > 2)
+  {
+    jobs.push_back(
+        {split_inputs(*(it + 1)), std::string(*(it + 2)), std::string(option("--automation")),
+         rate, duration});
+  }
+  else if (auto list = option("--batch"); !list.empty())
+  {
+    std::ifstream file{std::string(list)};
+    std::string line;
+    while (std::getline(file, line))
+    {
+      std::istringstream ss{line};
+      std::string ins, out, automation;
+      if (ss >> ins >> out)
+      {
+        ss >> automation;
+        jobs.push_back({split_inputs(ins), out, automation, rate, duration});
+      }
+    }
+  }
+  else
+  {
+    return -1;
+  }
+
+  return renderer.render(jobs, int(number("--threads", 0))) == 0 ? 0 : 1;
+}
+}
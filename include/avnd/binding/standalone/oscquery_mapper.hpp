@@ -6,6 +6,7 @@
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/messages.hpp>
 #include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/controls_mirror.hpp>
 #include <avnd/wrappers/effect_container.hpp>
 #include <avnd/wrappers/widgets.hpp>
 #include <ossia/audio/audio_engine.hpp>
@@ -20,6 +21,15 @@
 #include <ossia/protocols/midi/midi.hpp>
 #include <ossia/protocols/oscquery/oscquery_server_asio.hpp>
 
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/udp.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <vector>
+
 namespace standalone
 {
 template <typename T>
@@ -28,25 +38,112 @@ struct tag
   using type = T;
 };
 
+// A port the OS considers free, for the servers asked to use port 0
+inline int free_port(ossia::net::network_context& ctx, bool udp)
+{
+  namespace ip = boost::asio::ip;
+  boost::system::error_code ec;
+  if (udp)
+  {
+    ip::udp::socket sock{ctx.context};
+    sock.open(ip::udp::v4(), ec);
+    if (!ec)
+      sock.bind({ip::udp::v4(), 0}, ec);
+    return ec ? 0 : sock.local_endpoint(ec).port();
+  }
+  else
+  {
+    ip::tcp::acceptor sock{ctx.context};
+    sock.open(ip::tcp::v4(), ec);
+    if (!ec)
+      sock.bind({ip::tcp::v4(), 0}, ec);
+    return ec ? 0 : sock.local_endpoint(ec).port();
+  }
+}
+
+/**
+ * An OSCQuery server. It can be shared by several processors, each of which
+ * then gets its own sub-tree, see oscquery_mapper.
+ */
+struct oscquery_device
+{
+  std::shared_ptr<ossia::net::network_context> context;
+  int osc_port{};
+  int ws_port{};
+  ossia::net::generic_device device;
+
+  // A port of 0 picks a free one
+  explicit oscquery_device(
+      int osc = 1234, int ws = 5678, const std::string& name = "my_device")
+      : context{std::make_shared<ossia::net::network_context>()}
+      , osc_port{osc > 0 ? osc : free_port(*context, true)}
+      , ws_port{ws > 0 ? ws : free_port(*context, false)}
+      , device{
+            std::make_unique<ossia::oscquery_asio::oscquery_server_protocol>(
+                context, osc_port, ws_port),
+            name}
+  {
+  }
+
+  void run() { context->run(); }
+  void stop() { context->context.stop(); }
+};
+
 template <typename T>
 struct oscquery_mapper
 {
+  using controls = avnd::control_input_introspection<T>;
+  using controls_tuple = typename avnd::controls_mirror<T>::i_tuple;
+  using outputs = avnd::control_output_introspection<T>;
+  using outputs_tuple = typename avnd::controls_mirror<T>::o_tuple;
+
   avnd::effect_container<T>& object;
 
-  std::shared_ptr<ossia::net::network_context> m_context;
-  ossia::net::generic_device m_dev;
+  // The values received by the network thread, applied by the audio thread
+  // at the beginning of each buffer, see apply_network_controls
+  avnd::controls_requests<controls_tuple, controls::size> m_from_network;
+
+  // The output values which changed, sent by the audio thread after each buffer
+  // and flushed by the network thread at the output rate, see publish_network_outputs
+  avnd::controls_feedback<outputs_tuple, outputs::size> m_to_network;
+  outputs_tuple m_last_outputs{};
+  std::array<ossia::net::parameter_base*, outputs::size> m_output_params{};
+  std::vector<const ossia::net::parameter_base*> m_bundle;
+
+  std::unique_ptr<oscquery_device> m_owned_device;
+  oscquery_device& m_device;
+  ossia::net::node_base& m_root;
+  ossia::timer m_output_timer;
 
+  // With a server of its own
   oscquery_mapper(avnd::effect_container<T>& object)
+      : oscquery_mapper{object, std::make_unique<oscquery_device>()}
+  {
+  }
+
+  // In the "prefix" node of a server shared with other processors
+  oscquery_mapper(
+      avnd::effect_container<T>& object, oscquery_device& device, std::string_view prefix)
       : object{object}
-      , m_context{std::make_shared<ossia::net::network_context>()}
-      , m_dev{
-            std::make_unique<ossia::oscquery_asio::oscquery_server_protocol>(
-                m_context,
-                1234,
-                5678),
-            "my_device"}
+      , m_device{device}
+      , m_root{ossia::net::find_or_create_node(device.device.get_root_node(), prefix)}
+      , m_output_timer{device.context->context}
+  {
+    create_ports();
+    set_output_rate(30.);
+  }
+
+private:
+  oscquery_mapper(
+      avnd::effect_container<T>& object, std::unique_ptr<oscquery_device> device)
+      : object{object}
+      , m_owned_device{std::move(device)}
+      , m_device{*m_owned_device}
+      , m_root{m_device.device.get_root_node()}
+      , m_output_timer{m_device.context->context}
   {
     create_ports();
+    set_output_rate(30.);
     /*
     // Create a few float parameters
     std::vector<ossia::net::parameter_base*> my_params;
@@ -72,10 +169,37 @@ struct oscquery_mapper
     */
   }
 
-  template <avnd::parameter Field>
+public:
+
+  // Network thread
+  template <std::size_t I, typename V>
+  void send_to_audio(V&& value)
+  {
+    m_from_network.template set<I>(std::forward<V>(value));
+    m_from_network.send();
+  }
+
+  // Audio thread
+  void apply_network_controls()
+  {
+    if constexpr (controls::size > 0)
+    {
+      m_from_network.consume([this](const auto& values, const auto& changed) {
+        auto& ins = avnd::get_inputs<T>(object);
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+          ((changed.test(I) ? (void)(controls::template get<I>(ins).value = std::get<I>(values))
+                            : (void)0),
+           ...);
+        }(std::make_index_sequence<controls::size>{});
+      });
+    }
+  }
+
+  template <avnd::parameter Field, std::size_t I>
   requires(!avnd::enum_parameter<Field>) void setup_control(
       Field& field,
-      ossia::net::parameter_base& param)
+      ossia::net::parameter_base& param,
+      avnd::predicate_index<I>)
   {
     param.set_value_type(type_for_arg<decltype(Field::value)>());
 
@@ -89,13 +213,19 @@ struct oscquery_mapper
 
     param.set_access(ossia::access_mode::BI);
 
-    // Set-up the external callback
-    param.add_callback([&field](const ossia::value& val)
-                       { field.value = convert(val, tag<decltype(field.value)>{}); });
+    // Set-up the external callback.
+    // It runs on the network thread: the value is not written to the object directly.
+    param.add_callback([this](const ossia::value& val) {
+      using value_type = std::decay_t<decltype(Field::value)>;
+      send_to_audio<I>(value_type(convert(val, tag<value_type>{})));
+    });
   }
 
-  template <avnd::enum_parameter Field>
-  void setup_control(Field& field, ossia::net::parameter_base& param)
+  template <avnd::enum_parameter Field, std::size_t I>
+  void setup_control(
+      Field& field,
+      ossia::net::parameter_base& param,
+      avnd::predicate_index<I>)
   {
     param.set_value_type(ossia::val_type::STRING);
 
@@ -110,13 +240,14 @@ struct oscquery_mapper
     // Set-up the external callback
 
     param.add_callback(
-        [&field](const ossia::value& val)
+        [this](const ossia::value& val)
         {
+          using value_type = std::decay_t<decltype(Field::value)>;
           if (const int* iindex = val.target<int>())
           {
             if (*iindex >= 0 && *iindex < choices_count)
             {
-              field.value = static_cast<decltype(field.value)>(*iindex);
+              send_to_audio<I>(static_cast<value_type>(*iindex));
             }
           }
           else if (const float* findex = val.target<float>())
@@ -124,7 +255,7 @@ struct oscquery_mapper
             int index = *findex;
             if (index >= 0 && index < choices_count)
             {
-              field.value = static_cast<decltype(field.value)>(index);
+              send_to_audio<I>(static_cast<value_type>(index));
             }
           }
           else if (const std::string* txt = val.target<std::string>())
@@ -133,16 +264,16 @@ struct oscquery_mapper
             if (it != choices.end())
             {
               int index = std::distance(choices.begin(), it);
-              field.value = static_cast<decltype(field.value)>(index);
+              send_to_audio<I>(static_cast<value_type>(index));
             }
           }
         });
   }
 
-  template <avnd::parameter Field>
-  void create_control(Field& field)
+  template <avnd::parameter Field, std::size_t I>
+  void create_control(Field& field, avnd::predicate_index<I> idx)
   {
-    ossia::net::node_base& node = m_dev.get_root_node();
+    ossia::net::node_base& node = m_root;
     std::string name = "input";
     if constexpr (requires { Field::name(); })
       name = Field::name();
@@ -150,7 +281,7 @@ struct oscquery_mapper
     if (auto param
         = ossia::net::create_parameter<ossia::net::generic_parameter>(node, name))
     {
-      setup_control(field, *param);
+      setup_control(field, *param, idx);
     }
   }
 
@@ -472,7 +603,7 @@ struct oscquery_mapper
   {
     if constexpr (requires { avnd::function_reflection<Field::func()>::count; })
     {
-      ossia::net::node_base& node = m_dev.get_root_node();
+      ossia::net::node_base& node = m_root;
       std::string name{Field::name()};
       if (auto param = ossia::net::create_parameter<ossia::net::generic_parameter>(
               node, name)) // TODO
@@ -502,10 +633,10 @@ struct oscquery_mapper
     }
   }
 
-  template <avnd::parameter Field>
-  void create_output(Field& field)
+  template <avnd::parameter Field, std::size_t I>
+  void create_output(Field& field, avnd::predicate_index<I>)
   {
-    ossia::net::node_base& node = m_dev.get_root_node();
+    ossia::net::node_base& node = m_root;
     std::string name = "output";
     if constexpr (requires { Field::name(); })
       name = Field::name();
@@ -521,36 +652,40 @@ struct oscquery_mapper
       }
 
       param->set_access(ossia::access_mode::GET);
+      m_output_params[I] = param;
     }
   }
 
-  template <typename Field>
-  void create_control(Field& field)
+  template <typename Field, std::size_t I>
+  void create_control(Field& field, avnd::predicate_index<I>)
   {
   }
 
-  template <typename Field>
-  void create_output(Field& field)
+  template <typename Field, std::size_t I>
+  void create_output(Field& field, avnd::predicate_index<I>)
   {
   }
 
   void create_ports()
   {
-    /*
-    if constexpr (avnd::float_parameter_input_introspection<T>::size > 0)
+    if constexpr (controls::size > 0)
     {
-      boost::pfr::for_each_field(
-          object.inputs(),
-          [this]<typename Field>(Field& f) { create_control(f); });
+      controls::for_all_n(
+          avnd::get_inputs<T>(object),
+          [this]<typename Field, std::size_t I>(Field& f, avnd::predicate_index<I> idx) {
+            create_control(f, idx);
+          });
     }
 
-    if constexpr (avnd::float_parameter_output_introspection<T>::size > 0)
+    if constexpr (outputs::size > 0)
     {
-      boost::pfr::for_each_field(
-          object.outputs(),
-          [this]<typename Field>(Field& f) { create_output(f); });
+      outputs::for_all_n(
+          avnd::get_outputs<T>(object),
+          [this]<typename Field, std::size_t I>(Field& f, avnd::predicate_index<I> idx) {
+            create_output(f, idx);
+          });
     }
-*/
+
     if constexpr (avnd::has_messages<T>)
     {
       boost::pfr::for_each_field(
@@ -571,7 +706,90 @@ struct oscquery_mapper
     */
   }
 
-  void run() { m_context->run(); }
-  void stop() { m_context->context.stop(); }
+  // Audio thread, after each buffer: sends the outputs which changed.
+  // If the network thread did not flush the previous ones yet they are merged,
+  // thus a meter updated at each buffer is only sent at the output rate.
+  void publish_network_outputs()
+  {
+    if constexpr (outputs::size > 0)
+    {
+      auto& outs = avnd::get_outputs<T>(object);
+      std::bitset<outputs::size> changed;
+      [&]<std::size_t... I>(std::index_sequence<I...>) {
+        (
+            [&] {
+              auto& v = outputs::template get<I>(outs).value;
+              if (v != std::get<I>(m_last_outputs))
+              {
+                std::get<I>(m_last_outputs) = v;
+                changed.set(I);
+              }
+            }(),
+            ...);
+      }(std::make_index_sequence<outputs::size>{});
+
+      if (changed.any())
+        m_to_network.publish(changed, [this]<std::size_t I>(avnd::predicate_index<I>) -> auto& {
+          return std::get<I>(m_last_outputs);
+        });
+    }
+  }
+
+  // Network thread, or before run(): how often the changed outputs are sent
+  void set_output_rate(double hz)
+  {
+    m_output_timer.stop();
+    if constexpr (outputs::size > 0)
+    {
+      if (hz <= 0.)
+        return;
+      m_output_timer.set_delay(std::chrono::milliseconds(std::max(1, int(1000. / hz))));
+      m_output_timer.start([this] { flush_outputs(); });
+    }
+  }
+
+  template <typename V>
+  static ossia::value to_ossia(const V& v)
+  {
+    if constexpr (std::is_enum_v<V>)
+      return static_cast<int>(v);
+    else
+      return v;
+  }
+
+  // Network thread: all the outputs which changed since the last flush
+  // go in a single bundle when the protocol supports it
+  void flush_outputs()
+  {
+    m_to_network.consume([this](const auto& values, const auto& changed) {
+      m_bundle.clear();
+      [&]<std::size_t... I>(std::index_sequence<I...>) {
+        (
+            [&] {
+              if (changed.test(I) && m_output_params[I])
+              {
+                m_output_params[I]->set_value(to_ossia(std::get<I>(values)));
+                m_bundle.push_back(m_output_params[I]);
+              }
+            }(),
+            ...);
+      }(std::make_index_sequence<outputs::size>{});
+
+      if (m_bundle.empty())
+        return;
+      if (!m_device.device.get_protocol().push_bundle(m_bundle))
+        for (auto* param : m_bundle)
+          const_cast<ossia::net::parameter_base*>(param)->push_value();
+    });
+  }
+
+  // Only for a server of its own
+  void run() { m_device.run(); }
+  void stop()
+  {
+    m_output_timer.stop();
+    if (m_owned_device)
+      m_owned_device->stop();
+  }
 };
 }
@@ -0,0 +1,698 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/standalone/multi.hpp>
+#include <avnd/introspection/input.hpp>
+
+#if __has_include(<sys/socket.h>) && __has_include(<netinet/in.h>)
+#define AVND_STANDALONE_UDP 1
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+
+/**
+ * Running a processor on another machine, e.g. to spread the heavy ones of an
+ * installation: a remote_proxy<T> takes its place in the local instance_graph,
+ * and a remote_host<T> runs the actual processor on the other node.
+ *
+ * The proxy sends each block of its inputs, with the controls which changed,
+ * and plays the outputs the remote host sent back latency_frames later: that is
+ * the budget for the round trip, the processing and the jitter of the network,
+ * which the proxy reports as its latency. The outputs which did not arrive in time
+ * are silent, and counted in remote_stats.
+ *
+ * The packets go through a remote_transport: UDP between machines, or rings in
+ * shared memory between processes of a same machine. The samples are planar
+ * floats in the byte order of the nodes, which are assumed to have the same one.
+ */
+namespace standalone
+{
+/**
+ * Sends and receives whole packets, without blocking: the proxy uses it on the audio thread.
+ */
+class remote_transport
+{
+public:
+  virtual ~remote_transport() = default;
+
+  // Returns false when the packet could not be sent, e.g. the queue is full
+  virtual bool send(const std::byte* data, std::size_t size) noexcept = 0;
+
+  // Returns the size of the next packet, 0 when there is none.
+  // Packets larger than capacity are discarded.
+  virtual std::size_t receive(std::byte* data, std::size_t capacity) noexcept = 0;
+};
+
+// Below the payload of an UDP datagram; the proxy splits larger blocks
+static constexpr std::size_t remote_max_packet = 65000;
+
+struct remote_header
+{
+  static constexpr uint32_t magic_value = 0x444e5641; // "AVND"
+
+  uint32_t magic{magic_value};
+  uint32_t frames{};
+  uint64_t position{}; // of the first frame, since the proxy started
+  uint16_t channels{};
+  uint16_t controls{}; // remote_control which follow the header
+  uint32_t reserved{};
+};
+
+// Value of the index-th parameter input, in [0; 1]
+struct remote_control
+{
+  uint32_t index{};
+  float value{};
+};
+
+static_assert(sizeof(remote_header) == 24 && sizeof(remote_control) == 8);
+
+// Counters, which can be read from any thread
+struct remote_stats
+{
+  std::atomic<uint64_t> sent_packets{};
+  std::atomic<uint64_t> send_failures{};
+  std::atomic<uint64_t> received_packets{};
+  std::atomic<uint64_t> invalid_packets{};
+
+  // Proxy: packets which arrived after their outputs were due
+  std::atomic<uint64_t> late_packets{};
+  // Proxy: frames played silent as their outputs did not arrive in time
+  std::atomic<uint64_t> dropped_frames{};
+
+  static void add(std::atomic<uint64_t>& counter, uint64_t n = 1) noexcept
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+};
+
+namespace detail
+{
+// The parts of a received packet, which stay in its buffer
+struct remote_packet_view
+{
+  remote_header header;
+  const std::byte* controls{};
+  const std::byte* samples{};
+
+  bool parse(const std::byte* data, std::size_t size) noexcept
+  {
+    if (size < sizeof(remote_header))
+      return false;
+    std::memcpy(&header, data, sizeof(remote_header));
+    controls = data + sizeof(remote_header);
+    samples = controls + header.controls * sizeof(remote_control);
+    return header.magic == remote_header::magic_value
+           && std::size_t(samples - data)
+                      + std::size_t(header.channels) * header.frames * sizeof(float)
+                  == size;
+  }
+
+  remote_control control(int i) const noexcept
+  {
+    remote_control c;
+    std::memcpy(&c, controls + i * sizeof(remote_control), sizeof(c));
+    return c;
+  }
+
+  // Samples may not be aligned in the packet
+  void read_channel(int c, int offset, float* out, int frames) const noexcept
+  {
+    std::memcpy(
+        out, samples + (std::size_t(c) * header.frames + offset) * sizeof(float),
+        frames * sizeof(float));
+  }
+};
+
+// Writes a packet in a buffer of remote_max_packet bytes
+struct remote_packet_writer
+{
+  std::byte* data{};
+  std::size_t size{};
+
+  void begin(const remote_header& header) noexcept
+  {
+    std::memcpy(data, &header, sizeof(header));
+    size = sizeof(header);
+  }
+  void control(remote_control c) noexcept
+  {
+    std::memcpy(data + size, &c, sizeof(c));
+    size += sizeof(c);
+  }
+  void channel(const float* samples, int frames) noexcept
+  {
+    std::memcpy(data + size, samples, frames * sizeof(float));
+    size += frames * sizeof(float);
+  }
+  void set_controls(uint16_t count) noexcept
+  {
+    std::memcpy(data + offsetof(remote_header, controls), &count, sizeof(count));
+  }
+};
+}
+
+// Sets the index-th parameter input; string controls are not sent
+template <typename T>
+void apply_remote_control(avnd::effect_container<T>& effect, remote_control ctl) noexcept
+{
+  using param_in_info = avnd::parameter_input_introspection<T>;
+  if constexpr (param_in_info::size > 0)
+  {
+    if (ctl.index >= param_in_info::size || !std::isfinite(ctl.value))
+      return;
+    param_in_info::for_nth_mapped(
+        effect.inputs(), ctl.index, [v = ctl.value]<typename C>(C& field) {
+          if constexpr (!avnd::string_parameter<C>)
+            field.value = avnd::map_control_from_01<C>(std::clamp(v, 0.f, 1.f));
+        });
+  }
+}
+
+/**
+ * Single-producer single-consumer queue of packets, e.g. in memory shared by two
+ * processes through shm_open and mmap: it only holds atomics and bytes,
+ * and is constructed in place in the mapping by one of the two sides.
+ */
+struct remote_packet_ring
+{
+  static constexpr std::size_t capacity = 1 << 20;
+  static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+  alignas(64) std::atomic<uint64_t> write_position{};
+  alignas(64) std::atomic<uint64_t> read_position{};
+  std::byte bytes[capacity];
+
+  // Each packet is its size on 4 bytes, then its bytes
+  bool push(const std::byte* data, std::size_t size) noexcept
+  {
+    const uint64_t w = write_position.load(std::memory_order_relaxed);
+    const uint64_t r = read_position.load(std::memory_order_acquire);
+    if (size > remote_max_packet || capacity - (w - r) < size + 4)
+      return false;
+    const uint32_t n = size;
+    copy_in(w, reinterpret_cast<const std::byte*>(&n), 4);
+    copy_in(w + 4, data, size);
+    write_position.store(w + 4 + size, std::memory_order_release);
+    return true;
+  }
+
+  std::size_t pop(std::byte* data, std::size_t max) noexcept
+  {
+    const uint64_t r = read_position.load(std::memory_order_relaxed);
+    const uint64_t w = write_position.load(std::memory_order_acquire);
+    if (w == r)
+      return 0;
+    uint32_t n{};
+    copy_out(r, reinterpret_cast<std::byte*>(&n), 4);
+    if (n <= max)
+      copy_out(r + 4, data, n);
+    read_position.store(r + 4 + n, std::memory_order_release);
+    return n <= max ? n : 0;
+  }
+
+private:
+  void copy_in(uint64_t pos, const std::byte* src, std::size_t n) noexcept
+  {
+    const std::size_t start = pos % capacity;
+    const std::size_t first = std::min(n, capacity - start);
+    std::memcpy(bytes + start, src, first);
+    std::memcpy(bytes, src + first, n - first);
+  }
+  void copy_out(uint64_t pos, std::byte* dst, std::size_t n) const noexcept
+  {
+    const std::size_t start = pos % capacity;
+    const std::size_t first = std::min(n, capacity - start);
+    std::memcpy(dst, bytes + start, first);
+    std::memcpy(dst + first, bytes, n - first);
+  }
+};
+
+// One side of a pair of rings: the other side sends on our receiving one and conversely
+class shared_memory_transport final : public remote_transport
+{
+public:
+  shared_memory_transport(remote_packet_ring& send_ring, remote_packet_ring& receive_ring)
+      : m_send{send_ring}
+      , m_receive{receive_ring}
+  {
+  }
+
+  bool send(const std::byte* data, std::size_t size) noexcept override
+  {
+    return m_send.push(data, size);
+  }
+
+  std::size_t receive(std::byte* data, std::size_t capacity) noexcept override
+  {
+    return m_receive.pop(data, capacity);
+  }
+
+private:
+  remote_packet_ring& m_send;
+  remote_packet_ring& m_receive;
+};
+
+#if AVND_STANDALONE_UDP
+/**
+ * IPv4 UDP. The side which does not know the address of the other one,
+ * usually the remote host, is created without it and answers to whoever
+ * sent the last packet.
+ */
+class udp_transport final : public remote_transport
+{
+public:
+  // A port of 0 picks a free one, see local_port()
+  explicit udp_transport(int local_port, const char* address = nullptr, int port = 0)
+  {
+    m_socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0)
+      return;
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(local_port);
+    if (::bind(m_socket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+    {
+      ::close(m_socket);
+      m_socket = -1;
+      return;
+    }
+    ::fcntl(m_socket, F_SETFL, ::fcntl(m_socket, F_GETFL) | O_NONBLOCK);
+
+    // Room for the packets of a few blocks, which the audio thread reads once per buffer
+    const int buffer = 4 << 20;
+    ::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    ::setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+
+    if (address)
+    {
+      m_peer.sin_family = AF_INET;
+      m_peer.sin_port = htons(port);
+      m_has_peer = ::inet_pton(AF_INET, address, &m_peer.sin_addr) == 1;
+      m_fixed_peer = m_has_peer;
+    }
+  }
+
+  ~udp_transport() override
+  {
+    if (m_socket >= 0)
+      ::close(m_socket);
+  }
+
+  udp_transport(const udp_transport&) = delete;
+  udp_transport& operator=(const udp_transport&) = delete;
+
+  bool valid() const noexcept { return m_socket >= 0; }
+
+  int local_port() const noexcept
+  {
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    if (m_socket < 0
+        || ::getsockname(m_socket, reinterpret_cast<sockaddr*>(&addr), &len) < 0)
+      return 0;
+    return ntohs(addr.sin_port);
+  }
+
+  bool send(const std::byte* data, std::size_t size) noexcept override
+  {
+    if (m_socket < 0 || !m_has_peer)
+      return false;
+    return ::sendto(
+               m_socket, data, size, 0, reinterpret_cast<const sockaddr*>(&m_peer),
+               sizeof(m_peer))
+           == ssize_t(size);
+  }
+
+  std::size_t receive(std::byte* data, std::size_t capacity) noexcept override
+  {
+    if (m_socket < 0)
+      return 0;
+    sockaddr_in from{};
+    socklen_t len = sizeof(from);
+    const ssize_t n = ::recvfrom(
+        m_socket, data, capacity, MSG_TRUNC, reinterpret_cast<sockaddr*>(&from), &len);
+    if (n <= 0 || std::size_t(n) > capacity)
+      return 0;
+    if (!m_fixed_peer)
+    {
+      m_peer = from;
+      m_has_peer = true;
+    }
+    return n;
+  }
+
+private:
+  sockaddr_in m_peer{};
+  int m_socket{-1};
+  bool m_has_peer{};
+  bool m_fixed_peer{};
+};
+#endif
+
+struct remote_options
+{
+  // Frames between a block being sent and its outputs being played
+  int latency_frames{2048};
+
+  // Packets between two sendings of all the controls, for the changes lost on the way
+  int keyframe_interval{64};
+};
+
+/**
+ * Local side: an instance of the graph whose processing happens on a remote_host.
+ * Its effect only holds the controls, which are sent when they change.
+ */
+template <typename T>
+class remote_proxy final : public hosted_instance
+{
+public:
+  using param_in_info = avnd::parameter_input_introspection<T>;
+
+  remote_proxy(std::string name, remote_transport& transport, remote_options options = {})
+      : hosted_instance{std::move(name)}
+      , m_transport{transport}
+      , m_options{options}
+  {
+    m_options.latency_frames = std::max(m_options.latency_frames, 0);
+    m_options.keyframe_interval = std::max(m_options.keyframe_interval, 1);
+    if constexpr (avnd::has_inputs<T>)
+      avnd::init_controls(effect.inputs());
+  }
+
+  int input_channels() const noexcept override { return m_inputs; }
+  int output_channels() const noexcept override { return m_outputs; }
+  int latency() const noexcept override { return m_options.latency_frames; }
+
+  void prepare(double rate, int frames) override
+  {
+    frames = std::max(frames, 1);
+
+    // The blocks which do not fit in a packet are split
+    const std::size_t channel_bytes = std::max({m_inputs, m_outputs, 1}) * sizeof(float);
+    const std::size_t fixed = sizeof(remote_header) + param_in_info::size * sizeof(remote_control);
+    m_packet_frames = std::clamp(int((remote_max_packet - fixed) / channel_bytes), 1, frames);
+
+    // Holds what was sent and not yet played, and packets arriving a bit early
+    m_ring_frames = std::bit_ceil(std::size_t(m_options.latency_frames + 2 * frames));
+    m_ring.assign(m_ring_frames * m_outputs, 0.f);
+    m_ring_positions.assign(m_ring_frames, std::numeric_limits<uint64_t>::max());
+    m_packet.assign(remote_max_packet, std::byte{});
+    m_sent_controls.assign(param_in_info::size, std::numeric_limits<float>::quiet_NaN());
+    m_position = 0;
+    m_packets = 0;
+  }
+
+  // Audio thread
+  void process(float** ins, float** outs, int frames) override
+  {
+    receive_outputs(frames);
+
+    for (int offset = 0; offset < frames; offset += m_packet_frames)
+      send_inputs(ins, offset, std::min(m_packet_frames, frames - offset));
+
+    play_outputs(outs, frames);
+    m_position += frames;
+  }
+
+  // Not sent
+  avnd::effect_container<T> effect;
+  remote_stats stats;
+
+private:
+  void receive_outputs(int frames) noexcept
+  {
+    // First frame which is played in this buffer
+    const int64_t playing = int64_t(m_position) - m_options.latency_frames;
+    const uint64_t mask = m_ring_frames - 1;
+
+    detail::remote_packet_view packet;
+    while (const std::size_t size
+           = m_transport.receive(m_packet.data(), m_packet.size()))
+    {
+      if (!packet.parse(m_packet.data(), size) || packet.header.frames > m_ring_frames
+          || packet.header.position + packet.header.frames > m_position)
+      {
+        remote_stats::add(stats.invalid_packets);
+        continue;
+      }
+      remote_stats::add(stats.received_packets);
+
+      const auto& h = packet.header;
+      if (int64_t(h.position) < playing)
+        remote_stats::add(stats.late_packets);
+
+      // The frames which are already played are skipped
+      const uint32_t skip
+          = std::min<int64_t>(std::max<int64_t>(playing - int64_t(h.position), 0), h.frames);
+      const uint32_t n = h.frames - skip;
+      const uint64_t first = h.position + skip;
+      for (uint32_t i = 0; i < n; i++)
+        m_ring_positions[(first + i) & mask] = first + i;
+
+      // In at most two parts, as the ring wraps around
+      const std::size_t slot = first & mask;
+      const uint32_t before_end = std::min<std::size_t>(n, m_ring_frames - slot);
+      for (int c = 0; c < m_outputs; c++)
+      {
+        float* ring = &m_ring[c * m_ring_frames];
+        if (c < h.channels)
+        {
+          packet.read_channel(c, skip, ring + slot, before_end);
+          packet.read_channel(c, skip + before_end, ring, n - before_end);
+        }
+        else
+        {
+          std::fill_n(ring + slot, before_end, 0.f);
+          std::fill_n(ring, n - before_end, 0.f);
+        }
+      }
+    }
+  }
+
+  void send_inputs(float** ins, int offset, int frames) noexcept
+  {
+    detail::remote_packet_writer out{m_packet.data()};
+    out.begin(
+        {.frames = uint32_t(frames),
+         .position = m_position + offset,
+         .channels = uint16_t(m_inputs)});
+
+    // The controls go with the first packet of the buffer
+    if (offset == 0)
+      out.set_controls(write_controls(out));
+
+    for (int c = 0; c < m_inputs; c++)
+      out.channel(ins[c] + offset, frames);
+
+    if (m_transport.send(m_packet.data(), out.size))
+      remote_stats::add(stats.sent_packets);
+    else
+      remote_stats::add(stats.send_failures);
+    m_packets++;
+  }
+
+  uint16_t write_controls(detail::remote_packet_writer& out) noexcept
+  {
+    uint16_t count = 0;
+    if constexpr (param_in_info::size > 0)
+    {
+      const bool all = m_packets % m_options.keyframe_interval == 0;
+      param_in_info::for_all_n(
+          effect.inputs(), [&]<typename C, std::size_t I>(C& field, avnd::predicate_index<I>) {
+            if constexpr (!avnd::string_parameter<C>)
+            {
+              const float v = avnd::map_control_to_01(field);
+              if (all || v != m_sent_controls[I])
+              {
+                out.control({uint32_t(I), v});
+                m_sent_controls[I] = v;
+                count++;
+              }
+            }
+          });
+    }
+    return count;
+  }
+
+  void play_outputs(float** outs, int frames) noexcept
+  {
+    const uint64_t mask = m_ring_frames - 1;
+    int dropped = 0;
+    for (int i = 0; i < frames; i++)
+    {
+      const int64_t pos = int64_t(m_position) + i - m_options.latency_frames;
+      const std::size_t slot = uint64_t(pos) & mask;
+      // Before the first block comes back, the outputs are silent
+      if (pos >= 0 && m_ring_positions[slot] == uint64_t(pos))
+      {
+        for (int c = 0; c < m_outputs; c++)
+          outs[c][i] = m_ring[c * m_ring_frames + slot];
+      }
+      else
+      {
+        for (int c = 0; c < m_outputs; c++)
+          outs[c][i] = 0.f;
+        dropped += pos >= 0;
+      }
+    }
+    if (dropped > 0)
+      remote_stats::add(stats.dropped_frames, dropped);
+  }
+
+  remote_transport& m_transport;
+  remote_options m_options;
+  int m_inputs{avnd::input_channels<T>(2)};
+  int m_outputs{avnd::output_channels<T>(2)};
+  int m_packet_frames{1};
+
+  // Outputs by absolute position, each channel being m_ring_frames long
+  std::vector<float> m_ring;
+  std::vector<uint64_t> m_ring_positions;
+  std::size_t m_ring_frames{1};
+
+  std::vector<std::byte> m_packet;
+  std::vector<float> m_sent_controls;
+  uint64_t m_position{};
+  uint64_t m_packets{};
+};
+
+/**
+ * Remote side: runs the processor on the blocks of a remote_proxy<T> of the same T,
+ * and sends its outputs back.
+ */
+template <typename T>
+class remote_host
+{
+public:
+  explicit remote_host(remote_transport& transport)
+      : m_transport{transport}
+  {
+    if constexpr (avnd::has_inputs<T>)
+      avnd::init_controls(effect.inputs());
+  }
+
+  // frames: the largest blocks the proxy sends, i.e. its buffer size
+  void prepare(double rate, int frames)
+  {
+    m_frames = std::max(frames, 1);
+    const avnd::process_setup setup{
+        .input_channels = m_inputs,
+        .output_channels = m_outputs,
+        .frames_per_buffer = m_frames,
+        .rate = rate};
+
+    m_processor.allocate_buffers(setup, float{});
+    effect.init_channels(m_inputs, m_outputs);
+    avnd::prepare(effect, setup);
+
+    m_in_storage.assign(std::size_t(m_inputs) * m_frames, 0.f);
+    m_out_storage.assign(std::size_t(m_outputs) * m_frames, 0.f);
+    m_ins.resize(m_inputs);
+    m_outs.resize(m_outputs);
+    for (int c = 0; c < m_inputs; c++)
+      m_ins[c] = m_in_storage.data() + c * m_frames;
+    for (int c = 0; c < m_outputs; c++)
+      m_outs[c] = m_out_storage.data() + c * m_frames;
+    m_packet.assign(remote_max_packet, std::byte{});
+    m_reply.assign(remote_max_packet, std::byte{});
+  }
+
+  // Processes the blocks received since the previous call, returns their count
+  int poll()
+  {
+    int blocks = 0;
+    detail::remote_packet_view packet;
+    while (const std::size_t size
+           = m_transport.receive(m_packet.data(), m_packet.size()))
+    {
+      if (!packet.parse(m_packet.data(), size) || packet.header.frames > uint32_t(m_frames))
+      {
+        remote_stats::add(stats.invalid_packets);
+        continue;
+      }
+      remote_stats::add(stats.received_packets);
+      process(packet);
+      blocks++;
+    }
+    return blocks;
+  }
+
+  // Polls until running is false, e.g. on the main thread of the remote node
+  void run(const std::atomic_bool& running)
+  {
+    while (running.load(std::memory_order_relaxed))
+      if (poll() == 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+
+  avnd::effect_container<T> effect;
+  remote_stats stats;
+
+private:
+  void process(const detail::remote_packet_view& packet)
+  {
+    const auto& h = packet.header;
+    const int frames = h.frames;
+
+    for (int i = 0; i < h.controls; i++)
+      apply_remote_control(effect, packet.control(i));
+
+    for (int c = 0; c < m_inputs; c++)
+    {
+      if (c < h.channels)
+        packet.read_channel(c, 0, m_ins[c], frames);
+      else
+        std::fill_n(m_ins[c], frames, 0.f);
+    }
+
+    {
+      [[maybe_unused]] avnd::denormals_guard<T> denormals;
+      m_processor.process(
+          effect, avnd::span<float*>{m_ins.data(), m_ins.size()},
+          avnd::span<float*>{m_outs.data(), m_outs.size()}, frames);
+    }
+
+    detail::remote_packet_writer out{m_reply.data()};
+    out.begin(
+        {.frames = uint32_t(frames),
+         .position = h.position,
+         .channels = uint16_t(m_outputs)});
+    for (int c = 0; c < m_outputs; c++)
+      out.channel(m_outs[c], frames);
+
+    if (m_transport.send(m_reply.data(), out.size))
+      remote_stats::add(stats.sent_packets);
+    else
+      remote_stats::add(stats.send_failures);
+  }
+
+  remote_transport& m_transport;
+  [[no_unique_address]] avnd::host_process_adapter<T> m_processor;
+  int m_inputs{avnd::input_channels<T>(2)};
+  int m_outputs{avnd::output_channels<T>(2)};
+  int m_frames{};
+
+  std::vector<float> m_in_storage, m_out_storage;
+  std::vector<float*> m_ins, m_outs;
+  std::vector<std::byte> m_packet;
+  std::vector<std::byte> m_reply;
+};
+}
@@ -0,0 +1,572 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/standalone/remote.hpp>
+
+#if __has_include(<sys/mman.h>)
+#define AVND_STANDALONE_SHM 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Audio between standalone processes of a same machine, e.g. a chain of processors
+ * which each run in their own process so that a crash only takes one of them down.
+ *
+ * A shared_audio_stream lives in a shared memory segment: a ring of blocks of planar
+ * floats, each with its frame count and position, and a queue of control changes.
+ * The writing process renders directly in the next block and commits it, the reading
+ * one processes the block where it is: the samples are never copied, neither by the
+ * kernel nor by the two sides. On Linux, the reader sleeps on a futex in the segment
+ * until a block is committed, which is a single system call when it waits.
+ *
+ * A stream has one writer and one reader; a chain of processes uses one per link.
+ */
+namespace standalone
+{
+struct shared_audio_format
+{
+  int channels{2};
+  int frames{512}; // the largest blocks
+  int blocks{4};   // queued at most, i.e. the slack between the two processes
+  double rate{48000.};
+};
+
+namespace detail
+{
+// Waits on a 32-bit word of the segment, across processes
+struct shared_wakeup
+{
+  std::atomic<uint32_t> counter{};
+  std::atomic<uint32_t> waiters{};
+
+  // Called after the change that the waiters look for
+  void notify() noexcept
+  {
+    counter.fetch_add(1, std::memory_order_seq_cst);
+#if defined(__linux__)
+    if (waiters.load(std::memory_order_seq_cst) > 0)
+      ::syscall(
+          SYS_futex, reinterpret_cast<uint32_t*>(&counter), FUTEX_WAKE, INT_MAX, nullptr,
+          nullptr, 0);
+#endif
+  }
+
+  // Returns when ready() or after the timeout
+  template <typename F>
+  bool wait(F&& ready, std::chrono::microseconds timeout) noexcept
+  {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!ready())
+    {
+      const auto now = std::chrono::steady_clock::now();
+      if (now >= deadline)
+        return false;
+#if defined(__linux__)
+      waiters.fetch_add(1, std::memory_order_seq_cst);
+      const uint32_t seen = counter.load(std::memory_order_seq_cst);
+      if (!ready())
+      {
+        const auto left
+            = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+        const timespec ts{
+            .tv_sec = time_t(left.count() / 1000000000),
+            .tv_nsec = long(left.count() % 1000000000)};
+        ::syscall(
+            SYS_futex, reinterpret_cast<uint32_t*>(&counter), FUTEX_WAIT, seen, &ts,
+            nullptr, 0);
+      }
+      waiters.fetch_sub(1, std::memory_order_seq_cst);
+#else
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+    }
+    return true;
+  }
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+}
+
+/**
+ * The layout of the segment: this header, then the blocks.
+ * Only atomics and plain values, so that it can be shared by processes.
+ */
+class shared_audio_stream
+{
+public:
+  static constexpr uint32_t magic_value = 0x41485341; // "ASHA"
+  static constexpr int control_capacity = 1024;
+
+  // Bytes of the segment for a format
+  static std::size_t bytes_for(const shared_audio_format& f) noexcept
+  {
+    return layout(f).bytes;
+  }
+
+  // Sets up the stream in memory of bytes_for(format) bytes, by the side creating the segment
+  static shared_audio_stream* create(void* memory, shared_audio_format f) noexcept
+  {
+    f.channels = std::max(f.channels, 0);
+    f.frames = std::max(f.frames, 1);
+    f.blocks = std::max(f.blocks, 1);
+    auto* s = new (memory) shared_audio_stream;
+    const auto l = layout(f);
+    s->m_format = f;
+    s->m_stride = l.stride;
+    s->m_samples_offset = l.samples;
+    s->m_bytes = l.bytes;
+    s->m_magic.store(magic_value, std::memory_order_release);
+    return s;
+  }
+
+  // The stream another process created in memory of size bytes; null if it is not one
+  static shared_audio_stream* attach(void* memory, std::size_t size) noexcept
+  {
+    auto* s = static_cast<shared_audio_stream*>(memory);
+    if (size < sizeof(shared_audio_stream)
+        || s->m_magic.load(std::memory_order_acquire) != magic_value || s->m_bytes > size)
+      return nullptr;
+    return s;
+  }
+
+  const shared_audio_format& format() const noexcept { return m_format; }
+
+  float* channel(uint64_t block, int c) noexcept
+  {
+    auto* base = reinterpret_cast<std::byte*>(this) + m_samples_offset;
+    const std::size_t index = block % m_format.blocks;
+    return reinterpret_cast<float*>(base)
+           + (index * m_format.channels + c) * m_stride;
+  }
+
+  // Blocks committed and not yet released
+  uint64_t queued() const noexcept
+  {
+    return m_written.load(std::memory_order_acquire)
+           - m_read.load(std::memory_order_acquire);
+  }
+
+private:
+  friend class shared_audio_writer;
+  friend class shared_audio_reader;
+
+  struct block_info
+  {
+    uint64_t position{};
+    uint32_t frames{};
+    uint32_t controls_end{}; // position in the control queue after this block's changes
+  };
+
+  struct layout_type
+  {
+    std::size_t stride{};
+    std::size_t samples{};
+    std::size_t bytes{};
+  };
+
+  static layout_type layout(const shared_audio_format& f) noexcept
+  {
+    layout_type l;
+    l.stride = avnd::channel_buffers<float>::stride_for(std::max(f.frames, 1));
+    l.samples = avnd::align_audio_buffer(
+        sizeof(shared_audio_stream) + std::max(f.blocks, 1) * sizeof(block_info));
+    l.bytes = l.samples
+              + std::size_t(std::max(f.blocks, 1)) * std::max(f.channels, 0) * l.stride
+                    * sizeof(float);
+    return l;
+  }
+
+  block_info& info(uint64_t block) noexcept
+  {
+    auto* infos = reinterpret_cast<block_info*>(this + 1);
+    return infos[block % m_format.blocks];
+  }
+
+  std::atomic<uint32_t> m_magic{};
+  shared_audio_format m_format{};
+  std::size_t m_stride{};
+  std::size_t m_samples_offset{};
+  std::size_t m_bytes{};
+
+  // Blocks, in the order they are written
+  alignas(64) std::atomic<uint64_t> m_written{};
+  alignas(64) std::atomic<uint64_t> m_read{};
+  alignas(64) detail::shared_wakeup m_data;
+  alignas(64) detail::shared_wakeup m_space;
+
+  // Control changes, which the reader applies with the block they were sent with
+  alignas(64) std::atomic<uint32_t> m_controls_written{};
+  std::atomic<uint32_t> m_controls_read{};
+  remote_control m_controls[control_capacity];
+};
+
+/**
+ * Writing side: e.g. the audio callback of a process, or a shared_audio_node.
+ */
+class shared_audio_writer
+{
+public:
+  explicit shared_audio_writer(shared_audio_stream& s)
+      : m_stream{s}
+  {
+    m_channels.resize(s.m_format.channels);
+  }
+
+  // The channels of the next block, null when the reader is a whole ring behind:
+  // the block is then dropped, and counted in overruns.
+  float* const* acquire() noexcept
+  {
+    auto& s = m_stream;
+    const uint64_t w = s.m_written.load(std::memory_order_relaxed);
+    if (w - s.m_read.load(std::memory_order_acquire) >= uint64_t(s.m_format.blocks))
+    {
+      overruns++;
+      return nullptr;
+    }
+    for (int c = 0; c < s.m_format.channels; c++)
+      m_channels[c] = s.channel(w, c);
+    return m_channels.data();
+  }
+
+  // Waits until there is room for a block, e.g. in a process which has no clock of its own
+  bool wait_for_space(std::chrono::microseconds timeout) noexcept
+  {
+    auto& s = m_stream;
+    return s.m_space.wait(
+        [&s] {
+          return s.m_written.load(std::memory_order_relaxed)
+                     - s.m_read.load(std::memory_order_acquire)
+                 < uint64_t(s.m_format.blocks);
+        },
+        timeout);
+  }
+
+  // A change of the index-th parameter input of the reader, in [0; 1], which it gets
+  // with the next block. Returns false when the queue is full.
+  bool push_control(remote_control c) noexcept
+  {
+    auto& s = m_stream;
+    const uint32_t w = s.m_controls_written.load(std::memory_order_relaxed);
+    if (w - s.m_controls_read.load(std::memory_order_acquire)
+        >= uint32_t(shared_audio_stream::control_capacity))
+      return false;
+    s.m_controls[w % shared_audio_stream::control_capacity] = c;
+    s.m_controls_written.store(w + 1, std::memory_order_release);
+    return true;
+  }
+
+  // After acquire(), when the block is rendered
+  void commit(int frames) noexcept
+  {
+    auto& s = m_stream;
+    const uint64_t w = s.m_written.load(std::memory_order_relaxed);
+    auto& info = s.info(w);
+    info.position = m_position;
+    info.frames = std::clamp(frames, 0, s.m_format.frames);
+    info.controls_end = s.m_controls_written.load(std::memory_order_relaxed);
+    m_position += info.frames;
+
+    s.m_written.store(w + 1, std::memory_order_release);
+    s.m_data.notify();
+  }
+
+  int channels() const noexcept { return m_stream.m_format.channels; }
+
+  uint64_t overruns{};
+
+private:
+  shared_audio_stream& m_stream;
+  avnd::channel_vector<float*> m_channels;
+  uint64_t m_position{};
+};
+
+/**
+ * Reading side: e.g. a shared_audio_node, or the audio callback of the last process.
+ */
+class shared_audio_reader
+{
+public:
+  explicit shared_audio_reader(shared_audio_stream& s)
+      : m_stream{s}
+  {
+    m_channels.resize(s.m_format.channels);
+  }
+
+  // The channels of the next block, null when none was committed
+  const float* const* acquire() noexcept
+  {
+    auto& s = m_stream;
+    const uint64_t r = s.m_read.load(std::memory_order_relaxed);
+    if (s.m_written.load(std::memory_order_acquire) == r)
+      return nullptr;
+    for (int c = 0; c < s.m_format.channels; c++)
+      m_channels[c] = s.channel(r, c);
+    return m_channels.data();
+  }
+
+  // Sleeps until a block is committed
+  bool wait(std::chrono::microseconds timeout) noexcept
+  {
+    auto& s = m_stream;
+    return s.m_data.wait(
+        [&s] {
+          return s.m_written.load(std::memory_order_acquire)
+                 != s.m_read.load(std::memory_order_relaxed);
+        },
+        timeout);
+  }
+
+  int channels() const noexcept { return m_stream.m_format.channels; }
+
+  // Of the acquired block
+  int frames() const noexcept
+  {
+    return m_stream.info(m_stream.m_read.load(std::memory_order_relaxed)).frames;
+  }
+  uint64_t position() const noexcept
+  {
+    return m_stream.info(m_stream.m_read.load(std::memory_order_relaxed)).position;
+  }
+
+  // The control changes sent with the acquired block or before it
+  template <typename F>
+  void read_controls(F&& f) noexcept
+  {
+    auto& s = m_stream;
+    const uint32_t end = s.info(s.m_read.load(std::memory_order_relaxed)).controls_end;
+    uint32_t r = s.m_controls_read.load(std::memory_order_relaxed);
+    for (; r != end; r++)
+      f(s.m_controls[r % shared_audio_stream::control_capacity]);
+    s.m_controls_read.store(r, std::memory_order_release);
+  }
+
+  // When done with the acquired block: the writer may reuse it
+  void release() noexcept
+  {
+    auto& s = m_stream;
+    s.m_read.store(s.m_read.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    s.m_space.notify();
+  }
+
+private:
+  shared_audio_stream& m_stream;
+  avnd::channel_vector<const float*> m_channels;
+};
+
+#if AVND_STANDALONE_SHM
+/**
+ * A named POSIX shared memory segment, e.g. "/avnd-reverb-in".
+ * The creating side removes the name when it is destroyed; the processes which
+ * still have it mapped keep it until they unmap it.
+ */
+class shared_memory_segment
+{
+public:
+  static shared_memory_segment create(const std::string& name, std::size_t bytes)
+  {
+    shared_memory_segment seg;
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd < 0)
+      return seg;
+    if (::ftruncate(fd, off_t(bytes)) == 0)
+      seg.map(fd, bytes);
+    ::close(fd);
+    if (seg.m_data)
+      seg.m_name = name;
+    else
+      ::shm_unlink(name.c_str());
+    return seg;
+  }
+
+  static shared_memory_segment open(const std::string& name)
+  {
+    shared_memory_segment seg;
+    const int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+      return seg;
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0)
+      seg.map(fd, std::size_t(st.st_size));
+    ::close(fd);
+    return seg;
+  }
+
+  shared_memory_segment() = default;
+  shared_memory_segment(shared_memory_segment&& other) noexcept { swap(other); }
+  shared_memory_segment& operator=(shared_memory_segment&& other) noexcept
+  {
+    swap(other);
+    return *this;
+  }
+  ~shared_memory_segment()
+  {
+    if (m_data)
+      ::munmap(m_data, m_size);
+    if (!m_name.empty())
+      ::shm_unlink(m_name.c_str());
+  }
+
+  void* data() const noexcept { return m_data; }
+  std::size_t size() const noexcept { return m_size; }
+  explicit operator bool() const noexcept { return m_data; }
+
+private:
+  void map(int fd, std::size_t bytes)
+  {
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+      return;
+    m_data = p;
+    m_size = bytes;
+  }
+
+  void swap(shared_memory_segment& other) noexcept
+  {
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_name, other.m_name);
+  }
+
+  void* m_data{};
+  std::size_t m_size{};
+  std::string m_name; // set when created here
+};
+#endif
+
+/**
+ * A processor between two streams, e.g. the main loop of one process of a chain:
+ * it processes the blocks of its input stream where they are, into the blocks of
+ * its output stream, and applies the control changes sent with them.
+ * Without input stream it is a source, paced by the room in its output stream;
+ * without output stream, a sink.
+ */
+template <typename T>
+class shared_audio_node
+{
+public:
+  shared_audio_node(shared_audio_stream* input, shared_audio_stream* output)
+  {
+    if (input)
+      m_reader.emplace(*input);
+    if (output)
+      m_writer.emplace(*output);
+    if constexpr (avnd::has_inputs<T>)
+      avnd::init_controls(effect.inputs());
+  }
+
+  void prepare(double rate, int frames)
+  {
+    m_frames = std::max(frames, 1);
+    const avnd::process_setup setup{
+        .input_channels = m_inputs,
+        .output_channels = m_outputs,
+        .frames_per_buffer = m_frames,
+        .rate = rate};
+
+    m_processor.allocate_buffers(setup, float{});
+    effect.init_channels(m_inputs, m_outputs);
+    avnd::prepare(effect, setup);
+
+    // Channels which the streams do not have, and outputs which do not fit
+    m_silence.assign(m_frames, 0.f);
+    m_scratch.assign(std::size_t(m_outputs) * m_frames, 0.f);
+    m_ins.resize(m_inputs);
+    m_outs.resize(m_outputs);
+  }
+
+  // Processes one block, returns false when none came before the timeout
+  bool step(std::chrono::microseconds timeout)
+  {
+    const float* const* in{};
+    int frames = m_frames;
+    if (m_reader)
+    {
+      if (!m_reader->wait(timeout))
+        return false;
+      in = m_reader->acquire();
+      frames = std::min(m_reader->frames(), m_frames);
+      m_reader->read_controls([this](remote_control c) { apply_remote_control(effect, c); });
+    }
+
+    float* const* out{};
+    if (m_writer)
+    {
+      // A source waits for room, a processor in a chain does not hold its input back
+      if (!m_reader)
+        if (!m_writer->wait_for_space(timeout))
+          return false;
+      out = m_writer->acquire();
+    }
+
+    const int in_channels = m_reader ? m_reader->channels() : 0;
+    for (int c = 0; c < m_inputs; c++)
+      m_ins[c] = c < in_channels ? const_cast<float*>(in[c]) : m_silence.data();
+
+    const int out_channels = out ? m_writer->channels() : 0;
+    for (int c = 0; c < m_outputs; c++)
+      m_outs[c] = c < out_channels ? out[c] : m_scratch.data() + c * m_frames;
+
+    {
+      [[maybe_unused]] avnd::denormals_guard<T> denormals;
+      m_processor.process(
+          effect, avnd::span<float*>{m_ins.data(), m_ins.size()},
+          avnd::span<float*>{m_outs.data(), m_outs.size()}, frames);
+    }
+
+    if (out)
+    {
+      for (int c = m_outputs; c < out_channels; c++)
+        std::fill_n(out[c], frames, 0.f);
+      m_writer->commit(frames);
+    }
+    if (m_reader)
+      m_reader->release();
+    return true;
+  }
+
+  // Steps until running is false
+  void run(const std::atomic_bool& running)
+  {
+    while (running.load(std::memory_order_relaxed))
+      step(std::chrono::milliseconds(100));
+  }
+
+  // Blocks which did not fit in the output stream
+  uint64_t overruns() const noexcept { return m_writer ? m_writer->overruns : 0; }
+
+  avnd::effect_container<T> effect;
+
+private:
+  std::optional<shared_audio_reader> m_reader;
+  std::optional<shared_audio_writer> m_writer;
+  [[no_unique_address]] avnd::host_process_adapter<T> m_processor;
+  int m_inputs{avnd::input_channels<T>(2)};
+  int m_outputs{avnd::output_channels<T>(2)};
+  int m_frames{1};
+
+  std::vector<float> m_silence, m_scratch;
+  std::vector<float*> m_ins, m_outs;
+};
+}
@@ -9,6 +9,11 @@
 #endif
 #endif
 
+#include <avnd/binding/standalone/audio.hpp>
+#include <avnd/binding/standalone/benchmark.hpp>
+#include <avnd/binding/standalone/multi.hpp>
+#include <avnd/binding/standalone/offline.hpp>
+
 #if __has_include(<QQuickView>) && __has_include(<verdigris>)
 #define AVND_STANDALONE_QML 1
 #include <avnd/binding/ui/qml_layout_ui.hpp>
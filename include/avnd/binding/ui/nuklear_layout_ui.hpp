@@ -7,7 +7,15 @@
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/layout.hpp>
 #include <avnd/introspection/messages.hpp>
+#include <avnd/wrappers/controls_mirror.hpp>
 #include <avnd/wrappers/metadatas.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
 namespace nkl
 {
 constexpr const char* c_str(std::string_view s)
@@ -26,6 +34,13 @@ public:
   nk_colorf bg;
   struct nk_image img;
 
+  // Upper bound of the refresh rate
+  double max_fps{30.};
+
+  // Set by whatever changes the controls besides the UI, e.g. the network:
+  // the UI is only redrawn when this or the user changes something
+  avnd::dirty_flags<avnd::input_introspection<T>::size> dirty;
+
   explicit layout_ui(avnd::effect_container<T>& impl)
       : implementation{impl}
   {
@@ -43,6 +58,7 @@ public:
 #endif
     win = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Demo", nullptr, nullptr);
     glfwMakeContextCurrent(win);
+    glfwSwapInterval(1);
     glfwGetWindowSize(win, &width, &height);
 
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -62,6 +78,7 @@ public:
     }
 
     bg.r = 0.10f, bg.g = 0.18f, bg.b = 0.24f, bg.a = 1.0f;
+    lowerLayout();
   }
 
   ~layout_ui()
@@ -70,29 +87,58 @@ public:
     glfwTerminate();
   }
 
+  // The layout, lowered once into a flat list which each frame walks linearly,
+  // instead of going through the layout and looking up each control again
+  struct widget
+  {
+    enum kind_type : uint8_t
+    {
+      label,
+      row,          // next widgets on a row of "columns"
+      tree,         // collapsible, children up to "end"
+      tabs,         // the tab entries up to "end", "state" is the current one
+      tab,          // children up to "end"
+      float_slider, // "value" is a float*
+      int_slider    // "value" is an int*
+    } kind{};
+    const char* text{};
+    int columns{};
+    int end{};
+    float min{}, max{};
+    void* value{};
+    int state{};
+  };
+  std::vector<widget> widgets;
+
   void recurseItem(const auto& item)
   {
-    avnd::for_each_field_ref(item, [this](auto& child) { this->createItem(child); });
+    avnd::for_each_field_ref(item, [this](auto& child) { this->lowerItem(child); });
   }
 
   template <avnd::float_control C>
-  void create(C& control, int idx)
+  void lower(C& control)
   {
     constexpr auto rng = avnd::get_range<C>();
-    nk_layout_row_dynamic(ctx, row_height, 2);
-    nk_label(ctx, avnd::get_name<C>().data(), NK_TEXT_LEFT);
-    nk_slider_float(ctx, rng.min, &control.value, rng.max, 0.1);
+    widgets.push_back(
+        {.kind = widget::float_slider,
+         .text = avnd::get_name<C>().data(),
+         .min = float(rng.min),
+         .max = float(rng.max),
+         .value = &control.value});
   }
   template <avnd::int_control C>
-  void create(C& control, int idx)
+  void lower(C& control)
   {
     constexpr auto rng = avnd::get_range<C>();
-    nk_layout_row_dynamic(ctx, row_height, 2);
-    nk_label(ctx, avnd::get_name<C>().data(), NK_TEXT_LEFT);
-    nk_slider_int(ctx, rng.min, &control.value, rng.max, 1);
+    widgets.push_back(
+        {.kind = widget::int_slider,
+         .text = avnd::get_name<C>().data(),
+         .min = float(rng.min),
+         .max = float(rng.max),
+         .value = &control.value});
   }
 
-  void createWidget(const auto& item)
+  void lowerWidget(const auto& item)
   {
     if constexpr (requires {
                     {
@@ -100,58 +146,33 @@ public:
                       } -> std::convertible_to<std::string_view>;
                   })
     {
-      nk_label(ctx, item, NK_TEXT_LEFT);
+      widgets.push_back({.kind = widget::label, .text = c_str(item)});
     }
     else if constexpr (requires { (avnd::get_inputs<T>(this->implementation).*item); })
     {
       auto& ins = avnd::get_inputs<T>(this->implementation);
-      auto& control = ins.*item;
-      create(control, avnd::index_in_struct(ins, item));
+      lower(ins.*item);
     }
   }
 
-  template <typename Item>
-  void createTabs(const Item& item)
+  // Children of the widget at index "parent", which ends after them
+  void lowerChildren(std::size_t parent, const auto& item)
   {
-    constexpr int child_count = boost::pfr::tuple_size_v<Item>;
-    static int tab_state = 0;
-    nk_layout_row_begin(ctx, NK_STATIC, row_height, child_count);
-
-    int k = 0;
-    avnd::for_each_field_ref(
-        item,
-        [&]<typename TT>(const TT& child)
-        {
-          if (nk_tab(ctx, c_str(TT::name()), tab_state == k))
-          {
-            tab_state = k;
-          }
-          k++;
-        });
-    k = 0;
-    avnd::for_each_field_ref(
-        item,
-        [&]<typename TT>(const TT& child)
-        {
-          if (k == tab_state)
-          {
-            createItem(child);
-          }
-          k++;
-        });
+    recurseItem(item);
+    widgets[parent].end = int(widgets.size());
   }
 
   template <typename Item>
-  void createItem(const Item& item)
+  void lowerItem(const Item& item)
   {
     constexpr int child_count = boost::pfr::tuple_size_v<Item>;
     if constexpr (requires { item.spacing; })
     {
-      nk_label(ctx, " ", NK_TEXT_LEFT);
+      widgets.push_back({.kind = widget::label, .text = " "});
     }
     else if constexpr (requires { item.hbox; })
     {
-      nk_layout_row_dynamic(ctx, row_height, child_count);
+      widgets.push_back({.kind = widget::row, .columns = child_count});
       recurseItem(item);
     }
     else if constexpr (requires { item.vbox; })
@@ -160,51 +181,165 @@ public:
     }
     else if constexpr (requires { item.split; })
     {
-      if (nk_tree_push(ctx, NK_TREE_TAB, "Split", NK_MINIMIZED))
-      {
-        recurseItem(item);
-        nk_tree_pop(ctx);
-      }
+      widgets.push_back({.kind = widget::tree, .text = "Split"});
+      lowerChildren(widgets.size() - 1, item);
     }
     else if constexpr (requires { item.group; })
     {
-      if (nk_tree_push(ctx, NK_TREE_TAB, c_str(Item::name()), NK_MINIMIZED))
-      {
-        recurseItem(item);
-        nk_tree_pop(ctx);
-      }
+      widgets.push_back({.kind = widget::tree, .text = c_str(Item::name())});
+      lowerChildren(widgets.size() - 1, item);
     }
     else if constexpr (requires { item.tabs; })
     {
-      createTabs(item);
+      const std::size_t bar = widgets.size();
+      widgets.push_back({.kind = widget::tabs, .columns = child_count});
+      avnd::for_each_field_ref(item, [this]<typename TT>(const TT& child) {
+        widgets.push_back({.kind = widget::tab, .text = c_str(TT::name())});
+        const std::size_t tab = widgets.size() - 1;
+        lowerItem(child);
+        widgets[tab].end = int(widgets.size());
+      });
+      widgets[bar].end = int(widgets.size());
     }
     else
     {
       // Normal widget
-      createWidget(item);
+      lowerWidget(item);
     }
   }
 
-  void createLayout()
+  void lowerLayout()
   {
     using type = typename avnd::ui_type<T>::type;
     constexpr type layout;
-    createItem(layout);
+    widgets.clear();
+    lowerItem(layout);
+  }
+
+  // Whether the next widget is in the scrolled region of the window.
+  // Control rows outside of it only reserve their space, and read no value
+  bool next_visible() const
+  {
+    const struct nk_rect b = nk_widget_bounds(ctx);
+    const struct nk_rect clip = ctx->current->layout->clip;
+    return b.y < clip.y + clip.h && b.y + b.h > clip.y;
   }
 
+  // Only the current tab of each tab bar is drawn
+  void draw(int begin, int end)
+  {
+    for (int i = begin; i < end;)
+    {
+      auto& w = widgets[i];
+      switch (w.kind)
+      {
+        case widget::label:
+          nk_label(ctx, w.text, NK_TEXT_LEFT);
+          i++;
+          break;
+        case widget::row:
+          nk_layout_row_dynamic(ctx, row_height, w.columns);
+          i++;
+          break;
+        case widget::tree:
+          // Seeded by the index, so that two groups of a same name stay apart
+          if (nk_tree_push_hashed(
+                  ctx, NK_TREE_TAB, w.text, NK_MINIMIZED, w.text, int(std::strlen(w.text)),
+                  i))
+          {
+            draw(i + 1, w.end);
+            nk_tree_pop(ctx);
+          }
+          i = w.end;
+          break;
+        case widget::tabs: {
+          nk_layout_row_begin(ctx, NK_STATIC, row_height, w.columns);
+          int k = 0;
+          for (int t = i + 1; t < w.end; t = widgets[t].end, k++)
+            if (nk_tab(ctx, widgets[t].text, w.state == k))
+              w.state = k;
+          k = 0;
+          for (int t = i + 1; t < w.end; t = widgets[t].end, k++)
+            if (k == w.state)
+              draw(t + 1, widgets[t].end);
+          i = w.end;
+          break;
+        }
+        case widget::tab:
+          i = w.end;
+          break;
+        case widget::float_slider:
+          nk_layout_row_dynamic(ctx, row_height, 2);
+          if (!next_visible())
+          {
+            nk_spacing(ctx, 2);
+            i++;
+            break;
+          }
+          nk_label(ctx, w.text, NK_TEXT_LEFT);
+          nk_slider_float(ctx, w.min, static_cast<float*>(w.value), w.max, 0.1);
+          i++;
+          break;
+        case widget::int_slider:
+          nk_layout_row_dynamic(ctx, row_height, 2);
+          if (!next_visible())
+          {
+            nk_spacing(ctx, 2);
+            i++;
+            break;
+          }
+          nk_label(ctx, w.text, NK_TEXT_LEFT);
+          nk_slider_int(ctx, int(w.min), static_cast<int*>(w.value), int(w.max), 1);
+          i++;
+          break;
+      }
+    }
+  }
+
+  void createLayout() { draw(0, int(widgets.size())); }
+
   void render()
   {
+    using clock = std::chrono::steady_clock;
+    std::vector<char> last_commands;
+    int last_width = -1, last_height = -1;
+    auto next_frame = clock::now();
+
     while (!glfwWindowShouldClose(win))
     {
-      glfwPollEvents();
-      nk_glfw3_new_frame();
+      // Sleep until the user does something, or the next frame
+      const auto period = std::chrono::duration<double>(1. / std::max(max_fps, 1.));
+      std::this_thread::sleep_until(next_frame);
+      const auto before = clock::now();
+      glfwWaitEventsTimeout(period.count());
+      next_frame = before + std::chrono::duration_cast<clock::duration>(period);
 
+      const bool events = clock::now() - before < period * 0.9;
+      const bool changed = dirty.take().any();
       glfwGetWindowSize(win, &width, &height);
+      const bool resized = width != last_width || height != last_height;
+      if (!events && !changed && !resized)
+        continue;
 
+      nk_glfw3_new_frame();
       if (nk_begin(ctx, "Demo", nk_rect(0, 0, width, height), 0))
         createLayout();
       nk_end(ctx);
 
+      // Nothing to draw if the commands are the same as the last frame,
+      // e.g. the cursor moved outside of the widgets
+      const auto* cmds = static_cast<const char*>(nk_buffer_memory_const(&ctx->memory));
+      const std::size_t size = ctx->memory.allocated;
+      if (!resized && size == last_commands.size()
+          && std::memcmp(cmds, last_commands.data(), size) == 0)
+      {
+        nk_clear(ctx);
+        continue;
+      }
+      last_commands.assign(cmds, cmds + size);
+      last_width = width;
+      last_height = height;
+
       glViewport(0, 0, width, height);
       glClear(GL_COLOR_BUFFER_BIT);
       glClearColor(bg.r, bg.g, bg.b, bg.a);
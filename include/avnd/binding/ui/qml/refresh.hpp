@@ -0,0 +1,78 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/introspection/input.hpp>
+#include <avnd/wrappers/controls_mirror.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <QQuickItem>
+#include <QTimer>
+#include <QVariant>
+
+#include <algorithm>
+#include <bitset>
+
+namespace qml
+{
+/**
+ * Moves the widgets of the controls flagged in "changed" to the current values
+ * of the controls; the widgets are found by their "control_<index>" object name.
+ */
+template <typename T, std::size_t N>
+void refresh_controls(
+    QQuickItem& item, avnd::effect_container<T>& implementation,
+    const std::bitset<N>& changed)
+{
+  avnd::input_introspection<T>::for_all_n2(
+      avnd::get_inputs(implementation),
+      [&]<typename C, std::size_t Idx, std::size_t Field>(
+          C& ctl, avnd::predicate_index<Idx>, avnd::field_index<Field>) {
+        if constexpr (avnd::parameter<C>)
+        {
+          if (!changed.test(Field))
+            return;
+          auto obj = item.findChild<QObject*>(QStringLiteral("control_%1").arg(Field));
+          if (!obj)
+            return;
+
+          if constexpr (avnd::enum_parameter<C>)
+            obj->setProperty("currentIndex", static_cast<int>(ctl.value));
+          else if constexpr (avnd::bool_parameter<C>)
+            obj->setProperty("checked", bool(ctl.value));
+          else if constexpr (requires { QVariant::fromValue(ctl.value); })
+            obj->setProperty("value", QVariant::fromValue(ctl.value));
+        }
+      });
+}
+
+/**
+ * Refreshes the widgets at most max_fps times per second, and only
+ * when something flagged the controls as dirty.
+ */
+template <typename T>
+struct refresh_timer
+{
+  avnd::dirty_flags<avnd::input_introspection<T>::size> dirty;
+  QTimer timer;
+
+  // True while the widgets are moved, their change signals must then be ignored
+  bool updating{};
+
+  void start(QQuickItem*& item, avnd::effect_container<T>& implementation, double max_fps = 30.)
+  {
+    QObject::connect(&timer, &QTimer::timeout, [this, &item, &implementation] {
+      const auto changed = dirty.take();
+      if (!item || changed.none())
+        return;
+
+      updating = true;
+      refresh_controls(*item, implementation, changed);
+      updating = false;
+    });
+    set_max_fps(max_fps);
+  }
+
+  void set_max_fps(double fps) { timer.start(int(1000. / std::max(fps, 1.))); }
+};
+}
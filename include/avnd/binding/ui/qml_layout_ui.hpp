@@ -5,6 +5,7 @@
 #include <avnd/binding/ui/qml/enum_control.hpp>
 #include <avnd/binding/ui/qml/float_control.hpp>
 #include <avnd/binding/ui/qml/int_control.hpp>
+#include <avnd/binding/ui/qml/refresh.hpp>
 #include <avnd/binding/ui/qml/toggle_control.hpp>
 #include <avnd/common/for_nth.hpp>
 #include <avnd/introspection/input.hpp>
@@ -13,12 +14,14 @@
 
 #include <QDebug>
 #include <QGuiApplication>
-#include <QQmlApplicationEngine>
+#include <QQmlComponent>
 #include <QQmlContext>
 #include <QQmlEngine>
 #include <QQmlProperty>
 #include <QQuickItem>
 
+#include <memory>
+
 #include <verdigris>
 
 namespace qml
@@ -33,14 +36,31 @@ public:
 
   std::string componentData;
   QQuickItem* item{};
-  QQmlApplicationEngine engine;
+
+  // Flag the controls changed outside of the UI, e.g. by the network, in refresh.dirty
+  refresh_timer<T> refresh;
+
+  // The window, created from the component cached for T
+  std::unique_ptr<QObject> window;
 
   explicit qml_layout_ui_base(avnd::effect_container<T>& impl)
       : implementation{impl}
   {
-    componentData.reserve(20000);
+    refresh.start(item, implementation);
   }
 
+  // All the layout UIs share an engine, which lives as long as the application:
+  // the QtQuick modules are only loaded once
+  static QQmlEngine& engine()
+  {
+    static QQmlEngine* e = new QQmlEngine{QCoreApplication::instance()};
+    return *e;
+  }
+
+  // The document only depends on T: it is generated and compiled when the first
+  // UI of T opens, the next ones are instances of the same component
+  static inline QQmlComponent* component{};
+
   void create(qml_layout_ui_base& self, auto& c, int control_k) { }
 
   template <typename Val>
@@ -101,12 +121,15 @@ public:
   explicit qml_layout_ui(avnd::effect_container<T>& impl)
       : qml_layout_ui_base<T>{impl}
   {
-    this->engine.rootContext()->setContextProperty("_uiHandler", this);
-    using namespace std::literals;
+    auto& engine = this->engine();
+    if (!this->component)
+    {
+      /// Here we generate a QML file content
+      this->componentData.reserve(20000);
+      tab_bar_k = 0;
 
-    /// Here we generate a QML file content
-    // The header
-    append(R"_(import QtQuick 2.15
+      // The header
+      append(R"_(import QtQuick 2.15
 import QtQuick.Layouts 1.15
 import QtQuick.Controls 2.15
 ApplicationWindow {{
@@ -116,18 +139,26 @@ ApplicationWindow {{
 
 )_");
 
-    // The layout
-    createLayout();
+      // The layout
+      createLayout();
+
+      append("\n  }}\n}}\n");
 
-    append("\n  }}\n}}\n");
+      /// Compile the QML component
+      this->component = new QQmlComponent{&engine, &engine};
+      this->component->setData(QByteArray::fromStdString(this->componentData), QUrl());
+      std::string{}.swap(this->componentData);
+    }
 
-    /// Create and instantiate the QML component
-    this->engine.loadData(QByteArray::fromStdString(this->componentData), QUrl());
-    auto objs = this->engine.rootObjects();
-    assert(!objs.empty());
+    /// Instantiate it, with this UI as handler of its widgets
+    auto context = new QQmlContext{engine.rootContext(), this};
+    context->setContextProperty("_uiHandler", this);
+    this->window.reset(this->component->create(context));
+    assert(this->window);
 
-    this->item = objs[0]->template findChild<QQuickItem*>(QStringLiteral("mainItem"));
+    this->item = this->window->template findChild<QQuickItem*>(QStringLiteral("mainItem"));
     assert(this->item);
+    pageLoaded(this->item);
   }
 
   template <typename... Args>
@@ -142,6 +173,20 @@ ApplicationWindow {{
     avnd::for_each_field_ref(item, [this](auto& child) { this->createItem(child); });
   }
 
+  // The pages of a tab bar are only instantiated while they are the current one:
+  // the widgets of the others do not exist, and get no value updates
+  void recurseTabs(const auto& item)
+  {
+    avnd::for_each_field_ref(item, [this](auto& child) {
+      append(
+          "Loader {{ active: StackLayout.isCurrentItem; "
+          "onLoaded: _uiHandler.pageLoaded(item)\n"
+          "sourceComponent: Component {{\n");
+      this->createItem(child);
+      append("\n}}\n}}\n");
+    });
+  }
+
   static inline int tab_bar_k = 0;
   void createWidget(const auto& item)
   {
@@ -224,7 +269,7 @@ ApplicationWindow {{
           "StackLayout {{ width: parent.width; currentIndex: tabbar_{}.currentIndex\n",
           bar);
       depth++;
-      recurseItem(item);
+      recurseTabs(item);
       depth--;
       append("\n}}\n");
     }
@@ -241,8 +286,23 @@ ApplicationWindow {{
     createItem(lay);
   }
 
+  // Widgets which were just instantiated start from the current values of the controls
+  void pageLoaded(QQuickItem* page) noexcept
+  {
+    if (!page)
+      return;
+    this->refresh.updating = true;
+    refresh_controls(
+        *page, this->implementation,
+        std::bitset<avnd::input_introspection<T>::size>{}.set());
+    this->refresh.updating = false;
+  }
+  W_SLOT(pageLoaded, (QQuickItem*))
+
   void floatChanged(int idx, float value) noexcept
   {
+    if (this->refresh.updating)
+      return;
     float_control::changed(*this, idx, value);
   }
   W_SLOT(floatChanged, (int, float))
@@ -254,6 +314,8 @@ ApplicationWindow {{
 
   void intChanged(int idx, int value) noexcept
   {
+    if (this->refresh.updating)
+      return;
     int_control::changed(*this, idx, value);
   }
   W_SLOT(intChanged, (int, int))
@@ -265,12 +327,16 @@ ApplicationWindow {{
 
   void enumChanged(int idx, int value) noexcept
   {
+    if (this->refresh.updating)
+      return;
     enum_control::changed(*this, idx, value);
   }
   W_SLOT(enumChanged, (int, int))
 
   void toggleChanged(int idx, bool value) noexcept
   {
+    if (this->refresh.updating)
+      return;
     toggle_control::changed(*this, idx, value);
   }
   W_SLOT(toggleChanged, (int, bool))
@@ -5,6 +5,7 @@
 #include <avnd/binding/ui/qml/enum_control.hpp>
 #include <avnd/binding/ui/qml/float_control.hpp>
 #include <avnd/binding/ui/qml/int_control.hpp>
+#include <avnd/binding/ui/qml/refresh.hpp>
 #include <avnd/binding/ui/qml/toggle_control.hpp>
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/messages.hpp>
@@ -31,6 +32,9 @@ public:
 
   std::string componentData;
   QQuickItem* item{};
+
+  // Flag the controls changed outside of the UI, e.g. by the network, in refresh.dirty
+  refresh_timer<T> refresh;
   QQuickView view;
   QQmlComponent comp;
 
@@ -39,6 +43,7 @@ public:
       , comp{view.engine()}
   {
     componentData.reserve(20000);
+    refresh.start(item, implementation);
   }
 
   void create(qml_ui_base& self, auto& c, int control_k) { }
@@ -157,6 +162,8 @@ Item {{
 
   void floatChanged(int idx, float value) noexcept
   {
+    if (this->refresh.updating)
+      return;
     float_control::changed(*this, idx, value);
   }
   W_SLOT(floatChanged, (int, float))
@@ -168,6 +175,8 @@ Item {{
 
   void intChanged(int idx, int value) noexcept
   {
+    if (this->refresh.updating)
+      return;
     int_control::changed(*this, idx, value);
   }
   W_SLOT(intChanged, (int, int))
@@ -179,12 +188,16 @@ Item {{
 
   void enumChanged(int idx, int value) noexcept
   {
+    if (this->refresh.updating)
+      return;
     enum_control::changed(*this, idx, value);
   }
   W_SLOT(enumChanged, (int, int))
 
   void toggleChanged(int idx, bool value) noexcept
   {
+    if (this->refresh.updating)
+      return;
     toggle_control::changed(*this, idx, value);
   }
   W_SLOT(toggleChanged, (int, bool))
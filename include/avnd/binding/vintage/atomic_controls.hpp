@@ -7,6 +7,8 @@
 #include <avnd/introspection/input.hpp>
 #include <avnd/wrappers/control_display.hpp>
 #include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/controls_mirror.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
 #if __has_include(<fmt/format.h>)
 #include <fmt/format.h>
 #else
@@ -26,7 +28,7 @@ struct Controls
   {
   }
   void read(auto&&) { }
-  void write(auto&&) { }
+  void write(auto&&, auto&&) { }
   template <typename Effect_T>
   void display(Effect_T& effect, int index, void* ptr)
   {
@@ -50,7 +52,22 @@ requires(avnd::parameter_input_introspection<T>::size > 0) struct Controls<T>
 {
   using inputs_info_t = avnd::parameter_input_introspection<T>;
   static const constexpr int32_t parameter_count = inputs_info_t::size;
-  std::atomic<float> parameters[std::max(parameter_count, 1)];
+
+  // Written by the host from its threads, read by the audio thread. They start on
+  // their own cache lines, so that the flags and the text cache do not share them.
+  alignas(64) std::atomic<float> parameters[std::max(parameter_count, 1)];
+
+  // The parameters set since the last buffer: only these are written to the controls
+  alignas(64) avnd::dirty_flags<parameter_count> changed;
+
+  // Hosts ask for the text of the values of all the visible parameters at each frame
+  alignas(64) avnd::display_cache<parameter_count> value_texts;
+
+  void set(int32_t index, float value) noexcept
+  {
+    parameters[index].store(value, std::memory_order_release);
+    changed.set(index);
+  }
 
   template <typename Effect_T>
   void init(Effect_T& effect)
@@ -60,8 +77,8 @@ requires(avnd::parameter_input_introspection<T>::size > 0) struct Controls<T>
     {
       auto& self = *static_cast<Effect_T*>(effect);
 
-      if (index < Controls<T>::parameter_count)
-        self.controls.parameters[index].store(parameter, std::memory_order_release);
+      if (index >= 0 && index < Controls<T>::parameter_count)
+        self.controls.set(index, parameter);
     };
 
     effect.Effect::getParameter = [](Effect* effect, int32_t index) noexcept
@@ -88,24 +105,19 @@ requires(avnd::parameter_input_introspection<T>::size > 0) struct Controls<T>
     }
     (std::make_index_sequence<parameter_count>());
 
-    std::atomic_thread_fence(std::memory_order_release);
+    // e.g. a program: the controls get it at the next buffer
+    changed.set_all();
   }
 
-  void write(avnd::effect_container<T>& implementation)
+  // At the beginning of each buffer: the parameters which the host changed go to the controls
+  void write(avnd::effect_container<T>& implementation, avnd::shared_controls<T>& sink)
   {
-    std::atomic_thread_fence(std::memory_order_acquire);
-
-    [ this, &implementation ]<std::size_t... Index>(
-        std::integer_sequence<std::size_t, Index...>)
-    {
-      auto& source = this->parameters;
-      auto& sink = implementation.inputs();
-      ((inputs_info_t::template get<Index>(sink).value
-        = avnd::map_control_from_01<typename inputs_info_t::template nth_element<Index>>(
-            source[Index].load(std::memory_order_relaxed))),
-       ...);
-    }
-    (std::make_index_sequence<parameter_count>());
+    changed.take([this, &implementation, &sink](std::size_t index) {
+      const float value = parameters[index].load(std::memory_order_relaxed);
+      sink.write(implementation, int(index), [value]<typename C>(C& field) {
+        field.value = avnd::map_control_from_01<C>(value);
+      });
+    });
   }
 
   template <typename Effect_T>
@@ -131,16 +143,18 @@ requires(avnd::parameter_input_introspection<T>::size > 0) struct Controls<T>
   template <typename Effect_T>
   void display(Effect_T& effect, int index, void* ptr)
   {
-    auto& self = effect.effect;
+    if (index < 0 || index >= parameter_count)
+      return;
+
+    // The value set by the host, which the processor only gets at the next buffer
+    const float value = parameters[index].load(std::memory_order_acquire);
     inputs_info_t::for_nth_mapped(
-        self.inputs(),
         index,
-        [ptr]<typename C>(const C& param)
+        [this, index, value, ptr]<auto Idx, typename C>(avnd::field_reflection<Idx, C>)
         {
-          avnd::display_control<C>(
-              param.value,
-              reinterpret_cast<char*>(ptr),
-              vintage::Constants::ParamStrLen);
+          value_texts.template display<C>(
+              index, value, avnd::map_control_from_01<C>(value),
+              reinterpret_cast<char*>(ptr), vintage::Constants::ParamStrLen);
         });
   }
 
@@ -11,8 +11,21 @@
 #include <avnd/binding/vintage/vintage.hpp>
 #include <avnd/common/export.hpp>
 #include <avnd/introspection/channels.hpp>
+#include <avnd/wrappers/bypass.hpp>
+#include <avnd/wrappers/changed_controls.hpp>
 #include <avnd/wrappers/controls.hpp>
-#include <avnd/wrappers/process_adapter.hpp>
+#include <avnd/wrappers/deadline.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/latency.hpp>
+#include <avnd/wrappers/morph.hpp>
+#include <avnd/wrappers/programs.hpp>
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+#include <avnd/wrappers/silence.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
+#include <avnd/wrappers/smoothing_storage.hpp>
+#include <avnd/wrappers/tracing.hpp>
+#include <avnd/wrappers/worker.hpp>
 
 namespace vintage
 {
@@ -36,12 +49,27 @@ struct SimpleAudioEffect : vintage::Effect
 
   [[no_unique_address]] Controls<T> controls;
 
+  // Where the controls are written: once for duplicated instances, see shared_controls
+  [[no_unique_address]] avnd::shared_controls<T> instance_controls;
+
   [[no_unique_address]] ProcessorSetup processorSetup;
 
-  [[no_unique_address]] process_adapter<T> processor;
+  avnd::bypass_adapter<T> processor;
+
+  [[no_unique_address]] avnd::smoothing_storage<T> smoothing;
+
+  [[no_unique_address]] avnd::changed_controls_storage<T> changed_controls;
+
+  [[no_unique_address]] avnd::morph_storage<T> morphing;
+  [[no_unique_address]] avnd::worker_storage<T> worker;
+
+  // Callbacks over their time budget, when built with AVND_DEADLINE_MONITOR
+  [[no_unique_address]] avnd::deadline_monitor deadlines{avnd::get_name<T>()};
 
   [[no_unique_address]] programs_setup programs;
 
+  [[no_unique_address]] avnd::program_storage<T> program_values;
+
   [[no_unique_address]] midi_processor<T> midi;
 
   float sample_rate{44100.};
@@ -64,7 +92,7 @@ struct SimpleAudioEffect : vintage::Effect
     Effect::numParams = Controls<T>::parameter_count;
 
     Effect::flags |= EffectFlags::CanReplacing;
-    if constexpr (avnd::double_processor<T>)
+    if constexpr (ProcessorSetup::double_precision<SimpleAudioEffect>())
       Effect::flags |= EffectFlags::CanDoubleReplacing;
     if constexpr (avnd::midi_input_introspection<T>::size > 0)
       Effect::flags |= EffectFlags::IsSynth;
@@ -125,14 +153,33 @@ struct SimpleAudioEffect : vintage::Effect
     // Setup buffers for storing MIDI messages
     if constexpr (midi_input_introspection<T>::size > 0)
     {
-      using i_info = avnd::midi_input_introspection<T>;
-      auto& in_port = boost::pfr::get<i_info::index_map[0]>(effect.inputs());
-
-      midi.reserve_space(this->effect, buffer_size);
+      midi.reserve(this->effect, buffer_size);
     }
 
+    // Setup the ramps of smoothed controls
+    smoothing.prepare(effect, sample_rate, buffer_size);
+    worker.start(effect);
+    program_values.prepare(sample_rate);
+    deadlines.prepare(sample_rate);
+
     // Effect-specific preparation
     avnd::prepare(effect, setup_info);
+    processor.reserve_delay(avnd::latency_samples(effect));
+
+    // Read by the host when the effect is resumed
+    if constexpr (avnd::reports_latency<T>)
+      Effect::initialDelay = int32_t(std::max(avnd::latency_samples(effect), int64_t(0)));
+  }
+
+  // For GetTailSize: 1 means no tail, 0 that it is unknown
+  intptr_t tail_samples()
+  {
+    if constexpr (avnd::has_tail<T>)
+    {
+      const double frames = std::ceil(avnd::tail_seconds(effect) * sample_rate);
+      return frames < double(INT32_MAX) ? std::max(intptr_t(frames), intptr_t(1)) : INT32_MAX;
+    }
+    return 1;
   }
 
   ~SimpleAudioEffect() { }
@@ -150,6 +197,11 @@ struct SimpleAudioEffect : vintage::Effect
       std::floating_point auto** outputs,
       int32_t sampleFrames)
   {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    [[maybe_unused]] avnd::deadline_scope deadline{deadlines, sampleFrames};
+    AVND_TRACE_ZONE(T, callback);
+
     // Check if processing is to be bypassed
     if constexpr (avnd::can_bypass<T>)
     {
@@ -158,35 +210,61 @@ struct SimpleAudioEffect : vintage::Effect
           return;
     }
 
-    // Clear our midi outputs
+    // Clear our midi outputs, the inputs were filled by the events of the host
     midi.clear_outputs(effect);
+    midi.merge_inputs(effect);
 
     // Before processing starts, we copy all our atomics back into the struct
-    controls.write(effect);
+    {
+      AVND_TRACE_ZONE(T, parameters);
+      controls.write(effect, instance_controls);
+      program_values.apply(effect, sampleFrames);
+      instance_controls.sync(effect);
+    }
 
     // Actual processing
     using fp_t = std::decay_t<decltype(inputs[0][0])>;
-    processor.process(
-        effect,
-        avnd::span<fp_t*>{inputs, std::size_t(this->Effect::numInputs)},
-        avnd::span<fp_t*>{outputs, std::size_t(this->Effect::numOutputs)},
-        sampleFrames);
+    {
+      AVND_TRACE_ZONE(T, process);
+      worker.deliver(effect);
+      // The host gets the morphed values back, as they are written again at each buffer
+      if (morphing.update(effect))
+        controls.read(effect.inputs());
+      smoothing.update(effect, sampleFrames);
+      changed_controls.update(effect);
+      processor.process(
+          effect,
+          avnd::span<fp_t*>{inputs, std::size_t(this->Effect::numInputs)},
+          avnd::span<fp_t*>{outputs, std::size_t(this->Effect::numOutputs)},
+          sampleFrames);
+    }
 
     // Clear our midi inputs
     midi.clear_inputs(effect);
+
+    // The host reads initialDelay again when told that the I/O changed
+    if constexpr (avnd::dynamic_latency<T>)
+    {
+      const auto latency = int32_t(std::max(avnd::latency_samples(effect), int64_t(0)));
+      if (latency != Effect::initialDelay)
+      {
+        Effect::initialDelay = latency;
+        request(HostOpcodes::IOChanged, 0, 0, nullptr, 0.f);
+      }
+    }
   }
 
   void event_input(const vintage::Events* evs)
   {
     if constexpr (midi_input_introspection<T>::size > 0)
     {
+      AVND_TRACE_ZONE(T, midi);
       using i_info = avnd::midi_input_introspection<T>;
       auto& in_port = boost::pfr::get<i_info::index_map[0]>(effect.inputs());
 
-      // In case we need to allocate more storage:
+      // The storage was allocated in start(): hosts may send the events of a block
+      // in several calls, which all get appended.
       const int n = evs->numEvents;
-      midi.reserve_space(this->effect, n);
-
       for (int32_t i = 0; i < n; i++)
       {
         const auto* ev = evs->events[i];
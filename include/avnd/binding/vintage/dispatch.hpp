@@ -114,8 +114,9 @@ intptr_t default_dispatch(
         if (value >= 0 && value < std::ssize(effect_type::programs))
         {
           object.current_program = value;
+          // The host sees the new values at once, the processor at the next buffer
           object.controls.read(effect_type::programs[value].parameters);
-          object.controls.write(container);
+          object.program_values.select(value);
           object.request(HostOpcodes::UpdateDisplay, 0, 0, nullptr, 0.f);
         }
       }
@@ -133,7 +134,11 @@ intptr_t default_dispatch(
 
     case EffectOpcodes::SetBypass: // 44
     {
-      if constexpr (avnd::can_bypass<effect_type>)
+      if constexpr (requires { object.processor.set_bypass(true); })
+      {
+        object.processor.set_bypass(bool(value));
+      }
+      else if constexpr (avnd::can_bypass<effect_type>)
       {
         container.bypass = bool(value);
       }
@@ -274,6 +279,12 @@ intptr_t default_dispatch(
       }
       return 1;
     }
+    case EffectOpcodes::GetTailSize: // 52
+    {
+      if constexpr (requires { object.tail_samples(); })
+        return object.tail_samples();
+      return 0;
+    }
     case EffectOpcodes::GetVendorVersion: // 49
     {
       return avnd::get_int_version<effect_type>();
@@ -282,6 +293,11 @@ intptr_t default_dispatch(
       return Constants::ApiVersion;
     case EffectOpcodes::CanDo: // 51
     {
+      // The host then sends SetBypass instead of processing the output itself
+      if constexpr (requires { object.processor.set_bypass(true); })
+        if (std::string_view{reinterpret_cast<const char*>(ptr)} == "bypass")
+          return 1;
+
       if constexpr (can_event<Effect>)
       {
         static const std::array<std::string_view, 3> available{
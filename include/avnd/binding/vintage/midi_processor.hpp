@@ -6,11 +6,27 @@
 #include <avnd/concepts/all.hpp>
 #include <avnd/introspection/midi.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 namespace vintage
 {
 template <typename T>
 struct midi_processor : public avnd::midi_storage<T>
 {
+  // The API does not tell how many events a block can have at most
+  static constexpr int min_capacity = 1024;
+
+  // Messages an input port can hold per block: the ones past it are dropped
+  // instead of allocating in the audio thread.
+  int capacity{};
+
+  void reserve(avnd::effect_container<T>& t, int buffer_size)
+  {
+    capacity = std::max(buffer_size, min_capacity);
+    this->reserve_space(t, capacity);
+  }
+
   void
   init_midi_message(avnd::dynamic_midi_message auto& in, const vintage::MidiEvent& msg)
   {
@@ -38,18 +54,37 @@ struct midi_processor : public avnd::midi_storage<T>
       avnd::dynamic_container_midi_port auto& port,
       const vintage::MidiEvent& msg)
   {
+    // Fixed-capacity buses drop the message when they are full
+    const auto count = port.midi_messages.size();
+    if (count >= std::size_t(capacity))
+      return;
     port.midi_messages.push_back({});
+    if (port.midi_messages.size() == count)
+      return;
+
     auto& elt = port.midi_messages.back();
     init_midi_message(elt, msg);
+    update_expressions(port, msg);
   }
 
   void
   add_message(avnd::raw_container_midi_port auto& port, const vintage::MidiEvent& msg)
   {
+    if (port.size >= capacity)
+      return;
+
     auto& elt = port.midi_messages[port.size];
     init_midi_message(elt, msg);
+    update_expressions(port, msg);
 
     port.size++;
   }
+
+  // MPE: the channel messages also update the table of expressions of the port
+  void update_expressions(avnd::midi_port auto& port, const vintage::MidiEvent& msg)
+  {
+    if constexpr (avnd::note_expression_midi_port<std::decay_t<decltype(port)>>)
+      port.expressions.update(reinterpret_cast<const unsigned char*>(msg.midiData), 3);
+  }
 };
 }
@@ -2,8 +2,16 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
-#include <avnd/binding/vintage/helpers.hpp>
-#include <avnd/binding/vintage/vintage.hpp>
+#include <avnd/binding/vintage/audio_effect.hpp>
+#include <avnd/binding/vintage/synth_helpers.hpp>
+#include <avnd/binding/vintage/voice_pool.hpp>
+#include <avnd/wrappers/thread_pool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
 
 namespace vintage
 {
@@ -18,50 +26,230 @@ concept synth_voice = requires(T t)
   t.recycle;
 };
 
+/**
+ * Structure-of-arrays voices: a block renders "width" voices at once,
+ * each member being an array with one element per voice (lane).
+ * Only the lanes for which active[lane] is true have to be rendered.
+ */
+template <typename T>
+concept synth_voice_block = requires(T t)
+{
+  T::width;
+  t.frequency[0];
+  t.volume[0];
+  t.elapsed[0];
+  t.release_frame[0];
+  t.recycle[0];
+  t.active[0];
+  t.reset(0);
+};
+
+template <typename T>
+concept scalar_synth = requires { typename T::voice; } && synth_voice<typename T::voice>;
+
+template <typename T>
+concept simd_synth = requires
+{
+  typename T::voice_block;
+} && synth_voice_block<typename T::voice_block>;
+
+template <typename T>
+consteval int synth_polyphony()
+{
+  if constexpr (requires { T::polyphony; })
+    return T::polyphony;
+  else
+    return 128;
+}
+
+template <typename T>
+consteval voice_stealing synth_voice_stealing()
+{
+  if constexpr (requires { T::stealing; })
+    return T::stealing;
+  else
+    return voice_stealing::oldest;
+}
+
+/**
+ * Holds the DSP state of the voices, one T::voice per voice.
+ */
+template <typename T, int N>
+struct synth_voices
+{
+  static constexpr int capacity = N;
+  std::array<typename T::voice, N> voices;
+
+  void start(int i) { voices[i] = {}; }
+  void stop(int i) { }
+  void release(int i) { voices[i].release_frame = voices[i].elapsed; }
+  bool recycled(int i) const { return voices[i].recycle; }
+
+  // Gives the state of the voices of the synth to their DSP state
+  template <typename Pool>
+  void update(Pool& pool)
+  {
+    pool.for_each(
+        [&](int i, auto& v)
+        {
+          auto& dsp = voices[i];
+          dsp.frequency = v.frequency();
+          dsp.volume = v.volume();
+
+          if constexpr (requires { std::size(dsp.pan); })
+          {
+            if constexpr (std::size(decltype(dsp.pan){}) == 2)
+            {
+              dsp.pan[0] = v.pan == -1.f ? 1. : 0.;
+              dsp.pan[1] = v.pan == 1.f ? 1. : 0.;
+            }
+          }
+        });
+  }
+
+  // The voices are rendered independently of each other: the playing ones
+  template <typename Pool>
+  int groups(const Pool& pool) const noexcept
+  {
+    return pool.size();
+  }
+
+  template <typename Pool, typename sample_t>
+  void render(
+      T& impl, const Pool& pool, int first, int last, sample_t** outputs, int32_t frames)
+  {
+    for (int k = first; k < last; k++)
+      voices[pool.active(k)].process(impl, outputs, frames);
+  }
+};
+
+/**
+ * Used when the voices opt in to structure-of-arrays processing
+ * through a T::voice_block type: each process call renders a whole block.
+ */
+template <simd_synth T, int N>
+struct synth_voices<T, N>
+{
+  using block = typename T::voice_block;
+  static constexpr int width = block::width;
+  static constexpr int capacity = ((N + width - 1) / width) * width;
+
+  std::array<block, capacity / width> blocks;
+  std::array<int, capacity / width> playing{};
+
+  void start(int i)
+  {
+    auto& b = blocks[i / width];
+    const int lane = i % width;
+    if (!b.active[lane])
+      playing[i / width]++;
+    b.reset(lane);
+    b.active[lane] = true;
+  }
+
+  void stop(int i)
+  {
+    auto& b = blocks[i / width];
+    const int lane = i % width;
+    if (b.active[lane])
+      playing[i / width]--;
+    b.active[lane] = false;
+  }
+
+  void release(int i)
+  {
+    auto& b = blocks[i / width];
+    b.release_frame[i % width] = b.elapsed[i % width];
+  }
+
+  bool recycled(int i) const { return blocks[i / width].recycle[i % width]; }
+
+  template <typename Pool>
+  void update(Pool& pool)
+  {
+    pool.for_each(
+        [&](int i, auto& v)
+        {
+          auto& b = blocks[i / width];
+          const int lane = i % width;
+          b.frequency[lane] = v.frequency();
+          b.volume[lane] = v.volume();
+
+          if constexpr (requires { b.pan[1][0]; })
+          {
+            b.pan[0][lane] = v.pan == -1.f ? 1. : 0.;
+            b.pan[1][lane] = v.pan == 1.f ? 1. : 0.;
+          }
+        });
+  }
+
+  // The blocks are rendered independently of each other
+  template <typename Pool>
+  int groups(const Pool&) const noexcept
+  {
+    return int(blocks.size());
+  }
+
+  template <typename Pool, typename sample_t>
+  void render(
+      T& impl, const Pool&, int first, int last, sample_t** outputs, int32_t frames)
+  {
+    for (int k = first; k < last; k++)
+      if (playing[k] > 0)
+        blocks[k].process(impl, outputs, frames);
+  }
+};
+
+/**
+ * Synths with many voices can set T::parallel_voices to render them on
+ * several threads, see avnd::voice_parallelism: their voices then must
+ * only read the synth they are given.
+ */
+template <typename T>
+consteval bool synth_parallel_voices()
+{
+  if constexpr (requires { bool(T::parallel_voices); })
+    return T::parallel_voices;
+  else
+    return false;
+}
+
 template <typename T>
 struct PolyphonicSynthesizer : vintage::Effect
 {
   static_assert(
-      synth_voice<typename T::voice>,
+      scalar_synth<T> || simd_synth<T>,
       "T does not implement a correct synth voice system");
 
-  T implementation;
+  using effect_type = T;
+
+  // Voices are rendered in the precision the host asks for
+  static constexpr bool double_precision = true;
+
+  avnd::effect_container<T> effect;
   vintage::HostCallback master{};
 
   SynthControls<T> controls;
-  Processor<T> processor;
-  Programs<T> programs;
+
+  // Where the controls are written, see shared_controls
+  [[no_unique_address]] avnd::shared_controls<T> instance_controls;
+
+  ProcessorSetup processor;
+
+  [[no_unique_address]] programs_setup programs;
+
+  [[no_unique_address]] avnd::program_storage<T> program_values;
+
+  float sample_rate{44100.};
+  int buffer_size{512};
+  vintage::ProcessPrecision precision = vintage::ProcessPrecision::Single;
+
+  int current_program = 0;
 
   explicit PolyphonicSynthesizer(vintage::HostCallback master)
       : master{master}
   {
-    Effect::dispatcher = [](Effect* effect,
-                            int32_t opcode,
-                            int32_t index,
-                            intptr_t value,
-                            void* ptr,
-                            float opt) -> intptr_t
-    {
-      auto& self = *static_cast<PolyphonicSynthesizer*>(effect);
-      auto code = static_cast<EffectOpcodes>(opcode);
-
-      if (code == EffectOpcodes::Close)
-      {
-        delete &self;
-        return 1;
-      }
-
-      if constexpr (requires {
-                      self.implementation.dispatch(nullptr, 0, 0, 0, nullptr, 0.f);
-                    })
-      {
-        return self.implementation.dispatch(self, code, index, value, ptr, opt);
-      }
-      else
-      {
-        return default_dispatch(self, code, index, value, ptr, opt);
-      }
-    };
+    Effect::dispatcher = host_dispatcher;
 
     processor.init(*this);
     controls.init(*this);
@@ -74,15 +262,86 @@ struct PolyphonicSynthesizer : vintage::Effect
     Effect::flags = EffectFlags::CanReplacing | EffectFlags::CanDoubleReplacing
                     | EffectFlags::IsSynth;
     Effect::ioRatio = 1.;
-    Effect::object = nullptr;
-    Effect::user = nullptr;
-    Effect::uniqueID = T::unique_id;
-    Effect::version = 1;
+    Effect::object = this;
+    Effect::user = this;
+
+    if constexpr (requires { T::unique_id(); })
+      Effect::uniqueID = T::unique_id();
+    else if constexpr (requires { T::uuid(); })
+      Effect::uniqueID = hash_uuid(T::uuid());
+    else
+      Effect::uniqueID = 0xBADBAD;
+
+    if constexpr (avnd::has_version<T>)
+      Effect::version = avnd::get_int_version<T>();
+    else
+      Effect::version = 1;
+
+    sample_rate = request(HostOpcodes::GetSampleRate, 0, 0, nullptr, 0.f);
+    buffer_size = request(HostOpcodes::GetBlockSize, 0, 0, nullptr, 0.f);
+
+    if constexpr (avnd::has_inputs<T>)
+    {
+      avnd::init_controls(effect.inputs());
+      controls.read(effect.inputs());
+    }
+
+    if constexpr (synth_parallel_voices<T>())
+    {
+      if constexpr (requires { T::min_parallel_voices; })
+        parallelism.min_voices = T::min_parallel_voices;
+      threads = std::make_unique<avnd::thread_pool>();
+      set_thread_pool(threads.get());
+    }
+  }
+
+  // effMainsChanged lifecycle
+  void start()
+  {
+    avnd::process_setup setup_info{
+        .input_channels = Effect::numInputs,
+        .output_channels = Effect::numOutputs,
+        .frames_per_buffer = buffer_size,
+        .rate = sample_rate};
+
+    program_values.prepare(sample_rate);
+    avnd::prepare(effect, setup_info);
+  }
+
+  void stop() { }
 
-    controls.read(implementation);
+  // Renders the voices on the threads of executor, or only on the audio thread
+  // when it is null. Not to be called while processing.
+  void set_thread_pool(avnd::task_executor* executor)
+  {
+    parallelism.pool = executor;
+    const std::size_t samples
+        = executor ? std::size_t(executor->size()) * T::channels * scratch_frames : 0;
+    scratch_float.assign(samples, 0.f);
+    scratch_double.assign(samples, 0.);
+  }
+
+  static std::intptr_t host_dispatcher(
+      Effect* effect,
+      int32_t opcode,
+      int32_t index,
+      intptr_t value,
+      void* ptr,
+      float opt)
+  {
+    auto& self = *static_cast<PolyphonicSynthesizer*>(effect);
+    auto code = static_cast<EffectOpcodes>(opcode);
+
+    if (code == EffectOpcodes::Close)
+    {
+      delete &self;
+      return 1;
+    }
 
-    voices.reserve(127);
-    release_voices.reserve(127);
+    if constexpr (vintage::can_dispatch<T>)
+      return self.effect.effect.dispatch(self, code, index, value, ptr, opt);
+    else
+      return default_dispatch(self, code, index, value, ptr, opt);
   }
 
   intptr_t request(HostOpcodes opcode, int a, int b, void* c, float d)
@@ -90,15 +349,40 @@ struct PolyphonicSynthesizer : vintage::Effect
     return this->master(this, static_cast<int32_t>(opcode), a, b, c, d);
   }
 
+  // What the synth knows about a voice; the DSP state lives in dsp
+  struct voice
+  {
+    float note{};
+    float velocity{};
+    float detune{};
+    float bend{};
+    float pan{};
+    bool released{};
+
+    float frequency() const noexcept
+    {
+      return 440. * std::pow(2.0, (note - 69) / 12.0) + detune + bend;
+    }
+    float volume() const noexcept { return velocity / 127.; }
+  };
+
+  void start_voice(const voice& v)
+  {
+    auto [index, stolen] = voices.allocate(v, stealing);
+    if (stolen)
+      dsp.stop(index);
+    dsp.start(index);
+  }
+
   void note_on(int32_t note, int32_t velocity)
   {
-    voices.push_back({.note = float(note), .velocity = float(velocity), .detune = 0.0f});
+    start_voice({.note = float(note), .velocity = float(velocity), .detune = 0.0f});
     float unison = this->controls.unison_voices * 20.0;
     float detune = this->controls.unison_detune;
     float vol = this->controls.unison_volume;
     for (float i = -unison; i <= unison; i += 2.f)
     {
-      voices.push_back(
+      start_voice(
           {.note = float(note),
            .velocity = velocity * vol,
            .detune = i * (1.f + detune),
@@ -108,35 +392,43 @@ struct PolyphonicSynthesizer : vintage::Effect
 
   void note_off(int32_t note, int32_t velocity)
   {
-    for (auto it = voices.begin(); it != voices.end();)
-    {
-      if (it->note == note)
-      {
-        it->implementation.release_frame = it->implementation.elapsed;
-        release_voices.push_back(*it);
-        it = voices.erase(it);
-      }
-      else
-      {
-        ++it;
-      }
-    }
+    voices.for_each_of_note(
+        note,
+        [&](int i, voice& v)
+        {
+          if (!v.released)
+          {
+            v.released = true;
+            dsp.release(i);
+          }
+        });
   }
 
   void bend(int32_t bend)
   {
-    for (auto& voice : voices)
-    {
-      voice.bend = bend / 100.;
-    }
-    for (auto& voice : release_voices)
+    voices.for_each([&](int, voice& v) { v.bend = bend / 100.; });
+  }
+
+  // The events are applied by process(), at their frame: they are kept in order here
+  void midi_input(const vintage::MidiEvent& e)
+  {
+    if (pending_count == int(pending.size()))
+      return;
+
+    // Hosts send them sorted, so this is almost always the end
+    int k = pending_count;
+    while (k > 0 && pending[k - 1].deltaFrames > e.deltaFrames)
     {
-      voice.bend = bend / 100.;
+      pending[k] = pending[k - 1];
+      k--;
     }
+    pending[k] = e;
+    pending_count++;
   }
 
-  void midi_input(const vintage::MidiEvent& e)
+  void apply_midi(const vintage::MidiEvent& e)
   {
+    AVND_TRACE_ZONE(T, midi);
     switch (e.midiData[0] & 0xF0)
     {
       case 0x80: // Note off
@@ -168,84 +460,163 @@ struct PolyphonicSynthesizer : vintage::Effect
     }
   }
 
-  struct voice
-  {
-    float note{};
-    float velocity{};
-    float detune{};
-    float bend{};
-    float pan{};
-
-    typename T::voice implementation;
-
-    template <typename sample_t>
-    void process(PolyphonicSynthesizer& self, sample_t** outputs, int32_t frames)
-    {
-      implementation.frequency
-          = 440. * std::pow(2.0, (note - 69) / 12.0) + detune + bend;
-      implementation.volume = velocity / 127.;
-
-      if constexpr (std::size(decltype(implementation.pan){}) == 2)
-      {
-        implementation.pan[0] = pan == -1.f ? 1. : 0.;
-        implementation.pan[1] = pan == 1.f ? 1. : 0.;
-      }
-
-      implementation.process(self.implementation, outputs, frames);
-    }
-  };
-
   void process(
-      avnd::floating_point auto** inputs,
-      avnd::floating_point auto** outputs,
+      std::floating_point auto** inputs,
+      std::floating_point auto** outputs,
       int32_t frames)
   {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    AVND_TRACE_ZONE(T, callback);
+
     // Check if processing is to be bypassed
-    if constexpr (requires { implementation.bypass; })
+    if constexpr (avnd::can_bypass<T>)
     {
-      if (implementation.bypass)
+      if (effect.effect.bypass)
+      {
+        // The notes still have to end
+        for (int k = 0; k < pending_count; k++)
+          apply_midi(pending[k]);
+        pending_count = 0;
         return;
+      }
     }
 
     // Before processing starts, we copy all our atomics back into the struct
-    controls.write(implementation);
+    {
+      AVND_TRACE_ZONE(T, parameters);
+      controls.write(effect, instance_controls);
+      program_values.apply(effect, frames);
+      instance_controls.sync(effect);
+    }
 
     // Clear buffer
-    for (int32_t c = 0; c < implementation.channels; c++)
-      for (int32_t i = 0; i < frames; i++)
-        outputs[c][i] = 0.0;
+    for (int32_t c = 0; c < T::channels; c++)
+      std::fill_n(outputs[c], frames, 0.);
 
-    // Process voices
-    for (auto& voice : voices)
+    // Process voices, including the ones that were note'off'd
+    // in order to cleanly fade out.
+    // The buffer is split at the events so that the notes start at their exact frame.
     {
-      voice.process(*this, outputs, frames);
+      AVND_TRACE_ZONE(T, process);
+      int32_t pos = 0;
+      for (int k = 0; k < pending_count; k++)
+      {
+        const int32_t frame = std::clamp(pending[k].deltaFrames, pos, frames);
+        if (frame > pos)
+        {
+          render(outputs, pos, frame - pos);
+          pos = frame;
+        }
+        apply_midi(pending[k]);
+      }
+      pending_count = 0;
+
+      if (frames > pos)
+        render(outputs, pos, frames - pos);
     }
 
-    // Process voices that were note'off'd in order to cleanly fade out
-    for (auto it = release_voices.begin(); it != release_voices.end();)
+    // Recycle the voices which are done fading out
+    voices.for_each(
+        [&](int i, voice& v)
+        {
+          if (v.released && dsp.recycled(i))
+          {
+            dsp.stop(i);
+            voices.release(i);
+          }
+        });
+
+    // Post-processing
+    if constexpr (requires { effect.effect.process(inputs, outputs, frames); })
     {
-      auto& voice = *it;
-      voice.process(*this, outputs, frames);
-      if (voice.implementation.recycle)
-        it = release_voices.erase(it);
-      else
-        ++it;
+      effect.effect.process(inputs, outputs, frames);
     }
+  }
 
-    // Post-processing
-    if constexpr (effect_processor<float, T> || effect_processor<double, T>)
+  template <typename sample_t>
+  void render(sample_t** outputs, int32_t first, int32_t frames)
+  {
+    sample_t* part[T::channels];
+    for (int c = 0; c < T::channels; c++)
+      part[c] = outputs[c] + first;
+
+    dsp.update(voices);
+    if (const int tasks = parallelism.tasks_for(voices.size(), frames); tasks > 1)
+      render_parallel(part, frames, tasks);
+    else
+      dsp.render(effect.effect, voices, 0, dsp.groups(voices), part, frames);
+  }
+
+  // The first task renders in the output, the others in their own scratch
+  // buffer, which are summed in the output once they are all done
+  template <typename sample_t>
+  void render_parallel(sample_t** outputs, int32_t frames, int tasks)
+  {
+    sample_t* scratch = nullptr;
+    if constexpr (std::is_same_v<sample_t, float>)
+      scratch = scratch_float.data();
+    else
+      scratch = scratch_double.data();
+    const auto buffer = [=](int task, int c) {
+      return scratch + ((task - 1) * T::channels + c) * scratch_frames;
+    };
+
+    const int groups = dsp.groups(voices);
+    for (int32_t done = 0; done < frames; done += scratch_frames)
     {
-      implementation.process(inputs, outputs, frames);
+      const int32_t n = std::min(frames - done, scratch_frames);
+      parallelism.pool->run(tasks, [&](int task) {
+        const auto [first, last] = avnd::voice_parallelism::voices_of(task, tasks, groups);
+        sample_t* out[T::channels];
+        for (int c = 0; c < T::channels; c++)
+        {
+          if (task == 0)
+          {
+            out[c] = outputs[c] + done;
+          }
+          else
+          {
+            out[c] = buffer(task, c);
+            std::fill_n(out[c], n, sample_t{});
+          }
+        }
+        dsp.render(effect.effect, voices, first, last, out, n);
+      });
+
+      for (int task = 1; task < tasks; task++)
+      {
+        for (int c = 0; c < T::channels; c++)
+        {
+          const sample_t* in = buffer(task, c);
+          sample_t* out = outputs[c] + done;
+          for (int32_t i = 0; i < n; i++)
+            out[i] += in[i];
+        }
+      }
     }
   }
 
-  std::vector<voice> voices;
-  std::vector<voice> release_voices;
+  // The MIDI events received for the next buffer, sorted by frame
+  std::array<vintage::MidiEvent, 512> pending{};
+  int pending_count{};
+
+  using dsp_type = synth_voices<T, synth_polyphony<T>()>;
+  dsp_type dsp;
+  voice_pool<voice, dsp_type::capacity> voices;
+  voice_stealing stealing{synth_voice_stealing<T>()};
+
+  // Frames rendered at once by each task when the voices are split on several threads
+  static constexpr int32_t scratch_frames = 256;
+  avnd::voice_parallelism parallelism;
+  std::vector<float> scratch_float;
+  std::vector<double> scratch_double;
+  std::unique_ptr<avnd::thread_pool> threads;
 };
 }
 
 #define VINTAGE_DEFINE_SYNTH(EffectMainClass)                        \
-  extern "C" VINTAGE_EXPORTED_SYMBOL vintage::Effect* VSTPluginMain( \
+  extern "C" AVND_EXPORTED_SYMBOL vintage::Effect* VSTPluginMain(    \
       vintage::HostCallback cb)                                      \
   {                                                                  \
     return new vintage::PolyphonicSynthesizer<EffectMainClass>{cb};  \
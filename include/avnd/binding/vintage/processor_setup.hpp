@@ -9,6 +9,17 @@ namespace vintage
 
 struct ProcessorSetup
 {
+  // The double-precision callback is only set for the processors which natively
+  // support it: the host then never makes float ones go through conversions.
+  template <typename Self_T>
+  static constexpr bool double_precision() noexcept
+  {
+    if constexpr (requires { bool(Self_T::double_precision); })
+      return Self_T::double_precision;
+    else
+      return avnd::double_processor<typename Self_T::effect_type>;
+  }
+
   template <typename Self_T>
   void init(Self_T& effect)
   {
@@ -22,7 +33,7 @@ struct ProcessorSetup
       return self.process(inputs, outputs, sampleFrames);
     };
 
-    if constexpr (avnd::double_processor<T>)
+    if constexpr (double_precision<Self_T>())
     {
       effect.Effect::processDoubleReplacing
           = [](Effect* effect, double** inputs, double** outputs, int32_t sampleFrames)
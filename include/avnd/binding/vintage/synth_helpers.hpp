@@ -2,8 +2,18 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
+#include <avnd/binding/vintage/atomic_controls.hpp>
+#include <avnd/binding/vintage/helpers.hpp>
+#include <avnd/binding/vintage/vintage.hpp>
+
+#include <atomic>
+#include <cstdio>
+
 namespace vintage
 {
+/**
+ * The controls of T, followed by the unison controls of the polyphonic synth.
+ */
 template <typename T>
 struct SynthControls : Controls<T>
 {
@@ -17,14 +27,15 @@ struct SynthControls : Controls<T>
     effect.Effect::setParameter
         = [](Effect* effect, int32_t index, float parameter) noexcept
     {
-      if (index < Controls<T>::parameter_count + 3)
+      if (index >= 0 && index < Controls<T>::parameter_count + 3)
       {
         auto& self = *static_cast<Effect_T*>(effect);
 
         switch (index)
         {
           default:
-            self.controls.parameters[index].store(parameter, std::memory_order_release);
+            if constexpr (Controls<T>::parameter_count > 0)
+              self.controls.set(index, parameter);
             break;
           case Controls<T>::parameter_count:
             self.controls.unison_voices.store(parameter, std::memory_order_release);
@@ -41,14 +52,17 @@ struct SynthControls : Controls<T>
 
     effect.Effect::getParameter = [](Effect* effect, int32_t index) noexcept
     {
-      if (index < Controls<T>::parameter_count + 3)
+      if (index >= 0 && index < Controls<T>::parameter_count + 3)
       {
         auto& self = *static_cast<Effect_T*>(effect);
 
         switch (index)
         {
           default:
-            return self.controls.parameters[index].load(std::memory_order_acquire);
+            if constexpr (Controls<T>::parameter_count > 0)
+              return self.controls.parameters[index].load(std::memory_order_acquire);
+            else
+              return 0.f;
           case Controls<T>::parameter_count:
             return self.controls.unison_voices.load(std::memory_order_acquire);
           case Controls<T>::parameter_count + 1:
@@ -65,7 +79,6 @@ struct SynthControls : Controls<T>
   template <typename Effect_T>
   void label(Effect_T& effect, int index, void* ptr)
   {
-    auto& self = effect.implementation;
     switch (index)
     {
       default:
@@ -85,7 +98,6 @@ struct SynthControls : Controls<T>
   template <typename Effect_T>
   void name(Effect_T& effect, int index, void* ptr)
   {
-    auto& self = effect.implementation;
     switch (index)
     {
       default:
@@ -105,7 +117,6 @@ struct SynthControls : Controls<T>
   template <typename Effect_T>
   void display(Effect_T& effect, int index, void* ptr)
   {
-    auto& self = effect.implementation;
     switch (index)
     {
       default:
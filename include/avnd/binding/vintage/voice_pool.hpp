@@ -0,0 +1,232 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <array>
+#include <cstdint>
+
+namespace vintage
+{
+
+/**
+ * What to do when a note comes and all the voices are playing.
+ */
+enum class voice_stealing
+{
+  oldest,   // The voice which started first
+  quietest, // Released voices first, then the one with the lowest velocity
+  same_note // The oldest voice playing the same note, else the oldest one
+};
+
+/**
+ * Fixed-size set of voices: allocating and releasing a voice never allocates memory
+ * and is O(1), apart from stealing which looks through the playing voices.
+ * The playing voices are also indexed by note, so that a note off only
+ * looks at the voices of its note, see for_each_of_note.
+ *
+ * Voice must have "note", "velocity" and "released" members;
+ * the note of a voice must not change while it plays.
+ * Voices are identified by their index in [0; Capacity[, which is stable
+ * for as long as the voice plays: this allows to keep the actual DSP state
+ * out of the pool, for instance in structure-of-arrays blocks.
+ */
+template <typename Voice, int Capacity>
+class voice_pool
+{
+  static_assert(Capacity > 0 && Capacity <= 65535);
+
+public:
+  static constexpr int capacity() noexcept { return Capacity; }
+
+  voice_pool() noexcept { clear(); }
+
+  void clear() noexcept
+  {
+    for (int i = 0; i < Capacity; i++)
+      m_free[i] = uint16_t(Capacity - 1 - i);
+    m_free_count = Capacity;
+    m_active_count = 0;
+    m_note_first.fill(none);
+  }
+
+  int size() const noexcept { return m_active_count; }
+  bool empty() const noexcept { return m_active_count == 0; }
+
+  // Index of the k-th playing voice, for k in [0; size()[
+  int active(int k) const noexcept { return m_active[k]; }
+
+  Voice& operator[](int index) noexcept { return m_voices[index]; }
+  const Voice& operator[](int index) const noexcept { return m_voices[index]; }
+
+  // Returns the index of a voice to start, which is initialized with v,
+  // and whether a playing voice had to be stolen for it.
+  struct allocation
+  {
+    int index{};
+    bool stolen{};
+  };
+
+  allocation allocate(const Voice& v, voice_stealing policy) noexcept
+  {
+    allocation res;
+    if (m_free_count > 0)
+    {
+      res.index = m_free[--m_free_count];
+      m_position[res.index] = uint16_t(m_active_count);
+      m_active[m_active_count++] = uint16_t(res.index);
+    }
+    else
+    {
+      res.index = steal(v, policy);
+      res.stolen = true;
+      unlink_note(res.index);
+    }
+
+    m_voices[res.index] = v;
+    link_note(res.index);
+    m_age[res.index] = m_clock++;
+    return res;
+  }
+
+  // Puts the voice back in the free list
+  void release(int index) noexcept
+  {
+    unlink_note(index);
+
+    const int pos = m_position[index];
+    const int last = m_active[--m_active_count];
+    m_active[pos] = uint16_t(last);
+    m_position[last] = uint16_t(pos);
+
+    m_free[m_free_count++] = uint16_t(index);
+  }
+
+  // Calls f(index, voice) for each playing voice.
+  // f may release the voice it is called with.
+  template <typename F>
+  void for_each(F&& f) noexcept(noexcept(f(0, m_voices[0])))
+  {
+    // Releasing swaps the last voice in the current slot, which was
+    // already visited since we go backwards
+    for (int i = m_active_count - 1; i >= 0; i--)
+    {
+      const int index = m_active[i];
+      f(index, m_voices[index]);
+    }
+  }
+
+  // Calls f(index, voice) for each playing voice of the given note.
+  // f may release the voice it is called with.
+  template <typename F>
+  void for_each_of_note(int note, F&& f) noexcept(noexcept(f(0, m_voices[0])))
+  {
+    for (uint16_t index = m_note_first[note & 127]; index != none;)
+    {
+      const uint16_t next = m_note_next[index];
+      f(int(index), m_voices[index]);
+      index = next;
+    }
+  }
+
+private:
+  int steal(const Voice& v, voice_stealing policy) const noexcept
+  {
+    // The voices of the same note are at hand
+    if (policy == voice_stealing::same_note)
+    {
+      if (uint16_t index = m_note_first[key(v)]; index != none)
+      {
+        int best = index;
+        for (index = m_note_next[index]; index != none; index = m_note_next[index])
+          if (m_age[index] < m_age[best])
+            best = index;
+        return best;
+      }
+    }
+
+    int best = m_active[0];
+    for (int i = 1; i < m_active_count; i++)
+    {
+      const int cur = m_active[i];
+      if (better_victim(cur, best, v, policy))
+        best = cur;
+    }
+    return best;
+  }
+
+  bool better_victim(int cur, int best, const Voice& v, voice_stealing policy)
+      const noexcept
+  {
+    const Voice& c = m_voices[cur];
+    const Voice& b = m_voices[best];
+    switch (policy)
+    {
+      case voice_stealing::quietest:
+        if (c.released != b.released)
+          return c.released;
+        if (c.velocity != b.velocity)
+          return c.velocity < b.velocity;
+        break;
+
+      case voice_stealing::same_note:
+      {
+        const bool cs = c.note == v.note;
+        const bool bs = b.note == v.note;
+        if (cs != bs)
+          return cs;
+        break;
+      }
+
+      case voice_stealing::oldest:
+        break;
+    }
+    return m_age[cur] < m_age[best];
+  }
+
+  static constexpr uint16_t none = 0xFFFF;
+
+  static int key(const Voice& v) noexcept { return int(v.note) & 127; }
+
+  void link_note(int index) noexcept
+  {
+    const int k = key(m_voices[index]);
+    const uint16_t first = m_note_first[k];
+    m_note_prev[index] = none;
+    m_note_next[index] = first;
+    if (first != none)
+      m_note_prev[first] = uint16_t(index);
+    m_note_first[k] = uint16_t(index);
+  }
+
+  void unlink_note(int index) noexcept
+  {
+    const uint16_t prev = m_note_prev[index];
+    const uint16_t next = m_note_next[index];
+    if (prev != none)
+      m_note_next[prev] = next;
+    else
+      m_note_first[key(m_voices[index])] = next;
+    if (next != none)
+      m_note_prev[next] = prev;
+  }
+
+  std::array<Voice, Capacity> m_voices{};
+  std::array<uint64_t, Capacity> m_age{};
+
+  // Playing voices, and the position of each voice in that list
+  std::array<uint16_t, Capacity> m_active{};
+  std::array<uint16_t, Capacity> m_position{};
+  int m_active_count{};
+
+  std::array<uint16_t, Capacity> m_free{};
+  int m_free_count{};
+
+  // Playing voices of each note, as doubly-linked lists
+  std::array<uint16_t, 128> m_note_first{};
+  std::array<uint16_t, Capacity> m_note_next{};
+  std::array<uint16_t, Capacity> m_note_prev{};
+
+  uint64_t m_clock{};
+};
+
+}
@@ -4,6 +4,7 @@
 
 #include <avnd/binding/vst3/helpers.hpp>
 #include <avnd/binding/vst3/metadata.hpp>
+#include <avnd/concepts/audio_port.hpp>
 #include <avnd/introspection/channels.hpp>
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/output.hpp>
@@ -565,6 +566,16 @@ struct audio_bus_info<T>
       setStr(info.name, u16 "Stereo In");
       info.busType = Steinberg::Vst::BusTypes::kMain;
 
+      // Optional busses, e.g. side-chains, are only active when the host connects them
+      input_refl::for_nth_mapped(index, [&]<typename F>(F) {
+        if constexpr (avnd::optional_audio_port<typename F::type>)
+        {
+          setStr(info.name, u16 "Aux In");
+          info.busType = Steinberg::Vst::BusTypes::kAux;
+          info.flags = 0;
+        }
+      });
+
       return Steinberg::kResultTrue;
     }
 
@@ -653,8 +664,9 @@ struct audio_bus_info<T>
     return Steinberg::kInvalidArgument;
   }
 
-  bool inputActive[std::max(inputCount(), 1)];
-  bool outputActive[std::max(outputCount(), 1)];
+  // Only read for the optional busses, which the host has to activate
+  bool inputActive[std::max(inputCount(), 1)]{};
+  bool outputActive[std::max(outputCount(), 1)]{};
 
   int runtime_input_channel_count = defaultInputChannelCount();
   int runtime_output_channel_count = defaultOutputChannelCount();
@@ -9,8 +9,30 @@
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/midi.hpp>
 #include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/bypass.hpp>
+#include <avnd/wrappers/changed_controls.hpp>
 #include <avnd/wrappers/controls.hpp>
-#include <avnd/wrappers/process_adapter.hpp>
+#include <avnd/wrappers/controls_storage.hpp>
+#include <avnd/wrappers/deadline.hpp>
+#include <avnd/wrappers/denormals.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/message_bus.hpp>
+#include <avnd/wrappers/morph.hpp>
+#include <avnd/wrappers/output_parameters.hpp>
+#include <avnd/wrappers/latency.hpp>
+#include <avnd/wrappers/optional_busses.hpp>
+#include <avnd/wrappers/quality_governor.hpp>
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+#include <avnd/wrappers/silence.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
+#include <avnd/wrappers/smoothing_storage.hpp>
+#include <avnd/wrappers/sub_block_scheduler.hpp>
+#include <avnd/wrappers/tracing.hpp>
+#include <avnd/wrappers/worker.hpp>
+#include <pluginterfaces/vst/ivstmidicontrollers.h>
+
+#include <algorithm>
+#include <array>
 
 namespace stv3
 {
@@ -72,10 +94,22 @@ struct Component final
 
   avnd::effect_container<T> effect;
 
-  [[no_unique_address]] avnd::process_adapter<T> processor;
+  avnd::bypass_adapter<T> processor;
 
   [[no_unique_address]] avnd::midi_storage<T> midi;
 
+  [[no_unique_address]] avnd::control_storage<T> control_buffers;
+
+  [[no_unique_address]] avnd::shared_controls<T> controls;
+
+  [[no_unique_address]] avnd::smoothing_storage<T> smoothing;
+
+  [[no_unique_address]] avnd::changed_controls_storage<T> changed_controls;
+
+  [[no_unique_address]] avnd::morph_storage<T> morphing;
+  [[no_unique_address]] avnd::worker_storage<T> worker;
+  [[no_unique_address]] avnd::message_bus_storage<T> messages;
+
   [[no_unique_address]] stv3::audio_bus_info<T> audio_busses;
 
   [[no_unique_address]] stv3::event_bus_info<T> event_busses;
@@ -83,6 +117,50 @@ struct Component final
   using inputs_info_t = avnd::parameter_input_introspection<T>;
   static const constexpr int32_t parameter_count = inputs_info_t::size;
 
+  struct automation_point
+  {
+    ParamID id{};
+    ParamValue value{};
+  };
+
+  // Processors without sample-accurate inputs get their buffers split at automation points.
+  // Otherwise, this only holds the values of the sample-accurate inputs at the end of the buffer.
+  avnd::sub_block_scheduler<automation_point> automation;
+
+  // Lets processors with a tail skip the buffers flagged as silent by the host
+  avnd::silence_tracker silence;
+  bool received_notes{};
+
+  // The note expressions only give the id of their note: the last ones
+  // received with the notes, for the ports with a table of expressions
+  struct note_id
+  {
+    int32_t id{-1};
+    int16_t channel{};
+    int16_t pitch{};
+  };
+  std::array<note_id, 128> note_ids{};
+  int next_note_id{};
+
+  // Callbacks over their time budget, when built with AVND_DEADLINE_MONITOR
+  [[no_unique_address]] avnd::deadline_monitor deadlines{avnd::get_name<T>()};
+
+  // Lowers the quality of the processors which have levels when the buffers take too long
+  [[no_unique_address]] avnd::quality_governor<T> governor;
+
+  // The setup of the last prepare, to tell the processor what changed in the next one
+  avnd::process_setup current_setup{};
+
+  // The latency the host was last told, for the ones which change at run-time
+  int64_t reported_latency{};
+  int latency_changes{};
+
+  // Kept from one save to the next to not reallocate
+  std::vector<char> state_buffer;
+
+  // Changes of the output parameters, sent to the host through outputParameterChanges
+  [[no_unique_address]] avnd::output_parameter_reporter<T> output_params;
+
   Component()
   {
     using namespace Steinberg::Vst;
@@ -93,10 +171,9 @@ struct Component final
     processSetup.sampleRate = 44100.0;
     processSetup.symbolicSampleSize = kSample32;
 
-    // Setup modules
-    effect.init_channels(
-        audio_busses.defaultInputChannelCount(),
-        audio_busses.defaultOutputChannelCount());
+    // Only the parameters until the host sets up the processing: a duplicated
+    // processor keeps a single instance, which holds the controls
+    effect.init_channels(1, 1);
 
     /// Read the initial state of the controls
 
@@ -297,6 +374,16 @@ struct Component final
     processSetup.sampleRate = newSetup.sampleRate;
     processSetup.symbolicSampleSize = newSetup.symbolicSampleSize;
 
+    prepare_processing();
+    return kResultOk;
+  }
+
+  // Allocates buffers and prepares the processor for processSetup
+  void prepare_processing()
+  {
+    using namespace Steinberg;
+    const ProcessSetup& newSetup = processSetup;
+
     /// TODO ///
     // this part can be refactored with vintage
 
@@ -305,12 +392,16 @@ struct Component final
         .input_channels = audio_busses.runtime_input_channel_count,
         .output_channels = audio_busses.runtime_output_channel_count,
         .frames_per_buffer = newSetup.maxSamplesPerBlock,
-        .rate = newSetup.sampleRate};
-
-    // Setup buffers for eventual float <-> double conversion
-    // We always do so for float, as the plug-in API requires the existence of this
-    processor.allocate_buffers(setup_info, float{});
-    processor.allocate_buffers(setup_info, double{});
+        .rate = newSetup.sampleRate,
+        .mode = newSetup.processMode == Vst::kOffline ? avnd::render_mode::offline
+                                                      : avnd::render_mode::realtime};
+
+    // Setup buffers for eventual float <-> double conversion:
+    // the host processes in the precision negotiated here until the next setup
+    if (newSetup.symbolicSampleSize == Vst::kSample64)
+      processor.allocate_buffers(setup_info, double{});
+    else
+      processor.allocate_buffers(setup_info, float{});
 
     effect.init_channels(
         audio_busses.runtime_input_channel_count,
@@ -325,9 +416,46 @@ struct Component final
       midi.reserve_space(this->effect, newSetup.maxSamplesPerBlock);
     }
 
-    // Effect-specific preparation
-    avnd::prepare(effect, setup_info);
-    return kResultOk;
+    // Setup buffers for sample-accurate controls
+    control_buffers.reserve_space(this->effect, newSetup.maxSamplesPerBlock);
+    automation.reserve(parameter_count * 16);
+    automation.set_granularity(avnd::control_granularity<T>());
+    smoothing.prepare(this->effect, newSetup.sampleRate, newSetup.maxSamplesPerBlock);
+    worker.start(this->effect);
+    messages.start(this->effect);
+    silence.prepare(newSetup.sampleRate);
+    deadlines.prepare(newSetup.sampleRate);
+    governor.prepare(newSetup.sampleRate, setup_info.mode);
+    output_params.prepare(newSetup.sampleRate);
+
+    // Effect-specific preparation: the buffers of the binding were freed when
+    // deactivating, but the processor keeps what does not depend on what changed
+    avnd::reconfigure(effect, current_setup, setup_info);
+    processor.reserve_delay(avnd::latency_samples(effect));
+
+    // The host asks for the latency once set up
+    if constexpr (avnd::dynamic_latency<T>)
+      reported_latency = avnd::latency_samples(effect);
+    prepared = true;
+  }
+
+  // Frees what prepare_processing allocated: a deactivated instance only keeps
+  // its parameters, e.g. on a disabled track, until it is activated again.
+  void release_processing()
+  {
+    processor.release_buffers();
+    midi.release(this->effect);
+    control_buffers.release(this->effect);
+    automation.release();
+    avnd::release_channels(this->effect);
+    prepared = false;
+  }
+
+  void setParameter(ParamID id, ParamValue value)
+  {
+    controls.write_raw(effect, id, [&]<typename C>(C& ctl) {
+      ctl.value = avnd::map_control_from_01<C>(value);
+    });
   }
 
   void processControl(IParamValueQueue& queue)
@@ -337,13 +465,61 @@ struct Component final
     int32 numPoints = queue.getPointCount();
 
     int id = queue.getParameterId();
-    if (queue.getPoint(numPoints - 1, sampleOffset, value) == Steinberg::kResultTrue)
+    if (ParamID(id) == avnd::bypass_parameter_id)
     {
-      avnd::parameter_input_introspection<T>::for_nth_raw(
-          effect.inputs(),
-          id,
-          [&]<typename C>(C& ctl) { ctl.value = avnd::map_control_from_01<C>(value); });
-    };
+      // Crossfaded by the adapter: the last point is enough
+      if (queue.getPoint(numPoints - 1, sampleOffset, value) == Steinberg::kResultTrue)
+        processor.set_bypass(value >= 0.5);
+      return;
+    }
+
+    if constexpr (avnd::splits_on_control_changes<T>)
+    {
+      // Applied while processing the audio, see processAudio
+      for (int32 p = 0; p < numPoints; p++)
+      {
+        if (queue.getPoint(p, sampleOffset, value) == Steinberg::kResultTrue)
+          automation.push(sampleOffset, {ParamID(id), value});
+      }
+    }
+    else
+    {
+      // Sample-accurate inputs get every point
+      bool timed = false;
+      if constexpr (avnd::control_storage<T>::has_timed_inputs)
+      {
+        for (int32 p = 0; p < numPoints; p++)
+        {
+          if (queue.getPoint(p, sampleOffset, value) == Steinberg::kResultTrue)
+          {
+            timed |= control_buffers.push_input(
+                effect, id, sampleOffset, [&]<typename C>(C&) {
+                  return avnd::map_control_from_01<C>(value);
+                });
+          }
+        }
+      }
+
+      if (queue.getPoint(numPoints - 1, sampleOffset, value) == Steinberg::kResultTrue)
+      {
+        if (timed)
+        {
+          // For sample-accurate inputs, value is the one at the beginning of the buffer:
+          // the last point is only applied once the buffer is processed
+          automation.push(0, {ParamID(id), value});
+
+          ParamValue first_value;
+          if (queue.getPoint(0, sampleOffset, first_value) == Steinberg::kResultTrue
+              && sampleOffset <= 0)
+            setParameter(id, first_value);
+        }
+        else
+        {
+          // The value for the whole buffer is the last one
+          setParameter(id, value);
+        }
+      }
+    }
   }
 
   void processControls(ProcessData& data)
@@ -353,6 +529,7 @@ struct Component final
 
     if (auto paramChanges = data.inputParameterChanges)
     {
+      AVND_TRACE_ZONE(T, parameters);
       int32 numParamsChanged = paramChanges->getParameterCount();
       // for each parameter which are some changes in this audio block:
       for (int32 i = 0; i < numParamsChanged; i++)
@@ -372,6 +549,11 @@ struct Component final
     {
       bus.midi_messages.push_back({.bytes = {a, b, c}, .timestamp = ts});
     }
+    if constexpr (avnd::note_expression_midi_port<Bus>)
+    {
+      const uint8_t bytes[3]{a, b, c};
+      bus.expressions.update(bytes, 3);
+    }
     else
     {
       //AVND_STATIC_TODO(Bus);
@@ -382,6 +564,62 @@ struct Component final
   processEvent(avnd::midi_port auto& bus, const Steinberg::Vst::NoteOnEvent& ev, auto ts)
   {
     add_message(bus, ev.channel | 0x90, ev.pitch, ev.velocity * 127, ts);
+    if (ev.noteId >= 0)
+      note_ids[next_note_id++ % note_ids.size()]
+          = {ev.noteId, int16_t(ev.channel), int16_t(ev.pitch)};
+  }
+
+  void processEvent(
+      avnd::midi_port auto& bus,
+      const Steinberg::Vst::PolyPressureEvent& ev,
+      auto ts)
+  {
+    if constexpr (avnd::note_expression_midi_port<std::decay_t<decltype(bus)>>)
+      bus.expressions.set(ev.channel, ev.pitch, avnd::note_expression::pressure, ev.pressure);
+  }
+
+  void processEvent(
+      avnd::midi_port auto& bus,
+      const Steinberg::Vst::NoteExpressionValueEvent& ev,
+      auto ts)
+  {
+    using namespace Steinberg::Vst;
+    if constexpr (avnd::note_expression_midi_port<std::decay_t<decltype(bus)>>)
+    {
+      auto it = std::find_if(note_ids.begin(), note_ids.end(), [&](const note_id& n) {
+        return n.id == ev.noteId;
+      });
+      if (it == note_ids.end())
+        return;
+
+      // The values are normalized
+      using expr = avnd::note_expression;
+      const double v = ev.value;
+      auto set = [&](expr e, double value) { bus.expressions.set(it->channel, it->pitch, e, value); };
+      switch (ev.typeId)
+      {
+        case kVolumeTypeID:
+          set(expr::volume, 4. * v);
+          break;
+        case kPanTypeID:
+          set(expr::pan, v);
+          break;
+        case kTuningTypeID:
+          set(expr::tuning, 240. * (v - 0.5));
+          break;
+        case kVibratoTypeID:
+          set(expr::vibrato, v);
+          break;
+        case kExpressionTypeID:
+          set(expr::expression, v);
+          break;
+        case kBrightnessTypeID:
+          set(expr::brightness, v);
+          break;
+        default:
+          break;
+      }
+    }
   }
 
   void processEvent(
@@ -392,6 +630,22 @@ struct Component final
     add_message(bus, ev.channel | 0x80, ev.pitch, ev.velocity * 127, ts);
   }
 
+  // The bytes of the event are valid until the end of the process call
+  void processEvent(
+      avnd::midi_port auto& bus,
+      const Steinberg::Vst::DataEvent& ev,
+      auto ts)
+  {
+    using bus_type = std::decay_t<decltype(bus)>;
+    if (ev.type != Steinberg::Vst::DataEvent::kMidiSysEx)
+      return;
+
+    if constexpr (avnd::sysex_view_midi_port<bus_type>)
+      bus.sysex.push_view(ev.bytes, ev.size, ts);
+    else if constexpr (avnd::sysex_midi_port<bus_type>)
+      bus.sysex.push(ev.bytes, ev.size, ts);
+  }
+
   void processEvent(Event& event)
   {
     using refl = avnd::midi_input_introspection<T>;
@@ -401,6 +655,7 @@ struct Component final
     {
       case Event::kNoteOnEvent:
       {
+        received_notes = true;
         refl::for_nth_mapped(
             this->effect.inputs(),
             event.busIndex,
@@ -410,6 +665,7 @@ struct Component final
       }
       case Event::kNoteOffEvent:
       {
+        received_notes = true;
         refl::for_nth_mapped(
             this->effect.inputs(),
             event.busIndex,
@@ -419,17 +675,29 @@ struct Component final
       }
       case Event::kDataEvent:
       {
-        auto& e = event.data;
+        refl::for_nth_mapped(
+            this->effect.inputs(),
+            event.busIndex,
+            [&](auto& bus)
+            { this->processEvent(bus, event.data, event.sampleOffset); });
         break;
       }
       case Event::kPolyPressureEvent:
       {
-        auto& e = event.polyPressure;
+        refl::for_nth_mapped(
+            this->effect.inputs(),
+            event.busIndex,
+            [&](auto& bus)
+            { this->processEvent(bus, event.polyPressure, event.sampleOffset); });
         break;
       }
       case Event::kNoteExpressionValueEvent:
       {
-        auto& e = event.noteExpressionValue;
+        refl::for_nth_mapped(
+            this->effect.inputs(),
+            event.busIndex,
+            [&](auto& bus)
+            { this->processEvent(bus, event.noteExpressionValue, event.sampleOffset); });
         break;
       }
       case Event::kNoteExpressionTextEvent:
@@ -462,6 +730,7 @@ struct Component final
 
     if (data.inputEvents)
     {
+      AVND_TRACE_ZONE(T, events);
       const int32 numEvent = data.inputEvents->getEventCount();
       for (int32 i = 0; i < numEvent; i++)
       {
@@ -474,6 +743,161 @@ struct Component final
     }
   }
 
+  // The channels of all the busses one after the other, as the process adapters expect them.
+  // An optional bus which the host did not activate keeps its place with null channels,
+  // which the processor does not get; a missing bus of any other kind gets silent ones.
+  template <typename FP, bool Input>
+  avnd::span<FP*> busChannels(AudioBusBuffers* busses, int32 count, FP** storage)
+  {
+    std::size_t k = 0;
+    for (int32 b = 0; b < count; b++)
+    {
+      auto& bus = busses[b];
+      auto channels = (FP**)stv3::getChannelBuffersPointer(processSetup, bus);
+      const bool active
+          = Input ? audio_busses.inputActive[b] : audio_busses.outputActive[b];
+      const bool optional
+          = Input ? avnd::set_input_bus_connected(effect, b, channels && active)
+                  : avnd::set_output_bus_connected(effect, b, channels && active);
+
+      const bool connected = channels && (active || !optional);
+      if (!connected && !optional)
+        break;
+      for (int32 c = 0; c < bus.numChannels; c++)
+        storage[k++] = connected ? channels[c] : nullptr;
+    }
+    return {storage, k};
+  }
+
+  static std::size_t totalChannels(AudioBusBuffers* busses, int32 count) noexcept
+  {
+    std::size_t n = 0;
+    for (int32 b = 0; b < count; b++)
+      n += std::max(busses[b].numChannels, int32(0));
+    return n;
+  }
+
+  template <typename FP>
+  void processAudio(ProcessData& data, int32 first, int32 frames)
+  {
+    avnd::span<FP*> in{
+        (FP**)stv3::getChannelBuffersPointer(processSetup, data.inputs[0]),
+        std::size_t(data.inputs[0].numChannels)};
+    avnd::span<FP*> out{
+        (FP**)stv3::getChannelBuffersPointer(processSetup, data.outputs[0]),
+        std::size_t(data.outputs[0].numChannels)};
+
+    if constexpr (avnd::bus_port_processor<T>)
+    {
+      const int32 inputs = std::min(data.numInputs, int32(audio_busses.inputCount()));
+      const int32 outputs = std::min(data.numOutputs, int32(audio_busses.outputCount()));
+      if (inputs > 1)
+        in = busChannels<FP, true>(
+            data.inputs, inputs,
+            (FP**)alloca(sizeof(FP*) * totalChannels(data.inputs, inputs)));
+      if (outputs > 1)
+        out = busChannels<FP, false>(
+            data.outputs, outputs,
+            (FP**)alloca(sizeof(FP*) * totalChannels(data.outputs, outputs)));
+    }
+
+    if (first > 0)
+    {
+      in = avnd::sub_block_channels(in, first, (FP**)alloca(sizeof(FP*) * in.size()));
+      out = avnd::sub_block_channels(out, first, (FP**)alloca(sizeof(FP*) * out.size()));
+    }
+
+    {
+      AVND_TRACE_ZONE(T, process);
+      controls.sync(effect);
+      worker.deliver(effect);
+      messages.deliver(effect);
+      morphing.update(effect);
+      smoothing.update(effect, frames);
+      changed_controls.update(effect);
+      processor.process(effect, in, out, frames);
+    }
+
+    processMidiOutputs(data, first);
+
+    // The outputs have their value at the end of the sub-block
+    processOutputParameters(data, first + frames - 1, frames);
+  }
+
+  void processOutputParameters(ProcessData& data, int32 offset, int32 frames)
+  {
+    if constexpr (avnd::parameter_output_introspection<T>::size > 0)
+    {
+      auto changes = data.outputParameterChanges;
+      if (!changes)
+        return;
+
+      AVND_TRACE_ZONE(T, controls);
+      output_params.report(effect, frames, [&]<typename C>(const C& field, int index) {
+        int32 queue_index = 0;
+        if (auto queue = changes->addParameterData(
+                avnd::output_parameter_id_bit | index, queue_index))
+        {
+          int32 point_index = 0;
+          queue->addPoint(
+              std::max(offset, int32(0)), avnd::map_control_to_01(field), point_index);
+        }
+      });
+    }
+  }
+
+  void processAudio(ProcessData& data, int32 first, int32 frames)
+  {
+    using namespace Steinberg::Vst;
+    if (data.symbolicSampleSize == kSample32)
+      processAudio<Sample32>(data, first, frames);
+    else
+      processAudio<Sample64>(data, first, frames);
+  }
+
+  static uint64 channels_mask(int32 channels) noexcept
+  {
+    return channels >= 64 ? ~uint64(0) : channels > 0 ? (uint64(1) << channels) - 1 : 0;
+  }
+
+  template <typename FP>
+  void clearOutputs(ProcessData& data, int32 channels)
+  {
+    auto out = (FP**)stv3::getChannelBuffersPointer(processSetup, data.outputs[0]);
+    for (int32 c = 0; c < channels; c++)
+      std::fill_n(out[c], data.numSamples, FP(0));
+  }
+
+  void clearOutputs(ProcessData& data)
+  {
+    using namespace Steinberg::Vst;
+    if (data.symbolicSampleSize == kSample32)
+      clearOutputs<Sample32>(data, data.outputs[0].numChannels);
+    else
+      clearOutputs<Sample64>(data, data.outputs[0].numChannels);
+  }
+
+  template <typename FP>
+  uint64 silentOutputs(ProcessData& data, int32 channels)
+  {
+    auto out = (FP**)stv3::getChannelBuffersPointer(processSetup, data.outputs[0]);
+    uint64 flags = 0;
+    for (int32 c = 0; c < std::min(channels, int32(64)); c++)
+      if (avnd::is_silent(out[c], data.numSamples))
+        flags |= uint64(1) << c;
+    return flags;
+  }
+
+  // Lets the host and the following plug-ins skip the silent channels
+  uint64 silentOutputs(ProcessData& data)
+  {
+    using namespace Steinberg::Vst;
+    if (data.symbolicSampleSize == kSample32)
+      return silentOutputs<Sample32>(data, data.outputs[0].numChannels);
+    else
+      return silentOutputs<Sample64>(data, data.outputs[0].numChannels);
+  }
+
   void processAudio(ProcessData& data)
   {
     using namespace Steinberg;
@@ -481,27 +905,128 @@ struct Component final
 
     // FIXME handle multiple busses !
 
-    auto in = stv3::getChannelBuffersPointer(processSetup, data.inputs[0]);
-    auto out = stv3::getChannelBuffersPointer(processSetup, data.outputs[0]);
+    // Processors whose output is silent once their tail is over do not have to run
+    const uint64 input_silence = data.inputs[0].silenceFlags;
+    avnd::set_input_silence(effect, input_silence);
+    if constexpr (avnd::has_tail<T>)
+    {
+      const uint64 all = channels_mask(data.inputs[0].numChannels);
+      silence.advance(
+          !received_notes && all != 0 && (input_silence & all) == all,
+          data.numSamples,
+          avnd::tail_seconds(effect));
+    }
+    received_notes = false;
 
-    data.outputs[0].silenceFlags = 0;
-    if (data.symbolicSampleSize == kSample32)
+    if (silence.asleep())
+    {
+      clearOutputs(data);
+      data.outputs[0].silenceFlags = channels_mask(data.outputs[0].numChannels);
+      return;
+    }
+
+    if constexpr (avnd::splits_on_control_changes<T>)
     {
-      processor.process(
-          effect,
-          avnd::span<Sample32*>{(Sample32**)in, std::size_t(data.inputs[0].numChannels)},
-          avnd::span<Sample32*>{
-              (Sample32**)out, std::size_t(data.outputs[0].numChannels)},
-          data.numSamples);
+      // Process the sub-blocks between automation points
+      automation.run(
+          data.numSamples,
+          [this](const automation_point& pt) { setParameter(pt.id, pt.value); },
+          [this, &data](int32 first, int32 frames) { processAudio(data, first, frames); });
     }
     else
     {
-      processor.process(
-          effect,
-          avnd::span<Sample64*>{(Sample64**)in, std::size_t(data.inputs[0].numChannels)},
-          avnd::span<Sample64*>{
-              (Sample64**)out, std::size_t(data.outputs[0].numChannels)},
-          data.numSamples);
+      processAudio(data, 0, data.numSamples);
+    }
+
+    data.outputs[0].silenceFlags = silentOutputs(data);
+  }
+
+  // The messages of all the MIDI outputs go to the host in a single pass, sorted by time:
+  // addEvent copies each of them in the list of the host
+  void processMidiOutputs(ProcessData& data, int32 first)
+  {
+    if constexpr (avnd::midi_output_introspection<T>::size > 0)
+    {
+      if (!data.outputEvents)
+        return;
+
+      AVND_TRACE_ZONE(T, midi);
+      int32 last = 0;
+      midi.for_each_output_in_order(
+          effect, [&](avnd::span<const unsigned char> bytes, int32_t timestamp, int port) {
+        if (bytes.empty())
+          return;
+
+        // The host wants the events in order, even if a processor wrote them otherwise
+        last = std::max(last, std::max(first + timestamp, int32(0)));
+
+        Event e{};
+        e.busIndex = port;
+        e.sampleOffset = last;
+        if (toEvent(bytes, e))
+          data.outputEvents->addEvent(e);
+      });
+
+      // A processor split in sub-blocks writes its messages again for the next one
+      midi.clear_outputs(effect);
+    }
+  }
+
+  static bool toEvent(avnd::span<const unsigned char> bytes, Event& e) noexcept
+  {
+    using namespace Steinberg::Vst;
+    const auto byte = [&](std::size_t i) -> uint8 {
+      return i < bytes.size() ? bytes[i] & 0x7F : 0;
+    };
+    const int16 channel = bytes[0] & 0x0F;
+    auto cc = [&](uint8 control, uint8 value, uint8 value2 = 0) {
+      e.type = Event::kLegacyMIDICCOutEvent;
+      e.midiCCOut.controlNumber = control;
+      e.midiCCOut.channel = int8(channel);
+      e.midiCCOut.value = int8(value);
+      e.midiCCOut.value2 = int8(value2);
+      return true;
+    };
+
+    switch (bytes[0] & 0xF0)
+    {
+      case 0x80:
+        e.type = Event::kNoteOffEvent;
+        e.noteOff.channel = channel;
+        e.noteOff.pitch = byte(1);
+        e.noteOff.velocity = byte(2) / 127.f;
+        e.noteOff.noteId = -1;
+        return true;
+      case 0x90:
+        e.type = Event::kNoteOnEvent;
+        e.noteOn.channel = channel;
+        e.noteOn.pitch = byte(1);
+        e.noteOn.velocity = byte(2) / 127.f;
+        e.noteOn.noteId = -1;
+        return true;
+      case 0xA0:
+        e.type = Event::kPolyPressureEvent;
+        e.polyPressure.channel = channel;
+        e.polyPressure.pitch = byte(1);
+        e.polyPressure.pressure = byte(2) / 127.f;
+        e.polyPressure.noteId = -1;
+        return true;
+      case 0xB0:
+        return cc(byte(1), byte(2));
+      case 0xC0:
+        return cc(kCtrlProgramChange, byte(1));
+      case 0xD0:
+        return cc(kAfterTouch, byte(1));
+      case 0xE0:
+        return cc(kPitchBend, byte(1), byte(2));
+      default:
+        if (bytes[0] != 0xF0)
+          return false;
+        e.type = Event::kDataEvent;
+        e.data.size = uint32(bytes.size());
+        e.data.type = DataEvent::kMidiSysEx;
+        e.data.bytes = bytes.data();
+        return true;
     }
   }
 
@@ -512,16 +1037,46 @@ struct Component final
     // TODO
   }
 
+  // The controller gets the change, and asks the host to restart the component,
+  // which then reads the new latency
+  void processLatency(ProcessData& data)
+  {
+    if constexpr (avnd::dynamic_latency<T>)
+    {
+      const int64_t latency = avnd::latency_samples(effect);
+      if (latency == reported_latency || !data.outputParameterChanges)
+        return;
+
+      int32 queue_index = 0;
+      if (auto queue = data.outputParameterChanges->addParameterData(
+              stv3::latency_parameter_id, queue_index))
+      {
+        int32 point_index = 0;
+        reported_latency = latency;
+        latency_changes++;
+        queue->addPoint(0, latency_changes % 2, point_index);
+      }
+    }
+  }
+
   tresult process(ProcessData& data) override
   {
+    [[maybe_unused]] avnd::denormals_guard<T> denormals;
+    [[maybe_unused]] avnd::realtime_scope realtime;
+    [[maybe_unused]] avnd::deadline_scope deadline{deadlines, data.numSamples};
+    [[maybe_unused]] avnd::quality_scope<T> quality{governor, data.numSamples};
+    AVND_TRACE_ZONE(T, callback);
+
     using namespace Steinberg;
     using namespace Steinberg::Vst;
 
     // Clear outputs
     this->midi.clear_outputs(effect);
+    governor.apply(effect);
 
     processControls(data);
     processEvents(data);
+    this->midi.merge_inputs(effect);
 
     if (data.numInputs != 0 && data.numOutputs != 0)
     {
@@ -529,8 +1084,16 @@ struct Component final
       processOutputs(data);
     }
 
+    // Make sure the controls end up with their last value,
+    // e.g. if there was no audio to process
+    automation.flush([this](const automation_point& pt) { setParameter(pt.id, pt.value); });
+    controls.sync(effect);
+
+    processLatency(data);
+
     // Clear inputs
     this->midi.clear_inputs(effect);
+    this->control_buffers.clear_inputs(effect);
 
     return kResultOk;
   }
@@ -544,9 +1107,17 @@ struct Component final
     using namespace Steinberg;
     // called when we load a preset, the model has to be reloaded
 
-    IBStreamer streamer(state, kLittleEndian);
     if constexpr (avnd::has_inputs<T>)
     {
+      if (stv3::readState(state, state_buffer))
+      {
+        const bool ok = avnd::load_state<T>(
+            this->effect.inputs(), state_buffer.data(), state_buffer.size());
+        return ok ? Steinberg::kResultOk : Steinberg::kResultFalse;
+      }
+
+      // Older states: the normalized values of the parameters, one after the other
+      IBStreamer streamer(state, kLittleEndian);
       bool ok = inputs_info_t::for_all_unless(
           this->effect.inputs(),
           [&]<typename C>(C& field) -> bool
@@ -570,18 +1141,11 @@ struct Component final
   {
     using namespace Steinberg;
 
-    IBStreamer streamer(state, kLittleEndian);
     if constexpr (avnd::has_inputs<T>)
     {
-      bool ok = inputs_info_t::for_all_unless(
-          this->effect.inputs(),
-          [&]<typename C>(C& field) -> bool
-          {
-            double param = avnd::map_control_to_01<C>(field.value);
-            return streamer.writeDouble(param);
-          });
-
-      return ok ? Steinberg::kResultOk : Steinberg::kResultFalse;
+      avnd::save_state<T>(this->effect.inputs(), state_buffer);
+      return stv3::writeState(state, state_buffer) ? Steinberg::kResultOk
+                                                   : Steinberg::kResultFalse;
     }
     else
     {
@@ -594,11 +1158,23 @@ struct Component final
   /****************/
   tresult canProcessSampleSize(int32 symbolicSampleSize) override
   {
-    // We'll do conversions if necessary, 32 & 64 sample sizes are supported
-    return Steinberg::kResultTrue;
+    // 32-bit processing is mandatory, thus we convert for processors working with
+    // doubles only. 64-bit processing is only offered to the ones supporting it,
+    // so that hosts do not make float processors go through conversions.
+    using namespace Steinberg::Vst;
+    if (symbolicSampleSize == kSample32)
+      return Steinberg::kResultTrue;
+    if (symbolicSampleSize == kSample64 && avnd::double_processor<T>)
+      return Steinberg::kResultTrue;
+    return Steinberg::kResultFalse;
   }
 
-  uint32 getLatencySamples() override { return 0; }
+  uint32 getLatencySamples() override
+  {
+    if constexpr (avnd::reports_latency<T>)
+      return uint32(std::max(avnd::latency_samples(effect), int64_t(0)));
+    return 0;
+  }
 
   tresult setProcessing(TBool state) override
   {
@@ -609,16 +1185,27 @@ struct Component final
   uint32 getTailSamples() override
   {
     using namespace Steinberg::Vst;
+    if constexpr (avnd::has_tail<T>)
+    {
+      const double frames = avnd::tail_seconds(effect) * processSetup.sampleRate;
+      return frames < double(kInfiniteTail) ? uint32(std::ceil(frames)) : kInfiniteTail;
+    }
     return kNoTail;
   }
 
   Steinberg::tresult setActive(Steinberg::TBool state) override
   {
     using namespace Steinberg;
+    // Hosts may activate again without a new setupProcessing
+    if (!state)
+      release_processing();
+    else if (!prepared)
+      prepare_processing();
     return kResultOk;
   }
 
   ProcessSetup processSetup;
+  bool prepared{};
 
   int32 currentProcessMode{};
 };
@@ -1,13 +1,17 @@
 #pragma once
 #include <avnd/binding/vst3/controller_base.hpp>
+#include <avnd/binding/vst3/helpers.hpp>
 #include <avnd/binding/vst3/programs.hpp>
 #include <avnd/binding/vst3/refcount.hpp>
 #include <avnd/common/widechar.hpp>
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/bypass.hpp>
 #include <avnd/wrappers/control_display.hpp>
 #include <avnd/wrappers/controls.hpp>
 #include <avnd/wrappers/controls_fp.hpp>
+#include <avnd/wrappers/latency.hpp>
+#include <avnd/wrappers/output_parameters.hpp>
 #include <avnd/wrappers/widgets.hpp>
 #include <cmath>
 #include <pluginterfaces/vst/ivstmidicontrollers.h>
@@ -61,20 +65,102 @@ class Controller final
 
   using inputs_t = typename avnd::inputs_type<T>::type;
   inputs_t inputs_mirror{};
+  std::vector<char> state_buffer;
 
   using inputs_info_t = avnd::parameter_input_introspection<T>;
   static const constexpr int32_t parameter_count = inputs_info_t::size;
 
+  // Output parameters are reported by the component and shown read-only
+  using outputs_t = typename avnd::outputs_type<T>::type;
+  outputs_t outputs_mirror{};
+
+  using outputs_info_t = avnd::parameter_output_introspection<T>;
+
+  // Hosts ask for the text of the values of all the visible parameters at each frame
+  avnd::display_cache<inputs_info_t::size + outputs_info_t::size> value_texts;
+
+  static bool is_output(ParamID tag) noexcept
+  {
+    return tag & avnd::output_parameter_id_bit;
+  }
+  static int output_index(ParamID tag) noexcept
+  {
+    return tag & ~avnd::output_parameter_id_bit;
+  }
+
 public:
   Controller() { }
 
   virtual ~Controller();
 
-  int32 getParameterCount() override { return inputs_info_t::size; }
+  // The last one reports the changes of latency, see Component::processLatency
+  static constexpr int32 latency_parameter_count = avnd::dynamic_latency<T> ? 1 : 0;
+
+  // The bypass of the host comes last, see avnd::bypass_adapter
+  ParamValue bypass_value{};
+
+  int32 getParameterCount() override
+  {
+    return inputs_info_t::size + outputs_info_t::size + latency_parameter_count + 1;
+  }
+
+  Steinberg::tresult getOutputParameterInfo(int32 paramIndex, ParameterInfo& info)
+  {
+    if (paramIndex == outputs_info_t::size + latency_parameter_count)
+    {
+      info.id = avnd::bypass_parameter_id;
+      setStr(info.title, "Bypass");
+      setStr(info.shortTitle, "Bypass");
+      info.stepCount = 1;
+      info.defaultNormalizedValue = 0.;
+      info.unitId = 1;
+      info.flags = ParameterInfo::kCanAutomate | ParameterInfo::kIsBypass;
+      return Steinberg::kResultTrue;
+    }
+
+    if (latency_parameter_count > 0 && paramIndex == outputs_info_t::size)
+    {
+      info.id = stv3::latency_parameter_id;
+      setStr(info.title, "Latency");
+      setStr(info.shortTitle, "Latency");
+      info.stepCount = 1;
+      info.unitId = 1;
+      info.flags = ParameterInfo::kIsReadOnly | ParameterInfo::kIsHidden;
+      return Steinberg::kResultTrue;
+    }
+
+    if (paramIndex < 0 || paramIndex >= outputs_info_t::size)
+      return Steinberg::kInvalidArgument;
+
+    const int field = outputs_info_t::index_map[paramIndex];
+    info.id = avnd::output_parameter_id_bit | field;
+    outputs_info_t::for_nth_raw(
+        field,
+        [&]<std::size_t Index, typename C>(avnd::field_reflection<Index, C> field)
+        {
+          setStr(info.title, C::name());
+          setStr(info.shortTitle, C::name());
+          if constexpr (requires { C::units(); })
+            setStr(info.shortTitle, C::units());
+          if constexpr (avnd::has_range<C>)
+          {
+            constexpr auto range = avnd::get_range<C>();
+            if constexpr (requires { range.init; })
+              info.defaultNormalizedValue = avnd::map_control_to_01<C>(range.init);
+          }
+        });
+
+    info.unitId = 1;
+    info.flags = ParameterInfo::kIsReadOnly;
+
+    return Steinberg::kResultTrue;
+  }
 
   Steinberg::tresult getParameterInfo(int32 paramIndex, ParameterInfo& info) override
   {
-    if (paramIndex < 0 || paramIndex >= inputs_info_t::size)
+    if (paramIndex >= inputs_info_t::size)
+      return getOutputParameterInfo(paramIndex - inputs_info_t::size, info);
+    if (paramIndex < 0)
       return Steinberg::kInvalidArgument;
 
     info.id = inputs_info_t::index_map[paramIndex];
@@ -108,7 +194,17 @@ public:
   {
     ParamValue res = valueNormalized;
 
-    if constexpr (avnd::has_inputs<T>)
+    if (tag == avnd::bypass_parameter_id)
+      return res;
+    if (is_output(tag))
+    {
+      outputs_info_t::for_nth_raw(
+          this->outputs_mirror,
+          output_index(tag),
+          [&]<typename C>(C& field)
+          { res = avnd::map_control_from_01_to_fp<C>(valueNormalized); });
+    }
+    else if constexpr (avnd::has_inputs<T>)
     {
       inputs_info_t::for_nth_raw(
           this->inputs_mirror,
@@ -123,7 +219,17 @@ public:
   {
     ParamValue res = plainValue;
 
-    if constexpr (avnd::has_inputs<T>)
+    if (tag == avnd::bypass_parameter_id)
+      return res;
+    if (is_output(tag))
+    {
+      outputs_info_t::for_nth_raw(
+          this->outputs_mirror,
+          output_index(tag),
+          [&]<typename C>(C& field)
+          { res = avnd::map_control_from_fp_to_01<C>(plainValue); });
+    }
+    else if constexpr (avnd::has_inputs<T>)
     {
       inputs_info_t::for_nth_raw(
           this->inputs_mirror,
@@ -138,7 +244,16 @@ public:
   {
     ParamValue res{};
 
-    if constexpr (avnd::has_inputs<T>)
+    if (tag == avnd::bypass_parameter_id)
+      return bypass_value;
+    if (is_output(tag))
+    {
+      outputs_info_t::for_nth_raw(
+          this->outputs_mirror,
+          output_index(tag),
+          [&]<typename C>(C& field) { res = avnd::map_control_to_01(field); });
+    }
+    else if constexpr (avnd::has_inputs<T>)
     {
       inputs_info_t::for_nth_raw(
           this->inputs_mirror,
@@ -150,6 +265,30 @@ public:
 
   Steinberg::tresult setParamNormalized(ParamID tag, ParamValue value) override
   {
+    if (tag == stv3::latency_parameter_id)
+    {
+      if (this->componentHandler)
+        this->componentHandler->restartComponent(Steinberg::Vst::kLatencyChanged);
+      return Steinberg::kResultTrue;
+    }
+
+    if (tag == avnd::bypass_parameter_id)
+    {
+      bypass_value = value;
+      return Steinberg::kResultTrue;
+    }
+
+    // The host forwards the values reported by the component
+    if (is_output(tag))
+    {
+      outputs_info_t::for_nth_raw(
+          this->outputs_mirror,
+          output_index(tag),
+          [&]<typename C>(C& field)
+          { field.value = avnd::map_control_from_01<C>(value); });
+      return Steinberg::kResultTrue;
+    }
+
     if (tag < 0 || tag >= inputs_info_t::size)
       return Steinberg::kInvalidArgument;
 
@@ -174,10 +313,16 @@ public:
     if (!state)
       return Steinberg::kResultFalse;
 
-    IBStreamer streamer(state, kLittleEndian);
-
     if constexpr (avnd::has_inputs<T>)
     {
+      if (stv3::readState(state, state_buffer))
+      {
+        const bool ok = avnd::load_state<T>(
+            this->inputs_mirror, state_buffer.data(), state_buffer.size());
+        return ok ? Steinberg::kResultOk : Steinberg::kResultFalse;
+      }
+
+      IBStreamer streamer(state, kLittleEndian);
       bool ok = inputs_info_t::for_all_unless(
           this->inputs_mirror,
           [&]<typename C>(C& field) -> bool
@@ -227,9 +372,22 @@ public:
     using namespace Steinberg;
     using namespace Steinberg::Vst;
     bool ok = false;
+    if (is_output(tag))
+    {
+      outputs_info_t::for_nth_raw(
+          output_index(tag), [&]<auto Idx, typename C>(avnd::field_reflection<Idx, C> tag) {
+            ok = value_texts.template display<C>(
+                inputs_info_t::size + outputs_info_t::template unmap<Idx>(),
+                valueNormalized, avnd::map_control_from_01<C>(valueNormalized), string,
+                128);
+          });
+      return ok ? Steinberg::kResultTrue : Steinberg::kResultFalse;
+    }
+
     inputs_info_t::for_nth_raw(
         tag, [&]<auto Idx, typename C>(avnd::field_reflection<Idx, C> tag) {
-          ok = avnd::display_control<C>(
+          ok = value_texts.template display<C>(
+              inputs_info_t::template unmap<Idx>(), valueNormalized,
               avnd::map_control_from_01<C>(valueNormalized), string, 128);
         });
 
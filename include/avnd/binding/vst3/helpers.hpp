@@ -11,11 +11,18 @@
 #include <pluginterfaces/vst/vstpresetkeys.h>
 
 #include <algorithm>
+#include <avnd/wrappers/output_parameters.hpp>
+#include <avnd/wrappers/state.hpp>
 
 #include <string_view>
+#include <vector>
 
 namespace stv3
 {
+// Hidden read-only parameter through which the component tells the controller
+// that its latency changed: the value flips at each change.
+static constexpr uint32_t latency_parameter_id = avnd::output_parameter_id_bit | 0x3FFFFFFF;
+
 #if defined(_WIN32)
 #define u16 L""
 template <std::size_t M>
@@ -69,4 +76,52 @@ inline Steinberg::tresult isProjectState(Steinberg::IBStream* state)
   return kNotImplemented;
 }
 
+/**
+ * Reads a state saved with avnd::save_state in buffer.
+ * If the stream contains something else, e.g. a state saved by a previous version
+ * which wrote the parameters one by one, it is rewound and false is returned.
+ */
+inline bool readState(Steinberg::IBStream* state, std::vector<char>& buffer)
+{
+  using namespace Steinberg;
+  int64 start = 0;
+  if (state->tell(&start) != kResultOk)
+    return false;
+
+  buffer.resize(avnd::state_format::header_size);
+  int32 read = 0;
+  if (state->read(buffer.data(), int32(buffer.size()), &read) != kResultOk
+      || !avnd::is_state(buffer.data(), read))
+  {
+    state->seek(start, IBStream::kIBSeekSet, nullptr);
+    return false;
+  }
+
+  // Read everything in large chunks
+  constexpr int32 chunk = 65536;
+  for (;;)
+  {
+    const auto size = buffer.size();
+    buffer.resize(size + chunk);
+    read = 0;
+    state->read(buffer.data() + size, chunk, &read);
+    buffer.resize(size + std::max(read, int32(0)));
+    if (read < chunk)
+      break;
+  }
+  return true;
+}
+
+/**
+ * Writes the state in a single call.
+ */
+inline bool writeState(Steinberg::IBStream* state, const std::vector<char>& buffer)
+{
+  using namespace Steinberg;
+  int32 written = 0;
+  return state->write(
+             const_cast<char*>(buffer.data()), int32(buffer.size()), &written)
+             == kResultOk
+         && written == int32(buffer.size());
+}
 }
@@ -0,0 +1,125 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/binding/vst3/metadata.hpp>
+#include <avnd/wrappers/metadatas.hpp>
+#include <pluginterfaces/base/ipluginbase.h>
+#include <pluginterfaces/vst/ivstaudioprocessor.h>
+#include <pluginterfaces/vst/ivsteditcontroller.h>
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace stv3
+{
+/**
+ * The moduleinfo.json of a plug-in, which hosts read when scanning instead of
+ * loading the module and querying its factory. The content matches what
+ * stv3::factory reports, all of it being known at compile time: the build
+ * writes it in the Resources folder of the bundle.
+ */
+template <typename T>
+std::string module_info()
+{
+  auto str = [](std::string_view s) {
+    std::string res = "\"";
+    for (char c : s)
+    {
+      switch (c)
+      {
+        case '"':
+          res += "\\\"";
+          break;
+        case '\\':
+          res += "\\\\";
+          break;
+        case '\n':
+          res += "\\n";
+          break;
+        default:
+          if (static_cast<unsigned char>(c) >= 0x20)
+            res += c;
+          break;
+      }
+    }
+    return res += '"';
+  };
+
+  auto cid = [](const UnionID& id) {
+    std::string res = "\"";
+    for (auto byte : id.tuid)
+    {
+      char hex[3];
+      std::snprintf(hex, sizeof(hex), "%02X", static_cast<unsigned char>(byte));
+      res += hex;
+    }
+    return res += '"';
+  };
+
+  const std::string_view name = avnd::get_name<T>();
+  std::string_view vendor = "";
+  std::string_view version = "0.0.0";
+  std::string_view url = "";
+  std::string_view email = "";
+  if constexpr (avnd::has_vendor<T>)
+    vendor = avnd::get_vendor<T>();
+  if constexpr (avnd::has_version<T>)
+    version = avnd::get_version<T>();
+  if constexpr (avnd::has_url<T>)
+    url = avnd::get_url<T>();
+  if constexpr (avnd::has_email<T>)
+    email = avnd::get_email<T>();
+
+  auto class_info = [&](const UnionID& id, std::string_view category,
+                        const std::string& class_name, int flags,
+                        std::string_view subcategories) {
+    std::string res;
+    res += "    {\n";
+    res += "      \"CID\": " + cid(id) + ",\n";
+    res += "      \"Category\": " + str(category) + ",\n";
+    res += "      \"Name\": " + str(class_name) + ",\n";
+    res += "      \"Vendor\": " + str(vendor) + ",\n";
+    res += "      \"Version\": " + str(version) + ",\n";
+    res += "      \"SDK Version\": " + str(kVstVersionString) + ",\n";
+    res += "      \"Sub Categories\": [";
+    if (!subcategories.empty())
+      res += str(subcategories);
+    res += "],\n";
+    res += "      \"Class Flags\": " + std::to_string(flags) + ",\n";
+    res += "      \"Cardinality\": "
+           + std::to_string(Steinberg::PClassInfo::kManyInstances) + ",\n";
+    res += "      \"Snapshots\": []\n";
+    res += "    }";
+    return res;
+  };
+
+  std::string res;
+  res += "{\n";
+  res += "  \"Name\": " + str(name) + ",\n";
+  res += "  \"Version\": " + str(version) + ",\n";
+  res += "  \"Factory Info\": {\n";
+  res += "    \"Vendor\": " + str(vendor) + ",\n";
+  res += "    \"URL\": " + str(url) + ",\n";
+  res += "    \"E-Mail\": " + str(email) + ",\n";
+  res += "    \"Flags\": {\n";
+  res += "      \"Unicode\": true,\n";
+  res += "      \"Classes Discardable\": false,\n";
+  res += "      \"Component Non Discardable\": false\n";
+  res += "    }\n";
+  res += "  },\n";
+  res += "  \"Compatibility\": [],\n";
+  res += "  \"Classes\": [\n";
+  res += class_info(
+      component_uuid_for_type<T>(), kVstAudioEffectClass, std::string(name),
+      Steinberg::Vst::kDistributable, "Fx");
+  res += ",\n";
+  res += class_info(
+      controller_uuid_for_type<T>(), kVstComponentControllerClass,
+      std::string(name) + "Controller", 0, "");
+  res += "\n  ]\n";
+  res += "}\n";
+  return res;
+}
+}
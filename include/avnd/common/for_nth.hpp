@@ -2,23 +2,48 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
-#include <avnd/common/coroutines.hpp>
+#include <avnd/common/member_range.hpp>
 #include <boost/pfr.hpp>
 
+#include <array>
 #include <cassert>
+#include <type_traits>
 #include <utility>
 
 namespace avnd
 {
 
+/**
+ * Calls f.template operator()<k>() for a runtime k in [0; N[, and nothing otherwise.
+ *
+ * Small counts are tested one after the other, which the compiler can inline;
+ * larger ones go through a table of functions indexed by k, so that the cost
+ * does not grow with N, e.g. for processors with hundreds of parameters.
+ */
 template <std::size_t N>
 constexpr void for_nth(int k, auto&& f)
 {
-  [k]<std::size_t... Index>(std::index_sequence<Index...>, auto&& f)
+  if constexpr (N <= 4)
   {
-    ((void)(Index == k && (f.template operator()<Index>(), true)), ...);
+    [k]<std::size_t... Index>(std::index_sequence<Index...>, auto&& f)
+    {
+      ((void)(Index == k && (f.template operator()<Index>(), true)), ...);
+    }
+    (std::make_index_sequence<N>(), f);
+  }
+  else
+  {
+    using func_type = std::remove_reference_t<decltype(f)>;
+    constexpr auto table = []<std::size_t... Index>(std::index_sequence<Index...>)
+    {
+      return std::array<void (*)(func_type&), N>{
+          +[](func_type& f) { f.template operator()<Index>(); }...};
+    }
+    (std::make_index_sequence<N>());
+
+    if (k >= 0 && std::size_t(k) < N)
+      table[k](f);
   }
-  (std::make_index_sequence<N>(), f);
 }
 
 template <class T, class F>
@@ -37,24 +62,8 @@ constexpr void for_each_field_ref(T&& value, F&& func)
   (make_index_sequence<fields_count_val>{});
 }
 
-template <class T, class F>
-void for_each_field_ref(avnd::member_iterator<T>&& value, F&& func)
-{
-  for (auto& v : value)
-  {
-    for_each_field_ref(v, func);
-  }
-}
-template <class T, class F>
-void for_each_field_ref(avnd::member_iterator<T>& value, F&& func)
-{
-  for (auto& v : value)
-  {
-    for_each_field_ref(v, func);
-  }
-}
-template <class T, class F>
-void for_each_field_ref(const avnd::member_iterator<T>& value, F&& func)
+template <avnd::instance_range T, class F>
+void for_each_field_ref(T&& value, F&& func)
 {
   for (auto& v : value)
   {
@@ -0,0 +1,70 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+/**
+ * Freestanding profile, for micro-controllers and DSP boards:
+ * build with AVND_FREESTANDING=1, e.g. through the Avendish::Freestanding CMake target.
+ *
+ * The wrappers then do not allocate: their containers have static capacities, sized by
+ * the macros below, and the process adapters lay out their buffers in a fixed arena.
+ * The coroutines are disabled, and everything else that is used is header-only.
+ * A setup which does not fit, e.g. more channels than AVND_FREESTANDING_MAX_CHANNELS,
+ * is clamped to the capacities; a processor whose buffers do not fit in the arena stops
+ * the program when it is prepared, see audio_buffer_arena.
+ */
+#if !defined(AVND_FREESTANDING)
+#define AVND_FREESTANDING 0
+#endif
+
+#if AVND_FREESTANDING
+#if !defined(AVND_DISABLE_COROUTINES)
+#define AVND_DISABLE_COROUTINES 1
+#endif
+
+// Instances of a processor duplicated per channel, channels of a bus
+#if !defined(AVND_FREESTANDING_MAX_CHANNELS)
+#define AVND_FREESTANDING_MAX_CHANNELS 8
+#endif
+
+// Frames of a buffer
+#if !defined(AVND_FREESTANDING_MAX_FRAMES)
+#define AVND_FREESTANDING_MAX_FRAMES 256
+#endif
+
+// Conversion and silent buffers of the process adapters
+#if !defined(AVND_FREESTANDING_ARENA_BYTES)
+#define AVND_FREESTANDING_ARENA_BYTES 16384
+#endif
+
+#include <avnd/common/static_vector.hpp>
+#else
+#include <vector>
+#endif
+
+namespace avnd
+{
+#if AVND_FREESTANDING
+// One element per channel
+template <typename T>
+using channel_vector = static_vector<T, AVND_FREESTANDING_MAX_CHANNELS>;
+
+// One element per frame of a buffer
+template <typename T>
+using frame_vector = static_vector<T, AVND_FREESTANDING_MAX_FRAMES>;
+
+// One element per frame of each input and output channel
+template <typename T>
+using buffer_vector
+    = static_vector<T, 2 * AVND_FREESTANDING_MAX_CHANNELS * AVND_FREESTANDING_MAX_FRAMES>;
+#else
+template <typename T>
+using channel_vector = std::vector<T>;
+
+template <typename T>
+using frame_vector = std::vector<T>;
+
+template <typename T>
+using buffer_vector = std::vector<T>;
+#endif
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/coroutines.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+namespace avnd
+{
+/**
+ * Allocation-free counterpart of member_iterator, for iterating
+ * over elements stored contiguously, e.g. the duplicated instances
+ * of a monophonic processor.
+ *
+ * Dereferencing yields projection(element): it can either be a reference
+ * to a part of the element, or a small struct of references built on the fly.
+ */
+template <typename Element, typename Projection>
+class member_range
+{
+public:
+  class iterator
+  {
+  public:
+    constexpr iterator(Element* ptr, const Projection& proj) noexcept
+        : m_ptr{ptr}
+        , m_proj{proj}
+    {
+    }
+
+    constexpr void operator++() noexcept { ++m_ptr; }
+
+    constexpr decltype(auto) operator*() const noexcept { return m_proj(*m_ptr); }
+
+    constexpr bool operator==(const iterator& other) const noexcept
+    {
+      return m_ptr == other.m_ptr;
+    }
+
+  private:
+    Element* m_ptr{};
+    [[no_unique_address]] Projection m_proj;
+  };
+
+  constexpr member_range(Element* first, Element* last, Projection proj = {}) noexcept
+      : m_first{first}
+      , m_last{last}
+      , m_proj{proj}
+  {
+  }
+
+  constexpr iterator begin() const noexcept { return iterator{m_first, m_proj}; }
+  constexpr iterator end() const noexcept { return iterator{m_last, m_proj}; }
+
+  constexpr std::size_t size() const noexcept { return m_last - m_first; }
+
+  // Elements [first; last[, clamped to the range
+  constexpr member_range subrange(std::size_t first, std::size_t last) const noexcept
+  {
+    last = std::min(last, size());
+    first = std::min(first, last);
+    return {m_first + first, m_first + last, m_proj};
+  }
+
+private:
+  Element* m_first{};
+  Element* m_last{};
+  [[no_unique_address]] Projection m_proj;
+};
+
+struct identity_projection
+{
+  template <typename T>
+  constexpr T& operator()(T& t) const noexcept
+  {
+    return t;
+  }
+};
+
+template <typename T>
+struct is_member_range : std::false_type
+{
+};
+#if !AVND_DISABLE_COROUTINES
+template <typename T>
+struct is_member_range<member_iterator<T>> : std::true_type
+{
+};
+#endif
+template <typename E, typename P>
+struct is_member_range<member_range<E, P>> : std::true_type
+{
+};
+
+// Matches the ranges over multiple instances of a processor (or of its ports)
+template <typename T>
+concept instance_range = is_member_range<std::remove_cvref_t<T>>::value;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <cstdint>
+
+namespace avnd
+{
+/**
+ * How the host renders: in real-time, or offline, i.e. faster or slower than
+ * real-time as when bouncing or exporting, where a buffer may take longer than
+ * its duration and processors can use their most expensive algorithms.
+ */
+enum class render_mode : uint8_t
+{
+  realtime,
+  offline
+};
+}
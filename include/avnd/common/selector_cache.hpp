@@ -0,0 +1,75 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace avnd
+{
+/**
+ * Remembers which index an interned symbol (e.g. a Pd or Max t_symbol*)
+ * maps to, so that looking it up again is a pointer comparison.
+ *
+ * Fixed-size open addressing: once full, new symbols are still resolved
+ * but not remembered anymore.
+ */
+template <std::size_t Capacity>
+class selector_cache
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0);
+
+public:
+  // resolve() is called on a miss and must return the index for key, or -1
+  template <typename F>
+  int find(const void* key, F&& resolve)
+  {
+    std::size_t slot = hash(key);
+    for (std::size_t probe = 0; probe < Capacity; probe++)
+    {
+      auto& e = m_entries[slot];
+      if (e.key == key)
+        return e.index;
+      if (!e.key)
+        break;
+      slot = (slot + 1) & (Capacity - 1);
+    }
+
+    const int index = resolve();
+    if (m_count < Capacity * 3 / 4)
+    {
+      // slot is the first empty one of the probe sequence
+      m_entries[slot] = {key, index};
+      m_count++;
+    }
+    return index;
+  }
+
+private:
+  static std::size_t hash(const void* key) noexcept
+  {
+    // Symbols are allocated objects: drop the low bits which are always zero
+    const auto v = reinterpret_cast<std::uintptr_t>(key) >> 4;
+    return std::size_t(v * 0x9E3779B97F4A7C15ull >> 32) & (Capacity - 1);
+  }
+
+  struct entry
+  {
+    const void* key{};
+    int index{-1};
+  };
+
+  std::array<entry, Capacity> m_entries{};
+  std::size_t m_count{};
+};
+
+// Enough room for every message of an object and some unknown selectors
+constexpr std::size_t selector_cache_size(std::size_t messages) noexcept
+{
+  std::size_t n = 16;
+  while (n < 4 * messages)
+    n *= 2;
+  return n;
+}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+namespace avnd
+{
+/**
+ * What changed in the setup of a processor since the previous prepare,
+ * e.g. when the host changes the block size, or toggles its DSP off and on:
+ * processors can then keep what does not depend on it, instead of
+ * rebuilding their tables and delay lines from scratch.
+ *
+ * Everything changed for the first prepare.
+ */
+struct setup_change
+{
+  bool rate{true};
+  bool frames{true};
+  bool channels{true};
+  bool mode{true};
+
+  constexpr bool any() const noexcept { return rate || frames || channels || mode; }
+};
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace avnd
+{
+/**
+ * Wait-free single-producer / single-consumer FIFO of at most N values.
+ *
+ * The producer calls push(), which fails when the queue is full;
+ * the consumer looks at front() and pop()s it. Neither side allocates.
+ */
+template <typename T, std::size_t N>
+class spsc_queue
+{
+  static_assert(N > 0 && (N & (N - 1)) == 0, "the capacity must be a power of two");
+
+public:
+  // Producer side
+  bool push(const T& value) noexcept
+  {
+    const std::size_t w = m_write.load(std::memory_order_relaxed);
+    if (w - m_read.load(std::memory_order_acquire) == N)
+      return false;
+
+    m_buffer[w % N] = value;
+    m_write.store(w + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool push(T&& value) noexcept
+  {
+    const std::size_t w = m_write.load(std::memory_order_relaxed);
+    if (w - m_read.load(std::memory_order_acquire) == N)
+      return false;
+
+    m_buffer[w % N] = static_cast<T&&>(value);
+    m_write.store(w + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: nullptr if the queue is empty
+  const T* front() const noexcept
+  {
+    const std::size_t r = m_read.load(std::memory_order_relaxed);
+    if (r == m_write.load(std::memory_order_acquire))
+      return nullptr;
+    return &m_buffer[r % N];
+  }
+
+  // Lets the consumer move the value out before pop()
+  T* front() noexcept { return const_cast<T*>(std::as_const(*this).front()); }
+
+  void pop() noexcept
+  {
+    m_read.store(m_read.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+private:
+  std::array<T, N> m_buffer{};
+  alignas(64) std::atomic<std::size_t> m_write{};
+  alignas(64) std::atomic<std::size_t> m_read{};
+};
+}
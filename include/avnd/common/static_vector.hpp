@@ -0,0 +1,181 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace avnd
+{
+/**
+ * Vector with a fixed capacity, stored in place: it never allocates.
+ *
+ * It has the parts of the std::vector API the wrappers use, so that a container
+ * can be either depending on the build, see avnd/common/freestanding.hpp.
+ * Like halp::midi_message_buffer, growing past the capacity is clamped to it:
+ * the elements which do not fit are not inserted.
+ */
+template <typename T, std::size_t Capacity>
+class static_vector
+{
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  static_vector() noexcept = default;
+
+  explicit static_vector(size_type n) { resize(n); }
+  static_vector(size_type n, const T& v) { resize(n, v); }
+  static_vector(std::initializer_list<T> init) { assign(init.begin(), init.end()); }
+  template <typename It>
+  requires(!std::is_integral_v<It>)
+  static_vector(It first, It last)
+  {
+    assign(first, last);
+  }
+
+  static_vector(const static_vector& other) { assign(other.begin(), other.end()); }
+  static_vector(static_vector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+  {
+    for (auto& v : other)
+      unchecked_emplace_back(std::move(v));
+  }
+
+  static_vector& operator=(const static_vector& other)
+  {
+    if (this != &other)
+      assign(other.begin(), other.end());
+    return *this;
+  }
+
+  static_vector& operator=(static_vector&& other) noexcept(
+      std::is_nothrow_move_constructible_v<T>)
+  {
+    if (this != &other)
+    {
+      clear();
+      for (auto& v : other)
+        unchecked_emplace_back(std::move(v));
+    }
+    return *this;
+  }
+
+  ~static_vector() { clear(); }
+
+  static constexpr size_type capacity() noexcept { return Capacity; }
+  static constexpr size_type max_size() noexcept { return Capacity; }
+  size_type size() const noexcept { return m_size; }
+  bool empty() const noexcept { return m_size == 0; }
+  bool full() const noexcept { return m_size == Capacity; }
+
+  void reserve(size_type) noexcept { }
+  void shrink_to_fit() noexcept { }
+
+  void resize(size_type n)
+  {
+    n = std::min(n, Capacity);
+    shrink(n);
+    while (m_size < n)
+      unchecked_emplace_back();
+  }
+
+  void resize(size_type n, const T& v)
+  {
+    n = std::min(n, Capacity);
+    shrink(n);
+    while (m_size < n)
+      unchecked_emplace_back(v);
+  }
+
+  void assign(size_type n, const T& v)
+  {
+    clear();
+    resize(n, v);
+  }
+
+  template <typename It>
+  requires(!std::is_integral_v<It>)
+  void assign(It first, It last)
+  {
+    clear();
+    for (; first != last && m_size < Capacity; ++first)
+      unchecked_emplace_back(*first);
+  }
+
+  void clear() noexcept { shrink(0); }
+
+  void push_back(const T& v)
+  {
+    if (m_size < Capacity)
+      unchecked_emplace_back(v);
+  }
+
+  void push_back(T&& v)
+  {
+    if (m_size < Capacity)
+      unchecked_emplace_back(std::move(v));
+  }
+
+  template <typename... Args>
+  void emplace_back(Args&&... args)
+  {
+    if (m_size < Capacity)
+      unchecked_emplace_back(std::forward<Args>(args)...);
+  }
+
+  void pop_back() noexcept { shrink(m_size - 1); }
+
+  T* data() noexcept { return std::launder(reinterpret_cast<T*>(m_storage)); }
+  const T* data() const noexcept
+  {
+    return std::launder(reinterpret_cast<const T*>(m_storage));
+  }
+
+  iterator begin() noexcept { return data(); }
+  iterator end() noexcept { return data() + m_size; }
+  const_iterator begin() const noexcept { return data(); }
+  const_iterator end() const noexcept { return data() + m_size; }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+
+  T& front() noexcept { return data()[0]; }
+  T& back() noexcept { return data()[m_size - 1]; }
+  const T& front() const noexcept { return data()[0]; }
+  const T& back() const noexcept { return data()[m_size - 1]; }
+
+  T& operator[](size_type i) noexcept { return data()[i]; }
+  const T& operator[](size_type i) const noexcept { return data()[i]; }
+
+private:
+  template <typename... Args>
+  void unchecked_emplace_back(Args&&... args)
+  {
+    // The value is built before the size changes, as args may be an element,
+    // e.g. in v.push_back(v[0])
+    std::construct_at(
+        reinterpret_cast<T*>(m_storage) + m_size, std::forward<Args>(args)...);
+    m_size++;
+  }
+
+  void shrink(size_type n) noexcept
+  {
+    if (n >= m_size)
+      return;
+    if constexpr (!std::is_trivially_destructible_v<T>)
+      std::destroy(data() + n, data() + m_size);
+    m_size = n;
+  }
+
+  alignas(T) std::byte m_storage[sizeof(T) * (Capacity > 0 ? Capacity : 1)];
+  size_type m_size{};
+};
+}
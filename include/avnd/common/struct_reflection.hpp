@@ -3,12 +3,18 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <avnd/common/coroutines.hpp>
+#include <avnd/common/member_range.hpp>
 #include <avnd/common/dummy.hpp>
 #include <avnd/common/errors.hpp>
+#include <avnd/common/for_nth.hpp>
 #include <avnd/common/index_sequence.hpp>
 #include <boost/mp11.hpp>
 #include <boost/pfr.hpp>
 
+#include <array>
+#include <tuple>
+#include <utility>
+
 namespace avnd
 {
 namespace pfr = ::boost::pfr;
@@ -40,10 +46,52 @@ consteval int index_of_element(std::integer_sequence<T, Idx...>) noexcept
   return ret;
 }
 
+/**
+ * What pfr finds in a struct, computed once per type: the aliases below only
+ * name its members, rather than going through pfr's detection again in each of
+ * the introspection helpers instantiated for the type.
+ */
 template <typename T>
-using as_tuple_ref = decltype(pfr::detail::tie_as_tuple(std::declval<T&>()));
+struct struct_fields
+{
+  using tuple = decltype(pfr::structure_to_tuple(std::declval<T&>()));
+  using tuple_ref = decltype(pfr::detail::tie_as_tuple(std::declval<T&>()));
+  static constexpr std::size_t size = std::tuple_size_v<tuple>;
+};
+
 template <typename T>
-using as_tuple = decltype(pfr::structure_to_tuple(std::declval<T&>()));
+using as_tuple_ref = typename struct_fields<T>::tuple_ref;
+template <typename T>
+using as_tuple = typename struct_fields<T>::tuple;
+
+template <typename T>
+inline constexpr std::size_t field_count = struct_fields<T>::size;
+template <std::size_t I, typename T>
+using field_type = boost::mp11::mp_at_c<as_tuple<T>, I>;
+
+// The indices of the fields matching P, in one pass over the types of the fields
+template <typename Tuple, template <typename...> typename P>
+struct matching_fields;
+
+template <typename... Fields, template <typename...> typename P>
+struct matching_fields<std::tuple<Fields...>, P>
+{
+  static constexpr std::size_t size = (std::size_t(bool(P<Fields>::value)) + ... + 0);
+  static constexpr std::array<int, size> index_map = [] {
+    constexpr bool matches[] = {bool(P<Fields>::value)..., false};
+    std::array<int, size> res{};
+    std::size_t k = 0;
+    for (std::size_t i = 0; i < sizeof...(Fields); i++)
+      if (matches[i])
+        res[k++] = int(i);
+    return res;
+  }();
+
+  template <std::size_t... I>
+  static auto sequence(std::index_sequence<I...>)
+      -> std::integer_sequence<int, index_map[I]...>;
+  using indices_n = decltype(sequence(std::make_index_sequence<size>{}));
+};
 
 // Yields a tuple with the compile-time function applied to each member of the struct
 template <template <typename...> typename F, typename T>
@@ -93,7 +141,7 @@ struct fields_introspection
       // C++20 : template lambda
       [&func]<typename K, K... Index>(std::integer_sequence<K, Index...>)
       {
-        (func(field_reflection<Index, pfr::tuple_element_t<Index, type>>{}), ...);
+        (func(field_reflection<Index, field_type<Index, type>>{}), ...);
       }
       (indices_n{});
     }
@@ -101,20 +149,9 @@ struct fields_introspection
 
   static constexpr void for_nth(int n, auto&& func) noexcept
   {
-    // TODO maybe there is some dirty hack to do here with offsetof computations...
-    // technically, we ought to be able to compute the address of member "n" at compile time...
-    // and reinterpret_cast &fields+addr....
-
-    if constexpr (size > 0)
-    {
-      [ n, &func ]<typename K, K... Index>(std::integer_sequence<K, Index...>)
-      {
-        // TODO compare with || logical-or fold ?
-        ((void)(Index == n && (func(field_reflection<Index, pfr::tuple_element_t<Index, type>>{}), true)),
-         ...);
-      }
-      (indices_n{});
-    }
+    avnd::for_nth<size>(n, [&func]<std::size_t Index> {
+      func(field_reflection<Index, field_type<Index, type>>{});
+    });
   }
 
   static constexpr void for_all(type& fields, auto&& func) noexcept
@@ -132,21 +169,10 @@ struct fields_introspection
 
   static constexpr void for_nth(type& fields, int n, auto&& func) noexcept
   {
-    // TODO maybe there is some dirty hack to do here with offsetof computations...
-    // technically, we ought to be able to compute the address of member "n" at compile time...
-    // and reinterpret_cast &fields+addr....
-
-    if constexpr (size > 0)
-    {
-      [ n, &func, &fields ]<typename K, K... Index>(std::integer_sequence<K, Index...>)
-      {
-        auto&& ppl = pfr::detail::tie_as_tuple(fields);
-        // TODO compare with || logical-or fold ?
-        ((void)(Index == n && (func(pfr::detail::sequence_tuple::get<Index>(ppl)), true)),
-         ...);
-      }
-      (indices_n{});
-    }
+    avnd::for_nth<size>(n, [&func, &fields]<std::size_t Index> {
+      auto&& ppl = pfr::detail::tie_as_tuple(fields);
+      func(pfr::detail::sequence_tuple::get<Index>(ppl));
+    });
   }
 };
 
@@ -154,28 +180,16 @@ struct fields_introspection
  * Utilities to introspect all fields in a struct which match a given predicate
  */
 
-template <typename T, template <typename...> typename P, typename IntT>
-struct matches_predicate : P<pfr::tuple_element_t<IntT::value, T>>
-{
-};
-
 template <typename T, template <typename...> typename P>
 struct predicate_introspection
 {
   using type = T;
-  using indices
-      = typed_index_sequence_t<std::make_index_sequence<pfr::tuple_size_v<type>>>;
-
-  template <typename IntT>
-  struct matches_predicate_i : matches_predicate<T, P, IntT>
-  {
-  };
+  using matching = matching_fields<as_tuple<type>, P>;
 
   using fields = boost::mp11::mp_copy_if<as_tuple<type>, P>;
-  using indices_n
-      = numbered_index_sequence_t<boost::mp11::mp_copy_if<indices, matches_predicate_i>>;
-  static constexpr auto index_map = integer_sequence_to_array(indices_n{});
-  static constexpr auto size = indices_n::size();
+  using indices_n = typename matching::indices_n;
+  static constexpr auto index_map = matching::index_map;
+  static constexpr auto size = matching::size;
 
   template<std::size_t Idx>
   static consteval int map() noexcept {
@@ -192,7 +206,7 @@ struct predicate_introspection
     {
       [&func]<typename K, K... Index>(std::integer_sequence<K, Index...>)
       {
-        (func(field_reflection<Index, pfr::tuple_element_t<Index, T>>{}), ...);
+        (func(field_reflection<Index, field_type<Index, T>>{}), ...);
       }
       (indices_n{});
     }
@@ -201,38 +215,25 @@ struct predicate_introspection
   // n is in [0; total number of ports[ (even those that don't match the predicate)
   static constexpr void for_nth_raw(int n, auto&& func) noexcept
   {
-    if constexpr (size > 0)
-    {
-      [ n, &func ]<typename K, K... Index>(std::integer_sequence<K, Index...>)
-      {
-        // TODO compare with || logical-or fold ?
-        ((void)(Index == n && (func(field_reflection<Index, pfr::tuple_element_t<Index, T>>{}), true)),
-         ...);
-      }
-      (indices_n{});
-    }
+    avnd::for_nth<field_count<type>>(n, [&func]<std::size_t Index> {
+      if constexpr (P<field_type<Index, T>>::value)
+        func(field_reflection<Index, field_type<Index, T>>{});
+    });
   }
 
   // n is in [0; number of ports matching that predicate[
   static constexpr void for_nth_mapped(int n, auto&& func) noexcept
   {
-    if constexpr (size > 0)
-    {
-      [ k = index_map[n], &
-        func ]<typename K, K... Index>(std::integer_sequence<K, Index...>)
-      {
-        // TODO compare with || logical-or fold ?
-        ((void)(Index == k && (func(field_reflection<Index, pfr::tuple_element_t<Index, T>>{}), true)),
-         ...);
-      }
-      (indices_n{});
-    }
+    avnd::for_nth<size>(n, [&func]<std::size_t N> {
+      constexpr int Index = index_map[N];
+      func(field_reflection<Index, field_type<Index, T>>{});
+    });
   }
 
   // Goes from 0, 1, 2 indices to indices in the complete
   // struct with members that may not match this predicate
   template <std::size_t N>
-  using nth_element = std::decay_t<decltype(pfr::get<index_map[N]>(type{}))>;
+  using nth_element = field_type<index_map[N], type>;
 
   template <std::size_t N>
   static constexpr auto get(type& unfiltered_fields) noexcept -> decltype(auto)
@@ -284,28 +285,8 @@ struct predicate_introspection
     }
   }
 
-  template <typename U>
-  static constexpr void
-  for_all(member_iterator<U>&& unfiltered_fields, auto&& func) noexcept
-  {
-    if constexpr (size > 0)
-    {
-      [&func, &
-       unfiltered_fields ]<typename K, K... Index>(std::integer_sequence<K, Index...>)
-      {
-        for (auto& m : unfiltered_fields)
-        {
-          auto&& ppl = pfr::detail::tie_as_tuple(m);
-          (func(pfr::detail::sequence_tuple::get<Index>(ppl)), ...);
-        }
-      }
-      (indices_n{});
-    }
-  }
-
-  template <typename U>
   static constexpr void
-  for_all(member_iterator<U>& unfiltered_fields, auto&& func) noexcept
+  for_all(avnd::instance_range auto&& unfiltered_fields, auto&& func) noexcept
   {
     if constexpr (size > 0)
     {
@@ -361,9 +342,8 @@ struct predicate_introspection
     }
   }
 
-  template <typename U>
   static constexpr void
-  for_all_n(member_iterator<U> unfiltered_fields, auto&& func) noexcept
+  for_all_n(avnd::instance_range auto&& unfiltered_fields, auto&& func) noexcept
   {
     if constexpr (size > 0)
     {
@@ -404,9 +384,9 @@ struct predicate_introspection
     }
   }
 
-  template <typename U>
+  template <avnd::instance_range U>
   static constexpr bool
-  for_all_unless(member_iterator<U> unfiltered_fields, auto&& func) noexcept
+  for_all_unless(U&& unfiltered_fields, auto&& func) noexcept
   {
     if constexpr (size > 0)
     {
@@ -421,31 +401,22 @@ struct predicate_introspection
 
   static constexpr void for_nth_raw(type& fields, int n, auto&& func) noexcept
   {
-    if constexpr (size > 0)
-    {
-      [ n, &func, &fields ]<typename K, K... Index>(std::integer_sequence<K, Index...>)
+    avnd::for_nth<field_count<type>>(n, [&func, &fields]<std::size_t Index> {
+      if constexpr (P<field_type<Index, T>>::value)
       {
         auto&& ppl = pfr::detail::tie_as_tuple(fields);
-        ((void)(Index == n && (func(pfr::detail::sequence_tuple::get<Index>(ppl)), true)),
-         ...);
+        func(pfr::detail::sequence_tuple::get<Index>(ppl));
       }
-      (indices_n{});
-    }
+    });
   }
 
   static constexpr void for_nth_mapped(type& fields, int n, auto&& func) noexcept
   {
-    if constexpr (size > 0)
-    {
-      [ k = index_map[n], &func, &
-        fields ]<typename K, K... Index>(std::integer_sequence<K, Index...>)
-      {
-        auto&& ppl = pfr::detail::tie_as_tuple(fields);
-        ((void)(Index == k && (func(pfr::detail::sequence_tuple::get<Index>(ppl)), true)),
-         ...);
-      }
-      (indices_n{});
-    }
+    avnd::for_nth<size>(n, [&func, &fields]<std::size_t N> {
+      constexpr int Index = index_map[N];
+      auto&& ppl = pfr::detail::tie_as_tuple(fields);
+      func(pfr::detail::sequence_tuple::get<Index>(ppl));
+    });
   }
 };
 
@@ -0,0 +1,23 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <cstdint>
+
+namespace avnd
+{
+/**
+ * What a processor does with the pixels of a texture input, which decides
+ * whether a GPU host reads the texture back to the CPU:
+ *  - pixels: at each frame.
+ *  - on_demand: only on the frames after the processor asked for them.
+ *  - gpu: never, e.g. for processors which only look at the size of the texture,
+ *    or forward it to an output as is.
+ */
+enum class texture_access : uint8_t
+{
+  pixels,
+  on_demand,
+  gpu
+};
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <atomic>
+#include <cstdint>
+
+namespace avnd
+{
+/**
+ * Wait-free single-producer / single-consumer exchange of a value.
+ *
+ * The producer writes into write_buffer() and calls publish(),
+ * the consumer calls consume() and, if it returns true, reads read_buffer().
+ * Neither side ever waits for the other nor allocates: the consumer
+ * only gets the most recently published value.
+ */
+template <typename T>
+class triple_buffer
+{
+public:
+  // Producer side
+  T& write_buffer() noexcept { return m_buffers[m_write]; }
+
+  void publish() noexcept
+  {
+    m_write = m_middle.exchange(m_write | dirty_bit, std::memory_order_acq_rel)
+              & index_mask;
+  }
+
+  // True if the last published value has not been consumed yet
+  bool pending() const noexcept
+  {
+    return m_middle.load(std::memory_order_acquire) & dirty_bit;
+  }
+
+  // Consumer side
+  bool consume() noexcept
+  {
+    if (!(m_middle.load(std::memory_order_relaxed) & dirty_bit))
+      return false;
+
+    m_read = m_middle.exchange(m_read, std::memory_order_acq_rel) & index_mask;
+    return true;
+  }
+
+  const T& read_buffer() const noexcept { return m_buffers[m_read]; }
+
+private:
+  static constexpr uint8_t index_mask = 0b011;
+  static constexpr uint8_t dirty_bit = 0b100;
+
+  T m_buffers[3]{};
+
+  // Each side only touches its own index and the shared one
+  alignas(64) std::atomic<uint8_t> m_middle{1};
+  alignas(64) uint8_t m_write{0};
+  alignas(64) uint8_t m_read{2};
+};
+}
@@ -7,6 +7,7 @@
 #include <avnd/concepts/callback.hpp>
 #include <avnd/concepts/channels.hpp>
 #include <avnd/concepts/fft.hpp>
+#include <avnd/concepts/fixed_point.hpp>
 #include <avnd/concepts/generic.hpp>
 #include <avnd/concepts/gfx.hpp>
 #include <avnd/concepts/message.hpp>
@@ -3,8 +3,11 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later OR BSL-1.0 OR CC0-1.0 OR CC-PDCC OR 0BSD */
 
 #include <avnd/common/concepts_polyfill.hpp>
+#include <avnd/concepts/fixed_point.hpp>
 #include <avnd/concepts/generic.hpp>
 
+#include <cstdint>
+
 namespace avnd
 {
 
@@ -60,6 +63,15 @@ struct is_poly_array_sample_port_q
       conditional_t<poly_array_sample_port<FP, T>, std::true_type, std::false_type>;
 };
 
+// struct { halp::q15** samples; }; see avnd/concepts/fixed_point.hpp
+template <typename T>
+concept fixed_point_bus_port = requires { T::samples; }
+    && fixed_point_sample<std::remove_cvref_t<decltype(**T::samples)>>;
+
+template <typename T>
+using is_fixed_point_bus_port
+    = std::conditional_t<fixed_point_bus_port<T>, std::true_type, std::false_type>;
+
 template <typename T>
 concept mono_audio_port = audio_sample_port<float, T> || audio_sample_port<
     double,
@@ -83,6 +95,28 @@ concept dynamic_poly_audio_port = poly_audio_port<T> && !fixed_poly_audio_port<T
 template <typename T>
 concept audio_port = mono_audio_port<T> || poly_audio_port<T>;
 
+// The bus gets the silent channels from the host, as a bit mask
+template <typename T>
+concept silence_flagged_audio_port = poly_audio_port<T> && requires(T t)
+{
+  t.silence = uint64_t{};
+};
+
+// The bus or channel gets its channels which are constant over the buffer from the host,
+// as a bit mask
+template <typename T>
+concept constant_flagged_audio_port = audio_port<T> && requires(T t)
+{
+  t.constant = uint64_t{};
+};
+
+// The host may leave the bus unconnected, e.g. a sidechain
+template <typename T>
+concept optional_audio_port = poly_audio_port<T> && requires(T t)
+{
+  t.connected = bool{};
+};
+
 int get_channels(fixed_poly_audio_port auto& port)
 {
   return port.channels();
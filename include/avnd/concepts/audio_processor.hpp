@@ -24,4 +24,48 @@ concept can_prepare = requires(T t)
   t.prepare({});
 };
 
+/**
+ * Processors which only work on buffers of a given size, e.g. built around an FFT:
+ *
+ * static constexpr int block_size = 256;
+ * or halp_meta(block_size, 256)
+ *
+ * The bindings then queue the audio so that they are only called with such buffers,
+ * at the cost of as many frames of latency. 0 when the processor takes any size.
+ */
+template <typename T>
+constexpr int fixed_block_size() noexcept
+{
+  if constexpr (requires { int(T::block_size()); })
+    return T::block_size();
+  else if constexpr (requires { int(T::block_size); })
+    return T::block_size;
+  else
+    return 0;
+}
+
+/**
+ * Processors with control-rate work, e.g. computing filter coefficients
+ * from the controls, done at a fixed interval instead of at every buffer:
+ *
+ * static constexpr int control_interval = 32;
+ * or halp_meta(control_interval, 32)
+ * void control() { ... }
+ *
+ * The bindings call control() every control_interval frames, whatever the size
+ * of the host buffers, and process the audio between two calls. 0 when there is none.
+ */
+template <typename T>
+constexpr int control_interval() noexcept
+{
+  if constexpr (requires { int(T::control_interval()); })
+    return T::control_interval();
+  else if constexpr (requires { int(T::control_interval); })
+    return T::control_interval;
+  else
+    return 0;
+}
+
+template <typename T>
+concept control_rate_processor = (control_interval<T>() > 0) && requires(T t) { t.control(); };
 }
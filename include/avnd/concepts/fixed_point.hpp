@@ -0,0 +1,21 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later OR BSL-1.0 OR CC0-1.0 OR CC-PDCC OR 0BSD */
+
+#include <avnd/common/concepts_polyfill.hpp>
+
+#include <type_traits>
+
+namespace avnd
+{
+// A fixed-point sample, whose value is raw / 2^fraction_bits, e.g. Q15:
+// struct { int16_t raw; static constexpr int fraction_bits = 15; };
+template <typename T>
+concept fixed_point_sample
+    = std::is_integral_v<decltype(T::raw)> && std::is_signed_v<decltype(T::raw)>
+      && sizeof(T) == sizeof(T::raw) && requires {
+           {
+             T::fraction_bits
+             } -> std::convertible_to<int>;
+         };
+}
@@ -51,6 +51,15 @@ template <typename T>
 concept uniform_port = requires {
   T::uniform();
 };
+
+// Texture processors which work on a band of rows of their output at a time,
+// tile(x, y, width, height), that the bindings can run on many threads:
+// see avnd::run_texture_tiles.
+template <typename T>
+concept tiled_texture_processor = requires(T t)
+{
+  t.tile(0, 0, 0, 0);
+};
 }
 
 /*
@@ -60,6 +60,23 @@ concept message = reflectable_message<T> && requires(T t)
     } -> string_ish;
 };
 
+/***
+ * static constexpr bool coalesce = true;
+ * Only the last of the calls received during a buffer is made,
+ * e.g. for setters where the previous values do not matter.
+ */
+template <typename T>
+concept coalesced_message = requires { requires bool(T::coalesce); };
+
+/***
+ * static constexpr bool timed = true;
+ * The last argument of the message is an int which does not come from the host:
+ * the binding passes the sample, in the next buffer the processor computes,
+ * at which the message is due, e.g. to start a note at that exact sample.
+ */
+template <typename T>
+concept timed_message = requires { requires bool(T::timed); };
+
 template <typename T>
 concept unreflectable_message =
     !reflectable_message<T> && requires(T t)
@@ -133,4 +150,10 @@ using second_message_argument
 template <typename M>
 using third_message_argument
     = boost::mp11::mp_third<typename message_reflection<M>::arguments>;
+
+// The arguments of a message which the host sends, i.e. without the frame of a timed_message
+template <typename M>
+using host_message_arguments = boost::mp11::mp_take_c<
+    typename message_reflection<M>::arguments,
+    message_reflection<M>::count - (timed_message<M> ? 1 : 0)>;
 }
@@ -6,6 +6,9 @@
 #include <avnd/concepts/generic.hpp>
 #include <avnd/concepts/midi.hpp>
 
+#include <cstddef>
+#include <type_traits>
+
 namespace avnd
 {
 
@@ -24,4 +27,54 @@ template <typename T>
 concept raw_container_midi_port = midi_port<T> && std::is_pointer_v<
     decltype(T::midi_messages)> && std::is_integral_v<decltype(T::size)>;
 
+// The expressions a host can send for each note
+enum class note_expression : unsigned char
+{
+  volume,     // linear gain, 1 by default
+  pan,        // 0 left, 0.5 center, 1 right
+  tuning,     // in semitones
+  vibrato,    // 0 to 1
+  expression, // 0 to 1
+  brightness, // 0 to 1, the timbre of MPE
+  pressure    // 0 to 1
+};
+
+/**
+ * A port with a table of the expressions of each note, e.g. halp::mpe_bus:
+ * the bindings write there the per-note expressions of the host with
+ * port.expressions.set(channel, key, expression, value), a negative channel or key
+ * meaning all of them, and pass the channel messages with
+ * port.expressions.update(bytes, size) for MPE.
+ */
+template <typename T>
+concept note_expression_midi_port
+    = midi_port<T> && requires(T t, const unsigned char* bytes)
+{
+  t.expressions.set(0, 0, note_expression::tuning, 0.);
+  t.expressions.update(bytes, std::size_t{});
+};
+
+/**
+ * A port which keeps the system exclusive messages apart from the others,
+ * e.g. halp::midi_event_bus: the bindings copy them with
+ * port.sysex.push(bytes, size, timestamp) instead of adding them to midi_messages.
+ */
+template <typename T>
+concept sysex_midi_port = midi_port<T> && requires(T t, const unsigned char* bytes)
+{
+  t.sysex.push(bytes, std::size_t{}, 0);
+  t.sysex.clear();
+};
+
+/**
+ * A sysex port which takes the bytes of the host without copying them,
+ * e.g. halp::midi_sysex_stream_bus: the bindings whose host keeps them until
+ * the end of the buffer give them with port.sysex.push_view(bytes, size, timestamp).
+ */
+template <typename T>
+concept sysex_view_midi_port = sysex_midi_port<T> && requires(T t, const unsigned char* bytes)
+{
+  t.sysex.push_view(bytes, std::size_t{}, 0);
+};
+
 }
@@ -3,6 +3,7 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later OR BSL-1.0 OR CC0-1.0 OR CC-PDCC OR 0BSD */
 
 #include <avnd/common/concepts_polyfill.hpp>
+#include <avnd/common/span_polyfill.hpp>
 #include <avnd/concepts/generic.hpp>
 #include <avnd/wrappers/widgets.hpp>
 
@@ -215,4 +216,89 @@ concept span_sample_accurate_parameter = sample_accurate_parameter<
 template <typename T>
 concept dynamic_sample_accurate_parameter = sample_accurate_parameter<
     T> && dynamic_timed_values<std::decay_t<decltype(T::values)>>;
+
+/**
+ * A smoothed parameter gets from the host a per-sample ramp going towards its value,
+ * or an empty span when the value is stable:
+ *
+ * struct {
+ *   static consteval double smoothing_time() { return 10.; } // in milliseconds
+ *   enum smoothing { exponential }; // or linear, the default
+ *   float value;
+ *   std::span<const float> ramp;
+ * };
+ */
+template <typename T>
+concept smoothed_parameter
+    = parameter<T> && std::floating_point<std::decay_t<decltype(T::value)>>
+      && requires(T t) {
+           { T::smoothing_time() } -> std::convertible_to<double>;
+           t.ramp = avnd::span<const std::decay_t<decltype(T::value)>>{};
+         };
+
+template <typename T>
+concept exponential_smoothed_parameter
+    = smoothed_parameter<T> && requires { T::smoothing::exponential; };
+
+/**
+ * A modulated parameter gets from the hosts which support modulation
+ * the modulation offset in a separate member instead of summed in its value:
+ *
+ * struct {
+ *   float value;
+ *   float modulation;
+ * };
+ */
+template <typename T>
+concept modulated_parameter = parameter<T> && requires(T t) {
+  t.modulation = std::decay_t<decltype(T::value)>{};
+};
+
+/**
+ * A modulatable parameter can be modulated at audio rate by the host, e.g. by an LFO
+ * or another audio signal. It gets the modulated value averaged over each buffer,
+ * or that of each sample if it has a span for them:
+ *
+ * struct {
+ *   enum { audio_rate_modulation };
+ *   float value; // the one set by the host, or the average of the modulated ones
+ *   std::span<const float> modulated; // empty without modulation
+ * };
+ */
+template <typename T>
+concept modulatable_parameter
+    = parameter<T> && std::floating_point<std::decay_t<decltype(T::value)>>
+      && requires { T::audio_rate_modulation; };
+
+template <typename T>
+concept audio_rate_modulated_parameter
+    = modulatable_parameter<T> && requires(T t) {
+        t.modulated = avnd::span<const std::decay_t<decltype(T::value)>>{};
+      };
+
+/**
+ * A change-flagged parameter gets from the host whether its value changed since the
+ * previous buffer, e.g. to only recompute what depends on it when it did:
+ *
+ * struct {
+ *   float value;
+ *   bool changed;
+ * };
+ */
+template <typename T>
+concept change_flagged_parameter = parameter<T> && requires(T t) { t.changed = true; };
+
+/**
+ * The morph control of a processor with programs: the bindings interpolate
+ * its other controls between the programs as it moves, see avnd::morph_storage.
+ *
+ * struct {
+ *   static constexpr bool morph_programs = true;
+ *   float value; // or an XY value
+ * };
+ */
+template <typename T>
+concept morph_parameter
+    = parameter<T> && (float_parameter<T> || xy_parameter<T>)
+      && requires { requires bool(T::morph_programs); };
 }
@@ -3,6 +3,7 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later OR BSL-1.0 OR CC0-1.0 OR CC-PDCC OR 0BSD */
 
 #include <avnd/common/function_reflection.hpp>
+#include <avnd/common/span_polyfill.hpp>
 #include <avnd/concepts/audio_port.hpp>
 #include <avnd/concepts/port.hpp>
 
@@ -20,27 +21,27 @@ template <typename T>
 concept has_tick = std::is_default_constructible_v<typename T::tick>;
 
 template <typename FP, typename T>
-static constexpr int sample_input_port_count = boost::mp11::
+inline constexpr int sample_input_port_count = boost::mp11::
     mp_count_if_q<typename inputs_type<T>::tuple, is_audio_sample_port_q<FP>>::value;
 template <typename FP, typename T>
-static constexpr int sample_output_port_count = boost::mp11::
+inline constexpr int sample_output_port_count = boost::mp11::
     mp_count_if_q<typename outputs_type<T>::tuple, is_audio_sample_port_q<FP>>::value;
 
 template <typename FP, typename T>
-static constexpr int mono_sample_array_input_port_count = boost::mp11::mp_count_if_q<
+inline constexpr int mono_sample_array_input_port_count = boost::mp11::mp_count_if_q<
     typename inputs_type<T>::tuple,
     is_mono_array_sample_port_q<FP>>::value;
 template <typename FP, typename T>
-static constexpr int mono_sample_array_output_port_count = boost::mp11::mp_count_if_q<
+inline constexpr int mono_sample_array_output_port_count = boost::mp11::mp_count_if_q<
     typename outputs_type<T>::tuple,
     is_mono_array_sample_port_q<FP>>::value;
 
 template <typename FP, typename T>
-static constexpr int poly_sample_array_input_port_count = boost::mp11::mp_count_if_q<
+inline constexpr int poly_sample_array_input_port_count = boost::mp11::mp_count_if_q<
     typename inputs_type<T>::tuple,
     is_poly_array_sample_port_q<FP>>::value;
 template <typename FP, typename T>
-static constexpr int poly_sample_array_output_port_count = boost::mp11::mp_count_if_q<
+inline constexpr int poly_sample_array_output_port_count = boost::mp11::mp_count_if_q<
     typename outputs_type<T>::tuple,
     is_poly_array_sample_port_q<FP>>::value;
 
@@ -141,6 +142,112 @@ concept mono_per_sample_port_processor
     = (sample_input_port_count<FP, T> == 1)
    && (sample_output_port_count<FP, T> == 1)
    && mono_per_sample_port_invocations<FP, T>;
+
+// Optional SIMD-friendly entry point for mono_per_sample_port_processor:
+// processes N consecutive samples of a channel in a single call, e.g.
+// void operator()(const inputs& ins, std::span<const float, 4> in, std::span<float, 4> out);
+template <typename FP, typename T, std::size_t N>
+concept mono_per_sample_port_batch_invocations =
+    (std::is_invocable_r_v<void, T, const typename T::inputs&, avnd::span<const FP, N>, avnd::span<FP, N>>
+  || std::is_invocable_r_v<void, T, const typename T::inputs&, typename T::outputs&, avnd::span<const FP, N>, avnd::span<FP, N>>);
+
+// Optional structure-of-arrays storage of the per-channel state of a mono_per_sample_port_processor:
+// the instances get their state as an argument, and the states of all the channels are stored
+// field by field. The channel loop then goes through contiguous arrays, e.g.
+// struct state { float prev{}; };
+// using simd_state = state;
+// void operator()(const inputs& ins, outputs& outs, simd_state& s);
+template <typename T>
+concept mono_per_sample_port_simd_state =
+    std::is_aggregate_v<typename T::simd_state>
+ && std::is_invocable_r_v<void, T, const typename T::inputs&, typename T::outputs&, typename T::simd_state&>;
+
+// Optional lane-wise entry point of a mono_per_sample_port_simd_state processor:
+// processes one sample of N channels in a single call, with the states of these channels,
+// so that a processor written for one channel runs on N of them per instruction, e.g.
+// void operator()(const inputs& ins, std::span<const float, 4> in, std::span<float, 4> out,
+//                 std::span<state, 4> s);
+template <typename FP, typename T, std::size_t N>
+concept mono_per_sample_port_lane_invocations =
+    mono_per_sample_port_simd_state<T>
+ && std::is_invocable_r_v<void, T, const typename T::inputs&, avnd::span<const FP, N>, avnd::span<FP, N>, avnd::span<typename T::simd_state, N>>;
+
+// The processor supports getting the same buffers as input and output,
+// e.g. in a batched operator() writing out[i] only after having read in[i]:
+// static constexpr bool in_place_safe = true;
+template <typename T>
+concept in_place_safe_processor = requires { requires bool(T::in_place_safe); };
+
+// The instances of a duplicated monophonic processor are each stored on their own
+// cache lines, apart from the inputs they share when they are a type: the per-sample
+// state of one channel does not share lines with the controls, strings and files of
+// the inputs, nor with the state of the channels processed by other threads.
+// static constexpr bool cache_aligned = true;
+template <typename T>
+concept cache_aligned_processor = requires { requires bool(T::cache_aligned); };
+
+// The outputs of the processor only depend on its inputs, e.g. control logic:
+// bindings may skip running it when none of its inputs changed.
+// static constexpr bool pure_controls = true;
+template <typename T>
+concept pure_controls_processor = requires { requires bool(T::pure_controls); };
+
+// The processor gets which of its controls changed since the previous buffer:
+// bit i of changed_controls is set when the i-th control input did, e.g.
+// std::bitset<3> changed_controls;
+template <typename T>
+concept changed_controls_processor = requires(T t)
+{
+  t.changed_controls.reset();
+  t.changed_controls[0] = true;
+  t.changed_controls.size();
+};
+
+// The bindings only send the outputs whose value changed since they last sent them,
+// e.g. for analysis objects with many outputs which mostly hold still:
+// static constexpr bool changed_outputs_only = true;
+template <typename T>
+concept changed_outputs_processor = requires { requires bool(T::changed_outputs_only); };
+
+// The processor splits its work in tasks on its own, e.g. per voice,
+// and gets the worker threads of the binding through a member such as halp::task_runner:
+// struct { bool (*request)(void* pool, int tasks, void (*job)(void*, int), void* context); void* pool; } tasks;
+template <typename T>
+concept task_runner_processor = requires(T t)
+{
+  t.tasks.request;
+  t.tasks.pool;
+};
+
+// The processor has work which must not run in the audio thread, e.g. loading a file,
+// done by the binding on a background thread, and whose result is applied between two buffers:
+// struct { std::function<void(Request...)> request; static Response work(Request...); } worker;
+// Response is called with the processor, e.g. a std::function<void(T&)>.
+template <typename T>
+concept worker_processor = requires(T t)
+{
+  t.worker.request;
+  &std::decay_t<decltype(t.worker)>::work;
+};
+
+// The processor gets the messages of all its MIDI inputs in a single list sorted by
+// timestamp, merged by the binding in a member such as halp::merged_midi, with
+// merged_midi.merged_messages.push_back({bytes, timestamp, index of the input}).
+template <typename T>
+concept merged_midi_processor = requires(T t)
+{
+  t.merged_midi.merged_messages.clear();
+};
+
+// The output busses are independent of each other, and rendered one at a time
+// by process_bus(bus, frames), that the bindings can run on many threads:
+// see avnd::run_output_busses.
+template <typename T>
+concept per_bus_processor = requires(T t)
+{
+  t.process_bus(0, 0);
+};
+
 template <typename FP, typename T>
 concept poly_per_sample_port_processor =
     ((sample_input_port_count<FP, T> > 1)
@@ -238,6 +345,35 @@ concept float_processor = typed_processor<float, T>;
 template <typename T>
 concept double_processor = typed_processor<double, T>;
 
+template <typename T>
+inline constexpr int fixed_point_bus_input_count = boost::mp11::
+    mp_count_if<typename inputs_type<T>::tuple, is_fixed_point_bus_port>::value;
+template <typename T>
+inline constexpr int fixed_point_bus_output_count = boost::mp11::
+    mp_count_if<typename outputs_type<T>::tuple, is_fixed_point_bus_port>::value;
+
+// Processes fixed-point samples, e.g. for chips without FPU or int16 streams:
+// at most one input bus, and one output bus, of the same fixed_point_sample type.
+// struct { halp::dynamic_audio_bus<"In", halp::q15> audio; } inputs;
+template <typename T>
+concept fixed_point_processor
+    = !float_processor<T> && !double_processor<T> && fixed_point_bus_input_count<T>
+<= 1 && fixed_point_bus_output_count<T> == 1;
+
+// Index of the fixed-point bus in the inputs, resp. outputs
+template <typename T>
+inline constexpr int fixed_point_input_bus_index = boost::mp11::
+    mp_find_if<typename inputs_type<T>::tuple, is_fixed_point_bus_port>::value;
+template <typename T>
+inline constexpr int fixed_point_output_bus_index = boost::mp11::
+    mp_find_if<typename outputs_type<T>::tuple, is_fixed_point_bus_port>::value;
+
+template <typename T>
+using fixed_point_sample_type = std::remove_cvref_t<
+    decltype(**boost::mp11::mp_at_c<
+             typename outputs_type<T>::tuple,
+             fixed_point_output_bus_index<T>>::samples)>;
+
 template <typename T>
 concept monophonic_audio_processor
     = monophonic_processor<float, T> || monophonic_processor<double, T>;
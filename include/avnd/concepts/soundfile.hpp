@@ -5,6 +5,10 @@
 #include <avnd/common/concepts_polyfill.hpp>
 #include <avnd/concepts/generic.hpp>
 
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
 namespace avnd
 {
 
@@ -19,4 +23,37 @@ concept soundfile = requires(T t)
 template <typename T>
 concept soundfile_port = soundfile<std::decay_t<decltype(std::declval<T>().soundfile)>>;
 
+/**
+ * A soundfile read from the disk by the host while the processor plays it:
+ * only a window of frames around the playback position is available.
+ */
+template <typename T>
+concept soundfile_stream = requires(T t, float* out)
+{
+  t.read(t.stream, int32_t{}, int64_t{}, out, int64_t{});
+  t.play_from(t.stream, int64_t{});
+  t.frames;
+  t.channels;
+};
+
+template <typename T>
+concept soundfile_stream_port
+    = soundfile_stream<std::decay_t<decltype(std::declval<T>().soundfile)>>;
+
+/**
+ * A soundfile written to the disk by the host while the processor records:
+ * the frames go through a ring buffer to a thread which encodes them.
+ */
+template <typename T>
+concept soundfile_recorder = requires(T t, const float* const* in)
+{
+  t.write(t.stream, in, int64_t{});
+  t.open(t.stream, std::string_view{});
+  t.channels;
+};
+
+template <typename T>
+concept soundfile_recorder_port
+    = soundfile_recorder<std::decay_t<decltype(std::declval<T>().soundfile)>>;
+
 }
@@ -194,6 +194,39 @@ static constexpr int output_channels(int if_undefined = undefined_channels)
   return output_channels_introspection<T>::output_channels;
 }
 
+/// Upper bound of the channels the host may give to a processor whose channels
+/// are dynamic, e.g. static constexpr int max_channels = 8;
+/// Everything depending on the channels can then be allocated once for it.
+template <typename T>
+static constexpr int max_input_channels(int if_undefined = 0)
+{
+  if constexpr (requires { int(T::max_input_channels()); })
+    return T::max_input_channels();
+  else if constexpr (requires { int(T::max_input_channels); })
+    return T::max_input_channels;
+  else if constexpr (requires { int(T::max_channels()); })
+    return T::max_channels();
+  else if constexpr (requires { int(T::max_channels); })
+    return T::max_channels;
+  else
+    return if_undefined;
+}
+
+template <typename T>
+static constexpr int max_output_channels(int if_undefined = 0)
+{
+  if constexpr (requires { int(T::max_output_channels()); })
+    return T::max_output_channels();
+  else if constexpr (requires { int(T::max_output_channels); })
+    return T::max_output_channels;
+  else if constexpr (requires { int(T::max_channels()); })
+    return T::max_channels();
+  else if constexpr (requires { int(T::max_channels); })
+    return T::max_channels;
+  else
+    return if_undefined;
+}
+
 /// Bus introspection
 template <typename T>
 struct bus_introspection
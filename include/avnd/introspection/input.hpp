@@ -40,6 +40,18 @@ struct dynamic_timed_parameter_input_introspection
 {
 };
 
+template <typename T>
+struct smoothed_parameter_input_introspection
+    : smoothed_parameter_introspection<typename inputs_type<T>::type>
+{
+};
+
+template <typename T>
+struct modulatable_parameter_input_introspection
+    : modulatable_parameter_introspection<typename inputs_type<T>::type>
+{
+};
+
 template <typename T>
 struct midi_input_introspection : midi_port_introspection<typename inputs_type<T>::type>
 {
@@ -105,6 +117,12 @@ struct soundfile_input_introspection
 {
 };
 
+template <typename T>
+struct soundfile_stream_input_introspection
+    : soundfile_stream_introspection<typename inputs_type<T>::type>
+{
+};
+
 template <typename T>
 struct input_introspection : fields_introspection<typename inputs_type<T>::type>
 {
@@ -6,6 +6,10 @@
 #include <avnd/concepts/message.hpp>
 #include <avnd/wrappers/effect_container.hpp>
 
+#include <algorithm>
+#include <array>
+#include <string_view>
+
 namespace avnd
 {
 template <typename T>
@@ -49,4 +53,47 @@ static constexpr void for_all_messages(T& obj, auto&& func) noexcept
     boost::pfr::for_each_field(get_messages(obj), func);
   }
 }
+
+/**
+ * The names of the messages of T, sorted at compile-time:
+ * finding a message from its name is a binary search instead of
+ * a comparison with every name.
+ */
+template <typename T>
+struct message_name_table
+{
+  using type = typename messages_type<T>::type;
+  static constexpr int size = messages_introspection<T>::size;
+
+  struct entry
+  {
+    std::string_view name;
+    int index{};
+  };
+
+  static constexpr std::array<entry, size> entries = []
+  {
+    std::array<entry, size> e;
+    [&]<std::size_t... I>(std::index_sequence<I...>)
+    {
+      ((e[I] = {std::string_view{avnd::field_type<I, type>::name()}, int(I)}), ...);
+    }
+    (std::make_index_sequence<size>{});
+    std::sort(e.begin(), e.end(), [](const entry& lhs, const entry& rhs) {
+      return lhs.name < rhs.name;
+    });
+    return e;
+  }();
+
+  // Index of the message field in the messages struct, or -1
+  static constexpr int find(std::string_view name) noexcept
+  {
+    auto it = std::lower_bound(
+        entries.begin(), entries.end(), name,
+        [](const entry& e, std::string_view n) { return e.name < n; });
+    if (it != entries.end() && it->name == name)
+      return it->index;
+    return -1;
+  }
+};
 }
@@ -8,9 +8,48 @@
 #include <avnd/introspection/port.hpp>
 #include <boost/mp11.hpp>
 
+#include <array>
+#include <cstdint>
+#include <iterator>
+
 namespace avnd
 {
 
+// Number of bytes of a message which is not system exclusive, from its status
+constexpr int midi_message_size(unsigned char status) noexcept
+{
+  switch (status & 0xF0)
+  {
+    case 0xC0:
+    case 0xD0:
+      return 2;
+    case 0xF0:
+      switch (status)
+      {
+        case 0xF1:
+        case 0xF3:
+          return 2;
+        case 0xF2:
+          return 3;
+        default:
+          return 1;
+      }
+    default:
+      return 3;
+  }
+}
+
+// The bytes of a message, whatever the way its port stores them
+template <typename M>
+avnd::span<const unsigned char> midi_message_bytes(const M& m) noexcept
+{
+  const auto* bytes = reinterpret_cast<const unsigned char*>(std::data(m.bytes));
+  if constexpr (raw_midi_message<M>)
+    return {bytes, std::size_t(midi_message_size(bytes[0]))};
+  else
+    return {bytes, std::size(m.bytes)};
+}
+
 template <raw_container_midi_port Field>
 using midi_message_type
     = std::remove_pointer_t<std::remove_reference_t<decltype(Field::midi_messages)>>;
@@ -111,9 +150,39 @@ struct midi_storage
     dyn_midi_out_info::for_all(avnd::get_outputs(t), init_dyn);
   }
 
+  // Frees what reserve_space allocated, e.g. when the host deactivates the processor
+  void release(avnd::effect_container<T>& t)
+  {
+    if constexpr (raw_midi_in_info::size > 0)
+    {
+      raw_midi_in_info::for_all_n(
+          avnd::get_inputs(t), [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+            std::get<Idx>(this->inputs_storage) = {};
+            port.midi_messages = nullptr;
+            port.size = 0;
+          });
+    }
+
+    if constexpr (raw_midi_out_info::size > 0)
+    {
+      raw_midi_out_info::for_all_n(
+          avnd::get_outputs(t), [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+            std::get<Idx>(this->outputs_storage) = {};
+            port.midi_messages = nullptr;
+            port.size = 0;
+          });
+    }
+
+    auto release_dyn = [&](auto& port) { port.midi_messages = {}; };
+    dyn_midi_in_info::for_all(avnd::get_inputs(t), release_dyn);
+    dyn_midi_out_info::for_all(avnd::get_outputs(t), release_dyn);
+  }
+
   void do_clear(avnd::dynamic_container_midi_port auto& port)
   {
     port.midi_messages.clear();
+    if constexpr (avnd::sysex_midi_port<std::decay_t<decltype(port)>>)
+      port.sysex.clear();
   }
 
   void do_clear(avnd::raw_container_midi_port auto& port) { port.size = 0; }
@@ -128,9 +197,93 @@ struct midi_storage
     }
   }
 
+  // Calls f(bytes, timestamp, index of the port) for the messages of the ports of Info
+  // in the order of their timestamps: a k-way merge, as each port is already sorted.
+  // The system exclusive messages of the ports which keep them apart are merged too.
+  template <typename Info>
+  static void for_each_in_order(auto&& ports, auto&& f)
+  {
+    // Two sorted lists per port: its messages, and its sysex
+    std::array<std::size_t, 2 * Info::size> next{};
+    while (true)
+    {
+      int best = -1;
+      int64_t best_time = 0;
+      auto pick = [&](int list, const auto& messages, std::size_t count) {
+        if (next[list] < count)
+        {
+          const int64_t time = messages[next[list]].timestamp;
+          if (best < 0 || time < best_time)
+          {
+            best = list;
+            best_time = time;
+          }
+        }
+      };
+      Info::for_all_n(ports, [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+        pick(2 * Idx, port.midi_messages, message_count(port));
+        if constexpr (avnd::sysex_midi_port<M>)
+          pick(2 * Idx + 1, port.sysex, port.sysex.size());
+      });
+      if (best < 0)
+        break;
+
+      Info::for_all_n(ports, [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+        if (best == 2 * Idx)
+        {
+          const auto& m = port.midi_messages[next[best]++];
+          f(midi_message_bytes(m), int32_t(m.timestamp), int(Idx));
+        }
+        else if constexpr (avnd::sysex_midi_port<M>)
+        {
+          if (best == 2 * Idx + 1)
+          {
+            const auto& m = port.sysex[next[best]++];
+            f(avnd::span<const unsigned char>{m.bytes.data(), m.bytes.size()},
+              int32_t(m.timestamp), int(Idx));
+          }
+        }
+      });
+    }
+  }
+
+  // Once the MIDI inputs are filled, e.g. before calling the processor:
+  // merges their messages, already sorted by the host, see merged_midi_processor.
+  void merge_inputs(avnd::effect_container<T>& t)
+  {
+    if constexpr (avnd::merged_midi_processor<T> && midi_in_info::size > 0)
+    {
+      for (auto& impl : t.effects())
+      {
+        auto& merged = impl.merged_midi.merged_messages;
+        merged.clear();
+        for_each_in_order<midi_in_info>(
+            avnd::get_inputs(t), [&](auto bytes, int32_t timestamp, int port) {
+          merged.push_back({bytes, timestamp, port});
+        });
+      }
+    }
+  }
+
+  // After processing: the messages of the MIDI outputs, sorted, for the host
+  void for_each_output_in_order(avnd::effect_container<T>& t, auto&& f)
+  {
+    if constexpr (midi_out_info::size > 0)
+      for_each_in_order<midi_out_info>(avnd::get_outputs(t), f);
+  }
+
+  static std::size_t message_count(const avnd::dynamic_container_midi_port auto& port)
+  {
+    return std::size(port.midi_messages);
+  }
+  static std::size_t message_count(const avnd::raw_container_midi_port auto& port)
+  {
+    return port.size;
+  }
+
   void clear_outputs(avnd::effect_container<T>& t)
   {
-    if constexpr (midi_in_info::size > 0)
+    if constexpr (midi_out_info::size > 0)
     {
       auto clearer = [this](auto&& port) { this->do_clear(port); };
 
@@ -100,6 +100,12 @@ struct callback_output_introspection
 {
 };
 
+template <typename T>
+struct soundfile_recorder_output_introspection
+    : soundfile_recorder_introspection<typename outputs_type<T>::type>
+{
+};
+
 template <typename T>
 struct output_introspection : fields_introspection<typename outputs_type<T>::type>
 {
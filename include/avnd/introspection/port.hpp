@@ -55,6 +55,18 @@ template <typename T>
 using dynamic_timed_parameter_introspection
     = predicate_introspection<T, is_dynamic_timed_parameter_t>;
 
+template <typename Field>
+using is_smoothed_parameter_t = boost::mp11::mp_bool<smoothed_parameter<Field>>;
+template <typename T>
+using smoothed_parameter_introspection
+    = predicate_introspection<T, is_smoothed_parameter_t>;
+
+template <typename Field>
+using is_modulatable_parameter_t = boost::mp11::mp_bool<modulatable_parameter<Field>>;
+template <typename T>
+using modulatable_parameter_introspection
+    = predicate_introspection<T, is_modulatable_parameter_t>;
+
 template <typename Field>
 using is_midi_port_t = boost::mp11::mp_bool<midi_port<Field>>;
 template <typename T>
@@ -148,4 +160,14 @@ using is_soundfile_t = boost::mp11::mp_bool<soundfile_port<Field>>;
 template <typename T>
 using soundfile_introspection = predicate_introspection<T, is_soundfile_t>;
 
+template <typename Field>
+using is_soundfile_stream_t = boost::mp11::mp_bool<soundfile_stream_port<Field>>;
+template <typename T>
+using soundfile_stream_introspection = predicate_introspection<T, is_soundfile_stream_t>;
+
+template <typename Field>
+using is_soundfile_recorder_t = boost::mp11::mp_bool<soundfile_recorder_port<Field>>;
+template <typename T>
+using soundfile_recorder_introspection = predicate_introspection<T, is_soundfile_recorder_t>;
+
 }
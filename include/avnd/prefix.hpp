@@ -58,6 +58,7 @@
 #include <avnd/wrappers/controls_fp.hpp>
 #include <avnd/wrappers/controls_storage.hpp>
 #include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
 #include <avnd/wrappers/metadatas.hpp>
 #include <avnd/wrappers/prepare.hpp>
 #include <avnd/wrappers/process_adapter.hpp>
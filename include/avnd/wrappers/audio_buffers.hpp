@@ -0,0 +1,237 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/freestanding.hpp>
+#include <avnd/concepts/fixed_point.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AVND_AUDIO_BUFFERS_SSE2 1
+#endif
+
+namespace avnd
+{
+// Alignment of the temporary audio buffers: one cache line, which is
+// enough for any SIMD register width we care about
+static constexpr std::size_t audio_buffer_alignment = 64;
+
+constexpr std::size_t align_audio_buffer(std::size_t bytes) noexcept
+{
+  return (bytes + audio_buffer_alignment - 1) & ~(audio_buffer_alignment - 1);
+}
+
+/**
+ * A single aligned memory block, in which the various buffers needed by a
+ * process adapter are laid out.
+ */
+#if AVND_FREESTANDING
+// Without heap, the block is a member of AVND_FREESTANDING_ARENA_BYTES: a processor
+// which needs more stops when it is prepared, instead of overflowing in the audio thread
+class audio_buffer_arena
+{
+public:
+  std::byte* reserve(std::size_t bytes) noexcept
+  {
+    if (bytes > sizeof(m_storage))
+      std::abort();
+    m_capacity = std::max(m_capacity, bytes);
+    return m_storage;
+  }
+
+  std::byte* data() noexcept { return m_capacity > 0 ? m_storage : nullptr; }
+  const std::byte* data() const noexcept { return m_capacity > 0 ? m_storage : nullptr; }
+  std::size_t capacity() const noexcept { return m_capacity; }
+
+private:
+  alignas(audio_buffer_alignment) std::byte m_storage[AVND_FREESTANDING_ARENA_BYTES];
+  std::size_t m_capacity{};
+};
+#else
+class audio_buffer_arena
+{
+public:
+  // Only reallocates when growing
+  std::byte* reserve(std::size_t bytes)
+  {
+    if (bytes > m_capacity)
+    {
+      m_storage.reset(static_cast<std::byte*>(
+          ::operator new(bytes, std::align_val_t{audio_buffer_alignment})));
+      m_capacity = bytes;
+    }
+    return m_storage.get();
+  }
+
+  std::byte* data() const noexcept { return m_storage.get(); }
+  std::size_t capacity() const noexcept { return m_capacity; }
+
+private:
+  struct deleter
+  {
+    void operator()(std::byte* ptr) const noexcept
+    {
+      ::operator delete(ptr, std::align_val_t{audio_buffer_alignment});
+    }
+  };
+
+  std::unique_ptr<std::byte, deleter> m_storage;
+  std::size_t m_capacity{};
+};
+#endif
+
+/**
+ * Computes the offsets of consecutive, aligned sub-buffers in an arena.
+ */
+struct audio_buffer_layout
+{
+  std::size_t bytes{};
+
+  template <typename U>
+  std::size_t push(std::size_t count) noexcept
+  {
+    const std::size_t offset = align_audio_buffer(bytes);
+    bytes = offset + count * sizeof(U);
+    return offset;
+  }
+};
+
+/**
+ * View on a set of channels stored in an arena.
+ * Each channel starts on an aligned address.
+ */
+template <typename FP>
+struct channel_buffers
+{
+  FP* storage{};
+  std::size_t stride{};
+
+  // Number of elements between two channels for a given buffer size
+  static constexpr std::size_t stride_for(std::size_t frames) noexcept
+  {
+    return align_audio_buffer(frames * sizeof(FP)) / sizeof(FP);
+  }
+
+  FP* data() const noexcept { return storage; }
+  FP* channel(int c) const noexcept { return storage + c * stride; }
+};
+
+/**
+ * Sample type conversion, e.g. when the host sends floats to a double processor
+ * or conversely. The buffers must not overlap.
+ */
+template <typename Src, typename Dst>
+inline void
+convert_samples(const Src* __restrict in, Dst* __restrict out, std::size_t n) noexcept
+{
+  if constexpr (std::is_same_v<Src, Dst>)
+  {
+    std::copy_n(in, n, out);
+  }
+  else
+  {
+    std::size_t i = 0;
+#if defined(AVND_AUDIO_BUFFERS_SSE2)
+    if constexpr (std::is_same_v<Src, float> && std::is_same_v<Dst, double>)
+    {
+      for (; i + 4 <= n; i += 4)
+      {
+        const __m128 v = _mm_loadu_ps(in + i);
+        _mm_storeu_pd(out + i, _mm_cvtps_pd(v));
+        _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+      }
+    }
+    else if constexpr (std::is_same_v<Src, double> && std::is_same_v<Dst, float>)
+    {
+      for (; i + 4 <= n; i += 4)
+      {
+        const __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(in + i));
+        const __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(in + i + 2));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(lo, hi));
+      }
+    }
+#endif
+    for (; i < n; i++)
+      out[i] = static_cast<Dst>(in[i]);
+  }
+}
+
+/**
+ * Conversion to fixed-point samples, e.g. Q15: rounded to the nearest and
+ * saturated, thus a host sending samples outside of [-1; 1] clips instead of
+ * wrapping around. Q31 goes through double, as a float does not have 31 bits.
+ */
+template <std::floating_point Src, fixed_point_sample Dst>
+inline void
+convert_samples(const Src* __restrict in, Dst* __restrict out, std::size_t n) noexcept
+{
+  using raw_type = decltype(Dst::raw);
+  using calc_type = std::conditional_t<(sizeof(raw_type) < 4), float, double>;
+  constexpr calc_type scale = calc_type(int64_t(1) << Dst::fraction_bits);
+  constexpr calc_type lo = std::numeric_limits<raw_type>::min();
+  constexpr calc_type hi = std::numeric_limits<raw_type>::max();
+
+  for (std::size_t i = 0; i < n; i++)
+  {
+    // Written for the loop to vectorize: the rounding is a truncation after
+    // adding +/- 0.5, and the clamping comes after it, NaN going to lo
+    calc_type v = calc_type(in[i]) * scale;
+    v += std::copysign(calc_type(0.5), v);
+    v = lo < v ? v : lo;
+    v = v < hi ? v : hi;
+    out[i].raw = raw_type(v);
+  }
+}
+
+// And back: the scaling is exact, except for Q31 to float which rounds
+template <fixed_point_sample Src, std::floating_point Dst>
+inline void
+convert_samples(const Src* __restrict in, Dst* __restrict out, std::size_t n) noexcept
+{
+  constexpr Dst scale = Dst(1. / double(int64_t(1) << Src::fraction_bits));
+  for (std::size_t i = 0; i < n; i++)
+    out[i] = Dst(in[i].raw) * scale;
+}
+
+/**
+ * One channel of an interleaved buffer: its samples are stride apart.
+ */
+template <typename FP>
+struct strided_channel
+{
+  FP* samples{};
+  int stride{1};
+
+  FP& operator[](std::size_t frame) const noexcept { return samples[frame * stride]; }
+};
+
+/**
+ * Frames of interleaved samples, as some audio APIs and network receivers give them:
+ * channel c of frame i is samples[i * channels + c].
+ */
+template <typename FP>
+struct interleaved_buffer
+{
+  FP* samples{};
+  int channels{};
+  int frames{};
+
+  FP& operator()(int channel, int frame) const noexcept
+  {
+    return samples[std::size_t(frame) * channels + channel];
+  }
+
+  strided_channel<FP> channel(int c) const noexcept { return {samples + c, channels}; }
+};
+}
@@ -7,6 +7,8 @@
 #include <avnd/introspection/channels.hpp>
 #include <avnd/wrappers/effect_container.hpp>
 
+#include <optional>
+
 namespace avnd
 {
 /**
@@ -436,11 +438,103 @@ requires(
   int actual_runtime_outputs = 0;
 };
 
+/**
+ * Fixed-point processors: at most one input bus and one output bus.
+ * A dynamic output bus follows the input bus, like for the floating-point busses.
+ */
+template <typename T>
+requires avnd::fixed_point_processor<T>
+struct audio_channel_manager<T>
+{
+  static constexpr bool has_input_bus = avnd::fixed_point_bus_input_count<T> > 0;
+
+  explicit audio_channel_manager(avnd::effect_container<T>& eff)
+  {
+    if constexpr (has_input_bus)
+      actual_runtime_inputs = init(input_bus(eff));
+    actual_runtime_outputs = init(output_bus(eff));
+  }
+
+  static auto& input_bus(avnd::effect_container<T>& eff)
+  {
+    return boost::pfr::get<avnd::fixed_point_input_bus_index<T>>(eff.inputs());
+  }
+  static auto& output_bus(avnd::effect_container<T>& eff)
+  {
+    return boost::pfr::get<avnd::fixed_point_output_bus_index<T>>(eff.outputs());
+  }
+
+  template <typename P>
+  static int init(P& bus)
+  {
+    if constexpr (requires { P::channels(); })
+      return P::channels();
+    else
+      return bus.channels = 0;
+  }
+
+  // Returns the channels of the bus once set, or -1 when it cannot have that many
+  template <typename P>
+  static int set(P& bus, int channels)
+  {
+    if constexpr (requires { P::channels(); })
+      return P::channels() == channels ? channels : -1;
+    else
+      return bus.channels = channels;
+  }
+
+  bool set_input_channels(avnd::effect_container<T>& eff, int input_id, int channels)
+  {
+    if constexpr (has_input_bus)
+    {
+      if (input_id != 0)
+        return false;
+      const int res = set(input_bus(eff), channels);
+      if (res < 0)
+        return false;
+      actual_runtime_inputs = res;
+
+      auto& out = output_bus(eff);
+      if constexpr (!requires { std::remove_reference_t<decltype(out)>::channels(); })
+        actual_runtime_outputs = out.channels = res;
+      return true;
+    }
+    else
+    {
+      return channels == 0;
+    }
+  }
+
+  bool set_output_channels(avnd::effect_container<T>& eff, int output_id, int channels)
+  {
+    if (output_id != 0)
+      return false;
+    const int res = set(output_bus(eff), channels);
+    if (res < 0)
+      return false;
+    actual_runtime_outputs = res;
+    return true;
+  }
+
+  int get_input_channels(auto& processor, int input_id)
+  {
+    return input_id == 0 ? actual_runtime_inputs : 0;
+  }
+
+  int get_output_channels(auto& processor, int output_id)
+  {
+    return output_id == 0 ? actual_runtime_outputs : 0;
+  }
+
+  int actual_runtime_inputs = 0;
+  int actual_runtime_outputs = 0;
+};
+
 // Case for everything that does not handle audio
 template <typename T>
 requires(
     !avnd::float_processor<
-        T> && !avnd::double_processor<T>) struct audio_channel_manager<T>
+        T> && !avnd::double_processor<T> && !avnd::fixed_point_processor<T>) struct audio_channel_manager<T>
 {
   static constexpr const int detected_input_channels
       = avnd::input_channels_introspection<T>::input_channels;
@@ -0,0 +1,100 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace avnd
+{
+/**
+ * A thread running jobs one after the other, for the work which must not happen
+ * in the audio thread: loading and converting files, freeing large buffers...
+ *
+ * Posting a job takes a lock and may allocate: this is meant for rare requests,
+ * e.g. when the user picks a file, not for something done at every buffer.
+ * The thread sleeps on an atomic counter of the posted jobs, as the thread_pool
+ * workers do, so waking it up does not go through a condition variable.
+ */
+class background_worker
+{
+public:
+  background_worker() = default;
+  background_worker(const background_worker&) = delete;
+  background_worker& operator=(const background_worker&) = delete;
+
+  ~background_worker()
+  {
+    {
+      std::lock_guard lock{m_mutex};
+      m_stop = true;
+    }
+    wake();
+    if (m_thread.joinable())
+      m_thread.join();
+  }
+
+  // Shared by all the processors of a process
+  static background_worker& shared()
+  {
+    static background_worker worker;
+    return worker;
+  }
+
+  void post(std::function<void()> job)
+  {
+    {
+      std::lock_guard lock{m_mutex};
+      m_jobs.push_back(std::move(job));
+      if (!m_thread.joinable())
+        m_thread = std::thread{[this] { run(); }};
+    }
+    wake();
+  }
+
+private:
+  void wake() noexcept
+  {
+    m_posted.fetch_add(1, std::memory_order_release);
+    m_posted.notify_one();
+  }
+
+  void run()
+  {
+    for (;;)
+    {
+      // Read before looking at the queue: a job posted after that changes it
+      const uint32_t seen = m_posted.load(std::memory_order_acquire);
+
+      std::function<void()> job;
+      {
+        std::lock_guard lock{m_mutex};
+        if (m_stop)
+          return;
+
+        if (!m_jobs.empty())
+        {
+          job = std::move(m_jobs.front());
+          m_jobs.pop_front();
+        }
+      }
+
+      if (job)
+        job();
+      else
+        m_posted.wait(seen, std::memory_order_acquire);
+    }
+  }
+
+  std::mutex m_mutex;
+  std::atomic<uint32_t> m_posted{0};
+  std::deque<std::function<void()>> m_jobs;
+  std::thread m_thread;
+  bool m_stop{};
+};
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/span_polyfill.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/latency.hpp>
+#include <avnd/wrappers/output_parameters.hpp>
+#include <avnd/wrappers/prepare.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace avnd
+{
+// The id of the bypass parameter in the bindings which expose one to the host
+static constexpr uint32_t bypass_parameter_id = output_parameter_id_bit - 1;
+
+// How long switching the bypass crossfades, e.g. halp_meta(bypass_fade_seconds, 0.) for not at all
+template <typename T>
+constexpr double bypass_fade_seconds() noexcept
+{
+  if constexpr (requires { double(T::bypass_fade_seconds()); })
+    return T::bypass_fade_seconds();
+  else if constexpr (requires { double(T::bypass_fade_seconds); })
+    return T::bypass_fade_seconds;
+  else
+    return 0.01;
+}
+
+/**
+ * Bypass of the host, for any processor: while bypassed, the processor is not called
+ * and its outputs get its inputs, delayed by its latency so that they stay aligned
+ * with the other tracks and the switch does not click.
+ * Switching crossfades between the two over bypass_fade_seconds, 10 ms by default.
+ *
+ * The inputs of the last latency frames are kept at every buffer, which is
+ * the only cost while the processor runs. The delay is sized by reserve_delay()
+ * after prepare(): a latency which grows beyond it is clamped until the next one.
+ */
+template <typename T>
+struct bypass_adapter : host_process_adapter<T>
+{
+  using adapter_type = host_process_adapter<T>;
+
+  // Can be called from any thread
+  void set_bypass(bool b) noexcept { m_requested.store(b, std::memory_order_relaxed); }
+  bool bypass() const noexcept { return m_requested.load(std::memory_order_relaxed); }
+
+  template <std::floating_point FP>
+  void allocate_buffers(process_setup setup, FP f)
+  {
+    adapter_type::allocate_buffers(setup, f);
+    dry_for(f).allocate(
+        std::max(setup.input_channels, setup.max_input_channels),
+        setup.frames_per_buffer);
+    m_length = std::max(int(std::round(setup.rate * bypass_fade_seconds<T>())), 0);
+    m_fade = m_requested.load(std::memory_order_relaxed) ? 0 : m_length;
+  }
+
+  // Frees the buffers until the next allocate_buffers, e.g. when the host deactivates
+  void release_buffers()
+  {
+    if constexpr (
+        std::is_default_constructible_v<adapter_type>
+        && std::is_move_assignable_v<adapter_type>)
+      static_cast<adapter_type&>(*this) = adapter_type{};
+    m_dry_f = {};
+    m_dry_d = {};
+  }
+
+  // Once prepared, with avnd::latency_samples
+  void reserve_delay(int64_t latency)
+  {
+    m_dry_f.reserve_delay(latency);
+    m_dry_d.reserve_delay(latency);
+  }
+
+  template <std::floating_point FP>
+  void process(
+      avnd::effect_container<T>& implementation, avnd::span<FP*> in, avnd::span<FP*> out,
+      int32_t n)
+  {
+    auto& d = dry_for(FP{});
+    const bool bypassed = m_requested.load(std::memory_order_relaxed);
+    const int ins = std::min(int(in.size()), d.channels);
+    int64_t latency = 0;
+    if constexpr (reports_latency<T>)
+      latency = std::clamp(avnd::latency_samples(implementation), int64_t(0), d.delay());
+
+    if (!bypassed && m_fade == m_length)
+    {
+      // Running: the inputs are kept before the processor overwrites them
+      d.push(in.data(), ins, 0, n);
+      adapter_type::process(implementation, in, out, n);
+    }
+    else if (bypassed && m_fade == 0)
+    {
+      // Bypassed: the delayed inputs, by chunks of the size of the buffers
+      for (int first = 0; first < n && d.frames > 0; first += d.frames)
+      {
+        const int len = std::min(n - first, d.frames);
+        d.delayed(in.data(), ins, first, len, latency);
+        d.push(in.data(), ins, first, len);
+        for (int c = 0; c < int(out.size()); c++)
+        {
+          if (!out[c])
+            continue;
+          if (c < ins)
+            std::copy_n(d.scratch[c], len, out[c] + first);
+          else
+            std::fill_n(out[c] + first, len, FP(0));
+        }
+      }
+    }
+    else if (n > d.frames)
+    {
+      // Larger than the buffers of the setup: switched without crossfade
+      m_fade = bypassed ? 0 : m_length;
+      process(implementation, in, out, n);
+    }
+    else
+    {
+      // Switching: the processor runs, and its output is crossfaded with the dry one
+      d.delayed(in.data(), ins, 0, n, latency);
+      d.push(in.data(), ins, 0, n);
+      adapter_type::process(implementation, in, out, n);
+
+      const int step = bypassed ? -1 : 1;
+      const double scale = 1. / std::max(m_length, 1);
+      for (int c = 0; c < int(out.size()); c++)
+      {
+        if (!out[c])
+          continue;
+        int fade = m_fade;
+        for (int i = 0; i < n; i++)
+        {
+          fade = std::clamp(fade + step, 0, m_length);
+          const FP wet = FP(fade * scale);
+          const FP dry = c < ins ? d.scratch[c][i] : FP(0);
+          out[c][i] = dry + wet * (out[c][i] - dry);
+        }
+      }
+      m_fade = std::clamp(m_fade + step * n, 0, m_length);
+    }
+  }
+
+  // The samples must go through the dry path too
+  template <typename... Args>
+  void process_interleaved(Args&&...) = delete;
+
+private:
+  template <typename FP>
+  struct dry_path
+  {
+    // The last inputs, as many as the delay
+    std::vector<FP> history;
+    std::size_t position{};
+    std::size_t mask{};
+
+    // The dry output of a buffer
+    std::vector<FP> storage;
+    std::vector<FP*> scratch;
+    int channels{};
+    int frames{};
+
+    void allocate(int in, int n)
+    {
+      channels = std::max(in, 0);
+      frames = std::max(n, 0);
+      storage.assign(std::size_t(channels) * frames, FP(0));
+      scratch.resize(channels);
+      for (int c = 0; c < channels; c++)
+        scratch[c] = storage.data() + std::size_t(c) * frames;
+      reserve_delay(int64_t(mask));
+    }
+
+    void reserve_delay(int64_t latency)
+    {
+      std::size_t size = 1;
+      while (int64_t(size) < latency)
+        size *= 2;
+      history.assign(std::size_t(channels) * size, FP(0));
+      position = 0;
+      mask = size - 1;
+    }
+
+    int64_t delay() const noexcept { return channels > 0 ? int64_t(mask + 1) : 0; }
+
+    FP* history_of(int c) noexcept { return history.data() + c * (mask + 1); }
+
+    void push(FP* const* in, int ins, int first, int n) noexcept
+    {
+      const int size = int(mask + 1);
+      const int skip = std::max(n - size, 0);
+      for (int c = 0; c < ins; c++)
+      {
+        if (!in[c])
+          continue;
+        FP* h = history_of(c);
+        for (int i = skip; i < n; i++)
+          h[(position + i) & mask] = in[c][first + i];
+      }
+      position += n;
+    }
+
+    // Frame i reads the input latency frames before it: in the history
+    // for the ones before this buffer, which push() adds after
+    void delayed(FP* const* in, int ins, int first, int n, int64_t latency) noexcept
+    {
+      const int lat = int(latency);
+      for (int c = 0; c < ins; c++)
+      {
+        FP* h = history_of(c);
+        FP* dst = scratch[c];
+        if (!in[c])
+        {
+          std::fill_n(dst, n, FP(0));
+          continue;
+        }
+        const int from_history = std::min(lat, n);
+        for (int i = 0; i < from_history; i++)
+          dst[i] = h[(position + i - lat) & mask];
+        for (int i = from_history; i < n; i++)
+          dst[i] = in[c][first + i - lat];
+      }
+    }
+  };
+
+  dry_path<float>& dry_for(float) noexcept { return m_dry_f; }
+  dry_path<double>& dry_for(double) noexcept { return m_dry_d; }
+
+  dry_path<float> m_dry_f;
+  dry_path<double> m_dry_d;
+
+  std::atomic<bool> m_requested{};
+  int m_length{};
+  int m_fade{};
+};
+}
@@ -2,10 +2,22 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
+#include <avnd/common/for_nth.hpp>
+#include <avnd/common/function_reflection.hpp>
+#include <avnd/common/spsc_queue.hpp>
 #include <avnd/concepts/callback.hpp>
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/output.hpp>
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+
 namespace avnd
 {
 
@@ -119,4 +131,202 @@ struct callback_storage : callback_storage_views<T>
     }
   }
 };
+
+// R(Args...) for a callback, whether a function view or a std::function-like
+template <typename Call>
+struct callback_signature
+{
+  using type = typename Call::type;
+};
+
+template <typename R, typename... Args, template <typename...> typename F>
+requires(!function_view_ish<F<R(Args...)>>)
+struct callback_signature<F<R(Args...)>>
+{
+  using type = R(Args...);
+};
+
+// The callbacks whose calls can be copied in a queue: returning nothing,
+// with small arguments which can be copied byte per byte
+template <typename Sig>
+struct deferrable_signature : std::false_type
+{
+};
+
+template <typename... Args>
+struct deferrable_signature<void(Args...)>
+    : std::bool_constant<
+          ((std::is_trivially_copyable_v<std::decay_t<Args>>
+            && std::is_default_constructible_v<std::decay_t<Args>>)
+           && ...)
+          && (sizeof(std::decay_t<Args>) + ... + 0) <= 48>
+{
+};
+
+template <typename Field>
+using callback_signature_t =
+    typename callback_signature<std::decay_t<decltype(Field{}.call)>>::type;
+
+template <typename Field>
+static constexpr bool deferrable_callback
+    = deferrable_signature<callback_signature_t<Field>>::value;
+
+// What the host gets for a deferrable callback: the frame of the call, then its arguments
+template <typename Sig>
+struct deferred_handler
+{
+  using type = std::tuple<>;
+};
+
+template <typename... Args>
+requires deferrable_signature<void(Args...)>::value
+struct deferred_handler<void(Args...)>
+{
+  using type = std::function<void(int64_t, std::decay_t<Args>...)>;
+};
+
+template <typename Field>
+using deferred_handler_t = typename deferred_handler<callback_signature_t<Field>>::type;
+
+template <typename T, std::size_t Capacity = 256>
+struct deferred_callbacks : callback_storage<T>
+{
+  static constexpr void advance(int) noexcept { }
+  static constexpr void deliver() noexcept { }
+  static constexpr int64_t dropped() noexcept { return 0; }
+};
+
+/**
+ * Callbacks which do not call the host from the audio thread: when the processor
+ * calls one of them, its arguments are copied in a wait-free queue, and deliver()
+ * calls the functions of the host with them later, from its main or idle thread.
+ * They get the frame of the call as first argument if they take it,
+ * counted from the start of the processing, see advance().
+ *
+ * Only the callbacks which return nothing and whose arguments are trivially copyable
+ * go through the queue, up to 48 bytes of them: the others still call the host
+ * from the audio thread. Pointer arguments are copied, not what they point to.
+ * Calls are dropped when the queue is full.
+ */
+template <typename T, std::size_t Capacity>
+requires(callback_output_introspection<T>::size > 0)
+struct deferred_callbacks<T, Capacity> : callback_storage<T>
+{
+  using outputs_t = typename avnd::outputs_type<T>::type;
+  using callbacks_in = callback_introspection<outputs_t>;
+  using handlers = filter_and_apply<deferred_handler_t, callback_introspection, outputs_t>;
+
+  void wrap_callbacks(avnd::effect_container<T>& effect, auto callback_handler)
+  {
+    // The ones which cannot be deferred call the host directly
+    callback_storage<T>::wrap_callbacks(effect, callback_handler);
+
+    callbacks_in::for_all_n2(
+        effect.outputs(),
+        [this, callback_handler]<auto Idx, auto IdxGlob, typename C>(
+            C& cb, avnd::predicate_index<Idx>, avnd::field_index<IdxGlob>) {
+          if constexpr (deferrable_callback<C>)
+            wrap<Idx, IdxGlob, C>(
+                cb.call, callback_handler, function_reflection_t<callback_signature_t<C>>{},
+                typename function_reflection_t<callback_signature_t<C>>::arguments{});
+        });
+  }
+
+  // Audio thread, after each buffer: the frames it had
+  void advance(int frames) noexcept { m_frame += frames; }
+
+  // Main or idle thread: calls the host with the calls queued since the last time
+  void deliver()
+  {
+    while (const record* r = m_queue.front())
+    {
+      avnd::for_nth<callbacks_in::size>(r->port, [this, r]<std::size_t Idx> {
+        using C = typename callbacks_in::template nth_element<Idx>;
+        if constexpr (deferrable_callback<C>)
+          deliver_call<Idx>(*r, std::type_identity<callback_signature_t<C>>{});
+      });
+      m_queue.pop();
+    }
+  }
+
+  // The calls which did not fit in the queue
+  int64_t dropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  struct record
+  {
+    int port{};
+    int64_t frame{};
+    alignas(std::max_align_t) std::byte args[48]{};
+  };
+
+  template <typename... Args>
+  static constexpr auto argument_offsets() noexcept
+  {
+    std::array<std::size_t, sizeof...(Args) + 1> off{};
+    std::size_t pos = 0, k = 0;
+    ((pos = (pos + alignof(Args) - 1) / alignof(Args) * alignof(Args), off[k++] = pos,
+      pos += sizeof(Args)),
+     ...);
+    off[k] = pos;
+    return off;
+  }
+
+  template <
+      std::size_t Idx, std::size_t IdxGlob, typename C, typename Call, typename Handler,
+      typename Refl, typename... Args>
+  void wrap(Call& call, Handler& callback_handler, Refl refl, boost::mp11::mp_list<Args...> args)
+  {
+    static_assert(argument_offsets<std::decay_t<Args>...>().back() <= sizeof(record::args));
+
+    auto host = callback_handler(C::name(), args, refl, avnd::num<IdxGlob>{});
+    std::get<Idx>(m_handlers) = [host](int64_t frame, std::decay_t<Args>... a) mutable {
+      if constexpr (std::is_invocable_v<decltype(host)&, int64_t, std::decay_t<Args>...>)
+        host(frame, a...);
+      else
+        host(a...);
+    };
+
+    if constexpr (function_view_ish<Call>)
+    {
+      call.context = this;
+      call.function = +[](void* ctx, Args... a) {
+        static_cast<deferred_callbacks*>(ctx)->template enqueue<Idx>(a...);
+      };
+    }
+    else
+    {
+      call = [this](Args... a) { this->template enqueue<Idx>(a...); };
+    }
+  }
+
+  template <std::size_t Idx, typename... Args>
+  void enqueue(const Args&... a) noexcept
+  {
+    constexpr auto off = argument_offsets<std::decay_t<Args>...>();
+    record r{.port = int(Idx), .frame = m_frame};
+    std::size_t k = 0;
+    ((std::memcpy(r.args + off[k++], &a, sizeof(std::decay_t<Args>))), ...);
+    if (!m_queue.push(r))
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  template <std::size_t Idx, typename... Args>
+  void deliver_call(const record& r, std::type_identity<void(Args...)>)
+  {
+    constexpr auto off = argument_offsets<std::decay_t<Args>...>();
+    std::tuple<std::decay_t<Args>...> values;
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+      (std::memcpy(&std::get<I>(values), r.args + off[I], sizeof(std::get<I>(values))), ...);
+    }(std::index_sequence_for<Args...>{});
+
+    if (auto& f = std::get<Idx>(m_handlers))
+      std::apply([&](auto&... v) { f(r.frame, v...); }, values);
+  }
+
+  handlers m_handlers;
+  spsc_queue<record, Capacity> m_queue;
+  std::atomic<int64_t> m_dropped{};
+  int64_t m_frame{};
+};
 }
@@ -0,0 +1,300 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/struct_reflection.hpp>
+#include <avnd/concepts/audio_port.hpp>
+#include <avnd/concepts/processor.hpp>
+#include <avnd/introspection/port.hpp>
+#include <avnd/wrappers/prepare.hpp>
+#include <boost/mp11.hpp>
+#include <boost/preprocessor/repetition/enum_params.hpp>
+#include <boost/preprocessor/repetition/repeat.hpp>
+#include <boost/preprocessor/repetition/repeat_from_to.hpp>
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace avnd
+{
+/**
+ * An aggregate with a member of each type, which can thus be introspected:
+ * port_pack<A, B> is struct { A f0; B f1; }.
+ */
+template <typename... Fields>
+struct port_pack
+{
+};
+
+#define AVND_PORT_PACK_MEMBER(z, n, data) F##n f##n;
+#define AVND_PORT_PACK(z, n, data)                                         \
+  template <BOOST_PP_ENUM_PARAMS_Z(z, n, typename F)>                      \
+  struct port_pack<BOOST_PP_ENUM_PARAMS_Z(z, n, F)>                        \
+  {                                                                        \
+    BOOST_PP_REPEAT_##z(n, AVND_PORT_PACK_MEMBER, ~)                       \
+  };
+BOOST_PP_REPEAT_FROM_TO(1, 65, AVND_PORT_PACK, ~)
+#undef AVND_PORT_PACK
+#undef AVND_PORT_PACK_MEMBER
+
+namespace chain_detail
+{
+using namespace boost::mp11;
+
+template <typename P>
+using inputs_tuple = as_tuple<typename avnd::inputs_type<P>::type>;
+template <typename P>
+using outputs_tuple = as_tuple<typename avnd::outputs_type<P>::type>;
+
+template <typename Fields>
+using buses = mp_copy_if<Fields, is_audio_bus_t>;
+template <typename Fields>
+using parameters = mp_copy_if<Fields, is_parameter_t>;
+
+template <typename P>
+using input_bus = mp_front<buses<inputs_tuple<P>>>;
+template <typename P>
+using output_buses = buses<outputs_tuple<P>>;
+
+template <typename Bus>
+using sample_type
+    = std::remove_const_t<std::remove_pointer_t<std::remove_pointer_t<decltype(Bus::samples)>>>;
+
+template <typename P>
+constexpr bool valid_stage()
+{
+  using in = inputs_tuple<P>;
+  using out = outputs_tuple<P>;
+  return mp_size<buses<in>>::value == 1 && mp_size<output_buses<P>>::value <= 1
+         && mp_size<buses<in>>::value + mp_size<parameters<in>>::value == mp_size<in>::value
+         && mp_size<output_buses<P>>::value + mp_size<parameters<out>>::value
+                == mp_size<out>::value;
+}
+
+template <typename Bus>
+constexpr int fixed_channels()
+{
+  if constexpr (fixed_poly_audio_port<Bus>)
+    return Bus::channels();
+  else
+    return -1;
+}
+
+// The buses through which the audio goes after the first processor:
+// either all dynamic, or all with the same fixed channel count.
+template <typename... Buses>
+constexpr bool matching_buses()
+{
+  constexpr int channels[] = {fixed_channels<Buses>()...};
+  for (int c : channels)
+    if (c != channels[0])
+      return false;
+  return true;
+}
+
+template <typename... Counts>
+constexpr auto offsets() noexcept
+{
+  // The audio bus comes first
+  std::array<std::size_t, sizeof...(Counts)> res{};
+  std::size_t offset = 1;
+  std::size_t i = 0;
+  ((res[i++] = offset, offset += Counts::value), ...);
+  return res;
+}
+
+template <typename P>
+void invoke(P& processor, int frames)
+{
+  // clang-format off
+  if constexpr (has_tick<P>)
+  {
+    typename P::tick t{};
+    if_possible(t.frames = frames);
+
+    if_possible(processor(t))
+    else if_possible(processor(frames))
+    else if_possible(processor(frames, t))
+    else if_possible(processor());
+  }
+  else
+  {
+    if_possible(processor(frames))
+    else if_possible(processor());
+  }
+  // clang-format on
+}
+
+template <typename Port>
+void copy_parameter(Port& dst, const Port& src) noexcept
+{
+  dst.value = src.value;
+  if_possible(dst.ramp = src.ramp);
+}
+}
+
+/**
+ * Runs processors one after the other as a single processor:
+ *
+ * struct GainLowpass : avnd::chain<Gain, Lowpass> {
+ *   halp_meta(name, "Gain & lowpass") ...
+ * };
+ *
+ * Each processor has an audio bus as input, and at most one as output,
+ * the other ports being parameters. The inputs of the chain are the audio input
+ * of the first processor followed by the parameters of all of them,
+ * its outputs the audio output of the last one which has one, followed by
+ * all the output parameters.
+ *
+ * The audio of the first processor is written in the output buffers,
+ * which the following ones then process in place:
+ * they have to support getting the same buffers as input and output.
+ */
+template <typename... Processors>
+struct chain
+{
+  static_assert(sizeof...(Processors) > 0);
+  static_assert(
+      (chain_detail::valid_stage<Processors>() && ...),
+      "chained processors must have an audio bus as input, at most one as output, "
+      "and parameters");
+
+  using first_type = boost::mp11::mp_front<std::tuple<Processors...>>;
+  static_assert(
+      boost::mp11::mp_size<chain_detail::output_buses<first_type>>::value == 1,
+      "the first chained processor must write audio");
+
+  using input_bus_type = chain_detail::input_bus<first_type>;
+  using output_bus_type = boost::mp11::mp_back<
+      boost::mp11::mp_append<chain_detail::output_buses<Processors>...>>;
+  using sample_type = chain_detail::sample_type<output_bus_type>;
+
+  static_assert(
+      (std::is_same_v<
+           chain_detail::sample_type<chain_detail::input_bus<Processors>>, sample_type>
+       && ...),
+      "chained processors must use the same sample type");
+  static_assert(
+      []<typename... Outs>(boost::mp11::mp_list<Outs...>) {
+        return chain_detail::matching_buses<Outs...>();
+      }(boost::mp11::mp_append<
+          boost::mp11::mp_list<output_bus_type>,
+          chain_detail::output_buses<Processors>...,
+          boost::mp11::mp_pop_front<
+              boost::mp11::mp_list<chain_detail::input_bus<Processors>...>>>{}),
+      "the audio buses between chained processors must all be dynamic, "
+      "or have the same channel count");
+
+  using inputs_pack = boost::mp11::mp_rename<
+      boost::mp11::mp_append<
+          std::tuple<input_bus_type>,
+          chain_detail::parameters<chain_detail::inputs_tuple<Processors>>...>,
+      port_pack>;
+  using outputs_pack = boost::mp11::mp_rename<
+      boost::mp11::mp_append<
+          std::tuple<output_bus_type>,
+          chain_detail::parameters<chain_detail::outputs_tuple<Processors>>...>,
+      port_pack>;
+
+  struct setup
+  {
+    int input_channels{};
+    int output_channels{};
+    int frames{};
+    double rate{};
+  };
+
+  struct tick
+  {
+    int frames{};
+  };
+
+  inputs_pack inputs;
+  outputs_pack outputs;
+
+  void prepare(setup s)
+  {
+    [&]<std::size_t... K>(std::index_sequence<K...>) {
+      (avnd::prepare(
+           std::get<K>(m_stages),
+           process_setup{
+               .input_channels = K == 0 ? s.input_channels : s.output_channels,
+               .output_channels = s.output_channels,
+               .frames_per_buffer = s.frames,
+               .rate = s.rate}),
+       ...);
+    }(std::index_sequence_for<Processors...>{});
+  }
+
+  void operator()(tick t)
+  {
+    auto& in = pfr::get<0>(inputs);
+    auto& out = pfr::get<0>(outputs);
+
+    // Buffers read by the next processor
+    sample_type** current = const_cast<sample_type**>(in.samples);
+    int channels = avnd::get_channels(in);
+
+    [&]<std::size_t... K>(std::index_sequence<K...>) {
+      (run<K>(current, channels, out, t.frames), ...);
+    }(std::index_sequence_for<Processors...>{});
+  }
+
+  // The chained processors
+  template <std::size_t K>
+  auto& stage() noexcept
+  {
+    return std::get<K>(m_stages);
+  }
+
+private:
+  static constexpr auto input_offsets = chain_detail::offsets<boost::mp11::mp_size<
+      chain_detail::parameters<chain_detail::inputs_tuple<Processors>>>...>();
+  static constexpr auto output_offsets = chain_detail::offsets<boost::mp11::mp_size<
+      chain_detail::parameters<chain_detail::outputs_tuple<Processors>>>...>();
+
+  template <std::size_t K>
+  void run(sample_type**& current, int& channels, auto& out, int frames)
+  {
+    auto& p = std::get<K>(m_stages);
+    using P = std::decay_t<decltype(p)>;
+    using in_info = audio_bus_introspection<typename avnd::inputs_type<P>::type>;
+    using out_info = audio_bus_introspection<typename avnd::outputs_type<P>::type>;
+
+    parameter_introspection<typename avnd::inputs_type<P>::type>::for_all_n(
+        p.inputs, [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          chain_detail::copy_parameter(port, pfr::get<input_offsets[K] + Idx>(inputs));
+        });
+
+    auto& bus_in = in_info::template get<0>(p.inputs);
+    bus_in.samples = const_cast<decltype(bus_in.samples)>(current);
+    if constexpr (dynamic_poly_audio_port<std::decay_t<decltype(bus_in)>>)
+      bus_in.channels = channels;
+
+    if constexpr (out_info::size > 0)
+    {
+      auto& bus_out = out_info::template get<0>(p.outputs);
+      bus_out.samples = out.samples;
+      if constexpr (dynamic_poly_audio_port<std::decay_t<decltype(bus_out)>>)
+        bus_out.channels = avnd::get_channels(out);
+    }
+
+    chain_detail::invoke(p, frames);
+
+    parameter_introspection<typename avnd::outputs_type<P>::type>::for_all_n(
+        p.outputs, [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          chain_detail::copy_parameter(pfr::get<output_offsets[K] + Idx>(outputs), port);
+        });
+
+    if constexpr (out_info::size > 0)
+    {
+      current = out.samples;
+      channels = avnd::get_channels(out);
+    }
+  }
+
+  std::tuple<Processors...> m_stages;
+};
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/parameter.hpp>
+#include <avnd/concepts/processor.hpp>
+#include <avnd/introspection/input.hpp>
+#include <boost/mp11.hpp>
+
+#include <bitset>
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+
+namespace avnd
+{
+// The value of a control in the previous buffer, for the ones which can be compared
+// without allocating: the others are only reported as changed in the first buffer
+template <typename Field>
+struct previous_control_value
+{
+};
+
+template <typename Field>
+requires std::is_trivially_copyable_v<std::decay_t<decltype(Field::value)>>
+         && std::equality_comparable<std::decay_t<decltype(Field::value)>>
+struct previous_control_value<Field>
+{
+  std::decay_t<decltype(Field::value)> value{};
+};
+
+template <typename T>
+struct changed_controls_storage
+{
+  static constexpr void update(avnd::effect_container<T>&) noexcept { }
+};
+
+/**
+ * Tells the processors which of their controls changed since the previous buffer,
+ * whatever the binding, by comparing them with their values then:
+ *
+ * - void update(T& self) in a control is called once per buffer when it changed,
+ *   before the processor, e.g. to recompute the filter coefficients which depend on it;
+ * - the changed member of the change_flagged_parameter controls is set;
+ * - the bits of the changed_controls member of a changed_controls_processor are set,
+ *   bit i for the i-th control input;
+ * - the controls whose value is a halp::deferred_reactive_value are notified,
+ *   once per buffer whatever the number of assignments, in the order of the inputs.
+ *
+ * Everything is reported as changed in the first buffer.
+ * update() has to be called before each call to the processor, after the smoothing.
+ */
+template <typename T>
+requires(parameter_input_introspection<T>::size > 0)
+struct changed_controls_storage<T>
+{
+  using parameters_in = parameter_input_introspection<T>;
+  static constexpr std::size_t size = parameters_in::size;
+
+  // std::tuple< previous_control_value<Field1>, previous_control_value<Field2>, ... >
+  using previous_values
+      = filter_and_apply<previous_control_value, parameter_input_introspection, T>;
+
+  previous_values previous;
+  std::bitset<size> changed;
+
+  void update(avnd::effect_container<T>& t)
+  {
+    // Duplicated instances with their own inputs all have the same values:
+    // they are only compared for the first one
+    ++m_update;
+    changed.reset();
+    parameters_in::for_all_n(
+        avnd::get_inputs(t),
+        [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          if (m_last_update[Idx] == m_update)
+            return;
+          m_last_update[Idx] = m_update;
+
+          auto& prev = std::get<Idx>(this->previous);
+          if constexpr (requires { prev.value; })
+          {
+            if (!m_started || !(prev.value == port.value))
+            {
+              prev.value = port.value;
+              changed[Idx] = true;
+            }
+          }
+          else if (!m_started)
+          {
+            changed[Idx] = true;
+          }
+        });
+    m_started = true;
+
+    if constexpr (avnd::inputs_is_value<T>)
+    {
+      for (auto& fx : t.effects())
+        notify(fx.inputs, fx);
+    }
+    else
+    {
+      auto& inputs = avnd::get_inputs(t);
+      for (auto& fx : t.effects())
+        notify(inputs, fx);
+    }
+  }
+
+private:
+  template <typename Inputs>
+  void notify(Inputs& inputs, T& fx)
+  {
+    if constexpr (changed_controls_processor<T>)
+    {
+      fx.changed_controls.reset();
+      for (std::size_t i = 0; i < size && i < fx.changed_controls.size(); i++)
+        fx.changed_controls[i] = changed[i];
+    }
+
+    parameters_in::for_all_n(
+        inputs, [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          if constexpr (requires { port.value.flush(); })
+            port.value.flush();
+          if constexpr (change_flagged_parameter<M>)
+            port.changed = changed[Idx];
+          if constexpr (requires { port.update(fx); })
+            if (changed[Idx])
+              port.update(fx);
+        });
+  }
+
+  int64_t m_update{};
+  int64_t m_last_update[size]{};
+  bool m_started{};
+};
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/audio_port.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace avnd
+{
+// Whether a processor looks at which of its input channels are constant
+template <typename T>
+consteval bool wants_constant_inputs() noexcept
+{
+  bool res = false;
+  auto check = [&]<typename F>(F) {
+    res |= constant_flagged_audio_port<typename F::type>;
+  };
+  avnd::audio_bus_input_introspection<T>::for_all(check);
+  avnd::audio_channel_input_introspection<T>::for_all(check);
+  return res;
+}
+
+/**
+ * Gives the input channels which are constant over the buffer, e.g. from the
+ * constant_mask of CLAP, to processors which want them (see halp::constant_flagged).
+ * Bit k of mask is the k-th channel the host gives to the process adapter:
+ * the channels of the busses, or the single-channel ports, one after the other.
+ */
+template <typename T>
+void set_input_constants(avnd::effect_container<T>& implementation, uint64_t mask) noexcept
+{
+  if constexpr (
+      wants_constant_inputs<T>() && std::is_same_v<decltype(implementation.effect), T>)
+  {
+    int k = 0;
+    auto assign = [&]<typename P>(P& port) {
+      int channels = 1;
+      if constexpr (poly_audio_port<P>)
+        channels = avnd::get_channels(port);
+
+      if constexpr (constant_flagged_audio_port<P>)
+      {
+        const uint64_t bits
+            = channels >= 64 ? ~uint64_t(0) : (uint64_t(1) << channels) - 1;
+        port.constant = k < 64 ? (mask >> k) & bits : 0;
+      }
+      k += channels;
+    };
+    avnd::audio_bus_input_introspection<T>::for_all(implementation.inputs(), assign);
+    avnd::audio_channel_input_introspection<T>::for_all(implementation.inputs(), assign);
+  }
+}
+}
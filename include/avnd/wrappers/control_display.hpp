@@ -6,7 +6,10 @@
 #include <avnd/common/widechar.hpp>
 #include <avnd/introspection/widgets.hpp>
 
+#include <algorithm>
+#include <array>
 #include <cstring>
+#include <string_view>
 
 #if __has_include(<fmt/format.h>)
 #include <fmt/format.h>
@@ -34,12 +37,15 @@ bool display_control(const T& value, char* cstr, std::size_t len)
   }
   else if constexpr (requires { C{value}.display(); })
   {
-    const std::string_view str = C{value}.display();
-    int N = std::min(str.length() + 1, len - 1);
-    const auto src = str.data();
-    const auto dst = cstr;
-    for (int i = 0; i < N; i++)
-      dst[i] = src[i];
+    // The control is kept alive as display() may return a view into it
+    C ctl{value};
+    const auto& res = ctl.display();
+    const std::string_view str{res};
+    if (len == 0)
+      return false;
+    const std::size_t N = std::min(str.length(), len - 1);
+    std::copy_n(str.data(), N, cstr);
+    cstr[N] = '\0';
     return true;
   }
   else
@@ -70,27 +76,27 @@ bool display_control(const T& value, char* cstr, std::size_t len)
 #else
     if constexpr (std::floating_point<val_type>)
     {
-      snprintf(cstr, 16, "%.2f", value);
+      snprintf(cstr, len, "%.2f", value);
       return true;
     }
     else if constexpr (std::is_same_v<val_type, int>)
     {
-      snprintf(cstr, 16, "%d", value);
+      snprintf(cstr, len, "%d", value);
       return true;
     }
     else if constexpr (std::is_same_v<val_type, bool>)
     {
-      snprintf(cstr, 16, value ? "true" : "false");
+      snprintf(cstr, len, value ? "true" : "false");
       return true;
     }
     else if constexpr (std::is_same_v<val_type, const char*>)
     {
-      snprintf(cstr, 16, "%s", value);
+      snprintf(cstr, len, "%s", value);
       return true;
     }
     else if constexpr (std::is_same_v<val_type, std::string>)
     {
-      snprintf(cstr, 16, "%s", value.data());
+      snprintf(cstr, len, "%s", value.data());
       return true;
     }
     else if constexpr (std::is_enum_v<val_type>)
@@ -98,9 +104,9 @@ bool display_control(const T& value, char* cstr, std::size_t len)
       static constexpr auto choices = avnd::get_enum_choices<C>();
       const int enum_index = static_cast<int>(value);
       if (enum_index >= 0 && enum_index < choices.size())
-        snprintf(cstr, 16, "%s", choices[enum_index].data());
+        snprintf(cstr, len, "%s", choices[enum_index].data());
       else
-        snprintf(cstr, 16, "%d", enum_index);
+        snprintf(cstr, len, "%d", enum_index);
       return true;
     }
 #endif
@@ -111,7 +117,7 @@ template <typename C, typename T>
 bool display_control(const T& value, char16_t* string, std::size_t sz)
 {
   char temp[512] = {0};
-  if (display_control<C>(value, temp, sz))
+  if (display_control<C>(value, temp, std::min(sz, sizeof(temp))))
   {
     utf8_to_utf16(temp, temp + strlen(temp), string);
     return true;
@@ -122,11 +128,88 @@ template <typename C, typename T>
 bool display_control(const T& value, wchar_t* string, std::size_t sz)
 {
   char temp[512] = {0};
-  if (display_control<C>(value, temp, sz))
+  if (display_control<C>(value, temp, std::min(sz, sizeof(temp))))
   {
     utf8_to_utf16(temp, temp + strlen(temp), string);
     return true;
   }
   return false;
 }
+
+/**
+ * The texts of the values of N controls, for the hosts which ask for them
+ * again and again, e.g. for every visible parameter at every frame of their UI:
+ * the text of a control is only formatted again when it is asked for another value.
+ *
+ * Not thread-safe: one per thread asking, usually the UI one.
+ */
+template <std::size_t N>
+struct display_cache
+{
+  static constexpr std::size_t text_size = 128;
+
+  // key identifies the value, e.g. the normalized value given by the host
+  template <typename C, typename T>
+  bool display(std::size_t i, double key, const T& value, char* cstr, std::size_t len)
+  {
+    if (len == 0)
+      return false;
+    if (i >= N)
+      return display_control<C>(value, cstr, len);
+
+    auto& e = m_entries[i];
+    if (!e.valid || e.key != key)
+    {
+      e.valid = display_control<C>(value, e.text, text_size);
+      e.key = key;
+      if (!e.valid)
+        return false;
+    }
+
+    const std::size_t n = std::min(std::strlen(e.text), len - 1);
+    std::copy_n(e.text, n, cstr);
+    cstr[n] = '\0';
+    return true;
+  }
+
+  template <typename C, typename T>
+  bool display(std::size_t i, double key, const T& value, char16_t* string, std::size_t sz)
+  {
+    char temp[text_size] = {0};
+    if (display<C>(i, key, value, temp, std::min(sz, text_size)))
+    {
+      utf8_to_utf16(temp, temp + strlen(temp), string);
+      return true;
+    }
+    return false;
+  }
+
+  template <typename C, typename T>
+  bool display(std::size_t i, double key, const T& value, wchar_t* string, std::size_t sz)
+  {
+    char temp[text_size] = {0};
+    if (display<C>(i, key, value, temp, std::min(sz, text_size)))
+    {
+      utf8_to_utf16(temp, temp + strlen(temp), string);
+      return true;
+    }
+    return false;
+  }
+
+  // E.g. when the processor is reset
+  void clear() noexcept
+  {
+    for (auto& e : m_entries)
+      e.valid = false;
+  }
+
+private:
+  struct entry
+  {
+    double key{};
+    bool valid{};
+    char text[text_size]{};
+  };
+  std::array<entry, N> m_entries{};
+};
 }
@@ -0,0 +1,114 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/freestanding.hpp>
+#include <avnd/concepts/audio_processor.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/wrappers/process_adapter.hpp>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace avnd
+{
+/**
+ * Inputs whose events are timed in frames of the host buffer: the adapters which
+ * cut or queue the buffers would have to rebase them, so they do not take them.
+ */
+template <typename T>
+inline constexpr bool has_timed_inputs
+    = midi_input_introspection<T>::size > 0
+      || linear_timed_parameter_input_introspection<T>::size > 0
+      || span_timed_parameter_input_introspection<T>::size > 0
+      || dynamic_timed_parameter_input_introspection<T>::size > 0;
+
+/**
+ * Calls the control() of control_rate_processor every control_interval frames
+ * and processes the audio in between, cutting the buffers of the host where needed:
+ * the control-rate work costs the same whatever the size of the host buffers.
+ * Unlike fixed_block_adapter this adds no latency, the audio sub-blocks only point
+ * into the host buffers.
+ *
+ * The interval carries over from one buffer to the next: with 32 and buffers of 48 frames,
+ * control() is called at 0 and 32 in the first one, then at 16 in the second.
+ * Each sub-block would otherwise see all the MIDI and timed control events of the
+ * host buffer, thus processors with such inputs are not supported.
+ */
+template <typename T, typename Adapter = process_adapter<T>>
+struct control_rate_adapter : Adapter
+{
+  static constexpr int interval = control_interval<T>();
+  static_assert(interval > 0);
+  static_assert(
+      !has_timed_inputs<T>,
+      "control-rate processors cannot have MIDI or sample-accurate inputs");
+
+  template <std::floating_point SrcFP>
+  void allocate_buffers(process_setup setup, SrcFP f)
+  {
+    Adapter::allocate_buffers(setup, f);
+    offsets_for(f).allocate(setup.input_channels, setup.output_channels);
+    m_position = 0;
+  }
+
+  template <std::floating_point FP>
+  void process(
+      avnd::effect_container<T>& implementation, avnd::span<FP*> in, avnd::span<FP*> out,
+      int32_t n)
+  {
+    auto& p = offsets_for(FP{});
+    const std::size_t ins = std::min(in.size(), p.inputs.size());
+    const std::size_t outs = std::min(out.size(), p.outputs.size());
+
+    for (std::size_t c = outs; c < out.size(); c++)
+      std::fill_n(out[c], n, FP(0));
+
+    for (int offset = 0; offset < n;)
+    {
+      if (m_position == 0)
+        for (auto& fx : implementation.effects())
+          fx.control();
+
+      const int len = std::min(n - offset, interval - m_position);
+      for (std::size_t c = 0; c < ins; c++)
+        p.inputs[c] = in[c] + offset;
+      for (std::size_t c = 0; c < outs; c++)
+        p.outputs[c] = out[c] + offset;
+
+      Adapter::process(
+          implementation, avnd::span<FP*>{p.inputs.data(), ins},
+          avnd::span<FP*>{p.outputs.data(), outs}, len);
+
+      offset += len;
+      m_position = (m_position + len) % interval;
+    }
+  }
+
+  // The sub-blocks must go through process()
+  template <typename... Args>
+  void process_interleaved(Args&&...) = delete;
+
+private:
+  template <typename FP>
+  struct offsets
+  {
+    avnd::channel_vector<FP*> inputs;
+    avnd::channel_vector<FP*> outputs;
+
+    // Sized once here: process() only writes in them
+    void allocate(int in, int out)
+    {
+      inputs.resize(std::max(in, 0));
+      outputs.resize(std::max(out, 0));
+    }
+  };
+
+  offsets<float>& offsets_for(float) noexcept { return m_offsets_f; }
+  offsets<double>& offsets_for(double) noexcept { return m_offsets_d; }
+
+  offsets<float> m_offsets_f;
+  offsets<double> m_offsets_d;
+  int m_position{};
+};
+}
@@ -3,10 +3,12 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <avnd/common/for_nth.hpp>
+#include <avnd/common/span_polyfill.hpp>
 #include <avnd/wrappers/avnd.hpp>
 #include <avnd/wrappers/widgets.hpp>
 #include <cmath>
 
+#include <algorithm>
 #include <string>
 
 namespace avnd
@@ -103,8 +105,13 @@ static constexpr auto map_control_from_01(std::floating_point auto v)
 template <avnd::enum_parameter T>
 static constexpr auto map_control_from_01(std::floating_point auto v)
 {
-  int res = std::round(v * (avnd::get_enum_choices_count<T>() - 1));
-  return static_cast<decltype(T::value)>(res);
+  // Rounded to the nearest choice without std::round, which does not vectorize;
+  // values out of [0; 1] give the first or last choice rather than an invalid one
+  constexpr int last = avnd::get_enum_choices_count<T>() - 1;
+  if constexpr (last <= 0)
+    return static_cast<decltype(T::value)>(0);
+  else
+    return static_cast<decltype(T::value)>(std::clamp(int(v * last + 0.5), 0, last));
 }
 
 template <typename T>
@@ -183,4 +190,27 @@ static constexpr auto map_control_to_01(const T& ctl)
 {
   return map_control_to_01<T>(ctl.value);
 }
+
+/**
+ * Maps a block of normalized values at once, e.g. the automation points a host
+ * sends for a parameter during a buffer: the range being known at compile time,
+ * the loop vectorizes. Converts min(normalized.size(), values.size()) values.
+ */
+template <avnd::parameter T, std::floating_point FP>
+static constexpr void
+map_controls_from_01(avnd::span<const FP> normalized, avnd::span<decltype(T::value)> values)
+{
+  const std::size_t n = std::min(normalized.size(), values.size());
+  for (std::size_t i = 0; i < n; i++)
+    values[i] = map_control_from_01<T>(normalized[i]);
+}
+
+template <avnd::parameter T, std::floating_point FP>
+static constexpr void
+map_controls_to_01(avnd::span<const decltype(T::value)> values, avnd::span<FP> normalized)
+{
+  const std::size_t n = std::min(normalized.size(), values.size());
+  for (std::size_t i = 0; i < n; i++)
+    normalized[i] = map_control_to_01<T>(values[i]);
+}
 }
@@ -6,6 +6,7 @@
 #include <avnd/wrappers/widgets.hpp>
 #include <cmath>
 
+#include <algorithm>
 #include <string>
 
 namespace avnd
@@ -61,7 +62,11 @@ static constexpr auto map_control_from_01_to_fp(std::floating_point auto v)
 template <avnd::enum_parameter T>
 static constexpr auto map_control_from_01_to_fp(std::floating_point auto v)
 {
-  return double(std::round(v * (avnd::get_enum_choices_count<T>() - 1)));
+  constexpr int last = avnd::get_enum_choices_count<T>() - 1;
+  if constexpr (last <= 0)
+    return 0.;
+  else
+    return double(std::clamp(int(v * last + 0.5), 0, last));
 }
 
 template <typename T>
@@ -0,0 +1,211 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/triple_buffer.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/introspection/output.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <bitset>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace avnd
+{
+/**
+ * Values of the controls which changed since the consumer last looked.
+ * Only the values whose bit is set in "changed" are meaningful.
+ */
+template <typename Tuple, std::size_t N>
+struct controls_snapshot
+{
+  Tuple values{};
+  std::bitset<N> changed;
+};
+
+/**
+ * Sends the controls which changed from the audio thread to e.g. the UI thread,
+ * without locking nor allocating (as long as the control values themselves
+ * do not allocate when copied).
+ */
+template <typename Tuple, std::size_t N>
+class controls_feedback
+{
+public:
+  // Audio thread: get(avnd::predicate_index<I>{}) must return the current value of the I-th control
+  template <typename Get>
+  void publish(std::bitset<N> changed, Get&& get)
+  {
+    // The consumer did not pick up the last snapshot yet: it is going to be superseded,
+    // thus the new one has to carry its changes too
+    if (m_buffer.pending())
+      changed |= m_published;
+
+    auto& slot = m_buffer.write_buffer();
+    [&]<std::size_t... I>(std::index_sequence<I...>)
+    {
+      ((changed.test(I) ? (void)(std::get<I>(slot.values) = get(avnd::predicate_index<I>{}))
+                        : (void)0),
+       ...);
+    }
+    (std::make_index_sequence<N>{});
+    slot.changed = changed;
+
+    m_published = changed;
+    m_buffer.publish();
+  }
+
+  // Consumer thread: calls f(const Tuple& values, std::bitset<N> changed)
+  // if there were changes since the last call.
+  template <typename F>
+  bool consume(F&& f)
+  {
+    if (!m_buffer.consume())
+      return false;
+
+    const auto& slot = m_buffer.read_buffer();
+    f(slot.values, slot.changed);
+    return true;
+  }
+
+private:
+  triple_buffer<controls_snapshot<Tuple, N>> m_buffer;
+  std::bitset<N> m_published;
+};
+
+/**
+ * Sends control changes from e.g. the UI thread to the audio thread.
+ *
+ * The UI sets the controls in a copy of its own, and sends all the ones it set
+ * at once, e.g. once per frame: the audio thread then gets at most one snapshot
+ * per tick, with only the changed controls.
+ */
+template <typename Tuple, std::size_t N>
+class controls_requests
+{
+public:
+  // Producer thread
+  template <std::size_t I, typename V>
+  void set(V&& value)
+  {
+    std::get<I>(m_staged) = std::forward<V>(value);
+    m_changed.set(I);
+  }
+
+  // Producer thread: sends the controls set since the last call
+  void send()
+  {
+    if (m_changed.none())
+      return;
+    m_feedback.publish(m_changed, [this]<std::size_t I>(avnd::predicate_index<I>) -> auto& {
+      return std::get<I>(m_staged);
+    });
+    m_changed.reset();
+  }
+
+  // Consumer thread, see controls_feedback::consume
+  template <typename F>
+  bool consume(F&& f)
+  {
+    return m_feedback.consume(std::forward<F>(f));
+  }
+
+private:
+  Tuple m_staged{};
+  std::bitset<N> m_changed;
+  controls_feedback<Tuple, N> m_feedback;
+};
+
+/**
+ * Controls which changed, set from any thread and taken by e.g. the UI thread
+ * to only refresh what needs it. Neither locks nor allocates.
+ */
+template <std::size_t N>
+class dirty_flags
+{
+public:
+  void set(std::size_t i) noexcept
+  {
+    m_words[i / 64].fetch_or(uint64_t(1) << (i % 64), std::memory_order_release);
+  }
+
+  void set(const std::bitset<N>& bits) noexcept
+  {
+    for (std::size_t i = 0; i < N; i++)
+      if (bits.test(i))
+        set(i);
+  }
+
+  // The flags set since the last call
+  std::bitset<N> take() noexcept
+  {
+    std::bitset<N> res;
+    for (std::size_t w = 0; w < words; w++)
+    {
+      const uint64_t v = m_words[w].exchange(0, std::memory_order_acquire);
+      for (std::size_t b = 0; b < 64 && w * 64 + b < N; b++)
+        if (v & (uint64_t(1) << b))
+          res.set(w * 64 + b);
+    }
+    return res;
+  }
+
+  // Calls f(i) for each flag set since the last call, without going through the others
+  template <typename F>
+  void take(F&& f)
+  {
+    for (std::size_t w = 0; w < words; w++)
+    {
+      for (uint64_t v = m_words[w].exchange(0, std::memory_order_acquire); v != 0;
+           v &= v - 1)
+        f(w * 64 + std::countr_zero(v));
+    }
+  }
+
+  // Sets the flags of all the controls
+  void set_all() noexcept
+  {
+    for (std::size_t w = 0; w < words; w++)
+    {
+      const std::size_t bits = std::min<std::size_t>(N - w * 64, 64);
+      m_words[w].fetch_or(
+          bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1,
+          std::memory_order_release);
+    }
+  }
+
+private:
+  static constexpr std::size_t words = (N + 63) / 64;
+  std::atomic<uint64_t> m_words[words > 0 ? words : 1]{};
+};
+
+template <typename Field>
+using control_value_type = std::decay_t<decltype(Field::value)>;
+
+template <typename T>
+struct controls_mirror
+{
+  static constexpr int i_size = avnd::control_input_introspection<T>::size;
+  static constexpr int o_size = avnd::control_output_introspection<T>::size;
+  using i_tuple
+      = avnd::filter_and_apply<control_value_type, avnd::control_input_introspection, T>;
+  using o_tuple
+      = avnd::filter_and_apply<control_value_type, avnd::control_output_introspection, T>;
+
+  // Controls changed during the current tick, only touched by the audio thread
+  std::bitset<i_size> inputs_set;
+  std::bitset<o_size> outputs_set;
+
+  // Audio thread to UI
+  controls_feedback<i_tuple, i_size> inputs;
+  controls_feedback<o_tuple, o_size> outputs;
+
+  // UI to audio thread
+  controls_requests<i_tuple, i_size> from_ui;
+};
+}
@@ -194,6 +194,105 @@ struct control_storage
     dyn_out::for_all(avnd::get_outputs(t), init_dyn);
   }
 
+  // Frees what reserve_space allocated, e.g. when the host deactivates the processor
+  void release(avnd::effect_container<T>& t)
+  {
+    auto release_buffer = [&]<typename M>(M& port, auto& buf) {
+      buf = {};
+      port.values = {};
+    };
+    if constexpr (lin_in::size > 0)
+      lin_in::for_all_n(
+          avnd::get_inputs(t), [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+            release_buffer(port, std::get<Idx>(this->linear_inputs));
+          });
+    if constexpr (lin_out::size > 0)
+      lin_out::for_all_n(
+          avnd::get_outputs(t), [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+            release_buffer(port, std::get<Idx>(this->linear_outputs));
+          });
+    if constexpr (span_in::size > 0)
+      span_in::for_all_n(
+          avnd::get_inputs(t), [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+            release_buffer(port, std::get<Idx>(this->span_inputs));
+          });
+    if constexpr (span_out::size > 0)
+      span_out::for_all_n(
+          avnd::get_outputs(t), [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+            release_buffer(port, std::get<Idx>(this->span_outputs));
+          });
+
+    auto release_dyn = [&](auto& port) { port.values = {}; };
+    dyn_in::for_all(avnd::get_inputs(t), release_dyn);
+    dyn_out::for_all(avnd::get_outputs(t), release_dyn);
+  }
+
+  static constexpr bool has_timed_inputs
+      = lin_in::size > 0 || span_in::size > 0 || dyn_in::size > 0;
+
+  // Stores a value which the host sent at a given frame of the current buffer,
+  // if the input n of the inputs struct is sample-accurate.
+  // value_for(port) converts the host value to the port's value type.
+  // Returns false if that input is not sample-accurate.
+  bool push_input(avnd::effect_container<T>& t, int n, int frame, auto&& value_for)
+  {
+    bool found = false;
+    if (frame < 0)
+      frame = 0;
+
+    if constexpr (lin_in::size > 0)
+    {
+      lin_in::for_all_n2(
+          avnd::get_inputs(t),
+          [&]<typename M, std::size_t Idx, std::size_t F>(
+              M& port, avnd::predicate_index<Idx>, avnd::field_index<F>)
+          {
+            auto& buf = std::get<Idx>(this->linear_inputs);
+            if (F == n)
+            {
+              found = true;
+              if (frame < std::ssize(buf))
+                port.values[frame] = value_for(port);
+            }
+          });
+    }
+
+    if constexpr (span_in::size > 0)
+    {
+      span_in::for_all_n2(
+          avnd::get_inputs(t),
+          [&]<typename M, std::size_t Idx, std::size_t F>(
+              M& port, avnd::predicate_index<Idx>, avnd::field_index<F>)
+          {
+            if (F == n)
+            {
+              found = true;
+              auto& buf = std::get<Idx>(this->span_inputs);
+              auto& v = buf.emplace_back();
+              v.frame = frame;
+              v.value = value_for(port);
+              port.values = {buf.data(), buf.size()};
+            }
+          });
+    }
+
+    if constexpr (dyn_in::size > 0)
+    {
+      dyn_in::for_all_n2(
+          avnd::get_inputs(t),
+          [&]<typename M, std::size_t Idx, std::size_t F>(
+              M& port, avnd::predicate_index<Idx>, avnd::field_index<F>)
+          {
+            if (F == n)
+            {
+              found = true;
+              port.values[frame] = value_for(port);
+            }
+          });
+    }
+    return found;
+  }
+
   void clear_inputs(avnd::effect_container<T>& t)
   {
     if constexpr (lin_in::size > 0)
@@ -213,6 +312,7 @@ struct control_storage
       {
         auto& buf = std::get<Idx>(this->span_inputs);
         buf.resize(0);
+        port.values = {buf.data(), std::size_t(0)};
       };
       span_in::for_all_n(avnd::get_inputs(t), init_raw_in);
     }
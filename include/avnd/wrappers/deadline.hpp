@@ -0,0 +1,197 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Deadline accounting of the audio callbacks, as read by avnd_read_deadline_stats:
+ * the bindings record it when built with AVND_DEADLINE_MONITOR, i.e. the
+ * AVENDISH_DEADLINE_MONITOR CMake option.
+ *
+ * Each instance counts the callbacks which took longer than a fraction of the duration
+ * of their block, frames / rate, and keeps the worst one: this shows the processors which
+ * spike during a show, from denormals, cold caches or a lazy initialization, without
+ * attaching a profiler.
+ *
+ * The fraction is 0.5 unless set with avnd_set_deadline_budget or the
+ * AVND_DEADLINE_BUDGET environment variable, e.g. AVND_DEADLINE_BUDGET=0.25.
+ */
+extern "C" {
+struct avnd_deadline_stats
+{
+  const char* name;
+  const void* instance;
+  uint64_t calls;
+  uint64_t misses;   // callbacks over the budget
+  uint64_t worst_ns; // the longest callback
+  double worst_load; // the highest duration of a callback over the duration of its block
+};
+
+typedef void (*avnd_deadline_callback)(const struct avnd_deadline_stats*, void*);
+}
+
+#if AVND_DEADLINE_MONITOR
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace avnd
+{
+inline std::atomic<double> deadline_budget{[] {
+  if (const char* env = std::getenv("AVND_DEADLINE_BUDGET"))
+    if (double v = std::strtod(env, nullptr); v > 0.)
+      return v;
+  return 0.5;
+}()};
+
+/**
+ * Written by the audio thread of an instance, read from any thread,
+ * with the same rules as node_profile.
+ */
+struct deadline_monitor
+{
+  explicit deadline_monitor(std::string_view name);
+  deadline_monitor(const deadline_monitor&) = delete;
+  deadline_monitor& operator=(const deadline_monitor&) = delete;
+  ~deadline_monitor();
+
+  void prepare(double rate) noexcept
+  {
+    ns_per_frame.store(rate > 0. ? 1e9 / rate : 0., std::memory_order_relaxed);
+  }
+
+  void record(int64_t frames, uint64_t ns) noexcept
+  {
+    constexpr auto r = std::memory_order_relaxed;
+    calls.fetch_add(1, r);
+    if (ns > worst_ns.load(r))
+      worst_ns.store(ns, r);
+
+    const double block_ns = double(frames) * ns_per_frame.load(r);
+    if (block_ns <= 0.)
+      return;
+
+    const double load = double(ns) / block_ns;
+    if (load > worst_load.load(r))
+      worst_load.store(load, r);
+    if (load > deadline_budget.load(r))
+      misses.fetch_add(1, r);
+  }
+
+  void read(avnd_deadline_stats& s, bool reset) noexcept
+  {
+    constexpr auto r = std::memory_order_relaxed;
+    auto get = [reset](auto& v) { return reset ? v.exchange(0, r) : v.load(r); };
+    s.calls = get(calls);
+    s.misses = get(misses);
+    s.worst_ns = get(worst_ns);
+    s.worst_load = get(worst_load);
+  }
+
+  std::string name;
+  std::atomic<double> ns_per_frame{};
+  std::atomic<uint64_t> calls{};
+  std::atomic<uint64_t> misses{};
+  std::atomic<uint64_t> worst_ns{};
+  std::atomic<double> worst_load{};
+};
+
+// All the monitors currently alive, locked outside of the audio thread
+struct deadline_registry
+{
+  static deadline_registry& instance()
+  {
+    static deadline_registry r;
+    return r;
+  }
+
+  std::mutex mutex;
+  std::vector<deadline_monitor*> monitors;
+};
+
+inline deadline_monitor::deadline_monitor(std::string_view name)
+    : name{name}
+{
+  auto& r = deadline_registry::instance();
+  std::lock_guard lock{r.mutex};
+  r.monitors.push_back(this);
+}
+
+inline deadline_monitor::~deadline_monitor()
+{
+  auto& r = deadline_registry::instance();
+  std::lock_guard lock{r.mutex};
+  std::erase(r.monitors, this);
+}
+
+// Times the callback it lives in
+struct deadline_scope
+{
+  deadline_monitor& monitor;
+  int64_t frames;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  deadline_scope(deadline_monitor& m, int64_t frames) noexcept
+      : monitor{m}
+      , frames{frames}
+  {
+  }
+
+  ~deadline_scope()
+  {
+    const auto t = std::chrono::steady_clock::now() - start;
+    monitor.record(
+        frames, std::chrono::duration_cast<std::chrono::nanoseconds>(t).count());
+  }
+};
+}
+
+extern "C" inline void avnd_set_deadline_budget(double fraction_of_block)
+{
+  if (fraction_of_block > 0.)
+    avnd::deadline_budget.store(fraction_of_block, std::memory_order_relaxed);
+}
+
+/**
+ * Calls cb(stats, ctx) with the statistics of each instance currently alive.
+ * If reset is non-zero, the counters start again from zero, e.g. to warn
+ * about the misses of the last second by calling this every second.
+ */
+extern "C" inline void
+avnd_read_deadline_stats(avnd_deadline_callback cb, void* ctx, int reset)
+{
+  auto& r = avnd::deadline_registry::instance();
+  std::lock_guard lock{r.mutex};
+  for (avnd::deadline_monitor* m : r.monitors)
+  {
+    avnd_deadline_stats stats{};
+    stats.name = m->name.c_str();
+    stats.instance = m;
+    m->read(stats, reset != 0);
+    cb(&stats, ctx);
+  }
+}
+#else
+namespace avnd
+{
+struct deadline_monitor
+{
+  explicit deadline_monitor(std::string_view) noexcept { }
+  void prepare(double) noexcept { }
+};
+
+struct deadline_scope
+{
+  deadline_scope(deadline_monitor&, int64_t) noexcept { }
+};
+}
+
+// Nothing is recorded
+extern "C" inline void avnd_set_deadline_budget(double) { }
+extern "C" inline void avnd_read_deadline_stats(avnd_deadline_callback, void*, int) { }
+#endif
@@ -0,0 +1,288 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/function_reflection.hpp>
+#include <avnd/common/spsc_queue.hpp>
+#include <avnd/concepts/callback.hpp>
+#include <avnd/concepts/parameter.hpp>
+#include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/output_parameters.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace avnd
+{
+/**
+ * The control outputs of an audio processor, for the bindings which must not
+ * send them from the audio thread, e.g. Pd and Max.
+ *
+ * After each buffer, the audio thread queues the numeric outputs which changed,
+ * every value of the timed outputs and every call of the callbacks, stamped with
+ * the time of their frame given by the binding. The binding's scheduler then
+ * drains the events when they are due. Neither side locks nor allocates; events
+ * are dropped when the scheduler is too late for the queue to hold them.
+ *
+ * The outputs which declare a report_epsilon() or a report_rate(), e.g. meters,
+ * are only queued when they moved by more than that, and at most that often.
+ * Besides numbers, the outputs can be lists of up to 4 numbers, e.g. halp::meter_value.
+ */
+template <typename T, std::size_t Capacity = 1024>
+class deferred_outputs
+{
+public:
+  // port: index of the output in the outputs struct.
+  // count is 1 for a number, more for a list.
+  struct event
+  {
+    int port{};
+    bool bang{};
+    int count{1};
+    double time{};
+    std::array<double, 4> values{};
+  };
+
+  static constexpr int size = avnd::output_introspection<T>::size;
+
+  // The outputs which get an event outlet
+  template <typename C>
+  static constexpr bool is_event_output = avnd::parameter<C> || avnd::callback<C>;
+  static constexpr bool has_event_outputs
+      = avnd::parameter_output_introspection<T>::size > 0
+        || avnd::callback_output_introspection<T>::size > 0;
+
+  // f(output, avnd::predicate_index<Idx>) for each field of the outputs
+  template <typename F>
+  static void for_each_output(avnd::effect_container<T>& impl, F&& f)
+  {
+    if constexpr (size > 0)
+    {
+      auto& outs = avnd::get_outputs<T>(impl);
+      [&]<std::size_t... I>(std::index_sequence<I...>)
+      {
+        (f(boost::pfr::get<I>(outs), avnd::predicate_index<I>{}), ...);
+      }
+      (std::make_index_sequence<size>{});
+    }
+  }
+
+  deferred_outputs() { m_staging.reserve(Capacity); }
+  deferred_outputs(const deferred_outputs&) = delete;
+  deferred_outputs& operator=(const deferred_outputs&) = delete;
+
+  // Once, before processing: the callbacks queue their calls
+  void setup_callbacks(avnd::effect_container<T>& impl)
+  {
+    for_each_output(impl, [this]<typename C, std::size_t Idx>(C& out, avnd::predicate_index<Idx>) {
+      if constexpr (avnd::callback<C>)
+        setup_callback<Idx>(out.call);
+    });
+  }
+
+  // When the sample rate is known, for the outputs which limit their report_rate()
+  void prepare(double rate) noexcept
+  {
+    m_rate = rate;
+    m_last = {};
+  }
+
+  // Audio thread, before processing: the time of the first frame of the buffer
+  void begin_buffer(double time) noexcept { m_buffer_time = time; }
+
+  // Audio thread, after processing the frames of a buffer.
+  // time_of(frame) is the time of a frame of the buffer.
+  // Returns the time the binding has to schedule a drain() at, if it has to.
+  template <typename TimeOf>
+  std::optional<double>
+  collect(avnd::effect_container<T>& impl, int frames, TimeOf&& time_of)
+  {
+    for_each_output(impl, [&]<typename C, std::size_t Idx>(C& out, avnd::predicate_index<Idx>) {
+      collect_output<Idx>(out, frames, time_of);
+    });
+
+    // The changes of the buffer are queued in the order of their time
+    std::stable_sort(m_staging.begin(), m_staging.end(), [](const event& a, const event& b) {
+      return a.time < b.time;
+    });
+    for (const event& e : m_staging)
+      m_queue.push(e);
+
+    std::optional<double> res;
+    if (!m_staging.empty() && !m_scheduled.exchange(true, std::memory_order_acq_rel))
+      res = m_staging.front().time;
+    m_staging.clear();
+    return res;
+  }
+
+  // Scheduler thread: send(event) for each event due at now.
+  // Returns the time the next drain() has to happen at, if any event is left.
+  template <typename Send>
+  std::optional<double> drain(double now, Send&& send)
+  {
+    for (;;)
+    {
+      while (const event* e = m_queue.front())
+      {
+        if (e->time > now)
+          return e->time;
+        send(*e);
+        m_queue.pop();
+      }
+
+      // An event queued after the queue was seen empty would not be scheduled otherwise
+      m_scheduled.store(false, std::memory_order_release);
+      if (!m_queue.front() || m_scheduled.exchange(true, std::memory_order_acq_rel))
+        return std::nullopt;
+    }
+  }
+
+private:
+  // The aggregates of 2 to 4 numbers, sent as lists
+  template <typename V>
+  static constexpr int list_size() noexcept
+  {
+    if constexpr (std::is_aggregate_v<V> && !std::is_array_v<V>)
+    {
+      constexpr int n = boost::pfr::tuple_size_v<V>;
+      if constexpr (n >= 2 && n <= 4)
+      {
+        constexpr bool numbers = []<std::size_t... I>(std::index_sequence<I...>) {
+          return (std::is_arithmetic_v<boost::pfr::tuple_element_t<I, V>> && ...);
+        }(std::make_index_sequence<n>{});
+        return numbers ? n : 0;
+      }
+    }
+    return 0;
+  }
+
+  // Whether an output moved enough since it was last queued
+  template <typename C>
+  static bool moved(const event& e, const std::array<double, 4>& last) noexcept
+  {
+    if constexpr (requires { C::report_epsilon(); })
+    {
+      double epsilon = avnd::output_report_epsilon<C>();
+      if constexpr (avnd::has_range<C>)
+      {
+        constexpr auto r = avnd::get_range<C>();
+        epsilon *= std::abs(double(r.max) - double(r.min));
+      }
+      for (int k = 0; k < e.count; k++)
+        if (std::abs(e.values[k] - last[k]) > epsilon)
+          return true;
+      return false;
+    }
+    else
+    {
+      return !std::equal(e.values.begin(), e.values.begin() + e.count, last.begin());
+    }
+  }
+
+  template <std::size_t Idx, typename C, typename TimeOf>
+  void collect_output(C& out, int frames, TimeOf& time_of)
+  {
+    if constexpr (avnd::dynamic_sample_accurate_parameter<C>)
+    {
+      using value_type = std::decay_t<decltype(std::get<1>(*out.values.begin()))>;
+      if constexpr (std::is_arithmetic_v<value_type>)
+        for (auto& [frame, v] : out.values)
+          stage({.port = int(Idx), .time = time_of(int(frame)), .values = {double(v)}});
+      out.values.clear();
+    }
+    else if constexpr (avnd::parameter<C> && !avnd::sample_accurate_parameter<C>)
+    {
+      using value_type = std::decay_t<decltype(out.value)>;
+      constexpr int n = std::is_arithmetic_v<value_type> ? 1 : list_size<value_type>();
+      if constexpr (n > 0)
+      {
+        event e{.port = int(Idx), .count = n, .time = time_of(0)};
+        if constexpr (n == 1)
+          e.values[0] = double(out.value);
+        else
+          boost::pfr::for_each_field(out.value, [&, k = 0](const auto& v) mutable {
+            e.values[k++] = double(v);
+          });
+
+        auto& last = m_last[Idx];
+        last.elapsed += frames;
+        if (last.sent
+            && (last.elapsed < avnd::output_report_interval<C>(m_rate, 0)
+                || !moved<C>(e, last.values)))
+          return;
+
+        last = {e.values, 0, true};
+        stage(e);
+      }
+    }
+  }
+
+  void stage(const event& e) noexcept
+  {
+    if (m_staging.size() < Capacity)
+      m_staging.push_back(e);
+  }
+
+  template <std::size_t Idx, typename Call>
+  void setup_callback(Call& call)
+  {
+    if constexpr (avnd::function_view_ish<Call>)
+    {
+      using func_t = typename Call::type;
+      call.context = this;
+      call.function = view_function<Idx>(typename avnd::function_reflection_t<func_t>::arguments{});
+    }
+    else
+    {
+      setup_dynamic_callback<Idx>(call);
+    }
+  }
+
+  template <std::size_t Idx, typename... Args>
+  static auto view_function(boost::mp11::mp_list<Args...>)
+  {
+    return +[](void* ctx, Args... args) {
+      static_cast<deferred_outputs*>(ctx)->call<Idx>(args...);
+    };
+  }
+
+  template <std::size_t Idx, typename R, typename... Args, template <typename...> typename F>
+  void setup_dynamic_callback(F<R(Args...)>& call)
+  {
+    call = [this](Args... args) { this->call<Idx>(args...); };
+  }
+
+  // Calls of the callbacks, which happen while processing
+  template <std::size_t Idx, typename... Args>
+  void call(const Args&... args) noexcept
+  {
+    if constexpr (sizeof...(Args) == 0)
+      stage({.port = int(Idx), .bang = true, .count = 0, .time = m_buffer_time});
+    else if constexpr (sizeof...(Args) == 1 && (std::is_arithmetic_v<Args> && ...))
+      stage({.port = int(Idx), .time = m_buffer_time, .values = {double(args)...}});
+  }
+
+  spsc_queue<event, Capacity> m_queue;
+  std::vector<event> m_staging;
+  std::atomic_bool m_scheduled{};
+  double m_buffer_time{};
+
+  // What the numeric outputs last queued
+  struct state
+  {
+    std::array<double, 4> values{};
+    int64_t elapsed{};
+    bool sent{};
+  };
+  std::array<state, size> m_last{};
+  double m_rate{};
+};
+}
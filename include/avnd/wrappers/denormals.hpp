@@ -0,0 +1,108 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define AVND_DENORMALS_SSE 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#define AVND_DENORMALS_AARCH64 1
+#elif defined(__arm__) && defined(__ARM_FP)
+#define AVND_DENORMALS_ARM 1
+#endif
+
+namespace avnd
+{
+/**
+ * Sets the floating-point unit of the calling thread to flush denormal numbers
+ * to zero for its lifetime, and restores the previous mode afterwards.
+ *
+ * Decaying IIR filters and reverb tails otherwise fall in the denormal range,
+ * where every operation gets an order of magnitude slower on most CPUs.
+ */
+class scoped_flush_denormals
+{
+public:
+  scoped_flush_denormals() noexcept
+      : m_previous{get()}
+  {
+    set(m_previous | mask);
+  }
+
+  ~scoped_flush_denormals() { set(m_previous); }
+
+  scoped_flush_denormals(const scoped_flush_denormals&) = delete;
+  scoped_flush_denormals& operator=(const scoped_flush_denormals&) = delete;
+
+private:
+#if defined(AVND_DENORMALS_SSE)
+  // Flush-to-zero (FTZ) and denormals-are-zero (DAZ) bits of MXCSR
+  static constexpr uint64_t mask = 0x8040;
+  static uint64_t get() noexcept { return _mm_getcsr(); }
+  static void set(uint64_t v) noexcept { _mm_setcsr(uint32_t(v)); }
+#elif defined(AVND_DENORMALS_AARCH64) && defined(_MSC_VER)
+  // FZ bit of FPCR
+  static constexpr uint64_t mask = 1ull << 24;
+  static uint64_t get() noexcept { return _ReadStatusReg(ARM64_FPCR); }
+  static void set(uint64_t v) noexcept { _WriteStatusReg(ARM64_FPCR, v); }
+#elif defined(AVND_DENORMALS_AARCH64)
+  static constexpr uint64_t mask = 1ull << 24;
+  static uint64_t get() noexcept
+  {
+    uint64_t v;
+    asm volatile("mrs %0, fpcr" : "=r"(v));
+    return v;
+  }
+  static void set(uint64_t v) noexcept { asm volatile("msr fpcr, %0" : : "r"(v)); }
+#elif defined(AVND_DENORMALS_ARM)
+  // FZ bit of FPSCR
+  static constexpr uint64_t mask = 1ull << 24;
+  static uint64_t get() noexcept
+  {
+    uint32_t v;
+    asm volatile("vmrs %0, fpscr" : "=r"(v));
+    return v;
+  }
+  static void set(uint64_t v) noexcept
+  {
+    asm volatile("vmsr fpscr, %0" : : "r"(uint32_t(v)));
+  }
+#else
+  static constexpr uint64_t mask = 0;
+  static uint64_t get() noexcept { return 0; }
+  static void set(uint64_t) noexcept { }
+#endif
+
+  uint64_t m_previous{};
+};
+
+struct no_denormals_flush
+{
+};
+
+/**
+ * Processors are run with denormals flushed to zero, unless they declare
+ * static constexpr bool flush_denormals = false;
+ * e.g. if they rely on IEEE-exact gradual underflow.
+ */
+template <typename T>
+constexpr bool flushes_denormals() noexcept
+{
+  if constexpr (requires { bool(T::flush_denormals); })
+    return T::flush_denormals;
+  else
+    return true;
+}
+
+// To be put at the beginning of the audio callbacks of the bindings:
+// [[maybe_unused]] avnd::denormals_guard<T> guard;
+template <typename T>
+using denormals_guard = std::conditional_t<
+    flushes_denormals<T>(), scoped_flush_denormals, no_denormals_flush>;
+}
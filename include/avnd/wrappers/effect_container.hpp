@@ -2,10 +2,15 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
-#include <avnd/common/coroutines.hpp>
+#include <avnd/common/freestanding.hpp>
+#include <avnd/common/member_range.hpp>
 #include <avnd/concepts/all.hpp>
+#include <avnd/wrappers/simd_state_storage.hpp>
 
-#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
 
 namespace avnd
 {
@@ -31,6 +36,23 @@ struct outputs_storage<T>
   typename T::outputs outputs_storage;
 };
 
+/**
+ * The storage of one instance of a duplicated monophonic processor:
+ * a cache_aligned_processor gets cache lines of its own.
+ */
+template <typename T>
+struct alignas(64) aligned_instance : T
+{
+};
+
+template <typename T>
+using instance_storage = std::conditional_t<cache_aligned_processor<T>, aligned_instance<T>, T>;
+
+// The alignment of the storage of some members: lines of their own for a cache_aligned_processor
+template <typename T, typename... Members>
+inline constexpr std::size_t storage_alignment
+    = std::max({cache_aligned_processor<T> ? std::size_t(64) : std::size_t(1), alignof(Members)...});
+
 /**
  * @brief used to adapt monophonic effects to polyphonic hosts
  */
@@ -97,7 +119,7 @@ struct effect_container
       return dummy_instance;
   }
 
-  member_iterator<T> effects() { co_yield effect; }
+  member_range<T, identity_projection> effects() { return {&effect, &effect + 1}; }
 };
 
 template <typename T>
@@ -118,7 +140,7 @@ requires(!has_inputs<T> && !has_outputs<T> && !monophonic_audio_processor<T>) st
   auto& outputs() noexcept { return dummy_instance; }
   auto& outputs() const noexcept { return dummy_instance; }
 
-  member_iterator<T> effects() { co_yield effect; }
+  member_range<T, identity_projection> effects() { return {&effect, &effect + 1}; }
 
   struct ref
   {
@@ -129,11 +151,12 @@ requires(!has_inputs<T> && !has_outputs<T> && !monophonic_audio_processor<T>) st
     [[no_unique_address]] dummy outputs;
   };
 
-  member_iterator<ref> full_state()
+  struct make_ref
   {
-    ref r{effect, {}, {}};
-    co_yield r;
-  }
+    ref operator()(T& e) const noexcept { return ref{e, {}, {}}; }
+  };
+
+  member_range<T, make_ref> full_state() { return {&effect, &effect + 1}; }
 };
 
 template <typename T>
@@ -142,7 +165,7 @@ requires(!has_inputs<T> && !has_outputs<T> && monophonic_audio_processor<T>) str
 {
   using type = T;
 
-  std::vector<T> effect;
+  avnd::channel_vector<instance_storage<T>> effect;
   void init_channels(int input, int output)
   {
     // FIXME do that everywhere
@@ -152,8 +175,7 @@ requires(!has_inputs<T> && !has_outputs<T> && monophonic_audio_processor<T>) str
     else if (effect.size() > input)
       effect.resize(input);
     else
-      while (effect.size() < input)
-        effect.push_back(effect[0]);
+      effect.resize(input, effect[0]);
   }
 
   auto& inputs() noexcept { return dummy_instance; }
@@ -161,10 +183,9 @@ requires(!has_inputs<T> && !has_outputs<T> && monophonic_audio_processor<T>) str
   auto& outputs() noexcept { return dummy_instance; }
   auto& outputs() const noexcept { return dummy_instance; }
 
-  member_iterator<T> effects()
+  member_range<instance_storage<T>, identity_projection> effects()
   {
-    for (auto& eff : effect)
-      co_yield eff;
+    return {effect.data(), effect.data() + effect.size()};
   }
 
   struct ref
@@ -176,33 +197,38 @@ requires(!has_inputs<T> && !has_outputs<T> && monophonic_audio_processor<T>) str
     [[no_unique_address]] dummy outputs;
   };
 
-  member_iterator<ref> full_state()
+  struct make_ref
   {
-    for (auto& e : effect)
-    {
-      ref r{e, {}, {}};
-      co_yield r;
-    }
+    ref operator()(T& e) const noexcept { return ref{e, {}, {}}; }
+  };
+
+  member_range<instance_storage<T>, make_ref> full_state()
+  {
+    return {effect.data(), effect.data() + effect.size()};
   }
 };
 
 template <avnd::monophonic_audio_processor T>
 requires avnd::inputs_is_type<T> && avnd::outputs_is_type<T>
-struct effect_container<T>
+struct effect_container<T> : simd_state_storage<T>
 {
   using type = T;
 
-  typename T::inputs inputs_storage;
+  alignas(storage_alignment<T, typename T::inputs>) typename T::inputs inputs_storage;
 
-  struct state
+  struct alignas(storage_alignment<T, T, typename T::outputs>) state
   {
     T effect;
     typename T::outputs outputs_storage;
   };
 
-  std::vector<state> effect;
+  avnd::channel_vector<state> effect;
 
-  void init_channels(int input, int output) { effect.resize(std::max(input, output)); }
+  void init_channels(int input, int output)
+  {
+    effect.resize(std::max(input, output));
+    this->resize_simd_state(effect.size());
+  }
 
   auto& inputs() noexcept { return inputs_storage; }
   auto& inputs() const noexcept { return inputs_storage; }
@@ -214,42 +240,58 @@ struct effect_container<T>
     typename T::outputs& outputs;
   };
 
-  member_iterator<ref> full_state()
+  struct make_ref
+  {
+    typename T::inputs* inputs;
+    ref operator()(state& e) const noexcept
+    {
+      return ref{e.effect, *inputs, e.outputs_storage};
+    }
+  };
+  struct get_effect
+  {
+    T& operator()(state& e) const noexcept { return e.effect; }
+  };
+  struct get_outputs
   {
-    for (state& e : effect)
+    typename T::outputs& operator()(state& e) const noexcept
     {
-      ref r{e.effect, this->inputs_storage, e.outputs_storage};
-      co_yield r;
+      return e.outputs_storage;
     }
+  };
+
+  member_range<state, make_ref> full_state()
+  {
+    return {
+        effect.data(), effect.data() + effect.size(), make_ref{&this->inputs_storage}};
   }
 
-  member_iterator<T> effects()
+  member_range<state, get_effect> effects()
   {
-    for (auto& e : effect)
-      co_yield e.effect;
+    return {effect.data(), effect.data() + effect.size()};
   }
 
-  member_iterator<typename T::outputs> outputs()
+  member_range<state, get_outputs> outputs()
   {
-    for (auto& e : effect)
-      co_yield e.outputs_storage;
+    return {effect.data(), effect.data() + effect.size()};
   }
 };
 
 template <avnd::monophonic_audio_processor T>
 requires avnd::inputs_is_type<T> && avnd::outputs_is_value<T>
-struct effect_container<T>
+struct effect_container<T> : simd_state_storage<T>
 {
   using type = T;
 
-  typename T::inputs inputs_storage;
+  alignas(storage_alignment<T, typename T::inputs>) typename T::inputs inputs_storage;
 
-  std::vector<T> effect;
+  avnd::channel_vector<instance_storage<T>> effect;
 
   void init_channels(int input, int output)
   {
     assert(input == output);
     effect.resize(input);
+    this->resize_simd_state(effect.size());
   }
 
   auto& inputs() noexcept { return inputs_storage; }
@@ -261,25 +303,30 @@ struct effect_container<T>
     typename T::inputs& inputs;
     decltype(T::outputs)& outputs;
   };
-  member_iterator<ref> full_state()
+  struct make_ref
   {
-    for (T& e : effect)
-    {
-      ref r{e.effect, this->inputs_storage, e.effect.outputs};
-      co_yield r;
-    }
+    typename T::inputs* inputs;
+    ref operator()(T& e) const noexcept { return ref{e, *inputs, e.outputs}; }
+  };
+  struct get_outputs
+  {
+    auto& operator()(T& e) const noexcept { return e.outputs; }
+  };
+
+  member_range<instance_storage<T>, make_ref> full_state()
+  {
+    return {
+        effect.data(), effect.data() + effect.size(), make_ref{&this->inputs_storage}};
   }
 
-  member_iterator<T> effects()
+  member_range<instance_storage<T>, identity_projection> effects()
   {
-    for (auto& e : effect)
-      co_yield e;
+    return {effect.data(), effect.data() + effect.size()};
   }
 
-  member_iterator<typename T::outputs> outputs()
+  member_range<instance_storage<T>, get_outputs> outputs()
   {
-    for (auto& e : effect)
-      co_yield e.output;
+    return {effect.data(), effect.data() + effect.size()};
   }
 };
 
@@ -289,7 +336,7 @@ struct effect_container<T>
 {
   using type = T;
 
-  std::vector<T> effect;
+  avnd::channel_vector<instance_storage<T>> effect;
 
   void init_channels(int input, int output)
   {
@@ -299,7 +346,8 @@ struct effect_container<T>
     effect.resize(sz);
     if (orig > 0)
     {
-      for (int i = orig; i < sz; i++)
+      // effect may hold less than sz with a static capacity
+      for (int i = orig; i < std::ssize(effect); i++)
       {
         effect[i].inputs = effect[0].inputs;
       }
@@ -312,33 +360,74 @@ struct effect_container<T>
     decltype(T::inputs)& inputs;
     decltype(T::outputs)& outputs;
   };
-  member_iterator<ref> full_state()
+  struct make_ref
   {
-    for (T& e : effect)
-    {
-      ref r{e.effect, e.effect.inputs, e.effect.outputs};
-      co_yield r;
-    }
+    ref operator()(T& e) const noexcept { return ref{e, e.inputs, e.outputs}; }
+  };
+  struct get_inputs
+  {
+    auto& operator()(T& e) const noexcept { return e.inputs; }
+  };
+  struct get_outputs
+  {
+    auto& operator()(T& e) const noexcept { return e.outputs; }
+  };
+
+  member_range<instance_storage<T>, make_ref> full_state()
+  {
+    return {effect.data(), effect.data() + effect.size()};
   }
 
-  member_iterator<T> effects()
+  member_range<instance_storage<T>, identity_projection> effects()
   {
-    for (auto& e : effect)
-      co_yield e;
+    return {effect.data(), effect.data() + effect.size()};
   }
 
-  member_iterator<decltype(T::inputs)> inputs()
+  member_range<instance_storage<T>, get_inputs> inputs()
   {
-    for (auto& e : effect)
-      co_yield e.inputs;
+    return {effect.data(), effect.data() + effect.size()};
   }
-  member_iterator<decltype(T::outputs)> outputs()
+  member_range<instance_storage<T>, get_outputs> outputs()
   {
-    for (auto& e : effect)
-      co_yield e.outputs;
+    return {effect.data(), effect.data() + effect.size()};
   }
 };
 
+/**
+ * Makes room for the instances of a duplicated monophonic processor, one per channel:
+ * init_channels does not reallocate them up to that many channels.
+ */
+template <typename T>
+void reserve_channels(effect_container<T>& implementation, int input, int output)
+{
+  if constexpr (requires { implementation.effect.reserve(1); })
+  {
+    const int channels = std::max(input, output);
+    implementation.effect.reserve(channels);
+    if constexpr (requires { implementation.reserve_simd_state(1); })
+      implementation.reserve_simd_state(channels);
+  }
+}
+
+/**
+ * Frees the instances of a duplicated monophonic processor but the first one,
+ * which keeps the controls until init_channels copies them again.
+ */
+template <typename T>
+void release_channels(effect_container<T>& implementation)
+{
+  if constexpr (requires { implementation.effect.reserve(1); })
+  {
+    auto& effect = implementation.effect;
+    if (effect.size() > 1)
+      effect.resize(1);
+    if constexpr (requires { effect.shrink_to_fit(); })
+      effect.shrink_to_fit();
+    if constexpr (requires { implementation.resize_simd_state(1); })
+      implementation.resize_simd_state(effect.size());
+  }
+}
+
 template <typename T>
 struct get_object_type
 {
@@ -0,0 +1,130 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/freestanding.hpp>
+#include <avnd/concepts/audio_processor.hpp>
+#include <avnd/wrappers/control_rate.hpp>
+#include <avnd/wrappers/process_adapter.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+namespace avnd
+{
+/**
+ * Queues the audio of the host for processors with a fixed block_size,
+ * so that they always get buffers of that size whatever the host sends.
+ * The output is delayed by block_size frames, which avnd::latency_samples reports.
+ *
+ * Both queues are only used by the audio thread: nothing locks nor allocates
+ * once the buffers are allocated.
+ * A block spans several host buffers, or a part of one, while the MIDI and timed
+ * control events are in frames of the host buffer: processors with such inputs
+ * are not supported.
+ */
+template <typename T, typename Adapter = process_adapter<T>>
+struct fixed_block_adapter : Adapter
+{
+  static constexpr int block = fixed_block_size<T>();
+  static_assert(block > 0);
+  static_assert(
+      !has_timed_inputs<T>,
+      "fixed block processors cannot have MIDI or sample-accurate inputs");
+#if AVND_FREESTANDING
+  static_assert(
+      block <= AVND_FREESTANDING_MAX_FRAMES,
+      "the queues of the block hold at most AVND_FREESTANDING_MAX_FRAMES frames");
+#endif
+
+  template <std::floating_point SrcFP>
+  void allocate_buffers(process_setup setup, SrcFP f)
+  {
+    queue_for(f).allocate(setup.input_channels, setup.output_channels);
+
+    setup.frames_per_buffer = block;
+    Adapter::allocate_buffers(setup, f);
+  }
+
+  template <std::floating_point FP>
+  void process(
+      avnd::effect_container<T>& implementation, avnd::span<FP*> in, avnd::span<FP*> out,
+      int32_t n)
+  {
+    auto& q = queue_for(FP{});
+    const std::size_t ins = std::min(in.size(), q.inputs.size());
+    const std::size_t outs = std::min(out.size(), q.outputs.size());
+
+    for (std::size_t c = outs; c < out.size(); c++)
+      std::fill_n(out[c], n, FP(0));
+
+    for (int offset = 0; offset < n;)
+    {
+      const int len = std::min(n - offset, block - q.position);
+
+      // Inputs first: the host buffers may be the same for the input and the output
+      for (std::size_t c = 0; c < ins; c++)
+        std::copy_n(in[c] + offset, len, q.inputs[c] + q.position);
+      for (std::size_t c = 0; c < outs; c++)
+        std::copy_n(q.outputs[c] + q.position, len, out[c] + offset);
+
+      offset += len;
+      q.position += len;
+      if (q.position == block)
+      {
+        q.position = 0;
+        Adapter::process(
+            implementation, avnd::span<FP*>{q.inputs.data(), ins},
+            avnd::span<FP*>{q.outputs.data(), q.outputs.size()}, block);
+      }
+    }
+  }
+
+  // The blocks must go through the queues
+  template <typename... Args>
+  void process_interleaved(Args&&...) = delete;
+
+private:
+  template <typename FP>
+  struct queue
+  {
+    avnd::buffer_vector<FP> storage;
+    avnd::channel_vector<FP*> inputs;
+    avnd::channel_vector<FP*> outputs;
+    int position{};
+
+    void allocate(int in, int out)
+    {
+      // With static capacities, the channels which do not fit are not queued
+      inputs.resize(std::max(in, 0));
+      outputs.resize(std::max(out, 0));
+      in = int(inputs.size());
+      out = int(outputs.size());
+      storage.assign(std::size_t(in + out) * block, FP(0));
+      for (int c = 0; c < in; c++)
+        inputs[c] = storage.data() + std::size_t(c) * block;
+      for (int c = 0; c < out; c++)
+        outputs[c] = storage.data() + std::size_t(in + c) * block;
+      position = 0;
+    }
+  };
+
+  queue<float>& queue_for(float) noexcept { return m_queue_f; }
+  queue<double>& queue_for(double) noexcept { return m_queue_d; }
+
+  queue<float> m_queue_f;
+  queue<double> m_queue_d;
+};
+
+// What processes the blocks of the host, or the fixed blocks
+template <typename T>
+using block_process_adapter = std::conditional_t<
+    control_rate_processor<T>, control_rate_adapter<T>, process_adapter<T>>;
+
+// What the bindings use to call the processors on the buffers of the host
+template <typename T>
+using host_process_adapter = std::conditional_t<
+    (fixed_block_size<T>() > 0), fixed_block_adapter<T, block_process_adapter<T>>,
+    block_process_adapter<T>>;
+}
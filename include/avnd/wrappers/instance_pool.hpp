@@ -0,0 +1,211 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace avnd
+{
+/**
+ * The thread which makes the instances of all the instance_pools,
+ * started when the first one needs it.
+ */
+class instance_pool_thread
+{
+public:
+  static instance_pool_thread& instance()
+  {
+    static instance_pool_thread thread;
+    return thread;
+  }
+
+  instance_pool_thread(const instance_pool_thread&) = delete;
+  instance_pool_thread& operator=(const instance_pool_thread&) = delete;
+
+  ~instance_pool_thread()
+  {
+    m_stop.store(true, std::memory_order_release);
+    wake();
+    m_thread.join();
+  }
+
+  void post(std::function<void()> task)
+  {
+    {
+      std::lock_guard lock{m_mutex};
+      m_tasks.push_back(std::move(task));
+    }
+    wake();
+  }
+
+private:
+  instance_pool_thread()
+      : m_thread{[this] { run(); }}
+  {
+  }
+
+  void wake() noexcept
+  {
+    m_wakeups.fetch_add(1, std::memory_order_release);
+    m_wakeups.notify_one();
+  }
+
+  void run()
+  {
+    std::vector<std::function<void()>> tasks;
+    uint32_t seen = 0;
+    for (;;)
+    {
+      m_wakeups.wait(seen, std::memory_order_acquire);
+      seen = m_wakeups.load(std::memory_order_acquire);
+      if (m_stop.load(std::memory_order_acquire))
+        return;
+
+      {
+        std::lock_guard lock{m_mutex};
+        std::swap(tasks, m_tasks);
+      }
+      for (auto& task : tasks)
+        task();
+      tasks.clear();
+    }
+  }
+
+  std::mutex m_mutex;
+  std::vector<std::function<void()>> m_tasks;
+  std::atomic<uint32_t> m_wakeups{};
+  std::atomic_bool m_stop{};
+  std::thread m_thread;
+};
+
+/**
+ * Instances constructed and prepared ahead of time, e.g. the nodes of a processor,
+ * so that adding one while performing does not construct nor allocate anything:
+ * take() gives one of them, and another one is made on the instance_pool_thread.
+ *
+ * They are made for a Setup, e.g. the buffer size and rate of the engine:
+ * the ones made for a previous setup are dropped.
+ */
+template <typename Object, typename Setup>
+class instance_pool
+{
+public:
+  using factory = std::function<std::shared_ptr<Object>(const Setup&)>;
+
+  instance_pool(int size, factory make)
+      : m_state{std::make_shared<state>()}
+  {
+    m_state->size = size;
+    m_state->make = std::move(make);
+  }
+
+  // Makes the instances for this setup in the background, e.g. when the engine starts
+  void prepare(const Setup& setup)
+  {
+    std::vector<std::shared_ptr<Object>> dropped;
+    {
+      std::lock_guard lock{m_state->mutex};
+      if (!m_state->configured || !(m_state->setup == setup))
+      {
+        m_state->setup = setup;
+        m_state->configured = true;
+        std::swap(dropped, m_state->ready);
+      }
+    }
+    refill(m_state);
+  }
+
+  // One of the instances made for this setup, or a new one if there is none left
+  std::shared_ptr<Object> take(const Setup& setup)
+  {
+    prepare(setup);
+
+    std::shared_ptr<Object> obj;
+    {
+      std::lock_guard lock{m_state->mutex};
+      if (!m_state->ready.empty())
+      {
+        obj = std::move(m_state->ready.back());
+        m_state->ready.pop_back();
+      }
+    }
+    refill(m_state);
+
+    if (!obj)
+      obj = m_state->make(setup);
+    return obj;
+  }
+
+  // Instances ready to be taken
+  int available() const
+  {
+    std::lock_guard lock{m_state->mutex};
+    return int(m_state->ready.size());
+  }
+
+private:
+  // Shared with the tasks of the thread, which may outlive the pool
+  struct state
+  {
+    mutable std::mutex mutex;
+    Setup setup{};
+    bool configured{};
+    std::vector<std::shared_ptr<Object>> ready;
+    int pending{};
+    int size{};
+    factory make;
+  };
+
+  static void refill(const std::shared_ptr<state>& s)
+  {
+    int missing = 0;
+    {
+      std::lock_guard lock{s->mutex};
+      missing = s->size - int(s->ready.size()) - s->pending;
+      if (missing <= 0)
+        return;
+      s->pending += missing;
+    }
+
+    auto& thread = instance_pool_thread::instance();
+    for (int i = 0; i < missing; i++)
+    {
+      thread.post([weak = std::weak_ptr<state>{s}] {
+        auto s = weak.lock();
+        if (!s)
+          return;
+
+        Setup setup;
+        {
+          std::lock_guard lock{s->mutex};
+          setup = s->setup;
+        }
+
+        auto obj = s->make(setup);
+
+        bool outdated = false;
+        {
+          std::lock_guard lock{s->mutex};
+          s->pending--;
+          outdated = !(s->setup == setup);
+          if (!outdated)
+            s->ready.push_back(std::move(obj));
+        }
+
+        // The setup changed meanwhile: one for the new one instead
+        if (outdated)
+          refill(s);
+      });
+    }
+  }
+
+  std::shared_ptr<state> m_state;
+};
+}
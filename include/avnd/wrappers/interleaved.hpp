@@ -0,0 +1,118 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/span_polyfill.hpp>
+#include <avnd/wrappers/audio_buffers.hpp>
+#include <avnd/wrappers/fixed_block.hpp>
+#include <avnd/wrappers/prepare.hpp>
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <vector>
+
+namespace avnd
+{
+/**
+ * Lets the bindings of hosts with interleaved buffers call any processor.
+ *
+ * The adapters which go through the frames one at a time anyway, i.e. the ones of the
+ * per-sample processors, work on the interleaved samples directly with process_interleaved.
+ * The others get the channels of the host copied to planar buffers and back,
+ * which allocate_buffers sizes once.
+ */
+template <typename T>
+struct interleaved_process_adapter : host_process_adapter<T>
+{
+  using adapter_type = host_process_adapter<T>;
+  using adapter_type::process;
+
+  template <std::floating_point FP>
+  void allocate_buffers(process_setup setup, FP f)
+  {
+    adapter_type::allocate_buffers(setup, f);
+    if (!direct<FP>() || setup.input_channels != setup.output_channels)
+      planar_for(f).allocate(
+          setup.input_channels, setup.output_channels, setup.frames_per_buffer);
+  }
+
+  template <std::floating_point FP>
+  void process(
+      avnd::effect_container<T>& implementation, interleaved_buffer<const FP> in,
+      interleaved_buffer<FP> out, int32_t n)
+  {
+    if constexpr (direct<FP>())
+    {
+      if (in.channels == out.channels)
+      {
+        adapter_type::process_interleaved(implementation, in, out, n);
+        return;
+      }
+    }
+
+    auto& p = planar_for(FP{});
+    const int ins = std::min(in.channels, int(p.inputs.size()));
+    const int outs = std::min(out.channels, int(p.outputs.size()));
+    for (int offset = 0; offset < n && p.frames > 0; offset += p.frames)
+    {
+      const int len = std::min(n - offset, p.frames);
+      for (int c = 0; c < ins; c++)
+        for (int i = 0; i < len; i++)
+          p.inputs[c][i] = in(c, offset + i);
+
+      adapter_type::process(
+          implementation, avnd::span<FP*>{p.inputs.data(), std::size_t(ins)},
+          avnd::span<FP*>{p.outputs.data(), std::size_t(outs)}, len);
+
+      for (int i = 0; i < len; i++)
+      {
+        for (int c = 0; c < outs; c++)
+          out(c, offset + i) = p.outputs[c][i];
+        for (int c = outs; c < out.channels; c++)
+          out(c, offset + i) = FP(0);
+      }
+    }
+  }
+
+  // Whether the samples are processed where they are, without planar copies
+  template <typename FP>
+  static constexpr bool direct() noexcept
+  {
+    return requires(
+        adapter_type a, avnd::effect_container<T>& impl, interleaved_buffer<const FP> in,
+        interleaved_buffer<FP> out) { a.process_interleaved(impl, in, out, 0); };
+  }
+
+private:
+
+  template <typename FP>
+  struct planar
+  {
+    std::vector<FP> storage;
+    std::vector<FP*> inputs;
+    std::vector<FP*> outputs;
+    int frames{};
+
+    void allocate(int in, int out, int n)
+    {
+      in = std::max(in, 0);
+      out = std::max(out, 0);
+      frames = std::max(n, 0);
+      storage.assign(std::size_t(in + out) * frames, FP(0));
+      inputs.resize(in);
+      outputs.resize(out);
+      for (int c = 0; c < in; c++)
+        inputs[c] = storage.data() + std::size_t(c) * frames;
+      for (int c = 0; c < out; c++)
+        outputs[c] = storage.data() + std::size_t(in + c) * frames;
+    }
+  };
+
+  planar<float>& planar_for(float) noexcept { return m_planar_f; }
+  planar<double>& planar_for(double) noexcept { return m_planar_d; }
+
+  planar<float> m_planar_f;
+  planar<double> m_planar_d;
+};
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/audio_processor.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+
+namespace avnd
+{
+/**
+ * Processors whose output is delayed relatively to their input, e.g. because of
+ * a look-ahead or of linear-phase filters, declare by how many frames
+ * so that the host can compensate it:
+ *
+ * halp_meta(latency_samples, 64)
+ *
+ * or as a member function when it depends on the controls or the sample rate:
+ * it is read again after prepare(), and after each buffer so that the bindings
+ * tell the host when it changed, e.g. with the size of a look-ahead.
+ */
+template <typename T>
+concept has_latency = requires(T t) {
+  { t.latency_samples() } -> std::convertible_to<int64_t>;
+};
+
+// Latencies known at compile-time never have to be watched
+template <typename T>
+concept dynamic_latency = has_latency<T> && !requires {
+  typename std::integral_constant<int64_t, int64_t(T::latency_samples())>;
+};
+
+// Processors with a latency of their own, or which get their buffers queued
+// to a fixed size, see fixed_block_adapter
+template <typename T>
+concept reports_latency = has_latency<T> || (fixed_block_size<T>() > 0);
+
+// The largest latency of the instances
+template <typename T>
+int64_t latency_samples(avnd::effect_container<T>& implementation)
+{
+  int64_t latency = fixed_block_size<T>();
+  if constexpr (has_latency<T>)
+  {
+    int64_t own = 0;
+    for (auto& eff : implementation.effects())
+      own = std::max(own, int64_t(eff.latency_samples()));
+    latency += own;
+  }
+  return latency;
+}
+}
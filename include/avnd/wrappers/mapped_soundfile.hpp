@@ -0,0 +1,317 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/wrappers/soundfile_stream.hpp>
+
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace avnd
+{
+/**
+ * Read-only mapping of a whole file: the pages are loaded by the OS when
+ * first accessed, and shared by all the processes mapping the same file.
+ */
+class mapped_file
+{
+public:
+  mapped_file() = default;
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+  ~mapped_file() { close(); }
+
+  bool open(const std::string& path)
+  {
+    close();
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return false;
+
+    LARGE_INTEGER size{};
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+      mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+      return false;
+
+    m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    m_size = m_data ? std::size_t(size.QuadPart) : 0;
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+      void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (p != MAP_FAILED)
+      {
+        m_data = p;
+        m_size = st.st_size;
+      }
+    }
+    ::close(fd);
+#endif
+    return m_data != nullptr;
+  }
+
+  void close() noexcept
+  {
+    if (!m_data)
+      return;
+#if defined(_WIN32)
+    UnmapViewOfFile(m_data);
+#else
+    ::munmap(m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+  }
+
+  const unsigned char* data() const noexcept
+  {
+    return static_cast<const unsigned char*>(m_data);
+  }
+  std::size_t size() const noexcept { return m_size; }
+
+private:
+  void* m_data{};
+  std::size_t m_size{};
+};
+
+/**
+ * A soundfile as planar float32 channels mapped from the disk.
+ *
+ * Mono float32 WAVE files are mapped directly. Other files are transcoded once
+ * in a cache directory, and the cached copy is what gets mapped:
+ * instances loading the same file share its pages.
+ */
+class mapped_soundfile
+{
+public:
+  using opener = std::unique_ptr<soundfile_source> (*)(const std::string&);
+
+  // Not realtime-safe: transcoding a file the first time takes a while.
+  static std::shared_ptr<const mapped_soundfile> open(
+      const std::string& path, const std::string& cache_directory,
+      opener open_source = &wav_soundfile_source::open)
+  {
+    // Files already mapped in this process
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<const mapped_soundfile>> files;
+
+    std::lock_guard lock{mutex};
+    if (auto f = files[path].lock())
+      if (f->m_source_stamp == file_stamp(path))
+        return f;
+
+    auto f = std::shared_ptr<mapped_soundfile>(new mapped_soundfile);
+    f->m_filename = path;
+    f->m_source_stamp = file_stamp(path);
+    if (!f->map_directly(path) && !f->map_cached(path, cache_directory, open_source))
+      return {};
+
+    files[path] = f;
+    return f;
+  }
+
+  int32_t channels() const noexcept { return int32_t(m_channels.size()); }
+  int64_t frames() const noexcept { return m_frames; }
+  const float** data() const noexcept { return const_cast<const float**>(m_channels.data()); }
+  const std::string& filename() const noexcept { return m_filename; }
+
+  template <typename View>
+  void assign(View& view) const noexcept
+  {
+    view.data = data();
+    view.frames = frames();
+    view.channels = channels();
+    view.filename = m_filename;
+  }
+
+private:
+  mapped_soundfile() = default;
+
+  // Layout of the cached files: the header, then each channel
+  struct cache_header
+  {
+    char magic[8] = {'A', 'V', 'N', 'D', 'F', '3', '2', 'P'};
+    int64_t channels{};
+    int64_t frames{};
+    int64_t source_size{};
+    int64_t source_time{};
+    int64_t reserved[3]{};
+  };
+  static_assert(sizeof(cache_header) == 64);
+
+  struct stamp
+  {
+    int64_t size{-1};
+    int64_t time{};
+    bool operator==(const stamp&) const noexcept = default;
+  };
+
+  static stamp file_stamp(const std::string& path) noexcept
+  {
+#if defined(_WIN32)
+    struct _stat64 st{};
+    if (::_stat64(path.c_str(), &st) != 0)
+      return {};
+#else
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0)
+      return {};
+#endif
+    return {int64_t(st.st_size), int64_t(st.st_mtime)};
+  }
+
+  static std::string cache_path(const std::string& path, const std::string& directory)
+  {
+    // FNV-1a of the path
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : path)
+      h = (h ^ c) * 0x100000001b3ull;
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.avndf32", (unsigned long long)h);
+    std::string res = directory;
+    if (!res.empty() && res.back() != '/' && res.back() != '\\')
+      res += '/';
+    return res + name;
+  }
+
+  bool map_directly(const std::string& path)
+  {
+    if constexpr (std::endian::native != std::endian::little)
+      return false;
+
+    auto wav = wav_soundfile_source::open_wav(path);
+    if (!wav || !wav->float32() || wav->channels() != 1 || wav->data_offset() % 4 != 0)
+      return false;
+    if (!m_file.open(path)
+        || m_file.size() < std::size_t(wav->data_offset() + wav->frames() * 4))
+      return false;
+
+    m_frames = wav->frames();
+    m_channels = {reinterpret_cast<const float*>(m_file.data() + wav->data_offset())};
+    return true;
+  }
+
+  bool map_cached(const std::string& path, const std::string& directory, opener open_source)
+  {
+    const auto cached = cache_path(path, directory);
+    if (!map_cache(cached) && !(transcode(path, cached, open_source) && map_cache(cached)))
+      return false;
+    return true;
+  }
+
+  bool map_cache(const std::string& cached)
+  {
+    if (!m_file.open(cached) || m_file.size() < sizeof(cache_header))
+      return false;
+
+    cache_header h;
+    std::memcpy(&h, m_file.data(), sizeof(h));
+    const bool valid = std::memcmp(h.magic, cache_header{}.magic, 8) == 0 && h.channels > 0
+                       && stamp{h.source_size, h.source_time} == m_source_stamp
+                       && m_file.size() == sizeof(h) + std::size_t(h.channels * h.frames * 4);
+    if (!valid)
+    {
+      m_file.close();
+      return false;
+    }
+
+    const auto* samples = reinterpret_cast<const float*>(m_file.data() + sizeof(h));
+    m_frames = h.frames;
+    m_channels.resize(h.channels);
+    for (int c = 0; c < h.channels; c++)
+      m_channels[c] = samples + c * h.frames;
+    return true;
+  }
+
+  bool transcode(const std::string& path, const std::string& cached, opener open_source)
+  {
+    auto src = open_source(path);
+    if (!src || src->channels() <= 0)
+      return false;
+
+    cache_header h;
+    h.channels = src->channels();
+    h.frames = src->frames();
+    h.source_size = m_source_stamp.size;
+    h.source_time = m_source_stamp.time;
+
+    // Written next to the cache entry then renamed, for concurrent loads of the same file
+    const std::string tmp = cached + "." + std::to_string(uintptr_t(this)) + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+      return false;
+
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1;
+
+    constexpr int64_t chunk = 65536;
+    std::vector<float> buffer(chunk * h.channels);
+    std::vector<float*> pointers(h.channels);
+    for (int c = 0; c < h.channels; c++)
+      pointers[c] = buffer.data() + c * chunk;
+
+    for (int64_t first = 0; ok && first < h.frames; first += chunk)
+    {
+      const int64_t n = std::min(chunk, h.frames - first);
+      if (src->read(first, n, pointers.data()) != n)
+        ok = false;
+
+      for (int c = 0; ok && c < h.channels; c++)
+      {
+        const int64_t offset = sizeof(h) + (c * h.frames + first) * 4;
+#if defined(_WIN32)
+        ok = ::_fseeki64(f, offset, SEEK_SET) == 0;
+#else
+        ok = ::fseeko(f, offset, SEEK_SET) == 0;
+#endif
+        ok = ok && std::fwrite(pointers[c], 4, n, f) == std::size_t(n);
+      }
+    }
+
+    ok = std::fclose(f) == 0 && ok;
+
+    // Windows does not replace existing files: another instance may have been faster
+    if (!ok || std::rename(tmp.c_str(), cached.c_str()) != 0)
+      std::remove(tmp.c_str());
+    return ok;
+  }
+
+  mapped_file m_file;
+  std::vector<const float*> m_channels;
+  int64_t m_frames{};
+  std::string m_filename;
+  stamp m_source_stamp;
+};
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/function_reflection.hpp>
+#include <avnd/common/spsc_queue.hpp>
+#include <avnd/concepts/message_bus.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace avnd
+{
+template <typename T>
+struct message_bus_storage
+{
+  static constexpr void start(avnd::effect_container<T>&) noexcept { }
+  static constexpr void deliver(avnd::effect_container<T>&) noexcept { }
+  static constexpr int64_t dropped() noexcept { return 0; }
+};
+
+/**
+ * Carries the messages between a processor and its UI, see avnd::message_bus,
+ * in two wait-free queues of the types the processor declares: the messages
+ * of the UI are given to T::process_message at the start of the next buffer,
+ * in the audio thread, and those of the processor to ui::bus::process_message
+ * when the UI updates, e.g. at each frame.
+ *
+ * Nothing allocates nor locks in the audio thread: the messages of the processor
+ * are copied in place, so they have to be trivially copyable, while the ones of the UI
+ * are read where they are and destroyed by the UI thread when their slot is reused.
+ * Messages are dropped when a queue is full.
+ *
+ * The binding calls start() and deliver() like for the worker; the UI integration
+ * calls connect() once its ui exists and update() at each of its frames.
+ */
+template <typename T>
+requires message_bus<T>
+struct message_bus_storage<T>
+{
+  static constexpr std::size_t capacity = 64;
+
+  using ui_type = typename T::ui;
+  using bus_type = typename T::ui::bus;
+  using ui_to_processor = std::decay_t<first_argument<&T::process_message>>;
+  using processor_to_ui = std::decay_t<
+      first_argument_t<std::decay_t<decltype(std::declval<T&>().send_message)>>>;
+  static_assert(
+      std::is_trivially_copyable_v<processor_to_ui>,
+      "the messages sent by the processor are copied in the audio thread");
+
+  message_bus_storage() = default;
+  message_bus_storage(const message_bus_storage&) = delete;
+  message_bus_storage& operator=(const message_bus_storage&) = delete;
+
+  // Once the processors exist, outside of the audio thread, e.g. in prepare
+  void start(avnd::effect_container<T>& effect)
+  {
+    for (auto& e : effect.effects())
+      e.send_message = [this](const processor_to_ui& msg) {
+        if (!m_to_ui.push(msg))
+          m_dropped.fetch_add(1, std::memory_order_relaxed);
+      };
+  }
+
+  // Audio thread, before the processor
+  void deliver(avnd::effect_container<T>& effect) noexcept
+  {
+    while (auto* m = m_to_processor.front())
+    {
+      for (auto& e : effect.effects())
+        e.process_message(*m);
+      m_to_processor.pop();
+    }
+  }
+
+  // UI thread, once the ui is created
+  void connect(ui_type& ui)
+  {
+    m_bus.send_message = [this](ui_to_processor msg) {
+      if (!m_to_processor.push(std::move(msg)))
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    };
+    m_bus.init(ui);
+  }
+
+  // UI thread, e.g. at the start of each frame
+  void update(ui_type& ui)
+  {
+    while (auto* m = m_to_ui.front())
+    {
+      const processor_to_ui msg = *m;
+      m_to_ui.pop();
+      bus_type::process_message(ui, msg);
+    }
+  }
+
+  // The messages which did not fit in the queues
+  int64_t dropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  bus_type m_bus;
+  spsc_queue<ui_to_processor, capacity> m_to_processor;
+  spsc_queue<processor_to_ui, capacity> m_to_ui;
+  std::atomic<int64_t> m_dropped{};
+};
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/for_nth.hpp>
+#include <avnd/common/freestanding.hpp>
+#include <avnd/concepts/parameter.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/introspection/widgets.hpp>
+#include <boost/mp11.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+
+namespace avnd
+{
+/**
+ * The audio-rate modulation of a parameter for a buffer: the signals
+ * of its sources are summed in a buffer allocated once, then added to the value
+ * set by the host and clamped to the range of the parameter.
+ * The loops have no dependency between frames, so that the compiler vectorizes them.
+ */
+template <std::floating_point FP>
+struct parameter_modulation
+{
+  void prepare(int buffer_size)
+  {
+    m_sum.assign(buffer_size, FP{});
+    m_values.assign(buffer_size, FP{});
+    m_last = {};
+    m_frames = 0;
+    m_active = false;
+  }
+
+  // Sums a source, scaled by depth, into the modulation of the next buffer
+  template <typename S>
+  void add(const S* signal, int frames, FP depth) noexcept
+  {
+    const int n = extend(frames);
+    FP* __restrict sum = m_sum.data();
+    for (int i = 0; i < n; i++)
+      sum[i] += FP(signal[i]) * depth;
+  }
+
+  // A constant source, e.g. an offset set by the host
+  void offset(FP value, int frames) noexcept
+  {
+    const int n = extend(frames);
+    FP* __restrict sum = m_sum.data();
+    for (int i = 0; i < n; i++)
+      sum[i] += value;
+  }
+
+  // Computes the modulated values of the buffer from the base value,
+  // and starts accumulating the next one
+  void run(FP base, FP min, FP max, int frames, bool average) noexcept
+  {
+    m_base = base;
+    m_active = m_frames > 0;
+    if (!m_active)
+    {
+      m_last = {};
+      return;
+    }
+
+    frames = std::min(frames, int(m_values.size()));
+    const int n = std::min(frames, m_frames);
+    const FP* __restrict sum = m_sum.data();
+    FP* __restrict out = m_values.data();
+    for (int i = 0; i < n; i++)
+      out[i] = std::min(std::max(base + sum[i], min), max);
+    std::fill(out + n, out + frames, std::min(std::max(base, min), max));
+
+    if (average)
+    {
+      FP acc{};
+      for (int i = 0; i < frames; i++)
+        acc += out[i];
+      m_average = frames > 0 ? acc / FP(frames) : base;
+    }
+
+    m_last = {out, std::size_t(frames)};
+    m_frames = 0;
+  }
+
+  // Whether the last buffer was modulated
+  bool active() const noexcept { return m_active; }
+  FP base() const noexcept { return m_base; }
+  FP average() const noexcept { return m_average; }
+
+  // The modulated values of the last buffer, or an empty span without modulation
+  avnd::span<const FP> values() const noexcept { return m_last; }
+
+private:
+  // The sources of a buffer may not all cover all of its frames
+  int extend(int frames) noexcept
+  {
+    const int n = std::clamp(frames, 0, int(m_sum.size()));
+    if (n > m_frames)
+    {
+      std::fill(m_sum.data() + m_frames, m_sum.data() + n, FP{});
+      m_frames = n;
+    }
+    return n;
+  }
+
+  avnd::frame_vector<FP> m_sum;
+  avnd::frame_vector<FP> m_values;
+  avnd::span<const FP> m_last;
+  FP m_base{};
+  FP m_average{};
+  int m_frames{};
+  bool m_active{};
+};
+
+template <typename Field>
+using parameter_modulation_type
+    = parameter_modulation<std::decay_t<decltype(Field::value)>>;
+
+template <typename T>
+struct modulation_storage
+{
+  static constexpr std::array<int, 0> parameters{};
+  static constexpr bool modulatable(int) noexcept { return false; }
+  static constexpr void prepare(avnd::effect_container<T>&, int) noexcept { }
+  static constexpr void add(int, const auto*, int, double = 1.) noexcept { }
+  static constexpr void offset(int, double, int) noexcept { }
+  static constexpr void update(avnd::effect_container<T>&, int) noexcept { }
+  static constexpr void restore(avnd::effect_container<T>&) noexcept { }
+};
+
+/**
+ * Used to modulate the modulatable parameters at audio rate.
+ * The host adds the modulation sources of a parameter, by its parameter index,
+ * before each buffer; then update() has to be called before the processor,
+ * and restore() after it.
+ */
+template <typename T>
+requires(modulatable_parameter_input_introspection<T>::size > 0)
+struct modulation_storage<T>
+{
+  using modulated_in = modulatable_parameter_input_introspection<T>;
+  using param_in = parameter_input_introspection<T>;
+
+  // std::tuple< parameter_modulation<float>, parameter_modulation<double> >
+  using modulations = filter_and_apply<
+      parameter_modulation_type,
+      modulatable_parameter_input_introspection,
+      T>;
+
+  // The parameter index of each modulatable input
+  static constexpr auto parameters = [] {
+    std::array<int, modulated_in::size> res{};
+    int k = 0;
+    modulated_in::for_all([&]<auto Idx, typename M>(avnd::field_reflection<Idx, M>) {
+      res[k++] = param_in::template unmap<Idx>();
+    });
+    return res;
+  }();
+
+  static constexpr int modulation_index(int parameter) noexcept
+  {
+    for (int k = 0; k < modulated_in::size; k++)
+      if (parameters[k] == parameter)
+        return k;
+    return -1;
+  }
+
+  static constexpr bool modulatable(int parameter) noexcept
+  {
+    return modulation_index(parameter) >= 0;
+  }
+
+  modulations modulation;
+
+  void prepare(avnd::effect_container<T>& t, int buffer_size)
+  {
+    std::apply([=](auto&... m) { (m.prepare(buffer_size), ...); }, modulation);
+    modulated_in::for_all_n(
+        avnd::get_inputs(t),
+        [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          if constexpr (audio_rate_modulated_parameter<M>)
+            port.modulated = {};
+        });
+  }
+
+  // Sums a signal, scaled by depth, into the modulation of a parameter for the next buffer
+  template <typename S>
+  void add(int parameter, const S* signal, int frames, double depth = 1.) noexcept
+  {
+    avnd::for_nth<modulated_in::size>(modulation_index(parameter), [&]<std::size_t N> {
+      auto& m = std::get<N>(modulation);
+      using fp = decltype(m.base());
+      m.add(signal, frames, fp(depth));
+    });
+  }
+
+  // A constant offset, e.g. the modulation of a CLAP parameter
+  void offset(int parameter, double value, int frames) noexcept
+  {
+    avnd::for_nth<modulated_in::size>(modulation_index(parameter), [&]<std::size_t N> {
+      auto& m = std::get<N>(modulation);
+      using fp = decltype(m.base());
+      m.offset(fp(value), frames);
+    });
+  }
+
+  // Before the processor: the values of the modulated parameters for this buffer
+  void update(avnd::effect_container<T>& t, int frames)
+  {
+    // Duplicated instances all share the modulation, which is only computed for the first one
+    ++m_update;
+    modulated_in::for_all_n(
+        avnd::get_inputs(t),
+        [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          auto& m = std::get<Idx>(this->modulation);
+          if (m_last_update[Idx] != m_update)
+          {
+            m_last_update[Idx] = m_update;
+            using fp = decltype(m.base());
+            fp min = -std::numeric_limits<fp>::infinity();
+            fp max = std::numeric_limits<fp>::infinity();
+            if constexpr (avnd::has_range<M>)
+            {
+              constexpr auto range = avnd::get_range<M>();
+              min = std::min(fp(range.min), fp(range.max));
+              max = std::max(fp(range.min), fp(range.max));
+            }
+            m.run(port.value, min, max, frames, !audio_rate_modulated_parameter<M>);
+          }
+
+          if constexpr (audio_rate_modulated_parameter<M>)
+            port.modulated = m.values();
+          else if (m.active())
+            port.value = m.average();
+        });
+  }
+
+  // After the processor: the value set by the host, for the next buffers
+  void restore(avnd::effect_container<T>& t) noexcept
+  {
+    modulated_in::for_all_n(
+        avnd::get_inputs(t),
+        [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          if constexpr (!audio_rate_modulated_parameter<M>)
+          {
+            auto& m = std::get<Idx>(this->modulation);
+            if (m.active())
+              port.value = m.base();
+          }
+        });
+  }
+
+private:
+  int64_t m_update{};
+  int64_t m_last_update[modulated_in::size]{};
+};
+}
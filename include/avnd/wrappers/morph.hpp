@@ -0,0 +1,180 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/audio_processor.hpp>
+#include <avnd/concepts/parameter.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/introspection/widgets.hpp>
+#include <boost/mp11.hpp>
+#include <boost/pfr.hpp>
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+namespace avnd
+{
+template <typename Field>
+using is_morph_parameter_t = boost::mp11::mp_bool<morph_parameter<Field>>;
+
+// The controls which are interpolated between the programs, the others switch
+template <typename Field>
+using is_morphed_parameter_t = boost::mp11::mp_bool<
+    !morph_parameter<Field> && std::floating_point<std::decay_t<decltype(Field::value)>>>;
+
+template <typename T>
+struct morph_storage
+{
+  static constexpr bool update(avnd::effect_container<T>&) noexcept { return false; }
+};
+
+/**
+ * Morphs all the controls of a processor between its programs, driven by one
+ * morph_parameter control: a slider goes from T::programs[0] to T::programs[1],
+ * an XY pad between the first four, one in each corner:
+ *
+ * 2 -- 3
+ * |    |
+ * 0 -- 1
+ *
+ * The floating-point controls are interpolated, in a single pass over contiguous
+ * tables of their values in each program, which the compiler vectorizes.
+ * The others take the value of the program the morph is the closest to.
+ *
+ * The controls are only written when the morph control moves, so that they can still
+ * be changed on their own in between: update() has to be called before each call
+ * to the processor, once the controls of the host are written and before the smoothing.
+ */
+template <typename T>
+requires has_programs<T>
+         && (boost::mp11::mp_count_if<
+                 typename parameter_input_introspection<T>::fields,
+                 is_morph_parameter_t>::value
+             == 1)
+struct morph_storage<T>
+{
+  using parameters_in = parameter_input_introspection<T>;
+  using fields = typename parameters_in::fields;
+
+  static constexpr std::size_t morph_index
+      = boost::mp11::mp_find_if<fields, is_morph_parameter_t>::value;
+  using morph_field = boost::mp11::mp_at_c<fields, morph_index>;
+  static constexpr bool xy = xy_parameter<morph_field>;
+  static constexpr std::size_t corners = xy ? 4 : 2;
+  static_assert(
+      std::size(T::programs) >= corners,
+      "A morph needs two programs, or four for an XY one");
+
+  // Position of each control in the tables of values, or -1 when it is not interpolated
+  static constexpr std::size_t morphed_count
+      = boost::mp11::mp_count_if<fields, is_morphed_parameter_t>::value;
+  static constexpr auto morphed_index = []<std::size_t... I>(std::index_sequence<I...>) {
+    std::array<int, sizeof...(I) + 1> res{};
+    int k = 0;
+    ((res[I] = is_morphed_parameter_t<boost::mp11::mp_at_c<fields, I>>::value ? k++ : -1),
+     ...);
+    return res;
+  }(std::make_index_sequence<parameters_in::size>{});
+
+  // The values of the interpolated controls in each program, then the result
+  std::array<std::array<double, morphed_count + 1>, corners> tables{};
+  std::array<double, morphed_count + 1> result{};
+
+  morph_storage()
+  {
+    for (std::size_t p = 0; p < corners; p++)
+    {
+      [&]<std::size_t... Index>(std::index_sequence<Index...>) {
+        const auto& source = T::programs[p].parameters;
+        (
+            [&] {
+              if constexpr (morphed_index[Index] >= 0)
+                tables[p][morphed_index[Index]]
+                    = boost::pfr::get<parameters_in::index_map[Index]>(source).value;
+            }(),
+            ...);
+      }(std::make_index_sequence<parameters_in::size>{});
+    }
+  }
+
+  // Returns whether the controls were written
+  bool update(avnd::effect_container<T>& t)
+  {
+    auto& inputs = avnd::get_inputs(t);
+    double x{}, y{};
+    bool moved = !m_started;
+    parameters_in::for_all_n(
+        inputs, [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          if constexpr (Idx == morph_index)
+          {
+            if constexpr (xy)
+            {
+              x = to_unit<M>(port.value.x);
+              y = to_unit<M>(port.value.y);
+            }
+            else
+            {
+              x = to_unit<M>(port.value);
+            }
+          }
+        });
+    moved |= x != m_x || y != m_y;
+    if (!moved)
+      return false;
+    m_started = true;
+    m_x = x;
+    m_y = y;
+
+    // Bilinear weights of the corners
+    std::array<double, corners> w;
+    if constexpr (xy)
+      w = {(1. - x) * (1. - y), x * (1. - y), (1. - x) * y, x * y};
+    else
+      w = {1. - x, x};
+
+    double* res = result.data();
+    for (std::size_t i = 0; i < morphed_count; i++)
+      res[i] = w[0] * tables[0][i];
+    for (std::size_t p = 1; p < corners; p++)
+    {
+      const double wp = w[p];
+      const double* table = tables[p].data();
+      for (std::size_t i = 0; i < morphed_count; i++)
+        res[i] += wp * table[i];
+    }
+
+    const auto closest = std::size_t(std::max_element(w.begin(), w.end()) - w.begin());
+    parameters_in::for_all_n(
+        inputs, [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          if constexpr (morphed_index[Idx] >= 0)
+            port.value = std::decay_t<decltype(port.value)>(result[morphed_index[Idx]]);
+          else if constexpr (Idx != morph_index)
+            port.value = boost::pfr::get<parameters_in::index_map[Idx]>(
+                             T::programs[closest].parameters)
+                             .value;
+        });
+    return true;
+  }
+
+private:
+  template <typename M>
+  static double to_unit(double v) noexcept
+  {
+    if constexpr (avnd::has_range<M>)
+    {
+      constexpr auto c = avnd::get_range<M>();
+      if constexpr (c.max != c.min)
+        v = (v - c.min) / double(c.max - c.min);
+    }
+    return std::clamp(v, 0., 1.);
+  }
+
+  double m_x{};
+  double m_y{};
+  bool m_started{};
+};
+}
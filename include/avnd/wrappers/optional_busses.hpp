@@ -0,0 +1,64 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/audio_port.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <type_traits>
+
+namespace avnd
+{
+/**
+ * Tells a processor whether the host connected one of its audio busses,
+ * e.g. from VST3's activateBus or from the cables of an ossia inlet.
+ * Only the busses declared optional get it (see halp::optional_bus):
+ * when they are not connected, the process adapter gives them no channel.
+ * Returns whether the bus is optional, i.e. whether the host may leave it without buffers.
+ */
+template <typename T>
+bool set_input_bus_connected(
+    avnd::effect_container<T>& implementation, int bus, bool connected) noexcept
+{
+  using refl = avnd::audio_bus_input_introspection<T>;
+  bool optional = false;
+  if constexpr (refl::size > 0)
+    refl::for_nth_mapped(implementation.inputs(), bus, [&]<typename P>(P& port) {
+      if constexpr (avnd::optional_audio_port<P>)
+      {
+        port.connected = connected;
+        optional = true;
+      }
+    });
+  return optional;
+}
+
+template <typename T>
+bool set_output_bus_connected(
+    avnd::effect_container<T>& implementation, int bus, bool connected) noexcept
+{
+  using refl = avnd::audio_bus_output_introspection<T>;
+  bool optional = false;
+  if constexpr (refl::size > 0)
+    refl::for_nth_mapped(implementation.outputs(), bus, [&]<typename P>(P& port) {
+      if constexpr (avnd::optional_audio_port<P>)
+      {
+        port.connected = connected;
+        optional = true;
+      }
+    });
+  return optional;
+}
+
+// Whether the processor gets the channels of the bus for this buffer
+template <typename P>
+bool bus_connected(const P& port) noexcept
+{
+  if constexpr (avnd::optional_audio_port<P>)
+    return port.connected;
+  else
+    return true;
+}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace avnd
+{
+// For the bindings which share a single id space between input and output parameters:
+// the id of an output parameter is its index in the outputs with this bit set.
+static constexpr uint32_t output_parameter_id_bit = 1u << 30;
+
+/**
+ * Output parameters, e.g. meters, can declare the smallest change worth reporting
+ * to the host, relative to their range, or in their unit when they have none:
+ *
+ * static consteval double report_epsilon() { return 0.01; }
+ */
+template <typename C>
+constexpr double output_report_epsilon() noexcept
+{
+  if constexpr (requires { C::report_epsilon(); })
+    return C::report_epsilon();
+  else
+    return 1e-3;
+}
+
+/**
+ * They can also ask to be reported at most a number of times per second,
+ * whatever the binding does otherwise:
+ *
+ * static consteval double report_rate() { return 20.; }
+ *
+ * 0 when they do not.
+ */
+template <typename C>
+constexpr double output_report_rate() noexcept
+{
+  if constexpr (requires { C::report_rate(); })
+    return C::report_rate();
+  else
+    return 0.;
+}
+
+// The frames between two reports of an output at this sample rate,
+// for the outputs which declare a report_rate(); otherwise the default
+template <typename C>
+constexpr int64_t output_report_interval(double rate, int64_t default_interval) noexcept
+{
+  if constexpr (output_report_rate<C>() > 0.)
+    return int64_t(rate / output_report_rate<C>());
+  else
+    return default_interval;
+}
+
+/**
+ * Sends the changes of the output parameters of a processor to the host:
+ * a value is only reported when it moved by more than the epsilon of the parameter
+ * since it was last reported, and at most once per interval, so that meters
+ * do not flood the event queues of the host at every buffer.
+ */
+template <typename T>
+struct output_parameter_reporter
+{
+  void prepare(double rate, double reports_per_second = 30.) noexcept { }
+
+  template <typename F>
+  void report(avnd::effect_container<T>& implementation, int frames, F&& f)
+  {
+  }
+};
+
+template <typename T>
+  requires(parameter_output_introspection<T>::size > 0)
+struct output_parameter_reporter<T>
+{
+  using refl = parameter_output_introspection<T>;
+
+  void prepare(double rate, double reports_per_second = 30.) noexcept
+  {
+    m_rate = rate;
+    m_interval = int64_t(rate / std::max(reports_per_second, 1e-3));
+    m_last = {};
+  }
+
+  // Call after the processor ran for the given frames:
+  // f(field, index of the field in the outputs) is called for the values to report.
+  template <typename F>
+  void report(avnd::effect_container<T>& implementation, int frames, F&& f)
+  {
+    refl::for_all_n2(
+        implementation.outputs(),
+        [&]<std::size_t Idx, std::size_t Field, typename C>(
+            C& field, avnd::predicate_index<Idx>, avnd::field_index<Field>) {
+          auto& last = m_last[Idx];
+          last.elapsed += frames;
+
+          const double v = avnd::map_control_to_01(field);
+          if (last.reported
+              && (last.elapsed < output_report_interval<C>(m_rate, m_interval)
+                  || std::abs(v - last.value) <= output_report_epsilon<C>()))
+            return;
+
+          last = {v, 0, true};
+          f(field, int(Field));
+        });
+  }
+
+private:
+  struct state
+  {
+    double value{};
+    int64_t elapsed{};
+    bool reported{};
+  };
+
+  std::array<state, refl::size> m_last{};
+  double m_rate{};
+  int64_t m_interval{};
+};
+}
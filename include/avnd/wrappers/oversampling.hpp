@@ -0,0 +1,381 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/wrappers/chain.hpp>
+#include <avnd/wrappers/latency.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+
+namespace avnd
+{
+/**
+ * Half-band lowpass filters, which double or halve the sample rate.
+ *
+ * They have 4K - 1 taps, of which only the center one and the 2K odd ones are
+ * not zero: each output sample thus costs K multiplications of symmetric pairs.
+ * The loops are written so that the compiler can vectorize them.
+ */
+template <typename FP>
+std::vector<FP> halfband_taps(int k)
+{
+  using std::numbers::pi;
+
+  // Odd taps at ±(2i + 1), windowed with a Blackman-Harris spanning ±2K
+  std::vector<double> taps(k);
+  double sum = 0.;
+  for (int i = 0; i < k; i++)
+  {
+    const double m = 2 * i + 1;
+    const double x = pi * m / (2. * k);
+    const double window = 0.35875 + 0.48829 * std::cos(x) + 0.14128 * std::cos(2. * x)
+                          + 0.01168 * std::cos(3. * x);
+    taps[i] = std::sin(pi * m / 2.) / (pi * m) * window;
+    sum += taps[i];
+  }
+
+  // Unity gain at DC, with the center tap at 0.5
+  std::vector<FP> res(k);
+  for (int i = 0; i < k; i++)
+    res[i] = FP(taps[i] * 0.25 / sum);
+  return res;
+}
+
+template <typename FP>
+class halfband_upsampler
+{
+public:
+  // Up to frames input samples per process() call
+  void prepare(int k, int frames)
+  {
+    m_taps = halfband_taps<FP>(k);
+    m_buffer.assign(history() + frames, FP(0));
+  }
+
+  // Delay of the output, at the output rate
+  int latency() const noexcept { return history(); }
+
+  // Writes 2 * frames samples
+  void process(const FP* in, int frames, FP* out) noexcept
+  {
+    const int k = int(m_taps.size());
+    const int h = history();
+    const FP* taps = m_taps.data();
+    std::copy_n(in, frames, m_buffer.data() + h);
+
+    for (int n = 0; n < frames; n++)
+    {
+      // p[h] is the current input sample
+      const FP* p = m_buffer.data() + n;
+      FP acc{};
+      for (int i = 0; i < k; i++)
+        acc += taps[i] * (p[k + i] + p[k - 1 - i]);
+      out[2 * n] = FP(2) * acc;
+      out[2 * n + 1] = p[k];
+    }
+
+    std::copy_n(m_buffer.data() + frames, h, m_buffer.data());
+  }
+
+private:
+  int history() const noexcept { return std::max(2 * int(m_taps.size()) - 1, 0); }
+
+  std::vector<FP> m_taps;
+  std::vector<FP> m_buffer;
+};
+
+template <typename FP>
+class halfband_downsampler
+{
+public:
+  // Up to frames output samples per process() call
+  void prepare(int k, int frames)
+  {
+    m_taps = halfband_taps<FP>(k);
+    m_buffer.assign(history() + 2 * frames, FP(0));
+  }
+
+  // Delay of the output, at the input rate
+  int latency() const noexcept { return std::max(2 * int(m_taps.size()) - 1, 0); }
+
+  // Reads 2 * frames samples
+  void process(const FP* in, int frames, FP* out) noexcept
+  {
+    const int k = int(m_taps.size());
+    const int h = history();
+    const FP* taps = m_taps.data();
+    std::copy_n(in, 2 * frames, m_buffer.data() + h);
+
+    for (int n = 0; n < frames; n++)
+    {
+      // q[h] is the first of the two input samples of this output sample
+      const FP* q = m_buffer.data() + 2 * n;
+      FP acc = FP(0.5) * q[2 * k - 1];
+      for (int i = 0; i < k; i++)
+        acc += taps[i] * (q[2 * k + 2 * i] + q[2 * k - 2 - 2 * i]);
+      out[n] = acc;
+    }
+
+    std::copy_n(m_buffer.data() + 2 * frames, h, m_buffer.data());
+  }
+
+private:
+  int history() const noexcept { return std::max(4 * int(m_taps.size()) - 2, 0); }
+
+  std::vector<FP> m_taps;
+  std::vector<FP> m_buffer;
+};
+
+namespace oversampling_detail
+{
+// The first stage sees the content closest to its Nyquist frequency,
+// the next ones only have to remove the images of an already filtered signal
+constexpr int half_taps(int stage) noexcept
+{
+  return stage == 0 ? 16 : 6;
+}
+
+// Delay of the up and down sampling stages, at the oversampled rate
+constexpr int filters_latency(int stages) noexcept
+{
+  int res = 0;
+  for (int s = 0; s < stages; s++)
+    res += (2 * half_taps(s) - 1) << (stages - s);
+  return res;
+}
+
+// Added at the oversampled rate so that the whole latency is a number of frames
+// at the base rate, which the host can compensate exactly
+constexpr int padding(int stages) noexcept
+{
+  const int factor = 1 << stages;
+  return (factor - filters_latency(stages) % factor) % factor;
+}
+
+// The latency at the base rate
+constexpr int latency(int stages) noexcept
+{
+  return (filters_latency(stages) + padding(stages)) >> stages;
+}
+
+template <typename FP>
+class upsampling_cascade
+{
+public:
+  void prepare(int stages, int frames)
+  {
+    m_stages.resize(stages);
+    m_buffers.resize(stages);
+    for (int s = 0; s < stages; s++)
+    {
+      m_stages[s].prepare(half_taps(s), frames << s);
+      m_buffers[s].assign(std::size_t(frames) << (s + 1), FP(0));
+    }
+  }
+
+  // frames << stages samples at the oversampled rate
+  FP* process(const FP* in, int frames) noexcept
+  {
+    for (std::size_t s = 0; s < m_stages.size(); s++)
+    {
+      m_stages[s].process(in, frames << s, m_buffers[s].data());
+      in = m_buffers[s].data();
+    }
+    return m_buffers.back().data();
+  }
+
+private:
+  std::vector<halfband_upsampler<FP>> m_stages;
+  std::vector<std::vector<FP>> m_buffers;
+};
+
+template <typename FP>
+class downsampling_cascade
+{
+public:
+  void prepare(int stages, int frames)
+  {
+    m_padding = padding(stages);
+    m_input.assign(m_padding + (std::size_t(frames) << stages), FP(0));
+    m_stages.resize(stages);
+    m_buffers.resize(stages);
+    for (int s = 0; s < stages; s++)
+    {
+      m_stages[s].prepare(half_taps(s), frames << s);
+      m_buffers[s].assign(s > 0 ? std::size_t(frames) << s : 0, FP(0));
+    }
+  }
+
+  // Where the processor writes, at the oversampled rate
+  FP* input() noexcept { return m_input.data() + m_padding; }
+
+  void process(int frames, FP* out) noexcept
+  {
+    const int stages = int(m_stages.size());
+    const FP* in = m_input.data();
+    for (int s = stages - 1; s >= 0; s--)
+    {
+      FP* dst = s > 0 ? m_buffers[s].data() : out;
+      m_stages[s].process(in, frames << s, dst);
+      in = dst;
+    }
+
+    // The last samples are delayed to the next buffer
+    std::copy_n(m_input.data() + (std::size_t(frames) << stages), m_padding, m_input.data());
+  }
+
+private:
+  int m_padding{};
+  std::vector<FP> m_input;
+  std::vector<halfband_downsampler<FP>> m_stages;
+  std::vector<std::vector<FP>> m_buffers;
+};
+}
+
+/**
+ * Runs a processor at Factor times the sample rate, e.g. so that the harmonics
+ * created by a non-linearity do not alias:
+ *
+ * struct Saturation4x : avnd::oversampled<Saturation, 4> {
+ *   halp_meta(name, "Saturation (4x)") ...
+ * };
+ *
+ * The processor has an audio bus as input and one as output, the other ports
+ * being parameters: it gets prepared and run at the oversampled rate, with
+ * buffers Factor times larger. The audio goes through cascaded half-band
+ * filters, whose latency is reported to the host.
+ */
+template <typename T, int Factor>
+struct oversampled : T
+{
+  static_assert(
+      Factor >= 2 && Factor <= 16 && std::has_single_bit(unsigned(Factor)),
+      "the oversampling factor must be 2, 4, 8 or 16");
+  static_assert(
+      chain_detail::valid_stage<T>()
+          && boost::mp11::mp_size<chain_detail::output_buses<T>>::value == 1,
+      "oversampled processors must have an audio bus as input, one as output, "
+      "and parameters");
+
+  static constexpr int factor = Factor;
+  static constexpr int stages = std::countr_zero(unsigned(Factor));
+
+  using input_bus_type = chain_detail::input_bus<T>;
+  using output_bus_type = boost::mp11::mp_front<chain_detail::output_buses<T>>;
+  using input_sample_type = chain_detail::sample_type<input_bus_type>;
+  using output_sample_type = chain_detail::sample_type<output_bus_type>;
+
+  struct setup
+  {
+    int input_channels{};
+    int output_channels{};
+    int frames{};
+    double rate{};
+  };
+
+  struct tick
+  {
+    int frames{};
+  };
+
+  void prepare(setup s)
+  {
+    constexpr int fixed_in = chain_detail::fixed_channels<input_bus_type>();
+    constexpr int fixed_out = chain_detail::fixed_channels<output_bus_type>();
+    const int in_channels = fixed_in >= 0 ? fixed_in : s.input_channels;
+    const int out_channels = fixed_out >= 0 ? fixed_out : s.output_channels;
+
+    m_frames = std::max(s.frames, 0);
+    m_up.resize(in_channels);
+    for (auto& c : m_up)
+      c.prepare(stages, m_frames);
+    m_down.resize(out_channels);
+    for (auto& c : m_down)
+      c.prepare(stages, m_frames);
+    m_in_ptrs.assign(in_channels, nullptr);
+    m_out_ptrs.assign(out_channels, nullptr);
+
+    avnd::prepare(
+        static_cast<T&>(*this),
+        process_setup{
+            .input_channels = in_channels,
+            .output_channels = out_channels,
+            .frames_per_buffer = m_frames * Factor,
+            .rate = s.rate * Factor});
+  }
+
+  void operator()(tick t)
+  {
+    using in_info = audio_bus_introspection<typename avnd::inputs_type<T>::type>;
+    using out_info = audio_bus_introspection<typename avnd::outputs_type<T>::type>;
+    auto& in = in_info::template get<0>(this->inputs);
+    auto& out = out_info::template get<0>(this->outputs);
+
+    const auto host_in = in.samples;
+    const auto host_out = out.samples;
+    const int host_out_channels = avnd::get_channels(out);
+    const int in_channels = std::min(avnd::get_channels(in), int(m_up.size()));
+    const int out_channels = std::min(host_out_channels, int(m_down.size()));
+
+    // Channels which were not prepared are left silent
+    for (int c = out_channels; c < host_out_channels; c++)
+      std::fill_n(host_out[c], t.frames, output_sample_type{});
+    if (m_frames <= 0)
+    {
+      for (int c = 0; c < out_channels; c++)
+        std::fill_n(host_out[c], t.frames, output_sample_type{});
+      return;
+    }
+
+    [[maybe_unused]] const int host_in_channels = avnd::get_channels(in);
+    if constexpr (dynamic_poly_audio_port<input_bus_type>)
+      in.channels = in_channels;
+    if constexpr (dynamic_poly_audio_port<output_bus_type>)
+      out.channels = out_channels;
+
+    for (int done = 0; done < t.frames; done += m_frames)
+    {
+      const int frames = std::min(m_frames, t.frames - done);
+      for (int c = 0; c < in_channels; c++)
+        m_in_ptrs[c] = m_up[c].process(host_in[c] + done, frames);
+      for (int c = 0; c < out_channels; c++)
+        m_out_ptrs[c] = m_down[c].input();
+
+      in.samples = const_cast<decltype(in.samples)>(m_in_ptrs.data());
+      out.samples = m_out_ptrs.data();
+      chain_detail::invoke(static_cast<T&>(*this), frames * Factor);
+
+      for (int c = 0; c < out_channels; c++)
+        m_down[c].process(frames, host_out[c] + done);
+    }
+
+    in.samples = host_in;
+    out.samples = host_out;
+    if constexpr (dynamic_poly_audio_port<input_bus_type>)
+      in.channels = host_in_channels;
+    if constexpr (dynamic_poly_audio_port<output_bus_type>)
+      out.channels = host_out_channels;
+  }
+
+  // The latency of the filters, plus the one of the processor if it has one
+  int64_t latency_samples() noexcept
+  {
+    int64_t res = oversampling_detail::latency(stages);
+    if constexpr (has_latency<T>)
+      res += (int64_t(static_cast<T&>(*this).latency_samples()) + Factor / 2) / Factor;
+    return res;
+  }
+
+private:
+  int m_frames{};
+  std::vector<oversampling_detail::upsampling_cascade<input_sample_type>> m_up;
+  std::vector<oversampling_detail::downsampling_cascade<output_sample_type>> m_down;
+  std::vector<input_sample_type*> m_in_ptrs;
+  std::vector<output_sample_type*> m_out_ptrs;
+};
+}
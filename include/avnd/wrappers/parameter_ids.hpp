@@ -0,0 +1,126 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/introspection/input.hpp>
+#include <avnd/wrappers/output_parameters.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace avnd
+{
+/**
+ * The ids under which the input parameters of a processor are known to the host.
+ *
+ * By default, the id of a parameter is the index of its field in the inputs:
+ * adding or moving a field thus changes the ids, and the automations and
+ * sessions saved by the host. A control can declare its id:
+ *
+ *   static consteval uint32_t id() { return 1234; }
+ *
+ * and a processor can ask for the ids of all its controls to be derived from
+ * their names, which stay stable across reorderings:
+ *
+ *   static constexpr bool stable_parameter_ids = true;
+ *
+ * The ids must be unique across the inputs and below output_parameter_id_bit.
+ */
+template <typename C>
+consteval uint32_t parameter_name_id() noexcept
+{
+  // FNV-1a, folded below the bit reserved for the output parameters
+  uint32_t h = 2166136261u;
+  for (char c : std::string_view{C::name()})
+  {
+    h ^= uint8_t(c);
+    h *= 16777619u;
+  }
+  return h % output_parameter_id_bit;
+}
+
+template <typename T, int N>
+consteval uint32_t parameter_id() noexcept
+{
+  using refl = parameter_input_introspection<T>;
+  using C = typename refl::template nth_element<N>;
+  if constexpr (requires { C::id(); })
+    return uint32_t(C::id());
+  else if constexpr (requires { requires bool(T::stable_parameter_ids); })
+    return parameter_name_id<C>();
+  else
+    return uint32_t(refl::index_map[N]);
+}
+
+template <typename T>
+struct parameter_ids
+{
+  using refl = parameter_input_introspection<T>;
+  static constexpr int size = refl::size;
+
+  // The id of each parameter, in the order of the inputs
+  static constexpr std::array<uint32_t, size> ids
+      = []<int... N>(std::integer_sequence<int, N...>) {
+          return std::array<uint32_t, size>{parameter_id<T, N>()...};
+        }(std::make_integer_sequence<int, size>{});
+
+  // True when the ids are the indices of the fields, looked up in a table
+  static constexpr bool field_indices = [] {
+    for (int i = 0; i < size; i++)
+      if (ids[i] != uint32_t(refl::index_map[i]))
+        return false;
+    return true;
+  }();
+
+  // field index -> parameter index, or size for the fields which are not parameters
+  static constexpr auto by_field = [] {
+    constexpr int fields = size > 0 ? refl::index_map[std::max(size - 1, 0)] + 1 : 0;
+    std::array<int, fields> res{};
+    res.fill(size);
+    for (int i = 0; i < size; i++)
+      res[refl::index_map[i]] = i;
+    return res;
+  }();
+
+  // (id, parameter index) sorted by id, for the declared ids
+  static constexpr auto by_id = [] {
+    std::array<std::pair<uint32_t, int>, size> res{};
+    for (int i = 0; i < size; i++)
+      res[i] = {ids[i], i};
+    std::sort(res.begin(), res.end());
+    return res;
+  }();
+
+  static_assert(
+      std::adjacent_find(
+          by_id.begin(), by_id.end(),
+          [](const auto& a, const auto& b) { return a.first == b.first; })
+          == by_id.end(),
+      "Two parameters have the same id");
+  static_assert(
+      std::all_of(
+          ids.begin(), ids.end(), [](uint32_t id) { return id < output_parameter_id_bit; }),
+      "Parameter ids must be below output_parameter_id_bit");
+
+  static constexpr uint32_t id(int index) noexcept { return ids[index]; }
+
+  // The parameter index of an id, or size for unknown ids
+  static constexpr int index(uint32_t id) noexcept
+  {
+    if constexpr (field_indices)
+    {
+      return id < by_field.size() ? by_field[id] : size;
+    }
+    else
+    {
+      auto it = std::lower_bound(
+          by_id.begin(), by_id.end(), id,
+          [](const std::pair<uint32_t, int>& p, uint32_t id) { return p.first < id; });
+      return it != by_id.end() && it->first == id ? it->second : size;
+    }
+  }
+};
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/audio_port.hpp>
+#include <avnd/concepts/processor.hpp>
+#include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/optional_busses.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+namespace avnd
+{
+/**
+ * Runs one buffer of a per_bus_processor:
+ *
+ *   void process_bus(int bus, int frames);
+ *
+ * Each output bus is rendered on its own, in the samples the adapter assigned to it,
+ * e.g. the bands of a multiband processor or the stems of a splitter.
+ * The busses go to the worker threads the processor was given with its task runner
+ * (see bind_task_runner) when each of them has at least min_samples_per_bus samples
+ * to render (frames * channels, unless T::min_samples_per_bus() says otherwise):
+ * process_bus() must then only write to its own bus.
+ * Busses which the host did not connect are skipped.
+ */
+template <per_bus_processor T>
+void run_output_busses(T& obj, int frames)
+{
+  using o_info = avnd::audio_bus_output_introspection<T>;
+  static constexpr int busses = o_info::size;
+
+  auto job = [&](int b) {
+    bool connected = true;
+    o_info::for_nth_mapped(
+        obj.outputs, b, [&](auto& bus) { connected = avnd::bus_connected(bus); });
+    if (connected)
+      obj.process_bus(b, frames);
+  };
+
+  bool done = false;
+  if constexpr (task_runner_processor<T> && busses > 1)
+  {
+    int64_t min_samples = 4096;
+    if constexpr (requires { T::min_samples_per_bus(); })
+      min_samples = T::min_samples_per_bus();
+
+    int64_t samples = 0;
+    o_info::for_all(obj.outputs, [&](auto& bus) {
+      samples += int64_t(avnd::get_channels(bus)) * frames;
+    });
+
+    if (obj.tasks.request && samples >= min_samples * busses)
+      done = obj.tasks.request(
+          obj.tasks.pool, busses,
+          +[](void* ctx, int t) { (*static_cast<decltype(job)*>(ctx))(t); },
+          (void*)std::addressof(job));
+  }
+  if (!done)
+    for (int b = 0; b < busses; b++)
+      job(b);
+}
+}
@@ -3,8 +3,13 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <avnd/common/function_reflection.hpp>
+#include <avnd/common/setup_change.hpp>
 #include <avnd/concepts/audio_processor.hpp>
+#include <avnd/introspection/channels.hpp>
 #include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/render_mode.hpp>
+
+#include <algorithm>
 
 namespace avnd
 {
@@ -14,11 +19,50 @@ struct process_setup
   int output_channels{};
   int frames_per_buffer{};
   double rate{};
+
+  // The most channels the host will ask for until the next setup, if it knows:
+  // the buffers are then sized for them, and changes of the channels up to
+  // them do not reallocate anything (see with_max_channels).
+  int max_input_channels{};
+  int max_output_channels{};
+
+  render_mode mode{render_mode::realtime};
 };
 
+// The maximum channels of a setup: the ones of the host, else the ones of the processor
 template <typename T>
-void prepare(avnd::effect_container<T>& implementation, process_setup setup)
+process_setup with_max_channels(process_setup setup) noexcept
 {
+  setup.max_input_channels = std::max(
+      {setup.input_channels, setup.max_input_channels, avnd::max_input_channels<T>()});
+  setup.max_output_channels = std::max(
+      {setup.output_channels, setup.max_output_channels, avnd::max_output_channels<T>()});
+  return setup;
+}
+
+// What changed from a setup to the next one
+inline setup_change changes_between(const process_setup& prev, const process_setup& next) noexcept
+{
+  if (prev.rate <= 0.)
+    return {};
+
+  return {
+      .rate = prev.rate != next.rate,
+      .frames = prev.frames_per_buffer != next.frames_per_buffer,
+      .channels = prev.input_channels != next.input_channels
+                  || prev.output_channels != next.output_channels
+                  || prev.max_input_channels != next.max_input_channels
+                  || prev.max_output_channels != next.max_output_channels,
+      .mode = prev.mode != next.mode};
+}
+
+template <typename T>
+void prepare(
+    avnd::effect_container<T>& implementation, process_setup setup,
+    setup_change changed = {})
+{
+  set_render_mode(implementation, setup.mode);
+
   if constexpr (avnd::can_prepare<T>)
   {
     using prepare_type = avnd::first_argument<&T::prepare>;
@@ -30,18 +74,29 @@ void prepare(avnd::effect_container<T>& implementation, process_setup setup)
     if_possible(t.input_channels = setup.input_channels);
     if_possible(t.output_channels = setup.output_channels);
     if_possible(t.channels = setup.output_channels);
+    if_possible(t.max_channels = std::max(setup.max_input_channels, setup.max_output_channels));
     if_possible(t.frames = setup.frames_per_buffer);
     if_possible(t.rate = setup.rate);
+    if_possible(t.offline = setup.mode == render_mode::offline);
+    if_possible(t.realtime = setup.mode == render_mode::realtime);
+    if_possible(t.changed = changed);
+
+    // The buffers are queued to always have this size, see fixed_block_adapter
+    if constexpr (avnd::fixed_block_size<T>() > 0)
+      if_possible(t.frames = avnd::fixed_block_size<T>());
 
-    // Coroutines get used here.
+    // Prepare every instance in the case of duplicated monophonic processors
     for (auto& eff : implementation.effects())
       eff.prepare(t);
   }
 }
 
 template <typename T>
-void prepare(T& implementation, process_setup setup)
+void prepare(T& implementation, process_setup setup, setup_change changed = {})
 {
+  if constexpr (has_render_mode<T>)
+    implementation.render_mode = setup.mode;
+
   if constexpr (avnd::can_prepare<T>)
   {
     using prepare_type = avnd::first_argument<&T::prepare>;
@@ -53,11 +108,29 @@ void prepare(T& implementation, process_setup setup)
     if_possible(t.input_channels = setup.input_channels);
     if_possible(t.output_channels = setup.output_channels);
     if_possible(t.channels = setup.output_channels);
+    if_possible(t.max_channels = std::max(setup.max_input_channels, setup.max_output_channels));
     if_possible(t.frames = setup.frames_per_buffer);
     if_possible(t.rate = setup.rate);
+    if_possible(t.offline = setup.mode == render_mode::offline);
+    if_possible(t.realtime = setup.mode == render_mode::realtime);
+    if_possible(t.changed = changed);
 
     implementation.prepare(t);
   }
 }
 
+/**
+ * Prepares the processor for a new setup of the host, telling it what changed
+ * since the current one, which it then replaces.
+ * Returns what changed, e.g. to skip reallocating the buffers of the binding.
+ */
+template <typename T>
+setup_change
+reconfigure(avnd::effect_container<T>& implementation, process_setup& current, process_setup next)
+{
+  const auto changed = changes_between(current, next);
+  current = next;
+  prepare(implementation, next, changed);
+  return changed;
+}
 }
@@ -6,10 +6,12 @@
 #include <avnd/common/function_reflection.hpp>
 #include <avnd/common/span_polyfill.hpp>
 #include <avnd/introspection/channels.hpp>
+#include <avnd/wrappers/audio_buffers.hpp>
 #include <avnd/wrappers/prepare.hpp>
 #include <avnd/wrappers/process_execution.hpp>
 #include <boost/pfr.hpp>
 
+#include <algorithm>
 #include <concepts>
 #include <cstdint>
 #include <cstdlib>
@@ -24,8 +26,8 @@ namespace avnd
 template <typename Fp>
 struct zero_storage
 {
-  std::vector<Fp> zeros_in, zeros_out;
-  std::vector<Fp*> zero_pointers_in, zero_pointers_out;
+  avnd::span<Fp> zeros_in, zeros_out;
+  avnd::span<Fp*> zero_pointers_in, zero_pointers_out;
 };
 
 /**
@@ -58,6 +60,11 @@ struct process_adapter
 template <typename T>
 struct audio_buffer_storage
 {
+  // All the buffers below point into this single aligned allocation
+  audio_buffer_arena m_arena;
+  process_setup m_allocated_setup{};
+  int m_host_types{}; // 1: float, 2: double
+
   // buffers used in case we need to convert float -> double
   [[no_unique_address]] buffer_type<double, T> m_dsp_buffer_input_f;
   [[no_unique_address]] buffer_type<double, T> m_dsp_buffer_output_f;
@@ -73,45 +80,112 @@ struct audio_buffer_storage
   auto& zero_storage_for(float) { return m_zero_storage_f; }
   auto& zero_storage_for(double) { return m_zero_storage_d; }
 
+  // The sample types the processor works with, for which it may need silent channels
+  static constexpr bool uses_float
+      = avnd::float_processor<T> || !avnd::double_processor<T>;
+  static constexpr bool uses_double
+      = avnd::double_processor<T> || !avnd::float_processor<T>;
+
   template <std::floating_point SrcFP>
   void allocate_buffers(process_setup setup, SrcFP f)
   {
-    // If our effect is written with doubles, and we're in a host
-    // which requires floats, we allocate buffers to store the converted data
-    if constexpr (needs_storage<SrcFP, T>::value)
-    {
-      using needed_type = typename needs_storage<SrcFP, T>::needed_storage_t;
-      input_buffer_for(needed_type{})
-          .resize(setup.frames_per_buffer * setup.input_channels);
-      output_buffer_for(needed_type{})
-          .resize(setup.frames_per_buffer * setup.output_channels);
-    }
+    // Conversion buffers are only allocated for the sample types the host asked for:
+    // the layout covers all of them, thus a host which calls this for both types
+    // allocates twice at most, and later calls with the same setup do nothing.
+    // The buffers are laid out for the maximum channels of the setup: later calls
+    // with as many channels or less reuse them as they are.
+    const int host_types = m_host_types | (std::is_same_v<SrcFP, float> ? 1 : 2);
+    const int max_inputs = std::max(setup.input_channels, setup.max_input_channels);
+    const int max_outputs = std::max(setup.output_channels, setup.max_output_channels);
+    if (m_arena.data() && host_types == m_host_types
+        && setup.frames_per_buffer == m_allocated_setup.frames_per_buffer
+        && max_inputs <= m_allocated_setup.max_input_channels
+        && max_outputs <= m_allocated_setup.max_output_channels)
+      return;
+    m_allocated_setup = setup;
+    m_allocated_setup.max_input_channels = max_inputs;
+    m_allocated_setup.max_output_channels = max_outputs;
+    m_host_types = host_types;
+
+    const std::size_t frames = std::max(setup.frames_per_buffer, 0);
+    const std::size_t inputs = std::max(max_inputs, 0);
+    const std::size_t outputs = std::max(max_outputs, 0);
 
     // Let's play it safe for the cases where the host does not supply
     // enough buffers
-    auto& floats = zero_storage_for(float{});
-    auto& doubles = zero_storage_for(double{});
-    floats.zeros_in.resize(setup.frames_per_buffer);
-    floats.zeros_out.resize(setup.frames_per_buffer);
-    doubles.zeros_in.resize(setup.frames_per_buffer);
-    doubles.zeros_out.resize(setup.frames_per_buffer);
-
-    int max_channels_in = (16 + setup.input_channels) * 16;
-    int max_channels_out = (16 + setup.output_channels) * 16;
-    floats.zero_pointers_in.resize(max_channels_in);
-    floats.zero_pointers_out.resize(max_channels_out);
-    doubles.zero_pointers_in.resize(max_channels_in);
-    doubles.zero_pointers_out.resize(max_channels_out);
-    for (int i = 0; i < max_channels_in; i++)
+    const std::size_t max_channels_in = (16 + inputs) * 16;
+    const std::size_t max_channels_out = (16 + outputs) * 16;
+
+    // First compute where each buffer goes, then allocate everything at once
+    audio_buffer_layout layout;
+    std::size_t conv_in{}, conv_out{}, conv_stride{};
+
+    // If our effect is written with doubles, and we're in a host
+    // which requires floats, we allocate buffers to store the converted data
+    auto layout_conversion = [&]<typename HostFP>(HostFP, int type) {
+      if constexpr (needs_storage<HostFP, T>::value)
+      {
+        if (!(m_host_types & type))
+          return;
+        using needed_type = typename needs_storage<HostFP, T>::needed_storage_t;
+        conv_stride = channel_buffers<needed_type>::stride_for(frames);
+        conv_in = layout.push<needed_type>(conv_stride * inputs);
+        conv_out = layout.push<needed_type>(conv_stride * outputs);
+      }
+    };
+    layout_conversion(float{}, 1);
+    layout_conversion(double{}, 2);
+
+    std::size_t zf_in{}, zf_out{}, zpf_in{}, zpf_out{};
+    std::size_t zd_in{}, zd_out{}, zpd_in{}, zpd_out{};
+    if constexpr (uses_float)
     {
-      floats.zero_pointers_in[i] = floats.zeros_in.data();
-      doubles.zero_pointers_in[i] = doubles.zeros_in.data();
+      zf_in = layout.push<float>(frames);
+      zf_out = layout.push<float>(frames);
+      zpf_in = layout.push<float*>(max_channels_in);
+      zpf_out = layout.push<float*>(max_channels_out);
     }
-    for (int i = 0; i < max_channels_out; i++)
+    if constexpr (uses_double)
     {
-      floats.zero_pointers_out[i] = floats.zeros_out.data();
-      doubles.zero_pointers_out[i] = doubles.zeros_out.data();
+      zd_in = layout.push<double>(frames);
+      zd_out = layout.push<double>(frames);
+      zpd_in = layout.push<double*>(max_channels_in);
+      zpd_out = layout.push<double*>(max_channels_out);
     }
+
+    std::byte* base = m_arena.reserve(layout.bytes);
+    std::fill_n(base, layout.bytes, std::byte{});
+
+    auto assign_conversion = [&]<typename HostFP>(HostFP, int type) {
+      if constexpr (needs_storage<HostFP, T>::value)
+      {
+        if (!(m_host_types & type))
+          return;
+        using needed_type = typename needs_storage<HostFP, T>::needed_storage_t;
+        input_buffer_for(needed_type{})
+            = {reinterpret_cast<needed_type*>(base + conv_in), conv_stride};
+        output_buffer_for(needed_type{})
+            = {reinterpret_cast<needed_type*>(base + conv_out), conv_stride};
+      }
+    };
+    assign_conversion(float{}, 1);
+    assign_conversion(double{}, 2);
+
+    auto assign_zeros = [&]<typename FP>(
+                            zero_storage<FP>& z, std::size_t in, std::size_t out,
+                            std::size_t p_in, std::size_t p_out) {
+      z.zeros_in = {reinterpret_cast<FP*>(base + in), frames};
+      z.zeros_out = {reinterpret_cast<FP*>(base + out), frames};
+      z.zero_pointers_in = {reinterpret_cast<FP**>(base + p_in), max_channels_in};
+      z.zero_pointers_out = {reinterpret_cast<FP**>(base + p_out), max_channels_out};
+      std::fill(z.zero_pointers_in.begin(), z.zero_pointers_in.end(), z.zeros_in.data());
+      std::fill(
+          z.zero_pointers_out.begin(), z.zero_pointers_out.end(), z.zeros_out.data());
+    };
+    if constexpr (uses_float)
+      assign_zeros(zero_storage_for(float{}), zf_in, zf_out, zpf_in, zpf_out);
+    if constexpr (uses_double)
+      assign_zeros(zero_storage_for(double{}), zd_in, zd_out, zpd_in, zpd_out);
   }
 };
 }
@@ -0,0 +1,146 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/wrappers/process/base.hpp>
+
+namespace avnd
+{
+/**
+ * Processors with a fixed-point bus, e.g. of halp::q15.
+ * A host which has the same format, e.g. a codec driver on a micro-controller,
+ * calls process() with its buffers, which are given as they are to the processor;
+ * float and double hosts go through conversion buffers, see avnd::convert_samples.
+ */
+template <typename T>
+requires fixed_point_processor<T>
+struct process_adapter<T>
+{
+  using sample_type = fixed_point_sample_type<T>;
+  static constexpr bool has_input_bus = fixed_point_bus_input_count<T> > 0;
+
+  audio_buffer_arena m_arena;
+  channel_buffers<sample_type> m_input, m_output;
+  avnd::span<sample_type*> m_input_pointers, m_output_pointers;
+  int m_frames{};
+
+  static auto& input_bus(avnd::effect_container<T>& implementation)
+  {
+    return boost::pfr::get<fixed_point_input_bus_index<T>>(implementation.inputs());
+  }
+  static auto& output_bus(avnd::effect_container<T>& implementation)
+  {
+    return boost::pfr::get<fixed_point_output_bus_index<T>>(implementation.outputs());
+  }
+
+  // The buffers are also used by a native host which sends less channels than a bus
+  // with a fixed count has: the missing ones are silent
+  template <typename SrcFP>
+  requires std::floating_point<SrcFP> || std::same_as<SrcFP, sample_type>
+  void allocate_buffers(process_setup setup, SrcFP)
+  {
+    const std::size_t frames = std::max(setup.frames_per_buffer, 0);
+    const std::size_t inputs
+        = std::max({setup.input_channels, setup.max_input_channels, 0});
+    const std::size_t outputs
+        = std::max({setup.output_channels, setup.max_output_channels, 0});
+    if (m_arena.data() && int(frames) == m_frames && inputs <= m_input_pointers.size()
+        && outputs <= m_output_pointers.size())
+      return;
+
+    audio_buffer_layout layout;
+    const std::size_t stride = channel_buffers<sample_type>::stride_for(frames);
+    const std::size_t in = layout.push<sample_type>(stride * inputs);
+    const std::size_t out = layout.push<sample_type>(stride * outputs);
+    const std::size_t p_in = layout.push<sample_type*>(inputs);
+    const std::size_t p_out = layout.push<sample_type*>(outputs);
+
+    std::byte* base = m_arena.reserve(layout.bytes);
+    std::fill_n(base, layout.bytes, std::byte{});
+
+    m_input = {reinterpret_cast<sample_type*>(base + in), stride};
+    m_output = {reinterpret_cast<sample_type*>(base + out), stride};
+    m_input_pointers = {reinterpret_cast<sample_type**>(base + p_in), inputs};
+    m_output_pointers = {reinterpret_cast<sample_type**>(base + p_out), outputs};
+    for (std::size_t c = 0; c < inputs; c++)
+      m_input_pointers[c] = m_input.channel(c);
+    for (std::size_t c = 0; c < outputs; c++)
+      m_output_pointers[c] = m_output.channel(c);
+    m_frames = frames;
+  }
+
+  // Dynamic busses get the channels of the host, in the limits of the buffers
+  template <typename Bus>
+  static int bus_channels(Bus& bus, int host_channels, int allocated)
+  {
+    if constexpr (requires { Bus::channels(); })
+      return std::min(int(Bus::channels()), allocated);
+    else
+      return bus.channels = std::min(host_channels, allocated);
+  }
+
+  template <typename FP>
+  requires std::floating_point<FP> || std::same_as<FP, sample_type>
+  void process(
+      avnd::effect_container<T>& implementation,
+      avnd::span<FP*> in,
+      avnd::span<FP*> out,
+      int32_t n)
+  {
+    static constexpr bool native = std::is_same_v<FP, sample_type>;
+    const int input_channels = in.size();
+    const int output_channels = out.size();
+
+    if constexpr (has_input_bus)
+    {
+      auto& bus = input_bus(implementation);
+      using bus_samples = decltype(bus.samples);
+      const int channels
+          = bus_channels(bus, input_channels, m_input_pointers.size());
+      bool passed = false;
+      if constexpr (native)
+      {
+        if ((passed = channels <= input_channels))
+          bus.samples = const_cast<bus_samples>(in.data());
+      }
+      if (!passed)
+      {
+        for (int c = 0; c < channels; c++)
+        {
+          if (c < input_channels)
+            avnd::convert_samples(in[c], m_input_pointers[c], n);
+          else
+            std::fill_n(m_input_pointers[c], n, sample_type{});
+        }
+        bus.samples = const_cast<bus_samples>(m_input_pointers.data());
+      }
+    }
+
+    auto& bus = output_bus(implementation);
+    const int channels = bus_channels(bus, output_channels, m_output_pointers.size());
+    bool native_out = false;
+    if constexpr (native)
+    {
+      if ((native_out = channels <= output_channels))
+        bus.samples = out.data();
+    }
+    if (!native_out)
+      bus.samples = m_output_pointers.data();
+
+    invoke_effect(implementation, n);
+
+    if (!native_out)
+    {
+      for (int c = 0; c < std::min(channels, output_channels); c++)
+        avnd::convert_samples(m_output_pointers[c], out[c], n);
+    }
+    // Host channels which the bus does not have are silent
+    for (int c = channels; c < output_channels; c++)
+      std::fill_n(out[c], n, FP{});
+
+    if constexpr (has_input_bus)
+      input_bus(implementation).samples = nullptr;
+    bus.samples = nullptr;
+  }
+};
+}
@@ -44,16 +44,18 @@ requires(
     const int channels = input_channels;
 
     // Write the output channels
-    // C++20: we're using our coroutine here !
+    // Iterate over the (possibly duplicated) instances: this does not allocate
     auto effects_range = implementation.full_state();
     auto effects_it = effects_range.begin();
     for (int c = 0; c < channels && effects_it != effects_range.end(); ++c, ++effects_it)
     {
-      auto& [impl, ins, outs] = *effects_it;
+      auto&& [impl, ins, outs] = *effects_it;
 
       if constexpr (requires { sizeof(current_tick(implementation)); })
       {
-        process_channel(in[c], out[c], impl, ins, outs, current_tick(implementation));
+        auto t = current_tick(implementation);
+        if_possible(t.frames = n);
+        process_channel(in[c], out[c], impl, ins, outs, t);
       }
       else
       {
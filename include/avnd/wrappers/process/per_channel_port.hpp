@@ -60,7 +60,7 @@ requires(
         {
           if (k + 1 <= buffers.size())
           {
-            std::copy_n(bus.channel, n, buffers[k]);
+            avnd::convert_samples(bus.channel, buffers[k], n);
           }
           k++;
         });
@@ -94,8 +94,8 @@ requires(
         auto i_conv = (DstFP**)alloca(sizeof(DstFP*) * input_channels);
         for (int c = 0; c < input_channels; ++c)
         {
-          i_conv[c] = dsp_buffer_input.data() + c * n;
-          std::copy_n(in[c], n, i_conv[c]);
+          i_conv[c] = dsp_buffer_input.channel(c);
+          avnd::convert_samples(in[c], i_conv[c], n);
         }
 
         initialize_busses<i_info, true>(
@@ -111,7 +111,7 @@ requires(
         auto o_conv = (DstFP**)alloca(sizeof(DstFP*) * output_channels);
         for (int c = 0; c < output_channels; ++c)
         {
-          o_conv[c] = dsp_buffer_output.data() + c * n;
+          o_conv[c] = dsp_buffer_output.channel(c);
         }
 
         initialize_busses<o_info, false>(
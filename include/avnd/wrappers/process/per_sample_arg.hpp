@@ -3,6 +3,10 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <avnd/wrappers/process/base.hpp>
+#include <avnd/wrappers/thread_pool.hpp>
+
+#include <algorithm>
+#include <utility>
 
 namespace avnd
 {
@@ -16,94 +20,196 @@ requires(
         double,
         T> || avnd::mono_per_sample_arg_processor<float, T>) struct process_adapter<T>
 {
+  // Set a pool to process the channels on multiple threads
+  channel_parallelism parallelism;
+
   void allocate_buffers(process_setup setup, auto&& f)
   {
     // No buffer to allocates here
   }
 
+  // The processor as a function of one sample: the signature is picked once,
+  // outside of the loops, which then only contain the call to the processor.
   template <typename FP>
-  FP process_sample(FP in, T& fx, auto& ins, auto& outs, auto&& tick)
+  static auto sample_function(T& fx, auto& ins, auto& outs, auto&... tick) noexcept
   {
-    if constexpr (requires { fx(in, ins, outs, tick); })
-      return fx(in, ins, outs, tick);
-    else if constexpr (requires { fx(in, ins, tick); })
-      return fx(in, ins, tick);
-    else if constexpr (requires { fx(in, outs, tick); })
-      return fx(in, outs, tick);
-    else if constexpr (requires { fx(in, tick); })
-      return fx(in, tick);
-    else if constexpr (requires { fx(tick); })
-      return fx(tick);
+    if constexpr (requires { fx(FP{}, ins, outs, tick...); })
+      return [&](FP in) -> FP { return fx(in, ins, outs, tick...); };
+    else if constexpr (requires { fx(FP{}, ins, tick...); })
+      return [&](FP in) -> FP { return fx(in, ins, tick...); };
+    else if constexpr (requires { fx(FP{}, outs, tick...); })
+      return [&](FP in) -> FP { return fx(in, outs, tick...); };
+    else if constexpr (requires { fx(FP{}, tick...); })
+      return [&](FP in) -> FP { return fx(in, tick...); };
+    else if constexpr (requires { fx(tick...); })
+      return [&](FP) -> FP { return fx(tick...); };
     else
-      static_assert(std::is_void_v<FP>, "Canno call processor");
+      static_assert(std::is_void_v<FP>, "Cannot call processor");
   }
 
-  template <typename FP>
-  FP process_sample(FP in, T& fx, auto& ins, auto& outs)
+  // The tick is the same for all the samples of a buffer: it is built once
+  static void with_tick(avnd::effect_container<T>& implementation, auto&& f)
   {
-    if constexpr (requires { fx(in, ins, outs); })
-      return fx(in, ins, outs);
-    else if constexpr (requires { fx(in, ins); })
-      return fx(in, ins);
-    else if constexpr (requires { fx(in, outs); })
-      return fx(in, outs);
-    else if constexpr (requires { fx(in); })
-      return fx(in);
-    else if constexpr (requires { fx(); })
-      return fx(in);
+    if constexpr (requires { sizeof(current_tick(implementation)); })
+    {
+      auto tick = current_tick(implementation);
+      f(tick);
+    }
     else
-      static_assert(std::is_void_v<FP>, "Canno call processor");
+    {
+      f();
+    }
+  }
+
+  template <typename FP>
+  static void process_block(const FP* __restrict src, FP* __restrict dst, int32_t n, auto f)
+  {
+    for (int32_t i = 0; i < n; i++)
+      dst[i] = f(src[i]);
+  }
+
+  template <typename FP>
+  static void process_block(FP* __restrict io, int32_t n, auto f)
+  {
+    for (int32_t i = 0; i < n; i++)
+      io[i] = f(io[i]);
   }
 
+  // Some hosts like puredata use the same buffers for input and output,
+  // and out[0] may be in[1]: the inputs of each block of samples are copied
+  // before writing any output. Channels > 0 unrolls the loops over the channels.
+  static constexpr int32_t crossed_block = 64;
+
+  template <std::size_t Channels, std::floating_point FP>
+  void process_crossed(
+      avnd::span<FP*> in, avnd::span<FP*> out, auto effects_range, int32_t n,
+      auto&... tick)
+  {
+    const int channels = Channels > 0 ? int(Channels) : int(in.size());
+    FP* scratch = (FP*)alloca(channels * crossed_block * sizeof(FP));
+
+    for (int32_t first = 0; first < n; first += crossed_block)
+    {
+      const int32_t frames = std::min(crossed_block, n - first);
+      auto copy = [&](int c) {
+        std::copy_n(in[c] + first, frames, scratch + c * crossed_block);
+      };
+      auto write = [&](int c, auto&& ref) {
+        auto&& [impl, ins, outs] = ref;
+        process_block(
+            scratch + c * crossed_block, out[c] + first, frames,
+            sample_function<FP>(impl, ins, outs, tick...));
+      };
+
+      if constexpr (Channels > 0)
+      {
+        [&]<std::size_t... C>(std::index_sequence<C...>) {
+          (copy(C), ...);
+          auto it = effects_range.begin();
+          ((write(C, *it), ++it), ...);
+        }(std::make_index_sequence<Channels>{});
+      }
+      else
+      {
+        for (int c = 0; c < channels; c++)
+          copy(c);
+        auto it = effects_range.begin();
+        for (int c = 0; c < channels && it != effects_range.end(); ++c, ++it)
+          write(c, *it);
+      }
+    }
+  }
+
+  // Processes the channels of in / out with the matching instances of effects_range
   template <std::floating_point FP>
-  void process(
+  void process_channels(
       avnd::effect_container<T>& implementation,
       avnd::span<FP*> in,
       avnd::span<FP*> out,
+      auto effects_range,
       int32_t n)
   {
-    const int input_channels = in.size();
-    const int output_channels = out.size();
-    assert(input_channels == output_channels);
-    const int channels = input_channels;
-
-    auto input_buf = (FP*)alloca(channels * sizeof(FP));
+    const int channels = in.size();
 
-    for (int32_t i = 0; i < n; i++)
-    {
-      // Some hosts like puredata uses the same buffers for input and output.
-      // Thus, we have to :
-      //  1/ fetch all inputs
-      //  2/ apply fx
-      //  3/ store all outputs
-      // otherwise writing out[0] may overwrite in[1]
-      // before we could read it for instance
-
-      // Copy the input channels
-      for (int c = 0; c < channels; c++)
+    with_tick(implementation, [&](auto&... tick) {
+      if (channel_parallelism::crossed_buffers(in.data(), out.data(), channels))
       {
-        input_buf[c] = in[c][i];
+        if (channels == 2 && effects_range.size() >= 2)
+          process_crossed<2>(in, out, effects_range, n, tick...);
+        else
+          process_crossed<0>(in, out, effects_range, n, tick...);
+        return;
       }
 
-      // Write the output channels
-      // C++20: we're using our coroutine here !
-      auto effects_range = implementation.full_state();
+      // Each channel only reads its own input, which may be its output:
+      // the channels can be processed one after the other without copy.
       auto effects_it = effects_range.begin();
       for (int c = 0; c < channels && effects_it != effects_range.end();
            ++c, ++effects_it)
       {
-        auto& [impl, ins, outs] = *effects_it;
-
-        if constexpr (requires { sizeof(current_tick(implementation)); })
-        {
-          out[c][i] = process_sample(
-              input_buf[c], impl, ins, outs, current_tick(implementation));
-        }
+        auto&& [impl, ins, outs] = *effects_it;
+        auto f = sample_function<FP>(impl, ins, outs, tick...);
+        if (in[c] == out[c])
+          process_block(out[c], n, f);
         else
-        {
-          out[c][i] = process_sample(input_buf[c], impl, ins, outs);
-        }
+          process_block((const FP*)in[c], out[c], n, f);
+      }
+    });
+  }
+
+  // Interleaved buffers of the host, see interleaved_process_adapter.
+  // Each sample is only read by its own channel before being written: in may be out.
+  template <std::floating_point FP>
+  void process_interleaved(
+      avnd::effect_container<T>& implementation,
+      interleaved_buffer<const FP> in,
+      interleaved_buffer<FP> out,
+      int32_t n)
+  {
+    const int channels = std::min(in.channels, out.channels);
+    with_tick(implementation, [&](auto&... tick) {
+      auto effects_it = implementation.full_state().begin();
+      for (int c = 0; c < channels; ++c, ++effects_it)
+      {
+        auto&& [impl, ins, outs] = *effects_it;
+        auto f = sample_function<FP>(impl, ins, outs, tick...);
+        for (int32_t i = 0; i < n; i++)
+          out(c, i) = f(in(c, i));
       }
+    });
+  }
+
+  template <std::floating_point FP>
+  void process(
+      avnd::effect_container<T>& implementation,
+      avnd::span<FP*> in,
+      avnd::span<FP*> out,
+      int32_t n)
+  {
+    const int input_channels = in.size();
+    const int output_channels = out.size();
+    assert(input_channels == output_channels);
+    const int channels = input_channels;
+
+    // Each task processes its own channels with their own instances:
+    // only possible if no output overwrites the input of another channel.
+    const int tasks = parallelism.tasks_for(channels, n);
+    if (tasks > 1
+        && !channel_parallelism::crossed_buffers(in.data(), out.data(), channels))
+    {
+      parallelism.pool->run(tasks, [&](int task) {
+        const auto [first, last] = channel_parallelism::channels_of(task, tasks, channels);
+        process_channels(
+            implementation,
+            in.subspan(first, last - first),
+            out.subspan(first, last - first),
+            implementation.full_state().subrange(first, last),
+            n);
+      });
+    }
+    else
+    {
+      process_channels(implementation, in, out, implementation.full_state(), n);
     }
   }
 };
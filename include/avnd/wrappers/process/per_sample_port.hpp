@@ -3,6 +3,9 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <avnd/wrappers/process/base.hpp>
+#include <avnd/wrappers/thread_pool.hpp>
+
+#include <memory>
 
 namespace avnd
 {
@@ -16,6 +19,10 @@ requires(
         double,
         T> || avnd::mono_per_sample_port_processor<float, T>) struct process_adapter<T>
 {
+  // Set a pool to process the channels on multiple threads.
+  // Not used when the instances share their inputs, since the samples are written in them.
+  channel_parallelism parallelism;
+
   void allocate_buffers(process_setup setup, auto&& f)
   {
     // No buffer to allocates here
@@ -23,7 +30,7 @@ requires(
 
   // Here we know that we at least have one in and one out
   template <typename FP>
-  FP process_0(avnd::effect_container<T>& implementation, FP in, auto& ref, auto&& tick)
+  FP process_0(avnd::effect_container<T>& implementation, FP in, auto&& ref, auto&& tick)
   {
     auto& [fx, ins, outs] = ref;
     // Copy the input
@@ -46,7 +53,7 @@ requires(
   }
 
   template <typename FP>
-  FP process_0(avnd::effect_container<T>& implementation, FP in, auto& ref)
+  FP process_0(avnd::effect_container<T>& implementation, FP in, auto&& ref)
   {
     auto& [fx, ins, outs] = ref;
     // Copy the input
@@ -63,21 +70,146 @@ requires(
     return out;
   }
 
+  // Type of the "sample" member of the ports
+  using sample_type = std::conditional_t<
+      avnd::mono_per_sample_port_processor<double, T>,
+      double,
+      float>;
+
+  // Widest batch the processor can optionally be invoked with
+  static constexpr std::size_t batch_width() noexcept
+  {
+    if constexpr (mono_per_sample_port_batch_invocations<sample_type, T, 16>)
+      return 16;
+    else if constexpr (mono_per_sample_port_batch_invocations<sample_type, T, 8>)
+      return 8;
+    else if constexpr (mono_per_sample_port_batch_invocations<sample_type, T, 4>)
+      return 4;
+    else if constexpr (mono_per_sample_port_batch_invocations<sample_type, T, 2>)
+      return 2;
+    else
+      return 1;
+  }
+
+  template <std::size_t N>
+  void process_batch(
+      T& fx,
+      auto& ins,
+      auto& outs,
+      avnd::span<const sample_type, N> in,
+      avnd::span<sample_type, N> out)
+  {
+    if constexpr (requires { fx(ins, outs, in, out); })
+      fx(ins, outs, in, out);
+    else
+      fx(ins, in, out);
+  }
+
+  // Processes the largest multiple of batch_width() samples of the buffers
+  // and returns the index of the first unprocessed sample.
   template <std::floating_point FP>
-  void process(
+  int32_t process_batches(
       avnd::effect_container<T>& implementation,
       avnd::span<FP*> in,
       avnd::span<FP*> out,
+      auto effects_range,
       int32_t n)
   {
-    const int input_channels = in.size();
-    const int output_channels = out.size();
-    assert(input_channels == output_channels);
-    const int channels = input_channels;
+    static constexpr std::size_t W = batch_width();
+    const int channels = in.size();
+
+    // Same in-place issue than in process_samples: we fetch a batch of all the inputs first,
+    // unless each channel only reads its own input.
+    const bool crossed = channel_parallelism::crossed_buffers(in.data(), out.data(), channels);
+    auto input_buf = (sample_type*)alloca(channels * W * sizeof(sample_type));
+    alignas(W * sizeof(sample_type)) sample_type output_buf[W];
+
+    int32_t i = 0;
+    for (; i + int32_t(W) <= n; i += W)
+    {
+      if (crossed)
+      {
+        for (int c = 0; c < channels; c++)
+        {
+          std::copy_n(in[c] + i, W, input_buf + c * W);
+        }
+      }
+
+      auto effects_it = effects_range.begin();
+      for (int c = 0; c < channels && effects_it != effects_range.end();
+           ++c, ++effects_it)
+      {
+        auto&& [fx, ins, outs] = *effects_it;
+
+        // A batch processed in place may overwrite its input before having read it,
+        // unless the processor tells otherwise
+        const sample_type* src = input_buf + c * W;
+        if (!crossed)
+        {
+          if constexpr (std::is_same_v<FP, sample_type>)
+          {
+            if (in_place_safe_processor<T> || in[c] != out[c])
+              src = in[c] + i;
+            else
+              std::copy_n(in[c] + i, W, input_buf + c * W);
+          }
+          else
+          {
+            std::copy_n(in[c] + i, W, input_buf + c * W);
+          }
+        }
+        const auto batch_in = avnd::span<const sample_type, W>(src, W);
+
+        if constexpr (std::is_same_v<FP, sample_type>)
+        {
+          process_batch<W>(fx, ins, outs, batch_in, avnd::span<sample_type, W>(out[c] + i, W));
+        }
+        else
+        {
+          process_batch<W>(fx, ins, outs, batch_in, avnd::span<sample_type, W>(output_buf, W));
+          std::copy_n(output_buf, W, out[c] + i);
+        }
+      }
+    }
+    return i;
+  }
+
+  template <std::floating_point FP>
+  void process_samples(
+      avnd::effect_container<T>& implementation,
+      avnd::span<FP*> in,
+      avnd::span<FP*> out,
+      auto effects_range,
+      int32_t first,
+      int32_t n)
+  {
+    const int channels = in.size();
+
+    if (!channel_parallelism::crossed_buffers(in.data(), out.data(), channels))
+    {
+      // See the per_sample_arg adapter: the channels are processed one after the other
+      auto effects_it = effects_range.begin();
+      for (int c = 0; c < channels && effects_it != effects_range.end();
+           ++c, ++effects_it)
+      {
+        auto&& ref = *effects_it;
+        const FP* src = in[c];
+        FP* dst = out[c];
+
+        for (int32_t i = first; i < n; i++)
+        {
+          if constexpr (requires { sizeof(current_tick(implementation)); })
+            dst[i] = process_0(implementation, src[i], ref, current_tick(implementation));
+          else
+            dst[i] = process_0(implementation, src[i], ref);
+        }
+      }
+      return;
+    }
 
     auto input_buf = (FP*)alloca(channels * sizeof(FP));
 
-    for (int32_t i = 0; i < n; i++)
+    for (int32_t i = first; i < n; i++)
     {
       // Some hosts like puredata uses the same buffers for input and output.
       // Thus, we have to :
@@ -94,8 +226,7 @@ requires(
       }
 
       // Write the output channels
-      // C++20: we're using our coroutine here !
-      auto effects_range = implementation.full_state();
+      // Iterate over the (possibly duplicated) instances: this does not allocate
       auto effects_it = effects_range.begin();
       for (int c = 0; c < channels && effects_it != effects_range.end();
            ++c, ++effects_it)
@@ -112,6 +243,237 @@ requires(
       }
     }
   }
+
+  // Widest group of channels the processor can optionally be invoked with
+  static constexpr std::size_t lane_width() noexcept
+  {
+    if constexpr (mono_per_sample_port_lane_invocations<sample_type, T, 16>)
+      return 16;
+    else if constexpr (mono_per_sample_port_lane_invocations<sample_type, T, 8>)
+      return 8;
+    else if constexpr (mono_per_sample_port_lane_invocations<sample_type, T, 4>)
+      return 4;
+    else if constexpr (mono_per_sample_port_lane_invocations<sample_type, T, 2>)
+      return 2;
+    else
+      return 1;
+  }
+
+  // The channels are taken by groups of lane_width(), each of which goes through the
+  // lane-wise operator() one sample at a time: the states of the group are loaded once
+  // for the whole buffer. Returns the first channel which is left for process_simd_state.
+  template <std::floating_point FP>
+  int process_lanes(
+      avnd::effect_container<T>& implementation,
+      avnd::span<FP*> in,
+      avnd::span<FP*> out,
+      int32_t n)
+  {
+    static constexpr std::size_t W = lane_width();
+    using state_type = typename T::simd_state;
+
+    auto& state = implementation.simd_state;
+    const int channels = std::min(int(in.size()), int(state.size()));
+    const int grouped = channels - channels % int(W);
+
+    alignas(W * sizeof(sample_type)) sample_type x[W];
+    alignas(W * sizeof(sample_type)) sample_type y[W];
+    state_type s[W];
+
+    for (int first = 0; first < grouped; first += W)
+    {
+      auto&& [fx, ins, outs] = *implementation.full_state().subrange(first, first + W).begin();
+
+      for (std::size_t k = 0; k < W; k++)
+        s[k] = state.load(first + k);
+
+      FP* const* src = in.data() + first;
+      FP* const* dst = out.data() + first;
+      for (int32_t i = 0; i < n; i++)
+      {
+        for (std::size_t k = 0; k < W; k++)
+          x[k] = src[k][i];
+
+        fx(ins, avnd::span<const sample_type, W>(x, W), avnd::span<sample_type, W>(y, W),
+           avnd::span<state_type, W>(s, W));
+
+        for (std::size_t k = 0; k < W; k++)
+          dst[k][i] = y[k];
+      }
+
+      for (std::size_t k = 0; k < W; k++)
+        state.store(first + k, s[k]);
+    }
+    return grouped;
+  }
+
+  // The channels which are not in a group of lanes: the state of each is loaded once
+  // from the structure-of-arrays storage of the container, stays in a local for the whole
+  // buffer, and is stored back at the end, rather than around each call.
+  template <std::floating_point FP>
+  void process_simd_state(
+      avnd::effect_container<T>& implementation,
+      avnd::span<FP*> in,
+      avnd::span<FP*> out,
+      int first_channel,
+      int32_t n)
+  {
+    using state_type = typename T::simd_state;
+    auto& state = implementation.simd_state;
+    const int channels = std::min(int(in.size()), int(state.size()));
+    if (first_channel >= channels)
+      return;
+
+    auto process_one = [&out](
+                           auto& fx, auto& ins, auto& outs, state_type& s, FP sample, int c,
+                           int32_t i) {
+      boost::pfr::for_each_field(ins, [sample]<typename Field>(Field& field) {
+        if_possible(field.sample = sample);
+      });
+
+      fx(ins, outs, s);
+
+      boost::pfr::for_each_field(
+          outs, [&out, c, i]<typename Field>(Field& field) {
+            if_possible(out[c][i] = field.sample);
+          });
+    };
+
+    if (!channel_parallelism::crossed_buffers(in.data(), out.data(), channels))
+    {
+      // Each channel over the whole buffer, as in process_samples
+      auto effects_it = implementation.full_state().subrange(first_channel, channels).begin();
+      for (int c = first_channel; c < channels; ++c, ++effects_it)
+      {
+        auto&& [fx, ins, outs] = *effects_it;
+        state_type s = state.load(c);
+        for (int32_t i = 0; i < n; i++)
+          process_one(fx, ins, outs, s, in[c][i], c, i);
+        state.store(c, s);
+      }
+      return;
+    }
+
+    // Same in-place issue than in process_samples: all the inputs of a sample are
+    // fetched before any output is written, thus the states of all the channels are live.
+    const int count = channels - first_channel;
+    auto input_buf = (FP*)alloca(count * sizeof(FP));
+    auto states = (state_type*)alloca(count * sizeof(state_type));
+    for (int k = 0; k < count; k++)
+      new (states + k) state_type(state.load(first_channel + k));
+
+    for (int32_t i = 0; i < n; i++)
+    {
+      for (int k = 0; k < count; k++)
+        input_buf[k] = in[first_channel + k][i];
+
+      auto effects_it = implementation.full_state().subrange(first_channel, channels).begin();
+      for (int k = 0; k < count; ++k, ++effects_it)
+      {
+        auto&& [fx, ins, outs] = *effects_it;
+        process_one(fx, ins, outs, states[k], input_buf[k], first_channel + k, i);
+      }
+    }
+
+    for (int k = 0; k < count; k++)
+      state.store(first_channel + k, states[k]);
+    std::destroy_n(states, count);
+  }
+
+  template <std::floating_point FP>
+  void process_channels(
+      avnd::effect_container<T>& implementation,
+      avnd::span<FP*> in,
+      avnd::span<FP*> out,
+      auto effects_range,
+      int32_t n)
+  {
+    int32_t first = 0;
+
+    // If the processor offers a batched operator(), use it for as many samples as possible,
+    // the remaining tail goes through the per-sample path.
+    if constexpr (batch_width() > 1)
+    {
+      first = process_batches(implementation, in, out, effects_range, n);
+    }
+
+    process_samples(implementation, in, out, effects_range, first, n);
+  }
+
+  // Interleaved buffers of the host, see interleaved_process_adapter.
+  // Each sample is only read by its own channel before being written: in may be out.
+  template <std::floating_point FP>
+  requires(!mono_per_sample_port_simd_state<T>)
+  void process_interleaved(
+      avnd::effect_container<T>& implementation,
+      interleaved_buffer<const FP> in,
+      interleaved_buffer<FP> out,
+      int32_t n)
+  {
+    const int channels = std::min(in.channels, out.channels);
+    for (int32_t i = 0; i < n; i++)
+    {
+      auto effects_it = implementation.full_state().begin();
+      for (int c = 0; c < channels; ++c, ++effects_it)
+      {
+        auto&& ref = *effects_it;
+        const FP sample = in(c, i);
+        if constexpr (requires { sizeof(current_tick(implementation)); })
+          out(c, i) = process_0(implementation, sample, ref, current_tick(implementation));
+        else
+          out(c, i) = process_0(implementation, sample, ref);
+      }
+    }
+  }
+
+  template <std::floating_point FP>
+  void process(
+      avnd::effect_container<T>& implementation,
+      avnd::span<FP*> in,
+      avnd::span<FP*> out,
+      int32_t n)
+  {
+    const int input_channels = in.size();
+    const int output_channels = out.size();
+    assert(input_channels == output_channels);
+
+    const int channels = input_channels;
+
+    if constexpr (mono_per_sample_port_simd_state<T>)
+    {
+      // The groups of channels are processed one after the other over the whole buffer:
+      // not possible when an output may be the input of another channel.
+      int first = 0;
+      if constexpr (lane_width() > 1)
+        if (!channel_parallelism::crossed_buffers(in.data(), out.data(), channels))
+          first = process_lanes(implementation, in, out, n);
+
+      process_simd_state(implementation, in, out, first, n);
+      return;
+    }
+    else if constexpr (!avnd::inputs_is_type<T>)
+    {
+      // See the per_sample_arg adapter
+      const int tasks = parallelism.tasks_for(channels, n);
+      if (tasks > 1
+          && !channel_parallelism::crossed_buffers(in.data(), out.data(), channels))
+      {
+        parallelism.pool->run(tasks, [&](int task) {
+          const auto [first, last]
+              = channel_parallelism::channels_of(task, tasks, channels);
+          process_channels(
+              implementation,
+              in.subspan(first, last - first),
+              out.subspan(first, last - first),
+              implementation.full_state().subrange(first, last),
+              n);
+        });
+        return;
+      }
+    }
+
+    process_channels(implementation, in, out, implementation.full_state(), n);
+  }
 };
 
 /**
@@ -2,6 +2,7 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
+#include <avnd/wrappers/optional_busses.hpp>
 #include <avnd/wrappers/process/base.hpp>
 
 namespace avnd
@@ -52,14 +53,14 @@ struct process_adapter<T> : audio_buffer_storage<T>
       // Copy & convert input channels
       for (int c = 0; c < input_channels; ++c)
       {
-        auto in_ptr = dsp_buffer_input.data() + c * n;
-        std::copy_n(in[c], n, in_ptr);
+        auto in_ptr = dsp_buffer_input.channel(c);
+        avnd::convert_samples(in[c], in_ptr, n);
         in_port.samples[c] = const_cast<input_fp_type*>(in_ptr);
       }
 
       for (int c = 0; c < output_channels; ++c)
       {
-        out_port.samples[c] = dsp_buffer_output.data() + c * n;
+        out_port.samples[c] = dsp_buffer_output.channel(c);
       }
 
       invoke_effect(implementation, n);
@@ -67,7 +68,7 @@ struct process_adapter<T> : audio_buffer_storage<T>
       // Copy & convert output channels
       for (int c = 0; c < output_channels; ++c)
       {
-        std::copy_n(out_port.samples[c], n, out[c]);
+        avnd::convert_samples(out_port.samples[c], out[c], n);
       }
     }
     else
@@ -118,6 +119,26 @@ requires polyphonic_audio_processor<T> &&(
   using i_info = avnd::audio_bus_input_introspection<T>;
   using o_info = avnd::audio_bus_output_introspection<T>;
 
+  // Only the channels of the connected busses are converted
+  template <typename Ports, typename SrcFP, typename DstFP>
+  void convert_inputs(Ports& ports, avnd::span<SrcFP*> in, DstFP** conv, int n)
+  {
+    int k = 0;
+    const int input_channels = in.size();
+    i_info::for_all(
+        ports,
+        [&](auto& bus)
+        {
+          const int channels = avnd::get_channels(bus);
+          if (avnd::bus_connected(bus))
+            for (int c = k; c < std::min(k + channels, input_channels); c++)
+              avnd::convert_samples(in[c], conv[c], n);
+          k += channels;
+        });
+  }
+
+  // The channels of the host are given to the busses in order.
+  // An optional bus which is not connected keeps its place but gets no channel.
   template <typename Info, bool Input, typename Ports>
   void initialize_busses(Ports& ports, auto buffers)
   {
@@ -129,7 +150,11 @@ requires polyphonic_audio_processor<T> &&(
           using sample_type = std::decay_t<decltype(bus.samples[0][0])>;
           const int channels = avnd::get_channels(bus);
 
-          if (k + channels <= buffers.size())
+          if (!avnd::bus_connected(bus))
+          {
+            bus.samples = nullptr;
+          }
+          else if (k + channels <= buffers.size())
           {
             auto buffer = buffers.data() + k;
             bus.samples = const_cast<decltype(bus.samples)>(buffer);
@@ -163,10 +188,10 @@ requires polyphonic_audio_processor<T> &&(
         {
           using sample_type = std::decay_t<decltype(bus.samples[0][0])>;
           const int channels = avnd::get_channels(bus);
-          if (k + channels < buffers.size())
+          if (avnd::bus_connected(bus) && k + channels <= buffers.size())
           {
             for (int c = 0; c < channels; c++)
-              std::copy_n(bus.samples[c], n, buffers[k + c]);
+              avnd::convert_samples(bus.samples[c], buffers[k + c], n);
           }
           k += channels;
         });
@@ -200,13 +225,11 @@ requires polyphonic_audio_processor<T> &&(
         // Convert inputs to the right FP type, init outputs
         auto i_conv = (DstFP**)alloca(sizeof(DstFP*) * input_channels);
         for (int c = 0; c < input_channels; ++c)
-        {
-          i_conv[c] = dsp_buffer_input.data() + c * n;
-          std::copy_n(in[c], n, i_conv[c]);
-        }
+          i_conv[c] = dsp_buffer_input.channel(c);
 
         initialize_busses<i_info, true>(
             implementation.inputs(), avnd::span<DstFP*>(i_conv, input_channels));
+        convert_inputs(implementation.inputs(), in, i_conv, n);
       }
 
       // Same process for the outputs
@@ -218,7 +241,7 @@ requires polyphonic_audio_processor<T> &&(
         auto o_conv = (DstFP**)alloca(sizeof(DstFP*) * output_channels);
         for (int c = 0; c < output_channels; ++c)
         {
-          o_conv[c] = dsp_buffer_output.data() + c * n;
+          o_conv[c] = dsp_buffer_output.channel(c);
         }
 
         initialize_busses<o_info, false>(
@@ -2,6 +2,7 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
+#include <avnd/wrappers/process/fixed_point.hpp>
 #include <avnd/wrappers/process/per_channel_arg.hpp>
 #include <avnd/wrappers/process/per_channel_port.hpp>
 #include <avnd/wrappers/process/per_sample_arg.hpp>
@@ -7,6 +7,9 @@
 #include <avnd/introspection/channels.hpp>
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/audio_buffers.hpp>
+#include <avnd/wrappers/per_bus.hpp>
+#include <avnd/wrappers/texture_tiles.hpp>
 
 #include <concepts>
 #include <cstdint>
@@ -55,8 +58,7 @@ requires(
 template <typename FP, typename T>
 using buffer_type = std::conditional_t<
     needs_storage<FP, T>::value,
-    std::vector<typename needs_storage<FP, T>::needed_storage_t> // TODO aligned alloc
-    ,
+    channel_buffers<typename needs_storage<FP, T>::needed_storage_t>,
     dummy>;
 
 // Original idea was to pass everything by arguments here.
@@ -81,7 +83,15 @@ template <typename T>
 void invoke_effect(avnd::effect_container<T>& implementation, int frames)
 {
   // clang-format off
-  if constexpr (has_tick<T>)
+  if constexpr (tiled_texture_processor<T> && std::is_same_v<decltype(implementation.effect), T>)
+  {
+    run_texture_tiles(implementation.effect);
+  }
+  else if constexpr (per_bus_processor<T> && std::is_same_v<decltype(implementation.effect), T>)
+  {
+    run_output_busses(implementation.effect, frames);
+  }
+  else if constexpr (has_tick<T>)
   {
     // Set-up the "tick" struct
     auto t = current_tick(implementation);
@@ -0,0 +1,203 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Statistics of the time spent in the phases of a node, as read by
+ * avnd_read_node_profiles: the bindings record them when built with AVND_PROFILING.
+ *
+ * Times are in ticks of the cycle counter of the CPU (TSC on x86, virtual counter
+ * on ARM64; nanoseconds elsewhere). histogram[i] counts the calls which took
+ * between 2^(i-1) and 2^i ticks.
+ */
+extern "C" {
+enum avnd_profile_phase
+{
+  avnd_profile_inputs = 0,   // reading the input ports and controls
+  avnd_profile_messages = 1, // running the messages
+  avnd_profile_process = 2,  // running the processor
+  avnd_profile_outputs = 3,  // writing the output ports
+  avnd_profile_phase_count = 4
+};
+
+struct avnd_profile_phase_stats
+{
+  uint64_t calls;
+  uint64_t ticks;
+  uint64_t max_ticks;
+  uint32_t histogram[64];
+};
+
+struct avnd_node_profile_stats
+{
+  const char* name;
+  const void* node;
+  struct avnd_profile_phase_stats phases[avnd_profile_phase_count];
+};
+
+typedef void (*avnd_node_profile_callback)(const struct avnd_node_profile_stats*, void*);
+}
+
+#if AVND_PROFILING
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace avnd
+{
+inline uint64_t profile_ticks() noexcept
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+  uint64_t v;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+  return v;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+/**
+ * Written by the audio thread of a node, read from any thread:
+ * all the counters are relaxed atomics, the reader may reset them
+ * to get the statistics since its last read.
+ */
+struct node_profile
+{
+  struct phase
+  {
+    std::atomic<uint64_t> calls{};
+    std::atomic<uint64_t> ticks{};
+    std::atomic<uint64_t> max_ticks{};
+    std::array<std::atomic<uint32_t>, 64> histogram{};
+
+    void record(uint64_t t) noexcept
+    {
+      constexpr auto r = std::memory_order_relaxed;
+      calls.fetch_add(1, r);
+      ticks.fetch_add(t, r);
+      if (t > max_ticks.load(r))
+        max_ticks.store(t, r);
+      histogram[std::min<int>(std::bit_width(t), 63)].fetch_add(1, r);
+    }
+
+    void read(avnd_profile_phase_stats& s, bool reset) noexcept
+    {
+      constexpr auto r = std::memory_order_relaxed;
+      auto get = [reset](auto& v) { return reset ? v.exchange(0, r) : v.load(r); };
+      s.calls = get(calls);
+      s.ticks = get(ticks);
+      s.max_ticks = get(max_ticks);
+      for (int i = 0; i < 64; i++)
+        s.histogram[i] = get(histogram[i]);
+    }
+  };
+
+  explicit node_profile(std::string_view name);
+  node_profile(const node_profile&) = delete;
+  node_profile& operator=(const node_profile&) = delete;
+  ~node_profile();
+
+  std::string name;
+  std::array<phase, avnd_profile_phase_count> phases;
+};
+
+/**
+ * All the profiles currently alive. Nodes register in their constructor,
+ * so this is only locked outside of the audio thread.
+ */
+struct profile_registry
+{
+  static profile_registry& instance()
+  {
+    static profile_registry r;
+    return r;
+  }
+
+  std::mutex mutex;
+  std::vector<node_profile*> profiles;
+};
+
+inline node_profile::node_profile(std::string_view name)
+    : name{name}
+{
+  auto& r = profile_registry::instance();
+  std::lock_guard lock{r.mutex};
+  r.profiles.push_back(this);
+}
+
+inline node_profile::~node_profile()
+{
+  auto& r = profile_registry::instance();
+  std::lock_guard lock{r.mutex};
+  std::erase(r.profiles, this);
+}
+
+// Times the scope it lives in
+struct profile_scope
+{
+  node_profile::phase& phase;
+  uint64_t start = profile_ticks();
+
+  profile_scope(node_profile& p, avnd_profile_phase ph) noexcept
+      : phase{p.phases[ph]}
+  {
+  }
+  ~profile_scope() { phase.record(profile_ticks() - start); }
+};
+}
+
+/**
+ * Calls cb(stats, ctx) with the statistics of each node currently alive.
+ * If reset is non-zero, the counters start again from zero, e.g. to get
+ * the statistics of the last second by calling this every second.
+ */
+extern "C" inline void
+avnd_read_node_profiles(avnd_node_profile_callback cb, void* ctx, int reset)
+{
+  auto& r = avnd::profile_registry::instance();
+  std::lock_guard lock{r.mutex};
+  for (avnd::node_profile* p : r.profiles)
+  {
+    avnd_node_profile_stats stats{};
+    stats.name = p->name.c_str();
+    stats.node = p;
+    for (int i = 0; i < avnd_profile_phase_count; i++)
+      p->phases[i].read(stats.phases[i], reset != 0);
+    cb(&stats, ctx);
+  }
+}
+#else
+namespace avnd
+{
+struct node_profile
+{
+  explicit node_profile(std::string_view) noexcept { }
+};
+
+struct profile_scope
+{
+  profile_scope(node_profile&, avnd_profile_phase) noexcept { }
+};
+}
+
+// Nothing is recorded
+extern "C" inline void avnd_read_node_profiles(avnd_node_profile_callback, void*, int) { }
+#endif
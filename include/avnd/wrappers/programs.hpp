@@ -0,0 +1,148 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/audio_processor.hpp>
+#include <avnd/introspection/input.hpp>
+#include <boost/pfr.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <concepts>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+
+namespace avnd
+{
+// How long the floating-point controls glide to the values of a program
+// when it gets selected, e.g. halp_meta(program_fade_seconds, 0.05). Not at all by default.
+template <typename T>
+constexpr double program_fade_seconds() noexcept
+{
+  if constexpr (requires { double(T::program_fade_seconds()); })
+    return T::program_fade_seconds();
+  else if constexpr (requires { double(T::program_fade_seconds); })
+    return T::program_fade_seconds;
+  else
+    return 0.;
+}
+
+template <typename Field>
+using program_value_type = std::decay_t<decltype(Field::value)>;
+
+template <typename T>
+struct program_storage
+{
+  static constexpr void prepare(double) noexcept { }
+  static constexpr bool select(int) noexcept { return false; }
+  static constexpr void apply(avnd::effect_container<T>&, int) noexcept { }
+};
+
+/**
+ * Switches the programs of a processor, i.e. its T::programs presets,
+ * without the audio thread ever seeing half of one: the values of the controls
+ * of every program are copied once, and select() only tells the audio thread
+ * which one to use. apply(), before the processor at every buffer, then sets
+ * them all at once.
+ *
+ * With program_fade_seconds(), the floating-point controls go from their
+ * current value to the one of the program over that time, buffer per buffer:
+ * the smoothed ones are then smoothed within the buffers too.
+ */
+template <typename T>
+requires has_programs<T> && (parameter_input_introspection<T>::size > 0)
+struct program_storage<T>
+{
+  using parameters_in = parameter_input_introspection<T>;
+  using values = filter_and_apply<program_value_type, parameter_input_introspection, T>;
+  static constexpr std::size_t count = std::size(T::programs);
+
+  program_storage()
+  {
+    for (std::size_t p = 0; p < count; p++)
+    {
+      [&]<std::size_t... Index>(std::index_sequence<Index...>) {
+        const auto& source = T::programs[p].parameters;
+        ((std::get<Index>(m_programs[p])
+          = boost::pfr::get<parameters_in::index_map[Index]>(source).value),
+         ...);
+      }(std::make_index_sequence<parameters_in::size>{});
+    }
+  }
+
+  void prepare(double rate)
+  {
+    m_fade_length = std::max(int(std::round(rate * program_fade_seconds<T>())), 0);
+  }
+
+  // Can be called from any thread
+  bool select(int program) noexcept
+  {
+    if (program < 0 || program >= int(count))
+      return false;
+    m_requested.store(program, std::memory_order_release);
+    return true;
+  }
+
+  // At the start of a buffer, once the controls of the host are written
+  void apply(avnd::effect_container<T>& t, int frames)
+  {
+    if (const int p = m_requested.exchange(-1, std::memory_order_acquire); p >= 0)
+    {
+      m_current = p;
+      m_fade = 0;
+      if (m_fade_length == 0)
+      {
+        write(avnd::get_inputs(t), 1.);
+        return;
+      }
+      save_start(avnd::get_inputs(t));
+    }
+
+    if (m_current >= 0 && m_fade < m_fade_length)
+    {
+      m_fade = std::min(m_fade + frames, m_fade_length);
+      write(avnd::get_inputs(t), double(m_fade) / m_fade_length);
+    }
+  }
+
+private:
+  void save_start(auto& inputs)
+  {
+    parameters_in::for_all_n(
+        inputs, [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          std::get<Idx>(m_start) = port.value;
+        });
+  }
+
+  void write(auto& inputs, double amount)
+  {
+    const auto& target = m_programs[m_current];
+    parameters_in::for_all_n(
+        inputs, [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          using value_type = program_value_type<M>;
+          const auto& to = std::get<Idx>(target);
+          if constexpr (std::floating_point<value_type>)
+          {
+            if (amount < 1.)
+            {
+              const auto& from = std::get<Idx>(m_start);
+              port.value = value_type(from + amount * (to - from));
+              return;
+            }
+          }
+          port.value = to;
+        });
+  }
+
+  std::array<values, count> m_programs{};
+  values m_start{};
+  std::atomic<int> m_requested{-1};
+  int m_current{-1};
+  int m_fade{};
+  int m_fade_length{};
+};
+}
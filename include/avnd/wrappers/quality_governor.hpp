@@ -0,0 +1,190 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/render_mode.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+
+namespace avnd
+{
+/**
+ * Processors which can trade quality for CPU time, e.g. with their oversampling
+ * factor, the most voices they play or the size of their FFT, declare how many
+ * levels they have, from 0, the cheapest, to quality_levels - 1, the best,
+ * and the member which the bindings set at the beginning of the buffers:
+ *
+ * halp_meta(quality_levels, 3)
+ * int quality{};
+ *
+ * While the processing of the buffers takes more than quality_budget of their
+ * duration, 0.5 by default, the quality steps down, one level at a time; once it
+ * stayed under half of that for quality_recovery_seconds, 2 by default, it steps
+ * back up. Offline renders always get the best quality.
+ */
+template <typename T>
+concept has_quality_levels = requires(T t) {
+  { T::quality_levels() } -> std::convertible_to<int>;
+  t.quality = 0;
+};
+
+template <typename T>
+constexpr double quality_budget() noexcept
+{
+  if constexpr (requires { double(T::quality_budget()); })
+    return T::quality_budget();
+  else
+    return 0.5;
+}
+
+template <typename T>
+constexpr double quality_recovery_seconds() noexcept
+{
+  if constexpr (requires { double(T::quality_recovery_seconds()); })
+    return T::quality_recovery_seconds();
+  else
+    return 2.;
+}
+
+template <typename T>
+struct quality_governor
+{
+  void prepare(double, render_mode = render_mode::realtime) noexcept { }
+  void set_render_mode(render_mode) noexcept { }
+  void apply(avnd::effect_container<T>&) noexcept { }
+  static constexpr int level() noexcept { return 0; }
+};
+
+template <has_quality_levels T>
+struct quality_governor<T>
+{
+  static constexpr int best = std::max(int(T::quality_levels()) - 1, 0);
+
+  // Outside of the audio thread, e.g. with the other storages in prepare
+  void prepare(double rate, render_mode mode = render_mode::realtime) noexcept
+  {
+    m_ns_per_frame = rate > 0. ? 1e9 / rate : 0.;
+    m_recovery_frames = int64_t(std::ceil(quality_recovery_seconds<T>() * rate));
+    m_settle_frames = int64_t(std::ceil(0.1 * rate));
+    m_level = best;
+    m_applied = -1;
+    m_load = 0.;
+    m_fresh = true;
+    m_below = 0;
+    m_settle = 0;
+    set_render_mode(mode);
+  }
+
+  // Audio thread, when the host changes it while running
+  void set_render_mode(render_mode mode) noexcept
+  {
+    m_offline = mode == render_mode::offline;
+    if (m_offline)
+      m_level = best;
+  }
+
+  // Audio thread, before the processor: sets the quality chosen with the last buffers
+  void apply(avnd::effect_container<T>& implementation) noexcept
+  {
+    if (m_level == m_applied)
+      return;
+    for (auto& e : implementation.effects())
+      e.quality = m_level;
+    m_applied = m_level;
+  }
+
+  // Audio thread, after the processor: how long it took for frames
+  void record(int64_t frames, uint64_t ns) noexcept
+  {
+    const double block_ns = double(frames) * m_ns_per_frame;
+    if (m_offline || block_ns <= 0.)
+      return;
+
+    // Averaged over a few buffers, so that a single spike does not change anything,
+    // and from the first buffer at a new level
+    const double load = double(ns) / block_ns;
+    m_load = m_fresh ? load : m_load + 0.25 * (load - m_load);
+    m_fresh = false;
+
+    // The load of a new level is only known a few buffers after
+    if (m_settle > 0)
+    {
+      m_settle -= frames;
+      return;
+    }
+
+    constexpr double budget = quality_budget<T>();
+    if (m_load > budget)
+    {
+      m_below = 0;
+      if (m_level > 0)
+        change(m_level - 1, frames);
+    }
+    else if (m_load < 0.5 * budget && m_level < best)
+    {
+      m_below += frames;
+      if (m_below >= m_recovery_frames)
+        change(m_level + 1, frames);
+    }
+    else
+    {
+      m_below = 0;
+    }
+  }
+
+  int level() const noexcept { return m_level; }
+
+private:
+  void change(int level, int64_t frames) noexcept
+  {
+    m_level = level;
+    m_below = 0;
+    m_settle = std::max(m_settle_frames, 4 * frames);
+    m_fresh = true;
+  }
+
+  double m_ns_per_frame{};
+  double m_load{};
+  int64_t m_recovery_frames{};
+  int64_t m_settle_frames{};
+  int64_t m_below{};
+  int64_t m_settle{};
+  int m_level{best};
+  int m_applied{-1};
+  bool m_offline{};
+  bool m_fresh{true};
+};
+
+// Times the callback it lives in, for the processors with quality levels
+template <typename T>
+struct quality_scope
+{
+  quality_scope(quality_governor<T>&, int64_t) noexcept { }
+};
+
+template <has_quality_levels T>
+struct quality_scope<T>
+{
+  quality_governor<T>& governor;
+  int64_t frames;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  quality_scope(quality_governor<T>& g, int64_t frames) noexcept
+      : governor{g}
+      , frames{frames}
+  {
+  }
+
+  ~quality_scope()
+  {
+    const auto t = std::chrono::steady_clock::now() - start;
+    governor.record(
+        frames, std::chrono::duration_cast<std::chrono::nanoseconds>(t).count());
+  }
+};
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <cstdint>
+
+/**
+ * Realtime-safety checks for debug and QA builds, enabled by AVND_RT_SANITIZE,
+ * i.e. the AVENDISH_RT_SANITIZE CMake option.
+ *
+ * The bindings open a realtime_scope around their audio callback. Within one,
+ * src/realtime_sanitizer.cpp, which is then linked in each binding, reports the calls
+ * which may block: the allocations and deallocations, the mutex locks and waits,
+ * and the syscalls of the files, the sleeps and the standard output.
+ * Each distinct call site is reported once, with its stack trace, on stderr.
+ *
+ * Only the calls made from the binary built with the processor are seen:
+ * the host and the other libraries are left untouched.
+ * Outside of a scope, each call costs a check of a thread-local counter.
+ *
+ * The AVND_RT_SANITIZE environment variable picks what a violation does:
+ * "log" (the default) reports it and goes on, "abort" reports it then aborts,
+ * "off" ignores it.
+ */
+extern "C" {
+enum avnd_rt_sanitizer_mode
+{
+  avnd_rt_sanitizer_off = 0,
+  avnd_rt_sanitizer_log = 1,
+  avnd_rt_sanitizer_abort = 2
+};
+
+#if AVND_RT_SANITIZE
+void avnd_rt_sanitizer_set_mode(enum avnd_rt_sanitizer_mode mode);
+// Violations since the start, including the ones at call sites already reported
+uint64_t avnd_rt_sanitizer_violations(void);
+#endif
+}
+
+#if AVND_RT_SANITIZE
+#if defined(__GNUC__)
+#define AVND_RT_TLS __attribute__((tls_model("initial-exec")))
+#else
+#define AVND_RT_TLS
+#endif
+
+namespace avnd::rt
+{
+// Not the default model, which may allocate on the first access by a thread:
+// they are read from within malloc
+inline thread_local int realtime_depth AVND_RT_TLS = 0;
+inline thread_local int exempt_depth AVND_RT_TLS = 0;
+}
+
+namespace avnd
+{
+// The code the checks apply to
+struct realtime_scope
+{
+  realtime_scope() noexcept { rt::realtime_depth++; }
+  ~realtime_scope() { rt::realtime_depth--; }
+  realtime_scope(const realtime_scope&) = delete;
+  realtime_scope& operator=(const realtime_scope&) = delete;
+};
+
+// Code of a realtime_scope known to be fine, e.g. an allocation in a first buffer
+// which is accepted for now
+struct realtime_exempt
+{
+  realtime_exempt() noexcept { rt::exempt_depth++; }
+  ~realtime_exempt() { rt::exempt_depth--; }
+  realtime_exempt(const realtime_exempt&) = delete;
+  realtime_exempt& operator=(const realtime_exempt&) = delete;
+};
+}
+#else
+namespace avnd
+{
+struct realtime_scope
+{
+  realtime_scope() noexcept { }
+};
+
+struct realtime_exempt
+{
+  realtime_exempt() noexcept { }
+};
+}
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/render_mode.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <atomic>
+
+namespace avnd
+{
+/**
+ * Processors which change their algorithms for offline rendering, e.g. with
+ * more oversampling or longer FFTs, get the mode in the offline or realtime
+ * member of their setup when prepared, and in a member which the bindings
+ * keep up to date when the host changes it while running:
+ *
+ * avnd::render_mode render_mode;
+ */
+template <typename T>
+concept has_render_mode = requires(T t) { t.render_mode = avnd::render_mode::offline; };
+
+template <typename T>
+void set_render_mode(avnd::effect_container<T>& implementation, render_mode mode) noexcept
+{
+  if constexpr (has_render_mode<T>)
+    for (auto& e : implementation.effects())
+      e.render_mode = mode;
+}
+
+/**
+ * The mode the host asked for from its main thread, which the audio thread
+ * gives to the processor at the beginning of the next buffer.
+ */
+struct render_mode_request
+{
+  void set(render_mode mode) noexcept { m_mode.store(mode, std::memory_order_relaxed); }
+  render_mode get() const noexcept { return m_mode.load(std::memory_order_relaxed); }
+
+  // Audio thread, before the processor
+  template <typename T>
+  void apply(avnd::effect_container<T>& implementation) const noexcept
+  {
+    if constexpr (has_render_mode<T>)
+      set_render_mode(implementation, get());
+  }
+
+private:
+  std::atomic<render_mode> m_mode{render_mode::realtime};
+};
+}
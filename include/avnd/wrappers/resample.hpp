@@ -0,0 +1,72 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+namespace avnd
+{
+// Number of frames of a signal once resampled
+inline int64_t resampled_frames(int64_t frames, double from_rate, double to_rate) noexcept
+{
+  if (from_rate <= 0. || to_rate <= 0. || from_rate == to_rate)
+    return frames;
+  return int64_t(std::ceil(double(frames) * to_rate / from_rate));
+}
+
+/**
+ * Band-limited resampling of a whole signal, e.g. a soundfile when it gets loaded:
+ * windowed-sinc interpolation, with the cutoff lowered when downsampling.
+ * Meant to be run outside of the audio thread.
+ *
+ * out must have room for out_frames samples, see resampled_frames.
+ */
+template <typename In, typename Out>
+void resample(
+    const In* in, int64_t in_frames, double from_rate, Out* out, int64_t out_frames,
+    double to_rate)
+{
+  using std::numbers::pi;
+  if (from_rate <= 0. || to_rate <= 0. || from_rate == to_rate)
+  {
+    const int64_t n = std::min(in_frames, out_frames);
+    std::copy_n(in, n, out);
+    std::fill_n(out + n, out_frames - n, Out{});
+    return;
+  }
+
+  // Zero crossings of the sinc on each side, at the input rate when not downsampling
+  constexpr int half_taps = 16;
+
+  const double step = from_rate / to_rate;
+  const double cutoff = std::min(1., to_rate / from_rate);
+  const double width = half_taps / cutoff;
+  const int64_t reach = int64_t(std::ceil(width));
+
+  for (int64_t i = 0; i < out_frames; i++)
+  {
+    const double pos = double(i) * step;
+    const int64_t center = int64_t(pos);
+    const int64_t first = std::max(center - reach + 1, int64_t(0));
+    const int64_t last = std::min(center + reach, in_frames - 1);
+
+    double acc = 0.;
+    for (int64_t k = first; k <= last; k++)
+    {
+      const double x = pos - double(k);
+      if (std::abs(x) >= width)
+        continue;
+
+      const double t = pi * x * cutoff;
+      const double sinc = t == 0. ? 1. : std::sin(t) / t;
+      const double window
+          = 0.42 + 0.5 * std::cos(pi * x / width) + 0.08 * std::cos(2. * pi * x / width);
+      acc += double(in[k]) * sinc * window;
+    }
+    out[i] = Out(acc * cutoff);
+  }
+}
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/for_nth.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace avnd
+{
+/**
+ * Duplicated monophonic processors whose inputs are members of T
+ * have one copy of the controls per instance, e.g. 64 for a 64-channel effect.
+ */
+template <typename T>
+concept duplicated_inputs = avnd::monophonic_audio_processor<T> && avnd::inputs_is_value<T>
+                            && avnd::outputs_is_value<T>;
+
+// sync() runs on the audio thread: it only copies values which cannot allocate nor throw
+template <typename T>
+inline constexpr bool trivially_copyable_controls
+    = []<std::size_t... N>(std::index_sequence<N...>) {
+        using param_in = parameter_input_introspection<T>;
+        return (
+            std::is_trivially_copyable_v<
+                std::remove_cvref_t<decltype(std::declval<
+                                             typename param_in::template nth_element<N>&>()
+                                                 .value)>>
+            && ...);
+      }(std::make_index_sequence<parameter_input_introspection<T>::size>{});
+
+/**
+ * Writes the controls of a processor from a binding.
+ *
+ * For duplicated_inputs processors, write() only changes the controls of the
+ * first instance and notes which ones changed. sync() then copies those values
+ * to the other instances once, before the processor runs. So a control which the
+ * host changes several times in a buffer is not written to every instance each time.
+ * Other processors have a single copy of their controls, which write() sets directly,
+ * as well as duplicated ones with e.g. string controls, whose copy could allocate.
+ *
+ * write_raw() takes the index of the field among all the inputs, e.g. the parameter
+ * ids of VST3 and ossia.
+ */
+template <typename T>
+struct shared_controls
+{
+  using param_in = parameter_input_introspection<T>;
+
+  // index is the one of the parameter among the parameter inputs
+  template <typename F>
+  static void write(avnd::effect_container<T>& t, int index, F&& f)
+  {
+    if constexpr (duplicated_inputs<T>)
+    {
+      for (auto& fx : t.effect)
+        param_in::for_nth_mapped(fx.inputs, index, f);
+    }
+    else
+    {
+      param_in::for_nth_mapped(t.inputs(), index, f);
+    }
+  }
+
+  template <typename F>
+  static void write_raw(avnd::effect_container<T>& t, int field, F&& f)
+  {
+    if constexpr (duplicated_inputs<T>)
+    {
+      for (auto& fx : t.effect)
+        param_in::for_nth_raw(fx.inputs, field, f);
+    }
+    else
+    {
+      param_in::for_nth_raw(t.inputs(), field, f);
+    }
+  }
+
+  template <typename F>
+  static void read(avnd::effect_container<T>& t, int index, F&& f)
+  {
+    if constexpr (duplicated_inputs<T>)
+    {
+      if (!t.effect.empty())
+        param_in::for_nth_mapped(t.effect[0].inputs, index, f);
+    }
+    else
+    {
+      param_in::for_nth_mapped(t.inputs(), index, f);
+    }
+  }
+
+  static constexpr void sync(avnd::effect_container<T>&) noexcept { }
+};
+
+template <typename T>
+  requires duplicated_inputs<T> && (parameter_input_introspection<T>::size > 0)
+           && trivially_copyable_controls<T>
+struct shared_controls<T>
+{
+  using param_in = parameter_input_introspection<T>;
+  static constexpr int count = param_in::size;
+  static constexpr int words = (count + 63) / 64;
+
+  // Index among the parameters of each field of the inputs, -1 for the other fields
+  static constexpr auto parameter_of_field = [] {
+    std::array<int, param_in::index_map[count - 1] + 1> map{};
+    map.fill(-1);
+    for (int k = 0; k < count; k++)
+      map[param_in::index_map[k]] = k;
+    return map;
+  }();
+
+  template <typename F>
+  void write(avnd::effect_container<T>& t, int index, F&& f)
+  {
+    if (t.effect.empty() || index < 0 || index >= count)
+      return;
+
+    param_in::for_nth_mapped(t.effect[0].inputs, index, f);
+    m_changed[index / 64] |= uint64_t(1) << (index % 64);
+    m_pending = true;
+  }
+
+  template <typename F>
+  void write_raw(avnd::effect_container<T>& t, int field, F&& f)
+  {
+    if (field >= 0 && field < int(parameter_of_field.size()))
+      write(t, parameter_of_field[field], std::forward<F>(f));
+  }
+
+  // The controls as the host last set them, i.e. those of the first instance
+  template <typename F>
+  void read(avnd::effect_container<T>& t, int index, F&& f)
+  {
+    if (t.effect.empty() || index < 0 || index >= count)
+      return;
+
+    param_in::for_nth_mapped(t.effect[0].inputs, index, f);
+  }
+
+  // Copies the controls changed since the last sync to the other instances
+  void sync(avnd::effect_container<T>& t) noexcept
+  {
+    if (!m_pending)
+      return;
+    m_pending = false;
+
+    auto& effect = t.effect;
+    for (int w = 0; w < words; w++)
+    {
+      for (uint64_t bits = std::exchange(m_changed[w], 0); bits != 0; bits &= bits - 1)
+      {
+        const int index = w * 64 + std::countr_zero(bits);
+        avnd::for_nth<param_in::size>(index, [&]<std::size_t N> {
+          const auto& src = param_in::template get<N>(effect[0].inputs);
+          for (std::size_t k = 1; k < effect.size(); k++)
+          {
+            auto& dst = param_in::template get<N>(effect[k].inputs);
+            dst.value = src.value;
+            if constexpr (modulated_parameter<std::decay_t<decltype(src)>>)
+              dst.modulation = src.modulation;
+          }
+        });
+      }
+    }
+  }
+
+private:
+  std::array<uint64_t, words> m_changed{};
+  bool m_pending{};
+};
+}
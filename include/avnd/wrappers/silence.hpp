@@ -0,0 +1,123 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/audio_port.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace avnd
+{
+/**
+ * Processors whose output becomes silent a given time after their input did,
+ * e.g. the decay of a reverb, can declare it:
+ *
+ * halp_meta(tail_seconds, 2.5)
+ *
+ * or as a member function when it depends on the controls.
+ * Infinity means that the output may never become silent.
+ * The bindings can then stop calling the processor while it only gets silence.
+ */
+template <typename T>
+concept has_tail = requires(T t) {
+  { t.tail_seconds() } -> std::convertible_to<double>;
+};
+
+// Tails which depend on the controls: the bindings tell the host when they change
+template <typename T>
+concept dynamic_tail = has_tail<T> && !requires {
+  typename std::bool_constant<(double(T::tail_seconds()) >= 0.)>;
+};
+
+// The longest tail of the instances
+template <typename T>
+double tail_seconds(avnd::effect_container<T>& implementation)
+{
+  double tail = 0.;
+  if constexpr (has_tail<T>)
+    for (auto& eff : implementation.effects())
+      tail = std::max(tail, double(eff.tail_seconds()));
+  return tail;
+}
+
+// Written so that the compiler can vectorize it
+template <typename FP>
+bool is_silent(const FP* samples, int frames) noexcept
+{
+  bool sound = false;
+  for (int i = 0; i < frames; i++)
+    sound |= (samples[i] != FP(0));
+  return !sound;
+}
+
+// Gives the silent channels of the first input bus to processors which want them
+template <typename T>
+void set_input_silence(avnd::effect_container<T>& implementation, uint64_t mask) noexcept
+{
+  using refl = avnd::audio_bus_input_introspection<T>;
+  if constexpr (refl::size > 0)
+  {
+    auto& bus = refl::template get<0>(implementation.inputs());
+    if constexpr (silence_flagged_audio_port<std::decay_t<decltype(bus)>>)
+      bus.silence = mask;
+  }
+}
+
+/**
+ * Counts, for a processor with a tail, the frames since its input became silent:
+ * once they exceed the tail, its output is silent too and it does not need to run
+ * until the input changes.
+ */
+class silence_tracker
+{
+public:
+  void prepare(double rate) noexcept { m_rate = rate; }
+
+  // To be called before processing each buffer, with the current tail
+  void advance(bool silent_input, int frames, double tail_seconds) noexcept
+  {
+    if (!silent_input)
+    {
+      m_silent = false;
+      m_silent_frames = 0;
+      return;
+    }
+
+    if (!m_silent)
+    {
+      m_silent = true;
+      m_silent_frames = 0;
+      m_tail_frames = std::isfinite(tail_seconds)
+                          ? int64_t(std::ceil(std::max(tail_seconds, 0.) * m_rate))
+                          : std::numeric_limits<int64_t>::max();
+    }
+    else
+    {
+      m_silent_frames = std::min(
+          m_silent_frames + m_last_frames, std::numeric_limits<int64_t>::max() / 2);
+    }
+    m_last_frames = frames;
+  }
+
+  // The input is silent, but the output may not be yet
+  bool in_tail() const noexcept { return m_silent && !asleep(); }
+
+  // The input has been silent for longer than the tail before this buffer:
+  // the output of the processor would be silent
+  bool asleep() const noexcept { return m_silent && m_silent_frames >= m_tail_frames; }
+
+private:
+  double m_rate{44100.};
+  int64_t m_silent_frames{};
+  int64_t m_tail_frames{};
+  int64_t m_last_frames{};
+  bool m_silent{};
+};
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/freestanding.hpp>
+#include <avnd/common/struct_reflection.hpp>
+#include <avnd/concepts/processor.hpp>
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace avnd
+{
+/**
+ * Stores N instances of an aggregate field by field:
+ * struct { float a; int b; } gives a vector of float and a vector of int.
+ */
+template <typename S, typename = std::make_index_sequence<field_count<S>>>
+class soa_storage;
+
+template <typename S, std::size_t... I>
+class soa_storage<S, std::index_sequence<I...>>
+{
+public:
+  std::size_t size() const noexcept { return m_size; }
+
+  // New elements get the default member initializers of S
+  void resize(std::size_t n)
+  {
+    const S init{};
+    (std::get<I>(m_fields).resize(n, pfr::get<I>(init)), ...);
+    m_size = n;
+  }
+
+  void reserve(std::size_t n) { (std::get<I>(m_fields).reserve(n), ...); }
+
+  template <std::size_t F>
+  auto* field() noexcept
+  {
+    return std::get<F>(m_fields).data();
+  }
+
+  S load(std::size_t index) const noexcept
+  {
+    S s;
+    ((pfr::get<I>(s) = std::get<I>(m_fields)[index]), ...);
+    return s;
+  }
+
+  void store(std::size_t index, const S& s) noexcept
+  {
+    ((std::get<I>(m_fields)[index] = pfr::get<I>(s)), ...);
+  }
+
+private:
+  std::tuple<avnd::channel_vector<field_type<I, S>>...> m_fields;
+  std::size_t m_size{};
+};
+
+template <typename T>
+struct simd_state_storage
+{
+  static constexpr void resize_simd_state(std::size_t) noexcept { }
+  static constexpr void reserve_simd_state(std::size_t) noexcept { }
+};
+
+/**
+ * State of each channel of a duplicated processor which declares a simd_state
+ */
+template <mono_per_sample_port_simd_state T>
+struct simd_state_storage<T>
+{
+  soa_storage<typename T::simd_state> simd_state;
+
+  void resize_simd_state(std::size_t channels) { simd_state.resize(channels); }
+  void reserve_simd_state(std::size_t channels) { simd_state.reserve(channels); }
+};
+}
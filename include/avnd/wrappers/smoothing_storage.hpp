@@ -0,0 +1,173 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/freestanding.hpp>
+#include <avnd/concepts/parameter.hpp>
+#include <avnd/introspection/input.hpp>
+#include <boost/mp11.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace avnd
+{
+/**
+ * Generates the per-sample ramp of a smoothed parameter for a buffer.
+ *
+ * Linear ramps last smoothing_time(), and restart from the current value
+ * when the target changes. Exponential ones get a one-pole response with
+ * smoothing_time() as time constant, and snap to the target once close enough.
+ * In both cases the ramp of a buffer is computed without loop-carried dependency.
+ */
+template <std::floating_point FP>
+struct parameter_smoother
+{
+  void prepare(double milliseconds, bool exponential, double rate, int buffer_size)
+  {
+    const double frames = std::max(milliseconds * 0.001 * rate, 1.);
+    m_exponential = exponential;
+    m_ramp_frames = int(std::lround(frames));
+    m_ramp.assign(buffer_size, FP{});
+
+    // m_powers[k] = coefficient^(k+1)
+    m_powers.resize(buffer_size);
+    const double coeff = std::exp(-1. / frames);
+    double p = 1.;
+    for (auto& v : m_powers)
+      v = FP(p *= coeff);
+
+    m_last = {};
+    m_started = false;
+    m_remaining = 0;
+  }
+
+  // Computes the ramp towards target for the next frames
+  void run(FP target, int frames) noexcept
+  {
+    if (!m_started || frames > std::ssize(m_ramp))
+    {
+      // First buffer, or the host did not give us the right buffer size
+      m_started = true;
+      m_current = target;
+      m_remaining = 0;
+    }
+
+    m_last = {};
+    if (m_current == target)
+      return;
+
+    FP* ramp = m_ramp.data();
+    if (m_exponential)
+    {
+      const FP d = m_current - target;
+      for (int i = 0; i < frames; i++)
+        ramp[i] = target + d * m_powers[i];
+
+      const FP end = frames > 0 ? d * m_powers[frames - 1] : d;
+      const FP epsilon = FP(1e-5) * std::max(FP(1), std::abs(target));
+      m_current = std::abs(end) > epsilon ? target + end : target;
+    }
+    else
+    {
+      if (target != m_target || m_remaining == 0)
+      {
+        m_remaining = m_ramp_frames;
+        m_step = (target - m_current) / FP(m_remaining);
+      }
+
+      const int n = std::min(frames, m_remaining);
+      const FP start = m_current;
+      const FP step = m_step;
+      for (int i = 0; i < n; i++)
+        ramp[i] = start + step * FP(i + 1);
+      std::fill(ramp + n, ramp + frames, target);
+
+      m_remaining -= n;
+      m_current = m_remaining > 0 ? start + step * FP(n) : target;
+    }
+    m_target = target;
+    m_last = {ramp, std::size_t(frames)};
+  }
+
+  // Last computed ramp, or an empty span if the value is stable
+  avnd::span<const FP> ramp() const noexcept { return m_last; }
+
+private:
+  avnd::frame_vector<FP> m_ramp;
+  avnd::frame_vector<FP> m_powers;
+  avnd::span<const FP> m_last;
+  FP m_current{};
+  FP m_target{};
+  FP m_step{};
+  int m_remaining{};
+  int m_ramp_frames{1};
+  bool m_exponential{};
+  bool m_started{};
+};
+
+template <typename Field>
+using parameter_smoother_type
+    = parameter_smoother<std::decay_t<decltype(Field::value)>>;
+
+template <typename T>
+struct smoothing_storage
+{
+  static constexpr void prepare(avnd::effect_container<T>&, double, int) noexcept { }
+  static constexpr void update(avnd::effect_container<T>&, int) noexcept { }
+};
+
+/**
+ * Used to store the state and ramps of smoothed parameters.
+ * update() has to be called before each call to the processor.
+ */
+template <typename T>
+requires(smoothed_parameter_input_introspection<T>::size > 0)
+struct smoothing_storage<T>
+{
+  using smoothed_in = smoothed_parameter_input_introspection<T>;
+
+  // std::tuple< parameter_smoother<float>, parameter_smoother<double> >
+  using smoothers = filter_and_apply<
+      parameter_smoother_type,
+      smoothed_parameter_input_introspection,
+      T>;
+
+  smoothers smoothing;
+
+  void prepare(avnd::effect_container<T>& t, double rate, int buffer_size)
+  {
+    smoothed_in::for_all_n(
+        avnd::get_inputs(t),
+        [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          std::get<Idx>(this->smoothing)
+              .prepare(
+                  M::smoothing_time(), exponential_smoothed_parameter<M>, rate,
+                  buffer_size);
+          port.ramp = {};
+        });
+  }
+
+  void update(avnd::effect_container<T>& t, int frames)
+  {
+    // Duplicated instances all share the ramp, which is only computed for the first one
+    ++m_update;
+    smoothed_in::for_all_n(
+        avnd::get_inputs(t),
+        [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          auto& smoother = std::get<Idx>(this->smoothing);
+          if (m_last_update[Idx] != m_update)
+          {
+            m_last_update[Idx] = m_update;
+            smoother.run(port.value, frames);
+          }
+          port.ramp = smoother.ramp();
+        });
+  }
+
+private:
+  int64_t m_update{};
+  int64_t m_last_update[smoothed_in::size]{};
+};
+}
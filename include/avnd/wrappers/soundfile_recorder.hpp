@@ -0,0 +1,443 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/spsc_queue.hpp>
+#include <avnd/concepts/soundfile.hpp>
+#include <avnd/introspection/output.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace avnd
+{
+/**
+ * Encoder used by recorded_soundfile, called only from its writer thread.
+ */
+class soundfile_sink
+{
+public:
+  virtual ~soundfile_sink() = default;
+
+  // Appends frames of each channel in[channel].
+  // Returns false if they could not be written.
+  virtual bool write(const float* const* in, int64_t frames) = 0;
+
+  // Completes the file once all the frames are written
+  virtual bool finalize() = 0;
+};
+
+/**
+ * Writes 32-bit floating-point WAVE files. Past 4GB, i.e. a few minutes of
+ * a multitrack recording, the header becomes an RF64 one.
+ */
+class wav_soundfile_sink final : public soundfile_sink
+{
+public:
+  static std::unique_ptr<soundfile_sink>
+  create(const std::string& path, int32_t channels, double rate)
+  {
+    auto sink = std::unique_ptr<wav_soundfile_sink>(new wav_soundfile_sink);
+    sink->m_channels = channels;
+    sink->m_rate = uint32_t(rate);
+    sink->m_file = std::fopen(path.c_str(), "wb");
+    if (!sink->m_file || !sink->write_header())
+      return {};
+    return sink;
+  }
+
+  ~wav_soundfile_sink() override
+  {
+    if (m_file)
+      std::fclose(m_file);
+  }
+
+  bool write(const float* const* in, int64_t frames) override
+  {
+    m_bytes.resize(frames * m_channels * 4);
+    unsigned char* p = m_bytes.data();
+    for (int64_t i = 0; i < frames; i++)
+      for (int c = 0; c < m_channels; c++, p += 4)
+        le(p, std::bit_cast<uint32_t>(in[c][i]), 4);
+
+    if (std::fwrite(m_bytes.data(), 1, m_bytes.size(), m_file) != m_bytes.size())
+      return false;
+    m_frames += frames;
+    return true;
+  }
+
+  bool finalize() override
+  {
+    bool ok = std::fseek(m_file, 0, SEEK_SET) == 0 && write_header();
+    ok = std::fclose(m_file) == 0 && ok;
+    m_file = nullptr;
+    return ok;
+  }
+
+private:
+  wav_soundfile_sink() = default;
+
+  static void le(unsigned char* p, uint64_t v, int bytes) noexcept
+  {
+    for (int i = 0; i < bytes; i++)
+      p[i] = (unsigned char)(v >> (8 * i));
+  }
+
+  // RIFF, then a JUNK chunk which becomes the ds64 chunk of RF64 files, fmt and data
+  bool write_header()
+  {
+    const uint64_t data = uint64_t(m_frames) * m_channels * 4;
+    const uint64_t riff = header_size - 8 + data;
+    const bool rf64 = riff > 0xFFFFFFFFull;
+
+    unsigned char h[header_size]{};
+    std::copy_n(rf64 ? "RF64" : "RIFF", 4, h);
+    le(h + 4, rf64 ? 0xFFFFFFFFull : riff, 4);
+    std::copy_n("WAVE", 4, h + 8);
+    std::copy_n(rf64 ? "ds64" : "JUNK", 4, h + 12);
+    le(h + 16, 28, 4);
+    if (rf64)
+    {
+      le(h + 20, riff, 8);
+      le(h + 28, data, 8);
+      le(h + 36, m_frames, 8);
+    }
+
+    std::copy_n("fmt ", 4, h + 48);
+    le(h + 52, 16, 4);
+    le(h + 56, 3, 2); // IEEE float
+    le(h + 58, m_channels, 2);
+    le(h + 60, m_rate, 4);
+    le(h + 64, uint64_t(m_rate) * m_channels * 4, 4);
+    le(h + 68, m_channels * 4, 2);
+    le(h + 70, 32, 2);
+
+    std::copy_n("data", 4, h + 72);
+    le(h + 76, rf64 ? 0xFFFFFFFFull : data, 4);
+    return std::fwrite(h, 1, header_size, m_file) == header_size;
+  }
+
+  static constexpr std::size_t header_size = 80;
+
+  std::FILE* m_file{};
+  std::vector<unsigned char> m_bytes;
+  int64_t m_frames{};
+  int32_t m_channels{};
+  uint32_t m_rate{};
+};
+
+/**
+ * Records a soundfile without touching the disk from the audio thread.
+ *
+ * write() copies the frames in a ring buffer of each channel, which a writer
+ * thread empties by large chunks into the file. The frames which do not fit
+ * when the disk does not keep up are dropped and counted. Files are created
+ * and finished by the writer thread, in the order open() was called.
+ */
+class recorded_soundfile
+{
+public:
+  using creator = std::unique_ptr<soundfile_sink> (*)(const std::string&, int32_t, double);
+
+  static constexpr int64_t default_ring_frames = 1 << 17;
+
+  explicit recorded_soundfile(
+      int32_t channels, int64_t ring_frames = default_ring_frames,
+      creator create = &wav_soundfile_sink::create)
+      : m_create{create}
+      , m_channels{std::max(channels, 1)}
+  {
+    while (m_capacity < ring_frames)
+      m_capacity *= 2;
+    m_chunk = std::min<int64_t>(write_chunk, m_capacity / 4);
+    m_samples.resize(m_channels * m_capacity);
+    m_pointers.resize(m_channels);
+    m_writer = std::thread{[this] { run(); }};
+  }
+
+  recorded_soundfile(const recorded_soundfile&) = delete;
+  recorded_soundfile& operator=(const recorded_soundfile&) = delete;
+
+  // Writes what is left and finishes the current file
+  ~recorded_soundfile()
+  {
+    m_stop.store(true, std::memory_order_release);
+    wake();
+    m_writer.join();
+  }
+
+  // Outside of the audio thread: the sample rate of the next files
+  void prepare(double rate) noexcept { m_rate = rate; }
+
+  // Realtime-safe: the file is created by the writer thread.
+  // An empty path finishes the current file. Ignored when the writer
+  // has not yet handled the previous requests.
+  void open(std::string_view path) noexcept
+  {
+    file_request req;
+    req.size = std::min(path.size(), req.path.size());
+    std::copy_n(path.data(), req.size, req.path.data());
+    req.at = m_write;
+    req.serial = m_serial + 1;
+    req.rate = m_rate;
+    if (!m_requests.push(req))
+      return;
+
+    m_serial++;
+    m_recording = req.size > 0;
+    m_frames = 0;
+    m_dropped = 0;
+    wake();
+  }
+
+  // Realtime-safe. in must have a pointer for each channel.
+  int64_t write(const float* const* in, int64_t frames) noexcept
+  {
+    if (!m_recording || frames <= 0)
+      return 0;
+
+    const int64_t queued = int64_t(m_write - m_read.load(std::memory_order_acquire));
+    const int64_t n = std::min(frames, m_capacity - queued);
+    const int64_t offset = int64_t(m_write & uint64_t(m_capacity - 1));
+    const int64_t first = std::min(n, m_capacity - offset);
+    for (int c = 0; c < m_channels; c++)
+    {
+      float* ring = m_samples.data() + c * m_capacity;
+      std::copy_n(in[c], first, ring + offset);
+      std::copy_n(in[c] + first, n - first, ring);
+    }
+
+    m_write += n;
+    m_written.store(m_write, std::memory_order_release);
+    m_frames += n;
+    m_dropped += frames - n;
+
+    // The writer only wakes up for whole chunks
+    if (m_write - m_woken >= uint64_t(m_chunk))
+    {
+      m_woken = m_write;
+      wake();
+    }
+    return n;
+  }
+
+  // To be called by the audio thread before each buffer
+  template <typename View>
+  void update(View& view) noexcept
+  {
+    view.stream = this;
+    view.write = &write_frames;
+    view.open = &open_file;
+    view.channels = m_channels;
+    view.frames = m_frames;
+    view.dropped = m_dropped;
+    view.recording = m_recording;
+    view.error = m_failed.load(std::memory_order_relaxed) == m_serial;
+  }
+
+  static int64_t
+  write_frames(void* stream, const float* const* in, int64_t frames) noexcept
+  {
+    return static_cast<recorded_soundfile*>(stream)->write(in, frames);
+  }
+
+  static void open_file(void* stream, std::string_view path) noexcept
+  {
+    static_cast<recorded_soundfile*>(stream)->open(path);
+  }
+
+private:
+  struct file_request
+  {
+    std::array<char, 4096> path{};
+    std::size_t size{};
+
+    // Frames written before the request, which go to the previous file
+    uint64_t at{};
+    uint32_t serial{};
+    double rate{};
+  };
+
+  void wake() noexcept
+  {
+    m_wakeups.fetch_add(1, std::memory_order_release);
+    m_wakeups.notify_one();
+  }
+
+  void run()
+  {
+    uint32_t seen = 0;
+    for (;;)
+    {
+      const bool stop = m_stop.load(std::memory_order_acquire);
+
+      // Requests made after this would be after these frames too
+      const uint64_t end = m_written.load(std::memory_order_acquire);
+      if (auto* req = m_requests.front())
+      {
+        drain(req->at, true);
+        switch_file(*req);
+        m_requests.pop();
+        continue;
+      }
+
+      drain(end, stop);
+      if (stop)
+        break;
+
+      m_wakeups.wait(seen, std::memory_order_acquire);
+      seen = m_wakeups.load(std::memory_order_acquire);
+    }
+
+    if (m_sink)
+      m_sink->finalize();
+  }
+
+  void switch_file(const file_request& req)
+  {
+    if (m_sink && !m_sink->finalize())
+      m_failed.store(m_current, std::memory_order_relaxed);
+    m_sink.reset();
+
+    m_current = req.serial;
+    if (req.size > 0)
+    {
+      m_sink = m_create(std::string{req.path.data(), req.size}, m_channels, req.rate);
+      if (!m_sink)
+        m_failed.store(m_current, std::memory_order_relaxed);
+    }
+  }
+
+  // Writes the frames up to end: by whole chunks, unless all of them are needed
+  void drain(uint64_t end, bool all)
+  {
+    uint64_t r = m_read.load(std::memory_order_relaxed);
+    while (end - r >= uint64_t(m_chunk) || (all && end > r))
+    {
+      const int64_t offset = int64_t(r & uint64_t(m_capacity - 1));
+      const int64_t n = std::min({int64_t(end - r), m_chunk, m_capacity - offset});
+      for (int c = 0; c < m_channels; c++)
+        m_pointers[c] = m_samples.data() + c * m_capacity + offset;
+
+      // Without a file, e.g. when it could not be created, the frames are discarded
+      if (m_sink && !m_sink->write(m_pointers.data(), n))
+      {
+        m_failed.store(m_current, std::memory_order_relaxed);
+        m_sink.reset();
+      }
+
+      r += n;
+      m_read.store(r, std::memory_order_release);
+    }
+  }
+
+  static constexpr int64_t write_chunk = 16384;
+
+  creator m_create{};
+  int32_t m_channels{};
+  int64_t m_capacity{256};
+  int64_t m_chunk{write_chunk};
+  double m_rate{48000.};
+
+  // Channel c is in m_samples[c * capacity; (c + 1) * capacity[,
+  // frame f at f % capacity.
+  std::vector<float> m_samples;
+
+  std::thread m_writer;
+  std::atomic_bool m_stop{false};
+  std::atomic<uint32_t> m_wakeups{0};
+  spsc_queue<file_request, 4> m_requests;
+
+  alignas(64) std::atomic<uint64_t> m_written{0};
+  alignas(64) std::atomic<uint64_t> m_read{0};
+  std::atomic<uint32_t> m_failed{~0u};
+
+  // Audio thread only
+  uint64_t m_write{};
+  uint64_t m_woken{};
+  uint32_t m_serial{};
+  int64_t m_frames{};
+  int64_t m_dropped{};
+  bool m_recording{};
+
+  // Writer thread only
+  std::unique_ptr<soundfile_sink> m_sink;
+  std::vector<float*> m_pointers;
+  uint32_t m_current{};
+};
+
+template <typename Field>
+constexpr int32_t soundfile_recorder_channels() noexcept
+{
+  if constexpr (requires { Field::channels(); })
+    return Field::channels();
+  else
+    return 2;
+}
+
+template <typename Field>
+constexpr int64_t soundfile_ring_frames() noexcept
+{
+  if constexpr (requires { Field::ring_frames(); })
+    return Field::ring_frames();
+  else
+    return recorded_soundfile::default_ring_frames;
+}
+
+template <typename T>
+struct soundfile_recorder_storage
+{
+  static constexpr void init(avnd::effect_container<T>&, double) noexcept { }
+  static constexpr void update(avnd::effect_container<T>&) noexcept { }
+};
+
+/**
+ * Used to record the soundfiles of soundfile_recorder_port outputs
+ */
+template <typename T>
+requires(soundfile_recorder_output_introspection<T>::size > 0)
+struct soundfile_recorder_storage<T>
+{
+  using sf_out = soundfile_recorder_output_introspection<T>;
+
+  std::array<std::unique_ptr<recorded_soundfile>, sf_out::size> recorders;
+
+  void init(avnd::effect_container<T>& t, double rate)
+  {
+    sf_out::for_all_n(
+        avnd::get_outputs(t),
+        [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          if (!recorders[Idx])
+            recorders[Idx] = std::make_unique<recorded_soundfile>(
+                soundfile_recorder_channels<M>(), soundfile_ring_frames<M>());
+          recorders[Idx]->prepare(rate);
+          recorders[Idx]->update(port.soundfile);
+        });
+  }
+
+  // Realtime-safe. N is the index of the port among the recorded soundfiles.
+  void open(int n, std::string_view path) noexcept
+  {
+    if (n >= 0 && n < int(sf_out::size) && recorders[n])
+      recorders[n]->open(path);
+  }
+
+  void update(avnd::effect_container<T>& t) noexcept
+  {
+    sf_out::for_all_n(
+        avnd::get_outputs(t),
+        [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          recorders[Idx]->update(port.soundfile);
+        });
+  }
+};
+}
@@ -7,8 +7,13 @@
 #include <avnd/introspection/input.hpp>
 #include <avnd/introspection/output.hpp>
 #include <avnd/introspection/port.hpp>
+#include <avnd/wrappers/mapped_soundfile.hpp>
 #include <boost/mp11.hpp>
 
+#include <array>
+#include <memory>
+#include <string>
+
 namespace avnd
 {
 // Field: struct { struct { float** data; } soundfile; }
@@ -36,6 +41,10 @@ struct soundfile_input_storage<T>
   using vectors = boost::mp11::mp_transform<std::vector, tuple>;
 
   [[no_unique_address]] vectors soundfiles;
+
+  // Soundfiles mapped from the disk, see soundfile_storage::load
+  std::array<std::shared_ptr<const mapped_soundfile>, soundfile_input_introspection<T>::size>
+      mapped;
 };
 
 
@@ -52,7 +61,7 @@ struct soundfile_storage
   {
     if constexpr (sf_in::size > 0)
     {
-      auto init_raw_in = [&]<auto Idx, typename M>(M & port, avnd::num<Idx>)
+      auto init_raw_in = [&]<auto Idx, typename M>(M & port, avnd::predicate_index<Idx>)
       {
         // Get the matching buffer in our storage, a std::vector<timed_value>
         auto& buf = std::get<Idx>(this->soundfiles);
@@ -69,6 +78,37 @@ struct soundfile_storage
       sf_in::for_all_n(avnd::get_inputs(t), init_raw_in);
     }
   }
+
+  /**
+   * Maps a soundfile for the N-th soundfile input, an empty path unloads it.
+   * Not realtime-safe: to be called while the processor is not running.
+   */
+  bool load(
+      avnd::effect_container<T>& t, int n, const std::string& path,
+      const std::string& cache_directory)
+  {
+    if constexpr (sf_in::size > 0)
+    {
+      if (n < 0 || n >= int(sf_in::size))
+        return false;
+
+      auto file = path.empty() ? nullptr : mapped_soundfile::open(path, cache_directory);
+      sf_in::for_all_n(
+          avnd::get_inputs(t), [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+            if (Idx != n)
+              return;
+            if (file)
+              file->assign(port.soundfile);
+            else
+              port.soundfile = {};
+          });
+
+      // Released after the ports stopped pointing to it
+      this->mapped[n] = std::move(file);
+      return this->mapped[n] || path.empty();
+    }
+    return false;
+  }
 };
 
 }
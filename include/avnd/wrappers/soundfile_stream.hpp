@@ -0,0 +1,519 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/triple_buffer.hpp>
+#include <avnd/concepts/soundfile.hpp>
+#include <avnd/introspection/input.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace avnd
+{
+/**
+ * Decoder used by streamed_soundfile, called only from its reader thread.
+ */
+class soundfile_source
+{
+public:
+  virtual ~soundfile_source() = default;
+
+  virtual int32_t channels() const noexcept = 0;
+  virtual int64_t frames() const noexcept = 0;
+
+  // Reads the frames [first; first + count[ in out[channel].
+  // Returns the number of frames read.
+  virtual int64_t read(int64_t first, int64_t count, float* const* out) = 0;
+};
+
+/**
+ * Reads PCM (8, 16, 24, 32 bits) and floating-point (32, 64 bits) WAVE files.
+ */
+class wav_soundfile_source final : public soundfile_source
+{
+public:
+  static std::unique_ptr<wav_soundfile_source> open_wav(const std::string& path)
+  {
+    auto src = std::unique_ptr<wav_soundfile_source>(new wav_soundfile_source);
+    if (!src->parse(path))
+      return {};
+    return src;
+  }
+
+  static std::unique_ptr<soundfile_source> open(const std::string& path)
+  {
+    return open_wav(path);
+  }
+
+  int32_t channels() const noexcept override { return m_channels; }
+  int64_t frames() const noexcept override { return m_frames; }
+  double sample_rate() const noexcept { return m_rate; }
+
+  // Samples stored as 32-bit floats, from data_offset() in the file
+  bool float32() const noexcept { return m_float && m_bits == 32; }
+  int64_t data_offset() const noexcept { return m_data_offset; }
+
+  int64_t read(int64_t first, int64_t count, float* const* out) override
+  {
+    count = std::clamp<int64_t>(std::min(count, m_frames - first), 0, m_frames);
+    if (count == 0)
+      return 0;
+
+    m_bytes.resize(count * m_block_align);
+    m_file.clear();
+    m_file.seekg(m_data_offset + first * m_block_align);
+    m_file.read(m_bytes.data(), m_bytes.size());
+    count = m_file.gcount() / m_block_align;
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(m_bytes.data());
+    const int width = m_bits / 8;
+    for (int64_t i = 0; i < count; i++)
+      for (int c = 0; c < m_channels; c++)
+        out[c][i] = decode(bytes + i * m_block_align + c * width);
+    return count;
+  }
+
+private:
+  wav_soundfile_source() = default;
+
+  static uint32_t le(const unsigned char* p, int bytes) noexcept
+  {
+    uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+      v = (v << 8) | p[i];
+    return v;
+  }
+
+  float decode(const unsigned char* p) const noexcept
+  {
+    if (m_float)
+    {
+      if (m_bits == 32)
+      {
+        const uint32_t v = le(p, 4);
+        float f;
+        std::memcpy(&f, &v, 4);
+        return f;
+      }
+      const uint64_t v = uint64_t(le(p, 4)) | (uint64_t(le(p + 4, 4)) << 32);
+      double d;
+      std::memcpy(&d, &v, 8);
+      return float(d);
+    }
+
+    switch (m_bits)
+    {
+      case 8:
+        return (int(p[0]) - 128) / 128.f;
+      case 16:
+        return int16_t(le(p, 2)) / 32768.f;
+      case 24:
+        return int32_t(le(p, 3) << 8) / 2147483648.f;
+      default:
+        return int32_t(le(p, 4)) / 2147483648.f;
+    }
+  }
+
+  bool parse(const std::string& path)
+  {
+    m_file.open(path, std::ios::binary);
+    if (!m_file)
+      return false;
+
+    unsigned char header[12];
+    if (!m_file.read(reinterpret_cast<char*>(header), 12)
+        || std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0)
+      return false;
+
+    bool has_format = false;
+    unsigned char chunk[8];
+    while (m_file.read(reinterpret_cast<char*>(chunk), 8))
+    {
+      const uint32_t size = le(chunk + 4, 4);
+      const std::streamoff start = m_file.tellg();
+      if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+      {
+        unsigned char fmt[40]{};
+        m_file.read(reinterpret_cast<char*>(fmt), std::min<uint32_t>(size, 40));
+        uint32_t tag = le(fmt, 2);
+        if (tag == 0xFFFE && size >= 26) // WAVE_FORMAT_EXTENSIBLE: sub-format GUID
+          tag = le(fmt + 24, 2);
+
+        m_channels = int32_t(le(fmt + 2, 2));
+        m_rate = le(fmt + 4, 4);
+        m_block_align = int32_t(le(fmt + 12, 2));
+        m_bits = int32_t(le(fmt + 14, 2));
+        m_float = tag == 3;
+        has_format = (tag == 1 && (m_bits == 8 || m_bits == 16 || m_bits == 24 || m_bits == 32))
+                     || (tag == 3 && (m_bits == 32 || m_bits == 64));
+      }
+      else if (std::memcmp(chunk, "data", 4) == 0)
+      {
+        if (!has_format || m_channels <= 0 || m_block_align != m_channels * m_bits / 8)
+          return false;
+        m_data_offset = start;
+        m_frames = size / m_block_align;
+        return true;
+      }
+
+      // Chunks are padded to an even size
+      m_file.seekg(start + std::streamoff(size) + (size & 1));
+    }
+    return false;
+  }
+
+  std::ifstream m_file;
+  std::vector<char> m_bytes;
+  std::streamoff m_data_offset{};
+  int64_t m_frames{};
+  int32_t m_channels{};
+  int32_t m_block_align{};
+  int32_t m_bits{};
+  double m_rate{};
+  bool m_float{};
+};
+
+/**
+ * Plays a soundfile without loading it in memory.
+ *
+ * A reader thread keeps a window of frames of each channel around the playback
+ * position given by play_from(): the frames behind it are recycled for the ones
+ * after the end of the window. Jumping out of the window restarts it from there.
+ *
+ * The audio thread never blocks: read() gets what is in memory, and
+ * detects the frames overwritten by the reader while it copied them.
+ */
+class streamed_soundfile
+{
+public:
+  using opener = std::unique_ptr<soundfile_source> (*)(const std::string&);
+
+  static constexpr int64_t default_window_frames = 1 << 18;
+
+  explicit streamed_soundfile(
+      int64_t window_frames = default_window_frames,
+      opener open = &wav_soundfile_source::open)
+      : m_open{open}
+  {
+    while (m_capacity < window_frames)
+      m_capacity *= 2;
+    m_reader = std::thread{[this] { run(); }};
+  }
+
+  streamed_soundfile(const streamed_soundfile&) = delete;
+  streamed_soundfile& operator=(const streamed_soundfile&) = delete;
+
+  ~streamed_soundfile()
+  {
+    m_stop.store(true, std::memory_order_release);
+    wake();
+    m_reader.join();
+    delete m_current.load();
+  }
+
+  // Realtime-safe: the file is opened by the reader thread.
+  // An empty path closes the current file.
+  void open(std::string_view path) noexcept
+  {
+    auto& req = m_requests.write_buffer();
+    req.size = std::min(path.size(), req.path.size());
+    std::copy_n(path.data(), req.size, req.path.data());
+    m_requests.publish();
+    wake();
+  }
+
+  // To be called by the audio thread before each buffer:
+  // points the view to the file currently opened.
+  template <typename View>
+  void update(View& view) noexcept
+  {
+    // Marks the window as used before the reader can free it
+    window* w = m_current.load(std::memory_order_seq_cst);
+    window* prev = m_in_use.exchange(w, std::memory_order_seq_cst);
+    while (w != m_current.load(std::memory_order_seq_cst))
+    {
+      w = m_current.load(std::memory_order_seq_cst);
+      m_in_use.store(w, std::memory_order_seq_cst);
+    }
+
+    // Lets the reader free the previous one
+    if (w != prev)
+      wake();
+
+    view.stream = w;
+    view.read = &read;
+    view.play_from = &play_from;
+    view.frames = w ? w->frames : 0;
+    view.channels = w ? w->channels : 0;
+    view.filename = w ? std::string_view{w->filename} : std::string_view{};
+  }
+
+  static int64_t
+  read(void* stream, int32_t channel, int64_t frame, float* out, int64_t count) noexcept
+  {
+    auto* w = static_cast<window*>(stream);
+    if (count <= 0)
+      return 0;
+    if (!w || channel < 0 || channel >= w->channels)
+    {
+      std::fill_n(out, count, 0.f);
+      return 0;
+    }
+
+    const uint32_t seeks = w->seeks.load(std::memory_order_acquire);
+    const int64_t b = w->begin.load(std::memory_order_acquire);
+    const int64_t e = w->end.load(std::memory_order_acquire);
+    int64_t n = 0;
+    if (frame >= b && frame < e)
+    {
+      n = std::min(count, e - frame);
+      const float* ring = w->samples.data() + channel * w->capacity;
+      const int64_t offset = frame & (w->capacity - 1);
+      const int64_t first = std::min(n, w->capacity - offset);
+      std::copy_n(ring + offset, first, out);
+      std::copy_n(ring, n - first, out + first);
+
+      // The reader may have started recycling or restarting the window meanwhile
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (w->seeks.load(std::memory_order_relaxed) != seeks
+          || w->begin.load(std::memory_order_relaxed) > frame)
+        n = 0;
+    }
+
+    std::fill(out + n, out + count, 0.f);
+    return n;
+  }
+
+  static void play_from(void* stream, int64_t frame) noexcept
+  {
+    auto* w = static_cast<window*>(stream);
+    if (!w)
+      return;
+
+    w->position.store(frame, std::memory_order_relaxed);
+
+    const int64_t b = w->begin.load(std::memory_order_relaxed);
+    const int64_t e = w->end.load(std::memory_order_relaxed);
+    const bool outside = frame < b || frame > e;
+    const bool low = e < w->frames && e - frame < w->capacity / 2;
+    if ((outside || low) && !w->pending.exchange(true, std::memory_order_acq_rel))
+      w->owner->wake();
+  }
+
+private:
+  struct path_request
+  {
+    std::array<char, 4096> path{};
+    std::size_t size{};
+  };
+
+  struct window
+  {
+    streamed_soundfile* owner{};
+    std::unique_ptr<soundfile_source> source;
+    std::string filename;
+    int64_t frames{};
+    int32_t channels{};
+
+    // Channel c is in samples[c * capacity; (c + 1) * capacity[,
+    // frame f at f % capacity.
+    int64_t capacity{};
+    std::vector<float> samples;
+
+    // Frames in memory
+    std::atomic<int64_t> begin{0};
+    std::atomic<int64_t> end{0};
+
+    // Incremented when the window restarts elsewhere
+    std::atomic<uint32_t> seeks{0};
+
+    // Set by the audio thread
+    std::atomic<int64_t> position{0};
+    std::atomic_bool pending{false};
+  };
+
+  void wake() noexcept
+  {
+    m_wakeups.fetch_add(1, std::memory_order_release);
+    m_wakeups.notify_one();
+  }
+
+  void run()
+  {
+    uint32_t seen = 0;
+    while (!m_stop.load(std::memory_order_acquire))
+    {
+      if (m_requests.consume())
+        open_requested(m_requests.read_buffer());
+
+      if (auto* w = m_current.load(std::memory_order_acquire))
+        fill(*w);
+
+      // Windows of the previous files, once the audio thread stopped using them
+      std::erase_if(m_retired, [this](const std::unique_ptr<window>& w) {
+        return m_in_use.load(std::memory_order_seq_cst) != w.get();
+      });
+
+      m_wakeups.wait(seen, std::memory_order_acquire);
+      seen = m_wakeups.load(std::memory_order_acquire);
+    }
+
+    m_retired.clear();
+  }
+
+  void open_requested(const path_request& req)
+  {
+    std::unique_ptr<window> w;
+    if (req.size > 0)
+    {
+      std::string path{req.path.data(), req.size};
+      if (auto src = m_open(path); src && src->channels() > 0)
+      {
+        w = std::make_unique<window>();
+        w->owner = this;
+        w->channels = src->channels();
+        w->frames = src->frames();
+        w->source = std::move(src);
+        w->filename = std::move(path);
+        w->capacity = m_capacity;
+        w->samples.resize(w->channels * m_capacity);
+        m_pointers.resize(w->channels);
+      }
+    }
+
+    window* old = m_current.exchange(w.release(), std::memory_order_seq_cst);
+    if (old)
+      m_retired.emplace_back(old);
+  }
+
+  void fill(window& w)
+  {
+    // Kept behind the playback position, e.g. for grains or reverse playback
+    const int64_t behind = w.capacity / 4;
+    const int64_t mask = w.capacity - 1;
+
+    while (!m_stop.load(std::memory_order_relaxed) && !m_requests.pending())
+    {
+      w.pending.store(false, std::memory_order_release);
+
+      const int64_t pos
+          = std::clamp<int64_t>(w.position.load(std::memory_order_relaxed), 0, w.frames);
+      int64_t b = w.begin.load(std::memory_order_relaxed);
+      int64_t e = w.end.load(std::memory_order_relaxed);
+
+      if (pos < b || pos > e)
+      {
+        // Restart the window: the ongoing reads will see the new seek count
+        b = e = std::max<int64_t>(pos - behind, 0);
+        w.begin.store(b, std::memory_order_relaxed);
+        w.end.store(e, std::memory_order_relaxed);
+        w.seeks.fetch_add(1, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_release);
+      }
+      else if (pos - behind > b)
+      {
+        // Recycle the frames far behind the playback position
+        b = pos - behind;
+        w.begin.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+      }
+
+      const int64_t target = std::min(b + w.capacity, w.frames);
+      if (e >= target)
+        return;
+
+      // Contiguous part of the rings
+      const int64_t n = std::min({target - e, read_chunk, w.capacity - (e & mask)});
+      for (int c = 0; c < w.channels; c++)
+        m_pointers[c] = w.samples.data() + c * w.capacity + (e & mask);
+
+      const int64_t got = w.source->read(e, n, m_pointers.data());
+      if (got <= 0)
+        return;
+      w.end.store(e + got, std::memory_order_release);
+    }
+  }
+
+  static constexpr int64_t read_chunk = 8192;
+
+  opener m_open{};
+  int64_t m_capacity{read_chunk};
+
+  std::thread m_reader;
+  std::atomic_bool m_stop{false};
+  std::atomic<uint32_t> m_wakeups{0};
+  triple_buffer<path_request> m_requests;
+
+  std::atomic<window*> m_current{};
+  std::atomic<window*> m_in_use{};
+
+  // Reader thread only
+  std::vector<std::unique_ptr<window>> m_retired;
+  std::vector<float*> m_pointers;
+};
+
+template <typename Field>
+constexpr int64_t soundfile_window_frames() noexcept
+{
+  if constexpr (requires { Field::window_frames(); })
+    return Field::window_frames();
+  else
+    return streamed_soundfile::default_window_frames;
+}
+
+template <typename T>
+struct soundfile_stream_storage
+{
+  static constexpr void init(avnd::effect_container<T>&) noexcept { }
+  static constexpr void update(avnd::effect_container<T>&) noexcept { }
+};
+
+/**
+ * Used to stream the soundfiles of soundfile_stream_port inputs
+ */
+template <typename T>
+requires(soundfile_stream_input_introspection<T>::size > 0)
+struct soundfile_stream_storage<T>
+{
+  using sf_in = soundfile_stream_input_introspection<T>;
+
+  std::array<std::unique_ptr<streamed_soundfile>, sf_in::size> streams;
+
+  void init(avnd::effect_container<T>& t)
+  {
+    sf_in::for_all_n(
+        avnd::get_inputs(t),
+        [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          if (!streams[Idx])
+            streams[Idx] = std::make_unique<streamed_soundfile>(soundfile_window_frames<M>());
+          streams[Idx]->update(port.soundfile);
+        });
+  }
+
+  // Realtime-safe. N is the index of the port among the streamed soundfiles.
+  void open(int n, std::string_view path) noexcept
+  {
+    if (n >= 0 && n < int(sf_in::size) && streams[n])
+      streams[n]->open(path);
+  }
+
+  void update(avnd::effect_container<T>& t) noexcept
+  {
+    sf_in::for_all_n(
+        avnd::get_inputs(t),
+        [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          streams[Idx]->update(port.soundfile);
+        });
+  }
+};
+}
@@ -0,0 +1,312 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/member_range.hpp>
+#include <avnd/introspection/input.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace avnd
+{
+/**
+ * Binary state of the inputs of a processor, as saved in the projects of the hosts.
+ *
+ * Layout, in the native byte order:
+ *
+ *   uint32 magic, uint32 version
+ *   then for each input parameter and soundfile:
+ *     uint32 hash of the field, uint32 size, size bytes
+ *
+ * Trivially copyable values are copied as-is, strings and soundfile paths as their
+ * characters. The hash of a field covers its name, kind and the size of its value:
+ * when loading, records are matched to the fields in order, and only looked up by
+ * hash when the layout changed, e.g. after an update of the processor added
+ * a parameter. Unknown records are skipped, fields missing from the state are
+ * left untouched.
+ *
+ * The instances of a duplicated monophonic processor share their controls:
+ * their state is the one of the first instance, whatever the channel count,
+ * and is loaded in all of them.
+ */
+struct state_format
+{
+  static constexpr uint32_t magic = 0x74736e61; // "anst"
+  static constexpr uint32_t version = 1;
+  static constexpr std::size_t header_size = 2 * sizeof(uint32_t);
+  static constexpr std::size_t record_header_size = 2 * sizeof(uint32_t);
+};
+
+template <typename V>
+concept state_string = requires(V v) {
+  v.data();
+  v.size();
+  v.resize(std::size_t{});
+} && sizeof(*std::declval<V>().data()) == 1;
+
+template <typename V>
+concept state_trivial = std::is_trivially_copyable_v<V> && !state_string<V>;
+
+template <typename C>
+concept state_parameter = requires(C c) { c.value; }
+                          && (state_trivial<std::decay_t<decltype(C::value)>>
+                              || state_string<std::decay_t<decltype(C::value)>>);
+
+namespace state_detail
+{
+constexpr uint32_t hash(std::string_view str, std::size_t size, uint32_t kind) noexcept
+{
+  // FNV-1a
+  uint32_t h = 2166136261u;
+  auto mix = [&h](uint32_t byte) {
+    h ^= byte & 0xFF;
+    h *= 16777619u;
+  };
+  for (char c : str)
+    mix(uint8_t(c));
+  for (int i = 0; i < 4; i++)
+    mix(uint32_t(size >> (8 * i)));
+  mix(kind);
+  return h;
+}
+
+template <typename C>
+constexpr uint32_t parameter_hash() noexcept
+{
+  using value_type = std::decay_t<decltype(C::value)>;
+  if constexpr (state_string<value_type>)
+    return hash(C::name(), 0, 1);
+  else
+    return hash(C::name(), sizeof(value_type), 0);
+}
+
+template <typename C>
+constexpr uint32_t soundfile_hash() noexcept
+{
+  return hash(C::name(), 0, 2);
+}
+
+inline void write_u32(char*& out, uint32_t v) noexcept
+{
+  std::memcpy(out, &v, sizeof(v));
+  out += sizeof(v);
+}
+
+inline uint32_t read_u32(const char* in) noexcept
+{
+  uint32_t v;
+  std::memcpy(&v, in, sizeof(v));
+  return v;
+}
+
+inline void write_record(char*& out, uint32_t hash, const void* data, std::size_t size) noexcept
+{
+  write_u32(out, hash);
+  write_u32(out, uint32_t(size));
+  if (size > 0)
+    std::memcpy(out, data, size);
+  out += size;
+}
+
+// Calls f(hash, [](const char* data, uint32 size) { ... }) for each field of the state
+template <typename T, typename F>
+void for_each_field(auto& inputs, F&& f)
+{
+  parameter_input_introspection<T>::for_all(inputs, [&]<typename C>(C& field) {
+    if constexpr (state_parameter<C>)
+    {
+      using value_type = std::decay_t<decltype(field.value)>;
+      f(parameter_hash<C>(), [&](const char* data, uint32_t size) {
+        if constexpr (state_string<value_type>)
+        {
+          field.value.resize(size);
+          if (size > 0)
+            std::memcpy(field.value.data(), data, size);
+        }
+        else if (size == sizeof(value_type))
+        {
+          std::memcpy(&field.value, data, size);
+        }
+      });
+    }
+  });
+}
+}
+
+/**
+ * Size of the state of the inputs, to allocate the buffer for save_state.
+ */
+template <typename T>
+std::size_t state_size(auto&& inputs) noexcept
+{
+  std::size_t size = state_format::header_size;
+  parameter_input_introspection<T>::for_all(inputs, [&]<typename C>(const C& field) {
+    if constexpr (state_parameter<C>)
+    {
+      size += state_format::record_header_size;
+      if constexpr (state_string<std::decay_t<decltype(field.value)>>)
+        size += field.value.size();
+      else
+        size += sizeof(field.value);
+    }
+  });
+  soundfile_input_introspection<T>::for_all(inputs, [&]<typename C>(const C& field) {
+    size += state_format::record_header_size + std::string_view{field.soundfile.filename}.size();
+  });
+  return size;
+}
+
+/**
+ * Writes the state of the inputs in buffer, which is resized but allocated only
+ * when it got too small: bindings can keep it around from one save to the next.
+ */
+template <typename T>
+void save_state(auto&& inputs, std::vector<char>& buffer)
+{
+  buffer.resize(state_size<T>(inputs));
+  char* out = buffer.data();
+
+  state_detail::write_u32(out, state_format::magic);
+  state_detail::write_u32(out, state_format::version);
+
+  parameter_input_introspection<T>::for_all(inputs, [&]<typename C>(const C& field) {
+    if constexpr (state_parameter<C>)
+    {
+      if constexpr (state_string<std::decay_t<decltype(field.value)>>)
+        state_detail::write_record(
+            out, state_detail::parameter_hash<C>(), field.value.data(), field.value.size());
+      else
+        state_detail::write_record(
+            out, state_detail::parameter_hash<C>(), &field.value, sizeof(field.value));
+    }
+  });
+  soundfile_input_introspection<T>::for_all(inputs, [&]<typename C>(const C& field) {
+    const std::string_view path = field.soundfile.filename;
+    state_detail::write_record(out, state_detail::soundfile_hash<C>(), path.data(), path.size());
+  });
+}
+
+/**
+ * Whether data starts like a state written by save_state,
+ * so that bindings can still read the formats they used before.
+ */
+inline bool is_state(const char* data, std::size_t size) noexcept
+{
+  return size >= state_format::header_size
+         && state_detail::read_u32(data) == state_format::magic;
+}
+
+/**
+ * Restores the inputs from a state written by save_state.
+ * Soundfiles have to be loaded by the binding: on_soundfile(index, path) is called
+ * with the index of the soundfile in the soundfile inputs and the path it had.
+ * Not realtime-safe.
+ */
+template <typename T>
+bool load_state(
+    auto&& inputs, const char* data, std::size_t size, auto&& on_soundfile)
+{
+  if (!is_state(data, size) || state_detail::read_u32(data + 4) > state_format::version)
+    return false;
+
+  // The records, in the order in which they were saved
+  struct record
+  {
+    uint32_t hash;
+    uint32_t size;
+    const char* data;
+  };
+
+  const char* in = data + state_format::header_size;
+  const char* const end = data + size;
+
+  auto next_record = [&](record& r) -> bool {
+    if (std::size_t(end - in) < state_format::record_header_size)
+      return false;
+    r.hash = state_detail::read_u32(in);
+    r.size = state_detail::read_u32(in + 4);
+    r.data = in + state_format::record_header_size;
+    if (r.size > std::size_t(end - r.data))
+      return false;
+    in = r.data + r.size;
+    return true;
+  };
+
+  // Looks for the record of a field, first at the current position
+  auto find = [&](uint32_t hash, record& r) -> bool {
+    const char* current = in;
+    if (next_record(r) && r.hash == hash)
+      return true;
+
+    in = data + state_format::header_size;
+    while (next_record(r))
+      if (r.hash == hash)
+        return true;
+
+    in = current;
+    return false;
+  };
+
+  state_detail::for_each_field<T>(inputs, [&](uint32_t hash, auto&& assign) {
+    if (record r; find(hash, r))
+      assign(r.data, r.size);
+  });
+
+  int k = 0;
+  soundfile_input_introspection<T>::for_all(inputs, [&]<typename C>(C& field) {
+    if (record r; find(state_detail::soundfile_hash<C>(), r))
+      on_soundfile(k, std::string_view{r.data, r.size});
+    k++;
+  });
+
+  return true;
+}
+
+template <typename T>
+std::size_t state_size(instance_range auto&& inputs) noexcept
+{
+  for (auto& first : inputs)
+    return state_size<T>(first);
+  return state_format::header_size;
+}
+
+template <typename T>
+void save_state(instance_range auto&& inputs, std::vector<char>& buffer)
+{
+  for (auto& first : inputs)
+    return save_state<T>(first, buffer);
+
+  buffer.resize(state_format::header_size);
+  char* out = buffer.data();
+  state_detail::write_u32(out, state_format::magic);
+  state_detail::write_u32(out, state_format::version);
+}
+
+template <typename T>
+bool load_state(
+    instance_range auto&& inputs, const char* data, std::size_t size,
+    auto&& on_soundfile)
+{
+  // The soundfiles are shared too: they are reported once
+  bool first = true;
+  for (auto& instance : inputs)
+  {
+    if (first && !load_state<T>(instance, data, size, on_soundfile))
+      return false;
+    else if (!first)
+      load_state<T>(instance, data, size, [](int, std::string_view) {});
+    first = false;
+  }
+  return true;
+}
+
+template <typename T>
+bool load_state(auto&& inputs, const char* data, std::size_t size)
+{
+  return load_state<T>(inputs, data, size, [](int, std::string_view) {});
+}
+}
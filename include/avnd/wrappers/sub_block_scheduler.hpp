@@ -0,0 +1,149 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/span_polyfill.hpp>
+#include <avnd/concepts/processor.hpp>
+#include <avnd/introspection/input.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace avnd
+{
+/**
+ * Processors whose controls are not sample-accurate get their buffers split
+ * where controls change, so that they still follow the changes within a buffer.
+ *
+ * MIDI timestamps are relative to the whole buffer, and sample-accurate inputs
+ * already get the timing of every change, thus we do not split in these cases.
+ */
+template <typename T>
+inline constexpr bool splits_on_control_changes
+    = (avnd::float_processor<T> || avnd::double_processor<T>)
+      && parameter_input_introspection<T>::size > 0
+      && linear_timed_parameter_input_introspection<T>::size == 0
+      && span_timed_parameter_input_introspection<T>::size == 0
+      && dynamic_timed_parameter_input_introspection<T>::size == 0
+      && midi_input_introspection<T>::size == 0;
+
+inline constexpr int default_control_granularity = 16;
+
+/**
+ * Processors choose the smallest sub-blocks their buffers can get split in,
+ * from 1 for sample-accurate changes to larger values which save CPU:
+ *
+ * static constexpr int control_granularity = 32;
+ * or halp_meta(control_granularity, 32)
+ */
+template <typename T>
+constexpr int control_granularity() noexcept
+{
+  if constexpr (requires { int(T::control_granularity()); })
+    return T::control_granularity();
+  else if constexpr (requires { int(T::control_granularity); })
+    return T::control_granularity;
+  else
+    return default_control_granularity;
+}
+
+/**
+ * Collects the timed control changes of a buffer, and then calls the processor
+ * on the sub-blocks between these changes.
+ *
+ * Change is whatever the binding needs to apply a change, e.g. a parameter id and a value.
+ */
+template <typename Change>
+class sub_block_scheduler
+{
+public:
+  static constexpr int default_granularity = default_control_granularity;
+
+  void reserve(std::size_t changes) { m_changes.reserve(changes); }
+  void release() noexcept { m_changes = {}; }
+
+  // Sub-blocks start on multiples of the granularity (apart from the block end):
+  // a change is applied at the beginning of the sub-block it falls in.
+  // A granularity of 1 gives sample-accurate changes, larger ones save CPU.
+  void set_granularity(int frames) noexcept { m_granularity = std::max(frames, 1); }
+  int granularity() const noexcept { return m_granularity; }
+
+  bool empty() const noexcept { return m_changes.empty(); }
+  void clear() noexcept { m_changes.clear(); }
+
+  void push(int frame, const Change& change)
+  {
+    const int order = int(m_changes.size());
+    m_changes.push_back({std::max(frame, 0), order, change});
+  }
+
+  // Calls apply(change) for each change, and process(first_frame, frames)
+  // for each sub-block of [0; frames[ between changes.
+  template <typename Apply, typename Process>
+  void run(int frames, Apply&& apply, Process&& process)
+  {
+    // By frame, then by order of arrival: for a given control the last change wins
+    std::sort(
+        m_changes.begin(),
+        m_changes.end(),
+        [g = m_granularity](const entry& lhs, const entry& rhs) noexcept {
+          const int lf = lhs.frame / g, rf = rhs.frame / g;
+          return lf < rf || (lf == rf && lhs.order < rhs.order);
+        });
+
+    const std::size_t n = m_changes.size();
+    std::size_t i = 0;
+    int pos = 0;
+    while (pos < frames)
+    {
+      for (; i < n && quantize(m_changes[i].frame) <= pos; i++)
+        apply(std::as_const(m_changes[i].change));
+
+      const int next = i < n ? std::min(quantize(m_changes[i].frame), frames) : frames;
+      process(pos, next - pos);
+      pos = next;
+    }
+
+    // Changes past the end of the buffer, or everything if there was nothing to process
+    for (; i < n; i++)
+      apply(std::as_const(m_changes[i].change));
+
+    m_changes.clear();
+  }
+
+  // Applies all the changes in order, without processing
+  template <typename Apply>
+  void flush(Apply&& apply)
+  {
+    run(0, apply, [](int, int) {});
+  }
+
+private:
+  int quantize(int frame) const noexcept { return frame - frame % m_granularity; }
+
+  struct entry
+  {
+    int frame{};
+    int order{};
+    Change change;
+  };
+
+  std::vector<entry> m_changes;
+  int m_granularity{default_granularity};
+};
+
+/**
+ * Points the channels to the beginning of a sub-block.
+ * storage must have room for channels.size() pointers.
+ */
+template <typename FP>
+avnd::span<FP*>
+sub_block_channels(avnd::span<FP*> channels, int first, FP** storage) noexcept
+{
+  for (std::size_t c = 0; c < channels.size(); c++)
+    storage[c] = channels[c] ? channels[c] + first : nullptr;
+  return {storage, channels.size()};
+}
+}
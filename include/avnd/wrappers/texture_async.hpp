@@ -0,0 +1,129 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/gfx.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/texture_tiles.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace avnd
+{
+/**
+ * Texture processors which declare halp_flag(asynchronous_textures) are run
+ * on a worker thread instead of the render thread, which thus never waits for them:
+ *
+ * - once the processor is idle, its outputs hold the frame it last generated;
+ *   the host uploads it, which becomes the front buffer shown on screen,
+ *   writes the inputs of the next frame, and starts it;
+ * - the processor then writes the next frame in its own memory, the back buffer,
+ *   and sets the changed flag of its outputs as usual;
+ * - the host does not touch the processor until it is idle again.
+ *
+ * The frames are thus shown one frame later than they were asked for.
+ */
+template <typename T>
+concept asynchronous_texture_generator = requires { T::asynchronous_textures; };
+
+// Generates the next frame of all the instances
+template <typename T>
+void run_texture_generator(avnd::effect_container<T>& t)
+{
+  for (auto& e : t.effects())
+  {
+    if constexpr (tiled_texture_processor<T>)
+      run_texture_tiles(e);
+    else
+      e();
+  }
+}
+
+template <typename T>
+class texture_generation
+{
+public:
+  explicit texture_generation(avnd::effect_container<T>& t) noexcept
+      : m_impl{t}
+  {
+  }
+
+  // Render thread: always idle, the frame is generated by start()
+  bool idle() const noexcept { return true; }
+  void start() { run_texture_generator(m_impl); }
+
+private:
+  avnd::effect_container<T>& m_impl;
+};
+
+template <typename T>
+  requires asynchronous_texture_generator<T>
+class texture_generation<T>
+{
+public:
+  explicit texture_generation(avnd::effect_container<T>& t)
+      : m_impl{t}
+      , m_thread{[this] { work(); }}
+  {
+  }
+
+  texture_generation(const texture_generation&) = delete;
+  texture_generation& operator=(const texture_generation&) = delete;
+
+  ~texture_generation()
+  {
+    m_state.store(stopping, std::memory_order_release);
+    m_state.notify_one();
+    m_thread.join();
+  }
+
+  // Render thread: whether the outputs hold a finished frame and the inputs can be written
+  bool idle() const noexcept
+  {
+    return m_state.load(std::memory_order_acquire) == waiting;
+  }
+
+  // Render thread, once idle: generates the next frame on the worker thread
+  void start() noexcept
+  {
+    m_state.store(running, std::memory_order_release);
+    m_state.notify_one();
+  }
+
+  // Number of frames generated so far
+  uint64_t frames() const noexcept { return m_frames.load(std::memory_order_relaxed); }
+
+private:
+  enum state : uint8_t
+  {
+    waiting,
+    running,
+    stopping
+  };
+
+  void work()
+  {
+    for (;;)
+    {
+      m_state.wait(waiting, std::memory_order_acquire);
+      if (m_state.load(std::memory_order_acquire) == stopping)
+        return;
+
+      run_texture_generator(m_impl);
+      m_frames.fetch_add(1, std::memory_order_relaxed);
+
+      // Publishes the frame, unless the host is going away meanwhile
+      auto expected = running;
+      if (!m_state.compare_exchange_strong(expected, waiting, std::memory_order_acq_rel))
+        return;
+    }
+  }
+
+  avnd::effect_container<T>& m_impl;
+  std::atomic<state> m_state{waiting};
+  std::atomic<uint64_t> m_frames{};
+  std::thread m_thread;
+};
+}
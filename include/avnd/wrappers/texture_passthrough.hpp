@@ -0,0 +1,96 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/texture_access.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <cstdint>
+
+namespace avnd
+{
+/**
+ * What GPU hosts need to keep the textures of CPU processors on the GPU:
+ * the textures of the inputs are read back only when the processor
+ * needs their pixels, and the outputs which forward an input are passed on
+ * as they are instead of being uploaded.
+ */
+template <typename Field>
+constexpr texture_access texture_access_of() noexcept
+{
+  if constexpr (requires { texture_access(Field::texture_access()); })
+    return Field::texture_access();
+  else
+    return texture_access::pixels;
+}
+
+// Whether the texture of the input has to be read back for the next frame
+template <typename Field>
+bool texture_needs_pixels(const Field& port) noexcept
+{
+  constexpr auto access = texture_access_of<Field>();
+  if constexpr (access == texture_access::pixels)
+    return true;
+  else if constexpr (access == texture_access::on_demand)
+    return port.pixels_requested;
+  else
+    return false;
+}
+
+// The texture of the input is on the GPU; its pixels, if any, are the ones of a previous frame
+template <typename Field>
+void set_texture_handle(Field& port, void* handle, int width, int height) noexcept
+{
+  if constexpr (requires { port.texture.handle = handle; })
+    port.texture.handle = handle;
+  if (width != port.texture.width || height != port.texture.height)
+    port.texture.bytes = nullptr;
+  port.texture.width = width;
+  port.texture.height = height;
+  port.texture.changed = true;
+}
+
+// The pixels read back for the input, possibly a few frames after they were asked for
+template <typename Field>
+void set_texture_pixels(Field& port, unsigned char* bytes, int width, int height) noexcept
+{
+  port.texture.bytes = bytes;
+  port.texture.width = width;
+  port.texture.height = height;
+  port.texture.changed = true;
+  if constexpr (requires { port.pixels_requested = false; })
+    port.pixels_requested = false;
+}
+
+// The GPU texture forwarded to the output, to pass on as is, or null if it has to be uploaded
+template <typename Field>
+void* forwarded_texture(const Field& port) noexcept
+{
+  if constexpr (requires {
+                  port.forwarded;
+                  port.texture.handle;
+                })
+    return port.forwarded ? port.texture.handle : nullptr;
+  else
+    return nullptr;
+}
+
+// Bit i is set when the i-th CPU texture input has to be read back for the next frame
+template <typename T>
+uint64_t texture_readbacks(avnd::effect_container<T>& t) noexcept
+{
+  uint64_t mask = 0;
+  if constexpr (cpu_texture_input_introspection<T>::size > 0)
+  {
+    static_assert(cpu_texture_input_introspection<T>::size <= 64);
+    cpu_texture_input_introspection<T>::for_all_n(
+        avnd::get_inputs(t), [&]<auto Idx, typename M>(M& port, avnd::predicate_index<Idx>) {
+          if (texture_needs_pixels(port))
+            mask |= uint64_t(1) << Idx;
+        });
+  }
+  return mask;
+}
+}
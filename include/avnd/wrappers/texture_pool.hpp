@@ -0,0 +1,210 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace avnd
+{
+/**
+ * Memory for the CPU texture outputs of the processors, owned by the host.
+ *
+ * The blocks are sized by powers of two and recycled when released, so that
+ * resizing or re-creating a texture of a similar size does not allocate.
+ * By default they come from the heap; a GPU host can provide its own memory,
+ * e.g. persistently mapped upload buffers, which the textures are then
+ * uploaded from directly.
+ */
+class texture_pool
+{
+public:
+  // Memory which outlives the pool, or null if there is none left
+  struct memory_source
+  {
+    void* context{};
+    unsigned char* (*allocate)(void* context, std::size_t bytes){};
+    void (*free)(void* context, unsigned char* data, std::size_t bytes){};
+  };
+
+  static constexpr int min_bucket = 12; // 4 KiB
+  static constexpr int buckets = 40 - min_bucket;
+
+  texture_pool() = default;
+  explicit texture_pool(memory_source src)
+      : m_source{src}
+  {
+  }
+
+  texture_pool(const texture_pool&) = delete;
+  texture_pool& operator=(const texture_pool&) = delete;
+
+  ~texture_pool()
+  {
+    for (auto& [data, bucket] : m_sizes)
+      free_block(data, bucket);
+  }
+
+  // Shared by all the processors of a process
+  static texture_pool& shared()
+  {
+    static texture_pool pool;
+    return pool;
+  }
+
+  unsigned char* allocate(std::size_t bytes)
+  {
+    const int bucket = bucket_for(bytes);
+    if (bucket >= buckets)
+      return nullptr;
+
+    std::lock_guard lock{m_mutex};
+    auto& free_list = m_free[bucket];
+    if (!free_list.empty())
+    {
+      auto* data = free_list.back();
+      free_list.pop_back();
+      return data;
+    }
+
+    const std::size_t size = std::size_t(1) << (bucket + min_bucket);
+    unsigned char* data{};
+    if (m_source.allocate)
+      data = m_source.allocate(m_source.context, size);
+    else
+      data = new (std::nothrow) unsigned char[size];
+    if (data)
+      m_sizes.emplace(data, bucket);
+    return data;
+  }
+
+  // The block is kept for the next allocation of the same size class
+  void release(unsigned char* data)
+  {
+    std::lock_guard lock{m_mutex};
+    if (auto it = m_sizes.find(data); it != m_sizes.end())
+      m_free[it->second].push_back(data);
+  }
+
+  // Gives the unused blocks back, e.g. when a project is closed
+  void trim()
+  {
+    std::lock_guard lock{m_mutex};
+    for (int b = 0; b < buckets; b++)
+    {
+      for (auto* data : m_free[b])
+      {
+        m_sizes.erase(data);
+        free_block(data, b);
+      }
+      m_free[b].clear();
+    }
+  }
+
+  static int bucket_for(std::size_t bytes) noexcept
+  {
+    const int bits = int(std::bit_width(std::max<std::size_t>(bytes, 1) - 1));
+    return std::max(bits - min_bucket, 0);
+  }
+
+private:
+  void free_block(unsigned char* data, int bucket) noexcept
+  {
+    if (m_source.free)
+      m_source.free(m_source.context, data, std::size_t(1) << (bucket + min_bucket));
+    else if (!m_source.allocate)
+      delete[] data;
+  }
+
+  memory_source m_source{};
+  std::mutex m_mutex;
+  std::array<std::vector<unsigned char*>, buckets> m_free;
+  std::unordered_map<unsigned char*, int> m_sizes;
+};
+
+template <typename T>
+struct texture_output_storage
+{
+  static constexpr void
+  init(avnd::effect_container<T>&, texture_pool& = texture_pool::shared()) noexcept
+  {
+  }
+  static constexpr void release() noexcept { }
+};
+
+/**
+ * Makes the texture outputs which accept it (e.g. halp::texture_output) take
+ * their memory from a texture_pool.
+ */
+template <typename T>
+requires(cpu_texture_output_introspection<T>::size > 0)
+struct texture_output_storage<T>
+{
+  texture_output_storage() = default;
+  texture_output_storage(const texture_output_storage&) = delete;
+  texture_output_storage& operator=(const texture_output_storage&) = delete;
+
+  // Must be destroyed before the processor
+  ~texture_output_storage() { release(); }
+
+  void init(avnd::effect_container<T>& t, texture_pool& pool = texture_pool::shared())
+  {
+    m_impl = &t;
+    m_pool = &pool;
+    cpu_texture_output_introspection<T>::for_all(
+        avnd::get_outputs(t), [&pool]<typename M>(M& port) {
+          if constexpr (requires { port.allocator.allocate; })
+          {
+            port.allocator.allocate.context = &pool;
+            port.allocator.allocate.function
+                = [](void* ctx, int w, int h, int bpp) -> unsigned char* {
+              return static_cast<texture_pool*>(ctx)->allocate(std::size_t(w) * h * bpp);
+            };
+            port.allocator.release.context = &pool;
+            port.allocator.release.function = [](void* ctx, unsigned char* data) {
+              static_cast<texture_pool*>(ctx)->release(data);
+            };
+          }
+        });
+  }
+
+  // Gives the memory of the textures back to the pool
+  void release()
+  {
+    if (!m_impl)
+      return;
+
+    cpu_texture_output_introspection<T>::for_all(
+        avnd::get_outputs(*m_impl), [this]<typename M>(M& port) {
+          if constexpr (requires { port.allocator.allocate; })
+          {
+            if (port.allocator.allocate.context == m_pool)
+            {
+              // Forwarded textures are the memory of an input
+              bool own = port.texture.bytes && port.texture.bytes != port.storage.data();
+              if constexpr (requires { port.forwarded; })
+                own = own && !port.forwarded;
+              if (own)
+                m_pool->release(port.texture.bytes);
+              port.texture.bytes = nullptr;
+              port.allocator = {};
+            }
+          }
+        });
+    m_impl = nullptr;
+  }
+
+private:
+  avnd::effect_container<T>* m_impl{};
+  texture_pool* m_pool{};
+};
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/gfx.hpp>
+#include <avnd/concepts/processor.hpp>
+#include <avnd/introspection/input.hpp>
+#include <avnd/introspection/output.hpp>
+#include <avnd/wrappers/thread_pool.hpp>
+
+#include <algorithm>
+#include <concepts>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace avnd
+{
+/**
+ * The area split in tiles: the first CPU texture output, or the first input
+ * for processors without one. Tiles are bands of whole rows, so that their
+ * pixels are contiguous, of about tile_bytes unless T::tile_rows() says otherwise.
+ */
+template <typename T>
+struct texture_tiling
+{
+  static constexpr int tile_bytes = 64 * 1024;
+
+  int width{};
+  int height{};
+  int rows{1};
+
+  int count() const noexcept { return rows > 0 ? (height + rows - 1) / rows : 0; }
+
+  static texture_tiling compute(T& obj) noexcept
+  {
+    texture_tiling res;
+    int bytes_per_pixel = 4;
+    auto from = [&]<typename M>(M& port) {
+      if (res.width > 0)
+        return;
+      res.width = port.texture.width;
+      res.height = port.texture.height;
+      using texture_type = std::decay_t<decltype(port.texture)>;
+      if constexpr (requires { texture_type::bytes_per_pixel; })
+        bytes_per_pixel = texture_type::bytes_per_pixel;
+    };
+
+    if constexpr (cpu_texture_output_introspection<T>::size > 0)
+      cpu_texture_output_introspection<T>::for_all(obj.outputs, from);
+    else if constexpr (cpu_texture_input_introspection<T>::size > 0)
+      cpu_texture_input_introspection<T>::for_all(obj.inputs, from);
+
+    if constexpr (requires { T::tile_rows(); })
+      res.rows = std::max(1, int(T::tile_rows()));
+    else if (res.width > 0)
+      res.rows = std::max(1, tile_bytes / (res.width * bytes_per_pixel));
+    return res;
+  }
+};
+
+/**
+ * Runs one frame of a tiled_texture_processor:
+ *
+ *   bool begin_frame();  // optional: e.g. creates the outputs, false skips the frame
+ *   void tile(int x, int y, int width, int height);
+ *   void end_frame();    // optional: e.g. marks the outputs as changed
+ *
+ * The tiles go to the worker threads the processor was given with its task runner
+ * (see bind_task_runner), and to the calling thread: tile() must only write its
+ * own part of the outputs. end_frame() is called once they are all done.
+ */
+template <tiled_texture_processor T>
+void run_texture_tiles(T& obj)
+{
+  if constexpr (requires {
+                  { obj.begin_frame() } -> std::convertible_to<bool>;
+                })
+  {
+    if (!obj.begin_frame())
+      return;
+  }
+  else if constexpr (requires { obj.begin_frame(); })
+  {
+    obj.begin_frame();
+  }
+
+  const auto tiling = texture_tiling<T>::compute(obj);
+  if (tiling.width > 0 && tiling.height > 0)
+  {
+    auto job = [&](int t) {
+      const int y = t * tiling.rows;
+      obj.tile(0, y, tiling.width, std::min(tiling.rows, tiling.height - y));
+    };
+
+    const int tiles = tiling.count();
+    bool done = false;
+    if constexpr (task_runner_processor<T>)
+    {
+      if (tiles > 1 && obj.tasks.request)
+        done = obj.tasks.request(
+            obj.tasks.pool, tiles,
+            +[](void* ctx, int t) { (*static_cast<decltype(job)*>(ctx))(t); },
+            (void*)std::addressof(job));
+    }
+    if (!done)
+      for (int t = 0; t < tiles; t++)
+        job(t);
+  }
+
+  if constexpr (requires { obj.end_frame(); })
+    obj.end_frame();
+}
+
+// Shared by the tiled texture processors of a process, which all run in the
+// render thread: only one frame at a time goes through it.
+inline thread_pool& texture_tiles_pool()
+{
+  static thread_pool pool;
+  return pool;
+}
+}
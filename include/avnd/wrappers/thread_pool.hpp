@@ -0,0 +1,253 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/processor.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace avnd
+{
+/**
+ * Something which runs a set of tasks and returns once they are all done,
+ * e.g. our own thread_pool, or the worker threads of a host.
+ */
+class task_executor
+{
+public:
+  virtual ~task_executor() = default;
+
+  // Number of threads the tasks can be spread on, not counting the thread calling run()
+  virtual int size() const noexcept = 0;
+
+  // Calls call(context, task) for every task in [0; tasks[.
+  // Returns false if the tasks could not be run, the caller then has to run them.
+  virtual bool execute(int tasks, void (*call)(void*, int), void* context) noexcept = 0;
+
+  // Calls f(task) for every task in [0; tasks[
+  template <typename F>
+  void run(int tasks, F&& f)
+  {
+    if (tasks <= 0)
+      return;
+
+    if (tasks > 1 && size() > 0
+        && execute(
+            tasks,
+            +[](void* ctx, int t) { (*static_cast<std::remove_reference_t<F>*>(ctx))(t); },
+            (void*)std::addressof(f)))
+      return;
+
+    for (int t = 0; t < tasks; t++)
+      f(t);
+  }
+};
+
+/**
+ * A set of worker threads used to split the work of a process() call,
+ * e.g. the duplicated instances of a monophonic processor.
+ *
+ * run() hands out tasks to the workers and to the calling thread: each thread takes
+ * the next task as soon as it is done with its own, so that a slow task does
+ * not hold up the others. run() returns once all the tasks are done.
+ *
+ * Nothing allocates nor locks once constructed. Only one thread may call run() at a time.
+ */
+class thread_pool final : public task_executor
+{
+public:
+  explicit thread_pool(int threads = int(std::thread::hardware_concurrency()) - 1)
+  {
+    threads = std::max(threads, 0);
+    m_workers.reserve(threads);
+    for (int i = 0; i < threads; i++)
+      m_workers.emplace_back([this] { work(); });
+  }
+
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  ~thread_pool()
+  {
+    m_stop.store(true, std::memory_order_release);
+    m_generation.fetch_add(1, std::memory_order_release);
+    m_generation.notify_all();
+    for (auto& t : m_workers)
+      t.join();
+  }
+
+  int size() const noexcept override { return int(m_workers.size()); }
+
+  // Tasks of a run() past this count are not split
+  static constexpr int max_tasks = 0xFFFF;
+
+  bool execute(int tasks, void (*call)(void*, int), void* context) noexcept override
+  {
+    if (m_workers.empty() || tasks > max_tasks)
+      return false;
+
+    // Nothing reads the job here: the tasks of the previous one are all done
+    m_job = {call, context};
+    m_done.store(0, std::memory_order_relaxed);
+
+    // Publishes the job: from now on, a claim on the previous one fails
+    const uint64_t generation = (m_state.load(std::memory_order_relaxed) >> 32) + 1;
+    m_state.store((generation << 32) | (uint64_t(tasks) << 16), std::memory_order_release);
+    m_generation.fetch_add(1, std::memory_order_release);
+    m_generation.notify_all();
+
+    run_tasks();
+
+    // Barrier: wait for the tasks taken by the workers
+    for (int done = m_done.load(std::memory_order_acquire); done < tasks;
+         done = m_done.load(std::memory_order_acquire))
+      m_done.wait(done, std::memory_order_acquire);
+    return true;
+  }
+
+private:
+  void run_tasks() noexcept
+  {
+    // m_state is the generation of the job, its task count and the next task:
+    // a task is claimed with a CAS, which fails if the job was replaced since s was read.
+    // The job is only read once a task is claimed: it cannot change until that task is done.
+    uint64_t s = m_state.load(std::memory_order_acquire);
+    while (true)
+    {
+      const int tasks = int((s >> 16) & max_tasks);
+      const int t = int(s & max_tasks);
+      if (t >= tasks)
+        return;
+
+      if (!m_state.compare_exchange_weak(
+              s, s + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+        continue;
+
+      m_job.call(m_job.context, t);
+      if (m_done.fetch_add(1, std::memory_order_acq_rel) + 1 == tasks)
+        m_done.notify_one();
+      s = m_state.load(std::memory_order_acquire);
+    }
+  }
+
+  void work() noexcept
+  {
+    uint32_t seen = 0;
+    while (true)
+    {
+      m_generation.wait(seen, std::memory_order_acquire);
+      seen = m_generation.load(std::memory_order_acquire);
+      if (m_stop.load(std::memory_order_acquire))
+        return;
+
+      run_tasks();
+    }
+  }
+
+  struct job
+  {
+    void (*call)(void*, int){};
+    void* context{};
+  };
+
+  std::vector<std::thread> m_workers;
+  job m_job;
+
+  alignas(64) std::atomic<uint64_t> m_state{0};
+  alignas(64) std::atomic<int> m_done{0};
+  alignas(64) std::atomic<uint32_t> m_generation{0};
+  std::atomic_bool m_stop{false};
+};
+
+/**
+ * Optional parallel processing of the duplicated instances of monophonic processors.
+ * The channels are split in contiguous sets, each processed by one task, as long as each
+ * task gets at least min_samples_per_task samples (frames * channels): small buffers
+ * and low channel counts stay on the calling thread.
+ */
+struct channel_parallelism
+{
+  task_executor* pool{};
+  int min_samples_per_task{4096};
+
+  int tasks_for(int channels, int frames) const noexcept
+  {
+    if (!pool || channels < 2)
+      return 1;
+    const int64_t samples = int64_t(channels) * frames;
+    const int64_t by_work = samples / std::max(min_samples_per_task, 1);
+    return int(std::clamp<int64_t>(by_work, 1, std::min(channels, pool->size() + 1)));
+  }
+
+  // [first; last[ channels of a task
+  static std::pair<int, int> channels_of(int task, int tasks, int channels) noexcept
+  {
+    return {task * channels / tasks, (task + 1) * channels / tasks};
+  }
+
+  // e.g. out[0] == in[1]: processing a channel would overwrite the input of another
+  template <typename FP>
+  static bool crossed_buffers(const FP* const* in, const FP* const* out, int channels) noexcept
+  {
+    for (int o = 0; o < channels; o++)
+      for (int i = 0; i < channels; i++)
+        if (i != o && out[o] == in[i])
+          return true;
+    return false;
+  }
+};
+
+/**
+ * Optional parallel rendering of the voices of a synthesizer: the playing voices
+ * are split in groups of at least min_voices, each rendered by one task in its
+ * own buffer, which are then summed. Buffers shorter than min_frames and
+ * small patches stay on the calling thread, where this would cost more than it gains.
+ */
+struct voice_parallelism
+{
+  task_executor* pool{};
+  int min_voices{32};
+  int min_frames{64};
+
+  int tasks_for(int voices, int frames) const noexcept
+  {
+    if (!pool || frames < min_frames)
+      return 1;
+    const int by_work = voices / std::max(min_voices, 1);
+    return std::clamp(by_work, 1, pool->size() + 1);
+  }
+
+  // [first; last[ voices of a task
+  static std::pair<int, int> voices_of(int task, int tasks, int voices) noexcept
+  {
+    return {task * voices / tasks, (task + 1) * voices / tasks};
+  }
+};
+
+/**
+ * Gives the executor to a processor which splits its work in tasks,
+ * or detaches it when executor is null.
+ */
+template <typename T>
+void bind_task_runner(T& object, task_executor* executor) noexcept
+{
+  if constexpr (task_runner_processor<T>)
+  {
+    object.tasks.pool = executor;
+    if (executor)
+      object.tasks.request
+          = [](void* pool, int tasks, void (*job)(void*, int), void* context) noexcept {
+        return static_cast<task_executor*>(pool)->execute(tasks, job, context);
+      };
+    else
+      object.tasks.request = nullptr;
+  }
+}
+}
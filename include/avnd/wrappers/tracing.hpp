@@ -0,0 +1,99 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/wrappers/metadatas.hpp>
+
+#include <array>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * Trace zones around the hot paths of the bindings, to see in a profiler of the whole
+ * host whether the time goes to the processor or to the code of the bindings.
+ * Compiled out unless built with the AVENDISH_TRACING CMake option:
+ *
+ * - AVND_TRACING_TRACY: zones of Tracy, when TRACY_ENABLE is defined.
+ * - AVND_TRACING_PERFETTO: track events of the Perfetto SDK, in the "avnd" category,
+ *   recorded by the system backend, see src/tracing_perfetto.cpp.
+ *
+ * A zone is named after the processor and the phase, e.g. "Lowpass: process":
+ *
+ * AVND_TRACE_ZONE(T, process);
+ */
+namespace avnd::trace
+{
+enum class phase
+{
+  callback,   // The whole audio callback of the host
+  events,     // Reading the events of the host, in order
+  parameters, // Applying the parameter changes
+  midi,       // Translating the MIDI messages from and to the ports
+  messages,   // Dispatching the messages to the processor
+  process,    // Running the processor
+  controls,   // Mirroring the output controls to the host
+};
+
+inline constexpr std::string_view phase_names[]
+    = {"callback", "events", "parameters", "midi", "messages", "process", "controls"};
+
+template <typename T>
+concept constant_name = requires {
+  typename std::integral_constant<std::size_t, avnd::get_name<T>().size()>;
+};
+
+// "name: phase", null-terminated, in static storage for the trace backends
+template <typename T, phase P>
+inline constexpr auto zone_name_storage = [] {
+  constexpr std::string_view name = [] {
+    if constexpr (constant_name<T>)
+      return avnd::get_name<T>();
+    else
+      return std::string_view{"avnd"};
+  }();
+  constexpr std::string_view ph = phase_names[int(P)];
+
+  std::array<char, name.size() + 2 + ph.size() + 1> res{};
+  auto it = res.begin();
+  for (char c : name)
+    *it++ = c;
+  *it++ = ':';
+  *it++ = ' ';
+  for (char c : ph)
+    *it++ = c;
+  return res;
+}();
+
+template <typename T, phase P>
+inline constexpr const char* zone_name = zone_name_storage<T, P>.data();
+}
+
+#define AVND_TRACE_CONCAT_(a, b) a##b
+#define AVND_TRACE_CONCAT(a, b) AVND_TRACE_CONCAT_(a, b)
+
+#if AVND_TRACING_TRACY
+#include <tracy/Tracy.hpp>
+
+#define AVND_TRACE_ZONE(T, Phase)                    \
+  ZoneNamedN(                                        \
+      AVND_TRACE_CONCAT(avnd_trace_zone_, __LINE__), \
+      (::avnd::trace::zone_name<T, ::avnd::trace::phase::Phase>), true)
+
+#elif AVND_TRACING_PERFETTO
+#include <perfetto.h>
+
+PERFETTO_DEFINE_CATEGORIES_IN_NAMESPACE(
+    avnd::trace::perfetto_categories,
+    perfetto::Category("avnd").SetDescription("The hot paths of the avendish bindings"));
+
+#define AVND_TRACE_ZONE(T, Phase)                                          \
+  PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(                           \
+      ::avnd::trace::perfetto_categories);                                 \
+  TRACE_EVENT(                                                             \
+      "avnd",                                                              \
+      ::perfetto::StaticString{                                            \
+          ::avnd::trace::zone_name<T, ::avnd::trace::phase::Phase>})
+
+#else
+#define AVND_TRACE_ZONE(T, Phase) static_assert(true)
+#endif
@@ -0,0 +1,166 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/function_reflection.hpp>
+#include <avnd/common/spsc_queue.hpp>
+#include <avnd/concepts/processor.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <boost/mp11.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace avnd
+{
+template <typename T>
+struct worker_storage
+{
+  static constexpr void start(avnd::effect_container<T>&) noexcept { }
+  static constexpr void deliver(avnd::effect_container<T>&) noexcept { }
+  static constexpr int64_t dropped() noexcept { return 0; }
+};
+
+/**
+ * Runs the worker of a processor, see worker_processor: when the processor calls
+ * worker.request(args...) from the audio thread, the arguments are copied in a
+ * wait-free queue and a thread of the binding calls worker::work(args...) with them.
+ * What work() returns is then called with the processor by deliver(), at the start
+ * of the next buffer, in the audio thread: it is where the result gets swapped in.
+ *
+ * Nothing is freed by the audio thread: the responses it has called go back to
+ * the thread, which destroys them. The arguments of the requests are copied
+ * in place, so they should not allocate, e.g. an index or a fixed-size string.
+ * Requests are dropped when the queue is full.
+ */
+template <typename T>
+requires worker_processor<T>
+struct worker_storage<T>
+{
+  static constexpr std::size_t capacity = 64;
+
+  using worker_type = std::decay_t<decltype(std::declval<T&>().worker)>;
+  using request_type = boost::mp11::mp_rename<
+      boost::mp11::mp_transform<
+          std::decay_t, typename function_reflection_t<
+                            std::decay_t<decltype(std::declval<worker_type&>().request)>>::
+                            arguments>,
+      std::tuple>;
+  using response_type = std::decay_t<decltype(std::apply(
+      &worker_type::work, std::declval<request_type>()))>;
+  static_assert(
+      std::is_invocable_v<response_type&, T&>,
+      "worker::work must return something which can be called with the processor");
+
+  worker_storage() = default;
+  worker_storage(const worker_storage&) = delete;
+  worker_storage& operator=(const worker_storage&) = delete;
+
+  ~worker_storage()
+  {
+    m_stop.store(true, std::memory_order_release);
+    wake();
+    if (m_thread.joinable())
+      m_thread.join();
+  }
+
+  // Once the processors exist, outside of the audio thread, e.g. in prepare
+  void start(avnd::effect_container<T>& effect)
+  {
+    int k = 0;
+    for (auto& e : effect.effects())
+    {
+      e.worker.request = [this, k](auto&&... args) {
+        if (m_requests.push(std::pair<int, request_type>{
+                k, request_type{std::forward<decltype(args)>(args)...}}))
+          wake();
+        else
+          m_dropped.fetch_add(1, std::memory_order_relaxed);
+      };
+      k++;
+    }
+
+    if (!m_thread.joinable())
+      m_thread = std::thread{[this] { run(); }};
+  }
+
+  // Audio thread, before the processor
+  void deliver(avnd::effect_container<T>& effect) noexcept
+  {
+    while (auto* r = m_responses.front())
+    {
+      auto [index, response] = std::move(*r);
+      m_responses.pop();
+
+      bool valid = true;
+      if constexpr (requires { bool(response); })
+        valid = bool(response);
+
+      int k = 0;
+      for (auto& e : effect.effects())
+        if (k++ == index && valid)
+          response(e);
+
+      if (m_spent.push(std::move(response)))
+        wake();
+    }
+  }
+
+  // The requests which did not fit in the queue
+  int64_t dropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  void wake() noexcept
+  {
+    m_posted.fetch_add(1, std::memory_order_release);
+    m_posted.notify_one();
+  }
+
+  void run()
+  {
+    while (!m_stop.load(std::memory_order_acquire))
+    {
+      // Read before looking at the queues: a request pushed after that changes it
+      const uint32_t seen = m_posted.load(std::memory_order_acquire);
+
+      while (auto* s = m_spent.front())
+      {
+        *s = response_type{};
+        m_spent.pop();
+      }
+
+      while (auto* r = m_requests.front())
+      {
+        auto [index, request] = std::move(*r);
+        m_requests.pop();
+
+        std::pair<int, response_type> response{
+            index, std::apply(&worker_type::work, std::move(request))};
+
+        // The audio thread will make room at its next buffer
+        while (!m_responses.push(std::move(response)))
+        {
+          if (m_stop.load(std::memory_order_acquire))
+            return;
+          std::this_thread::yield();
+        }
+      }
+
+      m_posted.wait(seen, std::memory_order_acquire);
+    }
+  }
+
+  spsc_queue<std::pair<int, request_type>, capacity> m_requests;
+  spsc_queue<std::pair<int, response_type>, capacity> m_responses;
+  spsc_queue<response_type, capacity> m_spent;
+
+  std::atomic<uint32_t> m_posted{0};
+  std::atomic<int64_t> m_dropped{};
+  std::atomic<bool> m_stop{};
+  std::thread m_thread;
+};
+}
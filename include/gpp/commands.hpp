@@ -4,6 +4,9 @@
 
 #include <gpp/generators.hpp>
 
+#include <cstddef>
+#include <cstdint>
+
 // FIXME: mpark::variant gives the best results
 #include <variant>
 
@@ -17,6 +20,11 @@ using texture_handle = texture_handle_t*;
 struct sampler_handle_t;
 using sampler_handle = sampler_handle_t*;
 
+// Optional in the upload commands: a counter the processor bumps whenever the
+// data changes. The host then skips same-generation uploads without looking at
+// the bytes; with 0 it has to compare them.
+using upload_generation = uint64_t;
+
 // Define our commands
 struct static_allocation
 {
@@ -34,6 +42,7 @@ struct static_upload
   int offset;
   int size;
   void* data;
+  upload_generation generation{};
 };
 
 struct dynamic_vertex_allocation
@@ -51,6 +60,7 @@ struct dynamic_vertex_upload
   int offset;
   int size;
   void* data;
+  upload_generation generation{};
 };
 
 struct dynamic_index_allocation
@@ -68,6 +78,7 @@ struct dynamic_index_upload
   int offset;
   int size;
   void* data;
+  upload_generation generation{};
 };
 
 struct dynamic_ubo_allocation
@@ -85,6 +96,42 @@ struct dynamic_ubo_upload
   int offset;
   int size;
   void* data;
+  upload_generation generation{};
+};
+
+// Writable staging memory for a range of a dynamic buffer. The processor
+// writes the data in it during update() instead of yielding an upload: the host
+// copies it to the buffer at the end of the frame. It is empty when the host
+// ran out of staging memory, the processor then has to upload as usual.
+struct mapped_range
+{
+  char* data;
+  std::size_t size;
+};
+
+struct dynamic_vertex_map
+{
+  enum { map, dynamic, vertex };
+  using return_type = mapped_range;
+  buffer_handle handle;
+  int offset;
+  int size;
+};
+struct dynamic_index_map
+{
+  enum { map, dynamic, index };
+  using return_type = mapped_range;
+  buffer_handle handle;
+  int offset;
+  int size;
+};
+struct dynamic_ubo_map
+{
+  enum { map, dynamic, ubo };
+  using return_type = mapped_range;
+  buffer_handle handle;
+  int offset;
+  int size;
 };
 
 struct sampler_allocation
@@ -109,6 +156,7 @@ struct texture_upload
   int offset;
   int size;
   void* data;
+  upload_generation generation{};
 };
 
 
@@ -177,6 +225,26 @@ struct compute_dispatch
   int x, y, z;
 };
 
+// Many dispatches of the current pipeline, run in order: the backend puts a
+// barrier between them so that each one sees what the previous ones wrote.
+struct compute_dispatch_batch
+{
+  enum { compute, dispatch, batch };
+  using return_type = void;
+  const compute_dispatch* dispatches;
+  int count;
+};
+
+// The workgroup counts are read by the GPU from three uint32 at offset in the
+// buffer, e.g. written by a previous dispatch.
+struct compute_dispatch_indirect
+{
+  enum { compute, dispatch, indirect };
+  using return_type = void;
+  buffer_handle handle;
+  int offset;
+};
+
 
 struct buffer_view { const char* data; std::size_t size; };
 struct texture_view { const char* data; std::size_t size; };
@@ -197,6 +265,22 @@ struct texture_awaiter {
     using return_type = texture_view;
     texture_readback_handle handle;
 };
+// Non-blocking alternative to yielding the awaiter: the view is empty until
+// the readback is done, which usually takes a few frames. The processor keeps
+// the awaiter and polls it at each dispatch().
+struct buffer_poll
+{
+  enum { readback, poll, buffer };
+  using return_type = buffer_view;
+  buffer_awaiter awaiter;
+};
+struct texture_poll
+{
+  enum { readback, poll, texture };
+  using return_type = texture_view;
+  texture_awaiter awaiter;
+};
+
 struct readback_buffer
 {
   enum { readback, request, buffer };
@@ -222,9 +306,10 @@ using update_action = bv2::variant<
   dynamic_ubo_allocation, dynamic_ubo_upload, ubo_release,
   sampler_allocation, sampler_release,
   texture_allocation, texture_upload, texture_release,
-  get_ubo_handle
+  get_ubo_handle,
+  dynamic_vertex_map, dynamic_index_map, dynamic_ubo_map
 >;
-using update_handle = bv2::variant<bv2::monostate, buffer_handle, texture_handle, sampler_handle>;
+using update_handle = bv2::variant<bv2::monostate, buffer_handle, texture_handle, sampler_handle, mapped_range>;
 using co_update = gpp::generator<update_action, update_handle>;
 
 
@@ -242,9 +327,10 @@ using co_release = gpp::generator<release_action, void>;
 
 using dispatch_action = bv2::variant<
   begin_compute_pass, end_compute_pass
-, compute_dispatch
+, compute_dispatch, compute_dispatch_batch, compute_dispatch_indirect
 , readback_buffer, readback_texture
 , buffer_awaiter, texture_awaiter
+, buffer_poll, texture_poll
 >;
 using dispatch_handle = bv2::variant<
   bv2::monostate
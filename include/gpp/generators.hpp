@@ -4,6 +4,8 @@
 
 #include <avnd/common/coroutines.hpp>
 
+#include <utility>
+
 // std::generator is not implemented yet, so polyfill it more or less
 namespace gpp
 {
@@ -6,6 +6,11 @@
 #include <avnd/common/member_reflection.hpp>
 #include <boost/pfr/core.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
 /*
 namespace gpp
 {
@@ -179,5 +184,76 @@ consteval int std140_size()
   return std140_offset_impl<T, boost::pfr::tuple_size_v<T>>();
 }
 
+namespace detail
+{
+inline void hash_bytes(uint64_t& h, const void* data, std::size_t size) noexcept
+{
+  // FNV-1a
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; i++)
+  {
+    h ^= bytes[i];
+    h *= 1099511628211ull;
+  }
+}
+
+template <typename V>
+void hash_value(uint64_t& h, V v) noexcept
+{
+  const auto i = int64_t(v);
+  hash_bytes(h, &i, sizeof(i));
+}
+
+inline void hash_name(uint64_t& h, std::string_view name) noexcept
+{
+  hash_bytes(h, name.data(), name.size());
+  hash_value(h, name.size());
+}
+
+// The ports (vertex attributes, uniforms...) are the leaves: their value is not
+// reflected, only its size.
+template <typename T>
+void hash_layout_member(uint64_t& h, const T& member)
+{
+  if constexpr (requires { T::name(); })
+    hash_name(h, T::name());
+  if constexpr (requires { T::binding(); })
+    hash_value(h, T::binding());
+  if constexpr (requires { T::location(); })
+    hash_value(h, T::location());
+  hash_value(h, sizeof(T));
+
+  if constexpr (
+      std::is_class_v<T> && std::is_aggregate_v<T> && !requires { member.value; }
+      && !requires { member.data; })
+  {
+    if constexpr (boost::pfr::tuple_size_v<T> > 0)
+      boost::pfr::for_each_field(
+          member, [&h](const auto& field) { hash_layout_member(h, field); });
+  }
+}
+}
+
+/**
+ * A hash of the interface a layout declares: the names, bindings and locations
+ * of its members, their sizes and the workgroup size for compute. The shader
+ * interface the host generates from the layout only changes when it does,
+ * which makes it a stable key for caches of compiled pipelines.
+ */
+template <typename Layout>
+uint64_t layout_hash()
+{
+  uint64_t h = 14695981039346656037ull;
+  if constexpr (requires { Layout::local_size_x(); })
+    detail::hash_value(h, Layout::local_size_x());
+  if constexpr (requires { Layout::local_size_y(); })
+    detail::hash_value(h, Layout::local_size_y());
+  if constexpr (requires { Layout::local_size_z(); })
+    detail::hash_value(h, Layout::local_size_z());
+
+  const Layout layout{};
+  detail::hash_layout_member(h, layout);
+  return h;
 }
 
+}
@@ -3,6 +3,8 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <avnd/common/concepts_polyfill.hpp>
+#include <avnd/common/render_mode.hpp>
+#include <avnd/common/setup_change.hpp>
 #include <avnd/common/span_polyfill.hpp>
 #include <halp/static_string.hpp>
 
@@ -73,6 +75,55 @@ struct dynamic_audio_bus
   }
 };
 
+/**
+ * An audio bus which also gets the channels flagged as silent by the host:
+ * halp::silence_flagged<halp::dynamic_audio_bus<"In", float>> audio;
+ * Bit c of silence is set when channel c only contains zeros,
+ * hosts which do not flag them leave it at 0.
+ */
+template <typename Bus>
+struct silence_flagged : Bus
+{
+  uint64_t silence{};
+
+  bool silent(int channel) const noexcept
+  {
+    return channel < 64 && (silence >> channel) & 1;
+  }
+};
+
+/**
+ * An audio bus which the host may leave unconnected, e.g. a sidechain:
+ * halp::optional_bus<halp::dynamic_audio_bus<"Sidechain", double>> sidechain;
+ * When connected is false, samples is null for the whole buffer: the bindings
+ * neither fill nor convert anything for it.
+ * Hosts which do not know whether it is connected leave it at true.
+ */
+template <typename Bus>
+struct optional_bus : Bus
+{
+  bool connected{true};
+};
+
+/**
+ * A bus or a channel which gets from the host which of its channels are constant
+ * over the buffer, e.g. CV inputs driven by a static control: their value is then
+ * their first sample, and per-sample work such as computing filter coefficients
+ * can be done once:
+ * halp::constant_flagged<halp::audio_channel<"Cutoff", double>> cutoff;
+ * The buffers are filled all the same: this is only a hint.
+ */
+template <typename Port>
+struct constant_flagged : Port
+{
+  uint64_t constant{};
+
+  bool is_constant(int channel = 0) const noexcept
+  {
+    return channel < 64 && (constant >> channel) & 1;
+  }
+};
+
 struct tick
 {
   int frames{};
@@ -84,7 +135,15 @@ struct setup
   int output_channels{};
   int frames{};
   double rate{};
+
+  // Bounces and exports, see avnd/wrappers/render_mode.hpp
+  bool offline{};
+
+  // What changed since the previous prepare
+  avnd::setup_change changed{};
 };
+
+using render_mode = avnd::render_mode;
 }
 
 namespace halp
@@ -0,0 +1,281 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/coroutines.hpp>
+
+#if AVND_DISABLE_COROUTINES == 0
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace halp
+{
+class block_script;
+
+/**
+ * The coroutines which a block_script runs: a processor writes its logic which spans
+ * many buffers, e.g. the steps of a sequencer, as a plain loop with co_await
+ * instead of a state machine. See block_script.
+ */
+struct block_task
+{
+  struct promise_type
+  {
+    block_task get_return_object() noexcept
+    {
+      return block_task{handle::from_promise(*this)};
+    }
+
+    // When the frame does not fit in the storage of the script
+    static block_task get_return_object_on_allocation_failure() noexcept { return {}; }
+
+    static std::suspend_always initial_suspend() noexcept { return {}; }
+    static std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() noexcept { }
+    [[noreturn]] static void unhandled_exception() { std::abort(); }
+
+    // The frame is in the storage of the script which creates the coroutine
+    static void* operator new(std::size_t size) noexcept;
+    static void operator delete(void*) noexcept { }
+  };
+
+  using handle = std::coroutine_handle<promise_type>;
+
+  block_task() noexcept = default;
+  explicit block_task(handle h) noexcept
+      : coroutine{h}
+  {
+  }
+  block_task(const block_task&) = delete;
+  block_task& operator=(const block_task&) = delete;
+  block_task(block_task&& other) noexcept
+      : coroutine{std::exchange(other.coroutine, {})}
+  {
+  }
+  block_task& operator=(block_task&& other) noexcept
+  {
+    if (this != &other)
+    {
+      if (coroutine)
+        coroutine.destroy();
+      coroutine = std::exchange(other.coroutine, {});
+    }
+    return *this;
+  }
+  ~block_task()
+  {
+    if (coroutine)
+      coroutine.destroy();
+  }
+
+  handle coroutine;
+};
+
+/**
+ * Runs a block_task across the buffers of a processor, resuming it where it waits:
+ *
+ * halp::block_script script;
+ * halp::block_task sequence() {
+ *   for (int step = 0;; step = (step + 1) % 4) {
+ *     level = steps[step];
+ *     co_await script.samples(length);
+ *   }
+ * }
+ * void prepare(halp::setup) { script.start([this] { return sequence(); }); }
+ * void operator()(int frames) {
+ *   script(frames, [&](int first, int n) { std::fill_n(out + first, n, level); });
+ * }
+ *
+ * The coroutine can wait for a number of samples, for the next buffer, or until
+ * a condition holds at the start of a buffer, e.g. that the result of a worker arrived.
+ * Its frame is created by start(), outside of the audio thread, in storage
+ * allocated once with the script: running it never allocates.
+ * start() fails if the frame is larger than that storage.
+ * A block_task cannot co_await another one.
+ */
+class block_script
+{
+public:
+  explicit block_script(std::size_t frame_bytes = 4096)
+      : m_storage{std::make_unique<std::max_align_t[]>(
+          (frame_bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t))}
+      , m_capacity{frame_bytes}
+  {
+  }
+
+  block_script(const block_script&) = delete;
+  block_script& operator=(const block_script&) = delete;
+
+  // Outside of the audio thread, e.g. in prepare(): make returns the block_task to run,
+  // from its first buffer on. The previous one is destroyed.
+  template <typename F>
+  bool start(F&& make)
+  {
+    m_task = {};
+    s_constructing = this;
+    m_task = std::forward<F>(make)();
+    s_constructing = nullptr;
+
+    m_wait = wait::start;
+    m_time = 0;
+    m_block = 0;
+    return bool(m_task.coroutine);
+  }
+
+  void stop() noexcept { m_task = {}; }
+
+  bool running() const noexcept { return m_task.coroutine && !m_task.coroutine.done(); }
+
+  // Where the coroutine is resumed in the current buffer, and the size of this buffer
+  int offset() const noexcept { return m_offset; }
+  int frames() const noexcept { return m_frames; }
+
+  // Audio thread, for each buffer: resumes the coroutine whenever it is done waiting.
+  // render(first, n) is called for each part of the buffer between two resumptions.
+  template <typename F>
+  void operator()(int frames, F&& render)
+  {
+    m_frames = frames;
+    int pos = 0;
+    while (running())
+    {
+      int at = -1;
+      switch (m_wait)
+      {
+        case wait::start:
+          at = pos;
+          break;
+        case wait::next_block:
+          if (m_block > m_waited_block)
+            at = pos;
+          break;
+        case wait::samples:
+          if (m_target < m_time + frames)
+            at = int(std::max(m_target - m_time, int64_t(pos)));
+          break;
+        case wait::condition:
+          if (pos == 0 && m_condition(m_context))
+            at = pos;
+          break;
+        case wait::running:
+          break;
+      }
+      if (at < 0)
+        break;
+
+      if (at > pos)
+        render(pos, at - pos);
+      pos = at;
+      m_offset = at;
+      m_wait = wait::running;
+      m_task.coroutine.resume();
+    }
+
+    if (frames > pos)
+      render(pos, frames - pos);
+    m_time += frames;
+    m_block++;
+  }
+
+  void operator()(int frames)
+  {
+    (*this)(frames, [](int, int) noexcept {});
+  }
+
+  // co_await script.samples(n): resumes n samples later, in this buffer or another one
+  auto samples(int64_t n) noexcept
+  {
+    struct awaiter
+    {
+      block_script& self;
+      int64_t n;
+      bool await_ready() const noexcept { return n <= 0; }
+      void await_suspend(std::coroutine_handle<>) const noexcept
+      {
+        self.m_wait = wait::samples;
+        self.m_target = self.m_time + self.m_offset + n;
+      }
+      void await_resume() const noexcept { }
+    };
+    return awaiter{*this, n};
+  }
+
+  // co_await script.next_block(): resumes at the start of the next buffer
+  auto next_block() noexcept
+  {
+    struct awaiter
+    {
+      block_script& self;
+      static constexpr bool await_ready() noexcept { return false; }
+      void await_suspend(std::coroutine_handle<>) const noexcept
+      {
+        self.m_wait = wait::next_block;
+        self.m_waited_block = self.m_block;
+      }
+      void await_resume() const noexcept { }
+    };
+    return awaiter{*this};
+  }
+
+  // co_await script.until(f): resumes at the start of the first buffer where f() is true
+  template <typename F>
+  auto until(F condition) noexcept
+  {
+    struct awaiter
+    {
+      block_script& self;
+      F condition;
+      bool await_ready() { return condition(); }
+      void await_suspend(std::coroutine_handle<>) noexcept
+      {
+        self.m_wait = wait::condition;
+        self.m_context = std::addressof(condition);
+        self.m_condition = +[](void* c) -> bool { return (*static_cast<F*>(c))(); };
+      }
+      void await_resume() const noexcept { }
+    };
+    return awaiter{*this, std::move(condition)};
+  }
+
+private:
+  friend struct block_task::promise_type;
+  static inline thread_local block_script* s_constructing{};
+
+  enum class wait
+  {
+    start,
+    running,
+    samples,
+    next_block,
+    condition
+  };
+
+  std::unique_ptr<std::max_align_t[]> m_storage;
+  std::size_t m_capacity{};
+  block_task m_task;
+
+  wait m_wait{wait::start};
+  int64_t m_time{};
+  int64_t m_target{};
+  int64_t m_block{};
+  int64_t m_waited_block{};
+  bool (*m_condition)(void*){};
+  void* m_context{};
+  int m_offset{};
+  int m_frames{};
+};
+
+inline void* block_task::promise_type::operator new(std::size_t size) noexcept
+{
+  auto* script = block_script::s_constructing;
+  if (!script || size > script->m_capacity)
+    return nullptr;
+  return script->m_storage.get();
+}
+}
+#endif
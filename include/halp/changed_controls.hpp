@@ -0,0 +1,24 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/controls.hpp>
+
+namespace halp
+{
+/**
+ * Gets from the host whether a control changed since the previous buffer, e.g.
+ * halp::change_flagged<halp::knob_f32<"Cutoff", halp::range{20., 20000., 1000.}>> cutoff;
+ * to only recompute what depends on it when it did:
+ * if (inputs.cutoff.changed) compute_coefficients();
+ *
+ * It is true in the first buffer.
+ */
+template <typename Control>
+struct change_flagged : Control
+{
+  bool changed{};
+
+  using Control::operator=;
+};
+}
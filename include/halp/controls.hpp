@@ -5,8 +5,10 @@
 #include <halp/polyfill.hpp>
 #include <halp/static_string.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <span>
 #include <string_view>
@@ -554,6 +556,98 @@ struct soundfile_port
   soundfile_view soundfile;
 };
 
+// A soundfile which is read from the disk while playing.
+// Only a window around the playback position is kept in memory.
+struct soundfile_stream_view {
+  void* stream{};
+
+  // Copies the frames [frame; frame + count[ of a channel, if they are in memory.
+  // Returns the number of frames copied, the remaining ones are set to zero.
+  int64_t (*read)(void* stream, int32_t channel, int64_t frame, float* out, int64_t count) noexcept
+      = [](void*, int32_t, int64_t, float* out, int64_t count) noexcept -> int64_t {
+    std::fill_n(out, count, 0.f);
+    return 0;
+  };
+
+  // Where the frames will be read next: the host reads ahead from there
+  void (*play_from)(void* stream, int64_t frame) noexcept
+      = [](void*, int64_t) noexcept { };
+
+  int64_t frames{};
+  int32_t channels{};
+
+  std::string_view filename;
+};
+
+template <halp::static_string lit, int64_t WindowFrames = 1 << 18>
+struct streamed_soundfile_port
+{
+  static clang_buggy_consteval auto name() { return std::string_view{lit.value}; }
+
+  // Frames kept in memory per channel
+  static clang_buggy_consteval int64_t window_frames() { return WindowFrames; }
+
+  operator bool() const noexcept { return soundfile.stream && soundfile.channels > 0 && soundfile.frames > 0; }
+
+  int channels() const noexcept { return soundfile.channels; }
+  int64_t frames() const noexcept { return soundfile.frames; }
+
+  int64_t read(int channel, int64_t frame, std::span<float> out) const noexcept
+  {
+    return soundfile.read(soundfile.stream, channel, frame, out.data(), out.size());
+  }
+
+  void play_from(int64_t frame) const noexcept { soundfile.play_from(soundfile.stream, frame); }
+
+  soundfile_stream_view soundfile;
+};
+
+// A soundfile which is written to the disk while recording.
+// The frames go through a ring buffer to a thread of the host, which encodes them.
+struct soundfile_recorder_view {
+  void* stream{};
+
+  // Queues the frames of each channel for the file. Returns the number of frames queued:
+  // the others did not fit in the ring buffer and are counted in dropped.
+  int64_t (*write)(void* stream, const float* const* in, int64_t frames) noexcept
+      = [](void*, const float* const*, int64_t) noexcept -> int64_t { return 0; };
+
+  // Finishes the current file and starts a new one. An empty path only finishes it.
+  void (*open)(void* stream, std::string_view path) noexcept
+      = [](void*, std::string_view) noexcept { };
+
+  int32_t channels{};
+
+  // Since the file was opened, as of the beginning of the buffer
+  int64_t frames{};
+  int64_t dropped{};
+  bool recording{};
+  bool error{};
+};
+
+template <halp::static_string lit, int Channels = 2, int64_t RingFrames = 1 << 17>
+struct soundfile_recorder_port
+{
+  static clang_buggy_consteval auto name() { return std::string_view{lit.value}; }
+
+  static clang_buggy_consteval int channels() { return Channels; }
+
+  // Frames kept in memory per channel until the host writes them
+  static clang_buggy_consteval int64_t ring_frames() { return RingFrames; }
+
+  operator bool() const noexcept { return soundfile.recording; }
+
+  int64_t write(const float* const* in, int64_t frames) const noexcept
+  {
+    return soundfile.write(soundfile.stream, in, frames);
+  }
+
+  void open(std::string_view path) const noexcept { soundfile.open(soundfile.stream, path); }
+  void close() const noexcept { soundfile.open(soundfile.stream, {}); }
+
+  soundfile_recorder_view soundfile;
+};
+
 }
 
 // Helpers for defining an enumeration without repeating the enumerated members
@@ -0,0 +1,545 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/wrappers/background_worker.hpp>
+#include <halp/controls.hpp>
+#include <halp/fft.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace halp
+{
+namespace detail
+{
+template <typename Bus>
+int bus_channels(const Bus& bus) noexcept
+{
+  if constexpr (requires { bus.channels(); })
+    return bus.channels();
+  else
+    return bus.channels;
+}
+
+// Uniformly partitioned overlap-save convolution with a segment of the impulse response:
+// partitions of "size" frames, each multiplied in the frequency domain
+// with the spectrum of an input block of the past.
+template <typename FP>
+struct convolution_stage
+{
+  int size{};
+  int partitions{};
+
+  void reset(int P, int channels, int filters)
+  {
+    size = P;
+    bins = P + 1;
+    fft.reset(2 * std::size_t(P));
+    window.assign(channels, std::vector<FP>(2 * std::size_t(P)));
+    output.assign(channels, std::vector<FP>(P));
+    fdl_re.assign(channels, {});
+    fdl_im.assign(channels, {});
+    fdl_pos.assign(channels, 0);
+    filter_re.assign(filters, {});
+    filter_im.assign(filters, {});
+    scratch.resize(2 * std::size_t(P));
+    spectrum.resize(2 * std::size_t(P));
+    acc_re.resize(bins);
+    acc_im.resize(bins);
+  }
+
+  // The frames [begin; end[ of each channel of the impulse response
+  template <typename T>
+  void set_filters(const T* const* ir, int64_t ir_frames, int64_t begin, int64_t end)
+  {
+    const int P = size;
+    partitions = int((end - begin + P - 1) / P);
+    const FP norm = FP(fft.normalization(2 * std::size_t(P)));
+
+    for (std::size_t f = 0; f < filter_re.size(); f++)
+    {
+      filter_re[f].assign(std::size_t(partitions) * bins, FP(0));
+      filter_im[f].assign(std::size_t(partitions) * bins, FP(0));
+      for (int j = 0; j < partitions; j++)
+      {
+        std::fill(scratch.begin(), scratch.end(), FP(0));
+        const int64_t first = begin + int64_t(j) * P;
+        const int64_t last = std::min({first + P, end, ir_frames});
+        for (int64_t i = first; i < last; i++)
+          scratch[i - first] = FP(ir[f][i]) * norm;
+
+        auto X = fft.execute(scratch.data(), 2 * std::size_t(P));
+        for (int k = 0; k < bins; k++)
+        {
+          filter_re[f][std::size_t(j) * bins + k] = X[k].real();
+          filter_im[f][std::size_t(j) * bins + k] = X[k].imag();
+        }
+      }
+    }
+
+    for (std::size_t c = 0; c < window.size(); c++)
+    {
+      fdl_re[c].assign(std::size_t(partitions) * bins, FP(0));
+      fdl_im[c].assign(std::size_t(partitions) * bins, FP(0));
+    }
+  }
+
+  // Where the frames of the current block are written
+  FP* block_input(int c) noexcept { return window[c].data() + size; }
+  const FP* block_output(int c) const noexcept { return output[c].data(); }
+
+  // Once the block is complete: computes the output for the next one
+  void compute(int c, int filter) noexcept
+  {
+    const int P = size;
+    const std::size_t N = 2 * std::size_t(P);
+    auto& win = window[c];
+
+    std::copy_n(win.data(), N, scratch.data());
+    auto X = fft.execute(scratch.data(), N);
+
+    const int pos = fdl_pos[c];
+    FP* __restrict xr = fdl_re[c].data() + std::size_t(pos) * bins;
+    FP* __restrict xi = fdl_im[c].data() + std::size_t(pos) * bins;
+    for (int k = 0; k < bins; k++)
+    {
+      xr[k] = X[k].real();
+      xi[k] = X[k].imag();
+    }
+
+    // Partition j goes with the spectrum of the input j blocks ago
+    FP* __restrict ar = acc_re.data();
+    FP* __restrict ai = acc_im.data();
+    std::fill_n(ar, bins, FP(0));
+    std::fill_n(ai, bins, FP(0));
+    for (int j = 0; j < partitions; j++)
+    {
+      const int slot = (pos - j + partitions) % partitions;
+      const FP* __restrict br = fdl_re[c].data() + std::size_t(slot) * bins;
+      const FP* __restrict bi = fdl_im[c].data() + std::size_t(slot) * bins;
+      const FP* __restrict hr = filter_re[filter].data() + std::size_t(j) * bins;
+      const FP* __restrict hi = filter_im[filter].data() + std::size_t(j) * bins;
+      for (int k = 0; k < bins; k++)
+      {
+        ar[k] += br[k] * hr[k] - bi[k] * hi[k];
+        ai[k] += br[k] * hi[k] + bi[k] * hr[k];
+      }
+    }
+    fdl_pos[c] = (pos + 1) % partitions;
+
+    for (int k = 0; k < bins; k++)
+      spectrum[k] = {ar[k], ai[k]};
+    auto y = fft.execute(spectrum.data(), N);
+
+    // The first half is wrapped around by the circular convolution
+    std::copy_n(y + P, P, output[c].data());
+    std::copy_n(win.data() + P, P, win.data());
+  }
+
+private:
+  int bins{};
+  halp::fft<FP> fft;
+
+  // The last two blocks of input
+  std::vector<std::vector<FP>> window;
+  std::vector<std::vector<FP>> output;
+
+  // Frequency-domain delay line: the spectra of the last input blocks
+  std::vector<std::vector<FP>> fdl_re, fdl_im;
+  std::vector<int> fdl_pos;
+
+  std::vector<std::vector<FP>> filter_re, filter_im;
+
+  std::vector<FP> scratch, acc_re, acc_im;
+  std::vector<std::complex<FP>> spectrum;
+};
+}
+
+/**
+ * Zero-latency convolution with long impulse responses, e.g. 10 seconds reverbs.
+ *
+ * The impulse response is split in segments of growing partition sizes:
+ * - the first "head" frames are convolved directly, sample by sample,
+ * - then come uniformly partitioned FFT stages of head, 4 * head, 16 * head... frames,
+ *   up to tail / 8, each one computed when a block of its size is complete,
+ * - from 2 * tail frames on, the rest is convolved with partitions of "tail" frames
+ *   on a thread of the convolver, with one block of time to do it.
+ *
+ * Thus the audio thread only does the direct head and the short FFTs,
+ * with a burst at each boundary of the largest stage. When the thread is late,
+ * process() waits for it.
+ *
+ * Channel c of the input is convolved with channel c of the impulse response, or its
+ * last channel if it has fewer, e.g. a mono impulse response for all the channels.
+ *
+ * reset() allocates and can take a while with long impulse responses:
+ * see ir_convolver to build it outside of the audio thread.
+ */
+template <typename FP>
+class convolver
+{
+public:
+  convolver() = default;
+  convolver(const convolver&) = delete;
+  convolver& operator=(const convolver&) = delete;
+  ~convolver() { stop(); }
+
+  // head and tail are rounded up to powers of two.
+  // threaded = false computes the tail in process(), e.g. for offline rendering.
+  template <typename T>
+  void reset(
+      const T* const* ir, int ir_channels, int64_t ir_frames, int channels,
+      int head = 64, int tail = 8192, bool threaded = true)
+  {
+    stop();
+
+    m_channels = std::max(channels, 0);
+    m_filters = std::max(ir_channels, 0);
+    m_head = pow2(std::max(head, 1));
+    m_tail = std::max(pow2(std::max(tail, 1)), 2 * m_head);
+    m_frames = 0;
+    m_stages.clear();
+    m_tail_stage.reset();
+    if (m_channels == 0 || m_filters == 0)
+      ir_frames = 0;
+
+    // Direct part, the taps reversed for the dot product with m_history
+    const int64_t L = std::max(ir_frames, int64_t(0));
+    m_head_taps.assign(m_filters, std::vector<FP>(m_head, FP(0)));
+    for (int f = 0; f < m_filters; f++)
+      for (int64_t i = 0; i < std::min(L, int64_t(m_head)); i++)
+        m_head_taps[f][m_head - 1 - i] = FP(ir[f][i]);
+    m_history.assign(m_channels, std::vector<FP>(2 * std::size_t(m_head), FP(0)));
+
+    // A stage of P frames needs its block complete before it can start,
+    // thus can start at P, or 2 * P when it is given the duration of a block to run
+    const bool has_tail = L > 2 * int64_t(m_tail);
+    const int64_t sync_end = has_tail ? 2 * int64_t(m_tail) : L;
+    for (int64_t begin = m_head, P = m_head; begin < sync_end; P *= 4)
+    {
+      const int64_t end = P * 4 <= m_tail / 8 ? std::min(P * 4, sync_end) : sync_end;
+      auto& st = m_stages.emplace_back(std::make_unique<detail::convolution_stage<FP>>());
+      st->reset(int(P), m_channels, m_filters);
+      st->set_filters(ir, L, begin, end);
+      begin = end;
+    }
+
+    if (has_tail)
+    {
+      m_tail_stage = std::make_unique<detail::convolution_stage<FP>>();
+      m_tail_stage->reset(m_tail, m_channels, m_filters);
+      m_tail_stage->set_filters(ir, L, 2 * int64_t(m_tail), L);
+      m_tail_input.assign(m_channels, std::vector<FP>(m_tail, FP(0)));
+      m_tail_output.assign(m_channels, std::vector<FP>(m_tail, FP(0)));
+
+      m_posted.store(0);
+      m_done.store(0);
+      m_stop.store(false);
+      if (threaded)
+        m_thread = std::thread{[this] { work(); }};
+    }
+  }
+
+  int channels() const noexcept { return m_channels; }
+
+  // Zero latency: out[c][i] gets the convolution up to in[c][i]. In-place is fine.
+  void process(const FP* const* in, FP* const* out, int channels, int frames) noexcept
+  {
+    channels = std::min(channels, m_channels);
+    if (m_filters == 0)
+    {
+      for (int c = 0; c < channels; c++)
+        std::fill_n(out[c], frames, FP(0));
+      return;
+    }
+
+    // Chunks never cross the boundary of a block of the head size,
+    // at which the blocks of all the stages end
+    for (int offset = 0; offset < frames;)
+    {
+      const int pos = int(m_frames % m_head);
+      const int len = std::min(frames - offset, m_head - pos);
+
+      for (int c = 0; c < channels; c++)
+        process_chunk(c, in[c] + offset, out[c] + offset, len);
+
+      offset += len;
+      m_frames += len;
+      if (m_frames % m_head == 0)
+        end_blocks(channels);
+    }
+  }
+
+  template <typename InBus, typename OutBus>
+    requires requires(InBus& i, OutBus& o) {
+      i.samples;
+      o.samples;
+    }
+  void process(const InBus& in, OutBus& out, int frames) noexcept
+  {
+    process(
+        in.samples, out.samples,
+        std::min(detail::bus_channels(in), detail::bus_channels(out)), frames);
+  }
+
+private:
+  static int pow2(int x) noexcept
+  {
+    int p = 1;
+    while (p < x)
+      p *= 2;
+    return p;
+  }
+
+  int filter(int c) const noexcept { return std::min(c, m_filters - 1); }
+
+  void process_chunk(int c, const FP* in, FP* out, int len) noexcept
+  {
+    const int H = m_head;
+    const int hpos = int(m_frames % H);
+    const FP* __restrict taps = m_head_taps[filter(c)].data();
+    FP* hist = m_history[c].data();
+
+    // Stored twice, so that the last H inputs are contiguous
+    for (int i = 0; i < len; i++)
+    {
+      const FP x = in[i];
+      const int w = (hpos + i) % H;
+      hist[w] = x;
+      hist[w + H] = x;
+
+      for (auto& st : m_stages)
+        st->block_input(c)[(m_frames + i) % st->size] = x;
+      if (m_tail_stage)
+        m_tail_input[c][(m_frames + i) % m_tail] = x;
+
+      const FP* __restrict h = hist + w + 1;
+      FP y = 0;
+      for (int k = 0; k < H; k++)
+        y += taps[k] * h[k];
+      out[i] = y;
+    }
+
+    for (auto& st : m_stages)
+    {
+      const FP* __restrict o = st->block_output(c) + (m_frames % st->size);
+      for (int i = 0; i < len; i++)
+        out[i] += o[i];
+    }
+
+    if (m_tail_stage)
+    {
+      const FP* __restrict o = m_tail_output[c].data() + (m_frames % m_tail);
+      for (int i = 0; i < len; i++)
+        out[i] += o[i];
+    }
+  }
+
+  void end_blocks(int channels) noexcept
+  {
+    for (auto& st : m_stages)
+      if (m_frames % st->size == 0)
+        for (int c = 0; c < channels; c++)
+          st->compute(c, filter(c));
+
+    if (m_tail_stage && m_frames % m_tail == 0)
+    {
+      // The result of the previous block is the output of the next one
+      const uint32_t posted = m_posted.load(std::memory_order_relaxed);
+      for (uint32_t d = m_done.load(std::memory_order_acquire); d != posted;
+           d = m_done.load(std::memory_order_acquire))
+        m_done.wait(d, std::memory_order_acquire);
+
+      for (int c = 0; c < m_channels; c++)
+      {
+        std::copy_n(m_tail_stage->block_output(c), m_tail, m_tail_output[c].data());
+        std::copy_n(m_tail_input[c].data(), m_tail, m_tail_stage->block_input(c));
+      }
+
+      if (m_thread.joinable())
+      {
+        m_posted.store(posted + 1, std::memory_order_release);
+        m_posted.notify_one();
+      }
+      else
+      {
+        compute_tail();
+      }
+    }
+  }
+
+  void compute_tail() noexcept
+  {
+    for (int c = 0; c < m_channels; c++)
+      m_tail_stage->compute(c, filter(c));
+  }
+
+  void work() noexcept
+  {
+    uint32_t seen = 0;
+    for (;;)
+    {
+      m_posted.wait(seen, std::memory_order_acquire);
+      seen = m_posted.load(std::memory_order_acquire);
+      if (m_stop.load(std::memory_order_acquire))
+        return;
+
+      compute_tail();
+      m_done.store(seen, std::memory_order_release);
+      m_done.notify_one();
+    }
+  }
+
+  void stop()
+  {
+    if (!m_thread.joinable())
+      return;
+
+    m_stop.store(true, std::memory_order_release);
+    m_posted.fetch_add(1, std::memory_order_release);
+    m_posted.notify_one();
+    m_thread.join();
+  }
+
+  int m_channels{};
+  int m_filters{};
+  int m_head{1};
+  int m_tail{};
+  int64_t m_frames{};
+
+  std::vector<std::vector<FP>> m_head_taps;
+  std::vector<std::vector<FP>> m_history;
+  std::vector<std::unique_ptr<detail::convolution_stage<FP>>> m_stages;
+
+  // Written by the audio thread while the worker computes the previous block
+  std::unique_ptr<detail::convolution_stage<FP>> m_tail_stage;
+  std::vector<std::vector<FP>> m_tail_input;
+  std::vector<std::vector<FP>> m_tail_output;
+
+  std::thread m_thread;
+  alignas(64) std::atomic<uint32_t> m_posted{0};
+  alignas(64) std::atomic<uint32_t> m_done{0};
+  std::atomic_bool m_stop{false};
+};
+
+/**
+ * A convolver with the impulse response of a soundfile port:
+ *
+ * halp::soundfile_port<"Impulse"> ir;
+ * halp::ir_convolver<double> reverb;
+ *
+ * void operator()(int frames) {
+ *   reverb.update(inputs.ir, inputs.audio.channels);
+ *   reverb.process(inputs.audio, outputs.audio, frames);
+ * }
+ *
+ * When the file or the channel count changes, the new convolver is built
+ * by avnd::background_worker and used once ready: until then the previous one
+ * keeps playing. The bindings free the replaced soundfiles on that same thread,
+ * after the jobs posted before, thus the file is still there when it is read.
+ * The previous convolvers are freed there too.
+ */
+template <typename FP>
+class ir_convolver
+{
+public:
+  ir_convolver() = default;
+  ir_convolver(const ir_convolver&) = delete;
+  ir_convolver& operator=(const ir_convolver&) = delete;
+  ~ir_convolver()
+  {
+    m_state->generation++;
+    if (m_current)
+      avnd::background_worker::shared().post(
+          [c = std::shared_ptr<convolver<FP>>(std::move(m_current))] {});
+  }
+
+  void set_partitions(int head, int tail) noexcept
+  {
+    m_head = head;
+    m_tail = tail;
+  }
+
+  // To be called by the audio thread before processing.
+  // Returns whether the convolver changed.
+  bool update(const soundfile_view& ir, int channels)
+  {
+    if (ir.data != m_data || ir.frames != m_ir_frames || ir.channels != m_ir_channels
+        || channels != m_channels)
+    {
+      m_data = ir.data;
+      m_ir_frames = ir.frames;
+      m_ir_channels = ir.channels;
+      m_channels = channels;
+
+      const uint64_t generation = ++m_state->generation;
+      avnd::background_worker::shared().post(
+          [state = m_state, ir, generation, channels, head = m_head, tail = m_tail] {
+        if (state->generation.load() != generation)
+          return;
+
+        auto conv = std::make_unique<convolver<FP>>();
+        if (ir.data && ir.frames > 0)
+          conv->reset(ir.data, ir.channels, ir.frames, channels, head, tail);
+
+        if (state->generation.load() == generation)
+          delete state->ready.exchange(conv.release());
+      });
+    }
+
+    auto* ready = m_state->ready.exchange(nullptr);
+    if (!ready)
+      return false;
+
+    if (m_current)
+      avnd::background_worker::shared().post(
+          [c = std::shared_ptr<convolver<FP>>(std::move(m_current))] {});
+    m_current.reset(ready);
+    return true;
+  }
+
+  // Silence until a convolver is ready
+  void process(const FP* const* in, FP* const* out, int channels, int frames) noexcept
+  {
+    if (m_current)
+      m_current->process(in, out, channels, frames);
+    else
+      for (int c = 0; c < channels; c++)
+        std::fill_n(out[c], frames, FP(0));
+  }
+
+  template <typename InBus, typename OutBus>
+  void process(const InBus& in, OutBus& out, int frames) noexcept
+  {
+    if (m_current)
+      m_current->process(in, out, frames);
+    else
+      for (int c = 0; c < detail::bus_channels(out); c++)
+        std::fill_n(out.samples[c], frames, FP(0));
+  }
+
+private:
+  struct state
+  {
+    std::atomic<uint64_t> generation{0};
+    std::atomic<convolver<FP>*> ready{nullptr};
+    ~state() { delete ready.load(); }
+  };
+
+  std::shared_ptr<state> m_state = std::make_shared<state>();
+  std::unique_ptr<convolver<FP>> m_current;
+
+  const float** m_data{};
+  int64_t m_ir_frames{};
+  int32_t m_ir_channels{};
+  int m_channels{};
+  int m_head{64};
+  int m_tail{8192};
+};
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/span_polyfill.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Approximations of libm functions for the audio thread, e.g. for a waveshaper:
+ *
+ * out[i] = halp::fastmath::tanh<halp::fastmath::accuracy::low>(gain * in[i]);
+ *
+ * or on a whole buffer, which the compiler vectorizes:
+ *
+ * halp::fastmath::tanh(avnd::span<float>(out, frames));
+ *
+ * They have no branch nor table and are constexpr. The maximum errors, checked
+ * against libm by tests/test_fastmath.cpp, are for double; float adds its own rounding,
+ * a few 1e-7:
+ *
+ *            low      medium   high
+ *   exp2     9e-5     9e-8     5e-11   relative
+ *   log2     6e-6     3e-8     2e-10   absolute
+ *   sin      7e-5     6e-7     4e-9    absolute
+ *   tanh     5e-5     5e-8     3e-11   absolute
+ *
+ * The float batches vectorize with SSE2; the double ones need 64-bit integer vectors
+ * for the exponents, e.g. AVX2.
+ *
+ * Unlike std::, they do not handle NaN nor infinities:
+ * exp2 saturates to the range of the normal numbers, log2 expects x > 0,
+ * and sin reduces its argument at FP precision, thus loses accuracy as |x| grows.
+ */
+namespace halp::fastmath
+{
+enum class accuracy
+{
+  low,
+  medium,
+  high
+};
+
+namespace detail
+{
+template <typename FP>
+struct ieee;
+
+template <>
+struct ieee<float>
+{
+  using bits = uint32_t;
+  static constexpr int mantissa = 23;
+  static constexpr int bias = 127;
+};
+
+template <>
+struct ieee<double>
+{
+  using bits = uint64_t;
+  static constexpr int mantissa = 52;
+  static constexpr int bias = 1023;
+};
+
+// Minimax polynomials, the coefficients go from the lowest degree up
+template <accuracy>
+struct exp2_poly;
+template <>
+struct exp2_poly<accuracy::low>
+{
+  static constexpr double c[] = {0.6951167864133907, 0.22764499119524612, 0.07706704200379226};
+};
+template <>
+struct exp2_poly<accuracy::medium>
+{
+  static constexpr double c[]
+      = {0.6931513118048814, 0.24016445015285626, 0.05579991310971214,
+         0.009017030315845952, 0.001867130072458681};
+};
+template <>
+struct exp2_poly<accuracy::high>
+{
+  static constexpr double c[]
+      = {0.6931471843442121,   0.240226405116519,    0.05550502301835252,
+         0.00961428317806138,  0.001341901563301439, 0.00014377207857853066,
+         2.1430614590387856e-05};
+};
+
+template <accuracy>
+struct log2_poly;
+template <>
+struct log2_poly<accuracy::low>
+{
+  static constexpr double c[] = {2.8852285696103537, 0.9835345091490658};
+};
+template <>
+struct log2_poly<accuracy::medium>
+{
+  static constexpr double c[] = {2.885391289368968, 0.9614708089491825, 0.5989738858040066};
+};
+template <>
+struct log2_poly<accuracy::high>
+{
+  static constexpr double c[]
+      = {2.885390072752169, 0.9618007592095409, 0.5765845414814419, 0.4342559398087534};
+};
+
+template <accuracy>
+struct sin_poly;
+template <>
+struct sin_poly<accuracy::low>
+{
+  static constexpr double c[] = {6.281280076633484, -41.09524268765419, 73.58551473981103};
+};
+template <>
+struct sin_poly<accuracy::medium>
+{
+  static constexpr double c[]
+      = {6.283164044302284, -41.33714237108171, 81.34076888715423, -70.99343326782008};
+};
+template <>
+struct sin_poly<accuracy::high>
+{
+  static constexpr double c[]
+      = {6.283185160089478, -41.34165503141657, 81.6010040732821, -76.5497822940875,
+         39.536706069501406};
+};
+
+// Unrolled: a loop left there would keep the callers from being vectorized
+template <typename FP, std::size_t N, std::size_t... K>
+constexpr FP horner(FP x, const double (&c)[N], std::index_sequence<K...>) noexcept
+{
+  FP r = FP(c[N - 1]);
+  ((r = r * x + FP(c[N - 2 - K])), ...);
+  return r;
+}
+
+template <typename FP, std::size_t N>
+constexpr FP horner(FP x, const double (&c)[N]) noexcept
+{
+  return detail::horner(x, c, std::make_index_sequence<N - 1>{});
+}
+
+// |x| clamped to hi, with the sign of x.
+// Done on the bits, as a comparison of floats would stay a branch:
+// the compilers do not turn those into selects unless allowed to ignore the NaNs
+template <typename FP>
+constexpr FP clamp_magnitude(FP x, FP hi) noexcept
+{
+  using bits = typename ieee<FP>::bits;
+  constexpr bits sign = bits(1) << (sizeof(FP) * 8 - 1);
+  const bits u = std::bit_cast<bits>(x);
+  return std::bit_cast<FP>(std::min(u & ~sign, std::bit_cast<bits>(hi)) | (u & sign));
+}
+
+// Without std::floor, which is neither constexpr nor always inlined
+template <typename FP>
+constexpr int floor_int(FP x) noexcept
+{
+  const int i = int(x);
+  return i - int(FP(i) > x);
+}
+}
+
+// 2^x, with x clamped to the exponents of the normal numbers
+template <accuracy A = accuracy::medium, std::floating_point FP>
+constexpr FP exp2(FP x) noexcept
+{
+  using ieee = detail::ieee<FP>;
+  using bits = typename ieee::bits;
+
+  x = detail::clamp_magnitude(x, FP(ieee::bias - 1));
+  const int i = detail::floor_int(x);
+  const FP f = x - FP(i);
+
+  // Exact on the integers: the polynomial is 1 + f * p(f)
+  const FP scale = std::bit_cast<FP>(bits(i + ieee::bias) << ieee::mantissa);
+  return (FP(1) + f * detail::horner(f, detail::exp2_poly<A>::c)) * scale;
+}
+
+// log2(x) for x > 0; denormals are taken as the smallest normal number
+template <accuracy A = accuracy::medium, std::floating_point FP>
+constexpr FP log2(FP x) noexcept
+{
+  using ieee = detail::ieee<FP>;
+  using bits = typename ieee::bits;
+  constexpr bits mantissa_mask = (bits(1) << ieee::mantissa) - 1;
+  constexpr bits one = bits(ieee::bias) << ieee::mantissa;
+
+  using sbits = std::make_signed_t<bits>;
+  const sbits smallest = std::bit_cast<sbits>(std::numeric_limits<FP>::min());
+  const bits u = bits(std::max(std::bit_cast<sbits>(x), smallest));
+  // x = 2^e m with m in [sqrt(0.5); sqrt(2)[, where log2(m) = log2((1 + t) / (1 - t))
+  // is odd in t
+  constexpr bits sqrt2 = std::bit_cast<bits>(FP(1.4142135623730950488)) & mantissa_mask;
+  const bits above = bits((u & mantissa_mask) > sqrt2);
+  const int e = int(u >> ieee::mantissa) - ieee::bias + int(above);
+  const FP m = std::bit_cast<FP>((u & mantissa_mask) | (one - (above << ieee::mantissa)));
+
+  const FP t = (m - FP(1)) / (m + FP(1));
+  return FP(e) + t * detail::horner(t * t, detail::log2_poly<A>::c);
+}
+
+template <accuracy A = accuracy::medium, std::floating_point FP>
+constexpr FP sin(FP x) noexcept
+{
+  // In periods, reduced to [-0.5; 0.5] then by symmetry to [-0.25; 0.25]
+  FP r = x * FP(0.15915494309189533577);
+  r = detail::clamp_magnitude(r, FP(1e9));
+  r -= FP(detail::floor_int(r + FP(0.5)));
+  const FP mirror = (r < FP(0) ? FP(-0.5) : FP(0.5)) - r;
+  r = (r < FP(-0.25) || r > FP(0.25)) ? mirror : r;
+  return r * detail::horner(r * r, detail::sin_poly<A>::c);
+}
+
+template <accuracy A = accuracy::medium, std::floating_point FP>
+constexpr FP tanh(FP x) noexcept
+{
+  // 1 - 2 / (e^2|x| + 1): the error is at most half the one of exp2,
+  // tanh(0) is 0 and the result is odd, i.e. a waveshaper does not add DC
+  const FP sign = x < FP(0) ? FP(-1) : FP(1);
+  const FP e = fastmath::exp2<A>(sign * x * FP(2.8853900817779268147));
+  return sign * (FP(1) - FP(2) / (e + FP(1)));
+}
+
+// Batches: the functions being inlined without a branch, these loops vectorize
+// (at -O3 for GCC, which does not vectorize at -O2 the loops needing an epilogue).
+// out may not overlap in, the overloads with a single buffer work in-place.
+#define HALP_FASTMATH_BATCH(func)                                                     \
+  template <accuracy A = accuracy::medium, std::floating_point FP>                    \
+  void func(const FP* __restrict in, FP* __restrict out, int n) noexcept              \
+  {                                                                                   \
+    for (int i = 0; i < n; i++)                                                       \
+      out[i] = fastmath::func<A>(in[i]);                                              \
+  }                                                                                   \
+  template <accuracy A = accuracy::medium, std::floating_point FP>                    \
+  void func(FP* __restrict x, int n) noexcept                                         \
+  {                                                                                   \
+    for (int i = 0; i < n; i++)                                                       \
+      x[i] = fastmath::func<A>(x[i]);                                                 \
+  }                                                                                   \
+  template <accuracy A = accuracy::medium, std::floating_point FP>                    \
+  void func(std::type_identity_t<avnd::span<const FP>> in, avnd::span<FP> out) noexcept \
+  {                                                                                   \
+    fastmath::func<A>(in.data(), out.data(), int(std::min(in.size(), out.size())));   \
+  }                                                                                   \
+  template <accuracy A = accuracy::medium, std::floating_point FP>                    \
+  void func(avnd::span<FP> x) noexcept                                                \
+  {                                                                                   \
+    fastmath::func<A>(x.data(), int(x.size()));                                       \
+  }
+
+HALP_FASTMATH_BATCH(exp2)
+HALP_FASTMATH_BATCH(log2)
+HALP_FASTMATH_BATCH(sin)
+HALP_FASTMATH_BATCH(tanh)
+
+#undef HALP_FASTMATH_BATCH
+}
@@ -1,83 +1,225 @@
 #pragma once
 #include <avnd/concepts/fft.hpp>
 
-#include <vector>
-#include <complex>
+#include <cassert>
 #include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
 
 namespace halp
 {
 namespace detail
 {
-// Minimal implementation taken from https://gist.github.com/lukicdarkoo/3f0d056e9244784f8b4a
-// Instead go use fftw, MKL, KFR or whatever !
-template<typename FP>
-static void fft_rec(std::complex<FP> *x, int N)
+// Minimal planned FFT: radix-2 decimation-in-time with the first two stages
+// merged in a radix-4 butterfly. All the tables are computed in reset(),
+// execution does not allocate nor calls any transcendental function.
+// Instead go use fftw, MKL, KFR or whatever if you need more !
+template <typename FP>
+struct fft_plan
 {
-  using namespace std;
   using cplx = std::complex<FP>;
-  static constexpr double pi = 3.141592653589793238462643383279502884;
 
-  // Check if it is splitted enough
-  if (N <= 1) {
-    return;
+  // Size of the complex transform
+  std::size_t size{};
+
+  // Interleaved real / imaginary parts of exp(-2 i pi j / size), for j < size / 2.
+  // Kept as scalars: copying std::complex out of the table otherwise
+  // ends up in a store-forwarding stall in the inner loop.
+  std::vector<FP> twiddles;
+
+  // Index permutation applied before the butterflies
+  std::vector<uint32_t> bitrev;
+
+  void reset(std::size_t N)
+  {
+    static constexpr double pi = 3.141592653589793238462643383279502884;
+    assert(N == 0 || (N & (N - 1)) == 0);
+
+    size = N;
+    twiddles.resize(N);
+    for (std::size_t j = 0; j < N / 2; j++)
+    {
+      const double phase = -2. * pi * double(j) / double(N);
+      twiddles[2 * j] = FP(std::cos(phase));
+      twiddles[2 * j + 1] = FP(std::sin(phase));
+    }
+
+    int bits = 0;
+    while ((std::size_t(1) << bits) < N)
+      bits++;
+
+    bitrev.resize(N);
+    for (std::size_t i = 0; i < N; i++)
+    {
+      uint32_t r = 0;
+      for (int b = 0; b < bits; b++)
+        r |= ((i >> b) & 1) << (bits - 1 - b);
+      bitrev[i] = r;
+    }
   }
 
-  // Split even and odd
-  auto* odd = (cplx*)alloca(sizeof(cplx) * (1 + N/2));
-  auto* even = (cplx*)alloca(sizeof(cplx) * (1 + N/2));
-  for (int i = 0; i < N / 2; i++) {
-    even[i] = x[i*2];
-    odd[i] = x[i*2+1];
+  // std::complex operator* goes through __mulsc3 and its NaN handling
+  // unless -ffast-math is set, thus we do it by hand
+  static cplx mul(cplx a, cplx b) noexcept
+  {
+    return {
+        a.real() * b.real() - a.imag() * b.imag(),
+        a.real() * b.imag() + a.imag() * b.real()};
   }
 
-  // Split on tasks
-  fft_rec(even, N/2);
-  fft_rec(odd, N/2);
+  // In-place complex transform of "size" elements, not normalized.
+  // Inverse = true computes sum_k x[k] exp(+2 i pi j k / size).
+  template <bool Inverse>
+  void execute(cplx* x) const noexcept
+  {
+    const std::size_t N = size;
+    if (N <= 1)
+      return;
+
+    for (std::size_t i = 0; i < N; i++)
+    {
+      const std::size_t r = bitrev[i];
+      if (i < r)
+        std::swap(x[i], x[r]);
+    }
+
+    if (N == 2)
+    {
+      const cplx a = x[0], b = x[1];
+      x[0] = a + b;
+      x[1] = a - b;
+      return;
+    }
 
-  // Calculate DFT
-  for (int k = 0; k < N / 2; k++) {
-    cplx t = std::exp(cplx(0, -2 * pi * k / N)) * odd[k];
-    x[k] = even[k] + t;
-    x[N / 2 + k] = even[k] - t;
+    // First two stages: 4-point DFTs, the only twiddles are 1 and -i (or i for the inverse)
+    for (std::size_t i = 0; i < N; i += 4)
+    {
+      const cplx b0 = x[i] + x[i + 1];
+      const cplx b1 = x[i] - x[i + 1];
+      const cplx b2 = x[i + 2] + x[i + 3];
+      const cplx d = x[i + 2] - x[i + 3];
+      const cplx b3 = Inverse ? cplx{-d.imag(), d.real()} : cplx{d.imag(), -d.real()};
+
+      x[i] = b0 + b2;
+      x[i + 1] = b1 + b3;
+      x[i + 2] = b0 - b2;
+      x[i + 3] = b1 - b3;
+    }
+
+    // Remaining radix-2 stages
+    for (std::size_t len = 8; len <= N; len <<= 1)
+    {
+      const std::size_t half = len / 2;
+      const std::size_t step = 2 * N / len;
+      const FP* __restrict tw = twiddles.data();
+      for (std::size_t i = 0; i < N; i += len)
+      {
+        FP* __restrict lo = reinterpret_cast<FP*>(x + i);
+        FP* __restrict hi = reinterpret_cast<FP*>(x + i + half);
+        for (std::size_t j = 0; j < half; j++)
+        {
+          const FP wr = tw[j * step];
+          const FP wi = Inverse ? -tw[j * step + 1] : tw[j * step + 1];
+
+          const FP hr = hi[2 * j], hi_ = hi[2 * j + 1];
+          const FP vr = hr * wr - hi_ * wi;
+          const FP vi = hr * wi + hi_ * wr;
+          const FP ur = lo[2 * j], ui = lo[2 * j + 1];
+
+          lo[2 * j] = ur + vr;
+          lo[2 * j + 1] = ui + vi;
+          hi[2 * j] = ur - vr;
+          hi[2 * j + 1] = ui - vi;
+        }
+      }
+    }
   }
-}
+};
 }
 
-template<typename FP>
+/**
+ * Real FFT of power-of-two sizes.
+ *
+ * The N real samples are packed into a N/2 complex transform, whose result
+ * is then split into the N/2 + 1 bins of the real spectrum.
+ *
+ * - execute(real*, N) returns N complex bins; bins above N/2 are the conjugate mirror
+ *   of the lower ones.
+ * - execute(complex*, N) reads the bins [0; N/2] of a conjugate-symmetric spectrum and
+ *   returns the N real samples, not normalized: multiply by normalization(N) to get
+ *   back the original signal. It can be passed the pointer returned by the forward transform.
+ *
+ * Calling reset(N) beforehand is needed to be allocation-free.
+ */
+template <typename FP>
 class fft
 {
 public:
-  template<typename T>
+  template <typename T>
   using fft_type = fft<T>;
 
   using real_type = FP;
   using complex_type = std::complex<FP>;
 
-  constexpr double normalization(std::size_t N)
-  {
-     return 1. / N;
-  }
+  constexpr double normalization(std::size_t N) { return 1. / N; }
 
   void reset(std::size_t N)
   {
+    m_size = N;
     m_cplx.resize(N + 1);
     m_real.resize(N + 1);
+    m_plan.reset(N / 2);
+
+    // split[k] = exp(-2 i pi k / N), for k < N / 2
+    static constexpr double pi = 3.141592653589793238462643383279502884;
+    m_split.resize(N / 2);
+    for (std::size_t k = 0; k < N / 2; k++)
+    {
+      const double phase = -2. * pi * double(k) / double(N);
+      m_split[k] = complex_type(FP(std::cos(phase)), FP(std::sin(phase)));
+    }
   }
 
   // Real to complex
   complex_type* execute(real_type* x_in, std::size_t N)
   {
-    if(m_cplx.size() != N + 1) {
-      m_cplx.resize(N + 1);
-    }
+    if (m_size != N)
+      reset(N);
 
     auto x_out = m_cplx.data();
-    for (int i = 0; i < N; i++) {
-      x_out[i] = {x_in[i], 0};
+    if (N < 2)
+    {
+      if (N == 1)
+        x_out[0] = {x_in[0], 0};
+      return x_out;
+    }
+
+    const std::size_t M = N / 2;
+    for (std::size_t i = 0; i < M; i++)
+      x_out[i] = {x_in[2 * i], x_in[2 * i + 1]};
+
+    m_plan.template execute<false>(x_out);
+
+    // Split the transform of the even / odd samples:
+    // X[k] = E[k] + W^k O[k],
+    // with E[k] = (Z[k] + Z*[M-k]) / 2 and O[k] = -i (Z[k] - Z*[M-k]) / 2
+    const complex_type z0 = x_out[0];
+    x_out[0] = {z0.real() + z0.imag(), 0};
+    x_out[M] = {z0.real() - z0.imag(), 0};
+
+    for (std::size_t k = 1; k <= M / 2; k++)
+    {
+      const complex_type a = x_out[k];
+      const complex_type b = x_out[M - k];
+
+      x_out[k] = split(a, b, m_split[k]);
+      if (k != M - k)
+        x_out[M - k] = split(b, a, m_split[M - k]);
     }
 
-    detail::fft_rec(x_out, N);
+    for (std::size_t k = 1; k < M; k++)
+      x_out[N - k] = std::conj(x_out[k]);
 
     return x_out;
   }
@@ -85,31 +227,69 @@ public:
   // Complex to real
   real_type* execute(complex_type* x_in, std::size_t N)
   {
-    if(m_cplx.size() != N + 1) {
-      m_cplx.resize(N + 1);
-    }
-    if(m_real.size() != N + 1) {
-      m_real.resize(N + 1);
+    if (m_size != N)
+      reset(N);
+
+    auto x_out = m_real.data();
+    if (N < 2)
+    {
+      if (N == 1)
+        x_out[0] = x_in[0].real();
+      return x_out;
     }
 
-    auto cplx = m_cplx.data();
-    for (int i = 0; i < N; i++) {
-      cplx[i] = {x_in[i].imag(), x_in[i].real()};
+    // Inverse of the split step, done pairwise so that x_in may alias m_cplx:
+    // Z[k] = (X[k] + X*[M-k]) + i W^-k (X[k] - X*[M-k])
+    const std::size_t M = N / 2;
+    auto z = m_cplx.data();
+
+    const FP x0 = x_in[0].real();
+    const FP xm = x_in[M].real();
+    for (std::size_t k = 1; k <= M / 2; k++)
+    {
+      const complex_type a = x_in[k];
+      const complex_type b = x_in[M - k];
+
+      z[k] = unsplit(a, b, m_split[k]);
+      if (k != M - k)
+        z[M - k] = unsplit(b, a, m_split[M - k]);
     }
+    z[0] = {x0 + xm, x0 - xm};
 
-    detail::fft_rec(cplx, N);
+    m_plan.template execute<true>(z);
 
-    auto x_out = m_real.data();
-    for (int i = 0; i < N; i++) {
-        x_out[i] = cplx[i].imag();
+    for (std::size_t i = 0; i < M; i++)
+    {
+      x_out[2 * i] = z[i].real();
+      x_out[2 * i + 1] = z[i].imag();
     }
 
     return x_out;
   }
 
 private:
+  static complex_type split(complex_type a, complex_type b, complex_type w) noexcept
+  {
+    const complex_type bc = std::conj(b);
+    const complex_type e = (a + bc) * FP(0.5);
+    const complex_type d = (a - bc) * FP(0.5);
+    const complex_type o{d.imag(), -d.real()};
+    return e + detail::fft_plan<FP>::mul(w, o);
+  }
+
+  static complex_type unsplit(complex_type a, complex_type b, complex_type w) noexcept
+  {
+    const complex_type bc = std::conj(b);
+    const complex_type e = a + bc;
+    const complex_type o = detail::fft_plan<FP>::mul(std::conj(w), a - bc);
+    return {e.real() - o.imag(), e.imag() + o.real()};
+  }
+
+  detail::fft_plan<FP> m_plan;
+  std::vector<std::complex<FP>> m_split;
   std::vector<std::complex<FP>> m_cplx;
   std::vector<FP> m_real;
+  std::size_t m_size{};
 };
 
 template <typename C, typename FP>
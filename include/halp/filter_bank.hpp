@@ -0,0 +1,359 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/span_polyfill.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace halp
+{
+enum class filter_response
+{
+  lowpass,
+  highpass,
+  bandpass, // 0 dB at the cutoff
+  notch,
+  allpass,
+  bell,     // gain_db at the cutoff
+  low_shelf,
+  high_shelf
+};
+
+/**
+ * A bank of state-variable filters (the trapezoidal SVF of A. Simper) for running
+ * many of them at once, e.g. one per channel of a bus or one per band of an analyzer.
+ *
+ * The coefficients and the states are stored as arrays across the filters,
+ * and the samples are processed in blocks transposed so that the inner loop
+ * goes over the filters: the compiler vectorizes it, running 4, 8 or 16 filters
+ * per instruction depending on the target.
+ *
+ * When smoothing is set, new coefficients are reached by linear interpolation
+ * over that many frames: this SVF stays stable while its coefficients move,
+ * and they are only computed once per set() call.
+ *
+ * resize() allocates, process_*() does not.
+ */
+template <typename FP>
+class svf_bank
+{
+public:
+  // Frames processed per transposed block
+  static constexpr int block = 64;
+
+  void resize(int filters)
+  {
+    m_size = filters;
+    // Padded so that the vectorized loops do not need a scalar tail
+    const std::size_t n = (std::size_t(std::max(filters, 0)) + 15) / 16 * 16;
+    for (auto* v : {&m_a1, &m_a2, &m_a3, &m_m0, &m_m1, &m_m2, &m_ic1, &m_ic2})
+      v->assign(n, FP(0));
+    for (auto* v : {&m_da1, &m_da2, &m_da3, &m_dm0, &m_dm1, &m_dm2})
+      v->assign(n, FP(0));
+    m_target.assign(n, {});
+    m_ramp.assign(n, 0);
+    m_x.assign(n * block, FP(0));
+    m_ramping = false;
+  }
+
+  int size() const noexcept { return m_size; }
+
+  // How many frames new coefficients take to be reached, 0 for immediately
+  void set_smoothing(int frames) noexcept { m_smoothing = std::max(frames, 0); }
+
+  // Clears the memory of the filters, e.g. when the playback restarts
+  void reset() noexcept
+  {
+    std::fill(m_ic1.begin(), m_ic1.end(), FP(0));
+    std::fill(m_ic2.begin(), m_ic2.end(), FP(0));
+  }
+
+  // Not for the audio thread if called for many filters at each buffer:
+  // computing the coefficients calls tan() and pow().
+  void set(
+      int i, filter_response r, double frequency, double q, double rate,
+      double gain_db = 0.) noexcept
+  {
+    if (i < 0 || i >= m_size || rate <= 0.)
+      return;
+
+    auto c = coefficients(r, frequency, q, rate, gain_db);
+    if (m_smoothing == 0)
+    {
+      m_a1[i] = c.a1;
+      m_a2[i] = c.a2;
+      m_a3[i] = c.a3;
+      m_m0[i] = c.m0;
+      m_m1[i] = c.m1;
+      m_m2[i] = c.m2;
+      stop_ramp(i);
+      return;
+    }
+
+    const FP steps = FP(m_smoothing);
+    m_target[i] = c;
+    m_ramp[i] = m_smoothing;
+    m_da1[i] = (c.a1 - m_a1[i]) / steps;
+    m_da2[i] = (c.a2 - m_a2[i]) / steps;
+    m_da3[i] = (c.a3 - m_a3[i]) / steps;
+    m_dm0[i] = (c.m0 - m_m0[i]) / steps;
+    m_dm1[i] = (c.m1 - m_m1[i]) / steps;
+    m_dm2[i] = (c.m2 - m_m2[i]) / steps;
+    m_ramping = true;
+  }
+
+  // Filter c processes channel c, e.g. of a dynamic_audio_bus. In-place is fine.
+  void process_channels(const FP* const* in, FP* const* out, int channels, int frames) noexcept
+  {
+    const int n = std::min(channels, m_size);
+    run(frames, n,
+        [&](int offset, int len) {
+          for (int c = 0; c < n; c++)
+            for (int j = 0; j < len; j++)
+              m_x[std::size_t(j) * stride() + c] = in[c][offset + j];
+          // The filters without a channel get silence
+          for (int j = 0; j < len; j++)
+            std::fill(
+                m_x.begin() + std::size_t(j) * stride() + n,
+                m_x.begin() + std::size_t(j + 1) * stride(), FP(0));
+        },
+        [&](int offset, int len) {
+          for (int c = 0; c < n; c++)
+            for (int j = 0; j < len; j++)
+              out[c][offset + j] = m_x[std::size_t(j) * stride() + c];
+        });
+  }
+
+  template <typename InBus, typename OutBus>
+    requires requires(InBus& i, OutBus& o) {
+      i.samples;
+      o.samples;
+    }
+  void process_channels(const InBus& in, OutBus& out, int frames) noexcept
+  {
+    process_channels(in.samples, out.samples, std::min(channels(in), channels(out)), frames);
+  }
+
+  // All the filters get the same input, filter b writing in out[b]
+  void process_bands(const FP* in, FP* const* out, int frames) noexcept
+  {
+    const int n = m_size;
+    run(frames, n,
+        [&](int offset, int len) {
+          for (int j = 0; j < len; j++)
+            std::fill_n(m_x.data() + std::size_t(j) * stride(), n, in[offset + j]);
+        },
+        [&](int offset, int len) {
+          for (int b = 0; b < n; b++)
+            for (int j = 0; j < len; j++)
+              out[b][offset + j] = m_x[std::size_t(j) * stride() + b];
+        });
+  }
+
+  void process_bands(avnd::span<const FP> in, avnd::span<FP*> out) noexcept
+  {
+    if (int(out.size()) >= m_size)
+      process_bands(in.data(), out.data(), int(in.size()));
+  }
+
+private:
+  struct coeffs
+  {
+    FP a1{}, a2{}, a3{}, m0{}, m1{}, m2{};
+  };
+
+  static coeffs
+  coefficients(filter_response r, double frequency, double q, double rate, double gain_db) noexcept
+  {
+    static constexpr double pi = 3.141592653589793238462643383279502884;
+    const double f = std::clamp(frequency, 1e-3, 0.49 * rate);
+    const double A = std::pow(10., gain_db / 40.);
+    double g = std::tan(pi * f / rate);
+    double k = 1. / std::max(q, 1e-3);
+    double m0 = 0., m1 = 0., m2 = 0.;
+
+    switch (r)
+    {
+      case filter_response::lowpass:
+        m2 = 1.;
+        break;
+      case filter_response::highpass:
+        m0 = 1.;
+        m1 = -k;
+        m2 = -1.;
+        break;
+      case filter_response::bandpass:
+        m1 = k;
+        break;
+      case filter_response::notch:
+        m0 = 1.;
+        m1 = -k;
+        break;
+      case filter_response::allpass:
+        m0 = 1.;
+        m1 = -2. * k;
+        break;
+      case filter_response::bell:
+        k /= A;
+        m0 = 1.;
+        m1 = k * (A * A - 1.);
+        break;
+      case filter_response::low_shelf:
+        g /= std::sqrt(A);
+        m0 = 1.;
+        m1 = k * (A - 1.);
+        m2 = A * A - 1.;
+        break;
+      case filter_response::high_shelf:
+        g *= std::sqrt(A);
+        m0 = A * A;
+        m1 = k * (1. - A) * A;
+        m2 = 1. - A * A;
+        break;
+    }
+
+    const double a1 = 1. / (1. + g * (g + k));
+    const double a2 = g * a1;
+    const double a3 = g * a2;
+    return {FP(a1), FP(a2), FP(a3), FP(m0), FP(m1), FP(m2)};
+  }
+
+  template <typename Bus>
+  static int channels(const Bus& bus) noexcept
+  {
+    if constexpr (requires { bus.channels(); })
+      return bus.channels();
+    else
+      return bus.channels;
+  }
+
+  std::size_t stride() const noexcept { return m_ic1.size(); }
+
+  void stop_ramp(int i) noexcept
+  {
+    m_ramp[i] = 0;
+    m_da1[i] = m_da2[i] = m_da3[i] = FP(0);
+    m_dm0[i] = m_dm1[i] = m_dm2[i] = FP(0);
+  }
+
+  // Blocks end where a ramp does, so that no coefficient goes past its target
+  int block_length(int frames) const noexcept
+  {
+    int len = std::min(frames, block);
+    if (m_ramping)
+      for (int i = 0; i < m_size; i++)
+        if (m_ramp[i] > 0)
+          len = std::min(len, m_ramp[i]);
+    return len;
+  }
+
+  void end_ramps(int len) noexcept
+  {
+    if (!m_ramping)
+      return;
+
+    m_ramping = false;
+    for (int i = 0; i < m_size; i++)
+    {
+      if (m_ramp[i] <= 0)
+        continue;
+      m_ramp[i] -= len;
+      if (m_ramp[i] > 0)
+      {
+        m_ramping = true;
+        continue;
+      }
+
+      // Snapped to the target so that rounding errors do not accumulate
+      const auto& c = m_target[i];
+      m_a1[i] = c.a1;
+      m_a2[i] = c.a2;
+      m_a3[i] = c.a3;
+      m_m0[i] = c.m0;
+      m_m1[i] = c.m1;
+      m_m2[i] = c.m2;
+      stop_ramp(i);
+    }
+  }
+
+  template <typename Load, typename Store>
+  void run(int frames, int n, Load&& load, Store&& store) noexcept
+  {
+    if (n <= 0)
+      return;
+
+    for (int offset = 0; offset < frames;)
+    {
+      const int len = block_length(frames - offset);
+      load(offset, len);
+      if (m_ramping)
+        filter<true>(len);
+      else
+        filter<false>(len);
+      store(offset, len);
+      end_ramps(len);
+      offset += len;
+    }
+  }
+
+  template <bool Ramp>
+  void filter(int len) noexcept
+  {
+    const std::size_t n = stride();
+    FP* __restrict a1 = m_a1.data();
+    FP* __restrict a2 = m_a2.data();
+    FP* __restrict a3 = m_a3.data();
+    FP* __restrict m0 = m_m0.data();
+    FP* __restrict m1 = m_m1.data();
+    FP* __restrict m2 = m_m2.data();
+    FP* __restrict ic1 = m_ic1.data();
+    FP* __restrict ic2 = m_ic2.data();
+    const FP* __restrict da1 = m_da1.data();
+    const FP* __restrict da2 = m_da2.data();
+    const FP* __restrict da3 = m_da3.data();
+    const FP* __restrict dm0 = m_dm0.data();
+    const FP* __restrict dm1 = m_dm1.data();
+    const FP* __restrict dm2 = m_dm2.data();
+
+    for (int j = 0; j < len; j++)
+    {
+      FP* __restrict x = m_x.data() + std::size_t(j) * n;
+      for (std::size_t k = 0; k < n; k++)
+      {
+        const FP v3 = x[k] - ic2[k];
+        const FP v1 = a1[k] * ic1[k] + a2[k] * v3;
+        const FP v2 = ic2[k] + a2[k] * ic1[k] + a3[k] * v3;
+        ic1[k] = FP(2) * v1 - ic1[k];
+        ic2[k] = FP(2) * v2 - ic2[k];
+        x[k] = m0[k] * x[k] + m1[k] * v1 + m2[k] * v2;
+
+        if constexpr (Ramp)
+        {
+          a1[k] += da1[k];
+          a2[k] += da2[k];
+          a3[k] += da3[k];
+          m0[k] += dm0[k];
+          m1[k] += dm1[k];
+          m2[k] += dm2[k];
+        }
+      }
+    }
+  }
+
+  int m_size{};
+  int m_smoothing{};
+  bool m_ramping{};
+  std::vector<FP> m_a1, m_a2, m_a3, m_m0, m_m1, m_m2;
+  std::vector<FP> m_da1, m_da2, m_da3, m_dm0, m_dm1, m_dm2;
+  std::vector<FP> m_ic1, m_ic2;
+  std::vector<coeffs> m_target;
+  std::vector<int> m_ramp;
+
+  // The samples of a block, transposed: m_x[frame * stride() + filter]
+  std::vector<FP> m_x;
+};
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+/**
+ * Fixed-point samples, for processors running on chips without FPU, or on int16
+ * network streams: the value is raw / 2^FractionBits, thus q15 and q31 cover [-1; 1[.
+ * A processor declares its busses with them:
+ *
+ * halp::dynamic_audio_bus<"In", halp::q15> audio;
+ *
+ * and the bindings pass the host buffers as they are when they have the same format,
+ * or convert them with saturation otherwise, see avnd::convert_samples.
+ * Unlike the integers, the arithmetic saturates instead of wrapping around.
+ */
+namespace halp
+{
+template <std::signed_integral Int, int FractionBits>
+requires(sizeof(Int) <= 4 && FractionBits > 0 && FractionBits < int(8 * sizeof(Int)))
+struct fixed
+{
+  using raw_type = Int;
+  // Large enough for a product: 32 bits for Q15, 64 for Q31
+  using wide_type = std::conditional_t<(sizeof(Int) < 4), int32_t, int64_t>;
+
+  static constexpr int fraction_bits = FractionBits;
+  static constexpr Int raw_min = std::numeric_limits<Int>::min();
+  static constexpr Int raw_max = std::numeric_limits<Int>::max();
+
+  Int raw{};
+
+  static constexpr fixed from_raw(Int r) noexcept { return fixed{r}; }
+
+  // Rounded to the nearest, saturated to [min(); max()]
+  static constexpr fixed from_float(double v) noexcept
+  {
+    v *= double(wide_type(1) << FractionBits);
+    if (!(v > raw_min))
+      return fixed{raw_min};
+    if (v >= raw_max)
+      return fixed{raw_max};
+    return fixed{Int(v < 0 ? v - 0.5 : v + 0.5)};
+  }
+
+  static constexpr fixed min() noexcept { return fixed{raw_min}; }
+  static constexpr fixed max() noexcept { return fixed{raw_max}; }
+
+  template <std::floating_point FP = float>
+  constexpr FP to_float() const noexcept
+  {
+    return FP(raw) * FP(1. / double(wide_type(1) << FractionBits));
+  }
+
+  static constexpr fixed saturate(wide_type v) noexcept
+  {
+    return fixed{Int(std::clamp(v, wide_type(raw_min), wide_type(raw_max)))};
+  }
+
+  friend constexpr fixed operator+(fixed a, fixed b) noexcept
+  {
+    return saturate(wide_type(a.raw) + b.raw);
+  }
+  friend constexpr fixed operator-(fixed a, fixed b) noexcept
+  {
+    return saturate(wide_type(a.raw) - b.raw);
+  }
+  friend constexpr fixed operator-(fixed a) noexcept { return saturate(-wide_type(a.raw)); }
+
+  // Rounded to the nearest; only -1 * -1 saturates
+  friend constexpr fixed operator*(fixed a, fixed b) noexcept
+  {
+    constexpr wide_type half = wide_type(1) << (FractionBits - 1);
+    return saturate((wide_type(a.raw) * b.raw + half) >> FractionBits);
+  }
+
+  constexpr fixed& operator+=(fixed other) noexcept { return *this = *this + other; }
+  constexpr fixed& operator-=(fixed other) noexcept { return *this = *this - other; }
+  constexpr fixed& operator*=(fixed other) noexcept { return *this = *this * other; }
+
+  friend constexpr bool operator==(fixed, fixed) noexcept = default;
+  friend constexpr auto operator<=>(fixed, fixed) noexcept = default;
+};
+
+using q15 = fixed<int16_t, 15>;
+using q31 = fixed<int32_t, 31>;
+}
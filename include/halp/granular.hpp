@@ -0,0 +1,284 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/controls.hpp>
+#include <halp/fastmath.hpp>
+#include <halp/soundfile_reader.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace halp
+{
+// What the scheduler of a granulator draws its grains from
+struct grain_settings
+{
+  double density{20.};      // Grains per second
+  double duration{0.1};     // In seconds
+  double position{};        // In the soundfile, from 0 to 1
+  double position_spread{}; // Random offset of the position, in fractions of the soundfile
+  double pitch{1.};         // Playback rate of the grains
+  double pitch_spread{};    // Random transposition, in semitones up or down
+  double jitter{};          // From 0 for regular onsets to 1 for random ones
+  float gain{1.f};
+};
+
+/**
+ * A granular engine on a soundfile_port:
+ *
+ * halp::granulator<double> grains;
+ *
+ * void prepare(halp::setup info) { grains.reset(512, info.rate, info.frames); }
+ *
+ * void operator()(int frames) {
+ *   grains.settings.position = inputs.position;
+ *   grains.process(inputs.sound, 0, outputs.audio[0], frames);
+ * }
+ *
+ * The scheduler starts the grains at the frame where they fall in the buffer,
+ * and trigger() starts others, e.g. on MIDI notes.
+ * The grains are kept in a pool of fixed capacity: when it is full, new grains are
+ * dropped, and counted in dropped().
+ *
+ * With workers, the grains are split across that many threads of the granulator
+ * when there are enough of them for it to be worth it, the audio thread rendering its
+ * own share then waiting for the others.
+ *
+ * reset() allocates and starts the threads, the rest does not allocate.
+ */
+template <typename FP, interpolation I = interpolation::cubic>
+class granulator
+{
+public:
+  grain_settings settings;
+
+  granulator() = default;
+  granulator(const granulator&) = delete;
+  granulator& operator=(const granulator&) = delete;
+  ~granulator() { stop(); }
+
+  void reset(int capacity, double rate, int max_frames, int workers = 0)
+  {
+    stop();
+
+    m_grains.assign(std::max(capacity, 0), grain{});
+    m_count = 0;
+    m_dropped = 0;
+    m_rate = rate;
+    m_max_frames = std::max(max_frames, 1);
+    m_next = 0.;
+
+    m_workers.clear();
+    for (int w = 0; w < workers; w++)
+    {
+      auto& wk = *m_workers.emplace_back(std::make_unique<worker>());
+      wk.output.assign(m_max_frames, FP(0));
+    }
+    m_stop.store(false, std::memory_order_release);
+    for (auto& wk : m_workers)
+      wk->thread = std::thread{[this, w = wk.get()] { work(*w); }};
+  }
+
+  // Starts a grain offset frames into the next buffer; false if the pool is full
+  bool trigger(int offset, grain g) noexcept
+  {
+    if (m_count == int(m_grains.size()))
+    {
+      m_dropped++;
+      return false;
+    }
+    g.delay = std::max(offset, 0);
+    m_grains[m_count++] = g;
+    return true;
+  }
+
+  // Schedules the grains of these frames and adds them all to out
+  void process(const soundfile_view& sound, int channel, FP* out, int frames) noexcept
+  {
+    if (channel < 0 || channel >= sound.channels || !sound.data || sound.frames <= 0)
+      return;
+
+    for (int offset = 0; offset < frames; offset += m_max_frames)
+    {
+      const int n = std::min(frames - offset, m_max_frames);
+      schedule(sound.frames, n);
+      render(sound.data[channel], sound.frames, out + offset, n);
+    }
+  }
+
+  // Stops all the grains, e.g. when the soundfile changes
+  void clear() noexcept
+  {
+    m_count = 0;
+    m_next = 0.;
+  }
+
+  int active() const noexcept { return m_count; }
+  int capacity() const noexcept { return int(m_grains.size()); }
+  int64_t dropped() const noexcept { return m_dropped; }
+
+private:
+  // Below this many grains per thread, the synchronization costs more than it saves
+  static constexpr int grains_per_thread = 32;
+
+  struct worker
+  {
+    std::vector<FP> output;
+    int begin{};
+    int end{};
+    std::thread thread;
+    alignas(64) std::atomic<uint32_t> done{0};
+  };
+
+  // xorshift32, in [0; 1[
+  double uniform() noexcept
+  {
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return double(m_seed) * (1. / 4294967296.);
+  }
+
+  // Bipolar, in [-1; 1[
+  double bipolar() noexcept { return 2. * uniform() - 1.; }
+
+  void schedule(int64_t file_frames, int n) noexcept
+  {
+    const auto& s = settings;
+    if (s.density <= 0. || m_rate <= 0.)
+    {
+      m_next = 0.;
+      return;
+    }
+
+    const double interval = m_rate / s.density;
+    const double duration = std::max(s.duration * m_rate, 1.);
+    for (; m_next < double(n); m_next += std::max(interval * (1. + s.jitter * bipolar()), 1.))
+    {
+      const double position = s.position + s.position_spread * bipolar();
+      const double semitones = s.pitch_spread * bipolar();
+      trigger(
+          int(m_next),
+          grain{
+              .position = position * double(file_frames),
+              .rate = s.pitch * fastmath::exp2(semitones / 12.),
+              .progress = 0.,
+              .increment = 1. / duration,
+              .gain = s.gain});
+    }
+    m_next -= double(n);
+  }
+
+  void render(const float* data, int64_t file_frames, FP* out, int n) noexcept
+  {
+    const int threads = std::min(1 + int(m_workers.size()), m_count / grains_per_thread);
+    const int share = threads > 1 ? (m_count + threads - 1) / threads : m_count;
+
+    if (threads > 1)
+    {
+      m_data = data;
+      m_file_frames = file_frames;
+      m_block = n;
+      for (int w = 0; w < threads - 1; w++)
+      {
+        m_workers[w]->begin = std::min(share * (w + 1), m_count);
+        m_workers[w]->end = std::min(share * (w + 2), m_count);
+      }
+      for (int w = threads - 1; w < int(m_workers.size()); w++)
+        m_workers[w]->begin = m_workers[w]->end = 0;
+
+      m_posted.fetch_add(1, std::memory_order_release);
+      m_posted.notify_all();
+    }
+
+    read_grains<I>(data, file_frames, avnd::span<grain>(m_grains.data(), share), out, n);
+
+    if (threads > 1)
+    {
+      const uint32_t posted = m_posted.load(std::memory_order_relaxed);
+      for (auto& wk : m_workers)
+      {
+        for (uint32_t d = wk->done.load(std::memory_order_acquire); d != posted;
+             d = wk->done.load(std::memory_order_acquire))
+          wk->done.wait(d, std::memory_order_acquire);
+
+        if (wk->begin < wk->end)
+        {
+          const FP* __restrict o = wk->output.data();
+          for (int j = 0; j < n; j++)
+            out[j] += o[j];
+        }
+      }
+    }
+
+    // The grains which are over are replaced by the last ones
+    for (int i = 0; i < m_count;)
+    {
+      if (m_grains[i].active())
+        i++;
+      else
+        m_grains[i] = m_grains[--m_count];
+    }
+  }
+
+  void work(worker& wk) noexcept
+  {
+    uint32_t seen = 0;
+    for (;;)
+    {
+      m_posted.wait(seen, std::memory_order_acquire);
+      seen = m_posted.load(std::memory_order_acquire);
+      if (m_stop.load(std::memory_order_acquire))
+        return;
+
+      if (wk.begin < wk.end)
+      {
+        std::fill_n(wk.output.data(), m_block, FP(0));
+        read_grains<I>(
+            m_data, m_file_frames,
+            avnd::span<grain>(m_grains.data() + wk.begin, std::size_t(wk.end - wk.begin)),
+            wk.output.data(), m_block);
+      }
+      wk.done.store(seen, std::memory_order_release);
+      wk.done.notify_one();
+    }
+  }
+
+  void stop()
+  {
+    if (m_workers.empty())
+      return;
+
+    m_stop.store(true, std::memory_order_release);
+    m_posted.fetch_add(1, std::memory_order_release);
+    m_posted.notify_all();
+    for (auto& wk : m_workers)
+      if (wk->thread.joinable())
+        wk->thread.join();
+    m_workers.clear();
+    m_posted.store(0, std::memory_order_relaxed);
+  }
+
+  std::vector<grain> m_grains;
+  int m_count{};
+  int64_t m_dropped{};
+  double m_rate{};
+  int m_max_frames{1};
+  double m_next{}; // Frames until the next grain
+  uint32_t m_seed{0x9E3779B9u};
+
+  // The block the workers render, written before m_posted is incremented
+  const float* m_data{};
+  int64_t m_file_frames{};
+  int m_block{};
+
+  std::vector<std::unique_ptr<worker>> m_workers;
+  alignas(64) std::atomic<uint32_t> m_posted{0};
+  std::atomic_bool m_stop{false};
+};
+}
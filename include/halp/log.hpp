@@ -7,7 +7,22 @@
 #if __has_include(<fmt/printf.h>)
 #include <fmt/format.h>
 #include <fmt/printf.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #else
+#include <cstdint>
 #include <iostream>
 #endif
 
@@ -43,6 +58,243 @@ struct basic_logger
   template <typename... T>
   static void critical(fmt::format_string<T...> fmt, T&&... args) noexcept { error(fmt, std::forward<T>(args)...); }
 };
+
+/**
+ * The messages of rt_logger, written to stdout or stderr by a thread of their own.
+ * Any thread can log at the same time: the messages go through a bounded
+ * lock-free queue, where the arguments are copied as they are, strings
+ * truncated to text_capacity characters. When the queue is full, the message
+ * is dropped and counted instead of waiting.
+ */
+class rt_log_queue
+{
+public:
+  static constexpr std::size_t capacity = 1024;
+  static constexpr std::size_t args_capacity = 192;
+  static constexpr std::size_t text_capacity = 47;
+
+  // How strings are copied
+  struct text
+  {
+    char data[text_capacity];
+    unsigned char size;
+  };
+
+  template <typename T>
+  static auto capture(const T& v) noexcept
+  {
+    if constexpr (std::is_convertible_v<const T&, std::string_view>)
+    {
+      const std::string_view str = v;
+      text t;
+      t.size = (unsigned char)std::min(str.size(), text_capacity);
+      std::memcpy(t.data, str.data(), t.size);
+      return t;
+    }
+    else
+    {
+      static_assert(
+          std::is_trivially_copyable_v<T>,
+          "rt_logger only copies numbers, strings and trivially copyable values");
+      return v;
+    }
+  }
+
+  template <typename T>
+  using captured = decltype(capture(std::declval<const T&>()));
+
+  static rt_log_queue& instance()
+  {
+    static rt_log_queue queue;
+    return queue;
+  }
+
+  rt_log_queue(const rt_log_queue&) = delete;
+  rt_log_queue& operator=(const rt_log_queue&) = delete;
+
+  ~rt_log_queue()
+  {
+    m_stop.store(true, std::memory_order_release);
+    if (m_thread.joinable())
+      m_thread.join();
+    drain();
+  }
+
+  // Starts the thread which writes the messages, during the setup of the host:
+  // push() never does it, as it may be called from the audio thread.
+  // Until then the messages wait in the queue, and the destructor writes them.
+  void start()
+  {
+    if (!m_started.exchange(true, std::memory_order_acq_rel))
+      m_thread = std::thread{[this] { run(); }};
+  }
+
+  template <typename... T>
+  void push(FILE* stream, std::string_view format, const T&... args) noexcept
+  {
+    using tuple = std::tuple<captured<T>...>;
+    static_assert(sizeof(tuple) <= args_capacity, "Too many arguments to log");
+    static_assert(alignof(tuple) <= alignof(std::max_align_t));
+
+    std::size_t pos = m_write.load(std::memory_order_relaxed);
+    cell* c{};
+    for (;;)
+    {
+      c = &m_cells[pos % capacity];
+      const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+      const auto diff = std::intptr_t(seq) - std::intptr_t(pos);
+      if (diff == 0)
+      {
+        if (m_write.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      else
+      {
+        pos = m_write.load(std::memory_order_relaxed);
+      }
+    }
+
+    c->stream = stream;
+    c->format = format;
+    c->print = &print<captured<T>...>;
+    new (c->args) tuple{capture(args)...};
+    c->sequence.store(pos + 1, std::memory_order_release);
+  }
+
+  // The messages which did not fit in the queue
+  int64_t dropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+  // Waits until the messages logged so far are written
+  void flush() noexcept
+  {
+    const std::size_t end = m_write.load(std::memory_order_acquire);
+    while (m_started.load(std::memory_order_acquire)
+           && m_read.load(std::memory_order_acquire) < end)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+private:
+  rt_log_queue()
+  {
+    for (std::size_t i = 0; i < capacity; i++)
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  struct cell
+  {
+    std::atomic<std::size_t> sequence;
+    FILE* stream;
+    std::string_view format;
+    void (*print)(cell&);
+    alignas(std::max_align_t) std::byte args[args_capacity];
+  };
+
+  template <typename T>
+  static decltype(auto) release(const T& v) noexcept
+  {
+    if constexpr (std::is_same_v<T, text>)
+      return std::string_view{v.data, v.size};
+    else
+      return (v);
+  }
+
+  template <typename... C>
+  static void print(cell& c)
+  {
+    using tuple = std::tuple<C...>;
+    auto& args = *std::launder(reinterpret_cast<tuple*>(c.args));
+    std::apply(
+        [&](const auto&... a) {
+          fmt::print(c.stream, fmt::runtime(c.format), release(a)...);
+          std::fputc('\n', c.stream);
+        },
+        args);
+    args.~tuple();
+  }
+
+  // Single consumer: the thread, or the destructor once it is stopped
+  bool drain()
+  {
+    bool any = false;
+    for (;;)
+    {
+      const std::size_t pos = m_read.load(std::memory_order_relaxed);
+      cell& c = m_cells[pos % capacity];
+      if (c.sequence.load(std::memory_order_acquire) != pos + 1)
+        break;
+
+      c.print(c);
+      c.sequence.store(pos + capacity, std::memory_order_release);
+      m_read.store(pos + 1, std::memory_order_release);
+      any = true;
+    }
+    if (any)
+    {
+      std::fflush(stdout);
+      std::fflush(stderr);
+    }
+    return any;
+  }
+
+  void run()
+  {
+    // Polled, so that logging never has to wake anything up
+    while (!m_stop.load(std::memory_order_acquire))
+      if (!drain())
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  std::array<cell, capacity> m_cells;
+  alignas(64) std::atomic<std::size_t> m_write{};
+  alignas(64) std::atomic<std::size_t> m_read{};
+  std::atomic<int64_t> m_dropped{};
+  std::atomic<bool> m_started{};
+  std::atomic<bool> m_stop{};
+  std::thread m_thread;
+};
+
+/**
+ * A logger which can be used from the audio thread, e.g. in operator():
+ * it neither formats, nor writes, nor waits, see rt_log_queue.
+ * Hosts call start() when setting up, before the audio runs.
+ */
+struct rt_logger
+{
+  using logger_type = rt_logger;
+
+  static void start() { rt_log_queue::instance().start(); }
+  static void flush() noexcept { rt_log_queue::instance().flush(); }
+  static int64_t dropped() noexcept { return rt_log_queue::instance().dropped(); }
+
+  template <typename... T>
+  static void log(fmt::format_string<T...> fmt, T&&... args) noexcept
+  {
+    const fmt::string_view str = fmt;
+    rt_log_queue::instance().push(stdout, std::string_view(str.data(), str.size()), args...);
+  }
+
+  template <typename... T>
+  static void error(fmt::format_string<T...> fmt, T&&... args) noexcept
+  {
+    const fmt::string_view str = fmt;
+    rt_log_queue::instance().push(stderr, std::string_view(str.data(), str.size()), args...);
+  }
+  template <typename... T>
+  static void trace(fmt::format_string<T...> fmt, T&&... args) noexcept { log(fmt, std::forward<T>(args)...); }
+  template <typename... T>
+  static void debug(fmt::format_string<T...> fmt, T&&... args) noexcept { log(fmt, std::forward<T>(args)...); }
+  template <typename... T>
+  static void info(fmt::format_string<T...> fmt, T&&... args) noexcept { log(fmt, std::forward<T>(args)...); }
+  template <typename... T>
+  static void warn(fmt::format_string<T...> fmt, T&&... args) noexcept { error(fmt, std::forward<T>(args)...); }
+  template <typename... T>
+  static void critical(fmt::format_string<T...> fmt, T&&... args) noexcept { error(fmt, std::forward<T>(args)...); }
+};
 #else
 struct basic_logger
 {
@@ -67,6 +319,16 @@ struct basic_logger
   template <typename... T>
   static void critical(T&&... args) noexcept { log(std::forward<T>(args)...); }
 };
+
+// Without fmt, the messages cannot be formatted later: they are written directly
+struct rt_logger : basic_logger
+{
+  using logger_type = rt_logger;
+
+  static void start() { }
+  static void flush() noexcept { }
+  static int64_t dropped() noexcept { return 0; }
+};
 #endif
 
 struct no_logger
@@ -90,6 +352,7 @@ struct no_logger
 
 static_assert(avnd::logger<halp::basic_logger>);
 static_assert(avnd::logger<halp::no_logger>);
+static_assert(avnd::logger<halp::rt_logger>);
 
 template <typename C>
 concept has_logger = avnd::logger<typename C::logger_type>;
@@ -0,0 +1,228 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace halp
+{
+/**
+ * Maximum, or minimum with std::less, of the last window values of a signal,
+ * in amortized constant time per value whatever the window:
+ * the candidates are kept in a monotonic deque, in a ring allocated by reset().
+ */
+template <typename FP, typename Compare = std::greater<FP>>
+class sliding_extremum
+{
+public:
+  void reset(int window)
+  {
+    m_window = std::max(window, 1);
+    m_values.assign(m_window, FP(0));
+    m_times.assign(m_window, 0);
+    clear();
+  }
+
+  void clear() noexcept
+  {
+    m_head = 0;
+    m_size = 0;
+    m_time = 0;
+  }
+
+  int window() const noexcept { return m_window; }
+
+  // Adds a value, and returns the extremum of the window which ends with it
+  FP push(FP x) noexcept
+  {
+    // The oldest candidate left the window
+    if (m_size > 0 && m_times[m_head] + m_window <= m_time)
+    {
+      m_head = next(m_head);
+      m_size--;
+    }
+
+    // The candidates which x beats can never be the extremum again
+    while (m_size > 0 && !Compare{}(m_values[back()], x))
+      m_size--;
+
+    const int k = (m_head + m_size) % m_window;
+    m_values[k] = x;
+    m_times[k] = m_time++;
+    m_size++;
+    return m_values[m_head];
+  }
+
+  void process(const FP* in, FP* out, int frames) noexcept
+  {
+    for (int i = 0; i < frames; i++)
+      out[i] = push(in[i]);
+  }
+
+private:
+  int next(int k) const noexcept { return k + 1 < m_window ? k + 1 : 0; }
+  int back() const noexcept { return (m_head + m_size - 1) % m_window; }
+
+  std::vector<FP> m_values;
+  std::vector<int64_t> m_times;
+  int64_t m_time{};
+  int m_window{1};
+  int m_head{};
+  int m_size{};
+};
+
+template <typename FP>
+using sliding_max = sliding_extremum<FP, std::greater<FP>>;
+template <typename FP>
+using sliding_min = sliding_extremum<FP, std::less<FP>>;
+
+/**
+ * Look-ahead for dynamics processors, e.g. limiters: the audio is delayed by
+ * the look-ahead, while the gain is computed from the peak of the frames to come.
+ *
+ * halp::lookahead<double> lookahead;
+ *
+ * void prepare(halp::setup info) {
+ *   lookahead.reset(info.input_channels, int(0.005 * info.rate));
+ * }
+ * int64_t latency_samples() const noexcept { return lookahead.latency(); }
+ *
+ * void operator()(int frames) {
+ *   lookahead.process(inputs.audio, outputs.audio, frames, [&](double peak) {
+ *     return peak > ceiling ? ceiling / peak : 1.;
+ *   });
+ * }
+ *
+ * The gain function gets, for each output frame, the largest absolute value of all
+ * the channels between that frame and latency() frames later, in order, so that
+ * it can keep a release state. Its result multiplies the delayed audio.
+ *
+ * The envelope, the delay and the gain are computed by blocks, in loops
+ * without dependency between frames which the compiler vectorizes;
+ * only the sliding maximum goes frame by frame.
+ *
+ * reset() allocates, process() does not. In-place is fine.
+ */
+template <typename FP>
+class lookahead
+{
+public:
+  static constexpr int block = 64;
+
+  void reset(int channels, int frames)
+  {
+    m_channels = std::max(channels, 0);
+    m_latency = std::max(frames, 0);
+    m_size = m_latency + block;
+    m_delay.assign(m_channels, std::vector<FP>(m_size, FP(0)));
+    m_peaks.reset(m_latency + 1);
+    m_pos = 0;
+  }
+
+  int64_t latency() const noexcept { return m_latency; }
+
+  // Clears the delayed frames, e.g. when the playback restarts
+  void clear() noexcept
+  {
+    for (auto& v : m_delay)
+      std::fill(v.begin(), v.end(), FP(0));
+    m_peaks.clear();
+    m_pos = 0;
+  }
+
+  template <typename F>
+  void process(
+      const FP* const* in, FP* const* out, int channels, int frames, F&& gain) noexcept
+  {
+    channels = std::min(channels, m_channels);
+    for (int k = 0; k < frames; k += block)
+      run(in, out, channels, k, std::min(block, frames - k), gain);
+  }
+
+  template <typename InBus, typename OutBus, typename F>
+    requires requires(InBus& i, OutBus& o) {
+      i.samples;
+      o.samples;
+    }
+  void process(const InBus& in, OutBus& out, int frames, F&& gain) noexcept
+  {
+    process(
+        in.samples, out.samples, std::min(bus_channels(in), bus_channels(out)), frames,
+        gain);
+  }
+
+private:
+  template <typename Bus>
+  static int bus_channels(const Bus& bus) noexcept
+  {
+    if constexpr (requires { bus.channels(); })
+      return bus.channels();
+    else
+      return bus.channels;
+  }
+
+  // Calls f(ring index, offset, count) on the contiguous parts of [pos; pos + n[
+  template <typename F>
+  void ring(int pos, int n, F&& f) const noexcept
+  {
+    const int first = std::min(n, m_size - pos);
+    f(pos, 0, first);
+    if (first < n)
+      f(0, first, n - first);
+  }
+
+  template <typename F>
+  void run(
+      const FP* const* in, FP* const* out, int channels, int offset, int n,
+      F& gain) noexcept
+  {
+    // Envelope of all the channels, before the outputs are written
+    FP env[block]{};
+    for (int c = 0; c < channels; c++)
+    {
+      const FP* __restrict src = in[c] + offset;
+      for (int i = 0; i < n; i++)
+        env[i] = std::max(env[i], std::abs(src[i]));
+    }
+
+    // The ring has room for the delay and a block: the input can be written before
+    // the delayed frames are read
+    for (int c = 0; c < channels; c++)
+    {
+      const FP* src = in[c] + offset;
+      FP* buf = m_delay[c].data();
+      ring(m_pos, n, [&](int r, int o, int count) { std::copy_n(src + o, count, buf + r); });
+    }
+
+    FP g[block];
+    for (int i = 0; i < n; i++)
+      g[i] = gain(m_peaks.push(env[i]));
+
+    const int read = (m_pos + m_size - m_latency) % m_size;
+    for (int c = 0; c < channels; c++)
+    {
+      const FP* buf = m_delay[c].data();
+      FP* dst = out[c] + offset;
+      ring(read, n, [&](int r, int o, int count) {
+        const FP* __restrict s = buf + r;
+        const FP* __restrict gs = g + o;
+        FP* __restrict d = dst + o;
+        for (int i = 0; i < count; i++)
+          d[i] = s[i] * gs[i];
+      });
+    }
+    m_pos = (m_pos + n) % m_size;
+  }
+
+  std::vector<std::vector<FP>> m_delay;
+  sliding_max<FP> m_peaks;
+  int m_channels{};
+  int m_latency{};
+  int m_size{block};
+  int m_pos{};
+};
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace halp
+{
+/**
+ * Mixes N input channels into M output channels through a matrix of gains,
+ * e.g. for panning sources over speakers, or encoding and decoding ambisonics:
+ *
+ * out[o] = sum_i gain(o, i) * in[i]
+ *
+ * Each gain glides linearly to the value it is set to, over the ramp given
+ * to prepare(), so that moving sources do not click. The inputs whose gain
+ * is zero for an output are skipped, which keeps pairwise panning and other
+ * sparse matrices cheap.
+ *
+ * The buffers are processed by blocks of frames small enough for the block of
+ * every input to stay in the cache while all the outputs are computed, and the
+ * inner loops are plain multiply-adds, which the compiler vectorizes.
+ * The outputs are computed in a buffer of the mixer, thus they can be the inputs.
+ * prepare() allocates, the rest does not.
+ */
+template <typename FP>
+class matrix_mixer
+{
+public:
+  void prepare(int inputs, int outputs, int max_frames, double rate, double ramp_ms = 20.)
+  {
+    m_inputs = inputs;
+    m_outputs = outputs;
+    m_ramp = std::max(1, int(rate * ramp_ms / 1000.));
+    m_coefs.assign(std::size_t(inputs) * outputs, coefficient{});
+    m_active.assign(std::size_t(inputs) * outputs, 0);
+    m_active_count.assign(outputs, 0);
+    m_dirty = false;
+
+    // The blocks of all the inputs fit in 32 KiB, a common L1 data cache
+    m_block = std::clamp(int(32768 / (sizeof(FP) * std::max(inputs, 1))) & ~15, 16, 512);
+    m_block = std::min(m_block, std::max(max_frames, 16));
+    m_scratch.assign(std::size_t(outputs) * m_block, FP(0));
+  }
+
+  int inputs() const noexcept { return m_inputs; }
+  int outputs() const noexcept { return m_outputs; }
+
+  FP gain(int output, int input) const noexcept
+  {
+    return m_coefs[index(output, input)].target;
+  }
+
+  void set_gain(int output, int input, FP g) noexcept
+  {
+    auto& c = m_coefs[index(output, input)];
+    if (g == c.target)
+      return;
+
+    c.target = g;
+    c.remaining = m_ramp;
+    c.step = (g - c.gain) / FP(m_ramp);
+    m_dirty = true;
+  }
+
+  // Without ramp, e.g. when the processor starts
+  void jump_gain(int output, int input, FP g) noexcept
+  {
+    auto& c = m_coefs[index(output, input)];
+    c = {.gain = g, .target = g};
+    m_dirty = true;
+  }
+
+  void operator()(const FP* const* in, FP* const* out, int frames) noexcept
+  {
+    if (m_dirty)
+      update_active();
+
+    for (int first = 0; first < frames; first += m_block)
+    {
+      const int n = std::min(m_block, frames - first);
+      bool ramps_done = false;
+
+      for (int o = 0; o < m_outputs; o++)
+      {
+        FP* acc = m_scratch.data() + std::size_t(o) * m_block;
+        const int* active = m_active.data() + std::size_t(o) * m_inputs;
+        const int count = m_active_count[o];
+        if (count == 0)
+        {
+          std::fill_n(acc, n, FP(0));
+          continue;
+        }
+
+        // The first input sets the block, the others add to it
+        for (int k = 0; k < count; k++)
+        {
+          auto& c = m_coefs[index(o, active[k])];
+          const FP* x = in[active[k]] + first;
+          if (k == 0)
+            mix<false>(c, x, acc, n);
+          else
+            mix<true>(c, x, acc, n);
+          ramps_done |= c.remaining == 0 && c.gain == FP(0) && c.target == FP(0);
+        }
+      }
+
+      for (int o = 0; o < m_outputs; o++)
+        std::copy_n(m_scratch.data() + std::size_t(o) * m_block, n, out[o] + first);
+
+      // A gain which reached zero does not need to be computed anymore
+      if (ramps_done)
+        update_active();
+    }
+  }
+
+private:
+  struct coefficient
+  {
+    FP gain{};
+    FP target{};
+    FP step{};
+    int remaining{};
+  };
+
+  std::size_t index(int output, int input) const noexcept
+  {
+    return std::size_t(output) * m_inputs + input;
+  }
+
+  template <bool Add>
+  static void mix(coefficient& c, const FP* __restrict x, FP* __restrict acc, int n) noexcept
+  {
+    int j = 0;
+    if (c.remaining > 0)
+    {
+      const int r = std::min(n, c.remaining);
+      const FP g = c.gain;
+      const FP step = c.step;
+      for (; j < r; j++)
+      {
+        const FP v = (g + step * FP(j + 1)) * x[j];
+        acc[j] = Add ? acc[j] + v : v;
+      }
+      c.remaining -= r;
+      c.gain = c.remaining > 0 ? g + step * FP(r) : c.target;
+    }
+
+    const FP g = c.gain;
+    for (; j < n; j++)
+    {
+      const FP v = g * x[j];
+      acc[j] = Add ? acc[j] + v : v;
+    }
+  }
+
+  void update_active() noexcept
+  {
+    for (int o = 0; o < m_outputs; o++)
+    {
+      int* active = m_active.data() + std::size_t(o) * m_inputs;
+      int count = 0;
+      for (int i = 0; i < m_inputs; i++)
+      {
+        const auto& c = m_coefs[index(o, i)];
+        if (c.gain != FP(0) || c.target != FP(0))
+          active[count++] = i;
+      }
+      m_active_count[o] = count;
+    }
+    m_dirty = false;
+  }
+
+  std::vector<coefficient> m_coefs;
+  std::vector<int> m_active;
+  std::vector<int> m_active_count;
+  std::vector<FP> m_scratch;
+  int m_inputs{};
+  int m_outputs{};
+  int m_ramp{1};
+  int m_block{16};
+  bool m_dirty{};
+};
+}
@@ -28,6 +28,22 @@ struct func_ref
   static clang_buggy_consteval auto func() { return M; }
 };
 
+/// Only the last call received during a buffer is made, for setters ///
+
+template <static_string lit, auto M>
+struct coalesced_func_ref : func_ref<lit, M>
+{
+  static constexpr bool coalesce = true;
+};
+
+/// The last argument of the function is the sample, in the buffer, at which the call is due ///
+
+template <static_string lit, auto M>
+struct timed_func_ref : func_ref<lit, M>
+{
+  static constexpr bool timed = true;
+};
+
 }
 
 #define halp_start_messages(T)       \
@@ -39,6 +55,10 @@ struct func_ref
   ;
 
 #define halp_mem_fun(Mem) ::halp::func_ref<#Mem, &parent_type::Mem> m_##Mem;
+#define halp_mem_fun_coalesced(Mem) \
+  ::halp::coalesced_func_ref<#Mem, &parent_type::Mem> m_##Mem;
+#define halp_mem_fun_timed(Mem) \
+  ::halp::timed_func_ref<#Mem, &parent_type::Mem> m_##Mem;
 #define halp_mem_fun_t(Mem, MemT)                                \
   ::halp::func_ref<#Mem, &parent_type::Mem MemT> HALP_TOKENPASTE2( \
       m_, HALP_TOKENPASTE2(Mem, __LINE__));
@@ -0,0 +1,482 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/fastmath.hpp>
+#include <halp/polyfill.hpp>
+#include <halp/static_string.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace halp
+{
+// max |x[i]|.
+// On the bits: the magnitudes of positive floats sort like integers,
+// and an integer max vectorizes where a float one stays a branch because of the NaNs
+template <std::floating_point FP>
+FP peak(const FP* __restrict x, int n) noexcept
+{
+  using sbits = std::make_signed_t<typename fastmath::detail::ieee<FP>::bits>;
+  constexpr sbits magnitude = std::numeric_limits<sbits>::max();
+  sbits m = 0;
+  for (int i = 0; i < n; i++)
+    m = std::max(m, sbits(std::bit_cast<sbits>(x[i]) & magnitude));
+  return std::bit_cast<FP>(m);
+}
+
+// Sum of x[i]^2, in eight partial sums: the compilers keep the order of a single sum
+// unless allowed to reassociate, which would keep the loop from being vectorized
+template <std::floating_point FP>
+FP sum_of_squares(const FP* __restrict x, int n) noexcept
+{
+  FP s[8]{};
+  int i = 0;
+  for (; i + 8 <= n; i += 8)
+    for (int k = 0; k < 8; k++)
+      s[k] += x[i + k] * x[i + k];
+
+  FP r{};
+  for (; i < n; i++)
+    r += x[i] * x[i];
+  for (int k = 0; k < 8; k++)
+    r += s[k];
+  return r;
+}
+
+template <std::floating_point FP>
+FP rms(const FP* x, int n) noexcept
+{
+  return n > 0 ? std::sqrt(halp::sum_of_squares(x, n) / FP(n)) : FP(0);
+}
+
+// What halp::level_meter gives: peak in dBTP, rms in dBFS, the loudness in LUFS.
+// Four numbers, which every binding can send as a list.
+struct meter_value
+{
+  // What silence reads as
+  static constexpr float floor = -120.f;
+
+  float peak{floor};
+  float rms{floor};
+  float momentary{floor};  // Loudness over the last 400 ms
+  float short_term{floor}; // Loudness over the last 3 s
+};
+
+/**
+ * An output for a halp::level_meter.
+ * The bindings send it at most report_rate() times per second, and only when
+ * one of the values moved by more than report_epsilon() dB.
+ */
+template <static_string lit>
+struct meter_port
+{
+  static clang_buggy_consteval auto name() { return std::string_view{lit.value}; }
+  static consteval double report_epsilon() { return 0.1; }
+  static consteval double report_rate() { return 20.; }
+
+  operator meter_value&() noexcept { return value; }
+  operator const meter_value&() const noexcept { return value; }
+  auto& operator=(meter_value t) noexcept
+  {
+    value = t;
+    return *this;
+  }
+
+  meter_value value;
+};
+
+namespace detail
+{
+// 4x oversampling for the true peak: phase p interpolates at p / 4 of a sample
+// through 12 samples, with a Blackman-windowed sinc.
+// Phase 0 gives the samples themselves and is not stored.
+inline constexpr int true_peak_taps = 12;
+
+constexpr std::array<std::array<double, true_peak_taps>, 3> make_true_peak_taps() noexcept
+{
+  constexpr double pi = 3.141592653589793238462643383279502884;
+  using fastmath::accuracy;
+  auto cos = [=](double x) { return fastmath::sin<accuracy::high>(x + 0.5 * pi); };
+
+  std::array<std::array<double, true_peak_taps>, 3> taps{};
+  for (int p = 1; p <= 3; p++)
+  {
+    auto& h = taps[p - 1];
+    double sum = 0.;
+    for (int k = 0; k < true_peak_taps; k++)
+    {
+      // Tap k is applied to the sample which is t samples before the interpolated point
+      const double t = k - true_peak_taps / 2 + p / 4.;
+      const double s = fastmath::sin<accuracy::high>(pi * t) / (pi * t);
+      const double w = pi * t / (true_peak_taps / 2);
+      h[k] = s * (0.42 + 0.5 * cos(w) + 0.08 * cos(2. * w));
+      sum += h[k];
+    }
+    // Unity gain at DC
+    for (double& v : h)
+      v /= sum;
+  }
+  return taps;
+}
+
+template <typename = void>
+inline constexpr auto true_peak_table = make_true_peak_taps();
+
+// Second-order sections of the K-weighting of ITU-R BS.1770 at a sample rate:
+// a high shelf modelling the head, then a high pass
+struct k_weighting_coefficients
+{
+  double b0, b1, b2, a1, a2; // Shelf
+  double c1, c2;             // High pass, whose numerator is 1, -2, 1
+
+  static k_weighting_coefficients at(double rate) noexcept
+  {
+    static constexpr double pi = 3.141592653589793238462643383279502884;
+    k_weighting_coefficients k;
+
+    // The analog prototypes of the standard's filters at 48 kHz, as derived in libebur128
+    {
+      const double f0 = 1681.974450955533;
+      const double gain_db = 3.999843853973347;
+      const double q = 0.7071752369554196;
+      const double K = std::tan(pi * f0 / rate);
+      const double vh = std::pow(10., gain_db / 20.);
+      const double vb = std::pow(vh, 0.4996667741545416);
+      const double a0 = 1. + K / q + K * K;
+      k.b0 = (vh + vb * K / q + K * K) / a0;
+      k.b1 = 2. * (K * K - vh) / a0;
+      k.b2 = (vh - vb * K / q + K * K) / a0;
+      k.a1 = 2. * (K * K - 1.) / a0;
+      k.a2 = (1. - K / q + K * K) / a0;
+    }
+    {
+      const double f0 = 38.13547087602444;
+      const double q = 0.5003270373238773;
+      const double K = std::tan(pi * f0 / rate);
+      const double a0 = 1. + K / q + K * K;
+      k.c1 = 2. * (K * K - 1.) / a0;
+      k.c2 = (1. - K / q + K * K) / a0;
+    }
+    return k;
+  }
+};
+}
+
+/**
+ * The true peak of ITU-R BS.1770 of a few channels: the peak of the signal
+ * oversampled four times, which catches the peaks in-between the samples that a
+ * digital to analog converter would output.
+ *
+ * reset() allocates, process() does not.
+ */
+template <std::floating_point FP>
+class true_peak
+{
+public:
+  static constexpr int history = detail::true_peak_taps - 1;
+
+  void reset(int channels)
+  {
+    m_history.assign(std::size_t(std::max(channels, 0)) * history, FP(0));
+  }
+
+  int channels() const noexcept { return int(m_history.size() / history); }
+
+  // The true peak of the frames, as an amplitude
+  FP process(int channel, const FP* in, int frames) noexcept
+  {
+    FP* hist = m_history.data() + std::size_t(channel) * history;
+    const auto& taps = detail::true_peak_table<>;
+
+    FP m = halp::peak(in, frames);
+    for (int offset = 0; offset < frames; offset += chunk)
+    {
+      const int len = std::min(frames - offset, chunk);
+
+      // The previous samples, then the new ones, contiguous
+      FP x[history + chunk];
+      std::copy_n(hist, history, x);
+      std::copy_n(in + offset, len, x + history);
+
+      for (const auto& h : taps)
+      {
+        FP y[chunk]{};
+        interpolate(x, h, y, len);
+        m = std::max(m, halp::peak(y, len));
+      }
+
+      std::copy_n(x + len, history, hist);
+    }
+    return m;
+  }
+
+private:
+  static constexpr int chunk = 64;
+
+  static void interpolate(
+      const FP* __restrict x, const std::array<double, detail::true_peak_taps>& h,
+      FP* __restrict y, int len) noexcept
+  {
+    FP c[detail::true_peak_taps];
+    for (int k = 0; k < detail::true_peak_taps; k++)
+      c[k] = FP(h[k]);
+    // y[j] interpolates between x[j + 5] and x[j + 6]
+    for (int j = 0; j < len; j++)
+    {
+      FP acc{};
+      for (int k = 0; k < detail::true_peak_taps; k++)
+        acc += c[k] * x[j + history - k];
+      y[j] = acc;
+    }
+  }
+
+  std::vector<FP> m_history;
+};
+
+/**
+ * The K-weighting filters of ITU-R BS.1770 on many channels, e.g. of a mixer,
+ * summing the squares of each filtered channel.
+ *
+ * The samples are processed in blocks transposed so that the inner loop goes
+ * over the channels, like halp::svf_bank: the compiler vectorizes it
+ * when there are enough channels.
+ *
+ * reset() allocates, process() does not.
+ */
+template <std::floating_point FP>
+class k_weighting
+{
+public:
+  static constexpr int block = 64;
+
+  void reset(int channels, double rate)
+  {
+    m_channels = std::max(channels, 0);
+    m_coeffs = detail::k_weighting_coefficients::at(rate);
+    // Padded to a vector of 4 floats, for the vectorized loops not to need a scalar tail:
+    // more would cost a stereo meter as many filters for nothing
+    const std::size_t n = (std::size_t(m_channels) + 3) / 4 * 4;
+    for (auto* v : {&m_s1, &m_s2, &m_h1, &m_h2, &m_energy})
+      v->assign(n, FP(0));
+    m_x.assign(n * block, FP(0));
+  }
+
+  int channels() const noexcept { return m_channels; }
+
+  // Adds the squares of the K-weighted frames [first; first + frames[ of in[c]
+  // to energy(c)
+  void process(const FP* const* in, int channels, int first, int frames) noexcept
+  {
+    const int n = std::min(channels, m_channels);
+    const std::size_t stride = m_energy.size();
+    for (int offset = 0; offset < frames; offset += block)
+    {
+      const int len = std::min(frames - offset, block);
+      for (int c = 0; c < n; c++)
+        for (int j = 0; j < len; j++)
+          m_x[std::size_t(j) * stride + c] = in[c][first + offset + j];
+      for (int j = 0; j < len; j++)
+        std::fill(
+            m_x.begin() + std::size_t(j) * stride + n,
+            m_x.begin() + std::size_t(j + 1) * stride, FP(0));
+
+      for (int j = 0; j < len; j++)
+        step(m_x.data() + std::size_t(j) * stride, int(stride));
+    }
+  }
+
+  FP energy(int channel) const noexcept { return m_energy[channel]; }
+  void clear_energy() noexcept { std::fill(m_energy.begin(), m_energy.end(), FP(0)); }
+
+private:
+  // One frame of every channel, through both sections in transposed direct form II
+  void step(const FP* __restrict x, int n) noexcept
+  {
+    const FP b0 = FP(m_coeffs.b0), b1 = FP(m_coeffs.b1), b2 = FP(m_coeffs.b2);
+    const FP a1 = FP(m_coeffs.a1), a2 = FP(m_coeffs.a2);
+    const FP c1 = FP(m_coeffs.c1), c2 = FP(m_coeffs.c2);
+    FP* __restrict s1 = m_s1.data();
+    FP* __restrict s2 = m_s2.data();
+    FP* __restrict h1 = m_h1.data();
+    FP* __restrict h2 = m_h2.data();
+    FP* __restrict e = m_energy.data();
+    for (int c = 0; c < n; c++)
+    {
+      const FP v = x[c];
+      const FP u = b0 * v + s1[c];
+      s1[c] = b1 * v - a1 * u + s2[c];
+      s2[c] = b2 * v - a2 * u;
+
+      const FP y = u + h1[c];
+      h1[c] = FP(-2) * u - c1 * y + h2[c];
+      h2[c] = u - c2 * y;
+      e[c] += y * y;
+    }
+  }
+
+  detail::k_weighting_coefficients m_coeffs{};
+  int m_channels{};
+  std::vector<FP> m_s1, m_s2, m_h1, m_h2;
+  std::vector<FP> m_energy;
+  std::vector<FP> m_x;
+};
+
+/**
+ * The meter of a channel strip or of a bus: true peak, RMS and the loudness of
+ * ITU-R BS.1770 with its momentary and short-term windows.
+ *
+ * halp::level_meter<double> meter;
+ *
+ * void prepare(halp::setup info) { meter.reset(2, info.rate); }
+ *
+ * void operator()(int frames) {
+ *   meter.process(inputs.audio.samples, inputs.audio.channels, frames);
+ *   outputs.level = meter.value();
+ * }
+ *
+ * The signal is measured in blocks of 100 ms:
+ * the peak is held over the last 300 ms and the block in progress,
+ * the RMS is the one of the loudest channel over the last 300 ms.
+ *
+ * reset() allocates, process() does not.
+ */
+template <std::floating_point FP>
+class level_meter
+{
+public:
+  void reset(int channels, double rate)
+  {
+    m_channels = std::max(channels, 0);
+    m_true_peak.reset(m_channels);
+    m_k_weighting.reset(m_channels, rate);
+    m_squares.assign(m_channels, FP(0));
+    m_weights.assign(m_channels, 1.);
+    m_block_frames = std::max(int(std::lround(rate / 10.)), 1);
+    m_position = 0;
+    m_peak = FP(0);
+    m_blocks = {};
+    m_last = 0;
+    m_value = {};
+  }
+
+  // In the loudness, e.g. 1.41 for the surround channels; 1 by default
+  void set_weight(int channel, double w) noexcept
+  {
+    if (channel >= 0 && channel < m_channels)
+      m_weights[channel] = w;
+  }
+
+  void process(const FP* const* in, int channels, int frames) noexcept
+  {
+    const int n = std::min(channels, m_channels);
+    for (int offset = 0; offset < frames;)
+    {
+      const int len = std::min(frames - offset, m_block_frames - m_position);
+      for (int c = 0; c < n; c++)
+      {
+        const FP* x = in[c] + offset;
+        m_peak = std::max(m_peak, m_true_peak.process(c, x, len));
+        m_squares[c] += halp::sum_of_squares(x, len);
+      }
+      m_k_weighting.process(in, n, offset, len);
+
+      offset += len;
+      m_position += len;
+      if (m_position == m_block_frames)
+        end_block();
+    }
+
+    double peak = m_peak;
+    for (int b = 0; b < peak_blocks; b++)
+      peak = std::max(peak, m_blocks[index(b)].peak);
+    m_value.peak = decibels(peak * peak);
+  }
+
+  const meter_value& value() const noexcept { return m_value; }
+
+private:
+  static constexpr int peak_blocks = 3;
+  static constexpr int rms_blocks = 3;
+  static constexpr int momentary_blocks = 4;
+  static constexpr int short_term_blocks = 30;
+
+  struct block
+  {
+    double peak{};        // Amplitude
+    double mean_square{}; // Of the loudest channel
+    double loudness{};    // Weighted sum of the mean squares of the K-weighted channels
+  };
+
+  // The b-th last block
+  int index(int b) const noexcept
+  {
+    return (m_last - b + short_term_blocks) % short_term_blocks;
+  }
+
+  void end_block() noexcept
+  {
+    const double frames = m_block_frames;
+    block b{.peak = double(m_peak)};
+    for (int c = 0; c < m_channels; c++)
+    {
+      b.mean_square = std::max(b.mean_square, double(m_squares[c]) / frames);
+      b.loudness += m_weights[c] * double(m_k_weighting.energy(c)) / frames;
+    }
+    std::fill(m_squares.begin(), m_squares.end(), FP(0));
+    m_k_weighting.clear_energy();
+    m_peak = FP(0);
+    m_position = 0;
+
+    m_last = (m_last + 1) % short_term_blocks;
+    m_blocks[m_last] = b;
+
+    double rms{}, momentary{}, short_term{};
+    for (int k = 0; k < short_term_blocks; k++)
+    {
+      const block& x = m_blocks[index(k)];
+      if (k < rms_blocks)
+        rms += x.mean_square;
+      if (k < momentary_blocks)
+        momentary += x.loudness;
+      short_term += x.loudness;
+    }
+    m_value.rms = decibels(rms / rms_blocks);
+    m_value.momentary = lufs(momentary / momentary_blocks);
+    m_value.short_term = lufs(short_term / short_term_blocks);
+  }
+
+  // From a power
+  static float decibels(double p) noexcept
+  {
+    return p > 0. ? std::max(float(10. * std::log10(p)), meter_value::floor)
+                  : meter_value::floor;
+  }
+  static float lufs(double p) noexcept
+  {
+    return p > 0. ? std::max(float(-0.691 + 10. * std::log10(p)), meter_value::floor)
+                  : meter_value::floor;
+  }
+
+  int m_channels{};
+  true_peak<FP> m_true_peak;
+  k_weighting<FP> m_k_weighting;
+  std::vector<FP> m_squares;
+  std::vector<double> m_weights;
+
+  int m_block_frames{1};
+  int m_position{};
+  FP m_peak{};
+  std::array<block, short_term_blocks> m_blocks{};
+  int m_last{};
+  meter_value m_value{};
+};
+}
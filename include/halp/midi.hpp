@@ -2,32 +2,301 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
+#include <avnd/common/freestanding.hpp>
+#include <avnd/common/span_polyfill.hpp>
 #include <halp/static_string.hpp>
+
+#if !AVND_FREESTANDING
 #include <boost/container/small_vector.hpp>
+#endif
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace halp
 {
 
 struct midi_msg
 {
+#if AVND_FREESTANDING
+  // Longer messages are truncated, the system exclusive ones go in midi_event_bus
+  avnd::static_vector<uint8_t, 15> bytes;
+#else
   boost::container::small_vector<uint8_t, 15> bytes;
+#endif
   int64_t timestamp{};
 };
 
-template <static_string lit>
+/**
+ * Vector-like container with a fixed capacity, which never allocates.
+ *
+ * Messages pushed when it is full are dropped and counted in overflows(),
+ * reserve() and resize() are clamped to the capacity.
+ */
+template <typename T, std::size_t Capacity>
+class midi_message_buffer
+{
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  static constexpr size_type capacity() noexcept { return Capacity; }
+  size_type size() const noexcept { return m_size; }
+  bool empty() const noexcept { return m_size == 0; }
+  bool full() const noexcept { return m_size == Capacity; }
+
+  // Number of messages dropped since construction because the buffer was full
+  std::size_t overflows() const noexcept { return m_overflows; }
+
+  void reserve(size_type) noexcept { }
+  void resize(size_type n)
+  {
+    n = std::min(n, Capacity);
+    for (size_type i = m_size; i < n; i++)
+      m_data[i] = T{};
+    m_size = n;
+  }
+
+  // Keeps the elements alive so that their own storage can be reused
+  void clear() noexcept { m_size = 0; }
+
+  void push_back(const T& msg)
+  {
+    if (full())
+      m_overflows++;
+    else
+      m_data[m_size++] = msg;
+  }
+
+  void push_back(T&& msg)
+  {
+    if (full())
+      m_overflows++;
+    else
+      m_data[m_size++] = std::move(msg);
+  }
+
+  template <typename... Args>
+  void emplace_back(Args&&... args)
+  {
+    if (full())
+      m_overflows++;
+    else
+      m_data[m_size++] = T{std::forward<Args>(args)...};
+  }
+
+  T* data() noexcept { return m_data.data(); }
+  const T* data() const noexcept { return m_data.data(); }
+
+  iterator begin() noexcept { return m_data.data(); }
+  iterator end() noexcept { return m_data.data() + m_size; }
+  const_iterator begin() const noexcept { return m_data.data(); }
+  const_iterator end() const noexcept { return m_data.data() + m_size; }
+  const_iterator cbegin() const noexcept { return begin(); }
+  const_iterator cend() const noexcept { return end(); }
+
+  T& front() noexcept { return m_data[0]; }
+  T& back() noexcept { return m_data[m_size - 1]; }
+  const T& front() const noexcept { return m_data[0]; }
+  const T& back() const noexcept { return m_data[m_size - 1]; }
+
+  T& operator[](size_type i) noexcept { return m_data[i]; }
+  const T& operator[](size_type i) const noexcept { return m_data[i]; }
+
+private:
+  std::array<T, Capacity> m_data{};
+  size_type m_size{};
+  std::size_t m_overflows{};
+};
+
+/**
+ * A channel message in 8 bytes which never allocate: the status, the two data bytes
+ * and the frame in the buffer. An array of them is filled by the bindings and read
+ * by the processors without chasing any pointer, see midi_event_bus.
+ */
+struct midi_event
+{
+  std::array<uint8_t, 3> bytes{};
+  int32_t timestamp{};
+};
+static_assert(sizeof(midi_event) == 8 && std::is_trivially_copyable_v<midi_event>);
+
+// A system exclusive message, whose bytes are in the sysex storage of its bus
+struct midi_sysex
+{
+  avnd::span<const uint8_t> bytes;
+  int32_t timestamp{};
+};
+
+/**
+ * The system exclusive messages received during a buffer: their bytes are copied
+ * one after the other in a fixed storage, which clear() makes available again.
+ * The messages which do not fit are dropped and counted in overflows().
+ */
+template <std::size_t Bytes, std::size_t Count>
+class midi_sysex_arena
+{
+public:
+  bool push(const uint8_t* data, std::size_t size, int32_t timestamp) noexcept
+  {
+    if (m_messages.full() || size > Bytes - m_used)
+    {
+      m_overflows++;
+      return false;
+    }
+
+    std::memcpy(m_bytes.data() + m_used, data, size);
+    m_messages.push_back({{m_bytes.data() + m_used, size}, timestamp});
+    m_used += size;
+    return true;
+  }
+
+  void clear() noexcept
+  {
+    m_messages.clear();
+    m_used = 0;
+  }
+
+  std::size_t size() const noexcept { return m_messages.size(); }
+  bool empty() const noexcept { return m_messages.empty(); }
+  std::size_t overflows() const noexcept { return m_overflows; }
+
+  auto begin() const noexcept { return m_messages.begin(); }
+  auto end() const noexcept { return m_messages.end(); }
+  const midi_sysex& operator[](std::size_t i) const noexcept { return m_messages[i]; }
+
+private:
+  std::array<uint8_t, Bytes> m_bytes{};
+  std::size_t m_used{};
+  midi_message_buffer<midi_sysex, Count> m_messages;
+  std::size_t m_overflows{};
+};
+
+/**
+ * The system exclusive messages received during a buffer, without copying them:
+ * the bindings which can, e.g. CLAP and VST3, give views of the bytes of the host
+ * with push_view(), which are valid until the end of the buffer.
+ *
+ * Dumps which come in several parts, the first one starting with F0 and the last one
+ * ending with F7, possibly across several buffers, are put together in a buffer of
+ * AccumulateBytes allocated with the stream: the message is seen once its last part
+ * arrived. Without this buffer such parts are dropped and counted in overflows(),
+ * as are the messages given with push(), whose bytes the binding does not keep.
+ */
+template <std::size_t Count, std::size_t AccumulateBytes = 0>
+class midi_sysex_stream
+{
+public:
+  midi_sysex_stream()
+      : m_buffer(AccumulateBytes)
+  {
+  }
+
+  void push_view(const uint8_t* data, std::size_t size, int32_t timestamp) noexcept
+  {
+    if (size == 0)
+      return;
+
+    if (!m_partial && data[0] == 0xF0 && data[size - 1] == 0xF7)
+      m_messages.push_back({{data, size}, timestamp});
+    else
+      accumulate(data, size, timestamp);
+  }
+
+  bool push(const uint8_t* data, std::size_t size, int32_t timestamp) noexcept
+  {
+    return size > 0 && accumulate(data, size, timestamp);
+  }
+
+  // The part of a dump received so far stays for the next buffers
+  void clear() noexcept
+  {
+    m_messages.clear();
+    if (m_partial)
+      std::memmove(m_buffer.data(), m_buffer.data() + m_start, m_used - m_start);
+    m_used -= m_start;
+    m_start = 0;
+  }
+
+  std::size_t size() const noexcept { return m_messages.size(); }
+  bool empty() const noexcept { return m_messages.empty(); }
+  std::size_t overflows() const noexcept { return m_overflows + m_messages.overflows(); }
+
+  auto begin() const noexcept { return m_messages.begin(); }
+  auto end() const noexcept { return m_messages.end(); }
+  const midi_sysex& operator[](std::size_t i) const noexcept { return m_messages[i]; }
+
+private:
+  bool accumulate(const uint8_t* data, std::size_t size, int32_t timestamp) noexcept
+  {
+    if (data[0] == 0xF0)
+    {
+      // A new dump before the end of the previous one
+      if (m_partial)
+      {
+        m_overflows++;
+        m_used = m_start;
+      }
+      m_partial = true;
+    }
+    else if (!m_partial)
+    {
+      m_overflows++;
+      return false;
+    }
+
+    if (size > m_buffer.size() - m_used)
+    {
+      m_overflows++;
+      m_partial = false;
+      m_used = m_start;
+      return false;
+    }
+
+    std::memcpy(m_buffer.data() + m_used, data, size);
+    m_used += size;
+    if (data[size - 1] == 0xF7)
+    {
+      m_messages.push_back({{m_buffer.data() + m_start, m_used - m_start}, timestamp});
+      m_partial = false;
+      m_start = m_used;
+    }
+    return true;
+  }
+
+  std::vector<uint8_t> m_buffer;
+  std::size_t m_start{};
+  std::size_t m_used{};
+  bool m_partial{};
+  midi_message_buffer<midi_sysex, Count> m_messages;
+  std::size_t m_overflows{};
+};
+
+// Enough for dense streams such as MPE or high-rate CCs on large buffers
+inline constexpr std::size_t default_midi_bus_capacity = 512;
+
+template <static_string lit, std::size_t Capacity = default_midi_bus_capacity>
 struct midi_bus
 {
   static consteval auto name() { return std::string_view{lit.value}; }
 
-  boost::container::small_vector<midi_msg, 2> midi_messages;
+  midi_message_buffer<midi_msg, Capacity> midi_messages;
 
   operator auto &() noexcept { return midi_messages; }
   operator const auto &() const noexcept { return midi_messages; }
 
   auto size() const noexcept { return midi_messages.size(); }
-  auto empty() const noexcept { return midi_messages.size(); }
+  auto empty() const noexcept { return midi_messages.empty(); }
+  auto overflows() const noexcept { return midi_messages.overflows(); }
 
   auto begin() noexcept { return midi_messages.begin(); }
   auto end() noexcept { return midi_messages.end(); }
@@ -53,4 +322,88 @@ struct midi_bus
     midi_messages.emplace_back(std::forward<Args>(t)...);
   }
 };
+
+/**
+ * A MIDI bus of compact midi_event, for the processors which only care about
+ * channel messages, e.g. synthesizers: the system exclusive ones are kept
+ * apart, in the sysex arena of the bus, when the binding receives any.
+ */
+template <
+    static_string lit, std::size_t Capacity = default_midi_bus_capacity,
+    std::size_t SysexBytes = 4096, std::size_t SysexCount = 64,
+    typename Sysex = midi_sysex_arena<SysexBytes, SysexCount>>
+struct midi_event_bus
+{
+  static consteval auto name() { return std::string_view{lit.value}; }
+
+  midi_message_buffer<midi_event, Capacity> midi_messages;
+  Sysex sysex;
+
+  auto size() const noexcept { return midi_messages.size(); }
+  auto empty() const noexcept { return midi_messages.empty(); }
+  auto overflows() const noexcept { return midi_messages.overflows() + sysex.overflows(); }
+
+  auto begin() noexcept { return midi_messages.begin(); }
+  auto end() noexcept { return midi_messages.end(); }
+  auto begin() const noexcept { return midi_messages.begin(); }
+  auto end() const noexcept { return midi_messages.end(); }
+
+  auto& front() const noexcept { return midi_messages.front(); }
+  auto& back() const noexcept { return midi_messages.back(); }
+
+  auto& operator[](std::size_t i) const noexcept { return midi_messages[i]; }
+
+  void push_back(const midi_event& msg) { midi_messages.push_back(msg); }
+};
+
+// A message of one of the MIDI inputs of a processor, see merged_midi
+struct merged_midi_event
+{
+  avnd::span<const uint8_t> bytes;
+  int32_t timestamp{};
+  int port{};
+};
+
+/**
+ * The messages of all the MIDI inputs of the processor, in a single list
+ * sorted by timestamp, for the processors which have several inputs but handle
+ * their messages in order: the bindings merge the inputs, already sorted,
+ * into the merged_midi member of the processor.
+ * The bytes stay in the inputs, which are valid for the same buffer.
+ *
+ * struct {
+ *   halp::midi_bus<"Keys"> keys;
+ *   halp::midi_bus<"Pads"> pads;
+ * } inputs;
+ * halp::merged_midi<> merged_midi;
+ *
+ * for (auto& m : merged_midi)
+ *   handle(m.bytes, m.timestamp, m.port); // m.port: 0 for keys, 1 for pads
+ */
+template <std::size_t Capacity = 4 * default_midi_bus_capacity>
+struct merged_midi
+{
+  midi_message_buffer<merged_midi_event, Capacity> merged_messages;
+
+  auto size() const noexcept { return merged_messages.size(); }
+  auto empty() const noexcept { return merged_messages.empty(); }
+  auto overflows() const noexcept { return merged_messages.overflows(); }
+
+  auto begin() const noexcept { return merged_messages.begin(); }
+  auto end() const noexcept { return merged_messages.end(); }
+
+  auto& operator[](std::size_t i) const noexcept { return merged_messages[i]; }
+};
+
+/**
+ * A MIDI bus for the processors which receive large system exclusive dumps, e.g.
+ * patch librarians: the sysex are views of the bytes of the host, and the dumps
+ * in several parts are put together in a buffer of AccumulateBytes,
+ * see midi_sysex_stream.
+ */
+template <
+    static_string lit, std::size_t AccumulateBytes = 0, std::size_t SysexCount = 64,
+    std::size_t Capacity = default_midi_bus_capacity>
+using midi_sysex_stream_bus = midi_event_bus<
+    lit, Capacity, 0, 0, midi_sysex_stream<SysexCount, AccumulateBytes>>;
 }
@@ -0,0 +1,213 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace halp
+{
+/**
+ * Renders MIDI notes as control voltages, with one value per sample, for the
+ * processors in the style of modular synthesizers. Each voice has a gate,
+ * 1 while its note is held, a pitch in volts per octave, 0 V being the middle C
+ * (note 60), and a velocity between 0 and 1.
+ *
+ * The buffers are filled span by span between two messages instead of sample
+ * by sample. The notes go to the free voice whose note is the oldest, or to
+ * the oldest voice when they all play. prepare() allocates buffers for the voices,
+ * or bind() points a voice to the outputs of the processor, which then get
+ * the CV directly:
+ *
+ * halp::midi_to_cv<4> cv;
+ * void prepare(halp::setup info) { cv.prepare(info.rate, info.frames); }
+ * void operator()(int frames) {
+ *   cv(inputs.midi, frames);
+ *   for (int v = 0; v < cv.voices; v++)
+ *     render(cv.gate(v), cv.pitch(v), cv.velocity(v), frames);
+ * }
+ */
+template <int Voices = 1, typename Sample = float>
+class midi_to_cv
+{
+public:
+  static constexpr int voices = Voices;
+
+  // Time for the pitch to get close to a new note, 0 for none
+  double glide_ms{};
+
+  // Semitones of a full pitch bend
+  double bend_range{2.};
+
+  // Without max_frames, the voices have to be bound to buffers before rendering
+  void prepare(double rate, int max_frames = 0)
+  {
+    m_rate = rate;
+    m_storage.assign(std::size_t(3 * Voices) * max_frames, Sample{});
+    for (int v = 0; v < Voices; v++)
+    {
+      if (max_frames > 0)
+      {
+        Sample* s = m_storage.data() + std::size_t(3 * v) * max_frames;
+        bind(v, s, s + max_frames, s + 2 * max_frames);
+      }
+      else
+      {
+        bind(v, nullptr, nullptr, nullptr);
+      }
+    }
+  }
+
+  // The voice renders in these buffers, e.g. output channels, from now on.
+  // A voice without buffers is not rendered.
+  void bind(int voice, Sample* gate, Sample* pitch, Sample* velocity) noexcept
+  {
+    m_out[voice] = {gate, pitch, velocity};
+  }
+
+  const Sample* gate(int voice) const noexcept { return m_out[voice].gate; }
+  const Sample* pitch(int voice) const noexcept { return m_out[voice].pitch; }
+  const Sample* velocity(int voice) const noexcept { return m_out[voice].velocity; }
+
+  // Renders a buffer, with the messages of a bus sorted by timestamp
+  template <typename Bus>
+  void operator()(const Bus& midi, int frames) noexcept
+  {
+    const double coef
+        = glide_ms > 0. ? 1. - std::exp(-1000. / (glide_ms * m_rate)) : 1.;
+
+    int pos = 0;
+    for (const auto& m : midi)
+    {
+      const int frame = std::clamp(int(m.timestamp), pos, frames);
+      render(pos, frame, coef);
+      pos = frame;
+      apply(std::data(m.bytes), std::size(m.bytes));
+    }
+    render(pos, frames, coef);
+  }
+
+  // Releases all the notes
+  void reset() noexcept
+  {
+    for (auto& v : m_voices)
+      v.held = false;
+    m_bend = 0.;
+  }
+
+private:
+  struct outputs
+  {
+    Sample* gate{};
+    Sample* pitch{};
+    Sample* velocity{};
+  };
+
+  struct voice
+  {
+    int note{-1};
+    bool held{};
+    double velocity{};
+    double target{};
+    double pitch{};
+    uint64_t age{};
+  };
+
+  void render(int first, int last, double coef) noexcept
+  {
+    const int n = last - first;
+    if (n <= 0)
+      return;
+
+    for (int k = 0; k < Voices; k++)
+    {
+      auto& v = m_voices[k];
+      auto& out = m_out[k];
+      if (!out.gate)
+        continue;
+
+      std::fill_n(out.gate + first, n, Sample(v.held ? 1 : 0));
+      std::fill_n(out.velocity + first, n, Sample(v.velocity));
+
+      // The pitch glides to the note, the bend applies at once
+      if (coef >= 1. || std::abs(v.target - v.pitch) < 1e-6)
+      {
+        v.pitch = v.target;
+        std::fill_n(out.pitch + first, n, Sample(v.pitch + m_bend));
+      }
+      else
+      {
+        for (int i = first; i < last; i++)
+        {
+          v.pitch += (v.target - v.pitch) * coef;
+          out.pitch[i] = Sample(v.pitch + m_bend);
+        }
+      }
+    }
+  }
+
+  template <typename Byte>
+  void apply(const Byte* bytes, std::size_t size) noexcept
+  {
+    if (size < 2)
+      return;
+
+    const int status = bytes[0] & 0xF0;
+    const int b1 = bytes[1] & 0x7F;
+    const int b2 = size > 2 ? bytes[2] & 0x7F : 0;
+    switch (status)
+    {
+      case 0x90:
+        if (b2 > 0)
+        {
+          note_on(b1, b2);
+          break;
+        }
+        [[fallthrough]];
+      case 0x80:
+        for (auto& v : m_voices)
+          if (v.held && v.note == b1)
+            v.held = false;
+        break;
+      case 0xB0:
+        // All notes off
+        if (b1 == 123)
+          for (auto& v : m_voices)
+            v.held = false;
+        break;
+      case 0xE0:
+        m_bend = bend_range * ((b1 | (b2 << 7)) - 8192) / (8192. * 12.);
+        break;
+      default:
+        break;
+    }
+  }
+
+  void note_on(int note, int velocity) noexcept
+  {
+    // The oldest free voice, else the oldest one
+    voice* best = nullptr;
+    for (auto& v : m_voices)
+      if (!best || (v.held == best->held ? v.age < best->age : !v.held))
+        best = &v;
+
+    best->note = note;
+    best->held = true;
+    best->velocity = velocity / 127.;
+    best->target = (note - 60) / 12.;
+    best->age = ++m_clock;
+  }
+
+  std::array<voice, Voices> m_voices{};
+  std::array<outputs, Voices> m_out{};
+  std::vector<Sample> m_storage;
+  double m_rate{48000.};
+  double m_bend{};
+  uint64_t m_clock{};
+};
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <span>
+#include <type_traits>
+
+namespace halp
+{
+/**
+ * Gets the modulation of a control from the hosts which support it, e.g. CLAP,
+ * as an offset next to the value set by the host instead of summed into it:
+ * halp::modulated<halp::knob_f32<"Cutoff", halp::range{20., 20000., 1000.}>> cutoff;
+ *
+ * value + modulation stays within the range of the control.
+ */
+template <typename Control>
+struct modulated : Control
+{
+  using value_type = std::decay_t<decltype(Control::value)>;
+
+  value_type modulation{};
+
+  value_type modulated_value() const noexcept { return this->value + modulation; }
+
+  using Control::operator=;
+};
+
+/**
+ * Lets the host modulate a continuous control at audio rate, e.g. from an LFO
+ * or another signal: halp::modulatable<halp::knob_f32<"Cutoff", ...>> cutoff;
+ *
+ * While it is modulated, value is the average of the modulated value over the buffer.
+ */
+template <typename Control>
+struct modulatable : Control
+{
+  halp_flag(audio_rate_modulation);
+
+  using Control::operator=;
+};
+
+/**
+ * Same, with the modulated value of each frame:
+ * for (int i = 0; i < N; i++) out[i] = in[i] * inputs.gain[i];
+ */
+template <typename Control>
+struct audio_rate_modulated : modulatable<Control>
+{
+  using value_type = std::decay_t<decltype(Control::value)>;
+  static_assert(std::is_floating_point_v<value_type>);
+
+  // Set by the host for each buffer: value plus the modulation at each frame,
+  // within the range of the control, or empty when it is not modulated.
+  std::span<const value_type> modulated;
+
+  value_type operator[](int frame) const noexcept
+  {
+    return modulated.empty() ? this->value : modulated[frame];
+  }
+
+  using modulatable<Control>::operator=;
+};
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/controls.hpp>
+
+namespace halp
+{
+/**
+ * Makes a control morph all the others between the programs of the processor:
+ * halp::morph<halp::hslider_f32<"Morph">> morph;
+ * goes from programs[0] to programs[1], and
+ * halp::morph<halp::xy_pad_f32<"Morph">> morph;
+ * between the first four, one in each corner.
+ */
+template <typename Control>
+struct morph : Control
+{
+  static constexpr bool morph_programs = true;
+
+  using Control::operator=;
+};
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/concepts/midi_port.hpp>
+#include <halp/midi.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace halp
+{
+// The expressions of a note, see avnd::note_expression
+struct note_expressions
+{
+  float volume{1.f};
+  float pan{0.5f};
+  float tuning{};
+  float vibrato{};
+  float expression{};
+  float brightness{};
+  float pressure{};
+};
+
+/**
+ * The current expressions of each note, by MIDI channel and key, which the bindings
+ * update in place from the note expressions of the host (CLAP, VST3) and from the
+ * MPE channel messages: a voice reads the ones of its note with a lookup
+ * instead of parsing MIDI messages.
+ *
+ * MPE gives its own channel to each note, and the pitch bend, channel pressure
+ * and CC 74 of that channel apply to it: they are kept per channel and added
+ * to the values of the note when they are read.
+ */
+class note_expression_table
+{
+public:
+  // Semitones of a full pitch bend: 48 for the notes in MPE
+  float bend_range{48.f};
+
+  note_expressions operator()(int channel, int key) const noexcept
+  {
+    note_expressions e = m_notes[channel & 15][key & 127];
+    const auto& c = m_channels[channel & 15];
+    e.tuning += c.tuning;
+    e.brightness += c.brightness;
+    e.pressure += c.pressure;
+    return e;
+  }
+
+  // A negative channel or key sets the expression of all of them
+  void set(int channel, int key, avnd::note_expression expr, double value) noexcept
+  {
+    const int c0 = channel < 0 ? 0 : channel & 15;
+    const int c1 = channel < 0 ? 16 : c0 + 1;
+    const int k0 = key < 0 ? 0 : key & 127;
+    const int k1 = key < 0 ? 128 : k0 + 1;
+    for (int c = c0; c < c1; c++)
+      for (int k = k0; k < k1; k++)
+        field(m_notes[c][k], expr) = float(value);
+  }
+
+  // The channel messages which carry expressions
+  void update(const unsigned char* bytes, std::size_t size) noexcept
+  {
+    if (size < 2)
+      return;
+
+    const int channel = bytes[0] & 15;
+    const auto value = [&](int i) { return i < int(size) ? bytes[i] & 127 : 0; };
+    switch (bytes[0] & 0xF0)
+    {
+      case 0x90:
+        // A new note starts from the default expressions
+        if (value(2) > 0)
+          m_notes[channel][value(1)] = {};
+        break;
+      case 0xA0:
+        m_notes[channel][value(1)].pressure = value(2) / 127.f;
+        break;
+      case 0xB0:
+        if (value(1) == 74)
+          m_channels[channel].brightness = value(2) / 127.f;
+        break;
+      case 0xD0:
+        m_channels[channel].pressure = value(1) / 127.f;
+        break;
+      case 0xE0:
+        m_channels[channel].tuning
+            = bend_range * float((value(1) | (value(2) << 7)) - 8192) / 8192.f;
+        break;
+      default:
+        break;
+    }
+  }
+
+  void reset() noexcept
+  {
+    for (auto& channel : m_notes)
+      channel.fill({});
+    m_channels.fill({});
+  }
+
+private:
+  static float& field(note_expressions& e, avnd::note_expression expr) noexcept
+  {
+    switch (expr)
+    {
+      case avnd::note_expression::volume:
+        return e.volume;
+      case avnd::note_expression::pan:
+        return e.pan;
+      case avnd::note_expression::tuning:
+        return e.tuning;
+      case avnd::note_expression::vibrato:
+        return e.vibrato;
+      case avnd::note_expression::expression:
+        return e.expression;
+      case avnd::note_expression::brightness:
+        return e.brightness;
+      case avnd::note_expression::pressure:
+      default:
+        return e.pressure;
+    }
+  }
+
+  struct channel_expressions
+  {
+    float tuning{};
+    float brightness{};
+    float pressure{};
+  };
+
+  std::array<std::array<note_expressions, 128>, 16> m_notes{};
+  std::array<channel_expressions, 16> m_channels{};
+};
+
+/**
+ * A MIDI bus of compact events, see midi_event_bus, with the expressions of each note:
+ *
+ * for (auto& voice : voices)
+ *   voice.detune(inputs.midi.expressions(voice.channel, voice.key).tuning);
+ */
+template <static_string lit, std::size_t Capacity = default_midi_bus_capacity>
+struct mpe_bus : midi_event_bus<lit, Capacity>
+{
+  note_expression_table expressions;
+};
+}
@@ -0,0 +1,405 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/span_polyfill.hpp>
+#include <halp/fastmath.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+
+/**
+ * Random numbers for the audio thread: small generators, held by the processor,
+ * instead of rand() which locks a global state on some platforms, or a
+ * thread_local std::mt19937 which costs a TLS lookup at each call.
+ *
+ * - xoshiro128 and pcg32 give one number per call, e.g. per sample or per grain.
+ *   They are UniformRandomBitGenerators, thus also work with the std:: distributions.
+ * - xoshiro128x8 runs eight xoshiro128 side by side: its fill_ functions
+ *   generate whole buffers, in loops the compiler vectorizes.
+ * - philox4x32 is counter-based: the value at a position of a stream only depends
+ *   on the seed, the stream and the position, so that threads or voices can each
+ *   generate their part and get the same values as a single thread would.
+ *
+ * Seeded with random_seed(), each instance gets its own sequence; with a fixed seed,
+ * the sequence is the same at each run, e.g. for tests or offline renders.
+ * None of them is meant for cryptography.
+ */
+namespace halp
+{
+// Mixes a 64-bit counter into well-spread values, used to seed the generators
+constexpr uint64_t splitmix64(uint64_t& state) noexcept
+{
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// A different seed at each call, e.g. for each instance of a processor
+inline uint64_t random_seed() noexcept
+{
+  static std::atomic<uint64_t> counter{
+      uint64_t(std::chrono::steady_clock::now().time_since_epoch().count())};
+  uint64_t s = counter.fetch_add(0x9E3779B97F4A7C15ull, std::memory_order_relaxed);
+  return splitmix64(s);
+}
+
+namespace detail
+{
+// In [0; 1[, from the 24 high bits: all the floats of this form are equally likely
+template <std::floating_point FP>
+constexpr FP unit(uint32_t x) noexcept
+{
+  return FP(x >> 8) * FP(0x1p-24);
+}
+}
+
+/**
+ * xoshiro128++ by D. Blackman and S. Vigna: 128 bits of state, a period of 2^128 - 1.
+ */
+class xoshiro128
+{
+public:
+  using result_type = uint32_t;
+
+  explicit constexpr xoshiro128(uint64_t seed = 0x853C49E6748FEA9Bull) noexcept
+  {
+    this->seed(seed);
+  }
+
+  constexpr void seed(uint64_t seed) noexcept
+  {
+    const uint64_t a = splitmix64(seed);
+    const uint64_t b = splitmix64(seed);
+    m_s = {uint32_t(a), uint32_t(a >> 32), uint32_t(b), uint32_t(b >> 32)};
+  }
+
+  static constexpr result_type min() noexcept { return 0; }
+  static constexpr result_type max() noexcept
+  {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  constexpr result_type operator()() noexcept
+  {
+    auto& s = m_s;
+    const uint32_t result = std::rotl(s[0] + s[3], 7) + s[0];
+    const uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = std::rotl(s[3], 11);
+    return result;
+  }
+
+  // In [0; 1[
+  template <std::floating_point FP = float>
+  constexpr FP uniform() noexcept
+  {
+    return detail::unit<FP>((*this)());
+  }
+
+  // In [-1; 1[
+  template <std::floating_point FP = float>
+  constexpr FP bipolar() noexcept
+  {
+    return FP(2) * uniform<FP>() - FP(1);
+  }
+
+  constexpr const std::array<uint32_t, 4>& state() const noexcept { return m_s; }
+
+private:
+  std::array<uint32_t, 4> m_s{};
+};
+
+/**
+ * PCG32 (XSH RR) by M. O'Neill: 64 bits of state, and 2^63 streams
+ * which give different sequences for a same seed.
+ */
+class pcg32
+{
+public:
+  using result_type = uint32_t;
+
+  explicit constexpr pcg32(
+      uint64_t seed = 0x853C49E6748FEA9Bull, uint64_t stream = 0xDA3E39CB94B95BDBull) noexcept
+  {
+    this->seed(seed, stream);
+  }
+
+  constexpr void seed(uint64_t seed, uint64_t stream = 0xDA3E39CB94B95BDBull) noexcept
+  {
+    m_state = 0;
+    m_inc = (stream << 1) | 1;
+    (*this)();
+    m_state += seed;
+    (*this)();
+  }
+
+  static constexpr result_type min() noexcept { return 0; }
+  static constexpr result_type max() noexcept
+  {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  constexpr result_type operator()() noexcept
+  {
+    const uint64_t old = m_state;
+    m_state = old * multiplier + m_inc;
+    const auto xorshifted = uint32_t(((old >> 18) ^ old) >> 27);
+    return std::rotr(xorshifted, int(old >> 59));
+  }
+
+  // Skips n numbers in log(n) steps, e.g. to give each thread its part of a sequence
+  constexpr void discard(uint64_t n) noexcept
+  {
+    uint64_t mult = multiplier, plus = m_inc;
+    uint64_t acc_mult = 1, acc_plus = 0;
+    for (; n > 0; n >>= 1)
+    {
+      if (n & 1)
+      {
+        acc_mult *= mult;
+        acc_plus = acc_plus * mult + plus;
+      }
+      plus = (mult + 1) * plus;
+      mult *= mult;
+    }
+    m_state = acc_mult * m_state + acc_plus;
+  }
+
+  template <std::floating_point FP = float>
+  constexpr FP uniform() noexcept
+  {
+    return detail::unit<FP>((*this)());
+  }
+
+  template <std::floating_point FP = float>
+  constexpr FP bipolar() noexcept
+  {
+    return FP(2) * uniform<FP>() - FP(1);
+  }
+
+private:
+  static constexpr uint64_t multiplier = 6364136223846793005ull;
+  uint64_t m_state{};
+  uint64_t m_inc{};
+};
+
+/**
+ * Eight xoshiro128 side by side, for whole buffers of noise.
+ * Lane k gives the same sequence as a xoshiro128 with the state lane_state(k).
+ */
+class xoshiro128x8
+{
+public:
+  static constexpr int lanes = 8;
+
+  explicit xoshiro128x8(uint64_t seed = random_seed()) noexcept { this->seed(seed); }
+
+  void seed(uint64_t seed) noexcept
+  {
+    for (int l = 0; l < lanes; l++)
+    {
+      const auto s = xoshiro128{splitmix64(seed)}.state();
+      m_s0[l] = s[0];
+      m_s1[l] = s[1];
+      m_s2[l] = s[2];
+      m_s3[l] = s[3];
+    }
+  }
+
+  std::array<uint32_t, 4> lane_state(int l) const noexcept
+  {
+    return {m_s0[l], m_s1[l], m_s2[l], m_s3[l]};
+  }
+
+  // One number per lane
+  void next(uint32_t* __restrict out) noexcept
+  {
+    for (int l = 0; l < lanes; l++)
+    {
+      const uint32_t s0 = m_s0[l], s1 = m_s1[l], s2 = m_s2[l], s3 = m_s3[l];
+      out[l] = std::rotl(s0 + s3, 7) + s0;
+      const uint32_t t = s1 << 9;
+      const uint32_t n2 = s2 ^ s0;
+      const uint32_t n3 = s3 ^ s1;
+      m_s1[l] = s1 ^ n2;
+      m_s0[l] = s0 ^ n3;
+      m_s2[l] = n2 ^ t;
+      m_s3[l] = std::rotl(n3, 11);
+    }
+  }
+
+  void fill_bits(avnd::span<uint32_t> out) noexcept
+  {
+    alignas(32) uint32_t r[lanes];
+    const std::size_t n = out.size();
+    std::size_t i = 0;
+    for (; i + lanes <= n; i += lanes)
+      next(out.data() + i);
+    if (i < n)
+    {
+      next(r);
+      for (std::size_t l = 0; i + l < n; l++)
+        out[i + l] = r[l];
+    }
+  }
+
+  // In [lo; hi[
+  template <std::floating_point FP>
+  void fill_uniform(avnd::span<FP> out, FP lo = FP(0), FP hi = FP(1)) noexcept
+  {
+    alignas(32) uint32_t r[lanes];
+    const FP scale = (hi - lo) * FP(0x1p-24);
+    const std::size_t n = out.size();
+    FP* __restrict o = out.data();
+    std::size_t i = 0;
+    for (; i + lanes <= n; i += lanes)
+    {
+      next(r);
+      for (int l = 0; l < lanes; l++)
+        o[i + l] = lo + FP(r[l] >> 8) * scale;
+    }
+    if (i < n)
+    {
+      next(r);
+      for (std::size_t l = 0; i + l < n; l++)
+        o[i + l] = lo + FP(r[l] >> 8) * scale;
+    }
+  }
+
+  // In [-1; 1[
+  template <std::floating_point FP>
+  void fill_bipolar(avnd::span<FP> out) noexcept
+  {
+    fill_uniform(out, FP(-1), FP(1));
+  }
+
+  // Normal distribution, by Box-Muller on the approximations of halp::fastmath:
+  // the tails stop at about 5.6 standard deviations for float, 8.5 for double.
+  template <std::floating_point FP>
+  void fill_gaussian(avnd::span<FP> out, FP mean = FP(0), FP stddev = FP(1)) noexcept
+  {
+    alignas(32) uint32_t a[lanes], b[lanes];
+    alignas(32) FP g[2 * lanes];
+    const std::size_t n = out.size();
+    FP* __restrict o = out.data();
+    std::size_t i = 0;
+    while (i < n)
+    {
+      next(a);
+      next(b);
+      for (int l = 0; l < lanes; l++)
+      {
+        // u in ]0; 1] so that the log is finite
+        const FP u = FP((a[l] >> 8) + 1) * FP(0x1p-24);
+        const FP theta = FP(2. * std::numbers::pi) * detail::unit<FP>(b[l]);
+        const FP r = stddev
+                     * std::sqrt(FP(-2. * std::numbers::ln2) * fastmath::log2(u));
+        g[l] = mean + r * fastmath::sin(theta + FP(std::numbers::pi / 2.));
+        g[lanes + l] = mean + r * fastmath::sin(theta);
+      }
+      const std::size_t count = std::min(n - i, std::size_t(2 * lanes));
+      for (std::size_t k = 0; k < count; k++)
+        o[i + k] = g[k];
+      i += count;
+    }
+  }
+
+private:
+  alignas(32) uint32_t m_s0[lanes]{};
+  alignas(32) uint32_t m_s1[lanes]{};
+  alignas(32) uint32_t m_s2[lanes]{};
+  alignas(32) uint32_t m_s3[lanes]{};
+};
+
+/**
+ * Philox4x32-10 by J. Salmon et al.: four numbers at each position of a stream,
+ * computed from the seed, the stream and the position only.
+ */
+class philox4x32
+{
+public:
+  using block = std::array<uint32_t, 4>;
+
+  explicit constexpr philox4x32(uint64_t seed = 0) noexcept
+      : m_key{uint32_t(seed), uint32_t(seed >> 32)}
+  {
+  }
+
+  static constexpr block generate(block ctr, std::array<uint32_t, 2> key) noexcept
+  {
+    for (int round = 0; round < 10; round++)
+    {
+      if (round > 0)
+      {
+        key[0] += 0x9E3779B9u;
+        key[1] += 0xBB67AE85u;
+      }
+      const uint64_t p0 = uint64_t(0xD2511F53u) * ctr[0];
+      const uint64_t p1 = uint64_t(0xCD9E8D57u) * ctr[2];
+      ctr = {
+          uint32_t(p1 >> 32) ^ ctr[1] ^ key[0], uint32_t(p1),
+          uint32_t(p0 >> 32) ^ ctr[3] ^ key[1], uint32_t(p0)};
+    }
+    return ctr;
+  }
+
+  // The four numbers at a position of a stream
+  constexpr block operator()(uint64_t position, uint64_t stream = 0) const noexcept
+  {
+    return generate(
+        {uint32_t(position), uint32_t(position >> 32), uint32_t(stream),
+         uint32_t(stream >> 32)},
+        m_key);
+  }
+
+  // The number at index i of a stream: number i % 4 at position i / 4
+  constexpr uint32_t at(uint64_t index, uint64_t stream = 0) const noexcept
+  {
+    return (*this)(index / 4, stream)[index % 4];
+  }
+
+  // out[k] gets the number at index first + k, in [lo; hi[:
+  // the same values whichever way a stream is split across calls.
+  template <std::floating_point FP>
+  void fill_uniform(
+      avnd::span<FP> out, uint64_t first, uint64_t stream = 0, FP lo = FP(0),
+      FP hi = FP(1)) const noexcept
+  {
+    const FP scale = (hi - lo) * FP(0x1p-24);
+    const std::size_t n = out.size();
+    std::size_t k = 0;
+    for (; k < n && (first + k) % 4 != 0; k++)
+      out[k] = lo + FP(at(first + k, stream) >> 8) * scale;
+
+    const uint64_t position = (first + k) / 4;
+    const std::size_t blocks = (n - k) / 4;
+    FP* __restrict o = out.data() + k;
+    for (std::size_t b = 0; b < blocks; b++)
+    {
+      const block r = (*this)(position + b, stream);
+      for (int l = 0; l < 4; l++)
+        o[4 * b + l] = lo + FP(r[l] >> 8) * scale;
+    }
+    for (k += 4 * blocks; k < n; k++)
+      out[k] = lo + FP(at(first + k, stream) >> 8) * scale;
+  }
+
+private:
+  std::array<uint32_t, 2> m_key{};
+};
+}
@@ -6,29 +6,67 @@
 namespace halp
 {
 
-template <typename T>
+enum class notification
+{
+  // notify is called by each assignment
+  immediate,
+  // Assignments only mark the value as changed, notify is called once by flush():
+  // the bindings do it for the controls once they applied the changes of a buffer,
+  // in the order of the inputs
+  deferred
+};
+
+template <typename T, notification Mode = notification::immediate>
 struct reactive_value
 {
   T value;
 
   basic_callback<void(const T&)> notify;
 
+  bool dirty{};
+
   operator T&() noexcept { return value; }
   operator const T&() const noexcept { return value; }
 
   reactive_value& operator=(const T& t)
   {
     value = t;
-    if (notify)
-      notify(value);
+    changed();
+    return *this;
   }
 
   reactive_value& operator=(T&& t)
   {
-    value = t;
+    value = static_cast<T&&>(t);
+    changed();
+    return *this;
+  }
+
+  // Calls notify if the value was assigned since the last call
+  void flush()
+  {
+    if (!dirty)
+      return;
+    dirty = false;
     if (notify)
       notify(value);
   }
+
+private:
+  void changed()
+  {
+    if constexpr (Mode == notification::deferred)
+    {
+      dirty = true;
+    }
+    else if (notify)
+    {
+      notify(value);
+    }
+  }
 };
 
+template <typename T>
+using deferred_reactive_value = reactive_value<T, notification::deferred>;
+
 }
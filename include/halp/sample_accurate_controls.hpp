@@ -3,18 +3,88 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <halp/controls.hpp>
-#include <boost/container/small_vector.hpp>
-#include <boost/container/flat_map.hpp>
 
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
 
 namespace halp
 {
 
+/**
+ * The values of a sample-accurate port in a buffer, as (frame, value) pairs by frame.
+ *
+ * Bindings give the values in order, which are appended; values[frame] = v is
+ * otherwise a sorted insertion, like with a map. reserve() is called by the bindings
+ * with the buffer size, which is the most values a buffer can have: they are then
+ * never allocated on the audio thread.
+ */
+template <typename T>
+class timed_values
+{
+public:
+  using value_type = std::pair<int, T>;
+  using allocator_type = std::allocator<value_type>;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  T& operator[](int frame)
+  {
+    if (m_values.empty() || m_values.back().first < frame)
+      return m_values.emplace_back(frame, T{}).second;
+    if (m_values.back().first == frame)
+      return m_values.back().second;
+
+    auto it = std::lower_bound(
+        m_values.begin(), m_values.end(), frame,
+        [](const value_type& v, int f) { return v.first < f; });
+    if (it->first != frame)
+      it = m_values.emplace(it, frame, T{});
+    return it->second;
+  }
+
+  void reserve(std::size_t n) { m_values.reserve(n); }
+  void clear() noexcept { m_values.clear(); }
+
+  [[nodiscard]] bool empty() const noexcept { return m_values.empty(); }
+  [[nodiscard]] std::size_t size() const noexcept { return m_values.size(); }
+
+  iterator begin() noexcept { return m_values.begin(); }
+  iterator end() noexcept { return m_values.end(); }
+  const_iterator begin() const noexcept { return m_values.begin(); }
+  const_iterator end() const noexcept { return m_values.end(); }
+
+  /**
+   * Writes the value at every frame of out: previous until the first value,
+   * then each one until the next. Returns the value at the end, i.e. the
+   * previous of the next buffer.
+   */
+  T render(std::span<T> out, T previous) const
+  {
+    const int frames = int(out.size());
+    int frame = 0;
+    for (const auto& [next, value] : m_values)
+    {
+      const int until = std::clamp(next, 0, frames);
+      std::fill(out.begin() + frame, out.begin() + until, previous);
+      frame = std::max(frame, until);
+      previous = value;
+    }
+    std::fill(out.begin() + frame, out.end(), previous);
+    return previous;
+  }
+
+private:
+  std::vector<value_type> m_values;
+};
+
 template <typename T>
 struct sample_accurate_values
 {
-  boost::container::small_flat_map<int, T, 16> values;
+  timed_values<T> values;
 };
 
 template <typename T>
@@ -0,0 +1,50 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+
+namespace halp
+{
+/**
+ * Read-only data which all the instances of a processor can share instead of
+ * each building its own copy: window functions, filter coefficient tables, impulse responses...
+ *
+ * std::shared_ptr<const window> win;
+ * void prepare(halp::setup info) { win = halp::shared_resource<window>(2048, shape); }
+ *
+ * The resource is built as Resource(args...) by the first instance which asks for it
+ * with these arguments, which are its key: they must be ordered with <.
+ * The others get the same one, until the last of them drops it, e.g. when it is
+ * prepared again with other arguments or deleted: it is then freed.
+ *
+ * This locks and may build the resource: call it from prepare() or the constructor,
+ * not from the audio thread, and drop the pointers outside of it too.
+ */
+template <typename Resource, typename... Args>
+std::shared_ptr<const Resource> shared_resource(const Args&... args)
+{
+  using key_type = std::tuple<std::decay_t<Args>...>;
+  struct registry
+  {
+    std::mutex mutex;
+    std::map<key_type, std::weak_ptr<const Resource>> resources;
+  };
+  static registry r;
+
+  std::lock_guard lock{r.mutex};
+  std::erase_if(r.resources, [](const auto& res) { return res.second.expired(); });
+
+  auto& slot = r.resources[key_type{args...}];
+  if (auto res = slot.lock())
+    return res;
+
+  auto res = std::make_shared<const Resource>(args...);
+  slot = res;
+  return res;
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/controls.hpp>
+
+#include <span>
+#include <type_traits>
+
+namespace halp
+{
+struct linear_smoothing
+{
+  enum smoothing
+  {
+    linear
+  };
+};
+
+struct exponential_smoothing
+{
+  enum smoothing
+  {
+    exponential
+  };
+};
+
+/**
+ * Makes the host smooth the changes of a floating-point control, e.g.
+ * halp::smoothed<halp::hslider_f32<"Gain">, 20.> gain;
+ *
+ * Milliseconds is the duration of a linear ramp,
+ * or the time constant of an exponential one.
+ */
+template <typename Control, double Milliseconds, typename Curve = linear_smoothing>
+struct smoothed
+    : Control
+    , Curve
+{
+  using value_type = std::decay_t<decltype(Control::value)>;
+  static_assert(std::is_floating_point_v<value_type>);
+
+  static clang_buggy_consteval double smoothing_time() { return Milliseconds; }
+
+  // Set by the host for each buffer: the value at each frame while it is moving
+  // towards "value", empty once it got there.
+  std::span<const value_type> ramp;
+
+  bool stable() const noexcept { return ramp.empty(); }
+
+  value_type operator[](int frame) const noexcept
+  {
+    return ramp.empty() ? this->value : ramp[frame];
+  }
+
+  using Control::operator=;
+};
+
+template <typename Control, double Milliseconds>
+using exp_smoothed = smoothed<Control, Milliseconds, exponential_smoothing>;
+
+}
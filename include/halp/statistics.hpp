@@ -0,0 +1,220 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/span_polyfill.hpp>
+#include <halp/fastmath.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Statistics of arrays, e.g. of spectra for feature extraction, computed in a single
+ * pass which gathers all the sums they need:
+ *
+ * auto s = halp::statistics::summarize(spectrum.data(), bins);
+ * centroid = s.centroid();
+ * flatness = s.flatness();
+ * entropy = s.entropy();
+ *
+ * The loops keep a partial sum per lane, so that the compilers vectorize them without
+ * being allowed to reorder floating-point additions; the logarithms are the ones of
+ * halp::fastmath, thus like them the float kernels vectorize with SSE2 and the double
+ * ones need e.g. AVX2 (at -O3 for GCC). The summaries of consecutive blocks merge into the one of their
+ * concatenation, which gives the statistics of a stream, see running.
+ */
+namespace halp::statistics
+{
+template <std::floating_point FP>
+struct summary
+{
+  int64_t count{};
+  FP sum{};
+  // Sum of the squared distances to the mean
+  FP m2{};
+  // Sum of i * x[i], i being the index from the start of the first block
+  FP weighted{};
+  // Sum of x log2(x), 0 for the zeros
+  FP xlog2x{};
+  // Sum of log2(x) over the non-zero values
+  FP log2_sum{};
+  int64_t zeros{};
+  int64_t negatives{};
+
+  FP mean() const noexcept { return count > 0 ? sum / FP(count) : FP(0); }
+
+  // Population variance
+  FP variance() const noexcept { return count > 0 ? m2 / FP(count) : FP(0); }
+
+  // Shannon entropy in bits of the array taken as a distribution, i.e. normalized
+  // by its sum; only meaningful without negative values
+  FP entropy() const noexcept
+  {
+    return sum > FP(0) ? std::log2(sum) - xlog2x / sum : FP(0);
+  }
+
+  // Center of mass, in indices
+  FP centroid() const noexcept { return sum != FP(0) ? weighted / sum : FP(0); }
+
+  // Geometric mean over arithmetic mean, 0 if there is a zero
+  FP flatness() const noexcept
+  {
+    if (count == 0 || zeros > 0 || sum <= FP(0))
+      return FP(0);
+    return std::exp2(log2_sum / FP(count)) / mean();
+  }
+
+  bool has_negatives() const noexcept { return negatives > 0; }
+
+  // next is the summary of the values which come right after these ones
+  void merge(const summary& next) noexcept
+  {
+    if (next.count == 0)
+      return;
+    if (count == 0)
+    {
+      *this = next;
+      return;
+    }
+
+    const FP n = FP(count + next.count);
+    const FP delta = next.mean() - mean();
+    m2 += next.m2 + delta * delta * FP(count) * FP(next.count) / n;
+    weighted += next.weighted + FP(count) * next.sum;
+    sum += next.sum;
+    xlog2x += next.xlog2x;
+    log2_sum += next.log2_sum;
+    zeros += next.zeros;
+    negatives += next.negatives;
+    count += next.count;
+  }
+};
+
+namespace detail
+{
+// Independent accumulators, one per lane of the widest vectors
+template <typename FP>
+constexpr int lanes = 64 / sizeof(FP);
+}
+
+template <std::floating_point FP>
+FP sum(const FP* x, int n) noexcept
+{
+  constexpr int L = detail::lanes<FP>;
+  FP s[L]{};
+  int i = 0;
+  for (; i + L <= n; i += L)
+    for (int k = 0; k < L; k++)
+      s[k] += x[i + k];
+  for (; i < n; i++)
+    s[0] += x[i];
+
+  FP r{};
+  for (int k = 0; k < L; k++)
+    r += s[k];
+  return r;
+}
+
+template <std::floating_point FP>
+FP mean(const FP* x, int n) noexcept
+{
+  return n > 0 ? statistics::sum(x, n) / FP(n) : FP(0);
+}
+
+template <fastmath::accuracy A = fastmath::accuracy::medium, std::floating_point FP>
+summary<FP> summarize(const FP* x, int n) noexcept
+{
+  summary<FP> r;
+  if (n <= 0)
+    return r;
+
+  // The squares are taken around the first value, which keeps them small
+  // when the values are far from 0, instead of a second pass around the mean
+  const FP shift = x[0];
+  using bits = typename fastmath::detail::ieee<FP>::bits;
+  constexpr int L = detail::lanes<FP>;
+  // The counts are kept as floating-point values, like the sums, to be in the same
+  // vectors; the minimum and maximum are not computed, as their selects keep
+  // GCC from vectorizing the loop
+  FP s[L]{}, q[L]{}, w[L]{}, e[L]{}, g[L]{}, z[L]{}, neg[L]{};
+
+  auto step = [&](int k, int i) {
+    const FP v = x[i];
+    const FP d = v - shift;
+    s[k] += d;
+    q[k] += d * d;
+    w[k] += FP(i) * v;
+    // fastmath::log2 takes the zeros as the smallest normal number: finite, thus
+    // multiplied by 0 instead of selected. Whether v is 0 is read on its bits,
+    // as GCC does not vectorize a loop with a second select of floats
+    const FP l = fastmath::log2<A>(v);
+    const FP nonzero = FP(int(std::min(std::bit_cast<bits>(v) << 1, bits(1))));
+    e[k] += v * l;
+    g[k] += nonzero * l;
+    z[k] += FP(1) - nonzero;
+    neg[k] += v < FP(0) ? FP(1) : FP(0);
+  };
+
+  int i = 0;
+  for (; i + L <= n; i += L)
+    for (int k = 0; k < L; k++)
+      step(k, i + k);
+  for (; i < n; i++)
+    step(0, i);
+
+  FP d{}, d2{}, zeros{}, negatives{};
+  for (int k = 0; k < L; k++)
+  {
+    d += s[k];
+    d2 += q[k];
+    r.weighted += w[k];
+    r.xlog2x += e[k];
+    r.log2_sum += g[k];
+    zeros += z[k];
+    negatives += neg[k];
+  }
+
+  r.count = n;
+  r.sum = d + FP(n) * shift;
+  r.m2 = std::max(d2 - d * d / FP(n), FP(0));
+  r.zeros = int64_t(zeros);
+  r.negatives = int64_t(negatives);
+  return r;
+}
+
+template <fastmath::accuracy A = fastmath::accuracy::medium, std::floating_point FP>
+summary<FP> summarize(avnd::span<const FP> x) noexcept
+{
+  return statistics::summarize<A>(x.data(), int(x.size()));
+}
+
+/**
+ * The statistics of a stream, updated with each block instead of
+ * recomputing them over all the values received so far:
+ *
+ * halp::statistics::running<float> level;
+ * level(in, frames);
+ * outputs.mean = level->mean();
+ */
+template <std::floating_point FP, fastmath::accuracy A = fastmath::accuracy::medium>
+class running
+{
+public:
+  void operator()(const FP* x, int n) noexcept
+  {
+    m_total.merge(statistics::summarize<A>(x, n));
+  }
+
+  const summary<FP>& operator*() const noexcept { return m_total; }
+  const summary<FP>* operator->() const noexcept { return &m_total; }
+
+  void reset() noexcept { m_total = {}; }
+
+private:
+  summary<FP> m_total;
+};
+}
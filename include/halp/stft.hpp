@@ -0,0 +1,267 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/common/span_polyfill.hpp>
+#include <avnd/concepts/fft.hpp>
+#include <halp/fft.hpp>
+#include <halp/shared_resource.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace halp
+{
+enum class stft_window
+{
+  rectangular,
+  hann,
+  hamming,
+  blackman
+};
+
+/**
+ * Short-time Fourier transform with overlap-add resynthesis, for spectral processors:
+ *
+ * halp::stft<double> stft;
+ *
+ * void prepare(halp::setup info) { stft.reset(info.input_channels, 2048, 512); }
+ * int64_t latency_samples() const noexcept { return stft.latency(); }
+ *
+ * void operator()(int frames) {
+ *   stft.process(inputs.audio, outputs.audio, frames,
+ *                [&](int channel, avnd::span<std::complex<double>> bins) { ... });
+ * }
+ *
+ * The callback gets the size / 2 + 1 bins of each frame, which it can modify,
+ * once every hop frames whatever the size of the buffers: the input is queued until
+ * a frame is complete. The output is delayed by latency() frames, size - 1:
+ * with a callback which does nothing, it is the input delayed, as long as the
+ * window overlap-adds to a constant with that hop, e.g. hann for hops up to size / 4.
+ *
+ * The frames are windowed at the analysis and at the synthesis.
+ * The FFT can be one provided by the host: its inverse must read the bins [0; size / 2]
+ * of a conjugate-symmetric spectrum as halp::fft does.
+ *
+ * reset() allocates, process() and analyze() do not. The windows are shared by
+ * the instances with the same size, hop and window (see halp::shared_resource).
+ */
+template <typename FP, typename FFT = halp::fft<FP>>
+  requires avnd::fft_1d<FP, FFT>
+class stft
+{
+public:
+  using complex_type = typename FFT::complex_type;
+
+  // size must be a power of two, hop is rounded down to one
+  void reset(int channels, int size, int hop, stft_window window = stft_window::hann)
+  {
+    m_size = std::max(size, 2);
+    m_hop = 1;
+    while (m_hop * 2 <= std::clamp(hop, 1, m_size))
+      m_hop *= 2;
+    m_channels = std::max(channels, 0);
+    m_frames = 0;
+
+    m_fft.reset(m_size);
+    m_scratch.assign(m_size, FP(0));
+    m_input.assign(m_channels, std::vector<FP>(m_size, FP(0)));
+    m_output.assign(m_channels, std::vector<FP>(2 * std::size_t(m_size), FP(0)));
+
+    // The windows only depend on these: the instances with the same ones share them
+    m_windows = halp::shared_resource<windows>(
+        m_size, m_hop, window, double(m_fft.normalization(m_size)));
+  }
+
+  int size() const noexcept { return m_size; }
+  int hop() const noexcept { return m_hop; }
+  int bins() const noexcept { return m_size / 2 + 1; }
+  int64_t latency() const noexcept { return m_size - 1; }
+
+  // Clears the queued frames, e.g. when the playback restarts
+  void clear() noexcept
+  {
+    for (auto& v : m_input)
+      std::fill(v.begin(), v.end(), FP(0));
+    for (auto& v : m_output)
+      std::fill(v.begin(), v.end(), FP(0));
+    m_frames = 0;
+  }
+
+  // f(int channel, avnd::span<complex_type> bins) modifies the frames. In-place is fine.
+  template <typename F>
+  void
+  process(const FP* const* in, FP* const* out, int channels, int frames, F&& f) noexcept
+  {
+    run<true>(in, out, std::min(channels, m_channels), frames, f);
+  }
+
+  template <typename InBus, typename OutBus, typename F>
+    requires requires(InBus& i, OutBus& o) {
+      i.samples;
+      o.samples;
+    }
+  void process(const InBus& in, OutBus& out, int frames, F&& f) noexcept
+  {
+    process(
+        in.samples, out.samples, std::min(bus_channels(in), bus_channels(out)), frames, f);
+  }
+
+  // For analyzers: f(int channel, avnd::span<complex_type> bins) gets the frames
+  template <typename F>
+  void analyze(const FP* const* in, int channels, int frames, F&& f) noexcept
+  {
+    run<false>(in, nullptr, std::min(channels, m_channels), frames, f);
+  }
+
+private:
+  template <typename Bus>
+  static int bus_channels(const Bus& bus) noexcept
+  {
+    if constexpr (requires { bus.channels(); })
+      return bus.channels();
+    else
+      return bus.channels;
+  }
+
+  // Calls f(ring index, offset, count) on the contiguous parts of [pos; pos + n[
+  // in a ring of size N
+  template <typename F>
+  static void ring(int pos, int n, int N, F&& f) noexcept
+  {
+    const int first = std::min(n, N - pos);
+    f(pos, 0, first);
+    if (first < n)
+      f(0, first, n - first);
+  }
+
+  template <bool Synthesis, typename F>
+  void run(const FP* const* in, FP* const* out, int channels, int frames, F& f) noexcept
+  {
+    const int N = m_size;
+    const int H = m_hop;
+
+    // Chunks end where a frame does
+    for (int offset = 0; offset < frames;)
+    {
+      const int pos = int(m_frames % N);
+      const int len = std::min(frames - offset, H - int(m_frames % H));
+      const bool frame_end = (m_frames + len) % H == 0;
+
+      for (int c = 0; c < channels; c++)
+      {
+        FP* __restrict input = m_input[c].data();
+        const FP* src = in[c] + offset;
+        ring(pos, len, N, [&](int dst, int s, int n) { std::copy_n(src + s, n, input + dst); });
+
+        // The frame ends at m_frames + len - 1 and starts N - 1 frames before
+        if (frame_end)
+          frame<Synthesis>(
+              c, int((m_frames + len) % N), int((m_frames + len + N) % (2 * N)), f);
+
+        if constexpr (Synthesis)
+        {
+          // The output lags N - 1 frames behind, where all the frames overlapping are done
+          FP* __restrict acc = m_output[c].data();
+          FP* dst = out[c] + offset;
+          ring(int((m_frames + N + 1) % (2 * N)), len, 2 * N, [&](int src, int d, int n) {
+            std::copy_n(acc + src, n, dst + d);
+            std::fill_n(acc + src, n, FP(0));
+          });
+        }
+      }
+
+      offset += len;
+      m_frames += len;
+    }
+  }
+
+  struct windows
+  {
+    windows(int size, int hop, stft_window window, double normalization)
+        : analysis(size)
+        , synthesis(size)
+    {
+      static constexpr double pi = 3.141592653589793238462643383279502884;
+      double power = 0.;
+      for (int i = 0; i < size; i++)
+      {
+        // Periodic windows, which overlap-add to a constant
+        const double x = 2. * pi * i / size;
+        double w = 1.;
+        switch (window)
+        {
+          case stft_window::rectangular:
+            break;
+          case stft_window::hann:
+            w = 0.5 - 0.5 * std::cos(x);
+            break;
+          case stft_window::hamming:
+            w = 0.54 - 0.46 * std::cos(x);
+            break;
+          case stft_window::blackman:
+            w = 0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2. * x);
+            break;
+        }
+        analysis[i] = FP(w);
+        power += w * w;
+      }
+
+      // The overlapping frames sum to power / hop
+      const double gain = normalization * hop / power;
+      for (int i = 0; i < size; i++)
+        synthesis[i] = FP(analysis[i] * gain);
+    }
+
+    std::vector<FP> analysis, synthesis;
+  };
+
+  // Where the oldest sample of the frame is in the input ring, and in the output ring
+  template <bool Synthesis, typename F>
+  void frame(int c, int start, int output, F& f) noexcept
+  {
+    const int N = m_size;
+    FP* __restrict x = m_scratch.data();
+
+    {
+      const FP* __restrict input = m_input[c].data();
+      const FP* __restrict w = m_windows->analysis.data();
+      ring(start, N, N, [&](int src, int dst, int n) {
+        for (int i = 0; i < n; i++)
+          x[dst + i] = input[src + i] * w[dst + i];
+      });
+    }
+
+    auto spectrum = m_fft.execute(x, std::size_t(N));
+    f(c, avnd::span<complex_type>(spectrum, std::size_t(N / 2 + 1)));
+
+    if constexpr (Synthesis)
+    {
+      const FP* __restrict y = m_fft.execute(spectrum, std::size_t(N));
+      const FP* __restrict w = m_windows->synthesis.data();
+      FP* __restrict acc = m_output[c].data();
+      ring(output, N, 2 * N, [&](int dst, int src, int n) {
+        for (int i = 0; i < n; i++)
+          acc[dst + i] += y[src + i] * w[src + i];
+      });
+    }
+  }
+
+  FFT m_fft;
+  int m_size{2};
+  int m_hop{1};
+  int m_channels{};
+  int64_t m_frames{};
+
+  std::shared_ptr<const windows> m_windows;
+  std::vector<FP> m_scratch;
+
+  // Rings indexed by the time, modulo N for the input and 2 N for the output:
+  // the latest frame is added while the end of the previous ones is read
+  std::vector<std::vector<FP>> m_input;
+  std::vector<std::vector<FP>> m_output;
+};
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <memory>
+#include <type_traits>
+
+namespace halp
+{
+/**
+ * Lets a processor split its work in tasks, e.g. one per voice or per channel,
+ * which the binding runs on worker threads when it has some:
+ *
+ * halp::task_runner tasks;
+ *
+ * void operator()(int frames) {
+ *   tasks(voices.size(), [&](int v) { voices[v].render(frames); });
+ * }
+ *
+ * The call returns once all the tasks are done. The tasks run one after the other
+ * on the calling thread when no worker threads are available.
+ * It must only be called from the audio thread.
+ */
+struct task_runner
+{
+  // Set by the binding
+  bool (*request)(void* pool, int tasks, void (*job)(void*, int), void* context) noexcept
+      = nullptr;
+  void* pool{};
+
+  template <typename F>
+  void operator()(int tasks, F&& f) const
+  {
+    if (tasks <= 0)
+      return;
+
+    if (tasks > 1 && request
+        && request(
+            pool,
+            tasks,
+            +[](void* ctx, int t) { (*static_cast<std::remove_reference_t<F>*>(ctx))(t); },
+            (void*)std::addressof(f)))
+      return;
+
+    for (int t = 0; t < tasks; t++)
+      f(t);
+  }
+};
+}
@@ -2,30 +2,145 @@
 
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 
+#include <avnd/common/span_polyfill.hpp>
+#include <avnd/common/texture_access.hpp>
+#include <halp/callback.hpp>
 #include <halp/controls.hpp>
 #include <halp/polyfill.hpp>
 #include <halp/static_string.hpp>
 #include <boost/container/vector.hpp>
 
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
 namespace halp
 {
 using uninitialized_bytes = boost::container::vector<unsigned char>;
+
+struct rgba_color
+{
+  uint8_t r, g, b, a;
+};
+
+// IEEE 754 half-precision float, kept as its bits as the GPU expects them
+struct half
+{
+  uint16_t bits;
+
+  static constexpr half from_float(float f) noexcept
+  {
+    const uint32_t x = std::bit_cast<uint32_t>(f);
+    const uint16_t sign = (x >> 16) & 0x8000;
+    const int32_t exp = int32_t((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mant = x & 0x7fffff;
+
+    if (((x >> 23) & 0xff) == 0xff) // inf / nan
+      return {uint16_t(sign | 0x7c00 | (mant ? 0x200 : 0))};
+    if (exp >= 31) // overflow
+      return {uint16_t(sign | 0x7c00)};
+    if (exp <= 0) // subnormal or zero
+    {
+      if (exp < -10)
+        return {sign};
+      mant |= 0x800000;
+      const int shift = 14 - exp;
+      uint32_t res = mant >> shift;
+      const uint32_t rest = mant & ((1u << shift) - 1);
+      const uint32_t halfway = 1u << (shift - 1);
+      if (rest > halfway || (rest == halfway && (res & 1)))
+        res++;
+      return {uint16_t(sign | res)};
+    }
+
+    // Round to nearest even, which may carry into the exponent
+    uint32_t res = (uint32_t(exp) << 10) | (mant >> 13);
+    const uint32_t rest = mant & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (res & 1)))
+      res++;
+    return {uint16_t(sign | res)};
+  }
+
+  constexpr float to_float() const noexcept
+  {
+    const uint32_t sign = uint32_t(bits & 0x8000) << 16;
+    const uint32_t exp = (bits >> 10) & 0x1f;
+    uint32_t mant = bits & 0x3ff;
+
+    if (exp == 0x1f)
+      return std::bit_cast<float>(sign | 0x7f800000 | (mant << 13));
+    if (exp == 0)
+    {
+      if (mant == 0)
+        return std::bit_cast<float>(sign);
+      // Subnormal: normalize it
+      int e = -1;
+      do
+      {
+        e++;
+        mant <<= 1;
+      } while ((mant & 0x400) == 0);
+      return std::bit_cast<float>(
+          sign | (uint32_t(127 - 15 - e) << 23) | ((mant & 0x3ff) << 13));
+    }
+    return std::bit_cast<float>(sign | ((exp + 127 - 15) << 23) | (mant << 13));
+  }
+};
+
+struct rg16f_color
+{
+  half r, g;
+};
+
+struct rgba32f_color
+{
+  float r, g, b, a;
+};
+
+/**
+ * The pixels of a texture, row by row: rows may be padded, e.g. when they come
+ * from a GPU readback, thus they are stride bytes apart.
+ */
+template <typename Pixel>
+struct texture_view
+{
+  unsigned char* bytes{};
+  int width{};
+  int height{};
+  std::ptrdiff_t stride{};
+
+  avnd::span<Pixel> row(int y) const noexcept
+  {
+    return {reinterpret_cast<Pixel*>(bytes + y * stride), std::size_t(width)};
+  }
+
+  Pixel& operator()(int x, int y) const noexcept { return row(y)[x]; }
+};
+
 struct rgba_texture
 {
   enum format
   {
     RGBA
   };
+  using pixel_type = rgba_color;
+  static constexpr int bytes_per_pixel = 4;
+
   unsigned char* bytes;
   int width;
   int height;
   bool changed;
 
-  /* FIXME the allocation should not be managed by the plug-in */
+  // Opaque texture of a GPU host, e.g. when the pixels were not read back
+  void* handle{};
+
+  // For the processors which keep their own pixels, see texture_output
+  // otherwise, whose memory can come from the host
   static auto allocate(int width, int height)
   {
     using namespace boost::container;
-    return uninitialized_bytes(width * height * 4, default_init);
+    return uninitialized_bytes(width * height * bytes_per_pixel, default_init);
   }
 
   void update(unsigned char* data, int w, int h) noexcept
@@ -35,36 +150,135 @@ struct rgba_texture
     height = h;
     changed = true;
   }
+
+  texture_view<pixel_type> view() const noexcept
+  {
+    return {bytes, width, height, std::ptrdiff_t(width) * bytes_per_pixel};
+  }
 };
 
-struct rgba_color
+// Textures of the other formats, which the host uploads as they are
+template <typename Pixel>
+struct basic_texture
 {
-  uint8_t r, g, b, a;
+  using pixel_type = Pixel;
+  static constexpr int bytes_per_pixel = sizeof(Pixel);
+
+  unsigned char* bytes;
+  int width;
+  int height;
+  bool changed;
+
+  // Opaque texture of a GPU host, e.g. when the pixels were not read back
+  void* handle{};
+
+  static auto allocate(int width, int height)
+  {
+    using namespace boost::container;
+    return uninitialized_bytes(width * height * bytes_per_pixel, default_init);
+  }
+
+  void update(unsigned char* data, int w, int h) noexcept
+  {
+    bytes = data;
+    width = w;
+    height = h;
+    changed = true;
+  }
+
+  texture_view<pixel_type> view() const noexcept
+  {
+    return {bytes, width, height, std::ptrdiff_t(width) * bytes_per_pixel};
+  }
+};
+
+// e.g. masks, depth or feature maps
+struct r8_texture : basic_texture<uint8_t>
+{
+  enum format
+  {
+    R8
+  };
 };
 
-template <static_string lit>
+// e.g. motion vectors
+struct rg16f_texture : basic_texture<rg16f_color>
+{
+  enum format
+  {
+    RG16F
+  };
+};
+
+// e.g. HDR images
+struct rgba32f_texture : basic_texture<rgba32f_color>
+{
+  enum format
+  {
+    RGBA32F
+  };
+};
+
+/**
+ * Memory for the texture outputs, provided by the host e.g. from a pool of its
+ * GPU upload memory: the pixels written by the processor are then uploaded
+ * from there without being copied first.
+ * allocate(width, height, bytes per pixel) returns the memory of the pixels, or null.
+ * The memory stays owned by the host, which may free it once the processor is gone.
+ */
+struct texture_allocator
+{
+  basic_callback<unsigned char*(int, int, int)> allocate{};
+  basic_callback<void(unsigned char*)> release{};
+};
+
+/**
+ * With a GPU host, the texture may only be on the GPU: Access tells when
+ * its pixels are needed on the CPU, see avnd::texture_access.
+ * Until they are read back, texture.bytes is null.
+ */
+template <
+    static_string lit, typename Texture = rgba_texture,
+    avnd::texture_access Access = avnd::texture_access::pixels>
 struct texture_input
 {
+  using pixel_type = typename Texture::pixel_type;
   static clang_buggy_consteval auto name() { return std::string_view{lit.value}; }
+  static clang_buggy_consteval auto texture_access() { return Access; }
 
-  rgba_color get(int x, int y) noexcept
+  bool has_pixels() const noexcept { return texture.bytes != nullptr; }
+
+  // With on_demand access: the pixels come with one of the next frames
+  void request_pixels() noexcept { pixels_requested = true; }
+
+  pixel_type get(int x, int y) const noexcept
   {
     assert(x >= 0 && x < texture.width);
     assert(y >= 0 && y < texture.height);
 
-    const int pixel_index = y * texture.width + x;
-    const int byte_index = pixel_index * 4;
+    pixel_type res;
+    std::memcpy(
+        &res, texture.bytes + (std::size_t(y) * texture.width + x) * sizeof(pixel_type),
+        sizeof(pixel_type));
+    return res;
+  }
 
-    auto* pixel_ptr = texture.bytes + byte_index;
-    return {.r = pixel_ptr[0], .g = pixel_ptr[1], .b = pixel_ptr[2], .a = pixel_ptr[3]};
+  // Iterate on view().row(y) rather than calling get() for each pixel
+  texture_view<const pixel_type> view() const noexcept
+  {
+    return {
+        texture.bytes, texture.width, texture.height,
+        std::ptrdiff_t(texture.width) * Texture::bytes_per_pixel};
   }
 
-  rgba_texture texture;
+  Texture texture;
+  bool pixels_requested{};
 };
 
-template <static_string lit>
+template <static_string lit, typename Texture = rgba_texture>
 struct texture_output
 {
+  using pixel_type = typename Texture::pixel_type;
   static clang_buggy_consteval auto name() { return std::string_view{lit.value}; }
 
   constexpr texture_output() noexcept
@@ -77,48 +291,79 @@ struct texture_output
 
   void create(int width, int height)
   {
-    storage = rgba_texture::allocate(width, height);
+    release();
+
+    if (allocator.allocate)
+      texture.bytes = allocator.allocate(int(width), int(height), int(Texture::bytes_per_pixel));
+    if (!texture.bytes)
+    {
+      storage = Texture::allocate(width, height);
+      texture.bytes = storage.data();
+    }
+
     texture.width = width;
     texture.height = height;
     texture.changed = false;
-    texture.bytes = storage.data();
   }
 
   void upload() noexcept { texture.changed = true; }
 
-  void set(int x, int y, int r, int g, int b, int a = 255) noexcept
+  /**
+   * Outputs the texture of an input as it is: a GPU host passes it on without
+   * reading it back nor uploading it again, when it was on the GPU.
+   * create() must be called again before writing pixels.
+   */
+  template <typename Input>
+  void forward(const Input& in) noexcept
   {
-    assert(x >= 0 && x < texture.width);
-    assert(y >= 0 && y < texture.height);
-
-    const int pixel_index = y * texture.width + x;
-    const int byte_index = pixel_index * 4;
+    release();
+    texture.bytes = in.texture.bytes;
+    texture.handle = in.texture.handle;
+    texture.width = in.texture.width;
+    texture.height = in.texture.height;
+    texture.changed = true;
+    forwarded = true;
+  }
 
-    auto* pixel_ptr = storage.data() + byte_index;
-    pixel_ptr[0] = r;
-    pixel_ptr[1] = g;
-    pixel_ptr[2] = b;
-    pixel_ptr[3] = a;
+  void set(int x, int y, int r, int g, int b, int a = 255) noexcept
+    requires std::is_same_v<pixel_type, rgba_color>
+  {
+    set(x, y, rgba_color{uint8_t(r), uint8_t(g), uint8_t(b), uint8_t(a)});
   }
 
-  void set(int x, int y, rgba_color col) noexcept
+  void set(int x, int y, pixel_type col) noexcept
   {
     assert(x >= 0 && x < texture.width);
     assert(y >= 0 && y < texture.height);
 
-    const int pixel_index = y * texture.width + x;
-    const int byte_index = pixel_index * 4;
-
-    auto* pixel_ptr = storage.data() + byte_index;
-    pixel_ptr[0] = col.r;
-    pixel_ptr[1] = col.g;
-    pixel_ptr[2] = col.b;
-    pixel_ptr[3] = col.a;
+    std::memcpy(
+        texture.bytes + (std::size_t(y) * texture.width + x) * sizeof(pixel_type), &col,
+        sizeof(pixel_type));
   }
 
-  rgba_texture texture;
+  // Write the rows through view().row(y) rather than calling set() for each pixel
+  texture_view<pixel_type> view() const noexcept { return texture.view(); }
 
+  Texture texture;
+
+  // Set by the host before the processor runs; when it is not, or when it runs
+  // out of memory, the pixels are kept in storage.
+  texture_allocator allocator;
   uninitialized_bytes storage;
+
+  // The texture is the one of an input, see forward()
+  bool forwarded{};
+
+private:
+  void release() noexcept
+  {
+    if (texture.bytes && !forwarded && texture.bytes != storage.data() && allocator.release)
+      allocator.release(static_cast<unsigned char*>(texture.bytes));
+    texture.bytes = nullptr;
+    texture.handle = nullptr;
+    forwarded = false;
+    storage.clear();
+  }
 };
 
 }
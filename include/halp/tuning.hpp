@@ -0,0 +1,165 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace halp
+{
+/**
+ * The frequency of each MIDI note in a tuning: equal temperament by default,
+ * or any scale, e.g. loaded from a Scala file.
+ *
+ * The frequencies are computed once, with a step of 1/subdivisions of a note,
+ * so that the voices look up fractional notes (pitch bends, MPE tuning)
+ * with a linear interpolation instead of calling exp2. Building the table
+ * computes these powers and may read a file: it is done outside of the audio thread,
+ * and shared by all the instances which use the same tuning:
+ *
+ * std::shared_ptr<const halp::tuning_table> tuning;
+ * void prepare(halp::setup) { tuning = halp::shared_resource<halp::tuning_table>(440.); }
+ * ...
+ * osc.set_frequency(tuning->frequency(note + bend), rate);
+ *
+ * A processor changes its tuning from its worker, which builds the new table
+ * and gives back the previous one to free it outside of the audio thread.
+ */
+class tuning_table
+{
+public:
+  static constexpr int notes = 128;
+  static constexpr int subdivisions = 32;
+
+  // Twelve-tone equal temperament
+  explicit tuning_table(double a4 = 440.)
+      : tuning_table{std::vector<double>{}, 69, a4}
+  {
+  }
+
+  // A scale given by the cents of each degree after the first: the last one is
+  // its period, e.g. 1200 for an octave. reference_note plays the first degree
+  // at reference_frequency, and the next notes play the next degrees.
+  // An empty scale is twelve-tone equal temperament.
+  tuning_table(std::vector<double> cents, int reference_note, double reference_frequency)
+  {
+    if (cents.empty() || cents.back() <= 0.)
+      cents = {100., 200., 300., 400., 500., 600., 700., 800., 900., 1000., 1100., 1200.};
+
+    const int degrees = int(cents.size());
+    const double period = cents.back();
+    auto note_frequency = [&](int note) {
+      const int k = note - reference_note;
+      const int octave = k >= 0 ? k / degrees : -((-k + degrees - 1) / degrees);
+      const int degree = k - octave * degrees;
+      const double c = octave * period + (degree == 0 ? 0. : cents[degree - 1]);
+      return reference_frequency * std::exp2(c / 1200.);
+    };
+
+    for (int n = 0; n < notes - 1; n++)
+    {
+      const double f0 = note_frequency(n);
+      const double ratio = note_frequency(n + 1) / f0;
+      for (int s = 0; s < subdivisions; s++)
+        m_table[n * subdivisions + s] = f0 * std::pow(ratio, double(s) / subdivisions);
+    }
+    m_table[(notes - 1) * subdivisions] = note_frequency(notes - 1);
+  }
+
+  // A Scala (.scl) file, see scala_cents
+  tuning_table(const std::string& scala_file, int reference_note, double reference_frequency)
+      : tuning_table{read_scala(scala_file), reference_note, reference_frequency}
+  {
+  }
+
+  double frequency(int note) const noexcept
+  {
+    return m_table[std::clamp(note, 0, notes - 1) * subdivisions];
+  }
+
+  // Fractional notes are interpolated
+  double frequency(double note) const noexcept
+  {
+    const double pos = std::clamp(note, 0., double(notes - 1)) * subdivisions;
+    const int i = std::min(int(pos), (notes - 1) * subdivisions - 1);
+    const double frac = pos - i;
+    return m_table[i] + frac * (m_table[i + 1] - m_table[i]);
+  }
+
+  // The degrees of a scale in the Scala format, in cents: the lines starting with '!'
+  // are comments, then come a description, the number of degrees, and each of them,
+  // in cents if it has a dot, else as a ratio such as 3/2 or 2.
+  // Returns nothing if the scale is not valid.
+  static std::vector<double> scala_cents(std::string_view text)
+  {
+    std::vector<double> cents;
+    int count = -1;
+    bool description = true;
+
+    std::istringstream lines{std::string{text}};
+    for (std::string line; std::getline(lines, line);)
+    {
+      if (!line.empty() && line[0] == '!')
+        continue;
+      if (description)
+      {
+        description = false;
+        continue;
+      }
+
+      std::istringstream words{line};
+      std::string word;
+      if (!(words >> word))
+        continue;
+
+      if (count < 0)
+      {
+        count = std::atoi(word.c_str());
+        if (count <= 0)
+          return {};
+        continue;
+      }
+
+      if (word.find('.') != std::string::npos)
+      {
+        cents.push_back(std::atof(word.c_str()));
+      }
+      else
+      {
+        const auto slash = word.find('/');
+        const double num = std::atof(word.substr(0, slash).c_str());
+        const double den = slash == std::string::npos
+                               ? 1.
+                               : std::atof(word.substr(slash + 1).c_str());
+        if (num <= 0. || den <= 0.)
+          return {};
+        cents.push_back(1200. * std::log2(num / den));
+      }
+
+      if (int(cents.size()) == count)
+        return cents;
+    }
+    return {};
+  }
+
+  static std::vector<double> read_scala(const std::string& file)
+  {
+    std::ifstream f{file};
+    if (!f)
+      return {};
+    std::stringstream text;
+    text << f.rdbuf();
+    return scala_cents(text.str());
+  }
+
+private:
+  std::array<double, (notes - 1) * subdivisions + 1> m_table{};
+};
+}
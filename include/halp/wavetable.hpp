@@ -0,0 +1,207 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <halp/fft.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+namespace halp
+{
+enum class waveform
+{
+  sine,
+  triangle,
+  saw,
+  square
+};
+
+/**
+ * Band-limited tables of one period of a waveform, one per octave:
+ * level l has the harmonics up to max_harmonics >> l, thus playing it below
+ * rate / (2 * (max_harmonics >> l)) does not alias.
+ *
+ * Computing them takes a while: shared() gives tables computed once
+ * for the whole process, which can then be read from any thread.
+ */
+template <typename FP>
+class wavetable
+{
+public:
+  // Samples per period, each table has one more for the interpolation
+  static constexpr int size = 2048;
+  static constexpr int max_harmonics = size / 4;
+  static constexpr int levels = 10;
+  static constexpr int stride = size + 1;
+
+  // harmonic(k) is the amplitude of sin(k * phase), for k >= 1
+  template <typename F>
+  explicit wavetable(F&& harmonic)
+      : m_data(std::size_t(levels) * stride)
+  {
+    halp::fft<double> fft;
+    std::vector<std::complex<double>> spectrum(size + 1);
+    for (int l = 0; l < levels; l++)
+    {
+      const int harmonics = std::max(max_harmonics >> l, 1);
+      std::fill(spectrum.begin(), spectrum.end(), std::complex<double>{});
+      for (int k = 1; k <= harmonics; k++)
+        spectrum[k] = {0., -0.5 * double(harmonic(k))};
+
+      const double* x = fft.execute(spectrum.data(), size);
+      FP* table = m_data.data() + std::size_t(l) * stride;
+      for (int i = 0; i < size; i++)
+        table[i] = FP(x[i]);
+      table[size] = table[0];
+    }
+  }
+
+  static const wavetable& shared(waveform w)
+  {
+    static constexpr double pi = 3.141592653589793238462643383279502884;
+    switch (w)
+    {
+      default:
+      case waveform::sine:
+      {
+        static const wavetable t{[](int k) { return k == 1 ? 1. : 0.; }};
+        return t;
+      }
+      case waveform::triangle:
+      {
+        static const wavetable t{[](int k) {
+          return k % 2 == 0 ? 0. : ((k / 2) % 2 ? -8. : 8.) / (pi * pi * k * k);
+        }};
+        return t;
+      }
+      case waveform::saw:
+      {
+        static const wavetable t{[](int k) { return (k % 2 ? 2. : -2.) / (pi * k); }};
+        return t;
+      }
+      case waveform::square:
+      {
+        static const wavetable t{[](int k) { return k % 2 == 0 ? 0. : 4. / (pi * k); }};
+        return t;
+      }
+    }
+  }
+
+  // Where the table without aliasing for this frequency starts in data()
+  static int offset(double frequency, double rate) noexcept
+  {
+    const double harmonics = 0.5 * rate / std::max(frequency, 1e-9);
+    int l = 0;
+    while (l < levels - 1 && (max_harmonics >> l) > harmonics)
+      l++;
+    return l * stride;
+  }
+
+  const FP* data() const noexcept { return m_data.data(); }
+
+private:
+  std::vector<FP> m_data;
+};
+
+/**
+ * Oscillators reading a shared wavetable, e.g. one per voice of a synthesizer.
+ * The phases, increments, amplitudes and tables are stored as arrays
+ * across the oscillators.
+ *
+ * Amplitude changes are ramped over the next render call.
+ * resize() allocates, the rest does not.
+ */
+template <typename FP>
+class oscillator_bank
+{
+public:
+  explicit oscillator_bank(const wavetable<FP>& table = wavetable<FP>::shared(waveform::sine))
+      : m_table{&table}
+  {
+  }
+
+  void resize(int oscillators)
+  {
+    const std::size_t n = std::max(oscillators, 0);
+    m_phase.assign(n, FP(0));
+    m_increment.assign(n, FP(0));
+    m_amplitude.assign(n, FP(0));
+    m_target.assign(n, FP(0));
+    m_offset.assign(n, 0);
+  }
+
+  int size() const noexcept { return int(m_phase.size()); }
+
+  // The oscillators go on where they are in their period
+  void set_table(const wavetable<FP>& table) noexcept { m_table = &table; }
+
+  // Also picks the table with as many harmonics as the frequency allows
+  void set_frequency(int i, double frequency, double rate) noexcept
+  {
+    if (rate <= 0.)
+      return;
+    frequency = std::clamp(frequency, 0., 0.5 * rate);
+    m_increment[i] = FP(frequency / rate);
+    m_offset[i] = wavetable<FP>::offset(frequency, rate);
+  }
+
+  void set_amplitude(int i, FP amplitude) noexcept { m_target[i] = amplitude; }
+
+  // From 0 to 1, e.g. 0 on a note-on to get the same attack for every note
+  void set_phase(int i, FP phase) noexcept { m_phase[i] = phase - std::floor(phase); }
+
+  // Adds the oscillators to out
+  void render(FP* out, int frames) noexcept
+  {
+    for (int i = 0; i < size(); i++)
+      render(i, out, frames);
+  }
+
+  // Adds oscillator i to out
+  void render(int i, FP* __restrict out, int frames) noexcept
+  {
+    if (frames <= 0)
+      return;
+
+    const FP* __restrict table = m_table->data() + m_offset[i];
+    const FP p = m_phase[i];
+    const FP inc = m_increment[i];
+    const FP a = m_amplitude[i];
+    const FP da = (m_target[i] - a) / FP(frames);
+    if (a == FP(0) && da == FP(0))
+    {
+      m_phase[i] = wrap(p + FP(frames) * inc);
+      return;
+    }
+
+    // Each phase is computed from the one at the start of the buffer,
+    // so that the frames do not depend on each other and the loop vectorizes
+    for (int j = 0; j < frames; j++)
+    {
+      const FP pos = wrap(p + FP(j) * inc) * FP(wavetable<FP>::size);
+      const int k = int(pos);
+      const FP frac = pos - FP(k);
+      const FP s = table[k] + frac * (table[k + 1] - table[k]);
+      out[j] += (a + FP(j) * da) * s;
+    }
+
+    m_phase[i] = wrap(p + FP(frames) * inc);
+    m_amplitude[i] = m_target[i];
+  }
+
+private:
+  // The phases are positive: truncating is enough to get the fractional part
+  static FP wrap(FP phase) noexcept { return phase - FP(int(phase)); }
+
+  const wavetable<FP>* m_table{};
+  std::vector<FP> m_phase;
+  std::vector<FP> m_increment;
+  std::vector<FP> m_amplitude;
+  std::vector<FP> m_target;
+  std::vector<int> m_offset;
+};
+}
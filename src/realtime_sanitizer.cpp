@@ -0,0 +1,551 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+// The checks of avnd/wrappers/realtime_sanitizer.hpp: linked in the binaries of the
+// bindings when built with AVENDISH_RT_SANITIZE.
+//
+// The functions which may block are interposed: these definitions are internal to the
+// binary, which is linked with -Bsymbolic, so the calls from its own code come here
+// and the ones of the host do not. Each one checks whether the calling thread is
+// in a realtime_scope, then forwards to the next definition, e.g. of the libc.
+//
+// Only on Linux for now; elsewhere the scopes are counted but nothing is checked.
+
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+
+#if AVND_RT_SANITIZE
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__)
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/select.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+std::atomic<int> g_mode{avnd_rt_sanitizer_log};
+std::atomic<uint64_t> g_violations{0};
+
+// While reporting, the calls of the report itself are not checked
+thread_local int t_reporting AVND_RT_TLS = 0;
+
+bool checked() noexcept
+{
+  return avnd::rt::realtime_depth > 0 && avnd::rt::exempt_depth == 0 && t_reporting == 0;
+}
+
+// The call sites already reported, by return address, in an open-addressed table
+constexpr int max_sites = 1024;
+std::atomic<uintptr_t> g_sites[max_sites]{};
+
+bool first_report(uintptr_t site) noexcept
+{
+  for (int i = 0, h = int((site >> 4) % max_sites); i < max_sites; i++, h = (h + 1) % max_sites)
+  {
+    uintptr_t cur = g_sites[h].load(std::memory_order_relaxed);
+    if (cur == 0 && g_sites[h].compare_exchange_strong(cur, site, std::memory_order_relaxed))
+      return true;
+    if (cur == site)
+      return false;
+  }
+  // Full: only the sites already known are reported
+  return false;
+}
+
+#if defined(__linux__)
+void report(const char* what, void* caller) noexcept
+{
+  const int mode = g_mode.load(std::memory_order_relaxed);
+  if (mode == avnd_rt_sanitizer_off)
+    return;
+
+  t_reporting++;
+  g_violations.fetch_add(1, std::memory_order_relaxed);
+  if (first_report(reinterpret_cast<uintptr_t>(caller)) || mode == avnd_rt_sanitizer_abort)
+  {
+    // Neither allocates: the buffers are on the stack and the trace goes to the descriptor
+    char msg[128];
+    const int n = std::snprintf(msg, sizeof(msg), "avnd: %s in a realtime scope\n", what);
+    if (n > 0)
+      (void)!::write(STDERR_FILENO, msg, std::size_t(std::min(n, int(sizeof(msg) - 1))));
+
+    void* frames[64];
+    const int depth = ::backtrace(frames, 64);
+    if (depth > 1)
+      ::backtrace_symbols_fd(frames + 1, depth - 1, STDERR_FILENO);
+  }
+  if (mode == avnd_rt_sanitizer_abort)
+    std::abort();
+  t_reporting--;
+}
+
+#define AVND_RT_CHECK(what)                    \
+  do                                           \
+  {                                            \
+    if (checked()) [[unlikely]]                \
+      report(what, __builtin_return_address(0)); \
+  } while (0)
+
+// The next definition of a function, e.g. the one of the libc, looked up once
+template <typename F>
+struct next_symbol
+{
+  const char* name;
+  std::atomic<F*> fn{};
+
+  F* get() noexcept
+  {
+    F* f = fn.load(std::memory_order_acquire);
+    if (!f)
+    {
+      f = reinterpret_cast<F*>(::dlsym(RTLD_NEXT, name));
+      fn.store(f, std::memory_order_release);
+    }
+    return f;
+  }
+};
+
+// The attributes of the libc declarations, e.g. nothrow, do not matter for the pointers
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+#define AVND_RT_NEXT(func) constinit next_symbol<decltype(::func)> next_##func{#func}
+
+// dlsym may allocate while malloc is being looked up: these allocations are served
+// from a static buffer, and never freed
+alignas(std::max_align_t) char g_bootstrap[8192];
+std::atomic<std::size_t> g_bootstrap_used{0};
+thread_local int t_resolving AVND_RT_TLS = 0;
+
+void* bootstrap_alloc(std::size_t n) noexcept
+{
+  n = (n + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+  const std::size_t offset = g_bootstrap_used.fetch_add(n, std::memory_order_relaxed);
+  return offset + n <= sizeof(g_bootstrap) ? g_bootstrap + offset : nullptr;
+}
+
+bool is_bootstrap(const void* p) noexcept
+{
+  auto* c = static_cast<const char*>(p);
+  return c >= g_bootstrap && c < g_bootstrap + sizeof(g_bootstrap);
+}
+
+AVND_RT_NEXT(malloc);
+AVND_RT_NEXT(calloc);
+AVND_RT_NEXT(realloc);
+AVND_RT_NEXT(free);
+AVND_RT_NEXT(aligned_alloc);
+AVND_RT_NEXT(posix_memalign);
+
+void* raw_malloc(std::size_t n) noexcept
+{
+  if (!next_malloc.fn.load(std::memory_order_acquire))
+  {
+    if (t_resolving)
+      return bootstrap_alloc(n);
+    t_resolving++;
+    next_malloc.get();
+    t_resolving--;
+  }
+  return next_malloc.get()(n);
+}
+
+void* raw_calloc(std::size_t n, std::size_t sz) noexcept
+{
+  if (!next_calloc.fn.load(std::memory_order_acquire))
+  {
+    // The bootstrap buffer is zero-initialized and never reused
+    if (t_resolving)
+      return n == 0 || sz <= sizeof(g_bootstrap) / n ? bootstrap_alloc(n * sz) : nullptr;
+    t_resolving++;
+    next_calloc.get();
+    t_resolving--;
+  }
+  return next_calloc.get()(n, sz);
+}
+
+void raw_free(void* p) noexcept
+{
+  if (p && !is_bootstrap(p))
+    next_free.get()(p);
+}
+
+void* raw_aligned(std::size_t n, std::size_t alignment) noexcept
+{
+  void* p{};
+  alignment = std::max(alignment, sizeof(void*));
+  return next_posix_memalign.get()(&p, alignment, n ? n : 1) == 0 ? p : nullptr;
+}
+
+// Startup, outside of any scope: the first backtrace() loads libgcc, which allocates
+[[maybe_unused]] const bool g_initialized = [] {
+  if (const char* env = std::getenv("AVND_RT_SANITIZE"))
+  {
+    if (std::strcmp(env, "off") == 0)
+      g_mode = avnd_rt_sanitizer_off;
+    else if (std::strcmp(env, "abort") == 0)
+      g_mode = avnd_rt_sanitizer_abort;
+  }
+  void* frames[1];
+  ::backtrace(frames, 1);
+  return true;
+}();
+#endif
+}
+
+extern "C" {
+void avnd_rt_sanitizer_set_mode(enum avnd_rt_sanitizer_mode mode)
+{
+  g_mode.store(mode, std::memory_order_relaxed);
+}
+
+uint64_t avnd_rt_sanitizer_violations(void)
+{
+  return g_violations.load(std::memory_order_relaxed);
+}
+}
+
+#if defined(__linux__)
+/// Memory
+extern "C" {
+void* malloc(std::size_t n)
+{
+  AVND_RT_CHECK("malloc");
+  return raw_malloc(n);
+}
+
+void* calloc(std::size_t n, std::size_t sz)
+{
+  AVND_RT_CHECK("calloc");
+  return raw_calloc(n, sz);
+}
+
+void* realloc(void* p, std::size_t n)
+{
+  AVND_RT_CHECK("realloc");
+  if (is_bootstrap(p))
+  {
+    void* res = raw_malloc(n);
+    if (res)
+      std::memcpy(res, p, std::min(n, std::size_t(g_bootstrap + sizeof(g_bootstrap) - static_cast<char*>(p))));
+    return res;
+  }
+  return next_realloc.get()(p, n);
+}
+
+void free(void* p)
+{
+  if (p)
+    AVND_RT_CHECK("free");
+  raw_free(p);
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t n)
+{
+  AVND_RT_CHECK("aligned_alloc");
+  return next_aligned_alloc.get()(alignment, n);
+}
+
+int posix_memalign(void** p, std::size_t alignment, std::size_t n)
+{
+  AVND_RT_CHECK("posix_memalign");
+  return next_posix_memalign.get()(p, alignment, n);
+}
+}
+
+// The replaceable allocation functions: the inlined code of the containers calls them
+void* operator new(std::size_t n)
+{
+  AVND_RT_CHECK("operator new");
+  if (void* p = raw_malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+void* operator new[](std::size_t n)
+{
+  AVND_RT_CHECK("operator new[]");
+  if (void* p = raw_malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{
+  AVND_RT_CHECK("operator new");
+  return raw_malloc(n ? n : 1);
+}
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept
+{
+  AVND_RT_CHECK("operator new[]");
+  return raw_malloc(n ? n : 1);
+}
+void* operator new(std::size_t n, std::align_val_t a)
+{
+  AVND_RT_CHECK("operator new");
+  if (void* p = raw_aligned(n, std::size_t(a)))
+    return p;
+  throw std::bad_alloc{};
+}
+void* operator new[](std::size_t n, std::align_val_t a)
+{
+  AVND_RT_CHECK("operator new[]");
+  if (void* p = raw_aligned(n, std::size_t(a)))
+    return p;
+  throw std::bad_alloc{};
+}
+void* operator new(std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+  AVND_RT_CHECK("operator new");
+  return raw_aligned(n, std::size_t(a));
+}
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+{
+  AVND_RT_CHECK("operator new[]");
+  return raw_aligned(n, std::size_t(a));
+}
+
+#define AVND_RT_DELETE(what)   \
+  if (p)                       \
+    AVND_RT_CHECK(what);       \
+  raw_free(p)
+
+void operator delete(void* p) noexcept { AVND_RT_DELETE("operator delete"); }
+void operator delete[](void* p) noexcept { AVND_RT_DELETE("operator delete[]"); }
+void operator delete(void* p, std::size_t) noexcept { AVND_RT_DELETE("operator delete"); }
+void operator delete[](void* p, std::size_t) noexcept { AVND_RT_DELETE("operator delete[]"); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { AVND_RT_DELETE("operator delete"); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+  AVND_RT_DELETE("operator delete[]");
+}
+void operator delete(void* p, std::align_val_t) noexcept { AVND_RT_DELETE("operator delete"); }
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+  AVND_RT_DELETE("operator delete[]");
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+  AVND_RT_DELETE("operator delete");
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+  AVND_RT_DELETE("operator delete[]");
+}
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  AVND_RT_DELETE("operator delete");
+}
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  AVND_RT_DELETE("operator delete[]");
+}
+
+/// Locks and waits, of std::mutex, std::condition_variable, std::thread::join...
+// pthread_mutex_trylock is fine: it never blocks
+namespace
+{
+AVND_RT_NEXT(pthread_mutex_lock);
+AVND_RT_NEXT(pthread_cond_wait);
+AVND_RT_NEXT(pthread_cond_timedwait);
+AVND_RT_NEXT(pthread_rwlock_rdlock);
+AVND_RT_NEXT(pthread_rwlock_wrlock);
+AVND_RT_NEXT(pthread_join);
+AVND_RT_NEXT(sem_wait);
+
+AVND_RT_NEXT(usleep);
+AVND_RT_NEXT(nanosleep);
+AVND_RT_NEXT(clock_nanosleep);
+AVND_RT_NEXT(sleep);
+AVND_RT_NEXT(poll);
+AVND_RT_NEXT(select);
+
+AVND_RT_NEXT(open);
+AVND_RT_NEXT(close);
+AVND_RT_NEXT(read);
+AVND_RT_NEXT(write);
+AVND_RT_NEXT(fopen);
+AVND_RT_NEXT(fclose);
+AVND_RT_NEXT(fread);
+AVND_RT_NEXT(fwrite);
+AVND_RT_NEXT(fflush);
+AVND_RT_NEXT(fputs);
+AVND_RT_NEXT(puts);
+AVND_RT_NEXT(vfprintf);
+}
+
+extern "C" {
+int pthread_mutex_lock(pthread_mutex_t* m)
+{
+  AVND_RT_CHECK("pthread_mutex_lock");
+  return next_pthread_mutex_lock.get()(m);
+}
+int pthread_cond_wait(pthread_cond_t* c, pthread_mutex_t* m)
+{
+  AVND_RT_CHECK("pthread_cond_wait");
+  return next_pthread_cond_wait.get()(c, m);
+}
+int pthread_cond_timedwait(pthread_cond_t* c, pthread_mutex_t* m, const struct timespec* t)
+{
+  AVND_RT_CHECK("pthread_cond_timedwait");
+  return next_pthread_cond_timedwait.get()(c, m, t);
+}
+int pthread_rwlock_rdlock(pthread_rwlock_t* l)
+{
+  AVND_RT_CHECK("pthread_rwlock_rdlock");
+  return next_pthread_rwlock_rdlock.get()(l);
+}
+int pthread_rwlock_wrlock(pthread_rwlock_t* l)
+{
+  AVND_RT_CHECK("pthread_rwlock_wrlock");
+  return next_pthread_rwlock_wrlock.get()(l);
+}
+int pthread_join(pthread_t t, void** res)
+{
+  AVND_RT_CHECK("pthread_join");
+  return next_pthread_join.get()(t, res);
+}
+int sem_wait(sem_t* s)
+{
+  AVND_RT_CHECK("sem_wait");
+  return next_sem_wait.get()(s);
+}
+
+/// Syscalls
+int usleep(useconds_t us)
+{
+  AVND_RT_CHECK("usleep");
+  return next_usleep.get()(us);
+}
+int nanosleep(const struct timespec* t, struct timespec* rem)
+{
+  AVND_RT_CHECK("nanosleep");
+  return next_nanosleep.get()(t, rem);
+}
+int clock_nanosleep(clockid_t c, int flags, const struct timespec* t, struct timespec* rem)
+{
+  AVND_RT_CHECK("clock_nanosleep");
+  return next_clock_nanosleep.get()(c, flags, t, rem);
+}
+unsigned int sleep(unsigned int s)
+{
+  AVND_RT_CHECK("sleep");
+  return next_sleep.get()(s);
+}
+int poll(struct pollfd* fds, nfds_t n, int timeout)
+{
+  AVND_RT_CHECK("poll");
+  return next_poll.get()(fds, n, timeout);
+}
+int select(int n, fd_set* r, fd_set* w, fd_set* e, struct timeval* t)
+{
+  AVND_RT_CHECK("select");
+  return next_select.get()(n, r, w, e, t);
+}
+
+int open(const char* path, int flags, ...)
+{
+  AVND_RT_CHECK("open");
+  mode_t mode = 0;
+  if (flags & (O_CREAT | O_TMPFILE))
+  {
+    va_list args;
+    va_start(args, flags);
+    mode = mode_t(va_arg(args, int));
+    va_end(args);
+  }
+  return next_open.get()(path, flags, mode);
+}
+int close(int fd)
+{
+  AVND_RT_CHECK("close");
+  return next_close.get()(fd);
+}
+ssize_t read(int fd, void* buf, std::size_t n)
+{
+  AVND_RT_CHECK("read");
+  return next_read.get()(fd, buf, n);
+}
+ssize_t write(int fd, const void* buf, std::size_t n)
+{
+  AVND_RT_CHECK("write");
+  return next_write.get()(fd, buf, n);
+}
+
+FILE* fopen(const char* path, const char* mode)
+{
+  AVND_RT_CHECK("fopen");
+  return next_fopen.get()(path, mode);
+}
+int fclose(FILE* f)
+{
+  AVND_RT_CHECK("fclose");
+  return next_fclose.get()(f);
+}
+std::size_t fread(void* buf, std::size_t sz, std::size_t n, FILE* f)
+{
+  AVND_RT_CHECK("fread");
+  return next_fread.get()(buf, sz, n, f);
+}
+std::size_t fwrite(const void* buf, std::size_t sz, std::size_t n, FILE* f)
+{
+  AVND_RT_CHECK("fwrite");
+  return next_fwrite.get()(buf, sz, n, f);
+}
+int fflush(FILE* f)
+{
+  AVND_RT_CHECK("fflush");
+  return next_fflush.get()(f);
+}
+int fputs(const char* s, FILE* f)
+{
+  AVND_RT_CHECK("fputs");
+  return next_fputs.get()(s, f);
+}
+int puts(const char* s)
+{
+  AVND_RT_CHECK("puts");
+  return next_puts.get()(s);
+}
+int vfprintf(FILE* f, const char* fmt, va_list args)
+{
+  AVND_RT_CHECK("vfprintf");
+  return next_vfprintf.get()(f, fmt, args);
+}
+int vprintf(const char* fmt, va_list args)
+{
+  AVND_RT_CHECK("vprintf");
+  return next_vfprintf.get()(stdout, fmt, args);
+}
+int fprintf(FILE* f, const char* fmt, ...)
+{
+  AVND_RT_CHECK("fprintf");
+  va_list args;
+  va_start(args, fmt);
+  const int res = next_vfprintf.get()(f, fmt, args);
+  va_end(args);
+  return res;
+}
+int printf(const char* fmt, ...)
+{
+  AVND_RT_CHECK("printf");
+  va_list args;
+  va_start(args, fmt);
+  const int res = next_vfprintf.get()(stdout, fmt, args);
+  va_end(args);
+  return res;
+}
+}
+#endif
+#endif
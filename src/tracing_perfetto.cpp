@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+// The storage of the "avnd" category of avnd/wrappers/tracing.hpp, in the avendish_perfetto
+// library which the bindings link to when built with AVENDISH_TRACING=perfetto.
+//
+// The events go to the system backend, i.e. the traced daemon, so that a trace of the
+// whole host is recorded with e.g. the perfetto command-line tool.
+
+#include <avnd/wrappers/tracing.hpp>
+
+#if AVND_TRACING_PERFETTO
+PERFETTO_TRACK_EVENT_STATIC_STORAGE_IN_NAMESPACE(avnd::trace::perfetto_categories);
+
+namespace
+{
+// Initialize() does nothing when the host already did it
+[[maybe_unused]] const bool g_initialized = [] {
+  perfetto::TracingInitArgs args;
+  args.backends = perfetto::kSystemBackend;
+  perfetto::Tracing::Initialize(args);
+  avnd::trace::perfetto_categories::TrackEvent::Register();
+  return true;
+}();
+}
+#endif
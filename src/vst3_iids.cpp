@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+// The interface identifiers of the VST3 SDK: defined once per binary, here,
+// for the plug-ins and for the programs which use stv3::Component directly.
+
+// The same declarations as in the prototype of the plug-ins
+#include <avnd/binding/vst3/audio_effect.hpp>
+
+namespace Steinberg {
+namespace Vst {
+
+//----VST 3.0--------------------------------
+DEF_CLASS_IID (IComponent)
+DEF_CLASS_IID (IAudioProcessor)
+DEF_CLASS_IID (IUnitData)
+DEF_CLASS_IID (IProgramListData)
+
+DEF_CLASS_IID (IEditController)
+DEF_CLASS_IID (IUnitInfo)
+
+DEF_CLASS_IID (IConnectionPoint)
+
+DEF_CLASS_IID (IComponentHandler)
+DEF_CLASS_IID (IUnitHandler)
+
+DEF_CLASS_IID (IParamValueQueue)
+DEF_CLASS_IID (IParameterChanges)
+
+DEF_CLASS_IID (IEventList)
+DEF_CLASS_IID (IMessage)
+
+DEF_CLASS_IID (IHostApplication)
+DEF_CLASS_IID (IAttributeList)
+
+//----VST 3.0.1--------------------------------
+DEF_CLASS_IID (IMidiMapping)
+
+//----VST 3.0.2--------------------------------
+
+//----VST 3.1----------------------------------
+DEF_CLASS_IID (IComponentHandler2)
+DEF_CLASS_IID (IEditController2)
+DEF_CLASS_IID (IAudioPresentationLatency)
+DEF_CLASS_IID (IVst3ToVst2Wrapper)
+DEF_CLASS_IID (IVst3ToAUWrapper)
+
+//----VST 3.5----------------------------------
+DEF_CLASS_IID (INoteExpressionController)
+DEF_CLASS_IID (IKeyswitchController)
+DEF_CLASS_IID (IEditControllerHostEditing)
+
+//----VST 3.6----------------------------------
+DEF_CLASS_IID (IStreamAttributes)
+
+//----VST 3.6.5--------------------------------
+DEF_CLASS_IID (IUnitHandler2)
+
+//----VST 3.6.8--------------------------------
+DEF_CLASS_IID (IComponentHandlerBusActivation)
+DEF_CLASS_IID (IVst3ToAAXWrapper)
+
+DEF_CLASS_IID (IVst3WrapperMPESupport)
+
+
+//----VST 3.7-----------------------------------
+DEF_CLASS_IID (IProcessContextRequirements)
+DEF_CLASS_IID (IProgress)
+}}
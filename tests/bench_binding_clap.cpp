@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "bench_bindings.hpp"
+
+#include <avnd/binding/clap/audio_effect.hpp>
+#include <avnd/binding/clap/configure.hpp>
+
+#include <vector>
+
+namespace
+{
+// The events of a block, and a sink for the output ones
+struct event_list
+{
+  std::vector<clap_event> events;
+  clap_event_list list{
+      .ctx = this,
+      .size = [](const clap_event_list* l) -> uint32_t {
+        return static_cast<event_list*>(l->ctx)->events.size();
+      },
+      .get = [](const clap_event_list* l, uint32_t index) -> const clap_event* {
+        return &static_cast<event_list*>(l->ctx)->events[index];
+      },
+      .push_back = [](const clap_event_list* l, const clap_event* ev) {
+        benchmark::DoNotOptimize(ev->param_value.value);
+      }};
+};
+}
+
+// Parameter events in the input list of clap_plugin::process
+template <typename Processor>
+static void clap_glue(benchmark::State& state)
+{
+  using type = decltype(avnd::configure<avnd_clap::config, Processor>())::type;
+  using effect_type = avnd_clap::SimpleAudioEffect<type>;
+  const int frames = state.range(0);
+  const int changes = state.range(1);
+
+  // No extension: the processing is serial and the latency is never reported
+  clap_host host{};
+  host.clap_version = CLAP_VERSION;
+  host.name = "avendish_bench_bindings";
+  host.get_extension = [](const clap_host*, const char*) -> const void* { return nullptr; };
+  host.request_restart = [](const clap_host*) {};
+  host.request_process = [](const clap_host*) {};
+  host.request_callback = [](const clap_host*) {};
+
+  const clap_plugin* plugin = new effect_type{&host};
+  plugin->init(plugin);
+  plugin->activate(plugin, 48000., 1, bench_bindings::max_frames);
+  plugin->start_processing(plugin);
+
+  // The events go through the ids and the ranges which the host sees
+  auto params = static_cast<const clap_plugin_params*>(
+      plugin->get_extension(plugin, "clap.params"));
+  std::vector<clap_param_info> infos(changes);
+  for (int k = 0; k < changes; k++)
+    params->get_info(plugin, bench_bindings::parameter<Processor>(k), &infos[k]);
+
+  const int in_channels = avnd::input_channels<type>(2);
+  const int out_channels = avnd::output_channels<type>(2);
+  std::vector<std::vector<float>> in(in_channels, std::vector<float>(frames));
+  std::vector<std::vector<float>> out(out_channels, std::vector<float>(frames));
+  std::vector<float*> ins, outs;
+  for (auto& c : in)
+    ins.push_back(c.data());
+  for (auto& c : out)
+    outs.push_back(c.data());
+
+  clap_audio_buffer in_bus{};
+  in_bus.data32 = ins.data();
+  in_bus.channel_count = in_channels;
+  clap_audio_buffer out_bus{};
+  out_bus.data32 = outs.data();
+  out_bus.channel_count = out_channels;
+
+  event_list in_events, out_events;
+  in_events.events.resize(changes);
+
+  clap_process process{};
+  process.frames_count = frames;
+  process.audio_inputs = &in_bus;
+  process.audio_inputs_count = in_channels > 0;
+  process.audio_outputs = &out_bus;
+  process.audio_outputs_count = out_channels > 0;
+  process.in_events = &in_events.list;
+  process.out_events = &out_events.list;
+
+  int64_t block = 0;
+  for (auto _ : state)
+  {
+    // Spread over the block, as automation would be
+    for (int k = 0; k < changes; k++)
+    {
+      auto& ev = in_events.events[k];
+      const auto& info = infos[k];
+      ev = {};
+      ev.type = CLAP_EVENT_PARAM_VALUE;
+      ev.time = k * frames / changes;
+      ev.param_value.param_id = info.id;
+      ev.param_value.key = -1;
+      ev.param_value.channel = -1;
+      ev.param_value.value = info.min_value
+                             + bench_bindings::value(block, k)
+                                   * (info.max_value - info.min_value);
+    }
+
+    process.steady_time = block * frames;
+    plugin->process(plugin, &process);
+    benchmark::ClobberMemory();
+    block++;
+  }
+
+  plugin->stop_processing(plugin);
+  plugin->deactivate(plugin);
+  plugin->destroy(plugin);
+}
+
+BENCHMARK_TEMPLATE(clap_glue, examples::TrivialFilterExample)
+    ->Apply(bench_bindings::arguments);
+BENCHMARK_TEMPLATE(clap_glue, examples::ControlGallery)
+    ->Apply(bench_bindings::arguments);
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "bench_bindings.hpp"
+
+#include <avnd/binding/vintage/audio_effect.hpp>
+#include <avnd/binding/vintage/configure.hpp>
+
+#include <vector>
+
+// Parameters through setParameter, then processReplacing
+template <typename Processor>
+static void vintage_glue(benchmark::State& state)
+{
+  using type = decltype(avnd::configure<vintage::config, Processor>())::type;
+  const int frames = state.range(0);
+  const int changes = state.range(1);
+
+  // Nothing to answer: the rate and block size are set below
+  constexpr vintage::HostCallback host
+      = [](vintage::Effect*, int32_t, int32_t, intptr_t, void*, float) -> intptr_t {
+    return 0;
+  };
+
+  auto effect = new vintage::SimpleAudioEffect<type>{host};
+  auto dispatch = [effect](vintage::EffectOpcodes op, intptr_t value, float opt) {
+    return effect->dispatcher(effect, int32_t(op), 0, value, nullptr, opt);
+  };
+  dispatch(vintage::EffectOpcodes::SetSampleRate, 0, 48000.f);
+  dispatch(vintage::EffectOpcodes::SetBlockSize, bench_bindings::max_frames, 0.f);
+  dispatch(vintage::EffectOpcodes::MainsChanged, 1, 0.f);
+
+  std::vector<std::vector<float>> in(effect->numInputs, std::vector<float>(frames));
+  std::vector<std::vector<float>> out(effect->numOutputs, std::vector<float>(frames));
+  std::vector<float*> ins, outs;
+  for (auto& c : in)
+    ins.push_back(c.data());
+  for (auto& c : out)
+    outs.push_back(c.data());
+
+  int64_t block = 0;
+  for (auto _ : state)
+  {
+    for (int k = 0; k < changes; k++)
+      effect->setParameter(
+          effect, bench_bindings::parameter<Processor>(k),
+          float(bench_bindings::value(block, k)));
+    effect->processReplacing(effect, ins.data(), outs.data(), frames);
+    benchmark::ClobberMemory();
+    block++;
+  }
+
+  dispatch(vintage::EffectOpcodes::MainsChanged, 0, 0.f);
+  dispatch(vintage::EffectOpcodes::Close, 0, 0.f);
+}
+
+BENCHMARK_TEMPLATE(vintage_glue, examples::TrivialFilterExample)
+    ->Apply(bench_bindings::arguments);
+BENCHMARK_TEMPLATE(vintage_glue, examples::helpers::Controls)
+    ->Apply(bench_bindings::arguments);
@@ -0,0 +1,173 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "bench_bindings.hpp"
+
+#include <avnd/binding/vst3/audio_effect.hpp>
+#include <avnd/binding/vst3/configure.hpp>
+
+#include <utility>
+#include <vector>
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+namespace
+{
+// Owned by the benchmark: not reference-counted
+struct param_queue final : IParamValueQueue
+{
+  ParamID id{};
+  std::vector<std::pair<int32, ParamValue>> points;
+
+  tresult queryInterface(const TUID, void** obj) override
+  {
+    *obj = nullptr;
+    return kNoInterface;
+  }
+  uint32 addRef() override { return 1; }
+  uint32 release() override { return 1; }
+
+  ParamID getParameterId() override { return id; }
+  int32 getPointCount() override { return int32(points.size()); }
+  tresult getPoint(int32 index, int32& sampleOffset, ParamValue& value) override
+  {
+    if (index < 0 || index >= int32(points.size()))
+      return kResultFalse;
+    sampleOffset = points[index].first;
+    value = points[index].second;
+    return kResultTrue;
+  }
+  tresult addPoint(int32 sampleOffset, ParamValue value, int32& index) override
+  {
+    index = int32(points.size());
+    points.emplace_back(sampleOffset, value);
+    return kResultTrue;
+  }
+};
+
+// One queue per changed parameter, as the hosts give them
+struct parameter_changes final : IParameterChanges
+{
+  std::vector<param_queue> queues;
+  int32 used{};
+
+  explicit parameter_changes(int count)
+      : queues(count)
+  {
+  }
+
+  void clear()
+  {
+    for (int32 i = 0; i < used; i++)
+      queues[i].points.clear();
+    used = 0;
+  }
+
+  tresult queryInterface(const TUID, void** obj) override
+  {
+    *obj = nullptr;
+    return kNoInterface;
+  }
+  uint32 addRef() override { return 1; }
+  uint32 release() override { return 1; }
+
+  int32 getParameterCount() override { return used; }
+  IParamValueQueue* getParameterData(int32 index) override
+  {
+    return index >= 0 && index < used ? &queues[index] : nullptr;
+  }
+  IParamValueQueue* addParameterData(const ParamID& id, int32& index) override
+  {
+    for (index = 0; index < used; index++)
+      if (queues[index].id == id)
+        return &queues[index];
+    if (used == int32(queues.size()))
+      return nullptr;
+    queues[used].id = id;
+    return &queues[used++];
+  }
+};
+}
+
+// Parameter changes in the inputParameterChanges of IAudioProcessor::process
+template <typename Processor>
+static void vst3_glue(benchmark::State& state)
+{
+  using type = decltype(avnd::configure<stv3::config, Processor>())::type;
+  const int frames = state.range(0);
+  const int changes = state.range(1);
+
+  auto component = new stv3::Component<type>;
+
+  ProcessSetup setup{
+      .processMode = kRealtime,
+      .symbolicSampleSize = kSample32,
+      .maxSamplesPerBlock = bench_bindings::max_frames,
+      .sampleRate = 48000.};
+  component->setupProcessing(setup);
+  component->setActive(true);
+  component->setProcessing(true);
+
+  const int in_channels = component->audio_busses.runtime_input_channel_count;
+  const int out_channels = component->audio_busses.runtime_output_channel_count;
+  std::vector<std::vector<float>> in(in_channels, std::vector<float>(frames));
+  std::vector<std::vector<float>> out(out_channels, std::vector<float>(frames));
+  std::vector<float*> ins, outs;
+  for (auto& c : in)
+    ins.push_back(c.data());
+  for (auto& c : out)
+    outs.push_back(c.data());
+
+  AudioBusBuffers in_bus{};
+  in_bus.numChannels = in_channels;
+  in_bus.channelBuffers32 = ins.data();
+  AudioBusBuffers out_bus{};
+  out_bus.numChannels = out_channels;
+  out_bus.channelBuffers32 = outs.data();
+
+  // The ids of the parameters are the indices of their fields in the inputs
+  using param_in_info = avnd::parameter_input_introspection<type>;
+  parameter_changes in_changes{param_in_info::size};
+  parameter_changes out_changes{
+      avnd::parameter_output_introspection<type>::size + 1};
+
+  ProcessData data;
+  data.processMode = kRealtime;
+  data.symbolicSampleSize = kSample32;
+  data.numSamples = frames;
+  data.numInputs = in_channels > 0;
+  data.inputs = &in_bus;
+  data.numOutputs = out_channels > 0;
+  data.outputs = &out_bus;
+  data.inputParameterChanges = &in_changes;
+  data.outputParameterChanges = &out_changes;
+
+  int64_t block = 0;
+  for (auto _ : state)
+  {
+    in_changes.clear();
+    out_changes.clear();
+
+    // Spread over the block, as automation would be
+    for (int k = 0; k < changes; k++)
+    {
+      const ParamID id = param_in_info::index_map[bench_bindings::parameter<Processor>(k)];
+      int32 index{};
+      if (auto queue = in_changes.addParameterData(id, index))
+        queue->addPoint(k * frames / changes, bench_bindings::value(block, k), index);
+    }
+
+    component->process(data);
+    benchmark::ClobberMemory();
+    block++;
+  }
+
+  component->setProcessing(false);
+  component->setActive(false);
+  component->release();
+}
+
+BENCHMARK_TEMPLATE(vst3_glue, examples::TrivialFilterExample)
+    ->Apply(bench_bindings::arguments);
+BENCHMARK_TEMPLATE(vst3_glue, examples::ControlGallery)
+    ->Apply(bench_bindings::arguments);
@@ -0,0 +1,56 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <avnd/introspection/input.hpp>
+#include <benchmark/benchmark.h>
+#include <examples/Helpers/Controls.hpp>
+#include <examples/Tutorial/ControlGallery.hpp>
+#include <examples/Tutorial/TrivialFilterExample.hpp>
+
+#include <cstdint>
+
+// Measures the glue of each binding around the same processors, per block:
+// the blocks go straight to the process entry point of the binding, as a host
+// would call it, with a number of parameter changes in each. What is timed is thus
+// the parsing of the events, the application of the parameters and the setup of the
+// buffers, the processors themselves doing next to nothing:
+//  - TrivialFilterExample has a single control;
+//  - ControlGallery has a dozen sample-accurate ones, of most types;
+//  - helpers::Controls has a handful of plain ones, of the types vintage supports,
+//    which replaces ControlGallery for vintage as in cmake/avendish.examples.cmake.
+//
+// To track the glue across changes, save the results with
+//   --benchmark_out=bindings.json --benchmark_out_format=json
+// and compare two such files with tools/compare.py of Google Benchmark.
+namespace bench_bindings
+{
+// The buttons of ControlGallery print when pressed: only the next controls change
+template <typename T>
+inline constexpr int first_parameter = 0;
+template <>
+inline constexpr int first_parameter<examples::ControlGallery> = 2;
+
+// The index of the k-th parameter changed in a block
+template <typename T>
+int parameter(int k) noexcept
+{
+  constexpr int count = avnd::parameter_input_introspection<T>::size - first_parameter<T>;
+  static_assert(count > 0);
+  return first_parameter<T> + k % count;
+}
+
+// Its normalized value, different from one block to the next
+inline double value(int64_t block, int k) noexcept
+{
+  return double((block + k) % 100) / 100.;
+}
+
+inline constexpr int max_frames = 1024;
+
+// frames: the size of the blocks; changes: the parameter changes in each
+inline void arguments(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"frames", "changes"})->ArgsProduct({{16, 64, 256, max_frames}, {0, 1, 8}});
+}
+}
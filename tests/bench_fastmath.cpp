@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+#include <halp/fastmath.hpp>
+
+#include <cmath>
+#include <vector>
+
+// Compares halp::fastmath with std:: on buffers, reported per sample.
+// Registered statically: they run in avendish_bench along the process adapters.
+namespace fm = halp::fastmath;
+
+template <typename FP, typename F>
+static void fastmath_benchmark(benchmark::State& state, FP lo, FP hi, F func)
+{
+  const int frames = 1024;
+  std::vector<FP> input(frames), output(frames);
+  for (int i = 0; i < frames; i++)
+    input[i] = lo + (hi - lo) * FP(i) / FP(frames);
+
+  for (auto _ : state)
+  {
+    func(input.data(), output.data(), frames);
+    benchmark::DoNotOptimize(output.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.counters["per_sample"] = benchmark::Counter(
+      double(frames), benchmark::Counter::kIsIterationInvariantRate
+                          | benchmark::Counter::kInvert);
+}
+
+#define AVND_BENCH_FASTMATH(func, FP, lo, hi)                                          \
+  static void bench_std_##func##_##FP(benchmark::State& state)                         \
+  {                                                                                    \
+    fastmath_benchmark<FP>(state, lo, hi, [](const FP* in, FP* out, int n) {           \
+      for (int i = 0; i < n; i++)                                                      \
+        out[i] = std::func(in[i]);                                                     \
+    });                                                                                \
+  }                                                                                    \
+  template <fm::accuracy A>                                                            \
+  static void bench_fastmath_##func##_##FP(benchmark::State& state)                    \
+  {                                                                                    \
+    fastmath_benchmark<FP>(state, lo, hi, [](const FP* in, FP* out, int n) {           \
+      fm::func<A>(in, out, n);                                                         \
+    });                                                                                \
+  }                                                                                    \
+  BENCHMARK(bench_std_##func##_##FP)->Name("fastmath/" #func "<" #FP ">/std");         \
+  BENCHMARK(bench_fastmath_##func##_##FP<fm::accuracy::low>)                           \
+      ->Name("fastmath/" #func "<" #FP ">/low");                                       \
+  BENCHMARK(bench_fastmath_##func##_##FP<fm::accuracy::medium>)                        \
+      ->Name("fastmath/" #func "<" #FP ">/medium");                                    \
+  BENCHMARK(bench_fastmath_##func##_##FP<fm::accuracy::high>)                          \
+      ->Name("fastmath/" #func "<" #FP ">/high");
+
+AVND_BENCH_FASTMATH(exp2, float, -10.f, 10.f)
+AVND_BENCH_FASTMATH(log2, float, 1e-3f, 100.f)
+AVND_BENCH_FASTMATH(sin, float, -10.f, 10.f)
+AVND_BENCH_FASTMATH(tanh, float, -5.f, 5.f)
+AVND_BENCH_FASTMATH(exp2, double, -10., 10.)
+AVND_BENCH_FASTMATH(log2, double, 1e-3, 100.)
+AVND_BENCH_FASTMATH(sin, double, -10., 10.)
+AVND_BENCH_FASTMATH(tanh, double, -5., 5.)
@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "bench_messages.hpp"
+
+#include <avnd/binding/max/configure.hpp>
+#include <avnd/binding/max/messages.hpp>
+#include <avnd/wrappers/configure.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <variant>
+#include <vector>
+
+// Only called for invalid messages, which are not sent here:
+// the benchmark thus does not need a running Max to resolve the symbols.
+extern "C" {
+void object_error(t_object* x, C74_CONST char* s, ...) { }
+}
+
+// The "anything" method: the selector and the atoms of the message
+template <typename T>
+static void max_message(benchmark::State& state, const bench_messages::message_case& c)
+{
+  using type = decltype(avnd::configure<max::config, T>())::type;
+  avnd::effect_container<type> implementation;
+  max::messages<type> messages;
+
+  // Max interns the symbols: each message comes with the same selector
+  t_symbol selector{};
+  selector.s_name = const_cast<char*>(c.message);
+
+  const int argc = c.arguments.size();
+  std::vector<t_symbol> symbols(argc);
+  std::vector<t_atom> atoms(argc);
+  for (int i = 0; i < argc; i++)
+  {
+    if (auto f = std::get_if<float>(&c.arguments[i]))
+    {
+      atoms[i].a_type = A_FLOAT;
+      atoms[i].a_w.w_float = *f;
+    }
+    else
+    {
+      symbols[i].s_name = const_cast<char*>(std::get<const char*>(c.arguments[i]));
+      atoms[i].a_type = A_SYM;
+      atoms[i].a_w.w_sym = &symbols[i];
+    }
+  }
+
+  bench_messages::start_counting();
+  for (auto _ : state)
+    messages.process_messages(implementation, &selector, argc, atoms.data());
+  bench_messages::report(state, bench_messages::stop_counting());
+}
+
+static const bool registered = [] {
+  using namespace bench_messages;
+  register_cases<RawMessages>("max", max_message<RawMessages>);
+  register_cases<HelpersMessages>("max", max_message<HelpersMessages>);
+  return true;
+}();
@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "bench_messages.hpp"
+
+#include <avnd/binding/ossia/all.hpp>
+#include <avnd/binding/ossia/configure.hpp>
+
+#include <string>
+#include <variant>
+#include <vector>
+
+// A message inlet value: an impulse without argument, the value itself with one,
+// a list with several
+static ossia::value to_value(const std::vector<bench_messages::argument>& args)
+{
+  auto convert = [](const bench_messages::argument& arg) -> ossia::value {
+    if (auto f = std::get_if<float>(&arg))
+      return *f;
+    return std::string(std::get<const char*>(arg));
+  };
+
+  if (args.empty())
+    return ossia::impulse{};
+  if (args.size() == 1)
+    return convert(args[0]);
+
+  std::vector<ossia::value> list;
+  for (const auto& arg : args)
+    list.push_back(convert(arg));
+  return list;
+}
+
+// What the node does for each value received on the inlet of the message
+template <typename T>
+static void ossia_message(benchmark::State& state, const bench_messages::message_case& c)
+{
+  using type = decltype(avnd::configure<oscr::config, T>())::type;
+  oscr::safe_node<type> node{64, 48000.};
+  const ossia::value value = to_value(c.arguments);
+
+  bool found = false;
+  avnd::messages_introspection<type>::for_all([&]<auto Idx, typename M>(
+                                                   avnd::field_reflection<Idx, M> m) {
+    if (found || avnd::get_name<M>() != std::string_view{c.message})
+      return;
+    found = true;
+
+    if constexpr (!oscr::message_signature<type, M>::convertible)
+    {
+      state.SkipWithError("the arguments of this message are not ossia values");
+    }
+    else
+    {
+      bench_messages::start_counting();
+      for (auto _ : state)
+        node.invoke_message(value, m);
+      bench_messages::report(state, bench_messages::stop_counting());
+    }
+  });
+
+  if (!found)
+    state.SkipWithError("no such message");
+}
+
+static const bool registered = [] {
+  using namespace bench_messages;
+  register_cases<RawMessages>("ossia", ossia_message<RawMessages>);
+  register_cases<HelpersMessages>("ossia", ossia_message<HelpersMessages>);
+  return true;
+}();
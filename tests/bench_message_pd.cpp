@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "bench_messages.hpp"
+
+#include <avnd/binding/pd/configure.hpp>
+#include <avnd/binding/pd/messages.hpp>
+#include <avnd/wrappers/configure.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+
+#include <variant>
+#include <vector>
+
+// Only called for invalid messages, which are not sent here:
+// the benchmark thus does not need a running Pd to resolve the symbols.
+extern "C" {
+void startpost(const char* fmt, ...) { }
+void postatom(int argc, const t_atom* argv) { }
+void endpost(void) { }
+}
+
+// The "anything" method: the selector and the atoms of the message
+template <typename T>
+static void pd_message(benchmark::State& state, const bench_messages::message_case& c)
+{
+  using type = decltype(avnd::configure<pd::config, T>())::type;
+  avnd::effect_container<type> implementation;
+  pd::messages<type> messages;
+
+  // Pd interns the symbols: each message comes with the same selector
+  t_symbol selector{};
+  selector.s_name = c.message;
+
+  const int argc = c.arguments.size();
+  std::vector<t_symbol> symbols(argc);
+  std::vector<t_atom> atoms(argc);
+  for (int i = 0; i < argc; i++)
+  {
+    if (auto f = std::get_if<float>(&c.arguments[i]))
+    {
+      SETFLOAT(&atoms[i], *f);
+    }
+    else
+    {
+      symbols[i].s_name = std::get<const char*>(c.arguments[i]);
+      SETSYMBOL(&atoms[i], &symbols[i]);
+    }
+  }
+
+  bench_messages::start_counting();
+  for (auto _ : state)
+    messages.process_messages(implementation, &selector, argc, atoms.data());
+  bench_messages::report(state, bench_messages::stop_counting());
+}
+
+static const bool registered = [] {
+  using namespace bench_messages;
+  register_cases<RawMessages>("pd", pd_message<RawMessages>);
+  register_cases<HelpersMessages>("pd", pd_message<HelpersMessages>);
+  return true;
+}();
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "bench_messages.hpp"
+
+#include <avnd/binding/python/configure.hpp>
+#include <avnd/binding/python/processor.hpp>
+#include <pybind11/embed.h>
+
+#include <string>
+#include <variant>
+
+namespace py = pybind11;
+
+template <typename T>
+using python_type = decltype(avnd::configure<python::config, T>())::type;
+
+// The same module as the prototype would build for each processor
+PYBIND11_EMBEDDED_MODULE(avnd_bench_messages, m)
+{
+  static const python::processor<python_type<bench_messages::RawMessages>> raw{m};
+  static const python::processor<python_type<bench_messages::HelpersMessages>> helpers{m};
+}
+
+// A call of the bound method from Python: the arguments go through pybind11's casters.
+// The allocations done with the allocator of Python do not go through operator new.
+template <typename T>
+static void python_message(benchmark::State& state, const bench_messages::message_case& c)
+{
+  static py::scoped_interpreter interpreter;
+
+  auto module = py::module_::import("avnd_bench_messages");
+  const std::string name{avnd::get_c_identifier<python_type<T>>()};
+  auto object = module.attr(name.c_str())();
+  if (!py::hasattr(object, c.message))
+  {
+    state.SkipWithError("this message is not bound in Python");
+    return;
+  }
+  auto method = object.attr(c.message);
+
+  py::tuple args(c.arguments.size());
+  for (std::size_t i = 0; i < c.arguments.size(); i++)
+  {
+    if (auto f = std::get_if<float>(&c.arguments[i]))
+      args[i] = py::float_(*f);
+    else
+      args[i] = py::str(std::get<const char*>(c.arguments[i]));
+  }
+
+  bench_messages::start_counting();
+  for (auto _ : state)
+    method(*args);
+  bench_messages::report(state, bench_messages::stop_counting());
+}
+
+static const bool registered = [] {
+  using namespace bench_messages;
+  register_cases<RawMessages>("python", python_message<RawMessages>);
+  register_cases<HelpersMessages>("python", python_message<HelpersMessages>);
+  return true;
+}();
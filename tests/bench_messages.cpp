@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "bench_messages.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// Counts the allocations of the dispatch, like test_allocations.cpp.
+// The benchmarks run one at a time, on the main thread.
+static bool g_counting = false;
+static int64_t g_allocations = 0;
+
+void* operator new(std::size_t sz)
+{
+  if (g_counting)
+    g_allocations++;
+  if (void* ptr = std::malloc(sz ? sz : 1))
+    return ptr;
+  throw std::bad_alloc{};
+}
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace bench_messages
+{
+void start_counting() noexcept
+{
+  g_allocations = 0;
+  g_counting = true;
+}
+
+int64_t stop_counting() noexcept
+{
+  g_counting = false;
+  return g_allocations;
+}
+}
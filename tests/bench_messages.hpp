@@ -0,0 +1,137 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <benchmark/benchmark.h>
+#include <examples/Helpers/Messages.hpp>
+#include <halp/log.hpp>
+
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+// Measures the dispatch of the messages in each binding which has its own:
+// a message goes from the representation of the host (Pd and Max atoms, an ossia::value,
+// Python objects) to the call of the function, through messages_introspection.
+// Each benchmark sends one message a million times and reports, per message,
+// its time and the operator new calls of the dispatch.
+//
+// The messages of the examples which print are not sent: the printing would be
+// all that is measured.
+namespace bench_messages
+{
+// The messages of examples/Raw/Messages.hpp, without their printf
+struct RawMessages
+{
+  static consteval auto name() { return "Messages"; }
+  static consteval auto c_name() { return "avnd_bench_messages"; }
+
+  struct
+  {
+    struct
+    {
+      float value;
+    } a;
+    struct
+    {
+      float value;
+    } b;
+  } inputs;
+
+  struct
+  {
+    struct
+    {
+      static consteval auto name() { return "member"; }
+      static consteval auto func() { return &RawMessages::bamboozle; }
+    } member;
+    struct
+    {
+      static consteval auto name() { return "lambda_function"; }
+      static consteval auto func()
+      {
+        return [] { benchmark::ClobberMemory(); };
+      }
+    } lambda;
+    struct
+    {
+      static consteval auto name() { return "function"; }
+      static consteval auto func() { return free_function; }
+    } freefunc;
+  } messages;
+
+  static void free_function(float a) { benchmark::DoNotOptimize(a); }
+
+  void bamboozle(float x, float y, const char* str)
+  {
+    inputs.a.value = x;
+    inputs.b.value = y;
+    benchmark::DoNotOptimize(str);
+  }
+
+  void operator()() { }
+};
+
+struct silent_config
+{
+  using logger_type = halp::no_logger;
+};
+using HelpersMessages = examples::helpers::Messages<silent_config>;
+
+// A message and its arguments, as the host would send them
+using argument = std::variant<float, const char*>;
+struct message_case
+{
+  const char* message{};
+  std::vector<argument> arguments;
+};
+
+// From no argument to three of both types.
+// example3 is registered for int, float and const char*: the first one gets the call.
+template <typename T>
+std::vector<message_case> cases();
+template <>
+inline std::vector<message_case> cases<RawMessages>()
+{
+  return {
+      {"lambda_function", {}},
+      {"function", {1.f}},
+      {"member", {1.f, 2.f, "foo"}},
+  };
+}
+template <>
+inline std::vector<message_case> cases<HelpersMessages>()
+{
+  return {
+      {"example", {}},
+      {"example2", {1.f}},
+      {"example3", {1.f}},
+      {"my_message", {}},
+      {"free_template_example", {}},
+  };
+}
+
+// The operator new calls in between, counted by bench_messages.cpp
+void start_counting() noexcept;
+int64_t stop_counting() noexcept;
+
+inline void report(benchmark::State& state, int64_t allocations)
+{
+  state.SetItemsProcessed(state.iterations());
+  state.counters["allocations"]
+      = benchmark::Counter(double(allocations), benchmark::Counter::kAvgIterations);
+}
+
+// Registers f for each message of T, named binding/processor/message
+template <typename T, typename F>
+void register_cases(const char* binding, F f)
+{
+  for (const auto& c : cases<T>())
+  {
+    const std::string name
+        = std::string(binding) + "/" + std::string(T::name()) + "/" + c.message;
+    benchmark::RegisterBenchmark(name.c_str(), f, c)->Iterations(1'000'000);
+  }
+}
+}
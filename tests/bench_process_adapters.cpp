@@ -0,0 +1,169 @@
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/process_adapter.hpp>
+#include <benchmark/benchmark.h>
+#include <examples/Helpers/Lowpass.hpp>
+#include <examples/Helpers/PerBus.hpp>
+#include <examples/Helpers/PerSample.hpp>
+#include <examples/Raw/Lowpass.hpp>
+#include <examples/Raw/PerSampleProcessor.hpp>
+#include <examples/Raw/PerSampleProcessor2.hpp>
+#include <examples/Tutorial/Distortion.hpp>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Measures the cost of going through each process_adapter specialization,
+// reported per processed sample (i.e. per frame and per channel).
+
+// None of the examples processes its channels one at a time, thus
+// these two cover the per-channel adapters.
+struct PerChannelAsArgs
+{
+  // (FP*, FP*, int) would be taken as a monophonic effect,
+  // and the per-channel adapter does not convert between sample types
+  struct tick
+  {
+    int frames{};
+  };
+
+  template <typename FP>
+  void operator()(FP* in, FP* out, const tick& t)
+  {
+    for (int k = 0; k < t.frames; k++)
+      out[k] = std::tanh(FP(10) * in[k]);
+  }
+};
+
+struct PerChannelAsPorts
+{
+  struct
+  {
+    struct
+    {
+      static consteval auto name() { return "In"; }
+      float* channel{};
+    } audio;
+  } inputs;
+
+  struct
+  {
+    struct
+    {
+      static consteval auto name() { return "Out"; }
+      float* channel{};
+    } audio;
+    struct
+    {
+      static consteval auto name() { return "Out (inverted)"; }
+      float* channel{};
+    } inverted;
+  } outputs;
+
+  void operator()(int frames)
+  {
+    for (int k = 0; k < frames; k++)
+    {
+      const float v = std::tanh(10.f * inputs.audio.channel[k]);
+      outputs.audio.channel[k] = v;
+      outputs.inverted.channel[k] = -v;
+    }
+  }
+};
+
+template <typename T, typename FP>
+static void process_adapter_benchmark(benchmark::State& state)
+{
+  const int frames = state.range(0);
+  const int channels = state.range(1);
+
+  avnd::effect_container<T> impl;
+  avnd::process_adapter<T> processor;
+
+  const avnd::process_setup setup{
+      .input_channels = channels,
+      .output_channels = channels,
+      .frames_per_buffer = frames,
+      .rate = 48000.};
+  processor.allocate_buffers(setup, FP{});
+  impl.init_channels(channels, channels);
+  avnd::prepare(impl, setup);
+
+  std::vector<FP> input(std::size_t(frames) * channels);
+  std::vector<FP> output(std::size_t(frames) * channels);
+  for (std::size_t i = 0; i < input.size(); i++)
+    input[i] = FP(0.5) * std::sin(FP(0.01) * i);
+
+  std::vector<FP*> in(channels), out(channels);
+  for (int c = 0; c < channels; c++)
+  {
+    in[c] = input.data() + c * frames;
+    out[c] = output.data() + c * frames;
+  }
+
+  for (auto _ : state)
+  {
+    processor.process(
+        impl,
+        avnd::span<FP*>{in.data(), in.size()},
+        avnd::span<FP*>{out.data(), out.size()},
+        frames);
+    benchmark::DoNotOptimize(output.data());
+    benchmark::ClobberMemory();
+  }
+
+  // Inverted rate: time per sample, e.g. "2.5n" means 2.5 ns per sample
+  state.counters["per_sample"] = benchmark::Counter(
+      double(frames) * channels,
+      benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+template <typename T>
+static void register_adapter(
+    const std::string& name, std::vector<int64_t> channels = {1, 2, 8, 64})
+{
+  const std::vector<int64_t> frames{1, 4, 16, 64, 256, 1024, 4096};
+
+  benchmark::RegisterBenchmark(
+      (name + "<float>").c_str(), process_adapter_benchmark<T, float>)
+      ->ArgNames({"frames", "channels"})
+      ->ArgsProduct({frames, channels});
+  benchmark::RegisterBenchmark(
+      (name + "<double>").c_str(), process_adapter_benchmark<T, double>)
+      ->ArgNames({"frames", "channels"})
+      ->ArgsProduct({frames, channels});
+}
+
+int main(int argc, char** argv)
+{
+  // per_sample_arg
+  register_adapter<examples::helpers::PerSampleAsArgs>("per_sample_arg/PerSampleAsArgs");
+  register_adapter<examples::PerSampleProcessor>("per_sample_arg/PerSampleProcessor");
+
+  // per_sample_port
+  register_adapter<examples::helpers::PerSampleAsPorts>(
+      "per_sample_port/PerSampleAsPorts");
+  register_adapter<examples::PerSampleProcessor2>("per_sample_port/PerSampleProcessor2");
+  register_adapter<examples::helpers::PerSampleLowpass>(
+      "per_sample_port/PerSampleLowpass");
+
+  // per_channel_arg, per_channel_port
+  register_adapter<PerChannelAsArgs>("per_channel_arg/PerChannelAsArgs");
+  register_adapter<PerChannelAsPorts>("per_channel_port/PerChannelAsPorts");
+
+  // poly_arg
+  // Its channel count is fixed
+  register_adapter<examples::helpers::PerBusAsArgs>("poly_arg/PerBusAsArgs", {2});
+
+  // poly_port
+  register_adapter<examples::Lowpass>("poly_port/Lowpass");
+  register_adapter<examples::helpers::Lowpass>("poly_port/HelpersLowpass");
+  register_adapter<examples::Distortion>("poly_port/Distortion");
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
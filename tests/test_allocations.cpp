@@ -0,0 +1,288 @@
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/process_adapter.hpp>
+#include <examples/Helpers/Lowpass.hpp>
+#include <examples/Helpers/Noise.hpp>
+#include <examples/Helpers/Peak.hpp>
+#include <examples/Helpers/PerBus.hpp>
+#include <examples/Helpers/PerSample.hpp>
+#include <examples/Helpers/SmoothedGain.hpp>
+#include <examples/Raw/Addition.hpp>
+#include <examples/Raw/Lowpass.hpp>
+#include <examples/Raw/Minimal.hpp>
+#include <examples/Raw/PerSampleProcessor.hpp>
+#include <examples/Raw/PerSampleProcessor2.hpp>
+#include <examples/Raw/Presets.hpp>
+#include <halp/midi.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <memory>
+#include <new>
+
+// Counts the allocations done while processing:
+// the audio thread should never allocate once the buffers are set-up.
+static bool g_counting = false;
+static int g_allocations = 0;
+
+void* operator new(std::size_t sz)
+{
+  if (g_counting)
+    g_allocations++;
+  if (void* ptr = std::malloc(sz ? sz : 1))
+    return ptr;
+  throw std::bad_alloc{};
+}
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+// No example processes a single channel given as arguments
+struct MonoGain
+{
+  static consteval auto name() { return "Mono gain"; }
+
+  void operator()(float* in, float* out, int n)
+  {
+    for (int i = 0; i < n; i++)
+      out[i] = 0.5f * in[i];
+  }
+
+  void operator()(double* in, double* out, int n)
+  {
+    for (int i = 0; i < n; i++)
+      out[i] = 0.5 * in[i];
+  }
+};
+
+// The channels the host gives to the processor
+struct channels
+{
+  int inputs{};
+  int outputs{};
+};
+
+// What a binding does: setup once, then process the blocks.
+// The setup is done again on each change of channels, which may allocate.
+template <typename T, typename FP>
+struct host
+{
+  static constexpr int frames = 64;
+
+  avnd::effect_container<T> impl;
+  avnd::process_adapter<T> processor;
+
+  FP buffer[8][frames]{};
+  FP* in[8]{};
+  FP* out[8]{};
+  channels current{};
+
+  void setup(channels c, int max_channels = 0)
+  {
+    const avnd::process_setup setup = avnd::with_max_channels<T>({
+        .input_channels = c.inputs,
+        .output_channels = c.outputs,
+        .frames_per_buffer = frames,
+        .rate = 48000.,
+        .max_input_channels = c.inputs ? max_channels : 0,
+        .max_output_channels = c.outputs ? max_channels : 0});
+    processor.allocate_buffers(setup, FP{});
+    avnd::reserve_channels(impl, setup.max_input_channels, setup.max_output_channels);
+    impl.init_channels(c.inputs, c.outputs);
+    avnd::prepare(impl, setup);
+
+    for (int i = 0; i < 8; i++)
+      in[i] = out[i] = buffer[i];
+    current = c;
+  }
+
+  // The allocations of the given number of process() calls
+  int process(int blocks)
+  {
+    g_allocations = 0;
+    g_counting = true;
+    for (int i = 0; i < blocks; i++)
+    {
+      processor.process(
+          impl,
+          avnd::span<FP*>{in, std::size_t(current.inputs)},
+          avnd::span<FP*>{out, std::size_t(current.outputs)},
+          frames);
+    }
+    g_counting = false;
+    return g_allocations;
+  }
+};
+
+// Each layout is set-up after the previous one has been running,
+// as when the host changes the channels of a running plug-in
+template <typename T, typename FP>
+bool check_layouts(const char* name, std::initializer_list<channels> layouts)
+{
+  bool ok = true;
+  auto h = std::make_unique<host<T, FP>>();
+  for (channels c : layouts)
+  {
+    h->setup(c);
+    if (const int n = h->process(1000); n != 0)
+    {
+      std::fprintf(
+          stderr, "%s (%s): %d allocations with %d -> %d channels\n", name,
+          sizeof(FP) == 4 ? "float" : "double", n, c.inputs, c.outputs);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+template <typename T>
+bool check(const char* name, std::initializer_list<channels> layouts)
+{
+  bool ok = true;
+  ok &= check_layouts<T, float>(name, layouts);
+  ok &= check_layouts<T, double>(name, layouts);
+  return ok;
+}
+
+// The channels grow then shrink
+template <typename T>
+bool check(const char* name)
+{
+  return check<T>(name, {{1, 1}, {2, 2}, {8, 8}, {2, 2}, {1, 1}});
+}
+
+// Once set-up for the most channels, the host changes them without reallocating
+// the buffers nor the instances of a duplicated processor
+template <typename T>
+bool check_reserved(const char* name, std::initializer_list<channels> layouts)
+{
+  bool ok = true;
+  auto h = std::make_unique<host<T, float>>();
+  h->setup(*layouts.begin(), 8);
+  for (channels c : layouts)
+  {
+    g_allocations = 0;
+    g_counting = true;
+    h->processor.allocate_buffers(
+        {.input_channels = c.inputs,
+         .output_channels = c.outputs,
+         .frames_per_buffer = h->frames,
+         .rate = 48000.},
+        float{});
+    h->impl.init_channels(c.inputs, c.outputs);
+    g_counting = false;
+    h->current = c;
+
+    const int n = g_allocations + h->process(1000);
+    if (n != 0)
+    {
+      std::fprintf(
+          stderr, "%s: %d allocations when changing to %d -> %d of 8 channels\n", name, n,
+          c.inputs, c.outputs);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// Dense MIDI input must neither allocate nor grow past the bus capacity
+bool check_midi_bus()
+{
+  auto bus = std::make_unique<halp::midi_bus<"In", 64>>();
+
+  g_allocations = 0;
+  g_counting = true;
+  for (int block = 0; block < 4; block++)
+  {
+    bus->midi_messages.clear();
+    for (int i = 0; i < 100; i++)
+      bus->midi_messages.push_back(
+          {.bytes = {0xB0, uint8_t(i), 64}, .timestamp = i});
+  }
+  g_counting = false;
+
+  const bool ok = g_allocations == 0 && bus->size() == 64 && bus->overflows() == 4 * 36
+                  && bus->back().timestamp == 63;
+  if (!ok)
+    std::fprintf(
+        stderr, "midi_bus: %d allocations, %d messages, %d dropped\n", g_allocations,
+        int(bus->size()), int(bus->overflows()));
+  return ok;
+}
+
+// Same with compact events, the system exclusive messages going to the arena of the bus
+bool check_midi_event_bus()
+{
+  auto bus = std::make_unique<halp::midi_event_bus<"In", 64, 256, 4>>();
+  const uint8_t sysex[100]{0xF0, 0x7E, 0x7F, 0x06, 0x01, 0xF7};
+
+  g_allocations = 0;
+  g_counting = true;
+  for (int block = 0; block < 4; block++)
+  {
+    bus->midi_messages.clear();
+    bus->sysex.clear();
+    for (int i = 0; i < 100; i++)
+      bus->push_back({.bytes = {0x90, uint8_t(i), 100}, .timestamp = i});
+    for (int i = 0; i < 3; i++)
+      bus->sysex.push(sysex, sizeof(sysex), i);
+  }
+  g_counting = false;
+
+  const bool ok = g_allocations == 0 && bus->size() == 64 && bus->back().timestamp == 63
+                  && bus->sysex.size() == 2 && bus->sysex[1].bytes.size() == 100
+                  && bus->sysex[1].bytes[1] == 0x7E && bus->overflows() == 4 * 36 + 4;
+  if (!ok)
+    std::fprintf(
+        stderr, "midi_event_bus: %d allocations, %d messages, %d sysex, %d dropped\n",
+        g_allocations, int(bus->size()), int(bus->sysex.size()), int(bus->overflows()));
+  return ok;
+}
+
+int main()
+{
+  bool ok = true;
+
+  // No audio: only invoked once per block
+  ok &= check<examples::Addition>("Addition");
+
+  // One instance per channel, called per sample
+  ok &= check<examples::PerSampleProcessor>("PerSampleProcessor");
+  ok &= check<examples::helpers::PerSampleAsArgs>("PerSampleAsArgs");
+  ok &= check<examples::PerSampleProcessor2>("PerSampleProcessor2");
+  ok &= check<examples::helpers::PerSampleAsPorts>("PerSampleAsPorts");
+  ok &= check<examples::helpers::WhiteNoise>("WhiteNoise", {{0, 1}, {0, 2}, {0, 8}, {0, 1}});
+
+  // One instance per channel, called per block
+  ok &= check<MonoGain>("MonoGain");
+  ok &= check<examples::helpers::Peak>("Peak", {{1, 0}, {2, 0}, {8, 0}, {1, 0}});
+
+  // All the channels at once, as arguments then as ports.
+  // The processors with fixed channels only get these
+  ok &= check<examples::Presets>("Presets", {{2, 2}});
+  ok &= check<examples::helpers::PerBusAsArgs>("PerBusAsArgs", {{2, 2}});
+  ok &= check<examples::Minimal>("Minimal");
+  ok &= check<examples::helpers::Lowpass>("helpers::Lowpass");
+  ok &= check<examples::helpers::SmoothedGain>("SmoothedGain");
+  ok &= check<examples::helpers::PerBusAsPortsFixed>("PerBusAsPortsFixed", {{4, 2}});
+
+  // Goes through the float -> double conversion buffers
+  ok &= check<examples::Lowpass>("Lowpass");
+
+  // Channel changes up to the declared maximum
+  ok &= check_reserved<examples::PerSampleProcessor>(
+      "PerSampleProcessor", {{2, 2}, {8, 8}, {1, 1}, {4, 4}});
+  ok &= check_reserved<examples::helpers::PerSampleAsPorts>(
+      "PerSampleAsPorts", {{2, 2}, {8, 8}, {1, 1}, {4, 4}});
+  ok &= check_reserved<MonoGain>("MonoGain", {{2, 2}, {8, 8}, {1, 1}, {4, 4}});
+  ok &= check_reserved<examples::Minimal>("Minimal", {{2, 2}, {8, 8}, {1, 1}, {4, 4}});
+
+  ok &= check_midi_bus();
+  ok &= check_midi_event_bus();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+#include <avnd/binding/example/batch.hpp>
+#include <examples/Tutorial/Distortion.hpp>
+
+#include <cstdio>
+
+// Checks the combinations of a batch, and that its results do not depend on the threads
+int main()
+{
+  const char* args[]{"host", "--batch", "--grid=Gain:0:100:5", "--grid=Foo:1:2:2"};
+  auto opts = exhs::parse_batch_options(4, const_cast<char**>(args));
+  auto combinations = exhs::batch_combinations(*opts);
+  bool grid = combinations.size() == 10 && combinations[0] == std::vector<double>{0., 1.}
+              && combinations[1] == std::vector<double>{0., 2.}
+              && combinations[9] == std::vector<double>{100., 2.};
+
+  const char* bad[]{"host", "--batch", "--grid=Gain:0"};
+  grid &= !exhs::parse_batch_options(3, const_cast<char**>(bad));
+  std::printf("grid: %s\n", grid ? "ok" : "FAILED");
+
+  opts->random = 8;
+  opts->seed = 42;
+  auto a = exhs::batch_combinations(*opts);
+  bool random = a.size() == 8 && a == exhs::batch_combinations(*opts);
+  for (auto& v : a)
+    random &= v[0] >= 0. && v[0] <= 100. && v[1] >= 1. && v[1] <= 2.;
+  opts->seed = 43;
+  random &= a != exhs::batch_combinations(*opts);
+  std::printf("random: %s\n", random ? "ok" : "FAILED");
+
+  using fx = examples::Distortion;
+  exhs::batch_options render;
+  render.parameters.push_back({"Gain", 0., 100., 6});
+  render.duration = 0.1;
+  render.block_size = 64;
+  auto indices = std::vector<int>{exhs::batch_parameter_index<fx>("Gain")};
+  auto input = exhs::load_batch_input(render);
+  auto runs = exhs::batch_combinations(render);
+
+  render.threads = 1;
+  auto one = exhs::render_batch<fx>(render, *input, indices, runs);
+  render.threads = 4;
+  auto four = exhs::render_batch<fx>(render, *input, indices, runs);
+
+  bool deterministic = indices[0] >= 0 && exhs::batch_parameter_index<fx>("Nope") < 0
+                       && one.size() == 6 && four.size() == 6;
+  for (std::size_t i = 0; deterministic && i < one.size(); i++)
+    deterministic &= one[i].hash == four[i].hash && one[i].rms == four[i].rms;
+  // More gain, more distortion
+  deterministic &= one[0].rms < one[1].rms && one[1].rms < one[5].rms;
+  std::printf("deterministic: %s\n", deterministic ? "ok" : "FAILED");
+
+  return grid && random && deterministic ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include <halp/block_coroutine.hpp>
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+// Checks where a halp::block_script resumes its coroutine across buffers
+static constexpr int frames = 64;
+
+struct Script
+{
+  halp::block_script script{1024};
+  std::vector<std::pair<int, int>> resumed; // buffer, offset
+  bool ready{};
+  int block{};
+
+  void mark() { resumed.push_back({block, script.offset()}); }
+
+  halp::block_task run()
+  {
+    mark();
+    co_await script.samples(100);
+    mark();
+    co_await script.samples(10);
+    mark();
+    co_await script.next_block();
+    mark();
+    co_await script.until([this] { return ready; });
+    mark();
+  }
+};
+
+int main()
+{
+  Script s;
+  bool ok = s.script.start([&] { return s.run(); });
+
+  std::vector<std::pair<int, int>> parts;
+  for (s.block = 0; s.block < 6; s.block++)
+  {
+    if (s.block == 4)
+      s.ready = true;
+    s.script(frames, [&](int first, int n) { parts.push_back({first, n}); });
+  }
+
+  const std::vector<std::pair<int, int>> expected{{0, 0}, {1, 36}, {1, 46}, {2, 0}, {4, 0}};
+  ok &= s.resumed == expected && !s.script.running();
+  std::printf("resumed where awaited: %s\n", ok ? "ok" : "FAILED");
+
+  // The buffer 1 is rendered in three parts, around the two resumptions
+  const bool split = parts.size() == 8 && parts[1] == std::pair{0, 36}
+                     && parts[2] == std::pair{36, 10} && parts[3] == std::pair{46, 18};
+  std::printf("rendered between the resumptions: %s\n", split ? "ok" : "FAILED");
+
+  // A frame which does not fit in the storage is not created
+  struct Large
+  {
+    halp::block_script script{16};
+    halp::block_task run()
+    {
+      volatile char buffer[256]{};
+      co_await script.next_block();
+      (void)buffer[0];
+    }
+  } large;
+  const bool refused = !large.script.start([&] { return large.run(); });
+  std::printf("too large a frame refused: %s\n", refused ? "ok" : "FAILED");
+
+  return ok && split && refused ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#include <avnd/wrappers/bypass.hpp>
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <halp/audio.hpp>
+#include <halp/meta.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Checks that bypassing a processor with latency keeps the output aligned:
+// a pure delay gives the same output, bypassed or not, and while switching
+static constexpr int latency = 100;
+static constexpr int frames = 64;
+static constexpr int blocks = 40;
+static constexpr int channels = 2;
+
+struct Delay
+{
+  halp_meta(name, "Delay")
+  halp_meta(latency_samples, latency)
+
+  struct
+  {
+    halp::dynamic_audio_bus<"In", float> audio;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Out", float> audio;
+  } outputs;
+
+  void prepare(halp::setup info)
+  {
+    lines.assign(info.input_channels, std::vector<float>(latency, 0.f));
+  }
+
+  void operator()(int n)
+  {
+    calls++;
+    for (int c = 0; c < inputs.audio.channels; c++)
+    {
+      auto& line = lines[c];
+      int pos = position;
+      for (int i = 0; i < n; i++)
+      {
+        const float x = inputs.audio[c][i];
+        outputs.audio[c][i] = line[pos];
+        line[pos] = x;
+        pos = (pos + 1) % latency;
+      }
+    }
+    position = (position + n) % latency;
+  }
+
+  std::vector<std::vector<float>> lines;
+  int position{};
+  int calls{};
+};
+
+static float input(int channel, int frame)
+{
+  return 0.5f * std::sin(0.01f * (channel + 1) * frame);
+}
+
+int main()
+{
+  avnd::effect_container<Delay> impl;
+  avnd::bypass_adapter<Delay> processor;
+
+  const avnd::process_setup setup{
+      .input_channels = channels,
+      .output_channels = channels,
+      .frames_per_buffer = frames,
+      .rate = 48000.};
+  processor.allocate_buffers(setup, float{});
+  impl.init_channels(channels, channels);
+  avnd::prepare(impl, setup);
+  processor.reserve_delay(avnd::latency_samples(impl));
+
+  std::vector<float> storage(std::size_t(channels) * frames);
+  float* buffers[channels];
+  for (int c = 0; c < channels; c++)
+    buffers[c] = storage.data() + c * frames;
+
+  bool ok = true;
+  int bypassed_calls = 0;
+  for (int b = 0; b < blocks; b++)
+  {
+    // Bypassed for a while, then back, the crossfades lasting several buffers
+    processor.set_bypass(b >= 10 && b < 25);
+
+    // In place, as most hosts do
+    for (int c = 0; c < channels; c++)
+      for (int i = 0; i < frames; i++)
+        buffers[c][i] = input(c, b * frames + i);
+
+    const int calls = impl.effect.calls;
+    processor.process(
+        impl, avnd::span<float*>{buffers, channels}, avnd::span<float*>{buffers, channels},
+        frames);
+    if (b >= 20 && b < 25)
+      bypassed_calls += impl.effect.calls - calls;
+
+    // The processor resumes from the state it had when bypassed:
+    // the first latency frames it gives then are stale
+    if (b >= 25 && b * frames < 25 * frames + latency)
+      continue;
+
+    for (int c = 0; c < channels; c++)
+      for (int i = 0; i < frames; i++)
+      {
+        const int t = b * frames + i - latency;
+        const float expected = t >= 0 ? input(c, t) : 0.f;
+        ok &= std::abs(buffers[c][i] - expected) <= 1e-6f;
+      }
+  }
+
+  std::printf("aligned output: %s\n", ok ? "ok" : "FAILED");
+  std::printf("processor skipped while bypassed: %s\n", bypassed_calls == 0 ? "ok" : "FAILED");
+  return ok && bypassed_calls == 0 ? 0 : 1;
+}
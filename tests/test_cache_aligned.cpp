@@ -0,0 +1,140 @@
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/process_adapter.hpp>
+#include <examples/Helpers/PerSample.hpp>
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Checks that the instances of duplicated processors which ask for it are
+// each on their own cache lines, and still process the same
+template <bool Aligned>
+struct Shared
+{
+  halp_meta(name, "Shared")
+  static constexpr bool cache_aligned = Aligned;
+
+  struct inputs
+  {
+    halp::audio_sample<"In", float> audio;
+    halp::hslider_f32<"Gain", halp::range{.min = 0., .max = 2., .init = 0.5}> gain;
+    halp::lineedit<"Preset", "default"> preset;
+  };
+
+  struct outputs
+  {
+    halp::audio_sample<"Out", float> audio;
+  };
+
+  void operator()(const inputs& ins, outputs& outs)
+  {
+    state = ins.gain * ins.audio + 0.5f * state;
+    outs.audio = state;
+  }
+
+  float state{};
+};
+
+template <bool Aligned>
+struct Owned
+{
+  halp_meta(name, "Owned")
+  static constexpr bool cache_aligned = Aligned;
+
+  struct
+  {
+    halp::hslider_f32<"Gain", halp::range{.min = 0., .max = 2., .init = 0.5}> gain;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  float operator()(float in)
+  {
+    state = inputs.gain * in + 0.5f * state;
+    return state;
+  }
+
+  float state{};
+};
+
+static_assert(avnd::cache_aligned_processor<Shared<true>>);
+static_assert(!avnd::cache_aligned_processor<Shared<false>>);
+static_assert(alignof(avnd::instance_storage<Owned<true>>) == 64);
+static_assert(std::is_same_v<avnd::instance_storage<Owned<false>>, Owned<false>>);
+
+static bool on_line(const void* p)
+{
+  return reinterpret_cast<std::uintptr_t>(p) % 64 == 0;
+}
+
+template <typename T>
+static std::vector<float> run(avnd::effect_container<T>& impl, int channels)
+{
+  constexpr int frames = 64;
+  const avnd::process_setup setup{
+      .input_channels = channels,
+      .output_channels = channels,
+      .frames_per_buffer = frames,
+      .rate = 48000.};
+  avnd::process_adapter<T> processor;
+  avnd::init_controls(impl.inputs());
+  processor.allocate_buffers(setup, float{});
+  impl.init_channels(channels, channels);
+  avnd::prepare(impl, setup);
+
+  std::vector<std::vector<float>> in(channels, std::vector<float>(frames));
+  std::vector<std::vector<float>> out(channels, std::vector<float>(frames));
+  std::vector<float*> ins, outs;
+  for (int c = 0; c < channels; c++)
+  {
+    for (int i = 0; i < frames; i++)
+      in[c][i] = std::sin(0.1f * (c + 1) * i);
+    ins.push_back(in[c].data());
+    outs.push_back(out[c].data());
+  }
+  processor.process(
+      impl, avnd::span<float*>{ins.data(), std::size_t(channels)},
+      avnd::span<float*>{outs.data(), std::size_t(channels)}, frames);
+
+  std::vector<float> res;
+  for (auto& o : out)
+    res.insert(res.end(), o.begin(), o.end());
+  return res;
+}
+
+template <template <bool> typename P>
+static bool check(const char* name)
+{
+  avnd::effect_container<P<true>> aligned;
+  avnd::effect_container<P<false>> packed;
+  bool ok = run(aligned, 3) == run(packed, 3);
+
+  // Each instance starts a line, and so do the shared inputs
+  for (auto& e : aligned.effects())
+    ok &= on_line(&e);
+  if constexpr (avnd::inputs_is_type<P<true>>)
+    ok &= on_line(&aligned.inputs_storage);
+
+  std::printf("%s: %s\n", name, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main()
+{
+  const bool shared = check<Shared>("shared inputs");
+  const bool owned = check<Owned>("owned inputs");
+
+  avnd::effect_container<examples::helpers::PerSampleAsPorts> ports;
+  ports.init_channels(2, 2);
+  const bool example = on_line(&*ports.effects().begin()) && on_line(&ports.inputs_storage);
+  std::printf("example: %s\n", example ? "ok" : "FAILED");
+
+  return shared && owned && example ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include <avnd/wrappers/callbacks_adapter.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <halp/callback.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Checks that avnd::deferred_callbacks only calls the host from deliver(),
+// in the order of the calls and with their frame, except for the callbacks
+// which cannot be queued
+struct Notifier
+{
+  halp_meta(name, "Notifier")
+
+  struct
+  {
+    struct
+    {
+      halp_meta(name, "a")
+      float value;
+    } a;
+  } inputs;
+
+  struct
+  {
+    struct
+    {
+      halp_meta(name, "onset")
+      halp::basic_callback<void(float)> call;
+    } onset;
+
+    struct
+    {
+      halp_meta(name, "pair")
+      std::function<void(int, double)> call;
+    } pair;
+
+    struct
+    {
+      halp_meta(name, "text")
+      std::function<void(std::string)> call;
+    } text;
+  } outputs;
+
+  void operator()(int frames)
+  {
+    outputs.onset.call(float(frames));
+    outputs.pair.call(frames, 0.5);
+    outputs.text.call("direct");
+  }
+};
+
+static_assert(avnd::deferrable_callback<decltype(Notifier{}.outputs.onset)>);
+static_assert(avnd::deferrable_callback<decltype(Notifier{}.outputs.pair)>);
+static_assert(!avnd::deferrable_callback<decltype(Notifier{}.outputs.text)>);
+
+struct call
+{
+  std::string name;
+  std::vector<double> args;
+};
+
+int main()
+{
+  avnd::effect_container<Notifier> impl;
+  avnd::deferred_callbacks<Notifier> callbacks;
+  std::vector<call> log;
+
+  callbacks.wrap_callbacks(
+      impl, [&]<typename Refl, template <typename...> typename L, typename... Args,
+                std::size_t Idx>(std::string_view name, L<Args...>, Refl, avnd::num<Idx>) {
+        return [&log, name](auto&&... args) {
+          call c{std::string(name), {}};
+          auto add = [&](const auto& v) {
+            if constexpr (std::is_arithmetic_v<std::decay_t<decltype(v)>>)
+              c.args.push_back(double(v));
+          };
+          (add(args), ...);
+          log.push_back(c);
+        };
+      });
+
+  bool ok = true;
+  impl.effect(64);
+  callbacks.advance(64);
+  impl.effect(32);
+  callbacks.advance(32);
+
+  // Only the one with a string went to the host during the processing
+  ok &= log.size() == 2 && log[0].name == "text" && log[1].name == "text";
+  std::printf("nothing deferred while processing: %s\n", ok ? "ok" : "FAILED");
+
+  log.clear();
+  callbacks.deliver();
+  const std::vector<call> expected{
+      {"onset", {0., 64.}},
+      {"pair", {0., 64., 0.5}},
+      {"onset", {64., 32.}},
+      {"pair", {64., 32., 0.5}}};
+  bool delivered = log.size() == expected.size();
+  for (std::size_t i = 0; delivered && i < log.size(); i++)
+    delivered &= log[i].name == expected[i].name && log[i].args == expected[i].args;
+  std::printf("delivered in order with their frame: %s\n", delivered ? "ok" : "FAILED");
+
+  log.clear();
+  callbacks.deliver();
+  const bool once = log.empty() && callbacks.dropped() == 0;
+  std::printf("delivered once: %s\n", once ? "ok" : "FAILED");
+
+  return ok && delivered && once ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#include <examples/Ports/Essentia/pipeline.hpp>
+#include <examples/Ports/Essentia/standard/Spectrum.hpp>
+#include <examples/Ports/Essentia/standard/Windowing.hpp>
+#include <examples/Ports/Essentia/stats/Entropy.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+// Checks that essentia_ports::pipeline runs its stages in a shared arena
+// and gives the same results as the stages run one by one on their own arrays
+using namespace essentia_ports;
+
+// Each buffer is reused once the stage after the one which wrote it is done
+static_assert(pipeline_detail::arena_layout<1, 1, 0>().slots == 2);
+static_assert(pipeline_detail::arena_layout<1, 1, 1, 1>().slots == 2);
+static_assert(pipeline_detail::arena_layout<2, 1, 2>().slots == 3);
+
+int main()
+{
+  constexpr std::size_t N = 256;
+  std::vector<Real> frame(N);
+  for (std::size_t i = 0; i < N; i++)
+    frame[i] = std::sin(0.3 * i) + 0.5 * std::sin(1.7 * i);
+
+  // Reference: each stage on its own buffers
+  Windowing w;
+  Spectrum sp;
+  Entropy e;
+  std::vector<Real> windowed(N), spectrum(N / 2 + 1);
+  w.inputs.frame.channel = frame.data();
+  w.outputs.frame.channel = windowed.data();
+  sp.inputs.frame.channel = windowed.data();
+  sp.outputs.spectrum.channel = spectrum.data();
+  e.inputs.array.channel = spectrum.data();
+  w.reset_frames(N);
+  sp.reset_frames(N);
+  bool ok = !w(N) && !sp(N) && !e(spectrum.size());
+
+  pipeline<Windowing, Spectrum, Entropy> analysis;
+  analysis.prepare(N);
+  for (int hop = 0; hop < 2; hop++)
+    ok &= !analysis(frame.data(), N);
+
+  ok &= analysis.stage<2>().outputs.entropy.value == e.outputs.entropy.value;
+  const Real* bins = analysis.stage<1>().outputs.spectrum.channel;
+  for (std::size_t i = 0; i < spectrum.size(); i++)
+    ok &= bins[i] == spectrum[i];
+
+  // Windowing and Spectrum write in two buffers, which the next hops reuse
+  ok &= analysis.stage<0>().outputs.frame.channel != bins;
+  ok &= analysis.stage<0>().inputs.frame.channel == frame.data();
+
+  // The errors of the stages stop the frame
+  const auto err = analysis(frame.data(), N - 1);
+  ok &= err && std::string_view{*err}.starts_with("Spectrum");
+  ok &= bool(analysis(frame.data(), 2 * N));
+
+  std::printf("essentia pipeline: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
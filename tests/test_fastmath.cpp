@@ -0,0 +1,118 @@
+#include <halp/fastmath.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Checks the errors of halp::fastmath against libm over the ranges used in audio
+namespace fm = halp::fastmath;
+
+static_assert(fm::exp2(3.) == 8.);
+static_assert(fm::exp2(-2.f) == 0.25f);
+static_assert(fm::tanh(0.) == 0.);
+static_assert(fm::log2<fm::accuracy::low>(0.5) == -1.);
+static_assert(fm::sin(0.f) == 0.f);
+
+struct range
+{
+  double min, max;
+};
+
+// Largest error over a sweep of [r.min; r.max], relative to the reference when relative is set
+template <typename FP, typename F, typename R>
+double max_error(F approx, R reference, range r, bool relative)
+{
+  constexpr int points = 200000;
+  double worst = 0.;
+  for (int i = 0; i <= points; i++)
+  {
+    const FP x = FP(r.min + (r.max - r.min) * i / points);
+    const double expected = reference(double(x));
+    double err = std::abs(double(approx(x)) - expected);
+    if (relative)
+      err /= std::abs(expected);
+    worst = std::max(worst, err);
+  }
+  return worst;
+}
+
+template <typename FP>
+bool check(const char* func, const char* type, fm::accuracy a, double err, double bound)
+{
+  static constexpr const char* names[] = {"low", "medium", "high"};
+  const bool ok = err <= bound;
+  std::printf(
+      "%s %s<%s>: %.3g (bound %.3g)%s\n", names[int(a)], func, type, err, bound,
+      ok ? "" : " FAILED");
+  return ok;
+}
+
+template <fm::accuracy A, typename FP>
+bool check_tier(const char* type, double exp2_bound, double log2_bound, double sin_bound, double tanh_bound)
+{
+  // float has 24 bits of mantissa, i.e. rounds the results at about 6e-8
+  const double rounding = std::is_same_v<FP, float> ? 4e-7 : 1e-15;
+
+  bool ok = true;
+  ok &= check<FP>(
+      "exp2", type, A,
+      max_error<FP>([](FP x) { return fm::exp2<A>(x); }, [](double x) { return std::exp2(x); },
+                    {-20., 20.}, true),
+      exp2_bound + rounding);
+  ok &= check<FP>(
+      "log2", type, A,
+      max_error<FP>([](FP x) { return fm::log2<A>(x); }, [](double x) { return std::log2(x); },
+                    {1e-4, 100.}, false),
+      log2_bound + 8 * rounding);
+  ok &= check<FP>(
+      "sin", type, A,
+      max_error<FP>([](FP x) { return fm::sin<A>(x); }, [](double x) { return std::sin(x); },
+                    {-10., 10.}, false),
+      sin_bound + 4 * rounding);
+  ok &= check<FP>(
+      "tanh", type, A,
+      max_error<FP>([](FP x) { return fm::tanh<A>(x); }, [](double x) { return std::tanh(x); },
+                    {-10., 10.}, false),
+      tanh_bound + rounding);
+  return ok;
+}
+
+// The batches must give the same results as the scalar functions
+template <typename FP>
+bool check_batch()
+{
+  std::vector<FP> in(1000), out(1000), inplace(1000);
+  for (std::size_t i = 0; i < in.size(); i++)
+    in[i] = inplace[i] = FP(0.01) * FP(i) + FP(0.001);
+
+  fm::tanh<fm::accuracy::low>(avnd::span<const FP>(in.data(), in.size()), avnd::span<FP>(out));
+  fm::tanh<fm::accuracy::low>(avnd::span<FP>(inplace));
+  for (std::size_t i = 0; i < in.size(); i++)
+    if (out[i] != fm::tanh<fm::accuracy::low>(in[i]) || inplace[i] != out[i])
+      return false;
+
+  fm::log2(in.data(), out.data(), int(in.size()));
+  for (std::size_t i = 0; i < in.size(); i++)
+    if (out[i] != fm::log2(in[i]))
+      return false;
+  return true;
+}
+
+int main()
+{
+  using enum fm::accuracy;
+  bool ok = true;
+  ok &= check_tier<low, double>("double", 9e-5, 6e-6, 7e-5, 5e-5);
+  ok &= check_tier<medium, double>("double", 9e-8, 3e-8, 6e-7, 5e-8);
+  ok &= check_tier<high, double>("double", 5e-11, 2e-10, 4e-9, 3e-11);
+  ok &= check_tier<low, float>("float", 9e-5, 6e-6, 7e-5, 5e-5);
+  ok &= check_tier<medium, float>("float", 9e-8, 3e-8, 6e-7, 5e-8);
+  ok &= check_tier<high, float>("float", 5e-11, 2e-10, 4e-9, 3e-11);
+
+  if (!check_batch<float>() || !check_batch<double>())
+  {
+    std::printf("the batches differ from the scalar functions\n");
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#include <halp/fft.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <initializer_list>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+// Compares halp::fft to a naive DFT, computed in double precision
+static std::vector<std::complex<double>> naive_dft(const std::vector<double>& x)
+{
+  static constexpr double pi = 3.141592653589793238462643383279502884;
+  const std::size_t N = x.size();
+  std::vector<std::complex<double>> res(N);
+  for (std::size_t k = 0; k < N; k++)
+    for (std::size_t n = 0; n < N; n++)
+      res[k] += x[n] * std::polar(1., -2. * pi * double((k * n) % N) / double(N));
+  return res;
+}
+
+// fft is planned for N by its first execute() if needed
+template <typename FP>
+static bool check(halp::fft<FP>& fft, std::size_t N, std::mt19937& rng)
+{
+  // Relative to the largest value of the result
+  const double tolerance = std::is_same_v<FP, float> ? 1e-5 : 1e-12;
+  std::uniform_real_distribution<double> dist(-1., 1.);
+
+  std::vector<double> signal(N);
+  for (auto& s : signal)
+    s = dist(rng);
+  const auto spectrum = naive_dft(signal);
+
+  double scale = 1e-30;
+  for (auto& bin : spectrum)
+    scale = std::max(scale, std::abs(bin));
+
+  // Forward: all the N bins
+  std::vector<FP> in(signal.begin(), signal.end());
+  const std::complex<FP>* bins = fft.execute(in.data(), N);
+  double forward = 0.;
+  for (std::size_t k = 0; k < N; k++)
+    forward = std::max(
+        forward, std::abs(std::complex<double>(bins[k]) - spectrum[k]) / scale);
+
+  // Inverse: only the bins [0; N/2] are read, the others are garbage here
+  std::vector<std::complex<FP>> half(N);
+  for (std::size_t k = 0; k < N; k++)
+    half[k] = k <= N / 2 ? std::complex<FP>(spectrum[k]) : std::complex<FP>(1e6, -1e6);
+  const FP* samples = fft.execute(half.data(), N);
+  double inverse = 0.;
+  for (std::size_t n = 0; n < N; n++)
+    inverse = std::max(inverse, std::abs(samples[n] * fft.normalization(N) - signal[n]));
+
+  // Round trip through the buffer returned by the forward transform
+  double round_trip = 0.;
+  samples = fft.execute(fft.execute(in.data(), N), N);
+  for (std::size_t n = 0; n < N; n++)
+    round_trip
+        = std::max(round_trip, std::abs(samples[n] * fft.normalization(N) - signal[n]));
+
+  const bool ok = forward < tolerance && inverse < tolerance && round_trip < tolerance;
+  if (!ok)
+    std::printf(
+        "N = %zu (%s): forward %g, inverse %g, round trip %g\n", N,
+        std::is_same_v<FP, float> ? "float" : "double", forward, inverse, round_trip);
+  return ok;
+}
+
+int main()
+{
+  std::mt19937 rng{1234};
+
+  auto sizes = [&rng](std::initializer_list<std::size_t> sizes) {
+    bool ok = true;
+    for (std::size_t N : sizes)
+    {
+      halp::fft<float> f;
+      halp::fft<double> d;
+      f.reset(N);
+      d.reset(N);
+      ok &= check(f, N, rng) && check(d, N, rng);
+    }
+    return ok;
+  };
+
+  const bool small = sizes({1, 2, 4, 8});
+  std::printf("small sizes: %s\n", small ? "ok" : "FAILED");
+
+  const bool large = sizes({16, 32, 64, 128, 256, 512, 1024});
+  std::printf("large sizes: %s\n", large ? "ok" : "FAILED");
+
+  // The same object used with several sizes in turn is planned again for each
+  bool resize = true;
+  halp::fft<float> fft;
+  for (std::size_t N : {64, 4, 1024, 1, 2, 64})
+    resize &= check(fft, N, rng);
+  std::printf("resize: %s\n", resize ? "ok" : "FAILED");
+
+  return small && large && resize ? 0 : 1;
+}
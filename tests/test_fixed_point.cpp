@@ -0,0 +1,202 @@
+#include <avnd/binding/freestanding/processor.hpp>
+#include <halp/audio.hpp>
+#include <halp/fixed_point.hpp>
+#include <halp/meta.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+static_assert(avnd::fixed_point_sample<halp::q15>);
+static_assert(avnd::fixed_point_sample<halp::q31>);
+static_assert(!avnd::fixed_point_sample<float>);
+static_assert(!avnd::fixed_point_sample<int16_t>);
+
+// Halves its input, in Q15
+struct Q15Gain
+{
+  halp_meta(name, "Q15 gain")
+  halp_meta(c_name, "q15_gain")
+
+  struct
+  {
+    halp::dynamic_audio_bus<"In", halp::q15> audio;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Out", halp::q15> audio;
+  } outputs;
+
+  void operator()(int frames)
+  {
+    const auto gain = halp::q15::from_float(0.5);
+    for (int c = 0; c < inputs.audio.channels; c++)
+      for (int i = 0; i < frames; i++)
+        outputs.audio[c][i] = gain * inputs.audio[c][i];
+  }
+};
+
+// Stereo generator, in Q31
+struct Q31Ramp
+{
+  halp_meta(name, "Q31 ramp")
+  halp_meta(c_name, "q31_ramp")
+
+  struct
+  {
+  } inputs;
+
+  struct
+  {
+    halp::fixed_audio_bus<"Out", halp::q31, 2> audio;
+  } outputs;
+
+  void operator()(int frames)
+  {
+    for (int i = 0; i < frames; i++)
+    {
+      outputs.audio[0][i] = halp::q31::from_float(i / 8.);
+      outputs.audio[1][i] = -outputs.audio[0][i];
+    }
+  }
+};
+
+static_assert(avnd::fixed_point_processor<Q15Gain>);
+static_assert(avnd::fixed_point_processor<Q31Ramp>);
+static_assert(std::is_same_v<avnd::fixed_point_sample_type<Q15Gain>, halp::q15>);
+
+static bool check_arithmetic()
+{
+  using halp::q15;
+  bool ok = true;
+  const q15 half = q15::from_float(0.5);
+  ok &= half.raw == 16384;
+  ok &= (half + half).raw == 32767;
+  ok &= (-half - half).raw == -32768;
+  ok &= (-q15::min()).raw == 32767;
+  ok &= (q15::min() * q15::min()).raw == 32767;
+  ok &= (half * half).raw == 8192;
+  ok &= (half * q15::from_float(-0.5)).raw == -8192;
+  // 3 * 3 / 32768 rounds to 0, 181 * 181 / 32768 to 1
+  ok &= (q15::from_raw(3) * q15::from_raw(3)).raw == 0;
+  ok &= (q15::from_raw(181) * q15::from_raw(181)).raw == 1;
+  ok &= half.to_float() == 0.5f && q15::min().to_float() == -1.f;
+  ok &= q15::from_float(2.).raw == 32767 && q15::from_float(-2.).raw == -32768;
+  ok &= half > q15{} && q15::from_raw(-1) < q15{};
+
+  using halp::q31;
+  ok &= (q31::max() + q31::max()) == q31::max();
+  ok &= (q31::from_float(0.5) * q31::from_float(0.5)).raw == (1 << 29);
+  ok &= q31::from_float(-1.).raw == std::numeric_limits<int32_t>::min();
+  return ok;
+}
+
+static bool check_conversions()
+{
+  bool ok = true;
+  const float in[]
+      = {0.f,
+         0.5f,
+         -0.5f,
+         1.f,
+         -1.f,
+         4.f,
+         -4.f,
+         1.f / 65536.f,
+         -1.f / 65536.f,
+         std::numeric_limits<float>::quiet_NaN()};
+  constexpr int n = std::size(in);
+
+  halp::q15 q[n];
+  avnd::convert_samples(in, q, n);
+  const int16_t expected[n]{0, 16384, -16384, 32767, -32768, 32767, -32768, 1, -1, -32768};
+  for (int i = 0; i < n; i++)
+    ok &= q[i].raw == expected[i];
+
+  double back[n];
+  avnd::convert_samples(q, back, n);
+  ok &= back[1] == 0.5 && back[4] == -1. && back[7] == 1. / 32768.;
+
+  // Through double for Q31: 2^-31 is still there
+  const double din[]{1. / 2147483648., 1., -1.};
+  halp::q31 q31[3];
+  avnd::convert_samples(din, q31, 3);
+  ok &= q31[0].raw == 1 && q31[1].raw == std::numeric_limits<int32_t>::max()
+        && q31[2].raw == std::numeric_limits<int32_t>::min();
+
+  // Same type: copied
+  halp::q15 copy[n];
+  avnd::convert_samples(q, copy, n);
+  for (int i = 0; i < n; i++)
+    ok &= copy[i] == q[i];
+  return ok;
+}
+
+static bool check_float_host()
+{
+  bool ok = true;
+  freestanding::processor<Q15Gain> p;
+  p.start(2, 2, 16, 48000.);
+  ok &= p.input_channels() == 2 && p.output_channels() == 2;
+
+  float in_buf[2][40], out_buf[2][40];
+  const float* in[2]{in_buf[0], in_buf[1]};
+  float* out[2]{out_buf[0], out_buf[1]};
+  for (int i = 0; i < 40; i++)
+  {
+    in_buf[0][i] = 0.5f;
+    in_buf[1][i] = -3.f;
+  }
+  p.process(in, out, 40);
+  for (int i = 0; i < 40; i++)
+    ok &= out_buf[0][i] == 0.25f && out_buf[1][i] == -0.5f;
+  return ok;
+}
+
+static bool check_native_host()
+{
+  bool ok = true;
+  freestanding::processor<Q15Gain> p;
+  p.start(1, 1, 8, 48000.);
+
+  halp::q15 in_buf[20], out_buf[20];
+  for (int i = 0; i < 20; i++)
+    in_buf[i] = halp::q15::from_raw(int16_t(i * 1000 - 10000));
+  const halp::q15* in[1]{in_buf};
+  halp::q15* out[1]{out_buf};
+  p.process(in, out, 20);
+  for (int i = 0; i < 20; i++)
+    ok &= out_buf[i].raw == (i * 1000 - 10000) / 2;
+  return ok;
+}
+
+static bool check_generator()
+{
+  bool ok = true;
+  freestanding::processor<Q31Ramp> p;
+  p.start(0, 2, 8, 48000.);
+  ok &= p.input_channels() == 0 && p.output_channels() == 2;
+
+  float out_buf[2][8];
+  float* out[2]{out_buf[0], out_buf[1]};
+  p.process<float>(nullptr, out, 8);
+  for (int i = 0; i < 8; i++)
+    ok &= out_buf[0][i] == i / 8.f && out_buf[1][i] == -i / 8.f;
+  return ok;
+}
+
+int main()
+{
+  const bool arithmetic = check_arithmetic();
+  const bool conversions = check_conversions();
+  const bool float_host = check_float_host();
+  const bool native_host = check_native_host();
+  const bool generator = check_generator();
+  std::printf("arithmetic: %s\n", arithmetic ? "ok" : "FAILED");
+  std::printf("conversions: %s\n", conversions ? "ok" : "FAILED");
+  std::printf("float host: %s\n", float_host ? "ok" : "FAILED");
+  std::printf("native host: %s\n", native_host ? "ok" : "FAILED");
+  std::printf("generator: %s\n", generator ? "ok" : "FAILED");
+  return arithmetic && conversions && float_host && native_host && generator ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+// The profile of the firmwares, with small capacities to check the clamping
+#define AVND_FREESTANDING 1
+#define AVND_FREESTANDING_MAX_CHANNELS 4
+#define AVND_FREESTANDING_MAX_FRAMES 64
+
+#include <avnd/binding/freestanding/processor.hpp>
+#include <avnd/common/static_vector.hpp>
+#include <examples/Helpers/SmoothedGain.hpp>
+#include <examples/Raw/PerSampleProcessor.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+// Nothing may allocate once the program runs
+static bool g_counting = false;
+static int g_allocations = 0;
+
+void* operator new(std::size_t sz)
+{
+  if (g_counting)
+    g_allocations++;
+  if (void* ptr = std::malloc(sz ? sz : 1))
+    return ptr;
+  throw std::bad_alloc{};
+}
+void* operator new(std::size_t sz, std::align_val_t al)
+{
+  if (g_counting)
+    g_allocations++;
+  if (void* ptr = std::aligned_alloc(std::size_t(al), (sz + std::size_t(al) - 1) & ~(std::size_t(al) - 1)))
+    return ptr;
+  throw std::bad_alloc{};
+}
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+static int g_alive = 0;
+struct counted
+{
+  int value{};
+  counted() { g_alive++; }
+  counted(int v) : value{v} { g_alive++; }
+  counted(const counted& other) : value{other.value} { g_alive++; }
+  ~counted() { g_alive--; }
+};
+
+static bool check_static_vector()
+{
+  bool ok = true;
+  {
+    avnd::static_vector<counted, 4> v;
+    v.push_back(counted{3});
+    v.resize(3, v[0]);
+    ok &= v.size() == 3 && v[2].value == 3 && g_alive == 3;
+
+    // Clamped to the capacity
+    v.resize(10);
+    v.push_back(counted{5});
+    ok &= v.size() == 4 && v.back().value == 0 && g_alive == 4;
+
+    auto copy = v;
+    ok &= copy.size() == 4 && g_alive == 8;
+    v.clear();
+    ok &= v.empty() && g_alive == 4;
+  }
+  ok &= g_alive == 0;
+
+  avnd::static_vector<uint8_t, 15> bytes{0x90, 60, 100};
+  ok &= bytes.size() == 3 && bytes[1] == 60;
+  return ok;
+}
+
+// Duplicated per channel, in the effect container
+static bool check_per_sample()
+{
+  bool ok = true;
+  freestanding::processor<examples::PerSampleProcessor> p;
+  p.start(8, 8, 512, 48000.);
+  ok &= p.input_channels() == 4 && p.output_channels() == 4;
+  ok &= p.effect().effect.size() == 4;
+
+  // One knob at its maximum
+  p.set_parameter(0, 1.f);
+  ok &= std::abs(p.effect().inputs().gain.value - 500.f) < 1e-3f;
+
+  static float buf[4][200];
+  float* in[4]{buf[0], buf[1], buf[2], buf[3]};
+  for (auto& c : buf)
+    for (auto& s : c)
+      s = 0.25f;
+  p.process(in, in, 200);
+  for (auto& c : buf)
+    for (auto& s : c)
+      ok &= std::isfinite(s) && std::abs(s) <= 0.5f;
+  return ok;
+}
+
+// Smoothed control, with the host buffers larger than the ones of start()
+static bool check_smoothed()
+{
+  bool ok = true;
+  freestanding::processor<examples::helpers::SmoothedGain> p;
+  p.start(2, 2, 64, 48000.);
+  ok &= p.parameter_count() == 1;
+
+  static float in_buf[2][150], out_buf[2][150];
+  const float* in[2]{in_buf[0], in_buf[1]};
+  float* out[2]{out_buf[0], out_buf[1]};
+  for (auto& c : in_buf)
+    for (auto& s : c)
+      s = 1.f;
+
+  // Gain of 1 at first, then ramps to 2
+  p.process(in, out, 150);
+  ok &= std::abs(out_buf[0][149] - 1.f) < 1e-5f && std::abs(out_buf[1][0] - 1.f) < 1e-5f;
+
+  p.set_parameter(0, 1.f);
+  for (int k = 0; k < 100; k++)
+    p.process(in, out, 150);
+  ok &= std::abs(out_buf[0][149] - 2.f) < 1e-3f && std::abs(out_buf[1][149] - 2.f) < 1e-3f;
+  return ok;
+}
+
+int main()
+{
+  g_counting = true;
+  const bool vec = check_static_vector();
+  const bool per_sample = check_per_sample();
+  const bool smoothed = check_smoothed();
+  g_counting = false;
+
+  const bool no_alloc = g_allocations == 0;
+  std::printf("static_vector: %s\n", vec ? "ok" : "FAILED");
+  std::printf("per-sample processor: %s\n", per_sample ? "ok" : "FAILED");
+  std::printf("smoothed processor: %s\n", smoothed ? "ok" : "FAILED");
+  std::printf("no allocation: %s (%d)\n", no_alloc ? "ok" : "FAILED", g_allocations);
+  return vec && per_sample && smoothed && no_alloc ? 0 : 1;
+}
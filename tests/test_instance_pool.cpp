@@ -0,0 +1,76 @@
+#include <avnd/wrappers/instance_pool.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// Checks that the instances are made ahead of time on another thread,
+// for the setup they will be used with
+struct setup
+{
+  int frames{};
+  bool operator==(const setup&) const noexcept = default;
+};
+
+struct node
+{
+  explicit node(setup s)
+      : frames{s.frames}
+      , thread{std::this_thread::get_id()}
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  int frames{};
+  std::thread::id thread;
+};
+
+using pool_type = avnd::instance_pool<node, setup>;
+
+static std::shared_ptr<node> make(const setup& s)
+{
+  return std::make_shared<node>(s);
+}
+
+template <typename F>
+static bool wait_for(F f)
+{
+  for (int i = 0; i < 2000 && !f(); i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  return f();
+}
+
+int main()
+{
+  const auto self = std::this_thread::get_id();
+
+  pool_type pool{3, make};
+  pool.prepare({512});
+  bool warm = wait_for([&] { return pool.available() == 3; });
+
+  // Taken from the ones made on the other thread, which makes another one
+  auto a = pool.take({512});
+  warm &= a->frames == 512 && a->thread != self;
+  warm &= wait_for([&] { return pool.available() == 3; });
+  std::printf("warm: %s\n", warm ? "ok" : "FAILED");
+
+  // A new setup: the previous instances are dropped
+  auto b = pool.take({64});
+  bool setups = b->frames == 64 && b->thread == self;
+  setups &= wait_for([&] { return pool.available() == 3; });
+  for (int i = 0; i < 3; i++)
+  {
+    auto c = pool.take({64});
+    setups &= c->frames == 64 && c->thread != self;
+  }
+  std::printf("setups: %s\n", setups ? "ok" : "FAILED");
+
+  // Going away while instances are being made
+  {
+    pool_type other{8, make};
+    other.prepare({32});
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::printf("release: ok\n");
+
+  return warm && setups ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/interleaved.hpp>
+#include <avnd/wrappers/process_adapter.hpp>
+#include <examples/Helpers/Lowpass.hpp>
+#include <examples/Helpers/PerSample.hpp>
+#include <examples/Raw/Addition.hpp>
+#include <examples/Raw/PerSampleProcessor.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Checks that the interleaved buffers of a host give the same output as the planar ones,
+// whether the adapter processes them directly or through planar copies
+static constexpr int frames = 64;
+static constexpr int blocks = 4;
+
+template <typename T>
+static void setup(avnd::effect_container<T>& impl, auto& processor, int channels)
+{
+  const avnd::process_setup setup{
+      .input_channels = channels,
+      .output_channels = channels,
+      .frames_per_buffer = frames,
+      .rate = 48000.};
+  if constexpr (avnd::has_inputs<T>)
+    avnd::init_controls(impl.inputs());
+  processor.allocate_buffers(setup, float{});
+  impl.init_channels(channels, channels);
+  avnd::prepare(impl, setup);
+}
+
+static float input(int channel, int frame)
+{
+  return 0.5f * std::sin(0.01f * (channel + 1) * frame);
+}
+
+template <typename T>
+static bool check(const char* name, int channels, bool in_place)
+{
+  // Reference: planar buffers
+  avnd::effect_container<T> planar_impl;
+  avnd::process_adapter<T> planar_processor;
+  setup(planar_impl, planar_processor, channels);
+
+  std::vector<std::vector<float>> planar_in(channels), planar_out(channels);
+  std::vector<float*> ins(channels), outs(channels);
+  for (int c = 0; c < channels; c++)
+  {
+    planar_in[c].resize(frames * blocks);
+    planar_out[c].resize(frames * blocks);
+    for (int i = 0; i < frames * blocks; i++)
+      planar_in[c][i] = input(c, i);
+  }
+
+  for (int b = 0; b < blocks; b++)
+  {
+    for (int c = 0; c < channels; c++)
+    {
+      ins[c] = planar_in[c].data() + b * frames;
+      outs[c] = planar_out[c].data() + b * frames;
+    }
+    planar_processor.process(
+        planar_impl, avnd::span<float*>{ins.data(), std::size_t(channels)},
+        avnd::span<float*>{outs.data(), std::size_t(channels)}, frames);
+  }
+
+  // Interleaved buffers
+  avnd::effect_container<T> impl;
+  avnd::interleaved_process_adapter<T> processor;
+  setup(impl, processor, channels);
+
+  std::vector<float> in(std::size_t(channels) * frames * blocks);
+  std::vector<float> out(in.size());
+  for (int i = 0; i < frames * blocks; i++)
+    for (int c = 0; c < channels; c++)
+      in[i * channels + c] = input(c, i);
+
+  float* dst = in_place ? in.data() : out.data();
+  for (int b = 0; b < blocks; b++)
+  {
+    const std::size_t offset = std::size_t(b) * frames * channels;
+    processor.process(
+        impl, avnd::interleaved_buffer<const float>{in.data() + offset, channels, frames},
+        avnd::interleaved_buffer<float>{dst + offset, channels, frames}, frames);
+  }
+
+  bool ok = true;
+  for (int i = 0; i < frames * blocks; i++)
+    for (int c = 0; c < channels; c++)
+      ok &= std::abs(dst[i * channels + c] - planar_out[c][i]) <= 1e-6f;
+
+  std::printf(
+      "%s, %d channels%s (%s): %s\n", name, channels, in_place ? ", in place" : "",
+      avnd::interleaved_process_adapter<T>::template direct<float>() ? "direct" : "planar copies",
+      ok ? "ok" : "FAILED");
+  return ok;
+}
+
+template <typename T>
+static bool check(const char* name)
+{
+  bool ok = true;
+  for (int channels : {1, 2, 5})
+    for (bool in_place : {false, true})
+      ok &= check<T>(name, channels, in_place);
+  return ok;
+}
+
+int main()
+{
+  bool ok = true;
+
+  // Per-sample processors: the frames are processed where they are
+  ok &= check<examples::PerSampleProcessor>("PerSampleProcessor");
+  ok &= check<examples::helpers::PerSampleAsArgs>("PerSampleAsArgs");
+  ok &= check<examples::helpers::PerSampleAsPorts>("PerSampleAsPorts");
+
+  // The others: through the planar buffers
+  ok &= check<examples::Addition>("Addition");
+  ok &= check<examples::helpers::Lowpass>("helpers::Lowpass");
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+#include <avnd/binding/standalone/benchmark.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+struct Probe
+{
+  halp_meta(name, "Probe")
+};
+
+// The impulses come back after a simulated loopback of delay >= block frames
+static bool check_round_trips(int block, int delay)
+{
+  standalone::latency_probe probe;
+  probe.reset(48000., 0.025, 0.1, 100);
+
+  std::deque<float> cable(delay, 0.f);
+  std::vector<float> in(block), out(block);
+  for (int k = 0; k < 48000 / block; k++)
+  {
+    for (int i = 0; i < block; i++)
+    {
+      in[i] = cable.front();
+      cable.pop_front();
+    }
+    probe.process(in.data(), out.data(), block);
+    cable.insert(cable.end(), out.begin(), out.end());
+  }
+
+  auto stats = standalone::compute_latency(probe);
+  return stats.sent == 39 && stats.received >= 38 && stats.missed == 0
+         && stats.min_frames == delay && stats.max_frames == delay
+         && stats.stddev_frames == 0.;
+}
+
+int main()
+{
+  const char* args[]{"host", "--benchmark", "--periods=64,256", "--paths=standalone",
+                     "--duration=2", "--input-channel=1"};
+  auto opts = standalone::parse_benchmark_options(6, const_cast<char**>(args));
+  bool options = opts && opts->periods == std::vector<int>{64, 256}
+                 && opts->paths == std::vector<std::string>{"standalone"}
+                 && opts->duration == 2. && opts->input_channel == 1;
+
+  const char* bad[]{"host", "--benchmark", "--periods=64,0"};
+  options &= !standalone::parse_benchmark_options(3, const_cast<char**>(bad));
+  const char* none[]{"host", "--render"};
+  options &= !standalone::parse_benchmark_options(2, const_cast<char**>(none));
+  std::printf("options: %s\n", options ? "ok" : "FAILED");
+
+  bool latency = check_round_trips(64, 100) && check_round_trips(256, 1000)
+                 && check_round_trips(32, 32);
+
+  // Nothing comes back: every impulse but the last one is missed
+  {
+    standalone::latency_probe probe;
+    probe.reset(48000., 0.01, 0.1, 100);
+    std::vector<float> in(64, 0.f), out(64);
+    for (int k = 0; k < 48000 / 64; k++)
+      probe.process(in.data(), out.data(), 64);
+    auto stats = standalone::compute_latency(probe);
+    latency &= stats.sent == 99 && stats.received == 0 && stats.missed == 98;
+  }
+  std::printf("latency: %s\n", latency ? "ok" : "FAILED");
+
+  // 1.5 ms periods, every tenth callback 0.3 ms late
+  using namespace std::chrono;
+  standalone::callback_timer timer;
+  timer.reset(1000);
+  auto t = steady_clock::time_point{};
+  for (int k = 0; k < 100; k++)
+  {
+    const auto arrival = t + (k % 10 == 5 ? microseconds(300) : microseconds(0));
+    timer.begin(arrival);
+    timer.end(arrival + microseconds(150));
+    t += microseconds(1500);
+  }
+  auto stats = standalone::compute_jitter(timer, 1.5, 0.1);
+  int counted = 0;
+  for (int n : stats.histogram)
+    counted += n;
+  bool jitter = stats.callbacks == 100 && std::abs(stats.max_deviation_ms - 0.3) < 1e-6
+                && std::abs(stats.min_ms - 1.2) < 1e-6 && std::abs(stats.max_ms - 1.8) < 1e-6
+                && std::abs(stats.mean_callback_ms - 0.15) < 1e-6
+                && std::abs(stats.load - 0.1) < 1e-6 && counted == 99
+                && stats.histogram[15] == 79;
+  std::printf("jitter: %s\n", jitter ? "ok" : "FAILED");
+
+  // The report is JSON
+  standalone::benchmark_result r;
+  r.path = "standalone";
+  r.period = 64;
+  r.rate = 48000.;
+  r.latency = standalone::compute_latency(standalone::latency_probe{});
+  r.jitter = stats;
+  std::FILE* f = std::tmpfile();
+  standalone::write_json<Probe>(f, *opts, {"ALSA", "in \"1\"", "out", 4}, {r});
+  std::rewind(f);
+  std::string json(8192, '\0');
+  json.resize(std::fread(json.data(), 1, json.size(), f));
+  std::fclose(f);
+  bool report = json.find("\"processor\": \"Probe\"") != std::string::npos
+                && json.find("\"input_device\": \"in \\\"1\\\"\"") != std::string::npos
+                && json.find("\"period\": 64") != std::string::npos
+                && json.find("\"histogram\": [") != std::string::npos
+                && json.back() == '\n';
+  std::printf("report: %s\n", report ? "ok" : "FAILED");
+
+  return options && latency && jitter && report ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#include <avnd/binding/example/example_processor.hpp>
+#include <avnd/wrappers/latency.hpp>
+#include <examples/Helpers/Limiter.hpp>
+#include <halp/lookahead.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Checks the sliding extremums against a scan of the window, that the look-ahead
+// delays the audio by its latency whatever the buffers, and that the limiter
+// keeps the peaks under the ceiling
+int main()
+{
+  std::mt19937 rng{1};
+  std::uniform_real_distribution<double> dist{-1., 1.};
+  std::vector<double> signal(2000);
+  for (auto& x : signal)
+    x = dist(rng);
+
+  bool sliding = true;
+  for (int window : {1, 2, 7, 64, 300})
+  {
+    halp::sliding_max<double> max;
+    halp::sliding_min<double> min;
+    max.reset(window);
+    min.reset(window);
+    for (int i = 0; i < int(signal.size()); i++)
+    {
+      const auto first = signal.begin() + std::max(0, i - window + 1);
+      const auto last = signal.begin() + i + 1;
+      sliding &= max.push(signal[i]) == *std::max_element(first, last);
+      sliding &= min.push(signal[i]) == *std::min_element(first, last);
+    }
+  }
+  std::printf("sliding: %s\n", sliding ? "ok" : "FAILED");
+
+  // Unity gain, in-place, with buffers smaller and larger than the look-ahead
+  bool delay = true;
+  for (int latency : {0, 5, 100})
+  {
+    halp::lookahead<double> la;
+    la.reset(2, latency);
+    delay &= la.latency() == latency;
+
+    std::vector<double> l = signal, r = signal;
+    double* io[2]{l.data(), r.data()};
+    std::vector<double> peaks;
+    int done = 0;
+    for (int frames : {1, 3, 64, 65, 200, 17})
+    {
+      double* chunk[2]{io[0] + done, io[1] + done};
+      la.process(chunk, chunk, 2, frames, [&](double peak) {
+        peaks.push_back(peak);
+        return 1.;
+      });
+      done += frames;
+    }
+
+    for (int i = 0; i < done; i++)
+    {
+      const double expected = i >= latency ? signal[i - latency] : 0.;
+      delay &= l[i] == expected && r[i] == expected;
+
+      // The peak of the frames which come out until the current one does
+      double peak = 0.;
+      for (int k = std::max(0, i - latency); k <= i; k++)
+        peak = std::max(peak, std::abs(signal[k]));
+      delay &= peaks[i] == peak;
+    }
+  }
+  std::printf("delay: %s\n", delay ? "ok" : "FAILED");
+
+  // The limiter
+  using fx = examples::helpers::Limiter;
+  exhs::example_processor<fx> proc{false};
+  proc.set_channels(1, 1);
+  proc.start(256, 48000.);
+  std::vector<float> in(256), out(256);
+  float* ins[1]{in.data()};
+  float* outs[1]{out.data()};
+  bool limiter = true;
+  float loudest = 0.f;
+  for (int b = 0; b < 20; b++)
+  {
+    for (int i = 0; i < 256; i++)
+      in[i] = 2.f * std::sin(0.05f * float(b * 256 + i));
+    proc.process(ins, 1, outs, 1, 256);
+    for (float x : out)
+      loudest = std::max(loudest, std::abs(x));
+  }
+  // -1 dB by default
+  limiter &= loudest <= std::pow(10.f, -1.f / 20.f) + 1e-6f && loudest > 0.8f;
+  proc.stop();
+
+  avnd::effect_container<fx> limited;
+  limited.effect.prepare(
+      {.input_channels = 2, .output_channels = 2, .frames = 64, .rate = 48000.});
+  limiter &= avnd::latency_samples(limited) == 240;
+  std::printf("limiter: %s\n", limiter ? "ok" : "FAILED");
+
+  return sliding && delay && limiter ? 0 : 1;
+}
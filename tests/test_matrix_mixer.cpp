@@ -0,0 +1,77 @@
+#include <halp/matrix_mixer.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Checks halp::matrix_mixer against the definition, its gain ramps,
+// and that it can write its outputs over its inputs
+int main()
+{
+  constexpr int N = 24, M = 20, frames = 700, ramp = 48;
+  std::mt19937 gen{7};
+  std::uniform_real_distribution<float> dist{-1.f, 1.f};
+
+  std::vector<std::vector<float>> in(N, std::vector<float>(frames));
+  std::vector<std::vector<float>> out(M, std::vector<float>(frames));
+  std::vector<const float*> in_ptr;
+  std::vector<float*> out_ptr;
+  for (auto& c : in)
+  {
+    for (auto& s : c)
+      s = dist(gen);
+    in_ptr.push_back(c.data());
+  }
+  for (auto& c : out)
+    out_ptr.push_back(c.data());
+
+  halp::matrix_mixer<float> mixer;
+  mixer.prepare(N, M, frames, 48000., 1.);
+
+  // A sparse matrix: a third of the gains are zero
+  std::vector<float> gains(N * M);
+  for (int o = 0; o < M; o++)
+    for (int i = 0; i < N; i++)
+      mixer.jump_gain(o, i, gains[o * N + i] = (o + i) % 3 == 0 ? 0.f : dist(gen));
+
+  bool ok = true;
+  auto check = [&](auto gain_at) {
+    for (int o = 0; o < M; o++)
+      for (int j = 0; j < frames; j++)
+      {
+        double expected = 0.;
+        for (int i = 0; i < N; i++)
+          expected += double(gain_at(o, i, j)) * in[i][j];
+        ok &= std::abs(out[o][j] - expected) < 1e-4;
+      }
+  };
+
+  mixer(in_ptr.data(), out_ptr.data(), frames);
+  check([&](int o, int i, int) { return gains[o * N + i]; });
+
+  // New gains glide linearly over the ramp
+  std::vector<float> next(N * M);
+  for (int o = 0; o < M; o++)
+    for (int i = 0; i < N; i++)
+      mixer.set_gain(o, i, next[o * N + i] = i == o ? 1.f : 0.f);
+  mixer(in_ptr.data(), out_ptr.data(), frames);
+  check([&](int o, int i, int j) {
+    const float a = gains[o * N + i], b = next[o * N + i];
+    return j + 1 >= ramp ? b : a + (b - a) * float(j + 1) / ramp;
+  });
+
+  // Once the ramps are done only the diagonal remains, computed in place
+  for (int o = 0; o < M; o++)
+    out[o] = in[o];
+  std::vector<float*> inout;
+  for (auto& c : out)
+    inout.push_back(c.data());
+  for (int i = M; i < N; i++)
+    inout.push_back(in[i].data());
+  mixer(inout.data(), inout.data(), frames);
+  check([&](int o, int i, int) { return next[o * N + i]; });
+
+  std::printf("matrix mixer: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include <avnd/wrappers/message_bus.hpp>
+#include <halp/meta.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <thread>
+
+// Checks that avnd::message_bus_storage carries the messages of the UI
+// to the processor in the audio thread, and its answers back to the UI
+struct Echo
+{
+  halp_meta(name, "Echo")
+
+  struct
+  {
+  } inputs;
+  struct
+  {
+  } outputs;
+
+  struct ui_to_processor
+  {
+    int value;
+  };
+  struct processor_to_ui
+  {
+    int value;
+  };
+
+  int received{};
+  void process_message(const ui_to_processor& msg)
+  {
+    received++;
+    send_message(processor_to_ui{.value = 2 * msg.value});
+  }
+  std::function<void(processor_to_ui)> send_message;
+
+  void operator()(int frames) { }
+
+  struct ui
+  {
+    std::function<void(int)> on_click;
+    int sum{};
+
+    struct bus
+    {
+      void init(ui& self)
+      {
+        self.on_click = [this](int v) { this->send_message(ui_to_processor{.value = v}); };
+      }
+      static void process_message(ui& self, processor_to_ui msg) { self.sum += msg.value; }
+      std::function<void(ui_to_processor)> send_message;
+    };
+  };
+};
+
+int main()
+{
+  static_assert(avnd::message_bus<Echo>);
+
+  avnd::effect_container<Echo> impl;
+  avnd::message_bus_storage<Echo> bus;
+  bus.start(impl);
+
+  Echo::ui ui;
+  bus.connect(ui);
+
+  // The UI sends 1..100 in its thread while the audio thread processes buffers
+  constexpr int count = 100;
+  std::atomic<bool> done{};
+  std::thread audio{[&] {
+    while (!done.load(std::memory_order_acquire) || impl.effect.received < count)
+    {
+      bus.deliver(impl);
+      std::this_thread::yield();
+    }
+  }};
+
+  int expected = 0;
+  for (int i = 1; i <= count; i++)
+  {
+    ui.on_click(i);
+    expected += 2 * i;
+    // The UI waits for the answers every few messages, so that no queue fills up
+    if (i % 8 == 0)
+      while (ui.sum < expected)
+      {
+        bus.update(ui);
+        std::this_thread::yield();
+      }
+  }
+  done.store(true, std::memory_order_release);
+  audio.join();
+  bus.update(ui);
+
+  const bool ok = impl.effect.received == count && ui.sum == expected && bus.dropped() == 0;
+  std::printf("message bus: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+#include <avnd/wrappers/deferred_outputs.hpp>
+#include <halp/controls.hpp>
+#include <halp/meter.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Checks halp's meters against the values given by ITU-R BS.1770,
+// and the rate limiting of the meter outputs by avnd::deferred_outputs
+static_assert(halp::detail::true_peak_table<>[1][5] == halp::detail::true_peak_table<>[1][6]);
+
+static bool check(const char* what, double value, double expected, double tolerance)
+{
+  const bool ok = std::abs(value - expected) <= tolerance;
+  std::printf("%s: %.4f (expected %.4f)%s\n", what, value, expected, ok ? "" : " FAILED");
+  return ok;
+}
+
+template <typename FP>
+static std::vector<FP> sine(double frequency, double amplitude, double phase, int frames)
+{
+  std::vector<FP> x(frames);
+  for (int i = 0; i < frames; i++)
+    x[i] = FP(amplitude * std::sin(2. * M_PI * frequency * i / 48000. + phase));
+  return x;
+}
+
+static bool check_kernels()
+{
+  bool ok = true;
+  const auto x = sine<float>(440., 0.8, 0.1, 1001);
+  for (int n : {0, 1, 7, 8, 9, 63, 1001})
+  {
+    float peak = 0.f;
+    double squares = 0.;
+    for (int i = 0; i < n; i++)
+    {
+      peak = std::max(peak, std::abs(x[i]));
+      squares += double(x[i]) * x[i];
+    }
+    ok &= halp::peak(x.data(), n) == peak;
+    ok &= std::abs(halp::sum_of_squares(x.data(), n) - squares) <= 1e-5 * (1. + squares);
+  }
+  std::printf("peak and sum_of_squares: %s\n", ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static bool check_k_weighting()
+{
+  // The coefficients given by the standard at 48 kHz
+  const auto k = halp::detail::k_weighting_coefficients::at(48000.);
+  bool ok = true;
+  ok &= check("shelf b0", k.b0, 1.53512485958697, 1e-12);
+  ok &= check("shelf b1", k.b1, -2.69169618940638, 1e-12);
+  ok &= check("shelf b2", k.b2, 1.19839281085285, 1e-12);
+  ok &= check("shelf a1", k.a1, -1.69065929318241, 1e-12);
+  ok &= check("shelf a2", k.a2, 0.73248077421585, 1e-12);
+  ok &= check("high pass a1", k.c1, -1.99004745483398, 1e-12);
+  ok &= check("high pass a2", k.c2, 0.99007225036621, 1e-12);
+  return ok;
+}
+
+// A 997 Hz sine at 0 dBFS on one channel reads -3.01 LUFS
+template <typename FP>
+static bool check_loudness(int channels)
+{
+  halp::level_meter<FP> meter;
+  meter.reset(channels, 48000.);
+
+  std::vector<std::vector<FP>> in;
+  std::vector<const FP*> ptrs(channels);
+  for (int c = 0; c < channels; c++)
+    in.push_back(sine<FP>(997., 1., c, 48000 * 4));
+
+  // In buffers which do not fall on the 100 ms blocks
+  for (int offset = 0; offset < 48000 * 4; offset += 300)
+  {
+    for (int c = 0; c < channels; c++)
+      ptrs[c] = in[c].data() + offset;
+    meter.process(ptrs.data(), channels, 300);
+  }
+
+  const auto v = meter.value();
+  const double expected = -3.0103 + 10. * std::log10(channels);
+  bool ok = true;
+  ok &= check("momentary", v.momentary, expected, 0.02);
+  ok &= check("short-term", v.short_term, expected, 0.02);
+  ok &= check("rms", v.rms, -3.0103, 0.01);
+  ok &= check("peak", v.peak, 0., 0.1);
+  return ok;
+}
+
+static bool check_true_peak()
+{
+  bool ok = true;
+
+  // At a quarter of the rate, shifted by 45 degrees, the samples peak at -3 dB
+  halp::true_peak<float> tp;
+  tp.reset(1);
+  auto x = sine<float>(12000., 1., M_PI / 4., 1000);
+  ok &= check("sample peak", 20. * std::log10(halp::peak(x.data(), 1000)), -3.0103, 1e-3);
+  ok &= check("true peak", 20. * std::log10(tp.process(0, x.data(), 1000)), 0., 0.2);
+
+  // The standard allows under-reading by up to 0.55 dB near the Nyquist frequency
+  for (double f : {1000., 10000., 18000.})
+  {
+    double worst = 1.;
+    for (double phase = 0.; phase < 1.; phase += 0.05)
+    {
+      tp.reset(1);
+      x = sine<float>(f, 1., phase, 1000);
+      // In two calls, for the history of the filter
+      const float first = tp.process(0, x.data(), 500);
+      const float second = tp.process(0, x.data() + 500, 500);
+      worst = std::min(worst, double(std::max(first, second)));
+    }
+    ok &= check("worst true peak", 20. * std::log10(worst), 0., 0.55);
+  }
+  return ok;
+}
+
+struct Meter
+{
+  struct
+  {
+    halp::meter_port<"Level"> level;
+    halp::val_port<"Count", int> count;
+  } outputs;
+};
+
+static bool check_reports()
+{
+  avnd::effect_container<Meter> impl;
+  avnd::deferred_outputs<Meter> deferred;
+  deferred.prepare(48000.);
+
+  int levels = 0, counts = 0;
+  auto run = [&](float peak, int count) {
+    impl.effect.outputs.level.value.peak = peak;
+    impl.effect.outputs.count.value = count;
+    deferred.collect(impl, 480, [](int frame) { return double(frame); });
+    deferred.drain(1e9, [&](const auto& e) {
+      if (e.port == 0 && e.count == 4)
+        levels++;
+      else if (e.port == 1 && e.count == 1)
+        counts++;
+    });
+  };
+
+  // 100 buffers of 10 ms: the level moves at each, the count never does
+  for (int i = 0; i < 100; i++)
+    run(-float(i), 3);
+  // The level stays within its epsilon
+  for (int i = 0; i < 100; i++)
+    run(-99.f - 0.01f * (i % 2), 3);
+
+  bool ok = true;
+  // The first one, then at most 20 per second
+  ok &= check("level reports", levels, 21, 1);
+  ok &= check("count reports", counts, 1, 0);
+  return ok;
+}
+
+int main()
+{
+  bool ok = true;
+  ok &= check_kernels();
+  ok &= check_k_weighting();
+  ok &= check_loudness<float>(1);
+  ok &= check_loudness<double>(2);
+  ok &= check_loudness<float>(40);
+  ok &= check_true_peak();
+  ok &= check_reports();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#include <avnd/introspection/midi.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <halp/meta.hpp>
+#include <halp/midi.hpp>
+
+#include <cstdio>
+#include <vector>
+
+// Checks that avnd::midi_storage merges the MIDI inputs of a processor
+// in a single list sorted by timestamp, sysex included, and its outputs for the host
+struct TwoKeyboards
+{
+  halp_meta(name, "Two keyboards")
+
+  struct
+  {
+    halp::midi_bus<"Keys"> keys;
+    halp::midi_event_bus<"Pads"> pads;
+  } inputs;
+
+  struct
+  {
+    halp::midi_bus<"Notes"> notes;
+    halp::midi_event_bus<"Clock"> clock;
+  } outputs;
+
+  halp::merged_midi<> merged_midi;
+};
+
+int main()
+{
+  static_assert(avnd::merged_midi_processor<TwoKeyboards>);
+
+  avnd::effect_container<TwoKeyboards> impl;
+  avnd::midi_storage<TwoKeyboards> midi;
+  auto& in = impl.effect.inputs;
+
+  for (int t : {0, 5, 10})
+    in.keys.push_back({.bytes = {0x90, uint8_t(60 + t), 100}, .timestamp = t});
+  for (int t : {3, 5})
+    in.pads.push_back({.bytes = {0xB0, 1, uint8_t(t)}, .timestamp = t});
+  const uint8_t sysex[]{0xF0, 0x7E, 0xF7};
+  in.pads.sysex.push(sysex, 3, 7);
+
+  midi.merge_inputs(impl);
+
+  struct expected
+  {
+    int timestamp, port, status, size;
+  };
+  const std::vector<expected> order{
+      {0, 0, 0x90, 3}, {3, 1, 0xB0, 3}, {5, 0, 0x90, 3},
+      {5, 1, 0xB0, 3}, {7, 1, 0xF0, 3}, {10, 0, 0x90, 3}};
+
+  bool ok = impl.effect.merged_midi.size() == order.size();
+  for (std::size_t i = 0; ok && i < order.size(); i++)
+  {
+    const auto& m = impl.effect.merged_midi[i];
+    ok &= m.timestamp == order[i].timestamp && m.port == order[i].port
+          && m.bytes[0] == order[i].status && int(m.bytes.size()) == order[i].size;
+  }
+  std::printf("inputs merged in order: %s\n", ok ? "ok" : "FAILED");
+
+  midi.clear_inputs(impl);
+  midi.merge_inputs(impl);
+  const bool cleared = impl.effect.merged_midi.empty();
+  std::printf("merged again once cleared: %s\n", cleared ? "ok" : "FAILED");
+
+  // The outputs go to the host in the same order
+  auto& out = impl.effect.outputs;
+  out.notes.push_back({.bytes = {0x90, 60, 100}, .timestamp = 4});
+  out.notes.push_back({.bytes = {0x80, 60, 0}, .timestamp = 12});
+  out.clock.push_back({.bytes = {0xF8}, .timestamp = 0});
+  out.clock.push_back({.bytes = {0xF8}, .timestamp = 8});
+
+  std::vector<expected> sent;
+  midi.for_each_output_in_order(impl, [&](auto bytes, int32_t timestamp, int port) {
+    sent.push_back({timestamp, port, bytes[0], int(bytes.size())});
+  });
+  const std::vector<expected> sent_order{
+      {0, 1, 0xF8, 1}, {4, 0, 0x90, 3}, {8, 1, 0xF8, 1}, {12, 0, 0x80, 3}};
+  bool outputs = sent.size() == sent_order.size();
+  for (std::size_t i = 0; outputs && i < sent.size(); i++)
+    outputs &= sent[i].timestamp == sent_order[i].timestamp
+               && sent[i].port == sent_order[i].port
+               && sent[i].status == sent_order[i].status && sent[i].size == sent_order[i].size;
+  midi.clear_outputs(impl);
+  outputs &= out.notes.empty() && out.clock.empty();
+  std::printf("outputs sent in order: %s\n", outputs ? "ok" : "FAILED");
+
+  return ok && cleared && outputs ? 0 : 1;
+}
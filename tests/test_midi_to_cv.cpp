@@ -0,0 +1,45 @@
+#include <halp/midi.hpp>
+#include <halp/midi_to_cv.hpp>
+
+#include <cmath>
+#include <cstdio>
+
+// Checks that halp::midi_to_cv renders the notes at their frame
+// and gives them to the free voices
+static bool near(double a, double b)
+{
+  return std::abs(a - b) < 1e-6;
+}
+
+int main()
+{
+  halp::midi_to_cv<2> cv;
+  cv.prepare(48000., 64);
+
+  halp::midi_bus<"In"> midi;
+  midi.push_back({.bytes = {0x90, 72, 127}, .timestamp = 10});
+  midi.push_back({.bytes = {0x90, 48, 64}, .timestamp = 20});
+  midi.push_back({.bytes = {0x80, 72, 0}, .timestamp = 30});
+  cv(midi, 64);
+
+  const bool gates = near(cv.gate(0)[9], 0.) && near(cv.gate(0)[10], 1.)
+                     && near(cv.gate(0)[29], 1.) && near(cv.gate(0)[30], 0.)
+                     && near(cv.gate(1)[19], 0.) && near(cv.gate(1)[63], 1.);
+  std::printf("gates at the frame of the notes: %s\n", gates ? "ok" : "FAILED");
+
+  const bool pitches = near(cv.pitch(0)[10], 1.) && near(cv.pitch(1)[20], -1.)
+                       && near(cv.velocity(0)[10], 1.) && near(cv.velocity(1)[20], 64 / 127.);
+  std::printf("pitch and velocity: %s\n", pitches ? "ok" : "FAILED");
+
+  // Voice 0 is free again: the next note goes there, with a glide
+  midi.midi_messages.clear();
+  midi.push_back({.bytes = {0x90, 60, 100}, .timestamp = 0});
+  cv.glide_ms = 10.;
+  cv(midi, 64);
+  const bool glide = near(cv.gate(0)[0], 1.) && cv.pitch(0)[0] < 1.
+                     && cv.pitch(0)[63] < cv.pitch(0)[0] && cv.pitch(0)[63] > 0.
+                     && near(cv.pitch(1)[0], -1.);
+  std::printf("glide on the free voice: %s\n", glide ? "ok" : "FAILED");
+
+  return gates && pitches && glide ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#include <avnd/binding/example/example_processor.hpp>
+#include <examples/Helpers/ModulatedGain.hpp>
+
+#include <cmath>
+#include <cstdio>
+
+// Checks that audio-rate modulations are summed, clamped to the range of the parameters,
+// given per sample or averaged, and that the values set by the host are kept
+int main()
+{
+  using fx = examples::helpers::ModulatedGain;
+  using storage = avnd::modulation_storage<fx>;
+  bool indices = storage::parameters[0] == 0 && storage::parameters[1] == 1
+                 && storage::modulatable(1) && !storage::modulatable(2);
+  std::printf("indices: %s\n", indices ? "ok" : "FAILED");
+
+  exhs::example_processor<fx> proc{false};
+  proc.set_channels(2, 2);
+  proc.start(8, 48000.);
+
+  float in[8], out_l[8], out_r[8];
+  std::fill(std::begin(in), std::end(in), 1.f);
+  float* ins[2]{in, in};
+  float* outs[2]{out_l, out_r};
+
+  // No modulation: the value of the control
+  proc.process(ins, 2, outs, 2, 8);
+  bool per_sample = out_l[0] == 1.f && out_l[7] == 1.f;
+
+  // Two sources are summed, and the sum clamped to [0; 2]
+  const float lfo[8]{0.f, 0.25f, 0.5f, 0.75f, 1.f, 1.25f, -2.f, 0.f};
+  const double offset[8]{0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5};
+  proc.modulate(0, lfo, 8);
+  proc.modulate(0, offset, 8, 0.5);
+  proc.process(ins, 2, outs, 2, 8);
+  const float expected[8]{1.25f, 1.5f, 1.75f, 2.f, 2.f, 2.f, 0.f, 1.25f};
+  for (int i = 0; i < 8; i++)
+    per_sample &= std::abs(out_l[i] - expected[i]) < 1e-6f;
+
+  // The modulation only lasts for the buffer
+  proc.process(ins, 2, outs, 2, 8);
+  per_sample &= out_l[3] == 1.f;
+  std::printf("per sample: %s\n", per_sample ? "ok" : "FAILED");
+
+  // The pan gets the average of its modulation, and is back to 0 afterwards
+  const float pan[8]{1.f, 1.f, 1.f, 1.f, 0.f, 0.f, 0.f, 0.f};
+  proc.modulate(1, pan, 8);
+  proc.process(ins, 2, outs, 2, 8);
+  bool averaged = std::abs(out_l[0] - 0.5f) < 1e-6f && out_r[0] == 1.f;
+  proc.process(ins, 2, outs, 2, 8);
+  averaged &= out_l[0] == 1.f && out_r[0] == 1.f;
+  std::printf("averaged: %s\n", averaged ? "ok" : "FAILED");
+
+  proc.stop();
+  return indices && per_sample && averaged ? 0 : 1;
+}
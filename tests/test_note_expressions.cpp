@@ -0,0 +1,51 @@
+#include <halp/note_expressions.hpp>
+
+#include <cmath>
+#include <cstdio>
+
+// Checks that halp::note_expression_table combines the per-note expressions
+// of the host with the MPE channel messages
+static bool near(float a, float b)
+{
+  return std::abs(a - b) < 1e-3f;
+}
+
+int main()
+{
+  static_assert(avnd::note_expression_midi_port<halp::mpe_bus<"In">>);
+
+  halp::note_expression_table table;
+  bool ok = true;
+
+  // MPE: the note has its own channel, whose messages apply to it
+  const unsigned char note_on[]{0x91, 60, 100};
+  const unsigned char bend[]{0xE1, 0x00, 0x50};
+  const unsigned char pressure[]{0xD1, 127};
+  const unsigned char timbre[]{0xB1, 74, 127};
+  table.update(note_on, 3);
+  table.update(bend, 3);
+  table.update(pressure, 2);
+  table.update(timbre, 3);
+
+  auto e = table(1, 60);
+  ok &= near(e.tuning, 48.f * (0x2800 - 8192) / 8192.f) && near(e.pressure, 1.f)
+        && near(e.brightness, 1.f) && near(e.volume, 1.f);
+  std::printf("mpe channel messages: %s\n", ok ? "ok" : "FAILED");
+
+  // Per-note expressions of the host, and the wildcards
+  table.set(0, 64, avnd::note_expression::tuning, -0.5);
+  table.set(-1, -1, avnd::note_expression::volume, 0.25);
+  e = table(0, 64);
+  const bool host = near(e.tuning, -0.5f) && near(e.volume, 0.25f)
+                    && near(table(0, 65).tuning, 0.f) && near(table(15, 127).volume, 0.25f);
+  std::printf("host note expressions: %s\n", host ? "ok" : "FAILED");
+
+  // A new note on the same key starts from the defaults
+  const unsigned char again[]{0x90, 64, 90};
+  table.update(again, 3);
+  e = table(0, 64);
+  const bool reset = near(e.tuning, 0.f) && near(e.volume, 1.f);
+  std::printf("note on resets the note: %s\n", reset ? "ok" : "FAILED");
+
+  return ok && host && reset ? 0 : 1;
+}
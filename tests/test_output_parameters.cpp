@@ -0,0 +1,130 @@
+#include <avnd/wrappers/output_parameters.hpp>
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+#include <vector>
+
+// Checks which changes of the output parameters are reported to the host, and when
+struct Meters
+{
+  halp_meta(name, "Meters")
+
+  struct
+  {
+  } inputs;
+
+  struct
+  {
+    // Not a parameter: the indices of the parameters below are their field indices
+    halp::dynamic_audio_bus<"Out", double> audio;
+
+    halp::hbargraph_f32<"Level", halp::range{.min = 0., .max = 1., .init = 0.}> level;
+
+    // A change of a tenth of the range
+    struct : halp::hbargraph_f32<"Peak", halp::range{.min = 0., .max = 10., .init = 0.}>
+    {
+      static consteval double report_epsilon() { return 0.1; }
+    } peak;
+
+    // Every 10 frames at 1 kHz
+    struct : halp::hbargraph_f32<"Rms", halp::range{.min = 0., .max = 1., .init = 0.}>
+    {
+      static consteval double report_rate() { return 100.; }
+    } rms;
+  } outputs;
+
+  void operator()(int frames) { }
+};
+
+struct report
+{
+  uint32_t id;
+  float value;
+
+  bool operator==(const report&) const = default;
+};
+
+int main()
+{
+  avnd::effect_container<Meters> fx;
+  auto& out = fx.outputs();
+
+  // 1 kHz, 10 reports per second: every 100 frames
+  avnd::output_parameter_reporter<Meters> reporter;
+  reporter.prepare(1000., 10.);
+
+  std::vector<report> reports;
+  auto buffer = [&](int frames) {
+    reports.clear();
+    reporter.report(fx, frames, [&](const auto& field, int index) {
+      reports.push_back({avnd::output_parameter_id_bit | uint32_t(index), field.value});
+    });
+  };
+  constexpr uint32_t bit = avnd::output_parameter_id_bit;
+
+  // Everything is reported the first time, with the id of its field
+  buffer(50);
+  bool first = reports
+               == std::vector<report>{{bit | 1, 0.f}, {bit | 2, 0.f}, {bit | 3, 0.f}};
+  first &= (reports[1].id & ~bit) == 2 && (reports[1].id & bit);
+  std::printf("first: %s\n", first ? "ok" : "FAILED");
+
+  // Then at most once per interval: 100 frames, or 10 for rms
+  bool interval = true;
+  out.level.value = 0.5f;
+  out.rms.value = 0.5f;
+  buffer(50);
+  interval &= reports == std::vector<report>{{bit | 3, 0.5f}};
+
+  // The latest value when the interval is over
+  out.level.value = 0.75f;
+  out.rms.value = 0.3f;
+  buffer(50);
+  interval &= reports == std::vector<report>{{bit | 1, 0.75f}, {bit | 3, 0.3f}};
+
+  // A change is not lost: it is reported once the interval is over
+  out.rms.value = 0.25f;
+  buffer(5);
+  interval &= reports.empty();
+  buffer(5);
+  interval &= reports == std::vector<report>{{bit | 3, 0.25f}};
+  std::printf("interval: %s\n", interval ? "ok" : "FAILED");
+
+  // Only the changes past the epsilon of the parameter, relative to its range
+  bool epsilon = true;
+  out.peak.value = 0.5f;
+  out.level.value = 0.7505f;
+  buffer(200);
+  epsilon &= reports.empty();
+
+  // Compared to the last reported value, not to the previous buffer
+  out.peak.value = 1.5f;
+  out.level.value = 0.752f;
+  buffer(200);
+  epsilon &= reports == std::vector<report>{{bit | 1, 0.752f}, {bit | 2, 1.5f}};
+
+  out.peak.value = 0.6f;
+  buffer(200);
+  epsilon &= reports.empty();
+  out.peak.value = 0.4f;
+  buffer(200);
+  epsilon &= reports == std::vector<report>{{bit | 2, 0.4f}};
+
+  // Nothing moves: nothing is reported, whatever the time
+  for (int k = 0; k < 10; k++)
+  {
+    buffer(1000);
+    epsilon &= reports.empty();
+  }
+  std::printf("epsilon: %s\n", epsilon ? "ok" : "FAILED");
+
+  // prepare() starts over: everything is reported again
+  reporter.prepare(1000., 10.);
+  buffer(1);
+  const bool restart = reports.size() == 3;
+  std::printf("restart: %s\n", restart ? "ok" : "FAILED");
+
+  return first && interval && epsilon && restart ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/process_adapter.hpp>
+#include <examples/Helpers/PerSample.hpp>
+#include <examples/Raw/PerSampleProcessor.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Checks that the per-sample processors give the same output when the host
+// passes the input of a channel as the output of another one, which the
+// adapter processes by blocks through a copy of the inputs
+static constexpr int frames = 150;
+static constexpr int blocks = 3;
+
+template <typename T>
+struct runner
+{
+  explicit runner(int channels)
+      : channels{channels}
+  {
+    const avnd::process_setup setup{
+        .input_channels = channels,
+        .output_channels = channels,
+        .frames_per_buffer = frames,
+        .rate = 48000.};
+    if constexpr (avnd::has_inputs<T>)
+      avnd::init_controls(impl.inputs());
+    processor.allocate_buffers(setup, float{});
+    impl.init_channels(channels, channels);
+    avnd::prepare(impl, setup);
+  }
+
+  void process(float** in, float** out)
+  {
+    processor.process(
+        impl, avnd::span<float*>{in, std::size_t(channels)},
+        avnd::span<float*>{out, std::size_t(channels)}, frames);
+  }
+
+  int channels{};
+  avnd::effect_container<T> impl;
+  avnd::process_adapter<T> processor;
+};
+
+static float input(int channel, int frame)
+{
+  return 0.7f * std::sin(0.013f * (channel + 1) * frame + channel);
+}
+
+template <typename T>
+static bool check(const char* name, int channels)
+{
+  runner<T> separate{channels}, crossed{channels};
+
+  std::vector<std::vector<float>> a(channels), b(channels), shared(channels);
+  std::vector<float*> in(channels), out(channels), crossed_in(channels), crossed_out(channels);
+
+  bool ok = true;
+  for (int k = 0; k < blocks; k++)
+  {
+    for (int c = 0; c < channels; c++)
+    {
+      a[c].resize(frames);
+      b[c].resize(frames);
+      shared[c].resize(frames);
+      for (int i = 0; i < frames; i++)
+        a[c][i] = input(c, k * frames + i);
+      in[c] = a[c].data();
+      out[c] = b[c].data();
+    }
+
+    // Channel c is written where the input of channel c + 1 was
+    for (int c = 0; c < channels; c++)
+    {
+      shared[c] = a[c];
+      crossed_in[c] = shared[c].data();
+      crossed_out[c] = shared[(c + 1) % channels].data();
+    }
+
+    separate.process(in.data(), out.data());
+    crossed.process(crossed_in.data(), crossed_out.data());
+
+    for (int c = 0; c < channels; c++)
+      for (int i = 0; i < frames; i++)
+        ok &= crossed_out[c][i] == out[c][i];
+  }
+
+  std::printf("%s, %d channels: %s\n", name, channels, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main()
+{
+  bool ok = true;
+  for (int channels : {2, 3})
+  {
+    ok &= check<examples::PerSampleProcessor>("PerSampleProcessor", channels);
+    ok &= check<examples::helpers::PerSampleAsArgs>("PerSampleAsArgs", channels);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+#include <avnd/wrappers/quality_governor.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+
+// Checks that the quality steps down when the buffers take too long,
+// and back up once there is headroom again
+struct Shaper
+{
+  halp_meta(name, "Shaper")
+  halp_meta(quality_levels, 3)
+
+  int quality{-1};
+
+  float operator()(float x) { return x; }
+};
+
+struct Gain
+{
+  halp_meta(name, "Gain")
+
+  float operator()(float x) { return x; }
+};
+
+static_assert(avnd::has_quality_levels<Shaper>);
+static_assert(!avnd::has_quality_levels<Gain>);
+
+static constexpr int frames = 480;
+
+// 480 frames at 48kHz: 10ms
+static void run(avnd::quality_governor<Shaper>& g, double load, int buffers)
+{
+  for (int i = 0; i < buffers; i++)
+    g.record(frames, uint64_t(load * 1e7));
+}
+
+static bool all_at(avnd::effect_container<Shaper>& shaper, int level)
+{
+  bool ok = true;
+  for (auto& e : shaper.effects())
+    ok &= e.quality == level;
+  return ok;
+}
+
+int main()
+{
+  avnd::effect_container<Shaper> shaper;
+  shaper.init_channels(3, 3);
+  avnd::quality_governor<Shaper> governor;
+  governor.prepare(48000.);
+
+  // The best quality to begin with, for every instance
+  governor.apply(shaper);
+  bool start = governor.level() == 2 && all_at(shaper, 2);
+  std::printf("start: %s\n", start ? "ok" : "FAILED");
+
+  // A single slow buffer is not enough
+  run(governor, 0.3, 30);
+  run(governor, 0.9, 1);
+  run(governor, 0.3, 30);
+  bool spike = governor.level() == 2;
+  std::printf("spike: %s\n", spike ? "ok" : "FAILED");
+
+  // Over the budget: one level at a time, then not below the cheapest
+  run(governor, 0.8, 2);
+  bool down = governor.level() == 1;
+  governor.apply(shaper);
+  down &= all_at(shaper, 1);
+  run(governor, 0.8, 5);
+  down &= governor.level() == 1;
+  run(governor, 0.8, 100);
+  down &= governor.level() == 0;
+  governor.apply(shaper);
+  down &= all_at(shaper, 0);
+  std::printf("down: %s\n", down ? "ok" : "FAILED");
+
+  // Between the budget and half of it: stays there
+  run(governor, 0.4, 1000);
+  bool hold = governor.level() == 0;
+  std::printf("hold: %s\n", hold ? "ok" : "FAILED");
+
+  // Under half of the budget: back up after the recovery time, 200 buffers here
+  run(governor, 0.1, 150);
+  bool up = governor.level() == 0;
+  run(governor, 0.1, 100);
+  up &= governor.level() == 1;
+  run(governor, 0.1, 300);
+  up &= governor.level() == 2;
+  run(governor, 0.1, 300);
+  up &= governor.level() == 2;
+  std::printf("up: %s\n", up ? "ok" : "FAILED");
+
+  // Offline renders get the best quality whatever the load
+  run(governor, 0.8, 100);
+  bool offline = governor.level() == 0;
+  governor.set_render_mode(avnd::render_mode::offline);
+  run(governor, 5., 100);
+  governor.apply(shaper);
+  offline &= governor.level() == 2 && all_at(shaper, 2);
+  governor.set_render_mode(avnd::render_mode::realtime);
+  run(governor, 0.8, 2);
+  offline &= governor.level() == 1;
+  std::printf("offline: %s\n", offline ? "ok" : "FAILED");
+
+  // Nothing for the processors without levels
+  avnd::effect_container<Gain> gain;
+  avnd::quality_governor<Gain> none;
+  none.prepare(48000.);
+  none.apply(gain);
+  {
+    avnd::quality_scope<Gain> scope{none, frames};
+  }
+  bool opt_in = none.level() == 0;
+  std::printf("opt-in: %s\n", opt_in ? "ok" : "FAILED");
+
+  return start && spike && down && hold && up && offline && opt_in ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+#include <halp/random.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static_assert(std::uniform_random_bit_generator<halp::xoshiro128>);
+static_assert(std::uniform_random_bit_generator<halp::pcg32>);
+
+// Reference values of the authors' implementations
+static bool check_reference()
+{
+  bool ok = true;
+
+  // pcg32_srandom_r(&rng, 42, 54)
+  halp::pcg32 pcg{42, 54};
+  const uint32_t pcg_expected[]{0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293};
+  for (uint32_t e : pcg_expected)
+    ok &= pcg() == e;
+
+  // discard(n) is n calls
+  halp::pcg32 a{7}, b{7};
+  for (int i = 0; i < 1000; i++)
+    a();
+  b.discard(1000);
+  ok &= a() == b();
+
+  // Random123 known answers for philox4x32_10
+  const auto zero = halp::philox4x32::generate({0, 0, 0, 0}, {0, 0});
+  ok &= zero == halp::philox4x32::block{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8};
+  const auto ones = halp::philox4x32::generate(
+      {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff});
+  ok &= ones == halp::philox4x32::block{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd};
+  return ok;
+}
+
+static bool check_lanes()
+{
+  // Each lane of the block generator is a xoshiro128 from the lane state
+  bool ok = true;
+  halp::xoshiro128x8 block{1234};
+  std::vector<uint32_t> bits(8 * 100);
+  const auto s3 = block.lane_state(3);
+  block.fill_bits(bits);
+  uint32_t s[4]{s3[0], s3[1], s3[2], s3[3]};
+  for (int i = 0; i < 100; i++)
+  {
+    const uint32_t result = std::rotl(s[0] + s[3], 7) + s[0];
+    const uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = std::rotl(s[3], 11);
+    ok &= bits[i * 8 + 3] == result;
+  }
+  return ok;
+}
+
+template <typename FP>
+static bool check_distributions()
+{
+  bool ok = true;
+  halp::xoshiro128x8 gen{99};
+  std::vector<FP> v(100003);
+
+  gen.fill_uniform(avnd::span<FP>(v), FP(-2), FP(3));
+  double sum = 0.;
+  for (FP x : v)
+  {
+    ok &= x >= FP(-2) && x < FP(3);
+    sum += x;
+  }
+  ok &= std::abs(sum / v.size() - 0.5) < 0.02;
+
+  gen.fill_gaussian(avnd::span<FP>(v), FP(1), FP(2));
+  double mean = 0., var = 0.;
+  for (FP x : v)
+  {
+    ok &= std::isfinite(x);
+    mean += x;
+  }
+  mean /= v.size();
+  for (FP x : v)
+    var += (x - mean) * (x - mean);
+  var /= v.size();
+  ok &= std::abs(mean - 1.) < 0.03 && std::abs(var - 4.) < 0.1;
+  return ok;
+}
+
+static bool check_philox_streams()
+{
+  // A stream split in any blocks gives the same values
+  bool ok = true;
+  const halp::philox4x32 gen{0xC0FFEE};
+  std::vector<float> whole(1000), parts(1000);
+  gen.fill_uniform(avnd::span<float>(whole), 5, 3);
+  int first = 0;
+  for (int size : {1, 2, 3, 7, 13, 100, 874})
+  {
+    gen.fill_uniform(avnd::span<float>(parts.data() + first, size), 5 + first, 3);
+    first += size;
+  }
+  ok &= first == 1000 && whole == parts;
+
+  // Another stream is another sequence
+  gen.fill_uniform(avnd::span<float>(parts), 5, 4);
+  ok &= whole != parts;
+  ok &= gen.at(21, 3) >> 8 == uint32_t(whole[16] * 0x1p24f);
+  return ok;
+}
+
+static bool check_std()
+{
+  // Works with the standard distributions
+  halp::pcg32 gen{1};
+  std::uniform_int_distribution<int> dist{1, 6};
+  bool ok = true;
+  for (int i = 0; i < 1000; i++)
+  {
+    const int d = dist(gen);
+    ok &= d >= 1 && d <= 6;
+  }
+  halp::xoshiro128 x{1};
+  for (int i = 0; i < 1000; i++)
+  {
+    const float u = x.uniform();
+    const double b = x.bipolar<double>();
+    ok &= u >= 0.f && u < 1.f && b >= -1. && b < 1.;
+  }
+  return ok;
+}
+
+int main()
+{
+  const bool reference = check_reference();
+  const bool lanes = check_lanes();
+  const bool distributions = check_distributions<float>() && check_distributions<double>();
+  const bool streams = check_philox_streams();
+  const bool std_compat = check_std();
+  std::printf("reference: %s\n", reference ? "ok" : "FAILED");
+  std::printf("lanes: %s\n", lanes ? "ok" : "FAILED");
+  std::printf("distributions: %s\n", distributions ? "ok" : "FAILED");
+  std::printf("philox streams: %s\n", streams ? "ok" : "FAILED");
+  std::printf("std: %s\n", std_compat ? "ok" : "FAILED");
+  return reference && lanes && distributions && streams && std_compat ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#include <avnd/wrappers/realtime_sanitizer.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Checks that the calls which may block are counted in a realtime scope
+// and only there, with the sanitizer in log mode
+static std::vector<float>* volatile g_sink{};
+static std::mutex g_mutex;
+
+static void allocate()
+{
+  g_sink = new std::vector<float>(64);
+  delete g_sink;
+  g_sink = nullptr;
+}
+
+static void lock()
+{
+  std::lock_guard _{g_mutex};
+}
+
+template <typename F>
+static uint64_t violations(F f)
+{
+  const uint64_t before = avnd_rt_sanitizer_violations();
+  f();
+  return avnd_rt_sanitizer_violations() - before;
+}
+
+static bool check(const char* what, uint64_t count, bool expected)
+{
+  const bool ok = (count > 0) == expected;
+  std::printf("%s: %d violations%s\n", what, int(count), ok ? "" : " FAILED");
+  return ok;
+}
+
+int main()
+{
+  avnd_rt_sanitizer_set_mode(avnd_rt_sanitizer_log);
+
+  bool ok = true;
+  ok &= check("allocation outside", violations(allocate), false);
+  ok &= check("lock outside", violations(lock), false);
+  ok &= check("allocation", violations([] {
+    avnd::realtime_scope rt;
+    allocate();
+  }), true);
+  ok &= check("lock", violations([] {
+    avnd::realtime_scope rt;
+    lock();
+  }), true);
+  ok &= check("allocation exempted", violations([] {
+    avnd::realtime_scope rt;
+    avnd::realtime_exempt ex;
+    allocate();
+  }), false);
+  ok &= check("nothing", violations([] {
+    avnd::realtime_scope rt;
+    for (int i = 0; i < 64; i++)
+      g_sink = nullptr;
+  }), false);
+  return ok ? 0 : 1;
+}
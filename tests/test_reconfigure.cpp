@@ -0,0 +1,102 @@
+#include <avnd/wrappers/prepare.hpp>
+#include <halp/audio.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+
+// Checks that processors are told what changed in the setup since their previous prepare
+struct Probe
+{
+  halp_meta(name, "Probe")
+
+  struct
+  {
+    halp::dynamic_audio_bus<"In", float> audio;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Out", float> audio;
+  } outputs;
+
+  void prepare(halp::setup info)
+  {
+    changed = info.changed;
+    prepares++;
+  }
+
+  void operator()(int frames) { }
+
+  avnd::setup_change changed{};
+  int prepares{};
+};
+
+// Older setups without the field still get prepared
+struct Legacy
+{
+  halp_meta(name, "Legacy")
+  struct setup
+  {
+    double rate{};
+  };
+  void prepare(setup info) { rate = info.rate; }
+  float operator()(float x) { return x; }
+  double rate{};
+};
+
+static bool same(avnd::setup_change a, avnd::setup_change b)
+{
+  return a.rate == b.rate && a.frames == b.frames && a.channels == b.channels
+         && a.mode == b.mode;
+}
+
+int main()
+{
+  const avnd::process_setup base{
+      .input_channels = 2, .output_channels = 2, .frames_per_buffer = 512, .rate = 48000.};
+
+  // What changed between two setups
+  bool changes = same(avnd::changes_between({}, base), {});
+  changes &= !avnd::changes_between(base, base).any();
+  auto other = base;
+  other.rate = 44100.;
+  changes &= same(avnd::changes_between(base, other), {true, false, false, false});
+  other = base;
+  other.frames_per_buffer = 64;
+  changes &= same(avnd::changes_between(base, other), {false, true, false, false});
+  other = base;
+  other.output_channels = 1;
+  changes &= same(avnd::changes_between(base, other), {false, false, true, false});
+  other = base;
+  other.mode = avnd::render_mode::offline;
+  changes &= same(avnd::changes_between(base, other), {false, false, false, true});
+  std::printf("changes: %s\n", changes ? "ok" : "FAILED");
+
+  // What the processor is told
+  avnd::effect_container<Probe> fx;
+  avnd::process_setup current{};
+  bool reconfigure = avnd::reconfigure(fx, current, base).any();
+  reconfigure &= same(fx.effect.changed, {}) && current.rate == 48000.;
+
+  // e.g. toggling the DSP off and on
+  reconfigure &= !avnd::reconfigure(fx, current, base).any();
+  reconfigure &= !fx.effect.changed.any() && fx.effect.prepares == 2;
+
+  other = base;
+  other.frames_per_buffer = 128;
+  avnd::reconfigure(fx, current, other);
+  reconfigure &= same(fx.effect.changed, {false, true, false, false});
+
+  // Hosts which do not track it: everything changed
+  avnd::prepare(fx, other);
+  reconfigure &= same(fx.effect.changed, {});
+
+  avnd::effect_container<Legacy> legacy;
+  avnd::process_setup legacy_setup{};
+  legacy.init_channels(1, 1);
+  avnd::reconfigure(legacy, legacy_setup, base);
+  reconfigure &= legacy.effect[0].rate == 48000.;
+  std::printf("reconfigure: %s\n", reconfigure ? "ok" : "FAILED");
+
+  return changes && reconfigure ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+#include <avnd/introspection/midi.hpp>
+#include <avnd/wrappers/bypass.hpp>
+#include <avnd/wrappers/controls.hpp>
+#include <avnd/wrappers/controls_storage.hpp>
+#include <avnd/wrappers/effect_container.hpp>
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+#include <halp/midi.hpp>
+#include <halp/sample_accurate_controls.hpp>
+
+#include <cstdio>
+#include <vector>
+
+// Checks that what the bindings allocate when the host activates a processor
+// is freed when it deactivates it, and allocated again on the next activation
+static constexpr int frames = 64;
+
+struct Notes
+{
+  halp_meta(name, "Notes")
+
+  struct
+  {
+    struct
+    {
+      static consteval auto name() { return "Raw"; }
+      struct
+      {
+        uint8_t bytes[3]{};
+        int timestamp{};
+      }* midi_messages{};
+      std::size_t size{};
+    } raw;
+    halp::midi_bus<"Keys"> keys;
+    halp::accurate<halp::val_port<"Value", float>> value;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  void operator()() { }
+};
+
+// Duplicated for each channel
+struct Gain
+{
+  halp_meta(name, "Gain")
+
+  struct inputs
+  {
+    halp::audio_sample<"In", float> audio;
+    halp::hslider_f32<"Gain", halp::range{.min = 0., .max = 1., .init = 1.}> gain;
+  };
+
+  struct outputs
+  {
+    halp::audio_sample<"Out", float> audio;
+  };
+
+  void operator()(const inputs& ins, outputs& outs)
+  {
+    outs.audio.sample = ins.gain * ins.audio.sample;
+  }
+};
+
+// Duplicated for each channel, with its controls in each instance
+struct Offset
+{
+  halp_meta(name, "Offset")
+
+  struct
+  {
+    halp::audio_channel<"In", float> audio;
+    halp::hslider_f32<"Offset", halp::range{.min = 0., .max = 1., .init = 0.}> offset;
+  } inputs;
+
+  struct
+  {
+    halp::audio_channel<"Out", float> audio;
+  } outputs;
+
+  void operator()(int n)
+  {
+    for (int i = 0; i < n; i++)
+      outputs.audio[i] = inputs.audio[i] + inputs.offset;
+  }
+};
+
+static bool check_storages()
+{
+  bool ok = true;
+  avnd::effect_container<Notes> impl;
+  avnd::midi_storage<Notes> midi;
+  avnd::control_storage<Notes> controls;
+  auto& in = impl.effect.inputs;
+
+  for (int activation = 0; activation < 2; activation++)
+  {
+    midi.reserve_space(impl, frames);
+    controls.reserve_space(impl, frames);
+    ok &= in.raw.midi_messages != nullptr && in.value.values.empty();
+    in.raw.midi_messages[frames - 1].bytes[0] = 0x90;
+    in.keys.push_back({.bytes = {0x90, 60, 100}, .timestamp = 1});
+    in.value.values[3] = 0.5f;
+
+    midi.release(impl);
+    controls.release(impl);
+    ok &= in.raw.midi_messages == nullptr && in.raw.size == 0;
+    ok &= in.keys.midi_messages.empty() && in.value.values.empty();
+  }
+  return ok;
+}
+
+static bool check_channels()
+{
+  // Created with a single instance, then one per channel
+  bool ok = true;
+  avnd::effect_container<Gain> impl;
+  avnd::bypass_adapter<Gain> processor;
+  impl.init_channels(1, 1);
+  avnd::init_controls(impl.inputs());
+  impl.inputs().gain.value = 0.5f;
+
+  const avnd::process_setup setup{
+      .input_channels = 2, .output_channels = 2, .frames_per_buffer = frames, .rate = 48000.};
+  std::vector<float> in(2 * frames, 1.f), out(2 * frames);
+  float* ins[]{in.data(), in.data() + frames};
+  float* outs[]{out.data(), out.data() + frames};
+
+  for (int activation = 0; activation < 2; activation++)
+  {
+    processor.allocate_buffers(setup, float{});
+    impl.init_channels(2, 2);
+    avnd::prepare(impl, setup);
+    processor.reserve_delay(avnd::latency_samples(impl));
+    ok &= impl.effect.size() == 2;
+
+    std::fill(out.begin(), out.end(), 0.f);
+    processor.process(impl, avnd::span<float*>{ins}, avnd::span<float*>{outs}, frames);
+    for (float x : out)
+      ok &= x == 0.5f;
+
+    processor.release_buffers();
+    avnd::release_channels(impl);
+    ok &= impl.effect.size() == 1;
+  }
+
+  // The controls of the instances are kept by the first one
+  avnd::effect_container<Offset> offsets;
+  offsets.init_channels(1, 1);
+  offsets.effect[0].inputs.offset.value = 0.25f;
+  offsets.init_channels(4, 4);
+  avnd::release_channels(offsets);
+  ok &= offsets.effect.size() == 1 && offsets.effect[0].inputs.offset.value == 0.25f;
+  offsets.init_channels(3, 3);
+  for (auto& e : offsets.effects())
+    ok &= e.inputs.offset.value == 0.25f;
+  return ok;
+}
+
+int main()
+{
+  const bool storages = check_storages();
+  const bool channels = check_channels();
+  std::printf("storages: %s\n", storages ? "ok" : "FAILED");
+  std::printf("channels: %s\n", channels ? "ok" : "FAILED");
+  return storages && channels ? 0 : 1;
+}
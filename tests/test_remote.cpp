@@ -0,0 +1,270 @@
+#include <avnd/binding/standalone/remote.hpp>
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+#include <memory>
+
+// Gain on 2 channels
+struct RemoteGain
+{
+  halp_meta(name, "Remote gain")
+  halp_meta(c_name, "remote_gain")
+
+  struct
+  {
+    halp::fixed_audio_bus<"In", float, 2> audio;
+    halp::hslider_f32<"Gain", halp::range{.min = 0., .max = 4., .init = 1.}> gain;
+  } inputs;
+
+  struct
+  {
+    halp::fixed_audio_bus<"Out", float, 2> audio;
+  } outputs;
+
+  void operator()(int frames)
+  {
+    for (int c = 0; c < 2; c++)
+      for (int i = 0; i < frames; i++)
+        outputs.audio[c][i] = inputs.gain * inputs.audio[c][i];
+  }
+};
+
+// Loses the packets it is told to, like a network
+struct lossy_transport final : standalone::remote_transport
+{
+  standalone::remote_transport& impl;
+  int count = 0;
+  int lose = -1;
+
+  explicit lossy_transport(standalone::remote_transport& t)
+      : impl{t}
+  {
+  }
+
+  bool send(const std::byte* data, std::size_t size) noexcept override
+  {
+    if (count++ == lose)
+      return true;
+    return impl.send(data, size);
+  }
+  std::size_t receive(std::byte* data, std::size_t capacity) noexcept override
+  {
+    return impl.receive(data, capacity);
+  }
+};
+
+static constexpr int frames = 64;
+static constexpr int latency = 128;
+
+// The input of frame i
+static float ramp(int64_t i)
+{
+  return float(i % 1000) / 1000.f;
+}
+
+struct node_pair
+{
+  std::unique_ptr<standalone::remote_packet_ring> to_remote
+      = std::make_unique<standalone::remote_packet_ring>();
+  std::unique_ptr<standalone::remote_packet_ring> to_proxy
+      = std::make_unique<standalone::remote_packet_ring>();
+  standalone::shared_memory_transport local{*to_remote, *to_proxy};
+  standalone::shared_memory_transport remote{*to_proxy, *to_remote};
+  lossy_transport lossy{remote};
+
+  standalone::remote_proxy<RemoteGain> proxy{
+      "gain", local, {.latency_frames = latency, .keyframe_interval = 4}};
+  standalone::remote_host<RemoteGain> host{lossy};
+
+  float in_buf[2][frames]{}, out_buf[2][frames]{};
+  float* ins[2]{in_buf[0], in_buf[1]};
+  float* outs[2]{out_buf[0], out_buf[1]};
+  int64_t position = 0;
+
+  node_pair()
+  {
+    proxy.prepare(48000., frames);
+    host.prepare(48000., frames);
+  }
+
+  // One buffer of the audio thread on the local node, then the remote node runs
+  void step()
+  {
+    for (int i = 0; i < frames; i++)
+      in_buf[0][i] = in_buf[1][i] = ramp(position + i);
+    proxy.process(ins, outs, frames);
+    host.poll();
+    position += frames;
+  }
+};
+
+static bool check_round_trip()
+{
+  bool ok = true;
+  node_pair nodes;
+  ok &= nodes.proxy.latency() == latency;
+  nodes.proxy.effect.inputs().gain.value = 2.f;
+
+  for (int b = 0; b < 20; b++)
+  {
+    nodes.step();
+    for (int i = 0; i < frames; i++)
+    {
+      const int64_t source = nodes.position - frames + i - latency;
+      const float expected = source < 0 ? 0.f : 2.f * ramp(source);
+      ok &= std::abs(nodes.out_buf[0][i] - expected) < 1e-5f;
+      ok &= std::abs(nodes.out_buf[1][i] - expected) < 1e-5f;
+    }
+  }
+  ok &= std::abs(nodes.host.effect.inputs().gain.value - 2.f) < 1e-5f;
+  ok &= nodes.proxy.stats.dropped_frames == 0 && nodes.proxy.stats.late_packets == 0;
+  ok &= nodes.proxy.stats.sent_packets == 20 && nodes.host.stats.received_packets == 20;
+  return ok;
+}
+
+static bool check_loss()
+{
+  bool ok = true;
+  node_pair nodes;
+
+  // The outputs of the 4th block never come back: they are silent when due
+  nodes.lossy.lose = 3;
+  for (int b = 0; b < 10; b++)
+  {
+    nodes.step();
+    const int64_t first = nodes.position - frames - latency;
+    const bool lost = first == 3 * frames;
+    for (int i = 0; i < frames; i++)
+    {
+      const float expected = first < 0 || lost ? 0.f : ramp(first + i);
+      ok &= std::abs(nodes.out_buf[0][i] - expected) < 1e-5f;
+    }
+  }
+  ok &= nodes.proxy.stats.dropped_frames == frames;
+  ok &= nodes.proxy.stats.received_packets == 8;
+  return ok;
+}
+
+static bool check_late()
+{
+  bool ok = true;
+  node_pair nodes;
+
+  // The remote node stalls for longer than the latency: the first outputs are late
+  for (int b = 0; b < 4; b++)
+  {
+    for (int i = 0; i < frames; i++)
+      nodes.in_buf[0][i] = nodes.in_buf[1][i] = ramp(nodes.position + i);
+    nodes.proxy.process(nodes.ins, nodes.outs, frames);
+    nodes.position += frames;
+  }
+  nodes.host.poll();
+  nodes.step();
+  nodes.step();
+
+  ok &= nodes.proxy.stats.late_packets == 2;
+  ok &= nodes.proxy.stats.dropped_frames == 2 * frames;
+
+  // And the stream carries on
+  for (int i = 0; i < frames; i++)
+    ok &= std::abs(nodes.out_buf[0][i] - ramp(nodes.position - frames - latency + i)) < 1e-5f;
+  return ok;
+}
+
+static bool check_controls()
+{
+  bool ok = true;
+  node_pair nodes;
+
+  // A lost change is sent again with the next keyframe
+  nodes.lossy.lose = -1;
+  nodes.step();
+  nodes.proxy.effect.inputs().gain.value = 3.f;
+
+  // Packets from the proxy are not lost by lossy, which is on the remote side:
+  // drop the one carrying the change on the ring instead
+  nodes.proxy.process(nodes.ins, nodes.outs, frames);
+  std::byte discard[standalone::remote_max_packet];
+  ok &= nodes.to_remote->pop(discard, sizeof(discard)) > 0;
+  ok &= nodes.host.effect.inputs().gain.value == 1.f;
+
+  for (int b = 0; b < 4; b++)
+    nodes.step();
+  ok &= std::abs(nodes.host.effect.inputs().gain.value - 3.f) < 1e-5f;
+  return ok;
+}
+
+static bool check_split()
+{
+  // Blocks larger than a packet are split
+  bool ok = true;
+  node_pair nodes;
+  constexpr int big = 16384;
+  std::vector<float> in(2 * big), out(2 * big);
+  float* ins[2]{in.data(), in.data() + big};
+  float* outs[2]{out.data(), out.data() + big};
+  nodes.proxy.prepare(48000., big);
+  nodes.host.prepare(48000., big);
+  nodes.proxy.process(ins, outs, big);
+  ok &= nodes.proxy.stats.sent_packets > 1;
+  ok &= nodes.host.poll() == int(nodes.proxy.stats.sent_packets.load());
+  return ok;
+}
+
+#if AVND_STANDALONE_UDP
+static bool check_udp()
+{
+  standalone::udp_transport remote{0};
+  if (!remote.valid())
+    return true;
+  standalone::udp_transport local{0, "127.0.0.1", remote.local_port()};
+
+  const std::byte ping[4]{std::byte{1}, std::byte{2}, std::byte{3}, std::byte{4}};
+  std::byte buf[16]{};
+  bool ok = local.send(ping, 4);
+  std::size_t n = 0;
+  for (int i = 0; i < 1000 && n == 0; i++)
+  {
+    n = remote.receive(buf, sizeof(buf));
+    if (n == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ok &= n == 4 && buf[3] == std::byte{4};
+
+  // Answered to the sender
+  ok &= remote.send(ping, 2);
+  n = 0;
+  for (int i = 0; i < 1000 && n == 0; i++)
+  {
+    n = local.receive(buf, sizeof(buf));
+    if (n == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ok &= n == 2;
+  return ok;
+}
+#else
+static bool check_udp()
+{
+  return true;
+}
+#endif
+
+int main()
+{
+  const bool round_trip = check_round_trip();
+  const bool loss = check_loss();
+  const bool late = check_late();
+  const bool controls = check_controls();
+  const bool split = check_split();
+  const bool udp = check_udp();
+  std::printf("round trip: %s\n", round_trip ? "ok" : "FAILED");
+  std::printf("loss: %s\n", loss ? "ok" : "FAILED");
+  std::printf("late: %s\n", late ? "ok" : "FAILED");
+  std::printf("controls: %s\n", controls ? "ok" : "FAILED");
+  std::printf("split: %s\n", split ? "ok" : "FAILED");
+  std::printf("udp: %s\n", udp ? "ok" : "FAILED");
+  return round_trip && loss && late && controls && split && udp ? 0 : 1;
+}
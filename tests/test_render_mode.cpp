@@ -0,0 +1,76 @@
+#include <avnd/wrappers/prepare.hpp>
+#include <avnd/wrappers/render_mode.hpp>
+#include <halp/audio.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+
+// Checks that processors get the render mode of the host with prepare,
+// and when it changes while running
+struct Reverb
+{
+  halp_meta(name, "Reverb")
+
+  struct
+  {
+    halp::dynamic_audio_bus<"In", float> audio;
+  } inputs;
+
+  struct
+  {
+    halp::dynamic_audio_bus<"Out", float> audio;
+  } outputs;
+
+  halp::render_mode render_mode{};
+  bool prepared_offline{};
+
+  void prepare(halp::setup s) { prepared_offline = s.offline; }
+  void operator()(int frames) { }
+};
+
+// Duplicated for each channel
+struct Shaper
+{
+  halp_meta(name, "Shaper")
+
+  halp::render_mode render_mode{};
+
+  float operator()(float x) { return x; }
+};
+
+static_assert(avnd::has_render_mode<Reverb>);
+static_assert(avnd::has_render_mode<Shaper>);
+
+int main()
+{
+  bool ok = true;
+  avnd::effect_container<Reverb> reverb;
+  avnd::prepare(reverb, {.frames_per_buffer = 64, .rate = 48000.});
+  ok &= !reverb.effect.prepared_offline
+        && reverb.effect.render_mode == avnd::render_mode::realtime;
+
+  avnd::prepare(
+      reverb, {.frames_per_buffer = 64, .rate = 48000., .mode = avnd::render_mode::offline});
+  ok &= reverb.effect.prepared_offline
+        && reverb.effect.render_mode == avnd::render_mode::offline;
+  std::printf("prepare: %s\n", ok ? "ok" : "FAILED");
+
+  // Asked from another thread, given at the next buffer to every instance
+  bool running = true;
+  avnd::effect_container<Shaper> shaper;
+  shaper.init_channels(3, 3);
+  avnd::render_mode_request request;
+  request.set(avnd::render_mode::offline);
+  for (auto& e : shaper.effects())
+    running &= e.render_mode == avnd::render_mode::realtime;
+  request.apply(shaper);
+  for (auto& e : shaper.effects())
+    running &= e.render_mode == avnd::render_mode::offline;
+  request.set(avnd::render_mode::realtime);
+  request.apply(shaper);
+  for (auto& e : shaper.effects())
+    running &= e.render_mode == avnd::render_mode::realtime;
+  std::printf("running: %s\n", running ? "ok" : "FAILED");
+
+  return ok && running ? 0 : 1;
+}
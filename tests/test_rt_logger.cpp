@@ -0,0 +1,36 @@
+#include <halp/log.hpp>
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Checks that halp::rt_logger writes what is logged from many threads,
+// later and in full, and drops what does not fit in its queue
+int main()
+{
+  halp::rt_logger::start();
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++)
+    threads.emplace_back([t] {
+      const std::string name = "thread " + std::to_string(t);
+      for (int i = 0; i < 100; i++)
+        halp::rt_logger::info("{}: message {} of {:.1f}", name, i, 100.);
+    });
+  for (auto& t : threads)
+    t.join();
+  halp::rt_logger::flush();
+
+  const bool none_dropped = halp::rt_logger::dropped() == 0;
+  std::printf("messages from many threads: %s\n", none_dropped ? "ok" : "FAILED");
+
+  // Many more than the queue holds at once, faster than they can be written
+  for (int i = 0; i < 20 * int(halp::rt_log_queue::capacity); i++)
+    halp::rt_logger::debug("burst {}", i);
+  halp::rt_logger::flush();
+
+  const bool dropped = halp::rt_logger::dropped() > 0;
+  std::printf("messages dropped when full: %s\n", dropped ? "ok" : "FAILED");
+  return none_dropped && dropped ? 0 : 1;
+}
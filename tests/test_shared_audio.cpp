@@ -0,0 +1,267 @@
+#include <avnd/binding/standalone/shared_audio.hpp>
+#include <halp/audio.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+#include <vector>
+
+// Gain on 2 channels
+struct SharedGain
+{
+  halp_meta(name, "Shared gain")
+  halp_meta(c_name, "shared_gain")
+
+  struct
+  {
+    halp::fixed_audio_bus<"In", float, 2> audio;
+    halp::hslider_f32<"Gain", halp::range{.min = 0., .max = 4., .init = 1.}> gain;
+  } inputs;
+
+  struct
+  {
+    halp::fixed_audio_bus<"Out", float, 2> audio;
+  } outputs;
+
+  void operator()(int frames)
+  {
+    for (int c = 0; c < 2; c++)
+      for (int i = 0; i < frames; i++)
+        outputs.audio[c][i] = inputs.gain * inputs.audio[c][i];
+  }
+};
+
+static constexpr int frames = 64;
+static constexpr standalone::shared_audio_format format{
+    .channels = 2, .frames = frames, .blocks = 4};
+
+// The input of frame i
+static float ramp(int64_t i)
+{
+  return float(i % 1000) / 1000.f;
+}
+
+// Segment-like memory for a stream
+struct stream_memory
+{
+  struct alignas(64) line
+  {
+    std::byte bytes[64];
+  };
+  std::vector<line> storage;
+  standalone::shared_audio_stream* stream{};
+
+  explicit stream_memory(const standalone::shared_audio_format& f = format)
+  {
+    storage.resize(standalone::shared_audio_stream::bytes_for(f) / sizeof(line) + 1);
+    stream = standalone::shared_audio_stream::create(storage.data(), f);
+  }
+};
+
+static bool check_zero_copy()
+{
+  bool ok = true;
+  stream_memory mem;
+  standalone::shared_audio_writer writer{*mem.stream};
+  standalone::shared_audio_reader reader{*mem.stream};
+
+  ok &= reader.acquire() == nullptr;
+  for (int b = 0; b < 4; b++)
+  {
+    float* const* out = writer.acquire();
+    ok &= out != nullptr;
+    if (!out)
+      return false;
+    ok &= reinterpret_cast<uintptr_t>(out[0]) % 64 == 0;
+    for (int i = 0; i < frames; i++)
+      out[0][i] = out[1][i] = ramp(b * frames + i);
+    writer.commit(b == 3 ? frames / 2 : frames);
+  }
+
+  // Ring full
+  ok &= writer.acquire() == nullptr && writer.overruns == 1;
+  ok &= mem.stream->queued() == 4;
+
+  for (int b = 0; b < 4; b++)
+  {
+    const float* const* in = reader.acquire();
+    ok &= in != nullptr;
+    if (!in)
+      return false;
+    // The same memory the writer rendered in
+    ok &= in[0] == mem.stream->channel(b, 0);
+    ok &= reader.position() == uint64_t(b * frames);
+    ok &= reader.frames() == (b == 3 ? frames / 2 : frames);
+    for (int i = 0; i < reader.frames(); i++)
+      ok &= in[1][i] == ramp(b * frames + i);
+    reader.release();
+  }
+  ok &= reader.acquire() == nullptr && mem.stream->queued() == 0;
+  return ok;
+}
+
+static bool check_threads()
+{
+  // A writer and a reader which sleep on each other, like two processes
+  bool ok = true;
+  stream_memory mem;
+  constexpr int blocks = 2000;
+
+  std::thread writer_thread{[&] {
+    standalone::shared_audio_writer writer{*mem.stream};
+    for (int b = 0; b < blocks; b++)
+    {
+      if (!writer.wait_for_space(std::chrono::seconds(5)))
+        return;
+      float* const* out = writer.acquire();
+      for (int i = 0; i < frames; i++)
+        out[0][i] = out[1][i] = ramp(int64_t(b) * frames + i);
+      writer.commit(frames);
+    }
+  }};
+
+  standalone::shared_audio_reader reader{*mem.stream};
+  int received = 0;
+  for (; received < blocks; received++)
+  {
+    if (!reader.wait(std::chrono::seconds(5)))
+      break;
+    const float* const* in = reader.acquire();
+    const int64_t first = int64_t(reader.position());
+    ok &= first == int64_t(received) * frames;
+    for (int i = 0; i < frames; i++)
+      ok &= in[0][i] == ramp(first + i);
+    reader.release();
+  }
+  writer_thread.join();
+  ok &= received == blocks;
+  return ok;
+}
+
+static bool check_node()
+{
+  // source -> [gain] -> sink, where the gain is the process of a chain
+  bool ok = true;
+  stream_memory to_gain, from_gain;
+  standalone::shared_audio_writer source{*to_gain.stream};
+  standalone::shared_audio_reader sink{*from_gain.stream};
+  standalone::shared_audio_node<SharedGain> node{to_gain.stream, from_gain.stream};
+  node.prepare(48000., frames);
+
+  // No block: nothing to do
+  ok &= !node.step(std::chrono::microseconds(100));
+
+  // The change applies from the block it was sent with
+  for (int b = 0; b < 3; b++)
+  {
+    if (b == 1)
+      ok &= source.push_control({.index = 0, .value = 0.5f});
+    float* const* out = source.acquire();
+    for (int i = 0; i < frames; i++)
+      out[0][i] = out[1][i] = ramp(b * frames + i);
+    source.commit(frames);
+
+    ok &= node.step(std::chrono::milliseconds(100));
+
+    const float gain = b == 0 ? 1.f : 2.f;
+    const float* const* in = sink.acquire();
+    ok &= in != nullptr;
+    if (!in)
+      return false;
+    for (int i = 0; i < frames; i++)
+      ok &= std::abs(in[1][i] - gain * ramp(b * frames + i)) < 1e-5f;
+    sink.release();
+  }
+  ok &= std::abs(node.effect.inputs().gain.value - 2.f) < 1e-5f;
+
+  // A sink which does not keep up: the blocks which do not fit are dropped
+  for (int b = 0; b < 6; b++)
+  {
+    source.acquire();
+    source.commit(frames);
+    ok &= node.step(std::chrono::milliseconds(100));
+  }
+  ok &= node.overruns() == 2 && from_gain.stream->queued() == 4;
+  return ok;
+}
+
+static bool check_channels()
+{
+  // A mono stream into the stereo gain: the second input is silent
+  bool ok = true;
+  stream_memory mono{{.channels = 1, .frames = frames, .blocks = 2}};
+  stream_memory out{{.channels = 3, .frames = frames, .blocks = 2}};
+  standalone::shared_audio_writer source{*mono.stream};
+  standalone::shared_audio_reader sink{*out.stream};
+  standalone::shared_audio_node<SharedGain> node{mono.stream, out.stream};
+  node.prepare(48000., frames);
+
+  float* const* src = source.acquire();
+  std::fill_n(src[0], frames, 0.25f);
+  source.commit(frames);
+  ok &= node.step(std::chrono::milliseconds(100));
+
+  const float* const* in = sink.acquire();
+  ok &= in != nullptr;
+  if (!in)
+    return false;
+  for (int i = 0; i < frames; i++)
+    ok &= in[0][i] == 0.25f && in[1][i] == 0.f && in[2][i] == 0.f;
+  return ok;
+}
+
+#if AVND_STANDALONE_SHM
+static bool check_segment()
+{
+  const std::string name = "/avnd-test-" + std::to_string(::getpid());
+  auto created
+      = standalone::shared_memory_segment::create(name, standalone::shared_audio_stream::bytes_for(format));
+  if (!created)
+    return true; // No /dev/shm here
+  auto* stream = standalone::shared_audio_stream::create(created.data(), format);
+
+  // Another mapping of the same segment, like another process would have
+  auto opened = standalone::shared_memory_segment::open(name);
+  bool ok = bool(opened);
+  if (!ok)
+    return false;
+  auto* other = standalone::shared_audio_stream::attach(opened.data(), opened.size());
+  ok &= other != nullptr && other != stream;
+  if (!other)
+    return false;
+  ok &= other->format().channels == 2 && other->format().frames == frames;
+
+  standalone::shared_audio_writer writer{*stream};
+  standalone::shared_audio_reader reader{*other};
+  float* const* out = writer.acquire();
+  out[1][5] = 0.75f;
+  writer.commit(frames);
+  ok &= reader.wait(std::chrono::milliseconds(100));
+  ok &= reader.acquire()[1][5] == 0.75f;
+
+  // Not a stream
+  std::byte junk[256]{};
+  ok &= standalone::shared_audio_stream::attach(junk, sizeof(junk)) == nullptr;
+  return ok;
+}
+#else
+static bool check_segment()
+{
+  return true;
+}
+#endif
+
+int main()
+{
+  const bool zero_copy = check_zero_copy();
+  const bool threads = check_threads();
+  const bool node = check_node();
+  const bool channels = check_channels();
+  const bool segment = check_segment();
+  std::printf("zero copy: %s\n", zero_copy ? "ok" : "FAILED");
+  std::printf("threads: %s\n", threads ? "ok" : "FAILED");
+  std::printf("node: %s\n", node ? "ok" : "FAILED");
+  std::printf("channels: %s\n", channels ? "ok" : "FAILED");
+  std::printf("segment: %s\n", segment ? "ok" : "FAILED");
+  return zero_copy && threads && node && channels && segment ? 0 : 1;
+}
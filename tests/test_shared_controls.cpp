@@ -0,0 +1,109 @@
+#include <avnd/binding/example/example_processor.hpp>
+#include <avnd/wrappers/shared_controls.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+#include <type_traits>
+
+// Checks that the controls of duplicated instances are written once,
+// and reach all the instances before they process
+struct Gain
+{
+  halp_meta(name, "Gain")
+
+  struct
+  {
+    halp::hslider_f32<"Gain", halp::range{.min = 0., .max = 10., .init = 1.}> gain;
+    halp::hslider_f32<"Offset", halp::range{.min = 0., .max = 10., .init = 0.}> offset;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  float operator()(float x) { return x * inputs.gain + inputs.offset; }
+};
+
+// Copying its label could allocate on the audio thread: each instance is written
+struct Labelled
+{
+  halp_meta(name, "Labelled")
+
+  struct
+  {
+    halp::lineedit<"Label", "foo"> label;
+    halp::hslider_f32<"Gain"> gain;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  float operator()(float x) { return x * inputs.gain; }
+};
+
+int main()
+{
+  static_assert(avnd::duplicated_inputs<Gain>);
+  static_assert(avnd::duplicated_inputs<Labelled>);
+  static_assert(std::is_empty_v<avnd::shared_controls<Labelled>>);
+  static_assert(!std::is_empty_v<avnd::shared_controls<Gain>>);
+
+  avnd::effect_container<Gain> fx;
+  fx.init_channels(4, 4);
+  avnd::shared_controls<Gain> controls;
+
+  // Several changes in a buffer: only the first instance is written
+  controls.write(fx, 0, [](auto& field) { field.value = 2.f; });
+  controls.write(fx, 0, [](auto& field) { field.value = 3.f; });
+  bool once = fx.effect[0].inputs.gain.value == 3.f && fx.effect[1].inputs.gain.value == 1.f
+              && fx.effect[3].inputs.gain.value == 1.f;
+
+  // Then copied once, only for the controls which changed
+  fx.effect[2].inputs.offset.value = 5.f;
+  controls.sync(fx);
+  once &= fx.effect[3].inputs.gain.value == 3.f && fx.effect[2].inputs.offset.value == 5.f;
+  fx.effect[2].inputs.gain.value = 7.f;
+  controls.sync(fx);
+  once &= fx.effect[2].inputs.gain.value == 7.f;
+
+  // By the index of the field, as the VST3 and ossia parameter ids
+  controls.write_raw(fx, 1, [](auto& field) { field.value = 6.f; });
+  controls.write_raw(fx, 2, [](auto& field) { field.value = 9.f; });
+  controls.sync(fx);
+  once &= fx.effect[1].inputs.offset.value == 6.f && fx.effect[3].inputs.offset.value == 6.f;
+  std::printf("once: %s\n", once ? "ok" : "FAILED");
+
+  // Without sharing, every instance is written right away
+  avnd::effect_container<Labelled> labelled;
+  labelled.init_channels(3, 3);
+  avnd::shared_controls<Labelled> direct;
+  direct.write(labelled, 1, [](auto& field) {
+    if constexpr (avnd::float_parameter<std::decay_t<decltype(field)>>)
+      field.value = 2.f;
+  });
+  direct.write_raw(labelled, 0, [](auto& field) {
+    if constexpr (avnd::string_parameter<std::decay_t<decltype(field)>>)
+      field.value = "bar";
+  });
+  bool each = labelled.effect[2].inputs.gain.value == 2.f
+              && labelled.effect[1].inputs.label.value == "bar";
+  std::printf("each: %s\n", each ? "ok" : "FAILED");
+
+  // Through a host
+  exhs::example_processor<Gain> proc{false};
+  proc.set_channels(2, 2);
+  proc.start(4, 48000.);
+  float in[4]{1.f, 1.f, 1.f, 1.f}, l[4], r[4];
+  float* ins[2]{in, in};
+  float* outs[2]{l, r};
+  proc.apply_control(0, 4.f);
+  proc.apply_control(1, 0.5f);
+  proc.process(ins, 2, outs, 2, 4);
+  const bool host = l[0] == 4.5f && r[3] == 4.5f;
+  proc.stop();
+  std::printf("host: %s\n", host ? "ok" : "FAILED");
+
+  return once && each && host ? 0 : 1;
+}
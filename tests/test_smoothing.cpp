@@ -0,0 +1,183 @@
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/smoothing_storage.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+#include <halp/smoothed_controls.hpp>
+
+#include <cmath>
+#include <cstdio>
+
+// Checks the ramps of smoothed parameters against their closed forms.
+// 1 ms at 8 kHz: ramps of 8 frames.
+struct Gain
+{
+  halp_meta(name, "Gain")
+
+  struct
+  {
+    halp::smoothed<halp::hslider_f32<"Gain">, 1.> gain;
+    halp::exp_smoothed<halp::hslider_f32<"Pan">, 1.> pan;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  float operator()(float x) { return x * inputs.gain; }
+};
+
+static bool near(double a, double b)
+{
+  return std::abs(a - b) < 1e-6;
+}
+
+// ramp[i] == f(i) for the whole buffer
+template <typename FP, typename F>
+static bool ramp_is(avnd::span<const FP> ramp, std::size_t frames, F f)
+{
+  if (ramp.size() != frames)
+    return false;
+  for (std::size_t i = 0; i < frames; i++)
+    if (!near(ramp[i], f(int(i))))
+      return false;
+  return true;
+}
+
+int main()
+{
+  // Linear: 8 frames from the current value to the target, then the target
+  bool linear = true;
+  {
+    avnd::parameter_smoother<double> s;
+    s.prepare(1., false, 8000., 16);
+
+    // The first buffer starts at the value, without ramp
+    s.run(0., 16);
+    linear &= s.ramp().empty();
+
+    s.run(1., 16);
+    linear &= ramp_is(s.ramp(), 16, [](int i) { return i < 8 ? (i + 1) / 8. : 1.; });
+    s.run(1., 16);
+    linear &= s.ramp().empty();
+
+    // Across buffers shorter than the ramp
+    s.run(0., 4);
+    linear &= ramp_is(s.ramp(), 4, [](int i) { return 1. - (i + 1) / 8.; });
+    s.run(0., 4);
+    linear &= ramp_is(s.ramp(), 4, [](int i) { return 0.5 - (i + 1) / 8.; });
+    s.run(0., 4);
+    linear &= s.ramp().empty();
+  }
+  std::printf("linear: %s\n", linear ? "ok" : "FAILED");
+
+  // A new target in the middle of a ramp restarts it from where it is
+  bool restart = true;
+  {
+    avnd::parameter_smoother<double> s;
+    s.prepare(1., false, 8000., 16);
+    s.run(0., 16);
+    s.run(1., 4);
+    restart &= ramp_is(s.ramp(), 4, [](int i) { return (i + 1) / 8.; });
+
+    // From 0.5 to -0.5 in 8 frames
+    s.run(-0.5, 16);
+    restart &= ramp_is(
+        s.ramp(), 16, [](int i) { return i < 8 ? 0.5 - (i + 1) / 8. : -0.5; });
+
+    // The same target does not restart it
+    s.run(1., 4);
+    s.run(1., 4);
+    restart &= ramp_is(s.ramp(), 4, [](int i) { return -0.5 + 1.5 * (i + 5) / 8.; });
+  }
+  std::printf("restart: %s\n", restart ? "ok" : "FAILED");
+
+  // Exponential: target + (start - target) * exp(-t / 8 frames), then the target
+  bool exponential = true;
+  {
+    avnd::parameter_smoother<double> s;
+    s.prepare(1., true, 8000., 16);
+    s.run(0., 16);
+    exponential &= s.ramp().empty();
+
+    int elapsed = 0;
+    int buffers = 0;
+    do
+    {
+      s.run(1., 16);
+      if (!s.ramp().empty())
+        exponential &= ramp_is(s.ramp(), 16, [elapsed](int i) {
+          return 1. - std::exp(-(elapsed + i + 1) / 8.);
+        });
+      elapsed += 16;
+      buffers++;
+    } while (!s.ramp().empty() && buffers < 100);
+
+    // exp(-n / 8) gets below 1e-5 after 93 frames: the sixth buffer ends on the
+    // target, the seventh has no ramp
+    exponential &= buffers == 7;
+
+    // A new target restarts from the current value
+    s.run(0., 16);
+    exponential &= ramp_is(s.ramp(), 16, [](int i) { return std::exp(-(i + 1) / 8.); });
+  }
+  std::printf("exponential: %s\n", exponential ? "ok" : "FAILED");
+
+  // A buffer longer than the one it was prepared for jumps to the target
+  bool snap = true;
+  for (bool exp : {false, true})
+  {
+    avnd::parameter_smoother<float> s;
+    s.prepare(1., exp, 8000., 16);
+    s.run(0.f, 16);
+    s.run(1.f, 4);
+    snap &= !s.ramp().empty();
+    s.run(0.f, 32);
+    snap &= s.ramp().empty();
+    s.run(0.f, 16);
+    snap &= s.ramp().empty();
+  }
+  std::printf("snap: %s\n", snap ? "ok" : "FAILED");
+
+  // The duplicated instances share one ramp per update
+  bool shared = true;
+  {
+    avnd::effect_container<Gain> fx;
+    fx.init_channels(3, 3);
+    for (auto& instance : fx.effect)
+    {
+      instance.inputs.gain.value = 0.f;
+      instance.inputs.pan.value = 0.f;
+    }
+    avnd::smoothing_storage<Gain> smoothing;
+    smoothing.prepare(fx, 8000., 16);
+    smoothing.update(fx, 16);
+    shared &= fx.effect[2].inputs.gain.stable() && fx.effect[0].inputs.pan.stable();
+
+    for (auto& instance : fx.effect)
+    {
+      instance.inputs.gain.value = 1.f;
+      instance.inputs.pan.value = 1.f;
+    }
+    smoothing.update(fx, 16);
+    for (auto& instance : fx.effect)
+    {
+      auto& in = instance.inputs;
+      shared &= in.gain.ramp.data() == fx.effect[0].inputs.gain.ramp.data()
+                && in.pan.ramp.data() == fx.effect[0].inputs.pan.ramp.data();
+      shared &= ramp_is<float>(
+          in.gain.ramp, 16, [](int i) { return i < 8 ? (i + 1) / 8. : 1.; });
+      shared &= ramp_is<float>(
+          in.pan.ramp, 16, [](int i) { return 1. - std::exp(-(i + 1) / 8.); });
+    }
+
+    // The next update computes the next part of the ramp, once
+    smoothing.update(fx, 16);
+    shared &= fx.effect[0].inputs.gain.stable() && fx.effect[1].inputs.gain.stable()
+              && ramp_is<float>(fx.effect[1].inputs.pan.ramp, 16, [](int i) {
+                   return 1. - std::exp(-(i + 17) / 8.);
+                 });
+  }
+  std::printf("shared: %s\n", shared ? "ok" : "FAILED");
+
+  return linear && restart && exponential && snap && shared ? 0 : 1;
+}
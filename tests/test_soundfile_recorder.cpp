@@ -0,0 +1,223 @@
+#include <avnd/wrappers/soundfile_recorder.hpp>
+#include <avnd/wrappers/soundfile_stream.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+// Checks that the recorded frames end up in the files, in order,
+// and that nothing blocks when the disk does not keep up
+struct Recorder
+{
+  halp_meta(name, "Recorder")
+
+  struct
+  {
+  } inputs;
+
+  struct
+  {
+    halp::soundfile_recorder_port<"Take", 3, 4096> take;
+  } outputs;
+
+  void operator()(int frames) { }
+};
+
+static_assert(avnd::soundfile_recorder_port<halp::soundfile_recorder_port<"A">>);
+static_assert(avnd::soundfile_recorder_output_introspection<Recorder>::size == 1);
+
+static std::string temp_file(const char* name)
+{
+  return (std::filesystem::temp_directory_path()
+          / (std::string{"avnd_recorder_"} + name + ".wav"))
+      .string();
+}
+
+static float sample(int c, int64_t i)
+{
+  return float(c) + float(i % 997) / 1000.f;
+}
+
+// Writes frames [first; first + n[ of the test signal
+static int64_t record(avnd::recorded_soundfile& rec, int channels, int64_t first, int64_t n)
+{
+  std::vector<std::vector<float>> data(channels, std::vector<float>(n));
+  std::vector<const float*> ptrs;
+  for (int c = 0; c < channels; c++)
+  {
+    for (int64_t i = 0; i < n; i++)
+      data[c][i] = sample(c, first + i);
+    ptrs.push_back(data[c].data());
+  }
+  return rec.write(ptrs.data(), n);
+}
+
+// The file has frames [first; first + n[ of the test signal
+static bool check_file(const std::string& path, int channels, int64_t first, int64_t n)
+{
+  auto src = avnd::wav_soundfile_source::open_wav(path);
+  if (!src || src->channels() != channels || src->frames() != n
+      || src->sample_rate() != 44100.)
+    return false;
+
+  std::vector<std::vector<float>> data(channels, std::vector<float>(n));
+  std::vector<float*> ptrs;
+  for (auto& c : data)
+    ptrs.push_back(c.data());
+  src->read(0, n, ptrs.data());
+
+  bool ok = true;
+  for (int c = 0; c < channels; c++)
+    for (int64_t i = 0; i < n; i++)
+      ok &= data[c][i] == sample(c, first + i);
+  return ok;
+}
+
+static bool check_files()
+{
+  const auto a = temp_file("a"), b = temp_file("b");
+  {
+    // The ring holds both takes: nothing depends on how fast the writer drains it
+    avnd::recorded_soundfile rec{4, 40 * 256 + 500};
+    rec.prepare(44100.);
+
+    // Not recording yet
+    bool ok = record(rec, 4, 0, 256) == 0;
+
+    rec.open(a);
+    for (int i = 0; i < 40; i++)
+      ok &= record(rec, 4, i * 256, 256) == 256;
+    rec.open(b);
+    for (int i = 0; i < 5; i++)
+      ok &= record(rec, 4, 100000 + i * 100, 100) == 100;
+    rec.open({});
+    ok &= record(rec, 4, 0, 256) == 0;
+    if (!ok)
+      return false;
+  }
+
+  const bool ok = check_file(a, 4, 0, 40 * 256) && check_file(b, 4, 100000, 500);
+  std::filesystem::remove(a);
+  std::filesystem::remove(b);
+  return ok;
+}
+
+// A disk which does not take anything until it is released
+static std::atomic_bool disk_ready{false};
+struct slow_sink final : avnd::soundfile_sink
+{
+  static std::unique_ptr<avnd::soundfile_sink>
+  create(const std::string&, int32_t, double)
+  {
+    return std::make_unique<slow_sink>();
+  }
+  bool write(const float* const*, int64_t frames) override
+  {
+    while (!disk_ready)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    written += frames;
+    return true;
+  }
+  bool finalize() override { return true; }
+  static inline std::atomic<int64_t> written{};
+};
+
+static bool check_overruns()
+{
+  bool ok = true;
+  {
+    avnd::recorded_soundfile rec{2, 4096, &slow_sink::create};
+    halp::soundfile_recorder_view view;
+    rec.open("slow");
+
+    // The ring holds 4096 frames, the rest is dropped without waiting
+    int64_t queued = 0;
+    for (int i = 0; i < 20; i++)
+      queued += record(rec, 2, i * 512, 512);
+    rec.update(view);
+    ok &= queued >= 4096 && queued < 20 * 512;
+    ok &= view.recording && view.frames == queued && view.dropped == 20 * 512 - queued;
+
+    disk_ready = true;
+  }
+  // Everything which was queued got written before finishing the file
+  ok &= slow_sink::written >= 4096;
+  return ok;
+}
+
+static bool check_errors()
+{
+  const auto c = temp_file("c");
+  bool ok = true;
+  {
+    avnd::recorded_soundfile rec{1, 4096};
+    halp::soundfile_recorder_view view;
+    rec.open((std::filesystem::temp_directory_path() / "avnd/does/not/exist.wav").string());
+    for (int i = 0; i < 1000 && !view.error; i++)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      rec.update(view);
+    }
+    ok &= view.error;
+
+    // A new file clears it
+    rec.open(c);
+    rec.update(view);
+    ok &= !view.error && view.recording;
+    rec.open({});
+    rec.update(view);
+    ok &= !view.recording;
+  }
+  std::filesystem::remove(c);
+  return ok;
+}
+
+static bool check_port()
+{
+  const auto d = temp_file("d");
+  bool ok = true;
+  {
+    avnd::effect_container<Recorder> fx;
+    avnd::soundfile_recorder_storage<Recorder> storage;
+    storage.init(fx, 44100.);
+
+    auto& take = fx.outputs().take;
+    ok &= !take && take.soundfile.channels == 3;
+
+    take.open(d);
+    storage.update(fx);
+    ok &= bool(take);
+
+    float a[64], b[64], c[64];
+    for (int i = 0; i < 64; i++)
+    {
+      a[i] = sample(0, i);
+      b[i] = sample(1, i);
+      c[i] = sample(2, i);
+    }
+    const float* in[3]{a, b, c};
+    ok &= take.write(in, 64) == 64;
+    storage.update(fx);
+    ok &= take.soundfile.frames == 64 && take.soundfile.dropped == 0;
+  }
+  ok &= check_file(d, 3, 0, 64);
+  std::filesystem::remove(d);
+  return ok;
+}
+
+int main()
+{
+  const bool files = check_files();
+  const bool overruns = check_overruns();
+  const bool errors = check_errors();
+  const bool port = check_port();
+  std::printf("files: %s\n", files ? "ok" : "FAILED");
+  std::printf("overruns: %s\n", overruns ? "ok" : "FAILED");
+  std::printf("errors: %s\n", errors ? "ok" : "FAILED");
+  std::printf("port: %s\n", port ? "ok" : "FAILED");
+  return files && overruns && errors && port ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/state.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+#include <vector>
+
+// Checks that the states written by save_state come back, including from the
+// projects saved with another version of the processor
+struct Synth
+{
+  halp_meta(name, "Synth")
+
+  struct
+  {
+    halp::hslider_f32<"Cutoff", halp::range{.min = 0., .max = 1., .init = 0.5}> cutoff;
+    halp::hslider_i32<"Voices", halp::range{.min = 1, .max = 16, .init = 4}> voices;
+    halp::lineedit<"Preset", "init"> preset;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  void operator()(int frames) { }
+};
+
+// The next version: reordered, with a new control
+struct SynthV2
+{
+  halp_meta(name, "Synth")
+
+  struct
+  {
+    halp::lineedit<"Preset", "init"> preset;
+    halp::toggle<"Legato", halp::toggle_setup{.init = false}> legato;
+    halp::hslider_f32<"Cutoff", halp::range{.min = 0., .max = 1., .init = 0.5}> cutoff;
+    halp::hslider_i32<"Voices", halp::range{.min = 1, .max = 16, .init = 4}> voices;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  void operator()(int frames) { }
+};
+
+// Duplicated per channel
+struct Gain
+{
+  halp_meta(name, "Gain")
+
+  struct
+  {
+    halp::hslider_f32<"Gain", halp::range{.min = 0., .max = 10., .init = 1.}> gain;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  float operator()(float x) { return x * inputs.gain; }
+};
+
+int main()
+{
+  std::vector<char> buffer;
+
+  // Round trip
+  avnd::effect_container<Synth> a;
+  a.inputs().cutoff.value = 0.25f;
+  a.inputs().voices.value = 12;
+  a.inputs().preset.value = "a rather long preset name, past any small string";
+  avnd::save_state<Synth>(a.inputs(), buffer);
+  bool round_trip = buffer.size() == avnd::state_size<Synth>(a.inputs())
+                    && avnd::is_state(buffer.data(), buffer.size());
+
+  avnd::effect_container<Synth> b;
+  round_trip &= avnd::load_state<Synth>(b.inputs(), buffer.data(), buffer.size());
+  round_trip &= b.inputs().cutoff.value == 0.25f && b.inputs().voices.value == 12
+                && b.inputs().preset.value == a.inputs().preset.value;
+  std::printf("round trip: %s\n", round_trip ? "ok" : "FAILED");
+
+  // Truncated: the complete records are loaded, the others are left untouched
+  bool truncated = true;
+  {
+    avnd::effect_container<Synth> c;
+    truncated &= avnd::load_state<Synth>(c.inputs(), buffer.data(), buffer.size() - 1);
+    truncated &= c.inputs().cutoff.value == 0.25f && c.inputs().voices.value == 12
+                 && c.inputs().preset.value == "init";
+
+    avnd::effect_container<Synth> d;
+    truncated &= !avnd::load_state<Synth>(d.inputs(), buffer.data(), 6);
+    truncated &= !avnd::load_state<Synth>(d.inputs(), buffer.data(), 0);
+    truncated &= d.inputs().cutoff.value == 0.5f;
+
+    // A record header without its data
+    truncated &= avnd::load_state<Synth>(
+        d.inputs(), buffer.data(),
+        avnd::state_format::header_size + avnd::state_format::record_header_size + 2);
+    truncated &= d.inputs().cutoff.value == 0.5f && d.inputs().voices.value == 4;
+
+    // Newer versions of the format are refused
+    std::vector<char> newer = buffer;
+    newer[4] = char(avnd::state_format::version + 1);
+    truncated &= !avnd::load_state<Synth>(d.inputs(), newer.data(), newer.size());
+  }
+  std::printf("truncated: %s\n", truncated ? "ok" : "FAILED");
+
+  // Saved by the first version, loaded by the second one and back
+  bool versions = true;
+  {
+    avnd::effect_container<SynthV2> v2;
+    v2.inputs().legato.value = true;
+    versions &= avnd::load_state<SynthV2>(v2.inputs(), buffer.data(), buffer.size());
+    versions &= v2.inputs().cutoff.value == 0.25f && v2.inputs().voices.value == 12
+                && v2.inputs().preset.value == a.inputs().preset.value
+                && v2.inputs().legato.value == true;
+
+    std::vector<char> saved;
+    v2.inputs().cutoff.value = 0.75f;
+    avnd::save_state<SynthV2>(v2.inputs(), saved);
+    avnd::effect_container<Synth> v1;
+    versions &= avnd::load_state<Synth>(v1.inputs(), saved.data(), saved.size());
+    versions &= v1.inputs().cutoff.value == 0.75f && v1.inputs().voices.value == 12
+                && v1.inputs().preset.value == a.inputs().preset.value;
+  }
+  std::printf("versions: %s\n", versions ? "ok" : "FAILED");
+
+  // Duplicated instances: one state whatever the channel count, loaded in all of them
+  bool duplicated = true;
+  {
+    avnd::effect_container<Gain> mono;
+    mono.init_channels(1, 1);
+    mono.effect[0].inputs.gain.value = 3.f;
+    std::vector<char> one;
+    avnd::save_state<Gain>(mono.inputs(), one);
+
+    avnd::effect_container<Gain> quad;
+    quad.init_channels(4, 4);
+    quad.effect[0].inputs.gain.value = 3.f;
+    std::vector<char> four;
+    avnd::save_state<Gain>(quad.inputs(), four);
+    duplicated &= one == four && four.size() == avnd::state_size<Gain>(quad.inputs());
+
+    avnd::effect_container<Gain> stereo;
+    stereo.init_channels(2, 2);
+    duplicated &= avnd::load_state<Gain>(stereo.inputs(), four.data(), four.size());
+    duplicated &= stereo.effect[0].inputs.gain.value == 3.f
+                  && stereo.effect[1].inputs.gain.value == 3.f;
+  }
+  std::printf("duplicated: %s\n", duplicated ? "ok" : "FAILED");
+
+  return round_trip && truncated && versions && duplicated ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include <halp/statistics.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Checks halp::statistics against the definitions computed in several passes,
+// and that the summaries of blocks merge into the one of the whole array
+namespace st = halp::statistics;
+
+struct reference
+{
+  double sum{}, variance{}, entropy{}, centroid{}, flatness{};
+};
+
+static reference compute(const std::vector<double>& x)
+{
+  reference r;
+  const double n = x.size();
+  double log_sum = 0.;
+  bool zero = false;
+  for (std::size_t i = 0; i < x.size(); i++)
+  {
+    r.sum += x[i];
+    r.centroid += i * x[i];
+    zero |= x[i] == 0.;
+    log_sum += x[i] > 0. ? std::log(x[i]) : 0.;
+  }
+  const double mean = r.sum / n;
+  for (double v : x)
+  {
+    r.variance += (v - mean) * (v - mean) / n;
+    const double p = v / r.sum;
+    r.entropy -= p > 0. ? p * std::log2(p) : 0.;
+  }
+  r.centroid /= r.sum;
+  r.flatness = zero ? 0. : std::exp(log_sum / n) / mean;
+  return r;
+}
+
+template <typename FP>
+static bool close(FP value, double expected, double tolerance)
+{
+  return std::abs(double(value) - expected) <= tolerance * std::max(1., std::abs(expected));
+}
+
+template <typename FP>
+static bool check(const st::summary<FP>& s, const reference& r, double tolerance)
+{
+  return close(s.sum, r.sum, tolerance) && close(s.variance(), r.variance, tolerance)
+         && close(s.entropy(), r.entropy, tolerance)
+         && close(s.centroid(), r.centroid, tolerance)
+         && close(s.flatness(), r.flatness, tolerance);
+}
+
+template <typename FP>
+static bool check_type(const char* type, double tolerance)
+{
+  std::mt19937 gen{42};
+  std::uniform_real_distribution<double> dist{0., 2.};
+  bool ok = true;
+
+  for (int n : {1, 7, 16, 100, 1023})
+  {
+    // A spectrum with a few empty bins, above an offset which stresses the variance
+    std::vector<double> x(n);
+    std::vector<FP> values(n);
+    for (int i = 0; i < n; i++)
+    {
+      x[i] = (i % 11 == 5) ? 0. : 10. + dist(gen);
+      values[i] = FP(x[i]);
+      x[i] = values[i];
+    }
+    const auto r = compute(x);
+
+    const auto whole = st::summarize(values.data(), n);
+    ok &= whole.count == n && whole.zeros == (n + 5) / 11 && !whole.has_negatives();
+    ok &= check(whole, r, tolerance);
+    ok &= close(st::sum(values.data(), n), r.sum, tolerance);
+
+    // The same values, given in blocks of varying sizes
+    st::running<FP> stream;
+    for (int i = 0, block = 1; i < n; i += block, block = block * 2 + 1)
+      stream(values.data() + i, std::min(block, n - i));
+    ok &= stream->count == n && check(*stream, r, tolerance);
+  }
+
+  const FP negative[]{1, -1, 2};
+  ok &= st::summarize(negative, 3).negatives == 1;
+
+  // A uniform distribution over n bins has log2(n) bits, and is flat
+  std::vector<FP> uniform(64, FP(0.25));
+  const auto u = st::summarize(uniform.data(), 64);
+  ok &= close(u.entropy(), 6., tolerance) && close(u.flatness(), 1., tolerance)
+        && u.variance() == FP(0);
+
+  std::printf("statistics %s: %s\n", type, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main()
+{
+  bool ok = check_type<double>("double", 1e-6);
+  ok &= check_type<float>("float", 1e-4);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#include <avnd/concepts/midi_port.hpp>
+#include <halp/midi.hpp>
+
+#include <cstdio>
+#include <vector>
+
+// Checks that halp::midi_sysex_stream_bus keeps views of the complete sysex,
+// and puts together the dumps received in several parts across buffers
+int main()
+{
+  using bus_type = halp::midi_sysex_stream_bus<"In", 64>;
+  static_assert(avnd::sysex_view_midi_port<bus_type>);
+  static_assert(!avnd::sysex_view_midi_port<halp::midi_event_bus<"In">>);
+
+  bool ok = true;
+  bus_type bus;
+
+  // A complete message is not copied
+  const uint8_t whole[]{0xF0, 0x7E, 0x01, 0xF7};
+  bus.sysex.push_view(whole, sizeof(whole), 3);
+  ok &= bus.sysex.size() == 1 && bus.sysex[0].bytes.data() == whole
+        && bus.sysex[0].timestamp == 3;
+  bus.sysex.clear();
+
+  // A dump in three parts, over two buffers
+  std::vector<uint8_t> first{0xF0, 0x43, 0x10};
+  bus.sysex.push_view(first.data(), first.size(), 10);
+  first.assign(first.size(), 0);
+  ok &= bus.sysex.empty();
+  bus.sysex.clear();
+
+  const uint8_t middle[]{0x01, 0x02};
+  const uint8_t last[]{0x03, 0xF7};
+  bus.sysex.push_view(middle, sizeof(middle), 0);
+  bus.sysex.push_view(last, sizeof(last), 5);
+  const std::vector<uint8_t> dump{0xF0, 0x43, 0x10, 0x01, 0x02, 0x03, 0xF7};
+  ok &= bus.sysex.size() == 1 && bus.sysex[0].timestamp == 5
+        && std::vector<uint8_t>(bus.sysex[0].bytes.begin(), bus.sysex[0].bytes.end())
+               == dump;
+
+  // Copies go through the buffer, a message which does not fit is dropped
+  bus.sysex.clear();
+  bus.sysex.push(whole, sizeof(whole), 1);
+  std::vector<uint8_t> big(100, 0x10);
+  big.front() = 0xF0;
+  big.back() = 0xF7;
+  ok &= !bus.sysex.push(big.data(), big.size(), 2);
+  ok &= bus.sysex.size() == 1 && bus.sysex[0].bytes.data() != whole
+        && bus.sysex[0].bytes.size() == sizeof(whole) && bus.sysex.overflows() == 1;
+
+  // Without a buffer, only the complete messages are kept
+  halp::midi_sysex_stream_bus<"In"> views;
+  views.sysex.push_view(whole, sizeof(whole), 0);
+  const uint8_t start[]{0xF0, 0x43};
+  views.sysex.push_view(start, sizeof(start), 0);
+  views.sysex.push_view(last, sizeof(last), 0);
+  ok &= views.sysex.size() == 1 && views.sysex.overflows() == 2;
+
+  std::printf("sysex stream: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
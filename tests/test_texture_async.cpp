@@ -0,0 +1,116 @@
+#include <avnd/wrappers/texture_async.hpp>
+#include <examples/Tutorial/TextureGeneratorExample.hpp>
+#include <halp/meta.hpp>
+#include <halp/texture.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// Checks that slow texture generators do not block the render thread,
+// and that the frames they finish come with their changed flag set
+struct Slow
+{
+  halp_meta(name, "Slow")
+  halp_flag(asynchronous_textures);
+
+  struct
+  {
+  } inputs;
+
+  struct
+  {
+    halp::texture_output<"Out"> image;
+  } outputs;
+
+  void operator()()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    if (!outputs.image.texture.bytes)
+      outputs.image.create(2, 2);
+    outputs.image.texture.bytes[0] = (unsigned char)++frame;
+    outputs.image.upload();
+  }
+
+  int frame = 0;
+};
+
+struct Fast
+{
+  halp_meta(name, "Fast")
+
+  struct
+  {
+  } inputs;
+
+  struct
+  {
+    halp::texture_output<"Out"> image;
+  } outputs;
+
+  void operator()() { frame++; }
+
+  int frame = 0;
+};
+
+static_assert(avnd::asynchronous_texture_generator<Slow>);
+static_assert(!avnd::asynchronous_texture_generator<Fast>);
+static_assert(avnd::asynchronous_texture_generator<examples::TextureGeneratorExample>);
+
+using namespace std::chrono;
+template <typename F>
+static bool wait_for(F f)
+{
+  for (int i = 0; i < 2000 && !f(); i++)
+    std::this_thread::sleep_for(milliseconds(1));
+  return f();
+}
+
+int main()
+{
+  // A frame rendered each millisecond: the generator skips those it did not finish
+  avnd::effect_container<Slow> fx;
+  bool async = true;
+  {
+    avnd::texture_generation<Slow> gen{fx};
+    async &= gen.idle();
+
+    const auto t0 = steady_clock::now();
+    int ticks = 0, started = 0;
+    for (; ticks < 10; ticks++)
+    {
+      if (gen.idle())
+      {
+        gen.start();
+        started++;
+      }
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+    async &= steady_clock::now() - t0 < milliseconds(45) && started == 1;
+
+    // The frame is there once it is done
+    async &= wait_for([&] { return gen.idle(); });
+    auto& out = fx.effect.outputs.image;
+    async &= gen.frames() == 1 && out.texture.changed && out.texture.bytes[0] == 1;
+
+    // The host uploads it, then asks for the next one
+    out.texture.changed = false;
+    gen.start();
+    async &= !gen.idle();
+    async &= wait_for([&] { return gen.idle(); });
+    async &= gen.frames() == 2 && out.texture.changed && out.texture.bytes[0] == 2;
+
+    // Going away while a frame is generated
+    gen.start();
+  }
+  std::printf("async: %s\n", async ? "ok" : "FAILED");
+
+  // Without the flag, the frames are generated by the render thread
+  avnd::effect_container<Fast> fast;
+  avnd::texture_generation<Fast> sync{fast};
+  sync.start();
+  const bool synchronous = sync.idle() && fast.effect.frame == 1;
+  std::printf("sync: %s\n", synchronous ? "ok" : "FAILED");
+
+  return async && synchronous ? 0 : 1;
+}
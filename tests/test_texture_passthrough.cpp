@@ -0,0 +1,91 @@
+#include <avnd/wrappers/texture_passthrough.hpp>
+#include <avnd/wrappers/texture_pool.hpp>
+#include <examples/Tutorial/TexturePassthroughExample.hpp>
+#include <halp/meta.hpp>
+#include <halp/texture.hpp>
+
+#include <cstdio>
+
+// Checks that textures are only read back when the processor needs their pixels,
+// and that forwarded textures are passed on without being uploaded
+struct Filter
+{
+  halp_meta(name, "Filter")
+
+  struct
+  {
+    halp::texture_input<"Pixels"> a;
+    halp::texture_input<"Gpu", halp::rgba_texture, avnd::texture_access::gpu> b;
+    halp::texture_input<"Probe", halp::rgba_texture, avnd::texture_access::on_demand> c;
+  } inputs;
+
+  struct
+  {
+    halp::texture_output<"Out"> image;
+  } outputs;
+
+  void operator()() { }
+};
+
+int main()
+{
+  int gpu_texture = 0;
+  unsigned char pixels[4 * 4 * 4]{};
+
+  // Only the ports which need their pixels
+  avnd::effect_container<Filter> fx;
+  auto& in = fx.effect.inputs;
+  bool readbacks = avnd::texture_readbacks(fx) == 0b001;
+  in.c.request_pixels();
+  readbacks &= avnd::texture_readbacks(fx) == 0b101;
+
+  avnd::set_texture_handle(in.c, &gpu_texture, 4, 4);
+  readbacks &= !in.c.has_pixels() && in.c.texture.width == 4;
+  avnd::set_texture_pixels(in.c, pixels, 4, 4);
+  readbacks &= in.c.has_pixels() && avnd::texture_readbacks(fx) == 0b001;
+  std::printf("readbacks: %s\n", readbacks ? "ok" : "FAILED");
+
+  // A forwarded texture stays on the GPU, and is not given to the pool
+  avnd::texture_pool pool;
+  avnd::texture_output_storage<Filter> storage;
+  storage.init(fx, pool);
+  auto& out = fx.effect.outputs.image;
+  out.create(8, 8);
+  bool forward = out.texture.bytes != nullptr && avnd::forwarded_texture(out) == nullptr;
+
+  avnd::set_texture_handle(in.b, &gpu_texture, 16, 16);
+  out.forward(in.b);
+  forward &= avnd::forwarded_texture(out) == &gpu_texture && !out.texture.bytes
+             && out.texture.width == 16;
+
+  // Writing pixels again: back to an upload
+  out.create(8, 8);
+  forward &= out.texture.bytes != nullptr && avnd::forwarded_texture(out) == nullptr;
+
+  // e.g. the output of a CPU processor before this one, which still owns it
+  unsigned char* upstream = pool.allocate(64);
+  avnd::set_texture_pixels(in.c, upstream, 4, 4);
+  out.forward(in.c);
+  storage.release();
+  forward &= pool.allocate(64) != upstream;
+  std::printf("forward: %s\n", forward ? "ok" : "FAILED");
+
+  // A processor which only measures its input
+  avnd::effect_container<examples::TexturePassthroughExample> probe;
+  auto& p = probe.effect;
+  avnd::set_texture_handle(p.inputs.image, &gpu_texture, 4, 4);
+  p();
+  bool example = avnd::texture_readbacks(probe) == 0 && p.outputs.width == 4
+                 && avnd::forwarded_texture(p.outputs.image) == &gpu_texture;
+  p.inputs.probe.value = true;
+  p();
+  example &= avnd::texture_readbacks(probe) == 1;
+  pixels[(2 * 4 + 2) * 4] = 255;
+  avnd::set_texture_pixels(p.inputs.image, pixels, 4, 4);
+  p.inputs.probe.value = false;
+  p();
+  example &= p.outputs.center == int(0xff000000) && avnd::texture_readbacks(probe) == 0;
+  std::printf("example: %s\n", example ? "ok" : "FAILED");
+
+  return readbacks && forward && example ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#include <avnd/wrappers/thread_pool.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+
+// Back-to-back runs, as from an audio callback: each task of each run must be
+// executed exactly once, and be done when run() returns
+int main()
+{
+  avnd::thread_pool pool{3};
+
+  constexpr int runs = 20000;
+  constexpr int max_tasks = 17;
+  std::array<std::atomic<int>, max_tasks> counts{};
+
+  int failures = 0;
+  for (int r = 0; r < runs; r++)
+  {
+    const int tasks = 2 + r % (max_tasks - 1);
+    for (auto& c : counts)
+      c.store(0, std::memory_order_relaxed);
+
+    pool.run(tasks, [&](int t) { counts[t].fetch_add(1, std::memory_order_relaxed); });
+
+    for (int t = 0; t < max_tasks; t++)
+      if (counts[t].load(std::memory_order_relaxed) != (t < tasks ? 1 : 0))
+        failures++;
+  }
+  std::printf("exactly once: %s\n", failures == 0 ? "ok" : "FAILED");
+
+  // Too many tasks to split: they run on the calling thread
+  int count = 0;
+  pool.run(avnd::thread_pool::max_tasks + 1, [&](int) { count++; });
+  const bool inline_tasks = count == avnd::thread_pool::max_tasks + 1;
+  std::printf("inline: %s\n", inline_tasks ? "ok" : "FAILED");
+
+  return failures == 0 && inline_tasks ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+#include <avnd/introspection/messages.hpp>
+#include <examples/Helpers/TimedTrigger.hpp>
+
+#include <boost/mp11.hpp>
+
+#include <cstdio>
+#include <type_traits>
+#include <vector>
+
+// Checks that the frame of a timed message is not counted among the arguments
+// the host sends, and that the hits start at the sample they are due at
+using trigger = examples::helpers::TimedTrigger;
+using hit_message = decltype(trigger::messages::m_hit);
+
+static_assert(avnd::timed_message<hit_message>);
+static_assert(std::is_same_v<
+              avnd::host_message_arguments<hit_message>, boost::mp11::mp_list<float>>);
+
+int main()
+{
+  trigger t;
+  t.prepare({.input_channels = 0, .output_channels = 1, .frames = 16, .rate = 48000.});
+
+  std::vector<double> out(16);
+  t.outputs.audio.channel = out.data();
+
+  // Received out of order
+  t.hit(1.f, 10);
+  t.hit(0.5f, 3);
+  t(16);
+
+  const bool ok = out[2] == 0. && out[3] == 0.5 && out[9] > 0. && out[9] < 0.5
+                  && out[10] == 1. && t.hit_count == 0;
+  std::printf("hits at their frame: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
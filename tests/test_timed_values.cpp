@@ -0,0 +1,71 @@
+#include <halp/sample_accurate_controls.hpp>
+
+#include <cstdio>
+#include <vector>
+
+static bool check_insert()
+{
+  bool ok = true;
+  halp::timed_values<float> v;
+  v.reserve(64);
+
+  // In order: appended
+  v[0] = 1.f;
+  const auto* storage = &*v.begin();
+  v[10] = 2.f;
+  v[10] = 3.f;
+  v[20] = 4.f;
+  ok &= v.size() == 3 && v.begin()->second == 1.f;
+
+  // Out of order: inserted at its place
+  v[5] = 5.f;
+  v[10] = 6.f;
+  int frames[4]{}, k = 0;
+  for (auto& [frame, value] : v)
+    frames[k++] = frame;
+  ok &= v.size() == 4 && frames[0] == 0 && frames[1] == 5 && frames[2] == 10 && frames[3] == 20;
+  ok &= (v.begin() + 2)->second == 6.f;
+
+  // No allocation within the reserved space
+  for (int i = 21; i < 64; i++)
+    v[i] = float(i);
+  ok &= &*v.begin() == storage;
+
+  v.clear();
+  ok &= v.empty();
+  return ok;
+}
+
+static bool check_render()
+{
+  bool ok = true;
+  halp::timed_values<float> v;
+  v.reserve(8);
+  v[2] = 1.f;
+  v[5] = 2.f;
+
+  float out[8];
+  const float last = v.render(out, -1.f);
+  const float expected[8]{-1.f, -1.f, 1.f, 1.f, 1.f, 2.f, 2.f, 2.f};
+  for (int i = 0; i < 8; i++)
+    ok &= out[i] == expected[i];
+  ok &= last == 2.f;
+
+  // Nothing in the buffer: the previous value
+  v.clear();
+  ok &= v.render(out, 3.f) == 3.f && out[0] == 3.f && out[7] == 3.f;
+
+  // Values past the end of the output only change the returned one
+  v[20] = 7.f;
+  ok &= v.render(std::span<float>(out, 4), 0.f) == 7.f && out[3] == 0.f;
+  return ok;
+}
+
+int main()
+{
+  const bool insert = check_insert();
+  const bool render = check_render();
+  std::printf("insert: %s\n", insert ? "ok" : "FAILED");
+  std::printf("render: %s\n", render ? "ok" : "FAILED");
+  return insert && render ? 0 : 1;
+}
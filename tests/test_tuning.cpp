@@ -0,0 +1,48 @@
+#include <halp/shared_resource.hpp>
+#include <halp/tuning.hpp>
+
+#include <cmath>
+#include <cstdio>
+
+// Checks that halp::tuning_table gives the frequencies of equal temperament
+// and of Scala scales, fractional notes included
+static bool near_cents(double f, double expected)
+{
+  return std::abs(1200. * std::log2(f / expected)) < 0.01;
+}
+
+int main()
+{
+  auto tet = halp::shared_resource<halp::tuning_table>(440.);
+  bool ok = tet == halp::shared_resource<halp::tuning_table>(440.);
+  for (double note : {0., 21.5, 60., 69., 69.25, 100.75, 127.})
+    ok &= near_cents(tet->frequency(note), 440. * std::exp2((note - 69.) / 12.));
+  ok &= near_cents(tet->frequency(200.), tet->frequency(127));
+  std::printf("equal temperament, shared: %s\n", ok ? "ok" : "FAILED");
+
+  // Just intonation pentatonic: C D E G A, from middle C
+  const char* scala = "! pentatonic.scl\n"
+                      "!\n"
+                      "Just pentatonic\n"
+                      " 5\n"
+                      "!\n"
+                      " 9/8\n"
+                      " 5/4\n"
+                      " 3/2\n"
+                      " 884.359\n"
+                      " 2\n";
+  const auto cents = halp::tuning_table::scala_cents(scala);
+  halp::tuning_table just{cents, 60, 261.6255653};
+  const double c = 261.6255653;
+  const bool scl = cents.size() == 5 && near_cents(just.frequency(60), c)
+                   && near_cents(just.frequency(62), c * 5. / 4.)
+                   && near_cents(just.frequency(65), c * 2.)
+                   && near_cents(just.frequency(59), c / 2. * std::exp2(884.359 / 1200.))
+                   && near_cents(just.frequency(60.5), c * std::sqrt(9. / 8.));
+  std::printf("scala scale: %s\n", scl ? "ok" : "FAILED");
+
+  const bool invalid = halp::tuning_table::scala_cents("x\n3\n3/2\n").empty();
+  std::printf("truncated scala file: %s\n", invalid ? "ok" : "FAILED");
+
+  return ok && scl && invalid ? 0 : 1;
+}
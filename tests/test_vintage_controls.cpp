@@ -0,0 +1,60 @@
+#include <avnd/binding/vintage/atomic_controls.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <cstdio>
+#include <memory>
+
+struct ManyControls
+{
+  halp_meta(name, "Many controls")
+
+  struct
+  {
+    halp::hslider_f32<"A", halp::range{.min = 0., .max = 1., .init = 0.5}> a;
+    halp::hslider_f32<"B", halp::range{.min = 0., .max = 10., .init = 0.}> b;
+    halp::hslider_i32<"C", halp::range{.min = 0, .max = 100, .init = 0}> c;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  void operator()(int frames) { }
+};
+
+int main()
+{
+  bool ok = true;
+  avnd::effect_container<ManyControls> effect;
+  avnd::init_controls(effect.inputs());
+
+  auto controls = std::make_unique<vintage::Controls<ManyControls>>();
+  avnd::shared_controls<ManyControls> sink;
+  controls->read(effect.inputs());
+  ok &= controls->parameters[0].load() == 0.5f;
+
+  // read() marks everything: the first buffer gets all the values
+  effect.inputs().a.value = 0.25f;
+  controls->write(effect, sink);
+  ok &= effect.inputs().a.value == 0.5f;
+
+  // Only what the host set since is written: the processor keeps its own change of b
+  effect.inputs().b.value = 3.f;
+  controls->set(2, 0.5f);
+  controls->write(effect, sink);
+  ok &= effect.inputs().b.value == 3.f;
+  ok &= effect.inputs().c.value == 50;
+
+  controls->set(1, 0.5f);
+  controls->write(effect, sink);
+  ok &= effect.inputs().b.value == 5.f;
+
+  // Written once
+  effect.inputs().b.value = 1.f;
+  controls->write(effect, sink);
+  ok &= effect.inputs().b.value == 1.f;
+
+  std::printf("vintage controls: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
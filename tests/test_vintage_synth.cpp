@@ -0,0 +1,306 @@
+#include <avnd/binding/vintage/polyphonic_synth.hpp>
+#include <halp/controls.hpp>
+#include <halp/meta.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Each voice adds its volume to the output, and stops right after its note off
+struct Synth
+{
+  halp_meta(name, "Synth")
+  static constexpr int channels = 1;
+  static constexpr int polyphony = 8;
+
+  struct
+  {
+    halp::hslider_f32<"Level", halp::range{.min = 0., .max = 1., .init = 1.}> level;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  struct voice
+  {
+    float frequency{};
+    float volume{};
+    int elapsed{};
+    int release_frame{-1};
+    bool recycle{};
+
+    template <typename sample_t>
+    void process(Synth& synth, sample_t** outputs, int32_t frames)
+    {
+      for (int32_t i = 0; i < frames; i++)
+        outputs[0][i] += volume * synth.inputs.level;
+      elapsed += frames;
+      if (release_frame >= 0)
+        recycle = true;
+    }
+  };
+};
+
+// Enough voices to be rendered on several threads
+struct ParallelSynth
+{
+  halp_meta(name, "Parallel synth")
+  static constexpr int channels = 2;
+  static constexpr int polyphony = 64;
+  static constexpr bool parallel_voices = true;
+  static constexpr int min_parallel_voices = 4;
+
+  struct
+  {
+    halp::hslider_f32<"Level", halp::range{.min = 0., .max = 1., .init = 1.}> level;
+  } inputs;
+
+  struct
+  {
+  } outputs;
+
+  struct voice
+  {
+    float frequency{};
+    float volume{};
+    int elapsed{};
+    int release_frame{-1};
+    bool recycle{};
+
+    template <typename sample_t>
+    void process(ParallelSynth& synth, sample_t** outputs, int32_t frames)
+    {
+      for (int32_t i = 0; i < frames; i++)
+      {
+        const sample_t s
+            = volume * synth.inputs.level * std::sin(0.001 * frequency * (elapsed + i));
+        outputs[0][i] += s;
+        outputs[1][i] += s / 2;
+      }
+      elapsed += frames;
+    }
+  };
+};
+
+// Counts the buffers whose voices were split in several tasks
+struct counting_executor final : avnd::task_executor
+{
+  avnd::thread_pool pool{3};
+  int runs{};
+
+  int size() const noexcept override { return pool.size(); }
+  bool execute(int tasks, void (*call)(void*, int), void* context) noexcept override
+  {
+    runs++;
+    return pool.execute(tasks, call, context);
+  }
+};
+
+using synth_type = vintage::PolyphonicSynthesizer<Synth>;
+
+VINTAGE_DEFINE_SYNTH(Synth)
+
+static intptr_t host(vintage::Effect*, int32_t, int32_t, intptr_t, void*, float)
+{
+  return 0;
+}
+
+// Hosts allocate the event lists with as many pointers as they need
+template <int N>
+struct event_list
+{
+  int32_t numEvents{};
+  intptr_t reserved{};
+  vintage::Event* events[N]{};
+};
+
+static vintage::MidiEvent note(int status, int pitch, int velocity, int32_t frame)
+{
+  vintage::MidiEvent e;
+  e.deltaFrames = frame;
+  e.midiData[0] = char(status);
+  e.midiData[1] = char(pitch);
+  e.midiData[2] = char(velocity);
+  return e;
+}
+
+template <typename S, std::size_t N>
+static void send(S& synth, vintage::MidiEvent (&midi)[N])
+{
+  event_list<N> list;
+  list.numEvents = N;
+  for (std::size_t i = 0; i < N; i++)
+    list.events[i] = reinterpret_cast<vintage::Event*>(&midi[i]);
+  synth.dispatcher(
+      &synth, int32_t(vintage::EffectOpcodes::ProcessEvents), 0, 0, &list, 0.f);
+}
+
+template <typename S = synth_type>
+static S* make_synth()
+{
+  auto synth = new S{host};
+  auto dispatch = [synth](vintage::EffectOpcodes op, intptr_t value, float opt) {
+    return synth->dispatcher(synth, int32_t(op), 0, value, nullptr, opt);
+  };
+  dispatch(vintage::EffectOpcodes::SetSampleRate, 0, 48000.f);
+  dispatch(vintage::EffectOpcodes::SetBlockSize, 64, 0.f);
+  dispatch(vintage::EffectOpcodes::MainsChanged, 1, 0.f);
+  return synth;
+}
+
+static void close(vintage::Effect* synth)
+{
+  synth->dispatcher(synth, int32_t(vintage::EffectOpcodes::Close), 0, 0, nullptr, 0.f);
+}
+
+int main()
+{
+  // A note plays until its note off, then its voices go back to the pool
+  bool lifecycle = true;
+  {
+    auto synth = make_synth();
+    lifecycle &= synth->numOutputs == 1 && synth->numParams == 4
+                 && (int(synth->flags) & int(vintage::EffectFlags::IsSynth));
+
+    std::vector<float> out(64);
+    float* outs[1]{out.data()};
+
+    vintage::MidiEvent on[]{note(0x90, 60, 127, 0), note(0x90, 64, 127, 0)};
+    send(*synth, on);
+    synth->processReplacing(synth, nullptr, outs, 64);
+    lifecycle &= out[0] == 2.f && out[63] == 2.f;
+
+    // The level goes through the controls of the synth
+    synth->setParameter(synth, 0, 0.5f);
+    synth->processReplacing(synth, nullptr, outs, 64);
+    lifecycle &= out[0] == 1.f && synth->getParameter(synth, 0) == 0.5f;
+
+    // A note on with a null velocity is a note off
+    vintage::MidiEvent off[]{note(0x80, 60, 0, 0), note(0x90, 64, 0, 0)};
+    send(*synth, off);
+    synth->processReplacing(synth, nullptr, outs, 64);
+    lifecycle &= out[0] == 1.f && synth->voices.empty();
+
+    synth->processReplacing(synth, nullptr, outs, 64);
+    lifecycle &= out[0] == 0.f;
+
+    // In double precision too
+    std::vector<double> dout(64);
+    double* douts[1]{dout.data()};
+    send(*synth, on);
+    synth->processDoubleReplacing(synth, nullptr, douts, 64);
+    lifecycle &= dout[0] == 1.;
+    close(synth);
+  }
+  std::printf("lifecycle: %s\n", lifecycle ? "ok" : "FAILED");
+
+  // A note with deltaFrames = k starts at frame k
+  bool offsets = true;
+  for (int k : {0, 1, 17, 63})
+  {
+    auto synth = make_synth();
+    std::vector<float> out(64, -1.f);
+    float* outs[1]{out.data()};
+
+    vintage::MidiEvent on[]{note(0x90, 60, 127, k)};
+    send(*synth, on);
+    synth->processReplacing(synth, nullptr, outs, 64);
+    for (int i = 0; i < 64; i++)
+      offsets &= out[i] == (i < k ? 0.f : 1.f);
+    close(synth);
+  }
+  {
+    // The events are sorted by frame, those past the buffer are applied at its end
+    auto synth = make_synth();
+    std::vector<float> out(64);
+    float* outs[1]{out.data()};
+
+    vintage::MidiEvent on[]{
+        note(0x90, 64, 127, 40), note(0x90, 60, 127, 10), note(0x90, 67, 127, 100)};
+    send(*synth, on);
+    synth->processReplacing(synth, nullptr, outs, 64);
+    offsets &= out[9] == 0.f && out[10] == 1.f && out[39] == 1.f && out[40] == 2.f
+               && out[63] == 2.f;
+
+    synth->processReplacing(synth, nullptr, outs, 64);
+    offsets &= out[0] == 3.f;
+    close(synth);
+  }
+  std::printf("offsets: %s\n", offsets ? "ok" : "FAILED");
+
+  // The voices rendered on several threads sum up to the same output as on one
+  bool parallel = true;
+  {
+    using parallel_type = vintage::PolyphonicSynthesizer<ParallelSynth>;
+    counting_executor executor;
+    auto threaded = make_synth<parallel_type>();
+    auto single = make_synth<parallel_type>();
+    threaded->set_thread_pool(&executor);
+    single->set_thread_pool(nullptr);
+
+    // Two voices per note, with the unison one
+    vintage::MidiEvent on[24];
+    for (int n = 0; n < 24; n++)
+      on[n] = note(0x90, 40 + n, 20 + 4 * n, 3 * n);
+    send(*threaded, on);
+    send(*single, on);
+
+    // Longer than the scratch buffers of the tasks
+    constexpr int frames = 600;
+    auto compare = [&]<typename sample_t>(sample_t) {
+      std::vector<sample_t> a(2 * frames), b(2 * frames);
+      sample_t* as[2]{a.data(), a.data() + frames};
+      sample_t* bs[2]{b.data(), b.data() + frames};
+      for (int k = 0; k < 3; k++)
+      {
+        if constexpr (std::is_same_v<sample_t, float>)
+        {
+          threaded->processReplacing(threaded, nullptr, as, frames);
+          single->processReplacing(single, nullptr, bs, frames);
+        }
+        else
+        {
+          threaded->processDoubleReplacing(threaded, nullptr, as, frames);
+          single->processDoubleReplacing(single, nullptr, bs, frames);
+        }
+        // Only the order of the sums differs
+        for (int i = 0; i < 2 * frames; i++)
+          parallel &= std::abs(a[i] - b[i]) < 1e-5;
+        parallel &= a[frames - 1] != 0.;
+      }
+    };
+    compare(float{});
+    compare(double{});
+    parallel &= executor.runs > 0 && threaded->voices.size() == 48;
+    close(threaded);
+    close(single);
+  }
+  std::printf("parallel: %s\n", parallel ? "ok" : "FAILED");
+
+  // The events past the capacity of a buffer are dropped instead of allocating
+  bool events = true;
+  {
+    auto synth = static_cast<synth_type*>(VSTPluginMain(host));
+    events &= synth->numInputs == 1 && synth->numOutputs == 1;
+    synth->dispatcher(
+        synth, int32_t(vintage::EffectOpcodes::MainsChanged), 0, 1, nullptr, 0.f);
+
+    std::vector<float> out(64);
+    float* outs[1]{out.data()};
+    const auto bend = note(0xE0, 0, 0x40, 0);
+    for (std::size_t k = 0; k < synth->pending.size(); k++)
+      synth->midi_input(bend);
+    synth->midi_input(note(0x90, 60, 127, 0));
+    synth->processReplacing(synth, nullptr, outs, 64);
+    events &= out[0] == 0.f && synth->voices.empty();
+
+    synth->midi_input(note(0x90, 60, 127, 0));
+    synth->processReplacing(synth, nullptr, outs, 64);
+    events &= out[0] == 1.f;
+    close(synth);
+  }
+  std::printf("events: %s\n", events ? "ok" : "FAILED");
+
+  return lifecycle && offsets && parallel && events ? 0 : 1;
+}
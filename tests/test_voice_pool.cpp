@@ -0,0 +1,232 @@
+#include <avnd/binding/vintage/voice_pool.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+struct voice
+{
+  float note{};
+  float velocity{};
+  bool released{};
+};
+
+using pool_type = vintage::voice_pool<voice, 4>;
+
+static std::vector<int> playing(pool_type& pool)
+{
+  std::vector<int> res;
+  pool.for_each([&](int i, voice&) { res.push_back(i); });
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+int main()
+{
+  using vintage::voice_stealing;
+
+  // Allocating takes the free voices, releasing gives them back
+  bool allocation = true;
+  {
+    pool_type pool;
+    allocation &= pool.empty() && pool.capacity() == 4;
+
+    auto a = pool.allocate({.note = 60, .velocity = 100}, voice_stealing::oldest);
+    auto b = pool.allocate({.note = 62, .velocity = 100}, voice_stealing::oldest);
+    allocation &= !a.stolen && !b.stolen && a.index != b.index && pool.size() == 2;
+    allocation &= pool[a.index].note == 60 && pool[b.index].note == 62;
+
+    pool.release(a.index);
+    allocation &= pool.size() == 1 && playing(pool) == std::vector<int>{b.index};
+
+    // The free list is LIFO: the voice released last is the next one
+    auto c = pool.allocate({.note = 64, .velocity = 100}, voice_stealing::oldest);
+    allocation &= !c.stolen && c.index == a.index && pool[c.index].note == 64;
+
+    // All the voices can be used, then the next note steals one
+    pool.allocate({.note = 65}, voice_stealing::oldest);
+    pool.allocate({.note = 67}, voice_stealing::oldest);
+    allocation &= pool.size() == 4 && playing(pool) == std::vector<int>{0, 1, 2, 3};
+    auto d = pool.allocate({.note = 69}, voice_stealing::oldest);
+    allocation &= d.stolen && pool.size() == 4;
+
+    // Released then allocated again, any number of times
+    for (int k = 0; k < 1000; k++)
+    {
+      pool.for_each([&](int i, voice&) { pool.release(i); });
+      for (int n = 0; n < 4; n++)
+        allocation &= !pool.allocate({.note = float(n)}, voice_stealing::oldest).stolen;
+    }
+    allocation &= pool.size() == 4 && playing(pool) == std::vector<int>{0, 1, 2, 3};
+
+    pool.clear();
+    allocation &= pool.empty();
+  }
+  std::printf("allocation: %s\n", allocation ? "ok" : "FAILED");
+
+  // Each policy picks its victim when all the voices play
+  bool stealing = true;
+  {
+    // The voice which started first
+    pool_type pool;
+    const int first = pool.allocate({.note = 60}, voice_stealing::oldest).index;
+    pool.allocate({.note = 61}, voice_stealing::oldest);
+    pool.allocate({.note = 62}, voice_stealing::oldest);
+    pool.allocate({.note = 63}, voice_stealing::oldest);
+    auto s = pool.allocate({.note = 70}, voice_stealing::oldest);
+    stealing &= s.stolen && s.index == first && pool[first].note == 70;
+
+    // Then the second one: the stolen voice is now the newest
+    auto t = pool.allocate({.note = 71}, voice_stealing::oldest);
+    stealing &= t.stolen && t.index != first && pool[t.index].note == 71;
+  }
+  {
+    // Released voices first, then the lowest velocity
+    pool_type pool;
+    constexpr auto quietest = voice_stealing::quietest;
+    pool.allocate({.note = 60, .velocity = 30}, quietest);
+    const int loud = pool.allocate({.note = 61, .velocity = 120}, quietest).index;
+    const int quiet = pool.allocate({.note = 62, .velocity = 10}, quietest).index;
+    pool.allocate({.note = 63, .velocity = 50}, quietest);
+
+    pool[loud].released = true;
+    auto s = pool.allocate({.note = 70, .velocity = 100}, voice_stealing::quietest);
+    stealing &= s.stolen && s.index == loud;
+
+    auto t = pool.allocate({.note = 71, .velocity = 100}, voice_stealing::quietest);
+    stealing &= t.stolen && t.index == quiet;
+  }
+  {
+    // The oldest voice of the same note, else the oldest one
+    pool_type pool;
+    const int first = pool.allocate({.note = 60}, voice_stealing::same_note).index;
+    const int old64 = pool.allocate({.note = 64}, voice_stealing::same_note).index;
+    pool.allocate({.note = 67}, voice_stealing::same_note);
+    const int new64 = pool.allocate({.note = 64}, voice_stealing::same_note).index;
+
+    auto s = pool.allocate({.note = 64}, voice_stealing::same_note);
+    stealing &= s.stolen && s.index == old64;
+
+    auto t = pool.allocate({.note = 64}, voice_stealing::same_note);
+    stealing &= t.stolen && t.index == new64;
+
+    auto u = pool.allocate({.note = 72}, voice_stealing::same_note);
+    stealing &= u.stolen && u.index == first;
+  }
+  std::printf("stealing: %s\n", stealing ? "ok" : "FAILED");
+
+  // for_each visits every voice once, even when it releases them along the way
+  bool iteration = true;
+  {
+    pool_type pool;
+    for (int n = 0; n < 4; n++)
+      pool.allocate({.note = float(60 + n)}, voice_stealing::oldest);
+
+    int visited = 0;
+    pool.for_each([&](int i, voice& v) {
+      visited++;
+      if (int(v.note) % 2 == 0)
+        pool.release(i);
+    });
+    iteration &= visited == 4 && pool.size() == 2;
+
+    std::vector<float> notes;
+    pool.for_each([&](int, voice& v) { notes.push_back(v.note); });
+    std::sort(notes.begin(), notes.end());
+    iteration &= notes == std::vector<float>{61, 63};
+
+    visited = 0;
+    pool.for_each([&](int i, voice&) {
+      visited++;
+      pool.release(i);
+    });
+    iteration &= visited == 2 && pool.empty();
+  }
+  std::printf("iteration: %s\n", iteration ? "ok" : "FAILED");
+
+  // The voices of each note, as used by note off
+  bool notes = true;
+  {
+    auto of_note = [](auto& pool, int note) {
+      std::vector<int> res;
+      pool.for_each_of_note(note, [&](int i, voice& v) {
+        if (int(v.note) != note)
+          res.push_back(-1);
+        res.push_back(i);
+      });
+      std::sort(res.begin(), res.end());
+      return res;
+    };
+
+    // A note off releases all the voices of its note, and only them
+    vintage::voice_pool<voice, 8> pool;
+    const int a = pool.allocate({.note = 60}, voice_stealing::oldest).index;
+    const int b = pool.allocate({.note = 64}, voice_stealing::oldest).index;
+    const int c = pool.allocate({.note = 60}, voice_stealing::oldest).index;
+    const int d = pool.allocate({.note = 60}, voice_stealing::oldest).index;
+    notes &= of_note(pool, 60) == std::vector<int>{a, c, d};
+    notes &= of_note(pool, 64) == std::vector<int>{b} && of_note(pool, 61).empty();
+
+    pool.for_each_of_note(60, [&](int i, voice&) { pool.release(i); });
+    notes &= of_note(pool, 60).empty() && pool.size() == 1;
+
+    // The released voices are reused for other notes
+    pool.allocate({.note = 62}, voice_stealing::oldest);
+    pool.allocate({.note = 62}, voice_stealing::oldest);
+    notes &= of_note(pool, 62).size() == 2 && of_note(pool, 60).empty();
+  }
+  {
+    // Stealing the voice in the middle of the list of a note keeps the list linked
+    pool_type pool;
+    const int a = pool.allocate({.note = 60}, voice_stealing::oldest).index;
+    const int b = pool.allocate({.note = 60}, voice_stealing::oldest).index;
+    const int c = pool.allocate({.note = 60}, voice_stealing::oldest).index;
+    pool.allocate({.note = 67}, voice_stealing::oldest);
+
+    // b is in the middle of the list of 60 (c, b, a): released, it is the victim
+    pool[b].released = true;
+    auto s = pool.allocate({.note = 72}, voice_stealing::quietest);
+    notes &= s.stolen && s.index == b;
+
+    int count = 0;
+    bool only_60 = true;
+    pool.for_each_of_note(60, [&](int i, voice& v) {
+      count++;
+      only_60 &= v.note == 60 && (i == a || i == c);
+    });
+    notes &= count == 2 && only_60;
+
+    count = 0;
+    pool.for_each_of_note(72, [&](int i, voice&) { count += i == b; });
+    notes &= count == 1;
+
+    // The head and the tail of the list can go too
+    pool.release(c);
+    pool.release(a);
+    count = 0;
+    pool.for_each_of_note(60, [&](int, voice&) { count++; });
+    notes &= count == 0;
+
+    // Stealing the same note takes its oldest voice, then relinks it
+    pool.allocate({.note = 72}, voice_stealing::same_note);
+    pool.allocate({.note = 72}, voice_stealing::same_note);
+    auto t = pool.allocate({.note = 72}, voice_stealing::same_note);
+    notes &= t.stolen && t.index == b;
+    count = 0;
+    pool.for_each_of_note(72, [&](int, voice&) { count++; });
+    notes &= count == 3;
+
+    // clear() empties the lists of the notes as well
+    pool.clear();
+    count = 0;
+    for (int n : {60, 67, 72})
+      pool.for_each_of_note(n, [&](int, voice&) { count++; });
+    notes &= count == 0 && pool.empty();
+    pool.allocate({.note = 72}, voice_stealing::oldest);
+    pool.for_each_of_note(72, [&](int, voice&) { count++; });
+    notes &= count == 1;
+  }
+  std::printf("notes: %s\n", notes ? "ok" : "FAILED");
+
+  return allocation && stealing && iteration && notes ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#include <avnd/wrappers/effect_container.hpp>
+#include <avnd/wrappers/worker.hpp>
+#include <halp/meta.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Checks that avnd::worker_storage runs the requests outside of the calling thread
+// and applies the responses in order from deliver()
+struct Squares
+{
+  halp_meta(name, "Squares")
+
+  struct
+  {
+  } inputs;
+
+  struct
+  {
+    std::function<void(int)> request;
+
+    static std::function<void(Squares&)> work(int n)
+    {
+      const auto id = std::this_thread::get_id();
+      return [n, id](Squares& self) {
+        self.results.push_back(n * n);
+        self.on_worker &= id != std::this_thread::get_id();
+      };
+    }
+  } worker;
+
+  std::vector<int> results;
+  bool on_worker{true};
+};
+
+int main()
+{
+  avnd::effect_container<Squares> impl;
+  avnd::worker_storage<Squares> worker;
+  worker.start(impl);
+
+  impl.effect.results.reserve(8);
+  for (int i = 1; i <= 4; i++)
+    impl.effect.worker.request(i);
+
+  using namespace std::chrono;
+  const auto deadline = steady_clock::now() + seconds(5);
+  while (impl.effect.results.size() < 4 && steady_clock::now() < deadline)
+  {
+    worker.deliver(impl);
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+
+  const bool ok = impl.effect.results == std::vector<int>{1, 4, 9, 16};
+  std::printf("responses applied in order: %s\n", ok ? "ok" : "FAILED");
+  std::printf("work done on another thread: %s\n", impl.effect.on_worker ? "ok" : "FAILED");
+  return ok && impl.effect.on_worker ? 0 : 1;
+}